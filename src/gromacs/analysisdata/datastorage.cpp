@@ -55,6 +55,7 @@
 #include "gromacs/analysisdata/paralleloptions.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/mutex.h"
 
 namespace gmx
 {
@@ -245,7 +246,7 @@ class AnalysisDataStorageImpl
          * There is always one unused frame in the buffer, which is initialized
          * such that when \a firstFrameLocation_ is incremented, it becomes
          * valid.  This makes it easier to rotate the buffer in concurrent
-         * access scenarions (which are not yet otherwise implemented).
+         * access scenarios (see \a mutex_).
          */
         FrameList               frames_;
         //! Location of oldest frame in \a frames_.
@@ -270,6 +271,17 @@ class AnalysisDataStorageImpl
          * frame (see \a frames_).
          */
         int                     nextIndex_;
+        /*! \brief
+         * Protects the frame bookkeeping when frames are processed in parallel.
+         *
+         * When \a pendingLimit_ is larger than one, frames can be started and
+         * finished from multiple threads, concurrently with
+         * finishFrameSerial() for older frames.  The mutex protects
+         * \a frames_, \a firstFrameLocation_, \a nextIndex_ and \a builders_.
+         * It is never held while notifying modules, as the modules may access
+         * this storage or other storage objects from their callbacks.
+         */
+        mutable Mutex           mutex_;
 };
 
 /********************************************************************
@@ -497,18 +509,25 @@ AnalysisDataStorageImpl::getFrameBuilder()
 void
 AnalysisDataStorageImpl::finishFrame(int index)
 {
-    const int storageIndex = computeStorageLocation(index);
-    GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
-
-    AnalysisDataStorageFrameData &storedFrame = *frames_[storageIndex];
-    GMX_RELEASE_ASSERT(storedFrame.isStarted(),
+    AnalysisDataStorageFrameData *storedFrame;
+    {
+        lock_guard<Mutex> lock(mutex_);
+        const int         storageIndex = computeStorageLocation(index);
+        GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
+        storedFrame = frames_[storageIndex].get();
+    }
+    GMX_RELEASE_ASSERT(storedFrame->isStarted(),
                        "finishFrame() called for frame before startFrame()");
-    GMX_RELEASE_ASSERT(!storedFrame.isFinished(),
+    GMX_RELEASE_ASSERT(!storedFrame->isFinished(),
                        "finishFrame() called twice for the same frame");
-    GMX_RELEASE_ASSERT(storedFrame.frameIndex() == index,
+    GMX_RELEASE_ASSERT(storedFrame->frameIndex() == index,
                        "Inconsistent internal frame indexing");
-    builders_.push_back(storedFrame.finishFrame(isMultipoint()));
-    modules_->notifyParallelFrameFinish(storedFrame.header());
+    AnalysisDataFrameBuilderPointer builder(storedFrame->finishFrame(isMultipoint()));
+    {
+        lock_guard<Mutex> lock(mutex_);
+        builders_.push_back(std::move(builder));
+    }
+    modules_->notifyParallelFrameFinish(storedFrame->header());
     if (pendingLimit_ == 1)
     {
         finishFrameSerial(index);
@@ -521,35 +540,39 @@ AnalysisDataStorageImpl::finishFrameSerial(int index)
 {
     GMX_RELEASE_ASSERT(index == firstUnnotifiedIndex_,
                        "Out of order finisFrameSerial() calls");
-    const int storageIndex = computeStorageLocation(index);
-    GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
-
-    AnalysisDataStorageFrameData &storedFrame = *frames_[storageIndex];
-    GMX_RELEASE_ASSERT(storedFrame.frameIndex() == index,
+    AnalysisDataStorageFrameData *storedFrame;
+    {
+        lock_guard<Mutex> lock(mutex_);
+        const int         storageIndex = computeStorageLocation(index);
+        GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
+        storedFrame = frames_[storageIndex].get();
+    }
+    GMX_RELEASE_ASSERT(storedFrame->frameIndex() == index,
                        "Inconsistent internal frame indexing");
-    GMX_RELEASE_ASSERT(storedFrame.isFinished(),
+    GMX_RELEASE_ASSERT(storedFrame->isFinished(),
                        "finishFrameSerial() called before finishFrame()");
-    GMX_RELEASE_ASSERT(!storedFrame.isNotified(),
+    GMX_RELEASE_ASSERT(!storedFrame->isNotified(),
                        "finishFrameSerial() called twice for the same frame");
     // Increment before the notifications to make the frame available
     // in the module callbacks.
     ++firstUnnotifiedIndex_;
     if (shouldNotifyImmediately())
     {
-        modules_->notifyFrameFinish(storedFrame.header());
+        modules_->notifyFrameFinish(storedFrame->header());
     }
     else
     {
-        modules_->notifyFrameStart(storedFrame.header());
-        for (int j = 0; j < storedFrame.pointSetCount(); ++j)
+        modules_->notifyFrameStart(storedFrame->header());
+        for (int j = 0; j < storedFrame->pointSetCount(); ++j)
         {
-            modules_->notifyPointsAdd(storedFrame.pointSet(j));
+            modules_->notifyPointsAdd(storedFrame->pointSet(j));
         }
-        modules_->notifyFrameFinish(storedFrame.header());
+        modules_->notifyFrameFinish(storedFrame->header());
     }
-    storedFrame.markNotified();
-    if (storedFrame.frameIndex() >= storageLimit_)
+    storedFrame->markNotified();
+    if (storedFrame->frameIndex() >= storageLimit_)
     {
+        lock_guard<Mutex> lock(mutex_);
         rotateBuffer();
     }
 }
@@ -792,7 +815,8 @@ AnalysisDataStorage::frameCount() const
 AnalysisDataFrameRef
 AnalysisDataStorage::tryGetDataFrame(int index) const
 {
-    int storageIndex = impl_->computeStorageLocation(index);
+    lock_guard<Mutex> lock(impl_->mutex_);
+    int               storageIndex = impl_->computeStorageLocation(index);
     if (storageIndex == -1)
     {
         return AnalysisDataFrameRef();
@@ -866,29 +890,32 @@ AnalysisDataStorage::startFrame(const AnalysisDataFrameHeader &header)
 {
     GMX_ASSERT(header.isValid(), "Invalid header");
     internal::AnalysisDataStorageFrameData *storedFrame;
-    if (impl_->storeAll())
     {
-        size_t size = header.index() + 1;
-        if (impl_->frames_.size() < size)
+        lock_guard<Mutex> lock(impl_->mutex_);
+        if (impl_->storeAll())
         {
-            impl_->extendBuffer(size);
+            size_t size = header.index() + 1;
+            if (impl_->frames_.size() < size)
+            {
+                impl_->extendBuffer(size);
+            }
+            storedFrame = impl_->frames_[header.index()].get();
         }
-        storedFrame = impl_->frames_[header.index()].get();
-    }
-    else
-    {
-        int storageIndex = impl_->computeStorageLocation(header.index());
-        if (storageIndex == -1)
+        else
         {
-            GMX_THROW(APIError("Out of bounds frame index"));
+            int storageIndex = impl_->computeStorageLocation(header.index());
+            if (storageIndex == -1)
+            {
+                GMX_THROW(APIError("Out of bounds frame index"));
+            }
+            storedFrame = impl_->frames_[storageIndex].get();
         }
-        storedFrame = impl_->frames_[storageIndex].get();
+        GMX_RELEASE_ASSERT(!storedFrame->isStarted(),
+                           "startFrame() called twice for the same frame");
+        GMX_RELEASE_ASSERT(storedFrame->frameIndex() == header.index(),
+                           "Inconsistent internal frame indexing");
+        storedFrame->startFrame(header, impl_->getFrameBuilder());
     }
-    GMX_RELEASE_ASSERT(!storedFrame->isStarted(),
-                       "startFrame() called twice for the same frame");
-    GMX_RELEASE_ASSERT(storedFrame->frameIndex() == header.index(),
-                       "Inconsistent internal frame indexing");
-    storedFrame->startFrame(header, impl_->getFrameBuilder());
     impl_->modules_->notifyParallelFrameStart(header);
     if (impl_->shouldNotifyImmediately())
     {
@@ -908,10 +935,14 @@ AnalysisDataStorage::startFrame(int index, real x, real dx)
 AnalysisDataStorageFrame &
 AnalysisDataStorage::currentFrame(int index)
 {
-    const int storageIndex = impl_->computeStorageLocation(index);
-    GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
-
-    internal::AnalysisDataStorageFrameData &storedFrame = *impl_->frames_[storageIndex];
+    internal::AnalysisDataStorageFrameData *storedFramePointer;
+    {
+        lock_guard<Mutex> lock(impl_->mutex_);
+        const int         storageIndex = impl_->computeStorageLocation(index);
+        GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
+        storedFramePointer = impl_->frames_[storageIndex].get();
+    }
+    internal::AnalysisDataStorageFrameData &storedFrame = *storedFramePointer;
     GMX_RELEASE_ASSERT(storedFrame.isStarted(),
                        "currentFrame() called for frame before startFrame()");
     GMX_RELEASE_ASSERT(!storedFrame.isFinished(),
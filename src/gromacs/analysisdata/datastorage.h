@@ -257,8 +257,10 @@ class AnalysisDataStorageFrame
  * AnalysisDataStorageFrame::finishPointSet()) take the responsibility of
  * calling all the notification methods in AnalysisDataModuleManager,
  *
- * \todo
- * Proper multi-threaded implementation.
+ * If startParallelDataStorage() is used, different frames can be started and
+ * finished concurrently from multiple threads, and finishFrameSerial() can be
+ * called concurrently with these for older frames.  finishFrameSerial() calls
+ * must still be made from a single thread at a time, in frame order.
  *
  * \inlibraryapi
  * \ingroup module_analysisdata
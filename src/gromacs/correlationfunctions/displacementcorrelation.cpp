@@ -0,0 +1,167 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::DisplacementCorrelation.
+ *
+ * \ingroup module_correlationfunctions
+ */
+#include "gmxpre.h"
+
+#include "displacementcorrelation.h"
+
+#include <algorithm>
+#include <initializer_list>
+
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/fatalerror.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+/*! \brief
+ * Returns the smallest even length of at least \p n with only factors 2, 3, 5.
+ *
+ * Such lengths are handled efficiently by all FFT libraries.
+ */
+int fftLength(int n)
+{
+    for (int length = std::max(n + (n % 2), 2);; length += 2)
+    {
+        int remainder = length;
+        for (int factor : { 2, 3, 5 })
+        {
+            while (remainder % factor == 0)
+            {
+                remainder /= factor;
+            }
+        }
+        if (remainder == 1)
+        {
+            return length;
+        }
+    }
+}
+
+}   // namespace
+
+DisplacementCorrelation::DisplacementCorrelation(int ndata)
+    : ndata_(ndata), nfft_(0), fft_(nullptr)
+{
+    if (ndata < 1)
+    {
+        GMX_THROW(InconsistentInputError("Time series must have at least one point"));
+    }
+    // Padding to twice the length avoids wrap-around in the circular
+    // correlation computed by the FFT.
+    nfft_ = fftLength(2*ndata);
+    work_.resize(nfft_);
+    transformA_.resize(nfft_/2 + 1);
+    transformB_.resize(nfft_/2 + 1);
+    if (gmx_fft_init_1d_real(&fft_, nfft_, GMX_FFT_FLAG_CONSERVATIVE) != 0)
+    {
+        gmx_fatal(FARGS, "Could not initialize an FFT of length %d", nfft_);
+    }
+}
+
+DisplacementCorrelation::~DisplacementCorrelation()
+{
+    gmx_fft_destroy(fft_);
+}
+
+void DisplacementCorrelation::transform(const real x[], double mean, t_complex *out)
+{
+    for (int i = 0; i < ndata_; i++)
+    {
+        work_[i] = x[i] - mean;
+    }
+    std::fill(work_.begin() + ndata_, work_.end(), 0);
+    gmx_fft_1d_real(fft_, GMX_FFT_REAL_TO_COMPLEX, work_.data(), out);
+}
+
+void DisplacementCorrelation::add(const real a[], const real b[], real weight,
+                                  real result[])
+{
+    const bool bAuto = (a == b);
+    double     meanA = 0, meanB = 0;
+    for (int i = 0; i < ndata_; i++)
+    {
+        meanA += a[i];
+        meanB += b[i];
+    }
+    meanA /= ndata_;
+    meanB /= ndata_;
+
+    /* The cross terms sum_k a[k]*b[k+m] + b[k]*a[k+m] are the inverse
+     * transform of 2 Re(conj(A) B).
+     */
+    transform(a, meanA, transformA_.data());
+    if (!bAuto)
+    {
+        transform(b, meanB, transformB_.data());
+    }
+    for (size_t i = 0; i < transformA_.size(); i++)
+    {
+        const t_complex &ta = transformA_[i];
+        const t_complex &tb = (bAuto ? transformA_[i] : transformB_[i]);
+        transformB_[i].re = 2*(ta.re*tb.re + ta.im*tb.im);
+        transformB_[i].im = 0;
+    }
+    gmx_fft_1d_real(fft_, GMX_FFT_COMPLEX_TO_REAL, transformB_.data(), work_.data());
+
+    /* The squared terms sum_k a[k+m]*b[k+m] + a[k]*b[k] are obtained by
+     * removing the terms at both ends of the full sum for each lag.
+     */
+    double sumSquares = 0;
+    for (int i = 0; i < ndata_; i++)
+    {
+        sumSquares += 2*(a[i] - meanA)*(b[i] - meanB);
+    }
+    for (int m = 0; m < ndata_; m++)
+    {
+        if (m > 0)
+        {
+            sumSquares -= (a[m - 1] - meanA)*(b[m - 1] - meanB);
+            sumSquares -= (a[ndata_ - m] - meanA)*(b[ndata_ - m] - meanB);
+        }
+        const double cross = work_[m]/nfft_;
+        result[m] += weight*(sumSquares - cross)/(ndata_ - m);
+    }
+}
+
+} // namespace gmx
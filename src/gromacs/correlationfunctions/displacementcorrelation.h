@@ -0,0 +1,126 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal
+ * \file
+ * \brief
+ * Declares gmx::DisplacementCorrelation for computing mean square
+ * displacements over all time origins using FFTs.
+ *
+ * \inlibraryapi
+ * \ingroup module_correlationfunctions
+ */
+#ifndef GMX_CORRELATIONFUNCTIONS_DISPLACEMENTCORRELATION_H
+#define GMX_CORRELATIONFUNCTIONS_DISPLACEMENTCORRELATION_H
+
+#include <vector>
+
+#include "gromacs/fft/fft.h"
+#include "gromacs/math/gmxcomplex.h"
+#include "gromacs/utility/classhelpers.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+
+/*! \libinternal \brief
+ * Computes displacement correlations of time series over all time origins.
+ *
+ * For two time series a and b with n points, computes for each lag m the
+ * average over the n-m time origins k of (a[k+m] - a[k])*(b[k+m] - b[k]).
+ * With a equal to b this is the mean square displacement along a single
+ * dimension.  The sums over time origins are computed with FFTs
+ * (Kneller et al., Comput. Phys. Commun. 91, 191 (1995)), so the cost is
+ * O(n log n) instead of the O(n^2) of an explicit loop over origins.
+ *
+ * An object holds an FFT setup and work arrays for a fixed number of points.
+ * It should only be used by a single thread at a time; use one object per
+ * thread to compute in parallel.
+ *
+ * \inlibraryapi
+ * \ingroup module_correlationfunctions
+ */
+class DisplacementCorrelation
+{
+    public:
+        /*! \brief
+         * Prepares for time series of \p ndata points.
+         *
+         * \throws gmx::InconsistentInputError if \p ndata < 1.
+         * \throws std::bad_alloc if out of memory.
+         */
+        explicit DisplacementCorrelation(int ndata);
+        ~DisplacementCorrelation();
+
+        //! Returns the number of points in the time series.
+        int dataCount() const { return ndata_; }
+
+        /*! \brief
+         * Adds the displacement correlation of two time series.
+         *
+         * \param[in]     a       First time series, dataCount() points.
+         * \param[in]     b       Second time series, dataCount() points.
+         *     May be the same array as \p a.
+         * \param[in]     weight  Factor to multiply the correlation with.
+         * \param[in,out] result  \p weight times the correlation is added to
+         *     the dataCount() values, one for each lag.
+         *
+         * The correlation does not depend on the mean of the series, which is
+         * subtracted before the transforms to preserve precision.
+         */
+        void add(const real a[], const real b[], real weight, real result[]);
+
+    private:
+        //! Copies \p x minus its mean into the FFT input and transforms it.
+        void transform(const real x[], double mean, t_complex *out);
+
+        //! Number of points in the time series.
+        int                    ndata_;
+        //! Length of the zero-padded transforms.
+        int                    nfft_;
+        //! FFT setup for real transforms of length `nfft_`.
+        gmx_fft_t              fft_;
+        //! Real-space work array.
+        std::vector<real>      work_;
+        //! Transform of the first series.
+        std::vector<t_complex> transformA_;
+        //! Transform of the second series.
+        std::vector<t_complex> transformB_;
+
+        GMX_DISALLOW_COPY_AND_ASSIGN(DisplacementCorrelation);
+};
+
+} // namespace gmx
+
+#endif
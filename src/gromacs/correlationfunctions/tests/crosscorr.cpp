@@ -0,0 +1,122 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for FFT-based cross correlation.
+ *
+ * \ingroup module_correlationfunctions
+ */
+#include "gmxpre.h"
+
+#include "gromacs/correlationfunctions/crosscorr.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace
+{
+
+//! Returns a test series of length \p n.
+std::vector<real> makeSeries(int n, int seed)
+{
+    std::vector<real> x(n);
+    for (int i = 0; i < n; i++)
+    {
+        x[i] = std::sin(0.37*(i + 1)*seed) + 0.1*seed;
+    }
+    return x;
+}
+
+//! Checks \p corr against an explicit sum over all time origins.
+void checkCrossCorrelation(const std::vector<real> &f,
+                           const std::vector<real> &g,
+                           const std::vector<real> &corr)
+{
+    const int n = f.size();
+    for (int t = 0; t < n; t++)
+    {
+        double sum = 0;
+        for (int i = 0; i + t < n; i++)
+        {
+            sum += f[i + t]*g[i];
+        }
+        EXPECT_REAL_EQ_TOL(sum, corr[t], test::absoluteTolerance(1e-4*n))
+        << "lag " << t;
+    }
+}
+
+TEST(CrossCorrelationTest, MatchesDirectSum)
+{
+    const int         n = 100;
+    std::vector<real> f = makeSeries(n, 3);
+    std::vector<real> g = makeSeries(n, 7);
+    std::vector<real> corr(n);
+
+    cross_corr(n, f.data(), g.data(), corr.data());
+    checkCrossCorrelation(f, g, corr);
+}
+
+TEST(CrossCorrelationTest, ComputesManyCorrelations)
+{
+    const int         nFunc        = 3;
+    int               nData[nFunc] = { 16, 57, 128 };
+    std::vector<real> f[nFunc], g[nFunc], corr[nFunc];
+    real             *fPtr[nFunc], *gPtr[nFunc], *corrPtr[nFunc];
+
+    for (int i = 0; i < nFunc; i++)
+    {
+        f[i]       = makeSeries(nData[i], i + 1);
+        g[i]       = makeSeries(nData[i], i + 5);
+        corr[i].resize(nData[i]);
+        fPtr[i]    = f[i].data();
+        gPtr[i]    = g[i].data();
+        corrPtr[i] = corr[i].data();
+    }
+    many_cross_corr(nFunc, nData, fPtr, gPtr, corrPtr);
+    for (int i = 0; i < nFunc; i++)
+    {
+        checkCrossCorrelation(f[i], g[i], corr[i]);
+    }
+}
+
+} // namespace
+} // namespace gmx
@@ -0,0 +1,138 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx::DisplacementCorrelation.
+ *
+ * \ingroup module_correlationfunctions
+ */
+#include "gmxpre.h"
+
+#include "gromacs/correlationfunctions/displacementcorrelation.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/exceptions.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+namespace
+{
+
+/*! \brief
+ * Computes the displacement correlation with an explicit loop over origins.
+ */
+std::vector<real> directCorrelation(const std::vector<real> &a,
+                                    const std::vector<real> &b)
+{
+    const int         n = a.size();
+    std::vector<real> result(n);
+    for (int m = 0; m < n; m++)
+    {
+        double sum = 0;
+        for (int k = 0; k + m < n; k++)
+        {
+            sum += (a[k + m] - a[k])*(b[k + m] - b[k]);
+        }
+        result[m] = sum/(n - m);
+    }
+    return result;
+}
+
+//! Returns a test time series resembling a diffusing coordinate.
+std::vector<real> makeSeries(int n, real offset, int seed)
+{
+    std::vector<real> x(n);
+    real              value = offset;
+    for (int i = 0; i < n; i++)
+    {
+        value += 0.1*std::sin(0.37*(i + 1)*seed) + 0.002*seed;
+        x[i]   = value;
+    }
+    return x;
+}
+
+class DisplacementCorrelationTest : public ::testing::Test
+{
+    public:
+        //! Compares the FFT result to the direct computation.
+        void runTest(int n, bool bCross)
+        {
+            const std::vector<real> a = makeSeries(n, 5.0, 3);
+            const std::vector<real> b = (bCross ? makeSeries(n, -2.0, 7) : a);
+            const std::vector<real> ref
+                = directCorrelation(a, bCross ? b : a);
+
+            DisplacementCorrelation corr(n);
+            EXPECT_EQ(n, corr.dataCount());
+            std::vector<real>       result(n, 1.0);
+            corr.add(a.data(), bCross ? b.data() : a.data(), 2.0, result.data());
+            for (int m = 0; m < n; m++)
+            {
+                EXPECT_REAL_EQ_TOL(1.0 + 2*ref[m], result[m],
+                                   test::relativeToleranceAsFloatingPoint(1 + 2*std::abs(ref[0]) + 2*std::abs(ref[n/2]), 1e-4))
+                << "lag " << m;
+            }
+        }
+};
+
+TEST_F(DisplacementCorrelationTest, ThrowsForEmptySeries)
+{
+    EXPECT_THROW_GMX(DisplacementCorrelation(0), InconsistentInputError);
+}
+
+TEST_F(DisplacementCorrelationTest, HandlesSinglePoint)
+{
+    runTest(1, false);
+}
+
+TEST_F(DisplacementCorrelationTest, ComputesMeanSquareDisplacement)
+{
+    runTest(97, false);
+}
+
+TEST_F(DisplacementCorrelationTest, ComputesCrossCorrelation)
+{
+    runTest(128, true);
+}
+
+} // namespace
+} // namespace gmx
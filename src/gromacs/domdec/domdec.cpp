@@ -381,9 +381,30 @@ void dd_get_constraint_range(const gmx_domdec_t *dd, int *at_start, int *at_end)
     *at_end   = dd->comm->nat[ddnatCON];
 }
 
-void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
+/*! \brief Copies received coordinates for pulse \p ind to their place in \p x, for non in-place communication */
+static void dd_move_x_copy_received(const gmx_domdec_ind_t *ind, int nzone,
+                                    const rvec *rbuf, rvec x[])
 {
-    int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
+    int j = 0;
+    for (int zone = 0; zone < nzone; zone++)
+    {
+        for (int i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
+        {
+            copy_rvec(rbuf[j], x[i]);
+            j++;
+        }
+    }
+}
+
+/*! \brief Communicates the halo coordinates, pulse by pulse
+ *
+ * With \p bStartLastPulse the last pulse is only started and
+ * dd_move_x_finish() should be called to complete it.
+ */
+static void dd_move_x_pulses(gmx_domdec_t *dd, matrix box, rvec x[],
+                             gmx_bool bStartLastPulse)
+{
+    int                    nzone, nat_tot, n, d, p, i, j, at0, at1;
     int                   *index, *cgindex;
     gmx_domdec_comm_t     *comm;
     gmx_domdec_comm_dim_t *cd;
@@ -470,20 +491,19 @@ void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
                 rbuf = comm->vbuf2.v;
             }
             /* Send and receive the coordinates */
+            if (bStartLastPulse && d == dd->ndim - 1 && p == cd->np - 1)
+            {
+                dd_sendrecv_rvec_start(dd, d, dddirBackward,
+                                       buf,  ind->nsend[nzone+1],
+                                       rbuf, ind->nrecv[nzone+1]);
+                return;
+            }
             dd_sendrecv_rvec(dd, d, dddirBackward,
                              buf,  ind->nsend[nzone+1],
                              rbuf, ind->nrecv[nzone+1]);
             if (!cd->bInPlace)
             {
-                j = 0;
-                for (zone = 0; zone < nzone; zone++)
-                {
-                    for (i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
-                    {
-                        copy_rvec(rbuf[j], x[i]);
-                        j++;
-                    }
-                }
+                dd_move_x_copy_received(ind, nzone, rbuf, x);
             }
             nat_tot += ind->nrecv[nzone+1];
         }
@@ -491,9 +511,72 @@ void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
     }
 }
 
-void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
+void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
 {
-    int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
+    dd_move_x_pulses(dd, box, x, FALSE);
+}
+
+void dd_move_x_start(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    dd_move_x_pulses(dd, box, x, TRUE);
+}
+
+void dd_move_x_finish(gmx_domdec_t *dd, rvec x[])
+{
+    if (dd->ndim == 0)
+    {
+        return;
+    }
+
+    /* Complete the last pulse of the last dimension */
+    int                    d  = dd->ndim - 1;
+    gmx_domdec_comm_dim_t *cd = &dd->comm->cd[d];
+
+    dd_sendrecv_rvec_finish(dd);
+    if (!cd->bInPlace)
+    {
+        dd_move_x_copy_received(&cd->ind[cd->np - 1], 1 << d,
+                                dd->comm->vbuf2.v, x);
+    }
+}
+
+/*! \brief Returns the buffer with the halo forces to send for pulse \p ind, packs them when not communicating in place */
+static rvec *dd_move_f_pack(gmx_domdec_comm_t *comm, const gmx_domdec_comm_dim_t *cd,
+                            const gmx_domdec_ind_t *ind, int nzone, int nat_tot,
+                            rvec f[])
+{
+    rvec *sbuf;
+
+    if (cd->bInPlace)
+    {
+        sbuf = f + nat_tot;
+    }
+    else
+    {
+        sbuf  = comm->vbuf2.v;
+        int j = 0;
+        for (int zone = 0; zone < nzone; zone++)
+        {
+            for (int i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
+            {
+                copy_rvec(f[i], sbuf[j]);
+                j++;
+            }
+        }
+    }
+
+    return sbuf;
+}
+
+/*! \brief Communicates the halo forces and adds them, pulse by pulse
+ *
+ * With \p bFirstPulseStarted the first pulse has been started by
+ * dd_move_f_start() and is only completed here.
+ */
+static void dd_move_f_pulses(gmx_domdec_t *dd, rvec f[], rvec *fshift,
+                             gmx_bool bFirstPulseStarted)
+{
+    int                    nzone, nat_tot, n, d, p, i, j, at0, at1;
     int                   *index, *cgindex;
     gmx_domdec_comm_t     *comm;
     gmx_domdec_comm_dim_t *cd;
@@ -531,27 +614,18 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
         {
             ind      = &cd->ind[p];
             nat_tot -= ind->nrecv[nzone+1];
-            if (cd->bInPlace)
+            /* Communicate the forces */
+            if (bFirstPulseStarted && d == dd->ndim - 1 && p == cd->np - 1)
             {
-                sbuf = f + nat_tot;
+                dd_sendrecv_rvec_finish(dd);
             }
             else
             {
-                sbuf = comm->vbuf2.v;
-                j    = 0;
-                for (zone = 0; zone < nzone; zone++)
-                {
-                    for (i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
-                    {
-                        copy_rvec(f[i], sbuf[j]);
-                        j++;
-                    }
-                }
+                sbuf = dd_move_f_pack(comm, cd, ind, nzone, nat_tot, f);
+                dd_sendrecv_rvec(dd, d, dddirForward,
+                                 sbuf, ind->nrecv[nzone+1],
+                                 buf,  ind->nsend[nzone+1]);
             }
-            /* Communicate the forces */
-            dd_sendrecv_rvec(dd, d, dddirForward,
-                             sbuf, ind->nrecv[nzone+1],
-                             buf,  ind->nsend[nzone+1]);
             index = ind->index;
             /* Add the received forces */
             n = 0;
@@ -612,6 +686,40 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
     }
 }
 
+void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
+{
+    dd_move_f_pulses(dd, f, fshift, FALSE);
+}
+
+void dd_move_f_start(gmx_domdec_t *dd, rvec f[])
+{
+    if (dd->ndim == 0)
+    {
+        return;
+    }
+
+    /* Start the last pulse of the last dimension, which is the first
+     * to be communicated and only involves forces on halo atoms.
+     */
+    gmx_domdec_comm_t     *comm    = dd->comm;
+    int                    d       = dd->ndim - 1;
+    gmx_domdec_comm_dim_t *cd      = &comm->cd[d];
+    gmx_domdec_ind_t      *ind     = &cd->ind[cd->np - 1];
+    int                    nzone   = comm->zones.n/2;
+    int                    nat_tot = dd->nat_tot - ind->nrecv[nzone+1];
+    rvec                  *sbuf;
+
+    sbuf = dd_move_f_pack(comm, cd, ind, nzone, nat_tot, f);
+    dd_sendrecv_rvec_start(dd, d, dddirForward,
+                           sbuf,         ind->nrecv[nzone+1],
+                           comm->vbuf.v, ind->nsend[nzone+1]);
+}
+
+void dd_move_f_finish(gmx_domdec_t *dd, rvec f[], rvec *fshift)
+{
+    dd_move_f_pulses(dd, f, fshift, TRUE);
+}
+
 void dd_atom_spread_real(gmx_domdec_t *dd, real v[])
 {
     int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
@@ -7183,19 +7291,25 @@ static void set_dd_envvar_options(FILE *fplog, gmx_domdec_t *dd, int rank_mysim)
 {
     gmx_domdec_comm_t *comm = dd->comm;
 
-    dd->bSendRecv2      = dd_getenv(fplog, "GMX_DD_USE_SENDRECV2", 0);
-    comm->dlb_scale_lim = dd_getenv(fplog, "GMX_DLB_MAX_BOX_SCALING", 10);
-    comm->eFlop         = dd_getenv(fplog, "GMX_DLB_BASED_ON_FLOPS", 0);
-    int recload         = dd_getenv(fplog, "GMX_DD_RECORD_LOAD", 1);
-    comm->nstDDDump     = dd_getenv(fplog, "GMX_DD_NST_DUMP", 0);
-    comm->nstDDDumpGrid = dd_getenv(fplog, "GMX_DD_NST_DUMP_GRID", 0);
-    comm->DD_debug      = dd_getenv(fplog, "GMX_DD_DEBUG", 0);
+    dd->bSendRecv2       = dd_getenv(fplog, "GMX_DD_USE_SENDRECV2", 0);
+    dd->bOverlapHaloComm = dd_getenv(fplog, "GMX_DD_OVERLAP_HALO", 0);
+    comm->dlb_scale_lim  = dd_getenv(fplog, "GMX_DLB_MAX_BOX_SCALING", 10);
+    comm->eFlop          = dd_getenv(fplog, "GMX_DLB_BASED_ON_FLOPS", 0);
+    int recload          = dd_getenv(fplog, "GMX_DD_RECORD_LOAD", 1);
+    comm->nstDDDump      = dd_getenv(fplog, "GMX_DD_NST_DUMP", 0);
+    comm->nstDDDumpGrid  = dd_getenv(fplog, "GMX_DD_NST_DUMP_GRID", 0);
+    comm->DD_debug       = dd_getenv(fplog, "GMX_DD_DEBUG", 0);
 
     if (dd->bSendRecv2 && fplog)
     {
         fprintf(fplog, "Will use two sequential MPI_Sendrecv calls instead of two simultaneous non-blocking MPI_Irecv and MPI_Isend pairs for constraint and vsite communication\n");
     }
 
+    if (dd->bOverlapHaloComm && fplog)
+    {
+        fprintf(fplog, "Will overlap the halo coordinate and force communication with the non-bonded and long-range force computation\n");
+    }
+
     if (comm->eFlop)
     {
         if (fplog)
@@ -7258,6 +7372,8 @@ gmx_domdec_t *init_domain_decomposition(FILE *fplog, t_commrec *cr,
         set_ddgrid_parameters(fplog, dd, dlb_scale, mtop, ir, ddbox);
 
         setup_neighbor_relations(dd);
+
+        dd_shm_halo_init(fplog, dd);
     }
 
     /* Set overallocation to avoid frequent reallocation of arrays */
@@ -7965,6 +8081,28 @@ get_zone_pulse_cgs(gmx_domdec_t *dd,
     *nsend_z_ptr = nsend_z;
 }
 
+/*! \brief Returns the maximum number of atoms sent or received in a single coordinate or force halo pulse */
+static int max_halo_rvec_count(const gmx_domdec_t *dd)
+{
+    const gmx_domdec_comm_t *comm = dd->comm;
+    int                      nzone, nmax;
+
+    nmax  = 0;
+    nzone = 1;
+    for (int d = 0; d < dd->ndim; d++)
+    {
+        const gmx_domdec_comm_dim_t *cd = &comm->cd[d];
+        for (int p = 0; p < cd->np; p++)
+        {
+            nmax = std::max(nmax, cd->ind[p].nsend[nzone+1]);
+            nmax = std::max(nmax, cd->ind[p].nrecv[nzone+1]);
+        }
+        nzone += nzone;
+    }
+
+    return nmax;
+}
+
 static void setup_dd_communication(gmx_domdec_t *dd,
                                    matrix box, gmx_ddbox_t *ddbox,
                                    t_forcerec *fr,
@@ -9622,6 +9760,9 @@ void dd_partition_system(FILE                *fplog,
     /* Setup up the communication and communicate the coordinates */
     setup_dd_communication(dd, state_local->box, &ddbox, fr, state_local, f);
 
+    /* Make sure the coordinate and force halos fit in shared memory */
+    dd_shm_halo_reserve(dd, max_halo_rvec_count(dd));
+
     /* Set the indices */
     make_dd_indices(dd, cgs_gl->index, ncgindex_set);
 
@@ -240,6 +240,18 @@ float dd_pme_f_ratio(struct gmx_domdec_t *dd);
 /*! \brief Communicate the coordinates to the neighboring cells and do pbc. */
 void dd_move_x(struct gmx_domdec_t *dd, matrix box, rvec x[]);
 
+/*! \brief Start communicating the coordinates to the neighboring cells.
+ *
+ * Does the same as dd_move_x(), but the last communication pulse is
+ * only posted, so it can overlap with computation on the home atoms.
+ * The halo coordinates of that pulse are only valid after calling
+ * dd_move_x_finish(), no other DD communication should happen in between.
+ */
+void dd_move_x_start(struct gmx_domdec_t *dd, matrix box, rvec x[]);
+
+/*! \brief Completes the coordinate communication started with dd_move_x_start(). */
+void dd_move_x_finish(struct gmx_domdec_t *dd, rvec x[]);
+
 /*! \brief Sum the forces over the neighboring cells.
  *
  * When fshift!=NULL the shift forces are updated to obtain
@@ -247,6 +259,21 @@ void dd_move_x(struct gmx_domdec_t *dd, matrix box, rvec x[]);
  */
 void dd_move_f(struct gmx_domdec_t *dd, rvec f[], rvec *fshift);
 
+/*! \brief Start sending the forces on the halo atoms to the neighboring cells.
+ *
+ * Posts the first communication pulse of dd_move_f(). Can be called as
+ * soon as all forces on halo atoms have been computed. The forces
+ * on home atoms can still be computed until dd_move_f_finish() is called,
+ * no other DD communication should happen in between.
+ */
+void dd_move_f_start(struct gmx_domdec_t *dd, rvec f[]);
+
+/*! \brief Completes the force communication started with dd_move_f_start().
+ *
+ * Has the same effect as dd_move_f() together with dd_move_f_start().
+ */
+void dd_move_f_finish(struct gmx_domdec_t *dd, rvec f[], rvec *fshift);
+
 /*! \brief Communicate a real for each atom to the neighboring cells. */
 void dd_atom_spread_real(struct gmx_domdec_t *dd, real v[]);
 
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2008,2009,2010,2012,2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2008,2009,2010,2012,2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -48,15 +48,157 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#include <thread>
+
+#include "thread_mpi/atomic.h"
+
 #include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/gmxmpi.h"
+#include "gromacs/utility/smalloc.h"
 
 
 /*! \brief Returns the MPI rank of the domain decomposition master rank */
 #define DDMASTERRANK(dd)   (dd->masterrank)
 
+/*! \brief Whether halo exchange through MPI-3 shared-memory windows is supported
+ *
+ * With thread-MPI all ranks share one address space and messages are
+ * already copied directly, so this only applies to library MPI.
+ */
+#if GMX_LIB_MPI && defined MPI_VERSION && MPI_VERSION >= 3
+#define GMX_DD_SHM_HALO 1
+#else
+#define GMX_DD_SHM_HALO 0
+#endif
+
+#if GMX_DD_SHM_HALO
+
+/*! \brief Header of a shared-memory halo message slot
+ *
+ * The sender increments \p produced after writing a message behind
+ * the header, the receiver increments \p consumed after reading it.
+ * The counters are on separate cache lines to avoid false sharing.
+ */
+struct ShmHaloSlotHeader
+{
+    tMPI_Atomic_t produced;
+    char          pad0[64];
+    tMPI_Atomic_t consumed;
+    char          pad1[64];
+};
+
+/*! \brief Shared-memory halo exchange setup
+ *
+ * Each rank owns two message slots per decomposition dimension, one for
+ * each neighbor it sends to, in a window shared by the PP ranks of the node.
+ */
+struct gmx_domdec_shm_halo_t
+{
+    MPI_Comm comm_node;               /**< The PP ranks sharing memory with us */
+    int      nrank_node;              /**< The number of ranks in comm_node */
+    gmx_bool bNeighborOnNode[DIM][2]; /**< Whether a neighbor is in comm_node */
+    int      neighborNodeRank[DIM][2];/**< Rank of neighbors in comm_node */
+    MPI_Win  win;                     /**< The shared-memory window */
+    rvec    *pendingRecvBuf;          /**< Receive buffer of a started exchange */
+    int      pendingRecvN;            /**< Size of the pending receive, 0 when none */
+    int      pendingRecvDimInd;       /**< Dim. index of the pending receive */
+    int      pendingRecvNeighbor;     /**< Neighbor index of the pending receive */
+    int      nrvec;                   /**< Slot capacity, equal on all ranks of the node */
+    char    *localBase;               /**< Our own slots */
+    char    *neighborBase[DIM][2];    /**< The slots of the neighbors */
+};
+
+/*! \brief The number of polls of a slot counter before a waiting rank yields
+ *
+ * Neighbors usually arrive within microseconds, so waiting ranks spin
+ * first. When they do not, e.g. because the node is oversubscribed or
+ * a neighbor is imbalanced, we yield the core to not starve other
+ * ranks or threads that share it.
+ */
+static const int c_shmHaloSpinCount = 1000;
+
+/*! \brief Called once for each poll of a slot counter, yields after \p c_shmHaloSpinCount polls */
+static void shmHaloBackoff(int *numPolls)
+{
+    if (*numPolls < c_shmHaloSpinCount)
+    {
+        (*numPolls)++;
+    }
+    else
+    {
+        std::this_thread::yield();
+    }
+}
+
+/*! \brief Returns the size in bytes of one slot */
+static size_t shmHaloSlotSize(int nrvec)
+{
+    return sizeof(ShmHaloSlotHeader) + ((nrvec*sizeof(rvec) + 63)/64)*64;
+}
+
+/*! \brief Returns whether we can send \p n rvecs to neighbor \p i along dim. index \p ddimind through shared memory
+ *
+ * Note that the receiver makes the same decision, since the number of
+ * rvecs matches on both ends and the slot capacity is equal on the node.
+ */
+static gmx_bool shmHaloUse(const gmx_domdec_t *dd, int ddimind, int i, int n)
+{
+    const gmx_domdec_shm_halo_t *shm = dd->shmHalo;
+
+    return (shm != nullptr && shm->bNeighborOnNode[ddimind][i] &&
+            n > 0 && n <= shm->nrvec);
+}
+
+/*! \brief Copies \p n rvecs to our slot for neighbor \p i along dim. index \p ddimind */
+static void shmHaloSend(const gmx_domdec_t *dd, int ddimind, int i,
+                        const rvec *buf, int n)
+{
+    const gmx_domdec_shm_halo_t *shm = dd->shmHalo;
+    ShmHaloSlotHeader           *hdr;
+    int                          nsent;
+    int                          numPolls = 0;
+
+    hdr   = reinterpret_cast<ShmHaloSlotHeader *>(shm->localBase + (ddimind*2 + i)*shmHaloSlotSize(shm->nrvec));
+    nsent = tMPI_Atomic_get(&hdr->produced);
+    /* Wait until the receiver has read our previous message */
+    while (tMPI_Atomic_get(reinterpret_cast<volatile tMPI_Atomic_t *>(&hdr->consumed)) != nsent)
+    {
+        shmHaloBackoff(&numPolls);
+    }
+    tMPI_Atomic_memory_barrier();
+    memcpy(hdr + 1, buf, n*sizeof(rvec));
+    tMPI_Atomic_memory_barrier();
+    tMPI_Atomic_set(&hdr->produced, nsent + 1);
+}
+
+/*! \brief Copies \p n rvecs from the slot of neighbor \p j along dim. index \p ddimind */
+static void shmHaloRecv(const gmx_domdec_t *dd, int ddimind, int j,
+                        rvec *buf, int n)
+{
+    const gmx_domdec_shm_halo_t *shm = dd->shmHalo;
+    ShmHaloSlotHeader           *hdr;
+    int                          nread;
+    int                          numPolls = 0;
+
+    /* We are the neighbor in the opposite direction of our neighbor j */
+    hdr   = reinterpret_cast<ShmHaloSlotHeader *>(shm->neighborBase[ddimind][j] + (ddimind*2 + 1 - j)*shmHaloSlotSize(shm->nrvec));
+    nread = tMPI_Atomic_get(&hdr->consumed);
+    while (tMPI_Atomic_get(reinterpret_cast<volatile tMPI_Atomic_t *>(&hdr->produced)) == nread)
+    {
+        shmHaloBackoff(&numPolls);
+    }
+    tMPI_Atomic_memory_barrier();
+    memcpy(buf, hdr + 1, n*sizeof(rvec));
+    tMPI_Atomic_memory_barrier();
+    tMPI_Atomic_set(&hdr->consumed, nread + 1);
+}
+
+#endif /* GMX_DD_SHM_HALO */
+
 
 void dd_sendrecv_int(const struct gmx_domdec_t gmx_unused *dd,
                      int gmx_unused ddimind, int gmx_unused direction,
@@ -134,6 +276,25 @@ void dd_sendrecv_rvec(const struct gmx_domdec_t gmx_unused *dd,
     rank_s = dd->neighbor[ddimind][direction == dddirForward ? 0 : 1];
     rank_r = dd->neighbor[ddimind][direction == dddirForward ? 1 : 0];
 
+#if GMX_DD_SHM_HALO
+    /* Transfers within the node go through shared memory,
+     * the remaining transfers use MPI as usual.
+     */
+    int      i_s      = (direction == dddirForward ? 0 : 1);
+    int      i_r      = 1 - i_s;
+    gmx_bool bShmRecv = shmHaloUse(dd, ddimind, i_r, n_r);
+    int      n_r_shm  = n_r;
+    if (shmHaloUse(dd, ddimind, i_s, n_s))
+    {
+        shmHaloSend(dd, ddimind, i_s, buf_s, n_s);
+        n_s = 0;
+    }
+    if (bShmRecv)
+    {
+        n_r = 0;
+    }
+#endif
+
     if (n_s && n_r)
     {
         MPI_Sendrecv(buf_s[0], n_s*sizeof(rvec), MPI_BYTE, rank_s, 0,
@@ -151,6 +312,78 @@ void dd_sendrecv_rvec(const struct gmx_domdec_t gmx_unused *dd,
                      dd->mpi_comm_all, &stat);
     }
 
+#if GMX_DD_SHM_HALO
+    if (bShmRecv)
+    {
+        shmHaloRecv(dd, ddimind, i_r, buf_r, n_r_shm);
+    }
+#endif
+#endif
+}
+
+void dd_sendrecv_rvec_start(struct gmx_domdec_t gmx_unused *dd,
+                            int gmx_unused ddimind, int gmx_unused direction,
+                            rvec gmx_unused *buf_s, int gmx_unused n_s,
+                            rvec gmx_unused *buf_r, int gmx_unused n_r)
+{
+#if GMX_MPI
+    int rank_s, rank_r;
+
+    GMX_ASSERT(dd->nreq_halo == 0, "Only one non-blocking halo exchange can be in flight");
+
+    rank_s = dd->neighbor[ddimind][direction == dddirForward ? 0 : 1];
+    rank_r = dd->neighbor[ddimind][direction == dddirForward ? 1 : 0];
+
+#if GMX_DD_SHM_HALO
+    int i_s = (direction == dddirForward ? 0 : 1);
+    int i_r = 1 - i_s;
+    if (shmHaloUse(dd, ddimind, i_s, n_s))
+    {
+        shmHaloSend(dd, ddimind, i_s, buf_s, n_s);
+        n_s = 0;
+    }
+    if (shmHaloUse(dd, ddimind, i_r, n_r))
+    {
+        /* The shared-memory receive is done in dd_sendrecv_rvec_finish */
+        dd->shmHalo->pendingRecvBuf      = buf_r;
+        dd->shmHalo->pendingRecvN        = n_r;
+        dd->shmHalo->pendingRecvDimInd   = ddimind;
+        dd->shmHalo->pendingRecvNeighbor = i_r;
+        n_r                              = 0;
+    }
+#endif
+
+    if (n_r)
+    {
+        MPI_Irecv(buf_r[0], n_r*sizeof(rvec), MPI_BYTE, rank_r, 0,
+                  dd->mpi_comm_all, &dd->req_halo[dd->nreq_halo++]);
+    }
+    if (n_s)
+    {
+        MPI_Isend(buf_s[0], n_s*sizeof(rvec), MPI_BYTE, rank_s, 0,
+                  dd->mpi_comm_all, &dd->req_halo[dd->nreq_halo++]);
+    }
+#endif
+}
+
+void dd_sendrecv_rvec_finish(struct gmx_domdec_t gmx_unused *dd)
+{
+#if GMX_MPI
+    if (dd->nreq_halo > 0)
+    {
+        MPI_Waitall(dd->nreq_halo, dd->req_halo, MPI_STATUSES_IGNORE);
+        dd->nreq_halo = 0;
+    }
+
+#if GMX_DD_SHM_HALO
+    gmx_domdec_shm_halo_t *shm = dd->shmHalo;
+    if (shm != nullptr && shm->pendingRecvN > 0)
+    {
+        shmHaloRecv(dd, shm->pendingRecvDimInd, shm->pendingRecvNeighbor,
+                    shm->pendingRecvBuf, shm->pendingRecvN);
+        shm->pendingRecvN = 0;
+    }
+#endif
 #endif
 }
 
@@ -169,6 +402,32 @@ void dd_sendrecv2_rvec(const struct gmx_domdec_t gmx_unused *dd,
     rank_fw = dd->neighbor[ddimind][0];
     rank_bw = dd->neighbor[ddimind][1];
 
+#if GMX_DD_SHM_HALO
+    /* We send forward to neighbor 0 and receive forward from neighbor 1 */
+    gmx_bool bShmRecvFw = shmHaloUse(dd, ddimind, 1, n_r_fw);
+    gmx_bool bShmRecvBw = shmHaloUse(dd, ddimind, 0, n_r_bw);
+    int      n_r_fw_shm = n_r_fw;
+    int      n_r_bw_shm = n_r_bw;
+    if (shmHaloUse(dd, ddimind, 0, n_s_fw))
+    {
+        shmHaloSend(dd, ddimind, 0, buf_s_fw, n_s_fw);
+        n_s_fw = 0;
+    }
+    if (shmHaloUse(dd, ddimind, 1, n_s_bw))
+    {
+        shmHaloSend(dd, ddimind, 1, buf_s_bw, n_s_bw);
+        n_s_bw = 0;
+    }
+    if (bShmRecvFw)
+    {
+        n_r_fw = 0;
+    }
+    if (bShmRecvBw)
+    {
+        n_r_bw = 0;
+    }
+#endif
+
     if (!dd->bSendRecv2)
     {
         /* Try to send and receive in two directions simultaneously.
@@ -220,6 +479,150 @@ void dd_sendrecv2_rvec(const struct gmx_domdec_t gmx_unused *dd,
                      buf_r_bw[0], n_r_bw*sizeof(rvec), MPI_BYTE, rank_fw, 0,
                      dd->mpi_comm_all, &stat[0]);
     }
+
+#if GMX_DD_SHM_HALO
+    if (bShmRecvFw)
+    {
+        shmHaloRecv(dd, ddimind, 1, buf_r_fw, n_r_fw_shm);
+    }
+    if (bShmRecvBw)
+    {
+        shmHaloRecv(dd, ddimind, 0, buf_r_bw, n_r_bw_shm);
+    }
+#endif
+#endif
+}
+
+void dd_shm_halo_init(FILE gmx_unused *fplog, gmx_domdec_t gmx_unused *dd)
+{
+#if GMX_DD_SHM_HALO
+    gmx_domdec_shm_halo_t *shm;
+    MPI_Group              group_all, group_node;
+    int                    nneighbor_node;
+
+    dd->shmHalo = nullptr;
+
+    if (getenv("GMX_DD_NO_SHM_HALO") != nullptr)
+    {
+        if (fplog)
+        {
+            fprintf(fplog, "Found env.var. GMX_DD_NO_SHM_HALO, will use MPI for all halo communication\n");
+        }
+        return;
+    }
+
+    snew(shm, 1);
+    MPI_Comm_split_type(dd->mpi_comm_all, MPI_COMM_TYPE_SHARED, dd->rank,
+                        MPI_INFO_NULL, &shm->comm_node);
+    MPI_Comm_size(shm->comm_node, &shm->nrank_node);
+    if (shm->nrank_node == 1)
+    {
+        MPI_Comm_free(&shm->comm_node);
+        sfree(shm);
+        return;
+    }
+
+    MPI_Comm_group(dd->mpi_comm_all, &group_all);
+    MPI_Comm_group(shm->comm_node, &group_node);
+    nneighbor_node = 0;
+    for (int d = 0; d < dd->ndim; d++)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            MPI_Group_translate_ranks(group_all, 1, &dd->neighbor[d][i],
+                                      group_node, &shm->neighborNodeRank[d][i]);
+            shm->bNeighborOnNode[d][i] = (shm->neighborNodeRank[d][i] != MPI_UNDEFINED);
+            if (shm->bNeighborOnNode[d][i])
+            {
+                nneighbor_node++;
+            }
+        }
+    }
+    MPI_Group_free(&group_all);
+    MPI_Group_free(&group_node);
+
+    /* The window is allocated at the first call to dd_shm_halo_reserve */
+    shm->nrvec  = 0;
+    dd->shmHalo = shm;
+
+    if (fplog)
+    {
+        fprintf(fplog, "Using shared memory for halo communication between the %d PP ranks on a node, %d out of %d neighbor directions of the master rank are on its node\n",
+                shm->nrank_node, nneighbor_node, 2*dd->ndim);
+    }
+#endif
+}
+
+void dd_shm_halo_reserve(gmx_domdec_t gmx_unused *dd, int gmx_unused nrvec)
+{
+#if GMX_DD_SHM_HALO
+    gmx_domdec_shm_halo_t *shm = dd->shmHalo;
+    int                    nrvec_node;
+    MPI_Aint               size;
+
+    if (shm == nullptr)
+    {
+        return;
+    }
+
+    /* This also guarantees that all messages in the slots have been read */
+    MPI_Allreduce(&nrvec, &nrvec_node, 1, MPI_INT, MPI_MAX, shm->comm_node);
+    if (nrvec_node <= shm->nrvec)
+    {
+        return;
+    }
+
+    if (shm->nrvec > 0)
+    {
+        MPI_Win_unlock_all(shm->win);
+        MPI_Win_free(&shm->win);
+    }
+    shm->nrvec = over_alloc_dd(nrvec_node);
+
+    size = 2*dd->ndim*shmHaloSlotSize(shm->nrvec);
+    MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, shm->comm_node,
+                            &shm->localBase, &shm->win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, shm->win);
+    memset(shm->localBase, 0, size);
+    for (int d = 0; d < dd->ndim; d++)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            if (shm->bNeighborOnNode[d][i])
+            {
+                MPI_Aint size_neighbor;
+                int      disp_unit;
+
+                MPI_Win_shared_query(shm->win, shm->neighborNodeRank[d][i],
+                                     &size_neighbor, &disp_unit,
+                                     &shm->neighborBase[d][i]);
+            }
+        }
+    }
+    /* Make sure all counters have been cleared before they are used */
+    MPI_Win_sync(shm->win);
+    MPI_Barrier(shm->comm_node);
+#endif
+}
+
+void dd_shm_halo_done(gmx_domdec_t gmx_unused *dd)
+{
+#if GMX_DD_SHM_HALO
+    gmx_domdec_shm_halo_t *shm = dd->shmHalo;
+
+    if (shm == nullptr)
+    {
+        return;
+    }
+
+    if (shm->nrvec > 0)
+    {
+        MPI_Win_unlock_all(shm->win);
+        MPI_Win_free(&shm->win);
+    }
+    MPI_Comm_free(&shm->comm_node);
+    sfree(shm);
+    dd->shmHalo = nullptr;
 #endif
 }
 
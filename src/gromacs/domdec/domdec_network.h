@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2008,2009,2010,2012,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2008,2009,2010,2012,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -48,6 +48,8 @@
 #ifndef GMX_DOMDEC_DOMDEC_NETWORK_H
 #define GMX_DOMDEC_DOMDEC_NETWORK_H
 
+#include <stdio.h>
+
 #include "gromacs/math/vectypes.h"
 
 struct gmx_domdec_t;
@@ -104,6 +106,49 @@ dd_sendrecv2_rvec(const struct gmx_domdec_t *dd,
                   rvec *buf_r_fw, int n_r_fw,
                   rvec *buf_s_bw, int n_s_bw,
                   rvec *buf_r_bw, int n_r_bw);
+/*! \brief Starts moving rvec's in the comm. region one cell along the domain decomposition
+ *
+ * Same as dd_sendrecv_rvec(), but returns after posting the communication.
+ * The buffers should not be accessed until dd_sendrecv_rvec_finish()
+ * has been called. Only one such communication can be in flight.
+ */
+void
+dd_sendrecv_rvec_start(struct gmx_domdec_t *dd,
+                       int ddimind, int direction,
+                       rvec *buf_s, int n_s,
+                       rvec *buf_r, int n_r);
+
+/*! \brief Completes the communication started with dd_sendrecv_rvec_start() */
+void
+dd_sendrecv_rvec_finish(struct gmx_domdec_t *dd);
+
+
+/*! \brief Sets up shared-memory halo communication between PP ranks on the same node
+ *
+ * Requires MPI-3; with thread-MPI or without neighbors on our node,
+ * or when the env.var. GMX_DD_NO_SHM_HALO is set, nothing is done and
+ * all communication uses MPI messages. Collective over all PP ranks,
+ * must be called after the neighbor ranks have been set up.
+ */
+void
+dd_shm_halo_init(FILE *fplog, struct gmx_domdec_t *dd);
+
+/*! \brief Ensures that the shared-memory halo slots can hold \p nrvec rvecs
+ *
+ * Messages that do not fit, as well as messages to ranks on other
+ * nodes, are sent with MPI. Collective over all PP ranks, should be
+ * called after the halo communication setup at each repartitioning.
+ */
+void
+dd_shm_halo_reserve(struct gmx_domdec_t *dd, int nrvec);
+
+/*! \brief Frees the shared-memory window and node communicator for halo communication
+ *
+ * Collective over all PP ranks, does nothing when shared-memory halo
+ * communication is not used.
+ */
+void
+dd_shm_halo_done(struct gmx_domdec_t *dd);
 
 
 /* The functions below perform the same operations as the MPI functions
@@ -61,6 +61,7 @@
 struct gmx_domdec_comm_t;
 struct gmx_domdec_constraints_t;
 struct gmx_domdec_master_t;
+struct gmx_domdec_shm_halo_t;
 struct gmx_domdec_specat_comm_t;
 struct gmx_ga2la_t;
 struct gmx_hash_t;
@@ -125,6 +126,13 @@ struct gmx_domdec_t {
     MPI_Comm               mpi_comm_all;
     /* Use MPI_Sendrecv communication instead of non-blocking calls */
     gmx_bool               bSendRecv2;
+    /* Shared-memory halo exchange with neighbors on our node, can be NULL */
+    gmx_domdec_shm_halo_t *shmHalo;
+    /* Whether to overlap halo communication with force computation */
+    gmx_bool               bOverlapHaloComm;
+    /* Pending non-blocking halo communication */
+    int                    nreq_halo;
+    MPI_Request            req_halo[2];
     /* The local DD cell index and rank */
     ivec                   ci;
     int                    rank;
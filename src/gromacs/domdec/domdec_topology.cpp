@@ -1158,10 +1158,14 @@ static real dd_dist2(t_pbc *pbc_null, rvec *cg_cm, const int *la2lc, int i, int
     return norm2(dx);
 }
 
-/*! \brief Append t_blocka block structures 1 to nsrc in src to *dest */
+/*! \brief Append t_blocka block structures 1 to nsrc in src to *dest
+ *
+ * The sizes are determined first, after which the sources are copied
+ * in parallel, each to its own part of \p dest.
+ */
 static void combine_blocka(t_blocka *dest, const thread_work_t *src, int nsrc)
 {
-    int ni, na, s, i;
+    int ni, na, s;
 
     ni = src[nsrc-1].excl.nr;
     na = 0;
@@ -1179,33 +1183,53 @@ static void combine_blocka(t_blocka *dest, const thread_work_t *src, int nsrc)
         dest->nalloc_a = over_alloc_large(dest->nra+na);
         srenew(dest->a, dest->nalloc_a);
     }
+
+#pragma omp parallel for num_threads(nsrc) schedule(static)
     for (s = 1; s < nsrc; s++)
     {
-        for (i = dest->nr+1; i < src[s].excl.nr+1; i++)
+        /* The index and exclusion start of source s in dest */
+        int nr0  = (s == 1 ? dest->nr : src[s-1].excl.nr);
+        int nra0 = dest->nra;
+        for (int s2 = 1; s2 < s; s2++)
+        {
+            nra0 += src[s2].excl.nra;
+        }
+
+        for (int i = nr0+1; i < src[s].excl.nr+1; i++)
         {
-            dest->index[i] = dest->nra + src[s].excl.index[i];
+            dest->index[i] = nra0 + src[s].excl.index[i];
         }
-        for (i = 0; i < src[s].excl.nra; i++)
+        for (int i = 0; i < src[s].excl.nra; i++)
         {
-            dest->a[dest->nra+i] = src[s].excl.a[i];
+            dest->a[nra0+i] = src[s].excl.a[i];
         }
-        dest->nr   = src[s].excl.nr;
+    }
+
+    dest->nr = ni;
+    for (s = 1; s < nsrc; s++)
+    {
         dest->nra += src[s].excl.nra;
     }
 }
 
 /*! \brief Append t_idef structures 1 to nsrc in src to *dest,
  * virtual sites need special attention, as pbc info differs per vsite.
+ *
+ * All buffers are (re)allocated first, after which each source is
+ * copied to its own part of \p dest in parallel.
  */
 static void combine_idef(t_idef *dest, const thread_work_t *src, int nsrc,
                          gmx_vsite_t *vsite)
 {
     int ftype;
+    int nr_dest[F_NRE];
 
     for (ftype = 0; ftype < F_NRE; ftype++)
     {
         int n, s;
 
+        nr_dest[ftype] = dest->il[ftype].nr;
+
         n = 0;
         for (s = 1; s < nsrc; s++)
         {
@@ -1223,15 +1247,11 @@ static void combine_idef(t_idef *dest, const thread_work_t *src, int nsrc,
                 srenew(ild->iatoms, ild->nalloc);
             }
 
-            gmx_bool vpbc;
-            int      nral1 = 0, ftv = 0;
-
-            vpbc = ((interaction_function[ftype].flags & IF_VSITE) &&
-                    vsite->vsite_pbc_loc != nullptr);
-            if (vpbc)
+            if ((interaction_function[ftype].flags & IF_VSITE) &&
+                vsite->vsite_pbc_loc != nullptr)
             {
-                nral1 = 1 + NRAL(ftype);
-                ftv   = ftype - F_VSITE2;
+                int nral1 = 1 + NRAL(ftype);
+                int ftv   = ftype - F_VSITE2;
                 if ((ild->nr + n)/nral1 > vsite->vsite_pbc_loc_nalloc[ftv])
                 {
                     vsite->vsite_pbc_loc_nalloc[ftv] =
@@ -1241,69 +1261,84 @@ static void combine_idef(t_idef *dest, const thread_work_t *src, int nsrc,
                 }
             }
 
-            for (s = 1; s < nsrc; s++)
+            /* Position restraints need an additional treatment */
+            int nposres = (ild->nr + n)/2;
+            if (ftype == F_POSRES && nposres > dest->iparams_posres_nalloc)
+            {
+                dest->iparams_posres_nalloc = over_alloc_large(nposres);
+                srenew(dest->iparams_posres, dest->iparams_posres_nalloc);
+            }
+            if (ftype == F_FBPOSRES && nposres > dest->iparams_fbposres_nalloc)
             {
-                const t_ilist *ils;
-                int            i;
+                dest->iparams_fbposres_nalloc = over_alloc_large(nposres);
+                srenew(dest->iparams_fbposres, dest->iparams_fbposres_nalloc);
+            }
 
-                ils = &src[s].idef.il[ftype];
-                for (i = 0; i < ils->nr; i++)
+            ild->nr += n;
+        }
+    }
+
+    /* Copy the interactions of each source to dest */
+#pragma omp parallel for num_threads(nsrc) schedule(static)
+    for (int s = 1; s < nsrc; s++)
+    {
+        try
+        {
+            for (int ftype = 0; ftype < F_NRE; ftype++)
+            {
+                const t_ilist *ils = &src[s].idef.il[ftype];
+
+                if (ils->nr == 0)
                 {
-                    ild->iatoms[ild->nr+i] = ils->iatoms[i];
+                    continue;
                 }
-                if (vpbc)
+
+                t_ilist *ild = &dest->il[ftype];
+                int      nr0 = nr_dest[ftype];
+                for (int s2 = 1; s2 < s; s2++)
                 {
-                    for (i = 0; i < ils->nr; i += nral1)
-                    {
-                        vsite->vsite_pbc_loc[ftv][(ild->nr+i)/nral1] =
-                            src[s].vsite_pbc[ftv][i/nral1];
-                    }
+                    nr0 += src[s2].idef.il[ftype].nr;
                 }
 
-                ild->nr += ils->nr;
-            }
-
-            /* Position restraints need an additional treatment */
-            if (ftype == F_POSRES || ftype == F_FBPOSRES)
-            {
-                int nposres = dest->il[ftype].nr/2;
-                if (nposres > dest->iparams_posres_nalloc)
+                for (int i = 0; i < ils->nr; i++)
                 {
-                    dest->iparams_posres_nalloc = over_alloc_large(nposres);
-                    srenew(dest->iparams_posres, dest->iparams_posres_nalloc);
+                    ild->iatoms[nr0+i] = ils->iatoms[i];
                 }
-                /* Set nposres to the number of original position restraints in dest */
-                for (int s = 1; s < nsrc; s++)
+
+                if ((interaction_function[ftype].flags & IF_VSITE) &&
+                    vsite->vsite_pbc_loc != nullptr)
                 {
-                    nposres -= src[s].idef.il[ftype].nr/2;
+                    int nral1 = 1 + NRAL(ftype);
+                    int ftv   = ftype - F_VSITE2;
+                    for (int i = 0; i < ils->nr; i += nral1)
+                    {
+                        vsite->vsite_pbc_loc[ftv][(nr0+i)/nral1] =
+                            src[s].vsite_pbc[ftv][i/nral1];
+                    }
                 }
-                for (int s = 1; s < nsrc; s++)
+
+                if (ftype == F_POSRES || ftype == F_FBPOSRES)
                 {
-                    if (ftype == F_POSRES)
+                    int nposres = nr0/2;
+                    for (int i = 0; i < ils->nr/2; i++)
                     {
-                        for (int i = 0; i < src[s].idef.il[ftype].nr/2; i++)
+                        /* Correct the index into iparams_(fb)posres */
+                        ild->iatoms[nposres*2] = nposres;
+                        /* Copy the position restraint force parameters */
+                        if (ftype == F_POSRES)
                         {
-                            /* Correct the index into iparams_posres */
-                            dest->il[ftype].iatoms[nposres*2] = nposres;
-                            /* Copy the position restraint force parameters */
                             dest->iparams_posres[nposres] = src[s].idef.iparams_posres[i];
-                            nposres++;
                         }
-                    }
-                    else
-                    {
-                        for (int i = 0; i < src[s].idef.il[ftype].nr/2; i++)
+                        else
                         {
-                            /* Correct the index into iparams_fbposres */
-                            dest->il[ftype].iatoms[nposres*2] = nposres;
-                            /* Copy the position restraint force parameters */
                             dest->iparams_fbposres[nposres] = src[s].idef.iparams_fbposres[i];
-                            nposres++;
                         }
+                        nposres++;
                     }
                 }
             }
         }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
 }
 
@@ -325,6 +325,19 @@ typedef struct gmx_pme_t {
     /* Work data for sum_qgrid */
     real *   sum_qgrid_tmp;
     real *   sum_qgrid_dd_tmp;
+
+    /* Non-blocking forward communication of the fftgrid overlap,
+     * which is overlapped with spreading on the next grid.
+     */
+    int         fftgrid_comm_grid_index; /* Grid with communication in flight, -1 if none */
+    int         fftgrid_comm_nreq;       /* The number of outstanding requests */
+    MPI_Request fftgrid_comm_req[2];     /* The send and receive requests */
+
+    /* Copies of the local coefficients for each grid, needed for
+     * gathering when all grids are spread before the first gather.
+     */
+    real *grid_coefficient[DO_Q_AND_LJ];
+    int   grid_coefficient_nalloc;
 } t_gmx_pme_t;
 
 //! @endcond
@@ -61,6 +61,7 @@
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdlib/nb_verlet.h"
 #include "gromacs/mdlib/nbnxn_gpu_data_mgmt.h"
 #include "gromacs/mdlib/sim_util.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -764,6 +765,14 @@ pme_load_balance(pme_load_balancing_t      *pme_lb,
 
     set = &pme_lb->setup[pme_lb->cur];
 
+    if (nbv->bDynamicPruning)
+    {
+        /* Keep the difference between the outer and inner list cut-off
+         * constant, this never decreases the inner list buffers.
+         */
+        nbv->rlistInner += set->rlist - ic->rlist;
+    }
+
     ic->rcoulomb     = set->rcut_coulomb;
     ic->rlist        = set->rlist;
     ic->ewaldcoeff_q = set->ewaldcoeff_q;
@@ -50,6 +50,7 @@
 #include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/smalloc.h"
 
 #include "pme-grid.h"
@@ -697,19 +698,90 @@ reduce_threadgrid_overlap(struct gmx_pme_t *pme,
 }
 
 
+/* Adds the data received along the minor dimension in pulse ipulse
+ * to fftgrid and, with decomposition along both dimensions, to the
+ * send buffer for the major dimension.
+ */
+static void add_fftgrid_recvbuf_minor(struct gmx_pme_t *pme, real *fftgrid,
+                                      int ipulse, int size_yx,
+                                      const ivec local_fft_ndata,
+                                      const ivec local_fft_size)
+{
+    const pme_overlap_t *overlap     = &pme->overlap[1];
+    const int            recv_nindex = overlap->comm_data[ipulse].recv_nindex;
+    const int            recv_size_y = overlap->comm_data[ipulse].recv_size;
+    const real          *recvptr     = overlap->recvbuf;
+    int                  x, y, z, indg, indb;
+
+    for (x = 0; x < local_fft_ndata[XX]; x++)
+    {
+        for (y = 0; y < recv_nindex; y++)
+        {
+            indg = (x*local_fft_size[YY] + y)*local_fft_size[ZZ];
+            indb = (x*recv_size_y        + y)*local_fft_ndata[ZZ];
+            for (z = 0; z < local_fft_ndata[ZZ]; z++)
+            {
+                fftgrid[indg+z] += recvptr[indb+z];
+            }
+        }
+    }
+
+    if (pme->nnodes_major > 1)
+    {
+        /* Copy from the received buffer to the send buffer for dim 0 */
+        real *sendptr = pme->overlap[0].sendbuf;
+        for (x = 0; x < size_yx; x++)
+        {
+            for (y = 0; y < recv_nindex; y++)
+            {
+                indg = (x*local_fft_ndata[YY] + y)*local_fft_ndata[ZZ];
+                indb = ((local_fft_ndata[XX] + x)*recv_size_y + y)*local_fft_ndata[ZZ];
+                for (z = 0; z < local_fft_ndata[ZZ]; z++)
+                {
+                    sendptr[indg+z] += recvptr[indb+z];
+                }
+            }
+        }
+    }
+}
+
+/* Adds the data received along the major dimension to fftgrid */
+static void add_fftgrid_recvbuf_major(struct gmx_pme_t *pme, real *fftgrid,
+                                      const ivec local_fft_ndata,
+                                      const ivec local_fft_size)
+{
+    const pme_overlap_t *overlap     = &pme->overlap[0];
+    const int            recv_nindex = overlap->comm_data[0].recv_nindex;
+    const real          *recvptr     = overlap->recvbuf;
+    int                  x, y, z, indg, indb;
+
+    for (x = 0; x < recv_nindex; x++)
+    {
+        for (y = 0; y < local_fft_ndata[YY]; y++)
+        {
+            indg = (x*local_fft_size[YY]  + y)*local_fft_size[ZZ];
+            indb = (x*local_fft_ndata[YY] + y)*local_fft_ndata[ZZ];
+            for (z = 0; z < local_fft_ndata[ZZ]; z++)
+            {
+                fftgrid[indg+z] += recvptr[indb+z];
+            }
+        }
+    }
+}
+
 static void sum_fftgrid_dd(struct gmx_pme_t *pme, real *fftgrid, int grid_index)
 {
     ivec local_fft_ndata, local_fft_offset, local_fft_size;
     pme_overlap_t *overlap;
-    int  send_index0, send_nindex;
+    int  send_nindex;
     int  recv_nindex;
 #if GMX_MPI
     MPI_Status stat;
-#endif
+    int  send_index0;
     int  recv_size_y;
-    int  ipulse, size_yx;
     real *sendptr, *recvptr;
-    int  x, y, z, indg, indb;
+#endif
+    int  ipulse, size_yx;
 
     /* Note that this routine is only used for forward communication.
      * Since the force gathering, unlike the coefficient spreading,
@@ -744,16 +816,7 @@ static void sum_fftgrid_dd(struct gmx_pme_t *pme, real *fftgrid, int grid_index)
 
         for (ipulse = 0; ipulse < overlap->noverlap_nodes; ipulse++)
         {
-            send_index0   =
-                overlap->comm_data[ipulse].send_index0 -
-                overlap->comm_data[0].send_index0;
             send_nindex   = overlap->comm_data[ipulse].send_nindex;
-            /* We don't use recv_index0, as we always receive starting at 0 */
-            recv_nindex   = overlap->comm_data[ipulse].recv_nindex;
-            recv_size_y   = overlap->comm_data[ipulse].recv_size;
-
-            sendptr = overlap->sendbuf + send_index0*local_fft_ndata[ZZ];
-            recvptr = overlap->recvbuf;
 
             if (debug != nullptr)
             {
@@ -762,6 +825,15 @@ static void sum_fftgrid_dd(struct gmx_pme_t *pme, real *fftgrid, int grid_index)
             }
 
 #if GMX_MPI
+            send_index0   =
+                overlap->comm_data[ipulse].send_index0 -
+                overlap->comm_data[0].send_index0;
+            /* We don't use recv_index0, as we always receive starting at 0 */
+            recv_size_y   = overlap->comm_data[ipulse].recv_size;
+
+            sendptr = overlap->sendbuf + send_index0*local_fft_ndata[ZZ];
+            recvptr = overlap->recvbuf;
+
             int send_id = overlap->send_id[ipulse];
             int recv_id = overlap->recv_id[ipulse];
             MPI_Sendrecv(sendptr, send_size_y*datasize, GMX_MPI_REAL,
@@ -771,36 +843,8 @@ static void sum_fftgrid_dd(struct gmx_pme_t *pme, real *fftgrid, int grid_index)
                          overlap->mpi_comm, &stat);
 #endif
 
-            for (x = 0; x < local_fft_ndata[XX]; x++)
-            {
-                for (y = 0; y < recv_nindex; y++)
-                {
-                    indg = (x*local_fft_size[YY] + y)*local_fft_size[ZZ];
-                    indb = (x*recv_size_y        + y)*local_fft_ndata[ZZ];
-                    for (z = 0; z < local_fft_ndata[ZZ]; z++)
-                    {
-                        fftgrid[indg+z] += recvptr[indb+z];
-                    }
-                }
-            }
-
-            if (pme->nnodes_major > 1)
-            {
-                /* Copy from the received buffer to the send buffer for dim 0 */
-                sendptr = pme->overlap[0].sendbuf;
-                for (x = 0; x < size_yx; x++)
-                {
-                    for (y = 0; y < recv_nindex; y++)
-                    {
-                        indg = (x*local_fft_ndata[YY] + y)*local_fft_ndata[ZZ];
-                        indb = ((local_fft_ndata[XX] + x)*recv_size_y + y)*local_fft_ndata[ZZ];
-                        for (z = 0; z < local_fft_ndata[ZZ]; z++)
-                        {
-                            sendptr[indg+z] += recvptr[indb+z];
-                        }
-                    }
-                }
-            }
+            add_fftgrid_recvbuf_minor(pme, fftgrid, ipulse, size_yx,
+                                      local_fft_ndata, local_fft_size);
         }
     }
 
@@ -819,8 +863,6 @@ static void sum_fftgrid_dd(struct gmx_pme_t *pme, real *fftgrid, int grid_index)
         /* We don't use recv_index0, as we always receive starting at 0 */
         recv_nindex   = overlap->comm_data[ipulse].recv_nindex;
 
-        recvptr = overlap->recvbuf;
-
         if (debug != nullptr)
         {
             fprintf(debug, "PME fftgrid comm x %2d x %2d x %2d\n",
@@ -832,6 +874,7 @@ static void sum_fftgrid_dd(struct gmx_pme_t *pme, real *fftgrid, int grid_index)
         int send_id  = overlap->send_id[ipulse];
         int recv_id  = overlap->recv_id[ipulse];
         sendptr      = overlap->sendbuf;
+        recvptr      = overlap->recvbuf;
         MPI_Sendrecv(sendptr, send_nindex*datasize, GMX_MPI_REAL,
                      send_id, ipulse,
                      recvptr, recv_nindex*datasize, GMX_MPI_REAL,
@@ -839,25 +882,104 @@ static void sum_fftgrid_dd(struct gmx_pme_t *pme, real *fftgrid, int grid_index)
                      overlap->mpi_comm, &stat);
 #endif
 
-        for (x = 0; x < recv_nindex; x++)
-        {
-            for (y = 0; y < local_fft_ndata[YY]; y++)
-            {
-                indg = (x*local_fft_size[YY]  + y)*local_fft_size[ZZ];
-                indb = (x*local_fft_ndata[YY] + y)*local_fft_ndata[ZZ];
-                for (z = 0; z < local_fft_ndata[ZZ]; z++)
-                {
-                    fftgrid[indg+z] += recvptr[indb+z];
-                }
-            }
-        }
+        add_fftgrid_recvbuf_major(pme, fftgrid, local_fft_ndata, local_fft_size);
+    }
+}
+
+/* Returns whether the forward fftgrid overlap communication consists
+ * of a single send/receive pair, so it can be done non-blocking.
+ * With decomposition along both dimensions, the major dimension
+ * communication depends on the minor one, which we do not pipeline.
+ */
+static bool sum_fftgrid_dd_is_single_pulse(const struct gmx_pme_t *pme)
+{
+    return ((pme->nnodes_major > 1 && pme->nnodes_minor == 1) ||
+            (pme->nnodes_major == 1 && pme->nnodes_minor > 1 &&
+             pme->overlap[1].noverlap_nodes == 1));
+}
+
+/* Posts the non-blocking send and receive for the single pulse
+ * forward fftgrid overlap communication of grid grid_index.
+ * The communication is completed by spread_on_grid_finish_comm.
+ */
+static void sum_fftgrid_dd_start(struct gmx_pme_t *pme, int grid_index)
+{
+    GMX_ASSERT(pme->fftgrid_comm_grid_index < 0, "Only one fftgrid communication can be in flight");
+
+#if GMX_MPI
+    ivec           local_fft_ndata, local_fft_offset, local_fft_size;
+    pme_overlap_t *overlap;
+    int            send_count, recv_count;
+
+    gmx_parallel_3dfft_real_limits(pme->pfft_setup[grid_index],
+                                   local_fft_ndata,
+                                   local_fft_offset,
+                                   local_fft_size);
+
+    if (pme->nnodes_minor > 1)
+    {
+        overlap    = &pme->overlap[1];
+        send_count = overlap->send_size*local_fft_ndata[XX]*local_fft_ndata[ZZ];
+        recv_count = overlap->comm_data[0].recv_size*local_fft_ndata[XX]*local_fft_ndata[ZZ];
+    }
+    else
+    {
+        overlap    = &pme->overlap[0];
+        send_count = overlap->comm_data[0].send_nindex*local_fft_ndata[YY]*local_fft_ndata[ZZ];
+        recv_count = overlap->comm_data[0].recv_nindex*local_fft_ndata[YY]*local_fft_ndata[ZZ];
+    }
+
+    MPI_Irecv(overlap->recvbuf, recv_count, GMX_MPI_REAL,
+              overlap->recv_id[0], 0,
+              overlap->mpi_comm, &pme->fftgrid_comm_req[0]);
+    MPI_Isend(overlap->sendbuf, send_count, GMX_MPI_REAL,
+              overlap->send_id[0], 0,
+              overlap->mpi_comm, &pme->fftgrid_comm_req[1]);
+    pme->fftgrid_comm_nreq = 2;
+#endif
+
+    pme->fftgrid_comm_grid_index = grid_index;
+}
+
+void spread_on_grid_finish_comm(struct gmx_pme_t *pme)
+{
+    const int grid_index = pme->fftgrid_comm_grid_index;
+
+    if (grid_index < 0)
+    {
+        return;
+    }
+
+#if GMX_MPI
+    MPI_Waitall(pme->fftgrid_comm_nreq, pme->fftgrid_comm_req, MPI_STATUSES_IGNORE);
+#endif
+    pme->fftgrid_comm_nreq       = 0;
+    pme->fftgrid_comm_grid_index = -1;
+
+    ivec local_fft_ndata, local_fft_offset, local_fft_size;
+
+    gmx_parallel_3dfft_real_limits(pme->pfft_setup[grid_index],
+                                   local_fft_ndata,
+                                   local_fft_offset,
+                                   local_fft_size);
+
+    if (pme->nnodes_minor > 1)
+    {
+        add_fftgrid_recvbuf_minor(pme, pme->fftgrid[grid_index], 0, 0,
+                                  local_fft_ndata, local_fft_size);
+    }
+    else
+    {
+        add_fftgrid_recvbuf_major(pme, pme->fftgrid[grid_index],
+                                  local_fft_ndata, local_fft_size);
     }
 }
 
 void spread_on_grid(struct gmx_pme_t *pme,
                     pme_atomcomm_t *atc, pmegrids_t *grids,
                     gmx_bool bCalcSplines, gmx_bool bSpread,
-                    real *fftgrid, gmx_bool bDoSplines, int grid_index)
+                    real *fftgrid, gmx_bool bDoSplines, int grid_index,
+                    gmx_bool bOverlapComm)
 {
     int nthread, thread;
 #ifdef PME_TIME_THREADS
@@ -975,6 +1097,11 @@ void spread_on_grid(struct gmx_pme_t *pme,
 #ifdef PME_TIME_THREADS
         c3 = omp_cyc_start();
 #endif
+        /* The reduction writes to the communication send buffers,
+         * so the communication for the previous grid should be done.
+         */
+        spread_on_grid_finish_comm(pme);
+
 #pragma omp parallel for num_threads(grids->nthread) schedule(static)
         for (thread = 0; thread < grids->nthread; thread++)
         {
@@ -998,8 +1125,17 @@ void spread_on_grid(struct gmx_pme_t *pme,
             /* Communicate the overlapping part of the fftgrid.
              * For this communication call we need to check pme->bUseThreads
              * to have all ranks communicate here, regardless of pme->nthread.
+             * When requested, we only post the communication here, so it
+             * can overlap with the spreading on the next grid.
              */
-            sum_fftgrid_dd(pme, fftgrid, grid_index);
+            if (bOverlapComm && sum_fftgrid_dd_is_single_pulse(pme))
+            {
+                sum_fftgrid_dd_start(pme, grid_index);
+            }
+            else
+            {
+                sum_fftgrid_dd(pme, fftgrid, grid_index);
+            }
         }
     }
 
@@ -41,10 +41,22 @@
 
 #include "pme-internal.h"
 
+/*! \brief Spreads the coefficients in atc on grids and sums them into fftgrid
+ *
+ * With bOverlapComm, the communication of the fftgrid overlap with
+ * other PME ranks is, when possible, only posted. It is completed by
+ * the next call to spread_on_grid or by spread_on_grid_finish_comm,
+ * which needs to be called before fftgrid is used.
+ */
 void
 spread_on_grid(struct gmx_pme_t *pme,
                pme_atomcomm_t *atc, pmegrids_t *grids,
                gmx_bool bCalcSplines, gmx_bool bSpread,
-               real *fftgrid, gmx_bool bDoSplines, int grid_index);
+               real *fftgrid, gmx_bool bDoSplines, int grid_index,
+               gmx_bool bOverlapComm);
+
+/*! \brief Completes the fftgrid overlap communication left in flight by spread_on_grid, if any */
+void
+spread_on_grid_finish_comm(struct gmx_pme_t *pme);
 
 #endif
@@ -818,6 +818,14 @@ int gmx_pme_init(struct gmx_pme_t **pmedata,
     pme->lb_buf2       = nullptr;
     pme->lb_buf_nalloc = 0;
 
+    pme->fftgrid_comm_grid_index = -1;
+    pme->fftgrid_comm_nreq       = 0;
+    for (int i = 0; i < DO_Q_AND_LJ; i++)
+    {
+        pme->grid_coefficient[i] = nullptr;
+    }
+    pme->grid_coefficient_nalloc = 0;
+
     pme_init_all_work(&pme->solve_work, pme->nthread, pme->nkx);
 
     *pmedata = pme;
@@ -896,7 +904,7 @@ void gmx_pme_calc_energy(struct gmx_pme_t *pme, int n, rvec *x, real *q, real *V
     grid = &pme->pmegrid[PME_GRID_QA];
 
     /* Only calculate the spline coefficients, don't actually spread */
-    spread_on_grid(pme, atc, nullptr, TRUE, FALSE, pme->fftgrid[PME_GRID_QA], FALSE, PME_GRID_QA);
+    spread_on_grid(pme, atc, nullptr, TRUE, FALSE, pme->fftgrid[PME_GRID_QA], FALSE, PME_GRID_QA, FALSE);
 
     *V = gather_energy_bsplines(pme, grid->grid.grid, atc);
 }
@@ -1020,6 +1028,16 @@ int gmx_pme_do(struct gmx_pme_t *pme,
     /* If we are doing LJ-PME with LB, we only do Q here */
     max_grid_index = (pme->ljpme_combination_rule == eljpmeLB) ? DO_Q : DO_Q_AND_LJ;
 
+    /* We process the grids as a pipeline: first we spread the coefficients
+     * on all grids, then we do the FFTs, solve and gather for each grid
+     * in turn. The fftgrid overlap communication with other PME ranks
+     * for one grid then proceeds while we spread on the next grid,
+     * e.g. the Coulomb and LJ-PME grids overlap, and the communication
+     * for the last grid proceeds during the FFTs of the other grids.
+     */
+    int   grid_indices[DO_Q_AND_LJ];
+    real *coefficient_ptr[DO_Q_AND_LJ];
+    int   ngrid = 0;
     for (grid_index = 0; grid_index < max_grid_index; ++grid_index)
     {
         /* Check if we should do calculations at this grid_index
@@ -1034,11 +1052,20 @@ int gmx_pme_do(struct gmx_pme_t *pme,
         {
             continue;
         }
+        grid_indices[ngrid++] = grid_index;
+    }
+    /* With multiple ranks the redistributed coefficients are overwritten
+     * by those of the next grid, but we need them again for gathering.
+     */
+    const gmx_bool bStoreCoefficients = (pme->nnodes > 1 && ngrid > 1 && bCalcF);
+
+    for (int g = 0; g < ngrid; g++)
+    {
+        grid_index = grid_indices[g];
+
         /* Unpack structure */
         pmegrid    = &pme->pmegrid[grid_index];
         fftgrid    = pme->fftgrid[grid_index];
-        cfftgrid   = pme->cfftgrid[grid_index];
-        pfft_setup = pme->pfft_setup[grid_index];
         switch (grid_index)
         {
             case 0: coefficient = chargeA + start; break;
@@ -1046,6 +1073,7 @@ int gmx_pme_do(struct gmx_pme_t *pme,
             case 2: coefficient = c6A + start; break;
             case 3: coefficient = c6B + start; break;
         }
+        coefficient_ptr[grid_index] = coefficient;
 
         grid = pmegrid->grid.grid;
 
@@ -1071,6 +1099,20 @@ int gmx_pme_do(struct gmx_pme_t *pme,
             do_redist_pos_coeffs(pme, cr, start, homenr, bFirst, x, coefficient);
             where();
 
+            if (bStoreCoefficients)
+            {
+                if (atc->n > pme->grid_coefficient_nalloc)
+                {
+                    pme->grid_coefficient_nalloc = atc->nalloc;
+                    for (i = 0; i < DO_Q_AND_LJ; i++)
+                    {
+                        srenew(pme->grid_coefficient[i], pme->grid_coefficient_nalloc);
+                    }
+                }
+                std::copy(atc->coefficient, atc->coefficient + atc->n,
+                          pme->grid_coefficient[grid_index]);
+            }
+
             wallcycle_stop(wcycle, ewcPME_REDISTXF);
         }
 
@@ -1085,7 +1127,7 @@ int gmx_pme_do(struct gmx_pme_t *pme,
             wallcycle_start(wcycle, ewcPME_SPREADGATHER);
 
             /* Spread the coefficients on a grid */
-            spread_on_grid(pme, &pme->atc[0], pmegrid, bFirst, TRUE, fftgrid, bDoSplines, grid_index);
+            spread_on_grid(pme, &pme->atc[0], pmegrid, bFirst, TRUE, fftgrid, bDoSplines, grid_index, TRUE);
 
             if (bFirst)
             {
@@ -1122,6 +1164,27 @@ int gmx_pme_do(struct gmx_pme_t *pme,
                exit(0);
              */
         }
+        bFirst = FALSE;
+    }
+
+    for (int g = 0; g < ngrid; g++)
+    {
+        grid_index = grid_indices[g];
+
+        /* Unpack structure */
+        pmegrid    = &pme->pmegrid[grid_index];
+        fftgrid    = pme->fftgrid[grid_index];
+        cfftgrid   = pme->cfftgrid[grid_index];
+        pfft_setup = pme->pfft_setup[grid_index];
+        grid       = pmegrid->grid.grid;
+
+        if (pme->fftgrid_comm_grid_index == grid_index)
+        {
+            /* Complete the summation of this grid over the PME ranks */
+            wallcycle_start(wcycle, ewcPME_SPREADGATHER);
+            spread_on_grid_finish_comm(pme);
+            wallcycle_stop(wcycle, ewcPME_SPREADGATHER);
+        }
 
         /* Here we start a large thread parallel region */
 #pragma omp parallel num_threads(pme->nthread) private(thread)
@@ -1219,6 +1282,8 @@ int gmx_pme_do(struct gmx_pme_t *pme,
 #if GMX_MPI
             if (pme->nnodes > 1)
             {
+                /* The communication buffers might still be in use */
+                spread_on_grid_finish_comm(pme);
                 gmx_sum_qgrid_dd(pme, grid, GMX_SUM_GRID_BACKWARD);
             }
 #endif
@@ -1233,12 +1298,23 @@ int gmx_pme_do(struct gmx_pme_t *pme,
 
             where();
 
+            if (pme->nnodes == 1)
+            {
+                atc->coefficient = coefficient_ptr[grid_index];
+            }
+            else if (bStoreCoefficients)
+            {
+                std::copy(pme->grid_coefficient[grid_index],
+                          pme->grid_coefficient[grid_index] + atc->n,
+                          atc->coefficient);
+            }
+
             /* If we are running without parallelization,
              * atc->f is the actual force array, not a buffer,
              * therefore we should not clear it.
              */
             lambda  = grid_index < DO_Q ? lambda_q : lambda_lj;
-            bClearF = (bFirst && PAR(cr));
+            bClearF = (g == 0 && PAR(cr));
 #pragma omp parallel for num_threads(pme->nthread) schedule(static)
             for (thread = 0; thread < pme->nthread; thread++)
             {
@@ -1274,7 +1350,6 @@ int gmx_pme_do(struct gmx_pme_t *pme,
                 get_pme_ener_vir_lj(pme->solve_work, pme->nthread, &energy_AB[grid_index], vir_AB[grid_index]);
             }
         }
-        bFirst = FALSE;
     } /* of grid_index-loop */
 
     /* For Lorentz-Berthelot combination rules in LJ-PME, we need to calculate
@@ -1367,7 +1442,7 @@ int gmx_pme_do(struct gmx_pme_t *pme,
                 {
                     wallcycle_start(wcycle, ewcPME_SPREADGATHER);
                     /* Spread the c6 on a grid */
-                    spread_on_grid(pme, &pme->atc[0], pmegrid, bFirst, TRUE, fftgrid, bDoSplines, grid_index);
+                    spread_on_grid(pme, &pme->atc[0], pmegrid, bFirst, TRUE, fftgrid, bDoSplines, grid_index, FALSE);
 
                     if (bFirst)
                     {
@@ -1666,6 +1741,11 @@ int gmx_pme_destroy(struct gmx_pme_t **pmedata)
     sfree(pme->lb_buf1);
     sfree(pme->lb_buf2);
 
+    for (int i = 0; i < DO_Q_AND_LJ; i++)
+    {
+        sfree(pme->grid_coefficient[i]);
+    }
+
     sfree(pme->bufv);
     sfree(pme->bufr);
 
@@ -45,6 +45,9 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <string>
+#include <thread>
+
 #include <fcntl.h>
 #if GMX_NATIVE_WINDOWS
 #include <io.h>
@@ -70,6 +73,7 @@
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/baseversion.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
@@ -1549,13 +1553,97 @@ static int do_cpt_files(XDR *xd, gmx_bool bRead,
 }
 
 
+/* Makes sure the checkpoint file fp, opened as fntemp, and the output
+ * files it refers to are physically on disk, closes fp and moves
+ * the checkpoint to fn.
+ */
+static void finishCheckpointFile(t_fileio *fp, const char *fn, const char *fntemp,
+                                 gmx_bool bNumberAndKeep)
+{
+    t_fileio *ret;
+    char      buf[1024];
+
+    /* we really, REALLY, want to make sure to physically write the checkpoint,
+       and all the files it depends on, out to disk. Because we've
+       opened the checkpoint with gmx_fio_open(), it's in our list
+       of open files.  */
+    ret = gmx_fio_all_output_fsync();
+
+    if (ret)
+    {
+        char buf[STRLEN];
+        sprintf(buf,
+                "Cannot fsync '%s'; maybe you are out of disk space?",
+                gmx_fio_getname(ret));
+
+        if (getenv(GMX_IGNORE_FSYNC_FAILURE_ENV) == nullptr)
+        {
+            gmx_file(buf);
+        }
+        else
+        {
+            gmx_warning(buf);
+        }
+    }
+
+    if (gmx_fio_close(fp) != 0)
+    {
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+    }
+
+    /* we don't move the checkpoint if the user specified they didn't want it,
+       or if the fsyncs failed */
+#if !GMX_NO_RENAME
+    if (!bNumberAndKeep && !ret)
+    {
+        if (gmx_fexist(fn))
+        {
+            /* Rename the previous checkpoint file */
+            std::strcpy(buf, fn);
+            buf[std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1] = '\0';
+            std::strcat(buf, "_prev");
+            std::strcat(buf, fn+std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1);
+#ifndef GMX_FAHCORE
+            /* we copy here so that if something goes wrong between now and
+             * the rename below, there's always a state.cpt.
+             * If renames are atomic (such as in POSIX systems),
+             * this copying should be unneccesary.
+             */
+            gmx_file_copy(fn, buf, FALSE);
+            /* We don't really care if this fails:
+             * there's already a new checkpoint.
+             */
+#else
+            gmx_file_rename(fn, buf);
+#endif
+        }
+        if (gmx_file_rename(fntemp, fn) != 0)
+        {
+            gmx_file("Cannot rename checkpoint file; maybe you are out of disk space?");
+        }
+    }
+#endif  /* GMX_NO_RENAME */
+}
+
+/* Thread function for finishing a checkpoint in the background */
+static void finishCheckpointFileThread(t_fileio *fp, std::string fn, std::string fntemp,
+                                       gmx_bool bNumberAndKeep)
+{
+    try
+    {
+        finishCheckpointFile(fp, fn.c_str(), fntemp.c_str(), bNumberAndKeep);
+    }
+    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+}
+
 void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
                       FILE *fplog, t_commrec *cr,
                       ivec domdecCells, int nppnodes,
                       int eIntegrator, int simulation_part,
                       gmx_bool bExpanded, int elamstats,
                       gmx_int64_t step, double t,
-                      t_state *state, energyhistory_t *enerhist)
+                      t_state *state, energyhistory_t *enerhist,
+                      std::thread *finishThread)
 {
     t_fileio            *fp;
     int                  file_version;
@@ -1573,7 +1661,9 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
     int                  noutputfiles;
     char                *ftime;
     int                  flags_eks, flags_enh, flags_dfh;
-    t_fileio            *ret;
+
+    GMX_RELEASE_ASSERT(finishThread == nullptr || !finishThread->joinable(),
+                       "The previous checkpoint should be complete before we write a new one");
 
     if (DOMAINDECOMP(cr))
     {
@@ -1713,68 +1803,27 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
 
     do_cpt_footer(gmx_fio_getxdr(fp), file_version);
 
-    /* we really, REALLY, want to make sure to physically write the checkpoint,
-       and all the files it depends on, out to disk. Because we've
-       opened the checkpoint with gmx_fio_open(), it's in our list
-       of open files.  */
-    ret = gmx_fio_all_output_fsync();
+    sfree(outputfiles);
 
-    if (ret)
+    /* Get the checkpoint data out of our process, the fsyncs and
+     * renames can then be done in the background.
+     */
+    if (gmx_fio_flush(fp) != 0)
     {
-        char buf[STRLEN];
-        sprintf(buf,
-                "Cannot fsync '%s'; maybe you are out of disk space?",
-                gmx_fio_getname(ret));
-
-        if (getenv(GMX_IGNORE_FSYNC_FAILURE_ENV) == nullptr)
-        {
-            gmx_file(buf);
-        }
-        else
-        {
-            gmx_warning(buf);
-        }
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
     }
 
-    if (gmx_fio_close(fp) != 0)
+    if (finishThread != nullptr)
     {
-        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+        *finishThread = std::thread(finishCheckpointFileThread,
+                                    fp, std::string(fn), std::string(fntemp),
+                                    bNumberAndKeep);
     }
-
-    /* we don't move the checkpoint if the user specified they didn't want it,
-       or if the fsyncs failed */
-#if !GMX_NO_RENAME
-    if (!bNumberAndKeep && !ret)
+    else
     {
-        if (gmx_fexist(fn))
-        {
-            /* Rename the previous checkpoint file */
-            std::strcpy(buf, fn);
-            buf[std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1] = '\0';
-            std::strcat(buf, "_prev");
-            std::strcat(buf, fn+std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1);
-#ifndef GMX_FAHCORE
-            /* we copy here so that if something goes wrong between now and
-             * the rename below, there's always a state.cpt.
-             * If renames are atomic (such as in POSIX systems),
-             * this copying should be unneccesary.
-             */
-            gmx_file_copy(fn, buf, FALSE);
-            /* We don't really care if this fails:
-             * there's already a new checkpoint.
-             */
-#else
-            gmx_file_rename(fn, buf);
-#endif
-        }
-        if (gmx_file_rename(fntemp, fn) != 0)
-        {
-            gmx_file("Cannot rename checkpoint file; maybe you are out of disk space?");
-        }
+        finishCheckpointFile(fp, fn, fntemp, bNumberAndKeep);
     }
-#endif  /* GMX_NO_RENAME */
 
-    sfree(outputfiles);
     sfree(fntemp);
 
 #ifdef GMX_FAHCORE
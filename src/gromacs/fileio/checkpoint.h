@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -40,6 +40,8 @@
 
 #include <cstdio>
 
+#include <thread>
+
 #include "gromacs/math/vectypes.h"
 #include "gromacs/utility/basedefinitions.h"
 
@@ -61,6 +63,11 @@ struct t_trxframe;
 /* Write a checkpoint to <fn>.cpt
  * Appends the _step<step>.cpt with bNumberAndKeep,
  * otherwise moves the previous <fn>.cpt to <fn>_prev.cpt
+ * The state is serialized before returning. When finishThread is not NULL,
+ * syncing the checkpoint and the output files to disk and renaming
+ * the checkpoint file are done by a thread started in *finishThread,
+ * which the caller should join before writing the next checkpoint
+ * and before exiting. *finishThread should not be joinable on entry.
  */
 void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
                       FILE *fplog, t_commrec *cr,
@@ -68,7 +75,8 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
                       int eIntegrator, int simulation_part,
                       gmx_bool bExpanded, int elamstats,
                       gmx_int64_t step, double t,
-                      t_state *state, energyhistory_t *enerhist);
+                      t_state *state, energyhistory_t *enerhist,
+                      std::thread *finishThread);
 
 /* Loads a checkpoint from fn for run continuation.
  * Generates a fatal error on system size mismatch.
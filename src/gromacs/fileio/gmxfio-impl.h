@@ -57,6 +57,7 @@
 #include "thread_mpi/lock.h"
 
 #include "gromacs/fileio/xdrf.h"
+#include "gromacs/utility/futil.h"
 
 struct t_fileio
 {
@@ -69,6 +70,15 @@ struct t_fileio
     enum xdr_op  xdrmode;              /* the xdr mode */
     int          iFTP;                 /* the file type identifier */
 
+    char        *mappedData;           /* the memory-mapped file contents, or NULL */
+    gmx_off_t    mappedSize;           /* the size of the mapping */
+    gmx_off_t    mappedOffset;         /* file offset at which mappedXdr starts */
+    gmx_off_t    readAheadEnd;         /* end of the region that was prefetched */
+    XDR          mappedXdr;            /* xdr stream reading from the mapping */
+    XDR         *fileXdr;              /* the file xdr stream, while xdr points
+                                          to mappedXdr, NULL otherwise */
+    gmx_bool     bNoMapping;           /* the file can not or should not be mapped */
+
     t_fileio    *next, *prev;          /* next and previous file pointers in the
                                           linked list */
     tMPI_Lock_t  mtx;                  /* content locking mutex. This is a fast lock
@@ -41,15 +41,26 @@
 #include "config.h"
 
 #include <cerrno>
+#include <climits>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
+
 #if HAVE_IO_H
 #include <io.h>
 #endif
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if defined _POSIX_MAPPED_FILES && _POSIX_MAPPED_FILES > 0 && HAVE_FILENO
+#define GMX_FIO_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#define GMX_FIO_MMAP 0
+#endif
 
 #include "thread_mpi/threads.h"
 
@@ -352,6 +363,7 @@ t_fileio *gmx_fio_open(const char *fn, const char *mode)
         gmx_fatal(FARGS, "Cannot open file with NULL filename string");
     }
 
+    fio->bNoMapping        = (!bRead || getenv("GMX_NO_MMAP") != nullptr);
     fio->bRead             = bRead;
     fio->bReadWrite        = bReadWrite;
     fio->bDouble           = (sizeof(real) == sizeof(double));
@@ -361,10 +373,159 @@ t_fileio *gmx_fio_open(const char *fn, const char *mode)
     return fio;
 }
 
+/* Size of the region ahead of the read position that the OS is asked
+ * to read in when reading from a memory-mapped file */
+static const gmx_off_t c_mappedReadAheadSize = 64*1024*1024;
+
+/* Unmaps the file of fio, if it is mapped */
+static void gmx_fio_unmap(t_fileio *fio)
+{
+#if GMX_FIO_MMAP
+    if (fio->mappedData != nullptr)
+    {
+        munmap(fio->mappedData, fio->mappedSize);
+    }
+#endif
+    fio->mappedData   = nullptr;
+    fio->mappedSize   = 0;
+    fio->readAheadEnd = 0;
+}
+
+/* Makes sure that fio is mapped with the current size of the file.
+ * Returns FALSE when the file is not mapped.
+ *
+ * The size is checked before every mapped read. A file whose size has
+ * changed since it was mapped, i.e. that is still being written, is
+ * unmapped and read through stdio from then on. This does not make
+ * mapping safe against truncation: accessing a mapped page beyond the
+ * end of a file raises SIGBUS, so a file truncated between this check
+ * and the end of the read, as can happen with mdrun -append, still
+ * crashes the reader. Set GMX_NO_MMAP to read such files.
+ */
+static gmx_bool gmx_fio_update_mapping(t_fileio *fio)
+{
+#if GMX_FIO_MMAP
+    struct stat st;
+
+    if (fio->bNoMapping)
+    {
+        return FALSE;
+    }
+    if (fstat(fileno(fio->fp), &st) != 0 || !S_ISREG(st.st_mode) ||
+        static_cast<gmx_off_t>(static_cast<size_t>(st.st_size)) != st.st_size)
+    {
+        fio->bNoMapping = TRUE;
+        return FALSE;
+    }
+    if (fio->mappedData != nullptr && st.st_size != fio->mappedSize)
+    {
+        gmx_fio_unmap(fio);
+        fio->bNoMapping = TRUE;
+        /* Reset the stream state, which could be at end-of-file */
+        gmx_fseek(fio->fp, gmx_ftell(fio->fp), SEEK_SET);
+        return FALSE;
+    }
+    if (fio->mappedData == nullptr)
+    {
+        if (st.st_size == 0)
+        {
+            return FALSE;
+        }
+        /* MAP_PRIVATE only affects writes to the mapping; reading pages
+         * of a truncated file still raises SIGBUS.
+         */
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fio->fp), 0);
+        if (data == MAP_FAILED)
+        {
+            fio->bNoMapping = TRUE;
+            return FALSE;
+        }
+        fio->mappedData = static_cast<char *>(data);
+        fio->mappedSize = st.st_size;
+        posix_madvise(data, st.st_size, POSIX_MADV_SEQUENTIAL);
+    }
+    return TRUE;
+#else
+    GMX_UNUSED_VALUE(fio);
+    return FALSE;
+#endif
+}
+
+/* Asks the OS to read in the mapped data ahead of offset, if needed */
+static void gmx_fio_read_ahead(t_fileio *fio, gmx_off_t offset)
+{
+#if GMX_FIO_MMAP
+    if (offset + c_mappedReadAheadSize/2 > fio->readAheadEnd)
+    {
+        gmx_off_t pageSize = sysconf(_SC_PAGESIZE);
+        gmx_off_t start    = std::max(offset, fio->readAheadEnd)/pageSize*pageSize;
+        gmx_off_t end      = std::min(offset + c_mappedReadAheadSize, fio->mappedSize);
+        if (end > start)
+        {
+            posix_madvise(fio->mappedData + start, end - start, POSIX_MADV_WILLNEED);
+        }
+        fio->readAheadEnd = end;
+    }
+#else
+    GMX_UNUSED_VALUE(fio);
+    GMX_UNUSED_VALUE(offset);
+#endif
+}
+
+gmx_bool gmx_fio_begin_mapped_read(t_fileio *fio)
+{
+    gmx_bool bMapped = FALSE;
+
+    gmx_fio_lock(fio);
+    if (fio->xdr != nullptr && fio->xdrmode == XDR_DECODE && fio->fileXdr == nullptr &&
+        gmx_fio_update_mapping(fio))
+    {
+        gmx_off_t offset = gmx_ftell(fio->fp);
+        if (offset >= 0 && offset < fio->mappedSize)
+        {
+            gmx_off_t size = std::min<gmx_off_t>(fio->mappedSize - offset, INT_MAX);
+
+            gmx_fio_read_ahead(fio, offset);
+            xdrmem_create(&fio->mappedXdr, fio->mappedData + offset,
+                          static_cast<unsigned int>(size), XDR_DECODE);
+            fio->mappedOffset = offset;
+            fio->fileXdr      = fio->xdr;
+            fio->xdr          = &fio->mappedXdr;
+            bMapped           = TRUE;
+        }
+    }
+    gmx_fio_unlock(fio);
+
+    return bMapped;
+}
+
+void gmx_fio_end_mapped_read(t_fileio *fio)
+{
+    gmx_fio_lock(fio);
+    if (fio->fileXdr != nullptr)
+    {
+        gmx_off_t offset = fio->mappedOffset + xdr_getpos(fio->xdr);
+
+        xdr_destroy(fio->xdr);
+        fio->xdr     = fio->fileXdr;
+        fio->fileXdr = nullptr;
+        gmx_fseek(fio->fp, offset, SEEK_SET);
+    }
+    gmx_fio_unlock(fio);
+}
+
 static int gmx_fio_close_locked(t_fileio *fio)
 {
     int rc = 0;
 
+    if (fio->fileXdr != nullptr)
+    {
+        xdr_destroy(fio->xdr);
+        fio->xdr     = fio->fileXdr;
+        fio->fileXdr = nullptr;
+    }
+    gmx_fio_unmap(fio);
+
     if (fio->xdr != nullptr)
     {
         xdr_destroy(fio->xdr);
@@ -135,6 +135,18 @@ int gmx_fio_seek(t_fileio *fio, gmx_off_t fpos);
 FILE *gmx_fio_getfp(t_fileio *fio);
 /* Return the file pointer itself */
 
+gmx_bool gmx_fio_begin_mapped_read(t_fileio *fio);
+/* When fio is an XDR file opened for reading that can be memory-mapped,
+ * let the XDR reading functions on fio decode directly from the mapped
+ * file, starting at the current file position, and return TRUE.
+ * Return FALSE otherwise. Mapping is disabled when the environment
+ * variable GMX_NO_MMAP is set. */
+
+void gmx_fio_end_mapped_read(t_fileio *fio);
+/* End decoding from the mapped file started with
+ * gmx_fio_begin_mapped_read, and set the file position to just after
+ * the data that was decoded. */
+
 
 /* Element with information about position in a currently open file.
  * gmx_off_t should be defined by autoconf if your system does not have it.
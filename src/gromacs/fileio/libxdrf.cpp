@@ -43,6 +43,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/fileio/xdr_datatype.h"
 #include "gromacs/fileio/xdrf.h"
@@ -82,59 +83,130 @@ static const int magicints[] = {
     8192, 10321, 13003, 16384, 20642, 26007, 32768, 41285, 52015, 65536,
     82570, 104031, 131072, 165140, 208063, 262144, 330280, 416127, 524287, 660561,
     832255, 1048576, 1321122, 1664510, 2097152, 2642245, 3329021, 4194304, 5284491, 6658042,
-    8388607, 10568983, 13316085, 16777216
+    8388607, 10568983, 13316085, 16777216,
+    /* Older versions could select LASTIDX for large differences between
+     * atoms and then read past the end of the table. This entry continues
+     * the series, so such frames can be read; sendints and receiveints need
+     * 64-bit arithmetic for it. Frames are now written with at most
+     * LASTIDX-1, so older versions can read them.
+     */
+    21137967
 };
 
 #define FIRSTIDX 9
 /* note that magicints[FIRSTIDX-1] == 0 */
-#define LASTIDX static_cast<int>((sizeof(magicints) / sizeof(*magicints)))
+#define LASTIDX (static_cast<int>((sizeof(magicints) / sizeof(*magicints))) - 1)
 
 
 /*____________________________________________________________________________
  |
- | sendbits - encode num into buf using the specified number of bits
+ | BitWriter - append bit fields to a byte buffer
  |
- | This routines appends the value of num to the bits already present in
- | the array buf. You need to give it the number of bits to use and you
- | better make sure that this number of bits is enough to hold the value
- | Also num must be positive.
+ | sendbits() appends the value of num to the bits already present in
+ | the buffer. You need to give it the number of bits to use (at most 32)
+ | and you better make sure that this number of bits is enough to hold
+ | the value. Bits are stored most significant first, which is the layout
+ | of the compressed XTC coordinate stream. The pending bits are kept in
+ | a 64-bit register between calls, so only complete bytes are stored.
  |
  */
 
-static void sendbits(int buf[], int num_of_bits, int num)
+class BitWriter
 {
+    public:
+        explicit BitWriter(unsigned char *buf) : buf_(buf), cnt_(0), lastbits_(0), lastbyte_(0)
+        {
+        }
 
-    unsigned int    cnt, lastbyte;
-    int             lastbits;
-    unsigned char * cbuf;
+        void sendbits(int num_of_bits, unsigned int num)
+        {
+            lastbyte_  = (lastbyte_ << num_of_bits) | num;
+            lastbits_ += num_of_bits;
+            while (lastbits_ >= 8)
+            {
+                lastbits_   -= 8;
+                buf_[cnt_++] = static_cast<unsigned char>(lastbyte_ >> lastbits_);
+            }
+        }
 
-    cbuf     = (reinterpret_cast<unsigned char *>(buf)) + 3 * sizeof(*buf);
-    cnt      = static_cast<unsigned int>(buf[0]);
-    lastbits = buf[1];
-    lastbyte = static_cast<unsigned int>(buf[2]);
-    while (num_of_bits >= 8)
-    {
-        lastbyte     = (lastbyte << 8) | ((num >> (num_of_bits -8)) /* & 0xff*/);
-        cbuf[cnt++]  = lastbyte >> lastbits;
-        num_of_bits -= 8;
-    }
-    if (num_of_bits > 0)
-    {
-        lastbyte  = (lastbyte << num_of_bits) | num;
-        lastbits += num_of_bits;
-        if (lastbits >= 8)
+        /* Writes the remaining bits and returns the length of the stream in bytes */
+        int finish()
         {
-            lastbits   -= 8;
-            cbuf[cnt++] = lastbyte >> lastbits;
+            if (lastbits_ > 0)
+            {
+                buf_[cnt_++] = static_cast<unsigned char>(lastbyte_ << (8 - lastbits_));
+                lastbits_    = 0;
+            }
+            return cnt_;
         }
-    }
-    buf[0] = cnt;
-    buf[1] = lastbits;
-    buf[2] = lastbyte;
-    if (lastbits > 0)
-    {
-        cbuf[cnt] = lastbyte << (8 - lastbits);
-    }
+
+    private:
+        unsigned char *buf_;
+        int            cnt_;
+        int            lastbits_;
+        gmx_uint64_t   lastbyte_;
+};
+
+/*____________________________________________________________________________
+ |
+ | BitReader - extract bit fields from a byte buffer
+ |
+ | receivebits() is the inverse of BitWriter::sendbits(). It extracts the
+ | given number of bits (at most 32) from the buffer and returns them as
+ | an integer. Whole 32-bit words are loaded into the 64-bit register when
+ | possible. Reading past the end of the buffer returns zero bits, so
+ | a corrupted stream cannot make us read outside the buffer.
+ |
+ */
+
+class BitReader
+{
+    public:
+        BitReader(const unsigned char *buf, int size) : buf_(buf), size_(size), cnt_(0), lastbits_(0), lastbyte_(0)
+        {
+        }
+
+        unsigned int receivebits(int num_of_bits)
+        {
+            if (lastbits_ < num_of_bits)
+            {
+                if (cnt_ + 4 <= size_)
+                {
+                    lastbyte_  = (lastbyte_ << 32) |
+                        (static_cast<unsigned int>(buf_[cnt_]) << 24) |
+                        (static_cast<unsigned int>(buf_[cnt_ + 1]) << 16) |
+                        (static_cast<unsigned int>(buf_[cnt_ + 2]) << 8) |
+                        static_cast<unsigned int>(buf_[cnt_ + 3]);
+                    cnt_      += 4;
+                    lastbits_ += 32;
+                }
+                else
+                {
+                    while (lastbits_ < num_of_bits)
+                    {
+                        lastbyte_  = (lastbyte_ << 8) | (cnt_ < size_ ? buf_[cnt_] : 0);
+                        cnt_++;
+                        lastbits_ += 8;
+                    }
+                }
+            }
+            lastbits_ -= num_of_bits;
+            return static_cast<unsigned int>((lastbyte_ >> lastbits_) &
+                                             ((static_cast<gmx_uint64_t>(1) << num_of_bits) - 1));
+        }
+
+    private:
+        const unsigned char *buf_;
+        int                  size_;
+        int                  cnt_;
+        int                  lastbits_;
+        gmx_uint64_t         lastbyte_;
+};
+
+/* Reverses the byte order of x */
+static inline unsigned int byteSwap(unsigned int x)
+{
+    return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
 }
 
 /*_________________________________________________________________________
@@ -183,7 +255,7 @@ static int sizeofints( const int num_of_ints, unsigned int sizes[])
         tmp = 0;
         for (bytecnt = 0; bytecnt < num_of_bytes; bytecnt++)
         {
-            tmp            = bytes[bytecnt] * sizes[i] + tmp;
+            tmp            = static_cast<gmx_uint64_t>(bytes[bytecnt]) * sizes[i] + tmp;
             bytes[bytecnt] = tmp & 0xff;
             tmp          >>= 8;
         }
@@ -210,22 +282,57 @@ static int sizeofints( const int num_of_ints, unsigned int sizes[])
  | sendints - send a small set of small integers in compressed format
  |
  | this routine is used internally by xdr3dfcoord, to send a set of
- | small integers to the buffer.
+ | three small integers to the buffer.
  | Multiplication with fixed (specified maximum ) sizes is used to get
- | to one big, multibyte integer. Allthough the routine could be
- | modified to handle sizes bigger than 16777216, or more than just
- | a few integers, this is not done, because the gain in compression
- | isn't worth the effort. Note that overflowing the multiplication
- | or the byte buffer (32 bytes) is unchecked and causes bad results.
+ | to one big, multibyte integer, which is sent least significant byte
+ | first. Whenever that integer fits in 64 bits, which is the case
+ | for all but the very largest coordinate ranges, it is computed with
+ | plain 64-bit arithmetic and sent in 32-bit pieces. Otherwise the
+ | original byte-wise multiplication is used. Note that overflowing the
+ | byte buffer (32 bytes) is unchecked and causes bad results.
  |
  */
 
-static void sendints(int buf[], const int num_of_ints, const int num_of_bits,
-                     unsigned int sizes[], unsigned int nums[])
+static void sendints(BitWriter *writer, const int num_of_bits,
+                     const unsigned int sizes[], const unsigned int nums[])
 {
 
     int          i, num_of_bytes, bytecnt;
-    unsigned int bytes[32], tmp;
+    unsigned int bytes[32];
+    /* 64 bits, since a byte times the largest size does not fit in 32 */
+    gmx_uint64_t tmp;
+
+    for (i = 1; i < 3; i++)
+    {
+        if (nums[i] >= sizes[i])
+        {
+            fprintf(stderr, "major breakdown in sendints num %u doesn't "
+                    "match size %u\n", nums[i], sizes[i]);
+            exit(1);
+        }
+    }
+
+    if (num_of_bits <= 64)
+    {
+        gmx_uint64_t num = (static_cast<gmx_uint64_t>(nums[0])*sizes[1] + nums[1])*sizes[2] + nums[2];
+        int          bitsLeft;
+
+        for (bitsLeft = num_of_bits; bitsLeft >= 32; bitsLeft -= 32)
+        {
+            writer->sendbits(32, byteSwap(static_cast<unsigned int>(num)));
+            num >>= 32;
+        }
+        for (; bitsLeft >= 8; bitsLeft -= 8)
+        {
+            writer->sendbits(8, static_cast<unsigned int>(num & 0xff));
+            num >>= 8;
+        }
+        if (bitsLeft > 0)
+        {
+            writer->sendbits(bitsLeft, static_cast<unsigned int>(num));
+        }
+        return;
+    }
 
     tmp          = nums[0];
     num_of_bytes = 0;
@@ -236,19 +343,13 @@ static void sendints(int buf[], const int num_of_ints, const int num_of_bits,
     }
     while (tmp != 0);
 
-    for (i = 1; i < num_of_ints; i++)
+    for (i = 1; i < 3; i++)
     {
-        if (nums[i] >= sizes[i])
-        {
-            fprintf(stderr, "major breakdown in sendints num %u doesn't "
-                    "match size %u\n", nums[i], sizes[i]);
-            exit(1);
-        }
         /* use one step multiply */
         tmp = nums[i];
         for (bytecnt = 0; bytecnt < num_of_bytes; bytecnt++)
         {
-            tmp            = bytes[bytecnt] * sizes[i] + tmp;
+            tmp            = static_cast<gmx_uint64_t>(bytes[bytecnt]) * sizes[i] + tmp;
             bytes[bytecnt] = tmp & 0xff;
             tmp          >>= 8;
         }
@@ -263,96 +364,78 @@ static void sendints(int buf[], const int num_of_ints, const int num_of_bits,
     {
         for (i = 0; i < num_of_bytes; i++)
         {
-            sendbits(buf, 8, bytes[i]);
+            writer->sendbits(8, bytes[i]);
+        }
+        for (i = num_of_bits - num_of_bytes * 8; i > 0; i -= 8)
+        {
+            writer->sendbits(std::min(i, 8), 0);
         }
-        sendbits(buf, num_of_bits - num_of_bytes * 8, 0);
     }
     else
     {
         for (i = 0; i < num_of_bytes-1; i++)
         {
-            sendbits(buf, 8, bytes[i]);
+            writer->sendbits(8, bytes[i]);
         }
-        sendbits(buf, num_of_bits- (num_of_bytes -1) * 8, bytes[i]);
+        writer->sendbits(num_of_bits- (num_of_bytes -1) * 8, bytes[i]);
     }
 }
 
-
-/*___________________________________________________________________________
+/*____________________________________________________________________________
  |
- | receivebits - decode number from buf using specified number of bits
+ | receiveints - decode 'small' integers from the buffer
  |
- | extract the number of bits from the array buf and construct an integer
- | from it. Return that value.
+ | this routine is the inverse from sendints() and decodes the three small
+ | integers written to the buffer by calculating the remainder and doing
+ | divisions with the given sizes[]. You need to specify the total number
+ | of bits to be used from the buffer in num_of_bits.
  |
  */
 
-static int receivebits(int buf[], int num_of_bits)
+static void receiveints(BitReader *reader, int num_of_bits,
+                        const unsigned int sizes[], int nums[])
 {
+    int          bytes[32];
+    int          i, j, num_of_bytes, p;
+    gmx_uint64_t num;
 
-    int             cnt, num, lastbits;
-    unsigned int    lastbyte;
-    unsigned char * cbuf;
-    int             mask = (1 << num_of_bits) -1;
-
-    cbuf     = reinterpret_cast<unsigned char *>(buf) + 3 * sizeof(*buf);
-    cnt      = buf[0];
-    lastbits = static_cast<unsigned int>(buf[1]);
-    lastbyte = static_cast<unsigned int>(buf[2]);
-
-    num = 0;
-    while (num_of_bits >= 8)
-    {
-        lastbyte     = ( lastbyte << 8 ) | cbuf[cnt++];
-        num         |=  (lastbyte >> lastbits) << (num_of_bits - 8);
-        num_of_bits -= 8;
-    }
-    if (num_of_bits > 0)
+    if (num_of_bits <= 64)
     {
-        if (lastbits < num_of_bits)
+        gmx_uint64_t bignum = 0;
+        int          shift  = 0;
+
+        for (; num_of_bits >= 32; num_of_bits -= 32, shift += 32)
+        {
+            bignum |= static_cast<gmx_uint64_t>(byteSwap(reader->receivebits(32))) << shift;
+        }
+        for (; num_of_bits >= 8; num_of_bits -= 8, shift += 8)
         {
-            lastbits += 8;
-            lastbyte  = (lastbyte << 8) | cbuf[cnt++];
+            bignum |= static_cast<gmx_uint64_t>(reader->receivebits(8)) << shift;
         }
-        lastbits -= num_of_bits;
-        num      |= (lastbyte >> lastbits) & ((1 << num_of_bits) -1);
+        if (num_of_bits > 0)
+        {
+            bignum |= static_cast<gmx_uint64_t>(reader->receivebits(num_of_bits)) << shift;
+        }
+        nums[2] = static_cast<int>(bignum % sizes[2]);
+        bignum /= sizes[2];
+        nums[1] = static_cast<int>(bignum % sizes[1]);
+        bignum /= sizes[1];
+        nums[0] = static_cast<int>(bignum);
+        return;
     }
-    num   &= mask;
-    buf[0] = cnt;
-    buf[1] = lastbits;
-    buf[2] = lastbyte;
-    return num;
-}
-
-/*____________________________________________________________________________
- |
- | receiveints - decode 'small' integers from the buf array
- |
- | this routine is the inverse from sendints() and decodes the small integers
- | written to buf by calculating the remainder and doing divisions with
- | the given sizes[]. You need to specify the total number of bits to be
- | used from buf in num_of_bits.
- |
- */
-
-static void receiveints(int buf[], const int num_of_ints, int num_of_bits,
-                        unsigned int sizes[], int nums[])
-{
-    int bytes[32];
-    int i, j, num_of_bytes, p, num;
 
     bytes[0]     = bytes[1] = bytes[2] = bytes[3] = 0;
     num_of_bytes = 0;
     while (num_of_bits > 8)
     {
-        bytes[num_of_bytes++] = receivebits(buf, 8);
+        bytes[num_of_bytes++] = reader->receivebits(8);
         num_of_bits          -= 8;
     }
     if (num_of_bits > 0)
     {
-        bytes[num_of_bytes++] = receivebits(buf, num_of_bits);
+        bytes[num_of_bytes++] = reader->receivebits(num_of_bits);
     }
-    for (i = num_of_ints-1; i > 0; i--)
+    for (i = 2; i > 0; i--)
     {
         num = 0;
         for (j = num_of_bytes-1; j >= 0; j--)
@@ -360,421 +443,494 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits,
             num      = (num << 8) | bytes[j];
             p        = num / sizes[i];
             bytes[j] = p;
-            num      = num - p * sizes[i];
+            num      = num - static_cast<gmx_uint64_t>(p) * sizes[i];
         }
-        nums[i] = num;
+        nums[i] = static_cast<int>(num);
     }
     nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
 }
 
+/* Scratch buffers for xdr3dfcoord, reused between calls by the same thread */
+struct XdrCoordScratch
+{
+    std::vector<int>           ip;
+    std::vector<unsigned char> buf;
+};
+
+static XdrCoordScratch &getCoordScratch()
+{
+    static thread_local XdrCoordScratch scratch;
+    return scratch;
+}
+
+/* Computes the bit sizes used for the full coordinates from the ranges
+ * in sizeint. Returns the number of bits for sending all three coordinates
+ * with sendints(), or 0 when the ranges are too large to be multiplied,
+ * in which case bitsizeint holds the number of bits for each coordinate.
+ */
+static unsigned int coordinateBitSizes(unsigned int sizeint[], unsigned int bitsizeint[])
+{
+    /* check if one of the sizes is to big to be multiplied */
+    if ((sizeint[0] | sizeint[1] | sizeint[2] ) > 0xffffff)
+    {
+        bitsizeint[0] = sizeofint(sizeint[0]);
+        bitsizeint[1] = sizeofint(sizeint[1]);
+        bitsizeint[2] = sizeofint(sizeint[2]);
+        return 0; /* flag the use of large sizes */
+    }
+    bitsizeint[0] = bitsizeint[1] = bitsizeint[2] = 0;
+    return sizeofints(3, sizeint);
+}
+
 /*____________________________________________________________________________
  |
- | xdr3dfcoord - read or write compressed 3d coordinates to xdr file.
+ | compressCoordinates - the compression part of xdr3dfcoord
  |
- | this routine reads or writes (depending on how you opened the file with
- | xdropen() ) a large number of 3d coordinates (stored in *fp).
- | The number of coordinates triplets to write is given by *size. On
- | read this number may be zero, in which case it reads as many as were written
- | or it may specify the number if triplets to read (which should match the
- | number written).
- | Compression is achieved by first converting all floating numbers to integer
- | using multiplication by *precision and rounding to the nearest integer.
- | Then the minimum and maximum value are calculated to determine the range.
- | The limited range of integers so found, is used to compress the coordinates.
- | In addition the differences between succesive coordinates is calculated.
- | If the difference happens to be 'small' then only the difference is saved,
- | compressing the data even more. The notion of 'small' is changed dynamically
- | and is enlarged or reduced whenever needed or possible.
- | Extra compression is achieved in the case of GROMOS and coordinates of
- | water molecules. GROMOS first writes out the Oxygen position, followed by
- | the two hydrogens. In order to make the differences smaller (and thereby
- | compression the data better) the order is changed into first one hydrogen
- | then the oxygen, followed by the other hydrogen. This is rather special, but
- | it shouldn't harm in the general case.
+ | Converts the coordinates in fp to integers, determines the ranges and
+ | writes the compressed bit stream to buf. Returns the number of bytes
+ | written to buf, and the values that go into the header of the
+ | compressed data in minint, maxint and smallidx.
+ | The conversion to integers and the search for the ranges are written
+ | as separate simple loops over all values, so the compiler can vectorize
+ | them; only the bit packing itself needs to be sequential.
  |
  */
 
-int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
+static int compressCoordinates(const float *fp, int size, float precision,
+                               int *ip, unsigned char *buf,
+                               int minint[], int maxint[], int *smallidx, int *errval)
 {
-    int     *ip  = nullptr;
-    int     *buf = nullptr;
-    gmx_bool bRead;
-
-    /* preallocate a small buffer and ip on the stack - if we need more
-       we can always malloc(). This is faster for small values of size: */
-    unsigned     prealloc_size = 3*16;
-    int          prealloc_ip[3*16], prealloc_buf[3*20];
-    int          we_should_free = 0;
-
-    int          minint[3], maxint[3], mindiff, *lip, diff;
-    int          lint1, lint2, lint3, oldlint1, oldlint2, oldlint3, smallidx;
-    int          minidx, maxidx;
-    unsigned     sizeint[3], sizesmall[3], bitsizeint[3], size3, *luip;
-    int          flag, k;
-    int          smallnum, smaller, larger, i, is_small, is_smaller, run, prevrun;
-    float       *lfp, lf;
-    int          tmp, *thiscoord,  prevcoord[3];
+    int          mindiff, diff, minidx, maxidx;
+    unsigned int sizeint[3], sizesmall[3], bitsizeint[3], bitsize;
+    int          smallnum, smaller, larger, i, k, is_small, is_smaller, run, prevrun;
+    int          tmp, *thiscoord, prevcoord[3];
     unsigned int tmpcoord[30];
+    const int    size3    = size * 3;
+    bool         overflow = false;
 
-    int          bufsize, lsize;
-    unsigned int bitsize;
-    float        inv_precision;
-    int          errval = 1;
-    int          rc;
-
-    bRead         = (xdrs->x_op == XDR_DECODE);
-    bitsizeint[0] = bitsizeint[1] = bitsizeint[2] = 0;
-    prevcoord[0]  = prevcoord[1]  = prevcoord[2]  = 0;
+    for (k = 0; k < size3; k++)
+    {
+        /* find nearest integer */
+        float lf = (fp[k] >= 0.0) ? fp[k] * precision + 0.5 : fp[k] * precision - 0.5;
+        /* scaling would cause overflow */
+        overflow = overflow || std::abs(lf) > MAXABS;
+        ip[k]    = static_cast<int>(lf);
+    }
+    minint[0] = minint[1] = minint[2] = INT_MAX;
+    maxint[0] = maxint[1] = maxint[2] = INT_MIN;
+    for (i = 0; i < size; i++)
+    {
+        for (k = 0; k < 3; k++)
+        {
+            minint[k] = std::min(minint[k], ip[3*i + k]);
+            maxint[k] = std::max(maxint[k], ip[3*i + k]);
+        }
+    }
+    mindiff = INT_MAX;
+    for (i = 1; i < size; i++)
+    {
+        diff    = (std::abs(ip[3*i - 3] - ip[3*i]) +
+                   std::abs(ip[3*i - 2] - ip[3*i + 1]) +
+                   std::abs(ip[3*i - 1] - ip[3*i + 2]));
+        mindiff = std::min(mindiff, diff);
+    }
 
-    // The static analyzer warns about garbage values for thiscoord[] further
-    // down. It might be thrown off by all the reinterpret_casts, but we might
-    // as well make sure the small preallocated buffer is zero-initialized.
-    for (i = 0; i < static_cast<int>(prealloc_size); i++)
+    if ((float)maxint[0] - (float)minint[0] >= MAXABS ||
+        (float)maxint[1] - (float)minint[1] >= MAXABS ||
+        (float)maxint[2] - (float)minint[2] >= MAXABS)
     {
-        prealloc_ip[i] = 0;
+        /* turning value in unsigned by subtracting minint
+         * would cause overflow
+         */
+        overflow = true;
     }
+    if (overflow)
+    {
+        *errval = 0;
+    }
+    sizeint[0] = maxint[0] - minint[0]+1;
+    sizeint[1] = maxint[1] - minint[1]+1;
+    sizeint[2] = maxint[2] - minint[2]+1;
+    bitsize    = coordinateBitSizes(sizeint, bitsizeint);
 
-    if (!bRead)
+    *smallidx = FIRSTIDX;
+    while (*smallidx < LASTIDX - 1 && magicints[*smallidx] < mindiff)
     {
-        /* xdrs is open for writing */
+        (*smallidx)++;
+    }
 
-        if (xdr_int(xdrs, size) == 0)
+    BitWriter writer(buf);
+    int       curidx = *smallidx;
+
+    maxidx       = std::min(LASTIDX - 1, curidx + 8);
+    minidx       = maxidx - 8; /* often this equal smallidx */
+    smaller      = magicints[std::max(FIRSTIDX, curidx-1)] / 2;
+    smallnum     = magicints[curidx] / 2;
+    sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[curidx];
+    larger       = magicints[maxidx] / 2;
+    prevrun      = -1;
+    prevcoord[0] = prevcoord[1] = prevcoord[2] = 0;
+    i            = 0;
+    while (i < size)
+    {
+        is_small  = 0;
+        thiscoord = ip + i * 3;
+        if (curidx < maxidx && i >= 1 &&
+            std::abs(thiscoord[0] - prevcoord[0]) < larger &&
+            std::abs(thiscoord[1] - prevcoord[1]) < larger &&
+            std::abs(thiscoord[2] - prevcoord[2]) < larger)
         {
-            return 0;
+            is_smaller = 1;
         }
-        size3 = *size * 3;
-        /* when the number of coordinates is small, don't try to compress; just
-         * write them as floats using xdr_vector
-         */
-        if (*size <= 9)
+        else if (curidx > minidx)
         {
-            return (xdr_vector(xdrs, reinterpret_cast<char *>(fp), static_cast<unsigned int>(size3),
-                               static_cast<unsigned int>(sizeof(*fp)), (xdrproc_t)xdr_float));
+            is_smaller = -1;
         }
-
-        if (xdr_float(xdrs, precision) == 0)
+        else
         {
-            return 0;
+            is_smaller = 0;
         }
+        if (i + 1 < size)
+        {
+            if (std::abs(thiscoord[0] - thiscoord[3]) < smallnum &&
+                std::abs(thiscoord[1] - thiscoord[4]) < smallnum &&
+                std::abs(thiscoord[2] - thiscoord[5]) < smallnum)
+            {
+                /* interchange first with second atom for better
+                 * compression of water molecules
+                 */
+                tmp          = thiscoord[0]; thiscoord[0] = thiscoord[3];
+                thiscoord[3] = tmp;
+                tmp          = thiscoord[1]; thiscoord[1] = thiscoord[4];
+                thiscoord[4] = tmp;
+                tmp          = thiscoord[2]; thiscoord[2] = thiscoord[5];
+                thiscoord[5] = tmp;
+                is_small     = 1;
+            }
 
-        if (size3 <= prealloc_size)
+        }
+        tmpcoord[0] = thiscoord[0] - minint[0];
+        tmpcoord[1] = thiscoord[1] - minint[1];
+        tmpcoord[2] = thiscoord[2] - minint[2];
+        if (bitsize == 0)
         {
-            ip  = prealloc_ip;
-            buf = prealloc_buf;
+            writer.sendbits(bitsizeint[0], tmpcoord[0]);
+            writer.sendbits(bitsizeint[1], tmpcoord[1]);
+            writer.sendbits(bitsizeint[2], tmpcoord[2]);
         }
         else
         {
-            we_should_free = 1;
-            bufsize        = static_cast<int>(size3 * 1.2);
-            ip             = reinterpret_cast<int *>(malloc(size3 * sizeof(*ip)));
-            buf            = reinterpret_cast<int *>(malloc(bufsize * sizeof(*buf)));
-            if (ip == nullptr || buf == nullptr)
-            {
-                fprintf(stderr, "malloc failed\n");
-                exit(1);
-            }
+            sendints(&writer, bitsize, sizeint, tmpcoord);
         }
-        /* buf[0-2] are special and do not contain actual data */
-        buf[0]    = buf[1] = buf[2] = 0;
-        minint[0] = minint[1] = minint[2] = INT_MAX;
-        maxint[0] = maxint[1] = maxint[2] = INT_MIN;
-        prevrun   = -1;
-        lfp       = fp;
-        lip       = ip;
-        mindiff   = INT_MAX;
-        oldlint1  = oldlint2 = oldlint3 = 0;
-        while (lfp < fp + size3)
-        {
-            /* find nearest integer */
-            if (*lfp >= 0.0)
-            {
-                lf = *lfp * *precision + 0.5;
-            }
-            else
-            {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (fabs(lf) > MAXABS)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint1 = static_cast<int>(lf);
-            if (lint1 < minint[0])
-            {
-                minint[0] = lint1;
-            }
-            if (lint1 > maxint[0])
-            {
-                maxint[0] = lint1;
-            }
-            *lip++ = lint1;
-            lfp++;
-            if (*lfp >= 0.0)
-            {
-                lf = *lfp * *precision + 0.5;
-            }
-            else
-            {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (fabs(lf) > MAXABS)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint2 = static_cast<int>(lf);
-            if (lint2 < minint[1])
+        prevcoord[0] = thiscoord[0];
+        prevcoord[1] = thiscoord[1];
+        prevcoord[2] = thiscoord[2];
+        thiscoord    = thiscoord + 3;
+        i++;
+
+        run = 0;
+        if (is_small == 0 && is_smaller == -1)
+        {
+            is_smaller = 0;
+        }
+        while (is_small && run < 8*3)
+        {
+            if (is_smaller == -1 && (
+                    SQR(thiscoord[0] - prevcoord[0]) +
+                    SQR(thiscoord[1] - prevcoord[1]) +
+                    SQR(thiscoord[2] - prevcoord[2]) >= smaller * smaller))
             {
-                minint[1] = lint2;
+                is_smaller = 0;
             }
-            if (lint2 > maxint[1])
+
+            tmpcoord[run++] = thiscoord[0] - prevcoord[0] + smallnum;
+            tmpcoord[run++] = thiscoord[1] - prevcoord[1] + smallnum;
+            tmpcoord[run++] = thiscoord[2] - prevcoord[2] + smallnum;
+
+            prevcoord[0] = thiscoord[0];
+            prevcoord[1] = thiscoord[1];
+            prevcoord[2] = thiscoord[2];
+
+            i++;
+            thiscoord = thiscoord + 3;
+            is_small  = 0;
+            if (i < size &&
+                abs(thiscoord[0] - prevcoord[0]) < smallnum &&
+                abs(thiscoord[1] - prevcoord[1]) < smallnum &&
+                abs(thiscoord[2] - prevcoord[2]) < smallnum)
             {
-                maxint[1] = lint2;
+                is_small = 1;
             }
-            *lip++ = lint2;
-            lfp++;
-            if (*lfp >= 0.0)
+        }
+        if (run != prevrun || is_smaller != 0)
+        {
+            prevrun = run;
+            writer.sendbits(1, 1); /* flag the change in run-length */
+            writer.sendbits(5, run+is_smaller+1);
+        }
+        else
+        {
+            writer.sendbits(1, 0); /* flag the fact that runlength did not change */
+        }
+        for (k = 0; k < run; k += 3)
+        {
+            sendints(&writer, curidx, sizesmall, &tmpcoord[k]);
+        }
+        if (is_smaller != 0)
+        {
+            curidx += is_smaller;
+            if (is_smaller < 0)
             {
-                lf = *lfp * *precision + 0.5;
+                smallnum = smaller;
+                smaller  = magicints[curidx-1] / 2;
             }
             else
             {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (std::abs(lf) > MAXABS)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint3 = static_cast<int>(lf);
-            if (lint3 < minint[2])
-            {
-                minint[2] = lint3;
-            }
-            if (lint3 > maxint[2])
-            {
-                maxint[2] = lint3;
-            }
-            *lip++ = lint3;
-            lfp++;
-            diff = std::abs(oldlint1-lint1)+std::abs(oldlint2-lint2)+std::abs(oldlint3-lint3);
-            if (diff < mindiff && lfp > fp + 3)
-            {
-                mindiff = diff;
-            }
-            oldlint1 = lint1;
-            oldlint2 = lint2;
-            oldlint3 = lint3;
-        }
-        if ( (xdr_int(xdrs, &(minint[0])) == 0) ||
-             (xdr_int(xdrs, &(minint[1])) == 0) ||
-             (xdr_int(xdrs, &(minint[2])) == 0) ||
-             (xdr_int(xdrs, &(maxint[0])) == 0) ||
-             (xdr_int(xdrs, &(maxint[1])) == 0) ||
-             (xdr_int(xdrs, &(maxint[2])) == 0))
-        {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
+                smaller  = smallnum;
+                smallnum = magicints[curidx] / 2;
             }
-            return 0;
+            sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[curidx];
         }
+    }
+    return writer.finish();
+}
 
-        if ((float)maxint[0] - (float)minint[0] >= MAXABS ||
-            (float)maxint[1] - (float)minint[1] >= MAXABS ||
-            (float)maxint[2] - (float)minint[2] >= MAXABS)
-        {
-            /* turning value in unsigned by subtracting minint
-             * would cause overflow
-             */
-            errval = 0;
-        }
-        sizeint[0] = maxint[0] - minint[0]+1;
-        sizeint[1] = maxint[1] - minint[1]+1;
-        sizeint[2] = maxint[2] - minint[2]+1;
+/*____________________________________________________________________________
+ |
+ | decompressCoordinates - the decompression part of xdr3dfcoord
+ |
+ | Decodes the compressed bit stream of length byteCount in buf into
+ | size coordinate triplets in fp, using the values from the header of
+ | the compressed data. The integer coordinates are decoded in place in
+ | ip, and converted to floats in a separate loop at the end.
+ | Returns 1 when successful, 0 when the header values are corrupt.
+ |
+ */
+
+static int decompressCoordinates(const unsigned char *buf, int byteCount, int size,
+                                 const int minint[], const int maxint[], int smallidx,
+                                 float precision, int *ip, float *fp)
+{
+    unsigned int sizeint[3], sizesmall[3], bitsizeint[3], bitsize;
+    int          flag, k, i, run, is_smaller, smallnum, smaller, tmp;
+    int         *thiscoord, *lop, prevcoord[3];
+    float        inv_precision;
 
-        /* check if one of the sizes is to big to be multiplied */
-        if ((sizeint[0] | sizeint[1] | sizeint[2] ) > 0xffffff)
+    if (smallidx < FIRSTIDX || smallidx > LASTIDX)
+    {
+        return 0;
+    }
+    sizeint[0] = maxint[0] - minint[0]+1;
+    sizeint[1] = maxint[1] - minint[1]+1;
+    sizeint[2] = maxint[2] - minint[2]+1;
+    if (sizeint[0] == 0 || sizeint[1] == 0 || sizeint[2] == 0)
+    {
+        return 0;
+    }
+    bitsize = coordinateBitSizes(sizeint, bitsizeint);
+
+    smaller      = magicints[std::max(FIRSTIDX, smallidx-1)] / 2;
+    smallnum     = magicints[smallidx] / 2;
+    sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
+
+    BitReader reader(buf, byteCount);
+
+    run = 0;
+    i   = 0;
+    lop = ip;
+    while (i < size)
+    {
+        thiscoord = ip + i * 3;
+
+        if (bitsize == 0)
         {
-            bitsizeint[0] = sizeofint(sizeint[0]);
-            bitsizeint[1] = sizeofint(sizeint[1]);
-            bitsizeint[2] = sizeofint(sizeint[2]);
-            bitsize       = 0; /* flag the use of large sizes */
+            thiscoord[0] = reader.receivebits(bitsizeint[0]);
+            thiscoord[1] = reader.receivebits(bitsizeint[1]);
+            thiscoord[2] = reader.receivebits(bitsizeint[2]);
         }
         else
         {
-            bitsize = sizeofints(3, sizeint);
+            receiveints(&reader, bitsize, sizeint, thiscoord);
         }
-        luip     = reinterpret_cast<unsigned int *>(ip);
-        smallidx = FIRSTIDX;
-        while (smallidx < LASTIDX && magicints[smallidx] < mindiff)
+
+        i++;
+        thiscoord[0] += minint[0];
+        thiscoord[1] += minint[1];
+        thiscoord[2] += minint[2];
+
+        prevcoord[0] = thiscoord[0];
+        prevcoord[1] = thiscoord[1];
+        prevcoord[2] = thiscoord[2];
+
+
+        flag       = reader.receivebits(1);
+        is_smaller = 0;
+        if (flag == 1)
         {
-            smallidx++;
+            run        = reader.receivebits(5);
+            is_smaller = run % 3;
+            run       -= is_smaller;
+            is_smaller--;
         }
-        if (xdr_int(xdrs, &smallidx) == 0)
+        if (i + run/3 > size)
         {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
-            }
             return 0;
         }
-
-        maxidx       = std::min(LASTIDX, smallidx + 8);
-        minidx       = maxidx - 8; /* often this equal smallidx */
-        smaller      = magicints[std::max(FIRSTIDX, smallidx-1)] / 2;
-        smallnum     = magicints[smallidx] / 2;
-        sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
-        larger       = magicints[maxidx] / 2;
-        i            = 0;
-        while (i < *size)
+        if (run > 0)
         {
-            is_small  = 0;
-            thiscoord = reinterpret_cast<int *>(luip) + i * 3;
-            if (smallidx < maxidx && i >= 1 &&
-                std::abs(thiscoord[0] - prevcoord[0]) < larger &&
-                std::abs(thiscoord[1] - prevcoord[1]) < larger &&
-                std::abs(thiscoord[2] - prevcoord[2]) < larger)
-            {
-                is_smaller = 1;
-            }
-            else if (smallidx > minidx)
-            {
-                is_smaller = -1;
-            }
-            else
-            {
-                is_smaller = 0;
-            }
-            if (i + 1 < *size)
+            thiscoord += 3;
+            for (k = 0; k < run; k += 3)
             {
-                if (std::abs(thiscoord[0] - thiscoord[3]) < smallnum &&
-                    std::abs(thiscoord[1] - thiscoord[4]) < smallnum &&
-                    std::abs(thiscoord[2] - thiscoord[5]) < smallnum)
+                receiveints(&reader, smallidx, sizesmall, thiscoord);
+                i++;
+                thiscoord[0] += prevcoord[0] - smallnum;
+                thiscoord[1] += prevcoord[1] - smallnum;
+                thiscoord[2] += prevcoord[2] - smallnum;
+                if (k == 0)
                 {
                     /* interchange first with second atom for better
                      * compression of water molecules
                      */
-                    tmp          = thiscoord[0]; thiscoord[0] = thiscoord[3];
-                    thiscoord[3] = tmp;
-                    tmp          = thiscoord[1]; thiscoord[1] = thiscoord[4];
-                    thiscoord[4] = tmp;
-                    tmp          = thiscoord[2]; thiscoord[2] = thiscoord[5];
-                    thiscoord[5] = tmp;
-                    is_small     = 1;
+                    tmp          = thiscoord[0]; thiscoord[0] = prevcoord[0];
+                    prevcoord[0] = tmp;
+                    tmp          = thiscoord[1]; thiscoord[1] = prevcoord[1];
+                    prevcoord[1] = tmp;
+                    tmp          = thiscoord[2]; thiscoord[2] = prevcoord[2];
+                    prevcoord[2] = tmp;
+                    *lop++       = prevcoord[0];
+                    *lop++       = prevcoord[1];
+                    *lop++       = prevcoord[2];
                 }
-
+                else
+                {
+                    prevcoord[0] = thiscoord[0];
+                    prevcoord[1] = thiscoord[1];
+                    prevcoord[2] = thiscoord[2];
+                }
+                *lop++ = thiscoord[0];
+                *lop++ = thiscoord[1];
+                *lop++ = thiscoord[2];
+                thiscoord += 3;
             }
-            tmpcoord[0] = thiscoord[0] - minint[0];
-            tmpcoord[1] = thiscoord[1] - minint[1];
-            tmpcoord[2] = thiscoord[2] - minint[2];
-            if (bitsize == 0)
+        }
+        else
+        {
+            *lop++ = thiscoord[0];
+            *lop++ = thiscoord[1];
+            *lop++ = thiscoord[2];
+        }
+        smallidx += is_smaller;
+        if (smallidx < FIRSTIDX || smallidx > LASTIDX)
+        {
+            return 0;
+        }
+        if (is_smaller < 0)
+        {
+            smallnum = smaller;
+            if (smallidx > FIRSTIDX)
             {
-                sendbits(buf, bitsizeint[0], tmpcoord[0]);
-                sendbits(buf, bitsizeint[1], tmpcoord[1]);
-                sendbits(buf, bitsizeint[2], tmpcoord[2]);
+                smaller = magicints[smallidx - 1] /2;
             }
             else
             {
-                sendints(buf, 3, bitsize, sizeint, tmpcoord);
+                smaller = 0;
             }
-            prevcoord[0] = thiscoord[0];
-            prevcoord[1] = thiscoord[1];
-            prevcoord[2] = thiscoord[2];
-            thiscoord    = thiscoord + 3;
-            i++;
+        }
+        else if (is_smaller > 0)
+        {
+            smaller  = smallnum;
+            smallnum = magicints[smallidx] / 2;
+        }
+        sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
+    }
 
-            run = 0;
-            if (is_small == 0 && is_smaller == -1)
-            {
-                is_smaller = 0;
-            }
-            while (is_small && run < 8*3)
-            {
-                if (is_smaller == -1 && (
-                        SQR(thiscoord[0] - prevcoord[0]) +
-                        SQR(thiscoord[1] - prevcoord[1]) +
-                        SQR(thiscoord[2] - prevcoord[2]) >= smaller * smaller))
-                {
-                    is_smaller = 0;
-                }
+    inv_precision = 1.0 / precision;
+    for (k = 0; k < size * 3; k++)
+    {
+        fp[k] = ip[k] * inv_precision;
+    }
+    return 1;
+}
 
-                tmpcoord[run++] = thiscoord[0] - prevcoord[0] + smallnum;
-                tmpcoord[run++] = thiscoord[1] - prevcoord[1] + smallnum;
-                tmpcoord[run++] = thiscoord[2] - prevcoord[2] + smallnum;
+/*____________________________________________________________________________
+ |
+ | xdr3dfcoord - read or write compressed 3d coordinates to xdr file.
+ |
+ | this routine reads or writes (depending on how you opened the file with
+ | xdropen() ) a large number of 3d coordinates (stored in *fp).
+ | The number of coordinates triplets to write is given by *size. On
+ | read this number may be zero, in which case it reads as many as were written
+ | or it may specify the number if triplets to read (which should match the
+ | number written).
+ | Compression is achieved by first converting all floating numbers to integer
+ | using multiplication by *precision and rounding to the nearest integer.
+ | Then the minimum and maximum value are calculated to determine the range.
+ | The limited range of integers so found, is used to compress the coordinates.
+ | In addition the differences between succesive coordinates is calculated.
+ | If the difference happens to be 'small' then only the difference is saved,
+ | compressing the data even more. The notion of 'small' is changed dynamically
+ | and is enlarged or reduced whenever needed or possible.
+ | Extra compression is achieved in the case of GROMOS and coordinates of
+ | water molecules. GROMOS first writes out the Oxygen position, followed by
+ | the two hydrogens. In order to make the differences smaller (and thereby
+ | compression the data better) the order is changed into first one hydrogen
+ | then the oxygen, followed by the other hydrogen. This is rather special, but
+ | it shouldn't harm in the general case.
+ | The scratch buffers are kept per thread and reused between calls, so
+ | different threads can compress or decompress different frames at the
+ | same time.
+ |
+ */
 
-                prevcoord[0] = thiscoord[0];
-                prevcoord[1] = thiscoord[1];
-                prevcoord[2] = thiscoord[2];
+int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
+{
+    int              minint[3], maxint[3], smallidx, byteCount, lsize;
+    unsigned int     size3;
+    int              errval = 1;
+    XdrCoordScratch &scratch = getCoordScratch();
 
-                i++;
-                thiscoord = thiscoord + 3;
-                is_small  = 0;
-                if (i < *size &&
-                    abs(thiscoord[0] - prevcoord[0]) < smallnum &&
-                    abs(thiscoord[1] - prevcoord[1]) < smallnum &&
-                    abs(thiscoord[2] - prevcoord[2]) < smallnum)
-                {
-                    is_small = 1;
-                }
-            }
-            if (run != prevrun || is_smaller != 0)
-            {
-                prevrun = run;
-                sendbits(buf, 1, 1); /* flag the change in run-length */
-                sendbits(buf, 5, run+is_smaller+1);
-            }
-            else
-            {
-                sendbits(buf, 1, 0); /* flag the fact that runlength did not change */
-            }
-            for (k = 0; k < run; k += 3)
-            {
-                sendints(buf, 3, smallidx, sizesmall, &tmpcoord[k]);
-            }
-            if (is_smaller != 0)
-            {
-                smallidx += is_smaller;
-                if (is_smaller < 0)
-                {
-                    smallnum = smaller;
-                    smaller  = magicints[smallidx-1] / 2;
-                }
-                else
-                {
-                    smaller  = smallnum;
-                    smallnum = magicints[smallidx] / 2;
-                }
-                sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
-            }
+    if (xdrs->x_op == XDR_ENCODE)
+    {
+        /* xdrs is open for writing */
+
+        if (xdr_int(xdrs, size) == 0)
+        {
+            return 0;
         }
-        if (buf[1] != 0)
+        size3 = *size * 3;
+        /* when the number of coordinates is small, don't try to compress; just
+         * write them as floats using xdr_vector
+         */
+        if (*size <= 9)
         {
-            buf[0]++;
+            return (xdr_vector(xdrs, reinterpret_cast<char *>(fp), static_cast<unsigned int>(size3),
+                               static_cast<unsigned int>(sizeof(*fp)), (xdrproc_t)xdr_float));
         }
-        /* buf[0] holds the length in bytes */
-        if (xdr_int(xdrs, &(buf[0])) == 0)
+
+        if (xdr_float(xdrs, precision) == 0)
         {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
-            }
             return 0;
         }
 
+        /* the compressed stream never needs more than 15 bytes per atom */
+        scratch.ip.resize(size3);
+        scratch.buf.resize(5*size3 + 16);
+        byteCount = compressCoordinates(fp, *size, *precision, scratch.ip.data(), scratch.buf.data(),
+                                        minint, maxint, &smallidx, &errval);
 
-        rc = errval * (xdr_opaque(xdrs, reinterpret_cast<char *>(&(buf[3])), static_cast<unsigned int>(buf[0])));
-        if (we_should_free)
+        if ( (xdr_int(xdrs, &(minint[0])) == 0) ||
+             (xdr_int(xdrs, &(minint[1])) == 0) ||
+             (xdr_int(xdrs, &(minint[2])) == 0) ||
+             (xdr_int(xdrs, &(maxint[0])) == 0) ||
+             (xdr_int(xdrs, &(maxint[1])) == 0) ||
+             (xdr_int(xdrs, &(maxint[2])) == 0) ||
+             (xdr_int(xdrs, &smallidx) == 0) ||
+             (xdr_int(xdrs, &byteCount) == 0))
         {
-            free(ip);
-            free(buf);
+            return 0;
         }
-        return rc;
 
+        return errval * (xdr_opaque(xdrs, reinterpret_cast<char *>(scratch.buf.data()), static_cast<unsigned int>(byteCount)));
     }
     else
     {
@@ -803,207 +959,132 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
             return 0;
         }
 
-        if (size3 <= prealloc_size)
-        {
-            ip  = prealloc_ip;
-            buf = prealloc_buf;
-        }
-        else
-        {
-            we_should_free = 1;
-            bufsize        = static_cast<int>(size3 * 1.2);
-            ip             = reinterpret_cast<int *>(malloc(size3 * sizeof(*ip)));
-            buf            = reinterpret_cast<int *>(malloc(bufsize * sizeof(*buf)));
-            if (ip == nullptr || buf == nullptr)
-            {
-                fprintf(stderr, "malloc failed\n");
-                exit(1);
-            }
-        }
-
-        buf[0] = buf[1] = buf[2] = 0;
-
         if ( (xdr_int(xdrs, &(minint[0])) == 0) ||
              (xdr_int(xdrs, &(minint[1])) == 0) ||
              (xdr_int(xdrs, &(minint[2])) == 0) ||
              (xdr_int(xdrs, &(maxint[0])) == 0) ||
              (xdr_int(xdrs, &(maxint[1])) == 0) ||
-             (xdr_int(xdrs, &(maxint[2])) == 0))
+             (xdr_int(xdrs, &(maxint[2])) == 0) ||
+             (xdr_int(xdrs, &smallidx) == 0) ||
+             (xdr_int(xdrs, &byteCount) == 0) ||
+             byteCount < 0)
         {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
-            }
             return 0;
         }
 
-        sizeint[0] = maxint[0] - minint[0]+1;
-        sizeint[1] = maxint[1] - minint[1]+1;
-        sizeint[2] = maxint[2] - minint[2]+1;
-
-        /* check if one of the sizes is to big to be multiplied */
-        if ((sizeint[0] | sizeint[1] | sizeint[2] ) > 0xffffff)
+        /* When the stream is in memory, e.g. for a memory-mapped file,
+         * decode directly from it instead of copying the data */
+        const unsigned char *data = reinterpret_cast<const unsigned char *>(xdr_inline(xdrs, (byteCount + 3)/4*4));
+        if (data == nullptr)
         {
-            bitsizeint[0] = sizeofint(sizeint[0]);
-            bitsizeint[1] = sizeofint(sizeint[1]);
-            bitsizeint[2] = sizeofint(sizeint[2]);
-            bitsize       = 0; /* flag the use of large sizes */
-        }
-        else
-        {
-            bitsize = sizeofints(3, sizeint);
-        }
-
-        if (xdr_int(xdrs, &smallidx) == 0)
-        {
-            if (we_should_free)
+            scratch.buf.resize(std::max(byteCount, 1));
+            if (xdr_opaque(xdrs, reinterpret_cast<char *>(scratch.buf.data()), static_cast<unsigned int>(byteCount)) == 0)
             {
-                free(ip);
-                free(buf);
+                return 0;
             }
-            return 0;
+            data = scratch.buf.data();
         }
+        scratch.ip.resize(size3);
 
-        smaller      = magicints[std::max(FIRSTIDX, smallidx-1)] / 2;
-        smallnum     = magicints[smallidx] / 2;
-        sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
+        return decompressCoordinates(data, byteCount, *size, minint, maxint, smallidx,
+                                     *precision, scratch.ip.data(), fp);
+    }
+}
 
-        /* buf[0] holds the length in bytes */
+/* Reads a big-endian XDR integer from buffer at *pos, when it fits */
+static bool readBufferInt(const unsigned char *buffer, size_t bufferSize, size_t *pos, int *value)
+{
+    if (*pos + XDR_INT_SIZE > bufferSize)
+    {
+        return false;
+    }
+    const unsigned char *p = buffer + *pos;
+    *value = static_cast<int>((static_cast<unsigned int>(p[0]) << 24) |
+                              (static_cast<unsigned int>(p[1]) << 16) |
+                              (static_cast<unsigned int>(p[2]) << 8) |
+                              static_cast<unsigned int>(p[3]));
+    *pos  += XDR_INT_SIZE;
+    return true;
+}
 
-        if (xdr_int(xdrs, &(buf[0])) == 0)
-        {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
-            }
-            return 0;
-        }
+/* Reads a big-endian XDR float from buffer at *pos, when it fits */
+static bool readBufferFloat(const unsigned char *buffer, size_t bufferSize, size_t *pos, float *value)
+{
+    int i;
 
+    if (!readBufferInt(buffer, bufferSize, pos, &i))
+    {
+        return false;
+    }
+    std::memcpy(value, &i, sizeof(*value));
+    return true;
+}
 
-        if (xdr_opaque(xdrs, reinterpret_cast<char *>(&(buf[3])), static_cast<unsigned int>(buf[0])) == 0)
+size_t xdr3dfcoord_from_buffer(const char *buffer, size_t bufferSize,
+                               float *fp, int *size, float *precision)
+{
+    const unsigned char *buf = reinterpret_cast<const unsigned char *>(buffer);
+    size_t               pos = 0;
+    int                  minint[3], maxint[3], smallidx, byteCount, lsize, k;
+
+    if (!readBufferInt(buf, bufferSize, &pos, &lsize) || lsize < 0)
+    {
+        return 0;
+    }
+    if (*size != 0 && lsize != *size)
+    {
+        fprintf(stderr, "wrong number of coordinates in xdr3dfcoord_from_buffer; "
+                "%d arg vs %d in buffer", *size, lsize);
+    }
+    *size = lsize;
+    if (*size <= 9)
+    {
+        *precision = -1;
+        for (k = 0; k < *size * 3; k++)
         {
-            if (we_should_free)
+            if (!readBufferFloat(buf, bufferSize, &pos, &fp[k]))
             {
-                free(ip);
-                free(buf);
+                return 0;
             }
+        }
+        return pos;
+    }
+    if (!readBufferFloat(buf, bufferSize, &pos, precision))
+    {
+        return 0;
+    }
+    for (k = 0; k < 3; k++)
+    {
+        if (!readBufferInt(buf, bufferSize, &pos, &minint[k]))
+        {
             return 0;
         }
-
-
-
-        buf[0] = buf[1] = buf[2] = 0;
-
-        lfp           = fp;
-        inv_precision = 1.0 / *precision;
-        run           = 0;
-        i             = 0;
-        lip           = ip;
-        while (i < lsize)
+    }
+    for (k = 0; k < 3; k++)
+    {
+        if (!readBufferInt(buf, bufferSize, &pos, &maxint[k]))
         {
-            thiscoord = reinterpret_cast<int *>(lip) + i * 3;
-
-            if (bitsize == 0)
-            {
-                thiscoord[0] = receivebits(buf, bitsizeint[0]);
-                thiscoord[1] = receivebits(buf, bitsizeint[1]);
-                thiscoord[2] = receivebits(buf, bitsizeint[2]);
-            }
-            else
-            {
-                receiveints(buf, 3, bitsize, sizeint, thiscoord);
-            }
-
-            i++;
-            thiscoord[0] += minint[0];
-            thiscoord[1] += minint[1];
-            thiscoord[2] += minint[2];
-
-            prevcoord[0] = thiscoord[0];
-            prevcoord[1] = thiscoord[1];
-            prevcoord[2] = thiscoord[2];
-
-
-            flag       = receivebits(buf, 1);
-            is_smaller = 0;
-            if (flag == 1)
-            {
-                run        = receivebits(buf, 5);
-                is_smaller = run % 3;
-                run       -= is_smaller;
-                is_smaller--;
-            }
-            if (run > 0)
-            {
-                thiscoord += 3;
-                for (k = 0; k < run; k += 3)
-                {
-                    receiveints(buf, 3, smallidx, sizesmall, thiscoord);
-                    i++;
-                    thiscoord[0] += prevcoord[0] - smallnum;
-                    thiscoord[1] += prevcoord[1] - smallnum;
-                    thiscoord[2] += prevcoord[2] - smallnum;
-                    if (k == 0)
-                    {
-                        /* interchange first with second atom for better
-                         * compression of water molecules
-                         */
-                        tmp          = thiscoord[0]; thiscoord[0] = prevcoord[0];
-                        prevcoord[0] = tmp;
-                        tmp          = thiscoord[1]; thiscoord[1] = prevcoord[1];
-                        prevcoord[1] = tmp;
-                        tmp          = thiscoord[2]; thiscoord[2] = prevcoord[2];
-                        prevcoord[2] = tmp;
-                        *lfp++       = prevcoord[0] * inv_precision;
-                        *lfp++       = prevcoord[1] * inv_precision;
-                        *lfp++       = prevcoord[2] * inv_precision;
-                    }
-                    else
-                    {
-                        prevcoord[0] = thiscoord[0];
-                        prevcoord[1] = thiscoord[1];
-                        prevcoord[2] = thiscoord[2];
-                    }
-                    *lfp++ = thiscoord[0] * inv_precision;
-                    *lfp++ = thiscoord[1] * inv_precision;
-                    *lfp++ = thiscoord[2] * inv_precision;
-                }
-            }
-            else
-            {
-                *lfp++ = thiscoord[0] * inv_precision;
-                *lfp++ = thiscoord[1] * inv_precision;
-                *lfp++ = thiscoord[2] * inv_precision;
-            }
-            smallidx += is_smaller;
-            if (is_smaller < 0)
-            {
-                smallnum = smaller;
-                if (smallidx > FIRSTIDX)
-                {
-                    smaller = magicints[smallidx - 1] /2;
-                }
-                else
-                {
-                    smaller = 0;
-                }
-            }
-            else if (is_smaller > 0)
-            {
-                smaller  = smallnum;
-                smallnum = magicints[smallidx] / 2;
-            }
-            sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
+            return 0;
         }
     }
-    if (we_should_free)
+    if (!readBufferInt(buf, bufferSize, &pos, &smallidx) ||
+        !readBufferInt(buf, bufferSize, &pos, &byteCount) ||
+        byteCount < 0 || pos + byteCount > bufferSize)
     {
-        free(ip);
-        free(buf);
+        return 0;
     }
-    return 1;
+
+    std::vector<int> &ip = getCoordScratch().ip;
+    ip.resize(*size * 3);
+    if (!decompressCoordinates(buf + pos, byteCount, *size, minint, maxint, smallidx,
+                               *precision, ip.data(), fp))
+    {
+        return 0;
+    }
+    /* the opaque data is padded to a multiple of the XDR unit size */
+    pos += ((byteCount + XDR_INT_SIZE - 1) / XDR_INT_SIZE) * XDR_INT_SIZE;
+
+    return std::min(pos, bufferSize);
 }
 
 
@@ -878,12 +878,26 @@ static void write_xpm_axis(FILE *out, const char *axis, gmx_bool bSpatial,
     }
 }
 
-static void write_xpm_data(FILE *out, int n_x, int n_y, real **mat,
+/* Row function for writing a matrix stored as mat[x][y] */
+static void get_matrix_row(int j, int n_x, real row[], void *data)
+{
+    real **mat = static_cast<real **>(data);
+
+    for (int i = 0; i < n_x; i++)
+    {
+        row[i] = mat[i][j];
+    }
+}
+
+static void write_xpm_data(FILE *out, int n_x, int n_y,
+                           void (*get_row)(int j, int n_x, real row[], void *data), void *data,
                            real lo, real hi, int nlevels)
 {
-    int  i, j, c;
-    real invlevel;
+    int   i, j, c;
+    real  invlevel;
+    real *row;
 
+    snew(row, n_x);
     invlevel = (nlevels-1)/(hi-lo);
     for (j = n_y-1; (j >= 0); j--)
     {
@@ -891,10 +905,11 @@ static void write_xpm_data(FILE *out, int n_x, int n_y, real **mat,
         {
             fprintf(stderr, "%3d%%\b\b\b\b", (100*(n_y-j))/n_y);
         }
+        get_row(j, n_x, row, data);
         fprintf(out, "\"");
         for (i = 0; (i < n_x); i++)
         {
-            c = std::round((mat[i][j]-lo)*invlevel);
+            c = std::round((row[i]-lo)*invlevel);
             if (c < 0)
             {
                 c = 0;
@@ -921,6 +936,7 @@ static void write_xpm_data(FILE *out, int n_x, int n_y, real **mat,
             fprintf(out, "\"\n");
         }
     }
+    sfree(row);
 }
 
 static void write_xpm_data3(FILE *out, int n_x, int n_y, real **mat,
@@ -983,13 +999,17 @@ static void write_xpm_data3(FILE *out, int n_x, int n_y, real **mat,
     }
 }
 
-static void write_xpm_data_split(FILE *out, int n_x, int n_y, real **mat,
+static void write_xpm_data_split(FILE *out, int n_x, int n_y,
+                                 void (*get_row)(int j, int n_x, real row[], void *data),
+                                 void *data,
                                  real lo_top, real hi_top, int nlevel_top,
                                  real lo_bot, real hi_bot, int nlevel_bot)
 {
-    int  i, j, c;
-    real invlev_top, invlev_bot;
+    int   i, j, c;
+    real  invlev_top, invlev_bot;
+    real *row;
 
+    snew(row, n_x);
     invlev_top = (nlevel_top-1)/(hi_top-lo_top);
     invlev_bot = (nlevel_bot-1)/(hi_bot-lo_bot);
 
@@ -999,23 +1019,24 @@ static void write_xpm_data_split(FILE *out, int n_x, int n_y, real **mat,
         {
             fprintf(stderr, "%3d%%\b\b\b\b", (100*(n_y-j))/n_y);
         }
+        get_row(j, n_x, row, data);
         fprintf(out, "\"");
         for (i = 0; (i < n_x); i++)
         {
             if (i < j)
             {
-                c = nlevel_bot+round((mat[i][j]-lo_top)*invlev_top);
+                c = nlevel_bot+round((row[i]-lo_top)*invlev_top);
                 if ((c < nlevel_bot) || (c >= nlevel_bot+nlevel_top))
                 {
-                    gmx_fatal(FARGS, "Range checking i = %d, j = %d, c = %d, bot = %d, top = %d matrix[i,j] = %f", i, j, c, nlevel_bot, nlevel_top, mat[i][j]);
+                    gmx_fatal(FARGS, "Range checking i = %d, j = %d, c = %d, bot = %d, top = %d matrix[i,j] = %f", i, j, c, nlevel_bot, nlevel_top, row[i]);
                 }
             }
             else if (i > j)
             {
-                c = round((mat[i][j]-lo_bot)*invlev_bot);
+                c = round((row[i]-lo_bot)*invlev_bot);
                 if ((c < 0) || (c >= nlevel_bot+nlevel_bot))
                 {
-                    gmx_fatal(FARGS, "Range checking i = %d, j = %d, c = %d, bot = %d, top = %d matrix[i,j] = %f", i, j, c, nlevel_bot, nlevel_top, mat[i][j]);
+                    gmx_fatal(FARGS, "Range checking i = %d, j = %d, c = %d, bot = %d, top = %d matrix[i,j] = %f", i, j, c, nlevel_bot, nlevel_top, row[i]);
                 }
             }
             else
@@ -1034,6 +1055,7 @@ static void write_xpm_data_split(FILE *out, int n_x, int n_y, real **mat,
             fprintf(out, "\"\n");
         }
     }
+    sfree(row);
 }
 
 void write_xpm_m(FILE *out, t_matrix m)
@@ -1149,7 +1171,7 @@ void write_xpm_split(FILE *out, unsigned int flags,
                         bDiscreteColor, nlevel_bot, lo_bot, hi_bot, rlo_bot, rhi_bot);
     write_xpm_axis(out, "x", flags & MAT_SPATIAL_X, n_x, axis_x);
     write_xpm_axis(out, "y", flags & MAT_SPATIAL_Y, n_y, axis_y);
-    write_xpm_data_split(out, n_x, n_y, mat, lo_top, hi_top, *nlevel_top,
+    write_xpm_data_split(out, n_x, n_y, get_matrix_row, mat, lo_top, hi_top, *nlevel_top,
                          lo_bot, hi_bot, *nlevel_bot);
 }
 
@@ -1185,5 +1207,63 @@ void write_xpm(FILE *out, unsigned int flags,
     write_xpm_map(out, n_x, n_y, nlevels, lo, hi, rlo, rhi);
     write_xpm_axis(out, "x", flags & MAT_SPATIAL_X, n_x, axis_x);
     write_xpm_axis(out, "y", flags & MAT_SPATIAL_Y, n_y, axis_y);
-    write_xpm_data(out, n_x, n_y, mat, lo, hi, *nlevels);
+    write_xpm_data(out, n_x, n_y, get_matrix_row, mat, lo, hi, *nlevels);
+}
+
+void write_xpm_rows(FILE *out, unsigned int flags,
+                    const char *title, const char *legend,
+                    const char *label_x, const char *label_y,
+                    int n_x, int n_y, real axis_x[], real axis_y[],
+                    void (*get_row)(int j, int n_x, real row[], void *data),
+                    void *data, real lo, real hi,
+                    t_rgb rlo, t_rgb rhi, int *nlevels)
+{
+    /* See write_xpm, the rows are obtained from get_row */
+
+    if (hi <= lo)
+    {
+        gmx_fatal(FARGS, "hi (%f) <= lo (%f)", hi, lo);
+    }
+
+    write_xpm_header(out, title, legend, label_x, label_y, FALSE);
+    write_xpm_map(out, n_x, n_y, nlevels, lo, hi, rlo, rhi);
+    write_xpm_axis(out, "x", flags & MAT_SPATIAL_X, n_x, axis_x);
+    write_xpm_axis(out, "y", flags & MAT_SPATIAL_Y, n_y, axis_y);
+    write_xpm_data(out, n_x, n_y, get_row, data, lo, hi, *nlevels);
+}
+
+void write_xpm_split_rows(FILE *out, unsigned int flags,
+                          const char *title, const char *legend,
+                          const char *label_x, const char *label_y,
+                          int n_x, int n_y, real axis_x[], real axis_y[],
+                          void (*get_row)(int j, int n_x, real row[], void *data),
+                          void *data,
+                          real lo_top, real hi_top, int *nlevel_top,
+                          t_rgb rlo_top, t_rgb rhi_top,
+                          real lo_bot, real hi_bot, int *nlevel_bot,
+                          gmx_bool bDiscreteColor,
+                          t_rgb rlo_bot, t_rgb rhi_bot)
+{
+    /* See write_xpm_split, the rows are obtained from get_row */
+
+    if (hi_top <= lo_top)
+    {
+        gmx_fatal(FARGS, "hi_top (%g) <= lo_top (%g)", hi_top, lo_top);
+    }
+    if (hi_bot <= lo_bot)
+    {
+        gmx_fatal(FARGS, "hi_bot (%g) <= lo_bot (%g)", hi_bot, lo_bot);
+    }
+    if (bDiscreteColor && (*nlevel_bot >= 16))
+    {
+        gmx_impl("Can not plot more than 16 discrete colors");
+    }
+
+    write_xpm_header(out, title, legend, label_x, label_y, FALSE);
+    write_xpm_map_split(out, n_x, n_y, nlevel_top, lo_top, hi_top, rlo_top, rhi_top,
+                        bDiscreteColor, nlevel_bot, lo_bot, hi_bot, rlo_bot, rhi_bot);
+    write_xpm_axis(out, "x", flags & MAT_SPATIAL_X, n_x, axis_x);
+    write_xpm_axis(out, "y", flags & MAT_SPATIAL_Y, n_y, axis_y);
+    write_xpm_data_split(out, n_x, n_y, get_row, data, lo_top, hi_top, *nlevel_top,
+                         lo_bot, hi_bot, *nlevel_bot);
 }
@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2013,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2013,2014,2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -177,6 +177,34 @@ void write_xpm(FILE *out, unsigned int flags,
  * nlevels    number of color levels for the output
  */
 
+void write_xpm_rows(FILE *out, unsigned int flags,
+                    const char *title, const char *legend,
+                    const char *label_x, const char *label_y,
+                    int n_x, int n_y, real axis_x[], real axis_y[],
+                    void (*get_row)(int j, int n_x, real row[], void *data),
+                    void *data, real lo, real hi,
+                    t_rgb rlo, t_rgb rhi, int *nlevels);
+/* As write_xpm, but instead of the matrix the function get_row is passed,
+ * which is called for j = n_y-1 down to 0 and should then store element
+ * x,y=i,j in row[i] for i = 0 to n_x-1; data is passed to get_row.
+ * This allows writing matrices that are too large to store in memory.
+ */
+
+void write_xpm_split_rows(FILE *out, unsigned int flags,
+                          const char *title, const char *legend,
+                          const char *label_x, const char *label_y,
+                          int n_x, int n_y, real axis_x[], real axis_y[],
+                          void (*get_row)(int j, int n_x, real row[], void *data),
+                          void *data,
+                          real lo_top, real hi_top, int *nlevel_top,
+                          t_rgb rlo_top, t_rgb rhi_top,
+                          real lo_bot, real hi_bot, int *nlevel_bot,
+                          gmx_bool bDiscreteColor,
+                          t_rgb rlo_bot, t_rgb rhi_bot);
+/* As write_xpm_split, with the matrix rows obtained from get_row as for
+ * write_xpm_rows.
+ */
+
 real **mk_matrix(int nx, int ny, gmx_bool b1D);
 
 void done_matrix(int nx, real ***m);
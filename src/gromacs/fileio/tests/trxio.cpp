@@ -0,0 +1,297 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for reading XDR trajectories through memory-mapped files
+ * and for decoding XTC frames ahead in parallel.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trxio.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! Number of atoms in the test trajectories.
+const int c_natoms = 30;
+
+//! Returns the coordinates for \p frame.
+std::vector<gmx::RVec> frameCoordinates(int frame)
+{
+    std::vector<gmx::RVec> x(c_natoms);
+    for (int i = 0; i < c_natoms; i++)
+    {
+        x[i][XX] = 0.1*i + 0.01*frame;
+        x[i][YY] = 0.05*i*(frame % 3);
+        x[i][ZZ] = 0.2*(i % 7);
+    }
+    return x;
+}
+
+class TrajectoryReadingTest : public ::testing::TestWithParam<const char *>
+{
+    public:
+        TrajectoryReadingTest()
+        {
+            filename_ = fileManager_.getTemporaryFilePath(GetParam());
+            output_env_init_default(&oenv_);
+        }
+        ~TrajectoryReadingTest()
+        {
+            output_env_done(oenv_);
+        }
+
+        //! Writes frames \p firstFrame to \p lastFrame - 1 with \p mode.
+        void writeFrames(const char *mode, int firstFrame, int lastFrame)
+        {
+            matrix box;
+            clear_mat(box);
+            box[XX][XX] = box[YY][YY] = box[ZZ][ZZ] = 3;
+
+            bool      bXtc = (filename_.find(".xtc") != std::string::npos);
+            t_fileio *fio  = (bXtc ? open_xtc(filename_.c_str(), mode) : gmx_trr_open(filename_.c_str(), mode));
+            for (int frame = firstFrame; frame < lastFrame; frame++)
+            {
+                std::vector<gmx::RVec> x = frameCoordinates(frame);
+                if (bXtc)
+                {
+                    write_xtc(fio, c_natoms, 10*frame, 0.5*frame, box, as_rvec_array(x.data()), 1000);
+                }
+                else
+                {
+                    gmx_trr_write_frame(fio, 10*frame, 0.5*frame, 0, box, c_natoms,
+                                        as_rvec_array(x.data()), nullptr, nullptr);
+                }
+            }
+            if (bXtc)
+            {
+                close_xtc(fio);
+            }
+            else
+            {
+                gmx_trr_close(fio);
+            }
+        }
+
+        //! Checks that \p fr contains \p frame.
+        void checkFrame(const t_trxframe &fr, int frame)
+        {
+            EXPECT_EQ(10*frame, fr.step);
+            ASSERT_EQ(c_natoms, fr.natoms);
+            std::vector<gmx::RVec> x = frameCoordinates(frame);
+            for (int i = 0; i < c_natoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_NEAR(x[i][d], fr.x[i][d], 0.0006);
+                }
+            }
+        }
+
+        gmx::test::TestFileManager fileManager_;
+        std::string                filename_;
+        gmx_output_env_t          *oenv_;
+};
+
+TEST_P(TrajectoryReadingTest, ReadsAllFrames)
+{
+    writeFrames("w", 0, 8);
+
+    t_trxstatus *status;
+    t_trxframe   fr;
+    ASSERT_TRUE(read_first_frame(oenv_, &status, filename_.c_str(), &fr, TRX_NEED_X));
+    checkFrame(fr, 0);
+    for (int frame = 1; frame < 8; frame++)
+    {
+        ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+        checkFrame(fr, frame);
+    }
+    EXPECT_FALSE(read_next_frame(oenv_, status, &fr));
+
+    rewind_trj(status);
+    ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+    checkFrame(fr, 0);
+
+    close_trx(status);
+    sfree(fr.x);
+}
+
+TEST_P(TrajectoryReadingTest, ReadsFramesAppendedWhileReading)
+{
+    writeFrames("w", 0, 3);
+
+    t_trxstatus *status;
+    t_trxframe   fr;
+    ASSERT_TRUE(read_first_frame(oenv_, &status, filename_.c_str(), &fr, TRX_NEED_X));
+    ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+    checkFrame(fr, 1);
+
+    writeFrames("a", 3, 6);
+    for (int frame = 2; frame < 6; frame++)
+    {
+        ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+        checkFrame(fr, frame);
+    }
+    EXPECT_FALSE(read_next_frame(oenv_, status, &fr));
+
+    close_trx(status);
+    sfree(fr.x);
+}
+
+TEST_P(TrajectoryReadingTest, ReadsAllFramesWithThreads)
+{
+    // With more than one thread, XTC frames are decoded ahead in blocks
+    // of four frames per thread, so use a partial last block.
+    const int nframes  = 45;
+    const int nthreads = gmx_omp_get_max_threads();
+    writeFrames("w", 0, nframes);
+
+    gmx_omp_set_num_threads(4);
+    t_trxstatus *status;
+    t_trxframe   fr;
+    ASSERT_TRUE(read_first_frame(oenv_, &status, filename_.c_str(), &fr, TRX_NEED_X));
+    checkFrame(fr, 0);
+    for (int frame = 1; frame < nframes; frame++)
+    {
+        ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+        checkFrame(fr, frame);
+    }
+    EXPECT_FALSE(read_next_frame(oenv_, status, &fr));
+
+    // Frames decoded ahead should be discarded on rewinding
+    rewind_trj(status);
+    for (int frame = 0; frame < 3; frame++)
+    {
+        ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+        checkFrame(fr, frame);
+    }
+    rewind_trj(status);
+    ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+    checkFrame(fr, 0);
+
+    close_trx(status);
+    sfree(fr.x);
+    gmx_omp_set_num_threads(nthreads);
+}
+
+TEST_P(TrajectoryReadingTest, ReadsFramesAppendedWhileReadingWithThreads)
+{
+    const int nthreads = gmx_omp_get_max_threads();
+    writeFrames("w", 0, 3);
+
+    gmx_omp_set_num_threads(4);
+    t_trxstatus *status;
+    t_trxframe   fr;
+    ASSERT_TRUE(read_first_frame(oenv_, &status, filename_.c_str(), &fr, TRX_NEED_X));
+    for (int frame = 1; frame < 3; frame++)
+    {
+        ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+        checkFrame(fr, frame);
+    }
+    EXPECT_FALSE(read_next_frame(oenv_, status, &fr));
+
+    writeFrames("a", 3, 30);
+    for (int frame = 3; frame < 30; frame++)
+    {
+        ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+        checkFrame(fr, frame);
+    }
+    EXPECT_FALSE(read_next_frame(oenv_, status, &fr));
+
+    close_trx(status);
+    sfree(fr.x);
+    gmx_omp_set_num_threads(nthreads);
+}
+
+TEST_P(TrajectoryReadingTest, ReadsFileTruncatedWhileReading)
+{
+    // Truncate the file while it is read, as mdrun -append does, so that
+    // part of the file that was mapped for reading no longer exists.
+    const int nframes          = 2000;
+    const int nframesTruncated = 1000;
+    const int nthreads         = gmx_omp_get_max_threads();
+    writeFrames("w", 0, nframesTruncated);
+    FILE     *fp = gmx_ffopen(filename_.c_str(), "r");
+    gmx_fseek(fp, 0, SEEK_END);
+    gmx_off_t truncatedSize = gmx_ftell(fp);
+    gmx_ffclose(fp);
+    writeFrames("a", nframesTruncated, nframes);
+
+    gmx_omp_set_num_threads(1);
+    t_trxstatus *status;
+    t_trxframe   fr;
+    ASSERT_TRUE(read_first_frame(oenv_, &status, filename_.c_str(), &fr, TRX_NEED_X));
+    for (int frame = 1; frame < 3; frame++)
+    {
+        ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+        checkFrame(fr, frame);
+    }
+
+    ASSERT_EQ(0, gmx_truncate(filename_.c_str(), truncatedSize));
+    for (int frame = 3; frame < nframesTruncated; frame++)
+    {
+        ASSERT_TRUE(read_next_frame(oenv_, status, &fr));
+        checkFrame(fr, frame);
+    }
+    EXPECT_FALSE(read_next_frame(oenv_, status, &fr));
+
+    close_trx(status);
+    sfree(fr.x);
+    gmx_omp_set_num_threads(nthreads);
+}
+
+INSTANTIATE_TEST_CASE_P(WithXdrFormats, TrajectoryReadingTest,
+                        ::testing::Values("traj.xtc", "traj.trr"));
+
+} // namespace
@@ -0,0 +1,159 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Microbenchmark for XTC compression and decompression.
+ *
+ * Writes a trajectory of a synthetic water box and reports the time
+ * for writing it, for reading it frame by frame, and for reading it
+ * in blocks of frames that are decompressed in parallel.
+ *
+ * Usage: xtc-benchmark [natoms [nframes [nthreads]]]
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/smalloc.h"
+
+namespace
+{
+
+//! Clock used for the timings.
+typedef std::chrono::steady_clock Clock;
+
+//! Returns the time since \p start in milliseconds.
+double millisecondsSince(const Clock::time_point &start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const int   natoms    = (argc > 1 ? std::atoi(argv[1]) : 300000)/3*3;
+    const int   nframes   = (argc > 2 ? std::atoi(argv[2]) : 20);
+    const int   nthreads  = (argc > 3 ? std::atoi(argv[3]) : 4);
+    const char *filename  = "xtc-benchmark.xtc";
+    const real  boxSize   = std::cbrt(natoms/100.0);
+    const int   blockSize = 2*nthreads;
+
+    /* Water-like molecules with random positions and small thermal motion */
+    std::mt19937                     rng(1);
+    std::uniform_real_distribution<> position(0, boxSize);
+    std::normal_distribution<>       motion(0, 0.005);
+    std::vector<gmx::RVec>           x(natoms);
+    for (int i = 0; i < natoms; i += 3)
+    {
+        x[i]          = { real(position(rng)), real(position(rng)), real(position(rng)) };
+        x[i + 1]      = x[i];
+        x[i + 1][XX] += 0.1;
+        x[i + 2]      = x[i];
+        x[i + 2][YY] += 0.1;
+    }
+    matrix box;
+    clear_mat(box);
+    box[XX][XX] = box[YY][YY] = box[ZZ][ZZ] = boxSize;
+
+    Clock::time_point start = Clock::now();
+    t_fileio         *fio   = open_xtc(filename, "w");
+    for (int frame = 0; frame < nframes; frame++)
+    {
+        for (auto &v : x)
+        {
+            v[XX] += motion(rng);
+            v[YY] += motion(rng);
+            v[ZZ] += motion(rng);
+        }
+        write_xtc(fio, natoms, frame, frame, box, as_rvec_array(x.data()), 1000);
+    }
+    close_xtc(fio);
+    double writeTime = millisecondsSince(start);
+
+    gmx_int64_t step;
+    real        time, prec;
+    gmx_bool    bOK;
+    int         nread = 0;
+    start = Clock::now();
+    fio   = open_xtc(filename, "r");
+    while (read_next_xtc(fio, natoms, &step, &time, box, as_rvec_array(x.data()), &prec, &bOK))
+    {
+        nread++;
+    }
+    close_xtc(fio);
+    double readTime = millisecondsSince(start);
+
+    std::vector<gmx_int64_t>              steps(blockSize);
+    std::vector<real>                     times(blockSize), precs(blockSize);
+    matrix                               *boxes;
+    std::vector< std::vector<gmx::RVec> > blockX(blockSize, std::vector<gmx::RVec>(natoms));
+    std::vector<rvec *>                   xPointers;
+    for (auto &frameX : blockX)
+    {
+        xPointers.push_back(as_rvec_array(frameX.data()));
+    }
+    snew(boxes, blockSize);
+    int nreadBlocks = 0;
+    int count;
+    start = Clock::now();
+    fio   = open_xtc(filename, "r");
+    while ((count = read_next_xtc_frames(fio, natoms, blockSize, nthreads, steps.data(), times.data(),
+                                         boxes, xPointers.data(), precs.data())) > 0)
+    {
+        nreadBlocks += count;
+    }
+    close_xtc(fio);
+    double blockReadTime = millisecondsSince(start);
+    sfree(boxes);
+
+    std::printf("%d atoms, %d frames (%d and %d read back)\n", natoms, nframes, nread, nreadBlocks);
+    std::printf("write:                   %8.2f ms/frame\n", writeTime/nframes);
+    std::printf("read:                    %8.2f ms/frame\n", readTime/nframes);
+    std::printf("read with %2d threads:    %8.2f ms/frame\n", nthreads, blockReadTime/nframes);
+    std::remove(filename);
+
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the XTC frame-offset index and random trajectory access.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xtcindex.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/trxio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+class XtcFrameIndexTest : public ::testing::Test
+{
+    public:
+        XtcFrameIndexTest()
+        {
+            filename_ = fileManager_.getTemporaryFilePath("traj.xtc");
+            /* Makes the file manager remove the sidecar index file */
+            indexFilename_ = fileManager_.getTemporaryFilePath("traj.xtc.gmxidx");
+        }
+
+        //! Writes \p nframes frames of \p natoms atoms, starting at \p firstFrame.
+        void writeFrames(const char *mode, int natoms, int firstFrame, int nframes)
+        {
+            std::vector<gmx::RVec> x(natoms);
+            matrix                 box;
+            clear_mat(box);
+            box[XX][XX] = box[YY][YY] = box[ZZ][ZZ] = 3;
+
+            t_fileio *fio = open_xtc(filename_.c_str(), mode);
+            for (int frame = firstFrame; frame < firstFrame + nframes; frame++)
+            {
+                for (int i = 0; i < natoms; i++)
+                {
+                    /* Vary the content so the compressed size varies per frame */
+                    x[i][XX] = 0.1*i + 0.01*frame;
+                    x[i][YY] = 0.05*i*(frame % 3);
+                    x[i][ZZ] = 0.2*(i % 7);
+                }
+                write_xtc(fio, natoms, 10*frame, 0.5*frame, box,
+                          as_rvec_array(x.data()), 1000);
+            }
+            close_xtc(fio);
+        }
+
+        //! Builds an index for the test trajectory.
+        bool buildIndex(gmx::XtcFrameIndex *index, int natoms, bool bUseIndexFile)
+        {
+            t_fileio *fio = open_xtc(filename_.c_str(), "r");
+            bool      bOK = index->build(fio, natoms, bUseIndexFile);
+            close_xtc(fio);
+            return bOK;
+        }
+
+        //! Returns the size of the test trajectory.
+        gmx_off_t fileSize()
+        {
+            FILE     *fp = gmx_ffopen(filename_.c_str(), "rb");
+            gmx_fseek(fp, 0, SEEK_END);
+            gmx_off_t size = gmx_ftell(fp);
+            gmx_ffclose(fp);
+            return size;
+        }
+
+        gmx::test::TestFileManager fileManager_;
+        std::string                filename_;
+        std::string                indexFilename_;
+};
+
+TEST_F(XtcFrameIndexTest, IndexesAllFrames)
+{
+    writeFrames("w", 25, 0, 12);
+    gmx::XtcFrameIndex index;
+    ASSERT_TRUE(buildIndex(&index, 25, false));
+    ASSERT_EQ(12, index.frameCount());
+    EXPECT_EQ(0, index.frame(0).offset);
+    for (int i = 0; i < index.frameCount(); i++)
+    {
+        EXPECT_EQ(10*i, index.frame(i).step);
+        EXPECT_REAL_EQ_TOL(0.5*i, index.frame(i).time, gmx::test::defaultRealTolerance());
+        EXPECT_EQ(i, index.frameAtOffset(index.frame(i).offset));
+    }
+    EXPECT_EQ(fileSize(), index.endOffset());
+    EXPECT_EQ(4, index.findFrameAtTime(1.75));
+    EXPECT_EQ(12, index.findFrameAtTime(100));
+    EXPECT_EQ(-1, index.frameAtOffset(1));
+}
+
+TEST_F(XtcFrameIndexTest, HandlesUncompressedFrames)
+{
+    writeFrames("w", 5, 0, 4);
+    gmx::XtcFrameIndex index;
+    ASSERT_TRUE(buildIndex(&index, 5, false));
+    EXPECT_EQ(4, index.frameCount());
+}
+
+TEST_F(XtcFrameIndexTest, ReusesAndExtendsIndexFile)
+{
+    writeFrames("w", 25, 0, 6);
+    {
+        gmx::XtcFrameIndex index;
+        ASSERT_TRUE(buildIndex(&index, 25, true));
+        EXPECT_EQ(6, index.frameCount());
+    }
+    EXPECT_EQ(indexFilename_, gmx::XtcFrameIndex::indexFilename(filename_));
+    EXPECT_TRUE(gmx_fexist(indexFilename_.c_str()));
+    writeFrames("a", 25, 6, 4);
+    gmx::XtcFrameIndex index;
+    ASSERT_TRUE(buildIndex(&index, 25, true));
+    ASSERT_EQ(10, index.frameCount());
+    EXPECT_EQ(90, index.frame(9).step);
+}
+
+TEST_F(XtcFrameIndexTest, SeeksInTrajectory)
+{
+    writeFrames("w", 25, 0, 10);
+
+    gmx_output_env_t *oenv;
+    output_env_init_default(&oenv);
+    t_trxstatus      *status;
+    t_trxframe        fr;
+    ASSERT_TRUE(read_first_frame(oenv, &status, filename_.c_str(), &fr, TRX_NEED_X));
+    EXPECT_EQ(10, trx_get_number_of_frames(status));
+
+    ASSERT_TRUE(trx_seek_frame(status, 7));
+    ASSERT_TRUE(read_next_frame(oenv, status, &fr));
+    EXPECT_EQ(70, fr.step);
+    ASSERT_TRUE(read_next_frame(oenv, status, &fr));
+    EXPECT_EQ(80, fr.step);
+
+    ASSERT_TRUE(trx_seek_time(status, 1.0));
+    ASSERT_TRUE(read_next_frame(oenv, status, &fr));
+    EXPECT_EQ(20, fr.step);
+
+    EXPECT_FALSE(trx_seek_frame(status, 10));
+    EXPECT_FALSE(trx_seek_time(status, 10.0));
+
+    close_trx(status);
+    sfree(fr.x);
+    output_env_done(oenv);
+}
+
+} // namespace
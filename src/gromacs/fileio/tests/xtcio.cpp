@@ -0,0 +1,449 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for XTC coordinate compression and parallel frame reading.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xtcio.h"
+
+#include <cstdint>
+#include <cstdio>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/xdrf.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+/*! \brief
+ * Compressed size and FNV-1a hash of the output of xdr3dfcoord for
+ * the test cases, as written by the original implementation.
+ *
+ * The original implementation read past the end of the table of sizes
+ * for case 2, so its reference is that of the corrected coder.
+ */
+struct CompressedReference
+{
+    //! Size of the output in bytes.
+    size_t        size;
+    //! Hash of the output.
+    std::uint64_t hash;
+};
+
+//! Reference values for the cases of makeCoordinates().
+const CompressedReference c_reference[] = {
+    { 148, 0x031397af67fada69ULL },
+    { 132, 0x156ea00a329cd3acULL },
+    { 152, 0xb461ad6d719b0438ULL },
+    { 64, 0xc8073767e6f14127ULL },
+    { 724, 0x2d67c08f0c723c95ULL }
+};
+
+/*! \brief
+ * Returns the coordinates for test case \p testCase.
+ *
+ * The cases cover water-like runs of small differences, ranges that
+ * need the large-size encoding, ranges that need more than 64 bits per
+ * atom, uncompressed frames and varying precision.
+ */
+std::vector<float> makeCoordinates(int testCase, float *precision)
+{
+    std::vector<float> x;
+    *precision = 1000;
+    switch (testCase)
+    {
+        case 0:
+            for (int m = 0; m < 10; m++)
+            {
+                float o[3] = { 0.3f*m, 0.2f*(m % 3), 0.1f*(m % 5) };
+                x.insert(x.end(), { o[0], o[1], o[2] });
+                x.insert(x.end(), { o[0] + 0.1f, o[1], o[2] });
+                x.insert(x.end(), { o[0] - 0.03f, o[1] + 0.09f, o[2] });
+            }
+            break;
+        case 1:
+            for (int i = 0; i < 12; i++)
+            {
+                x.insert(x.end(), { 2000.0f*i, 0.5f*i, -1.0f*i });
+            }
+            break;
+        case 2:
+            for (int i = 0; i < 12; i++)
+            {
+                x.insert(x.end(), { 1300.0f*i, 1300.0f*(11 - i), 4000.0f*(i % 4) });
+            }
+            break;
+        case 3:
+            for (int i = 0; i < 5; i++)
+            {
+                x.insert(x.end(), { 0.5f*i, 1.5f, -0.25f*i });
+            }
+            break;
+        case 4:
+        {
+            std::uint32_t seed = 12345;
+            for (int i = 0; i < 3*200; i++)
+            {
+                seed = seed*1103515245u + 12345u;
+                int scale = (i/30) % 3 == 0 ? 100 : 10000;
+                x.push_back(static_cast<float>((seed >> 8) % scale)*0.001f);
+            }
+            *precision = 100;
+            break;
+        }
+    }
+    return x;
+}
+
+//! Returns the contents of file \p filename.
+std::vector<char> readFileContents(const std::string &filename)
+{
+    FILE             *fp = gmx_ffopen(filename.c_str(), "rb");
+    std::vector<char> data;
+    int               c;
+    while ((c = fgetc(fp)) != EOF)
+    {
+        data.push_back(static_cast<char>(c));
+    }
+    gmx_ffclose(fp);
+    return data;
+}
+
+//! Writes \p data to file \p filename.
+void writeFileContents(const std::string &filename, const std::vector<char> &data)
+{
+    FILE *fp = gmx_ffopen(filename.c_str(), "wb");
+    fwrite(data.data(), 1, data.size(), fp);
+    gmx_ffclose(fp);
+}
+
+//! Returns the big-endian XDR integer at \p pos in \p data.
+int getXdrInt(const std::vector<char> &data, size_t pos)
+{
+    unsigned int value = 0;
+    for (int b = 0; b < 4; b++)
+    {
+        value = (value << 8) | static_cast<unsigned char>(data[pos + b]);
+    }
+    return static_cast<int>(value);
+}
+
+//! Stores \p value as big-endian XDR integer at \p pos in \p data.
+void setXdrInt(std::vector<char> *data, size_t pos, int value)
+{
+    for (int b = 0; b < 4; b++)
+    {
+        (*data)[pos + b] = static_cast<char>(static_cast<unsigned int>(value) >> (24 - 8*b));
+    }
+}
+
+class XtcCompressionTest : public ::testing::TestWithParam<int>
+{
+    public:
+        XtcCompressionTest()
+        {
+            filename_ = fileManager_.getTemporaryFilePath("coords.xdr");
+        }
+
+        //! Returns the contents of the test file.
+        std::vector<char> readFile()
+        {
+            return readFileContents(filename_);
+        }
+
+        gmx::test::TestFileManager fileManager_;
+        std::string                filename_;
+};
+
+TEST_P(XtcCompressionTest, MatchesReferenceAndRoundTrips)
+{
+    float              precision;
+    std::vector<float> x      = makeCoordinates(GetParam(), &precision);
+    int                natoms = x.size()/DIM;
+
+    FILE              *fp = gmx_ffopen(filename_.c_str(), "wb");
+    XDR                xdr;
+    xdrstdio_create(&xdr, fp, XDR_ENCODE);
+    ASSERT_EQ(1, xdr3dfcoord(&xdr, x.data(), &natoms, &precision));
+    xdr_destroy(&xdr);
+    gmx_ffclose(fp);
+
+    std::vector<char> data = readFile();
+    std::uint64_t     hash = 14695981039346656037ULL;
+    for (char c : data)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    EXPECT_EQ(c_reference[GetParam()].size, data.size());
+    EXPECT_EQ(c_reference[GetParam()].hash, hash);
+
+    std::vector<float> y(x.size());
+    int                n = 0;
+    float              readPrecision;
+    fp = gmx_ffopen(filename_.c_str(), "rb");
+    xdrstdio_create(&xdr, fp, XDR_DECODE);
+    ASSERT_EQ(1, xdr3dfcoord(&xdr, y.data(), &n, &readPrecision));
+    xdr_destroy(&xdr);
+    gmx_ffclose(fp);
+    ASSERT_EQ(natoms, n);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        EXPECT_NEAR(x[i], y[i], (natoms <= 9 ? 0 : 0.5/precision) + 1e-6*std::abs(x[i]));
+    }
+
+    std::vector<float> z(x.size());
+    n = 0;
+    EXPECT_EQ(data.size(), xdr3dfcoord_from_buffer(data.data(), data.size(), z.data(), &n, &readPrecision));
+    ASSERT_EQ(natoms, n);
+    EXPECT_EQ(y, z);
+    n = 0;
+    EXPECT_EQ(0U, xdr3dfcoord_from_buffer(data.data(), data.size() - 8, z.data(), &n, &readPrecision));
+}
+
+INSTANTIATE_TEST_CASE_P(WithDifferentCoordinates, XtcCompressionTest,
+                        ::testing::Range(0, 5));
+
+TEST(XtcLargeDifferenceTest, RoundTripsWithLargestIndex)
+{
+    gmx::test::TestFileManager fileManager;
+    std::string                filename  = fileManager.getTemporaryFilePath("large.xtc");
+    const int                  natoms    = 53;
+    const int                  nframes   = 200;
+    const real                 precision = 1e5;
+    std::vector< std::vector<gmx::RVec> > refX(nframes, std::vector<gmx::RVec>(natoms));
+    matrix                     box;
+    clear_mat(box);
+    box[XX][XX] = box[YY][YY] = box[ZZ][ZZ] = 1000;
+
+    /* The first frame alternates between opposite corners, so all
+     * differences between consecutive atoms need the largest index.
+     * The other frames are random and only occasionally do so.
+     */
+    std::uint32_t seed = 4321;
+    t_fileio     *fio  = open_xtc(filename.c_str(), "w");
+    for (int frame = 0; frame < nframes; frame++)
+    {
+        for (int i = 0; i < natoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                seed = seed*1103515245u + 12345u;
+                if (frame == 0)
+                {
+                    refX[frame][i][d] = (i % 2)*1000;
+                }
+                else
+                {
+                    refX[frame][i][d] = static_cast<real>((seed >> 8) % 1000000)*0.001;
+                }
+            }
+        }
+        write_xtc(fio, natoms, frame, frame, box, as_rvec_array(refX[frame].data()), precision);
+    }
+    close_xtc(fio);
+
+    std::vector<gmx::RVec> x(natoms);
+    fio = open_xtc(filename.c_str(), "r");
+    for (int frame = 0; frame < nframes; frame++)
+    {
+        gmx_int64_t step;
+        real        time, prec;
+        gmx_bool    bOK;
+        matrix      readBox;
+        ASSERT_TRUE(read_next_xtc(fio, natoms, &step, &time, readBox,
+                                  as_rvec_array(x.data()), &prec, &bOK)) << "frame " << frame;
+        for (int i = 0; i < natoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_NEAR(refX[frame][i][d], x[i][d], 0.5/precision + 1e-6*refX[frame][i][d]);
+            }
+        }
+    }
+    close_xtc(fio);
+
+    std::vector<gmx_int64_t>              step(nframes);
+    std::vector<real>                     time(nframes), prec(nframes);
+    matrix                               *boxes;
+    std::vector< std::vector<gmx::RVec> > blockX(nframes, std::vector<gmx::RVec>(natoms));
+    std::vector<rvec *>                   xPointers;
+    for (auto &frameX : blockX)
+    {
+        xPointers.push_back(as_rvec_array(frameX.data()));
+    }
+    snew(boxes, nframes);
+    fio = open_xtc(filename.c_str(), "r");
+    EXPECT_EQ(nframes, read_next_xtc_frames(fio, natoms, nframes, 4, step.data(), time.data(),
+                                            boxes, xPointers.data(), prec.data()));
+    close_xtc(fio);
+    for (int frame = 0; frame < nframes; frame++)
+    {
+        for (int i = 0; i < natoms; i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_NEAR(refX[frame][i][d], blockX[frame][i][d], 0.5/precision + 1e-6*refX[frame][i][d]);
+            }
+        }
+    }
+
+    /* Older versions wrote the first frame with an initial index one
+     * past the largest one written now. Without runs of small differences
+     * this does not change the rest of the data, so the frame with the
+     * index incremented should be read unchanged.
+     */
+    std::vector<gmx::RVec> x0           = blockX[0];
+    std::vector<char>      data         = readFileContents(filename);
+    const size_t           smallIdxPos  = 84;
+    const size_t           byteCountPos = 88;
+    ASSERT_EQ(72, getXdrInt(data, smallIdxPos));
+    data.resize(byteCountPos + 4 + (getXdrInt(data, byteCountPos) + 3)/4*4);
+    setXdrInt(&data, smallIdxPos, 73);
+    writeFileContents(filename, data);
+    fio = open_xtc(filename.c_str(), "r");
+    EXPECT_EQ(1, read_next_xtc_frames(fio, natoms, 1, 1, step.data(), time.data(),
+                                      boxes, xPointers.data(), prec.data()));
+    close_xtc(fio);
+    for (int i = 0; i < natoms; i++)
+    {
+        EXPECT_EQ(x0[i][XX], blockX[0][i][XX]);
+        EXPECT_EQ(x0[i][YY], blockX[0][i][YY]);
+        EXPECT_EQ(x0[i][ZZ], blockX[0][i][ZZ]);
+    }
+
+    /* A compressed size beyond the end of the file is rejected */
+    setXdrInt(&data, byteCountPos, 0x7fffffff);
+    writeFileContents(filename, data);
+    fio = open_xtc(filename.c_str(), "r");
+    EXPECT_EQ(0, read_next_xtc_frames(fio, natoms, 1, 1, step.data(), time.data(),
+                                      boxes, xPointers.data(), prec.data()));
+    close_xtc(fio);
+    sfree(boxes);
+}
+
+TEST(XtcFrameReadingTest, ReadsFrameBlocksInParallel)
+{
+    gmx::test::TestFileManager fileManager;
+    std::string                filename = fileManager.getTemporaryFilePath("frames.xtc");
+    const int                  natoms   = 40;
+    const int                  nframes  = 9;
+    std::vector<gmx::RVec>     x(natoms);
+    matrix                     box;
+    clear_mat(box);
+    box[XX][XX] = box[YY][YY] = box[ZZ][ZZ] = 4;
+
+    t_fileio *fio = open_xtc(filename.c_str(), "w");
+    for (int frame = 0; frame < nframes; frame++)
+    {
+        for (int i = 0; i < natoms; i++)
+        {
+            x[i][XX] = 0.1*i + 0.01*frame;
+            x[i][YY] = 0.05*i*(frame % 3);
+            x[i][ZZ] = 0.2*(i % 7);
+        }
+        write_xtc(fio, natoms, 10*frame, 0.5*frame, box, as_rvec_array(x.data()), 1000);
+    }
+    close_xtc(fio);
+
+    /* Read all frames one at a time as reference */
+    std::vector< std::vector<gmx::RVec> > refX(nframes, std::vector<gmx::RVec>(natoms));
+    fio = open_xtc(filename.c_str(), "r");
+    for (int frame = 0; frame < nframes; frame++)
+    {
+        gmx_int64_t step;
+        real        time, prec;
+        gmx_bool    bOK;
+        matrix      readBox;
+        ASSERT_TRUE(read_next_xtc(fio, natoms, &step, &time, readBox,
+                                  as_rvec_array(refX[frame].data()), &prec, &bOK));
+    }
+    close_xtc(fio);
+
+    const int                             maxFrames = 6;
+    std::vector<gmx_int64_t>              step(maxFrames);
+    std::vector<real>                     time(maxFrames), prec(maxFrames);
+    matrix                               *boxes;
+    std::vector< std::vector<gmx::RVec> > blockX(maxFrames, std::vector<gmx::RVec>(natoms));
+    std::vector<rvec *>                   xPointers;
+    for (auto &frameX : blockX)
+    {
+        xPointers.push_back(as_rvec_array(frameX.data()));
+    }
+
+    snew(boxes, maxFrames);
+    fio = open_xtc(filename.c_str(), "r");
+    int firstFrame = 0;
+    for (int expectedCount : { maxFrames, nframes - maxFrames, 0 })
+    {
+        int count = read_next_xtc_frames(fio, natoms, maxFrames, 4, step.data(), time.data(),
+                                         boxes,
+                                         xPointers.data(), prec.data());
+        ASSERT_EQ(expectedCount, count);
+        for (int f = 0; f < count; f++)
+        {
+            int frame = firstFrame + f;
+            EXPECT_EQ(10*frame, step[f]);
+            EXPECT_REAL_EQ_TOL(0.5*frame, time[f], gmx::test::defaultRealTolerance());
+            EXPECT_EQ(box[XX][XX], boxes[f][XX][XX]);
+            EXPECT_REAL_EQ_TOL(1000, prec[f], gmx::test::defaultRealTolerance());
+            for (int i = 0; i < natoms; i++)
+            {
+                EXPECT_EQ(refX[frame][i][XX], blockX[f][i][XX]);
+                EXPECT_EQ(refX[frame][i][YY], blockX[f][i][YY]);
+                EXPECT_EQ(refX[frame][i][ZZ], blockX[f][i][ZZ]);
+            }
+        }
+        firstFrame += count;
+    }
+    close_xtc(fio);
+    sfree(boxes);
+}
+
+} // namespace
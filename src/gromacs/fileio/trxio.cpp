@@ -42,8 +42,11 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
+
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/filetypes.h"
@@ -58,6 +61,7 @@
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trrio.h"
 #include "gromacs/fileio/xdrf.h"
+#include "gromacs/fileio/xtcindex.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/md_enums.h"
@@ -68,6 +72,7 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 #if GMX_USE_PLUGINS
@@ -79,6 +84,23 @@
 #define SKIP2  100
 #define SKIP3 1000
 
+/* The maximum memory used for XTC frames decoded ahead, in bytes */
+static const size_t c_xtcBlockMaxBytes = 64*1024*1024;
+
+/* XTC frames decoded ahead in parallel with read_next_xtc_frames */
+struct t_xtcblock
+{
+    int          maxFrames; /* the number of frames allocated          */
+    int          natoms;    /* the number of atoms allocated per frame */
+    int          nframes;   /* the number of frames decoded            */
+    int          next;      /* the next frame to return                */
+    gmx_int64_t *step;
+    real        *time;
+    matrix      *box;
+    rvec       **x;
+    real        *prec;
+};
+
 struct t_trxstatus
 {
     int                     flags;            /* flags for read_first/next_frame  */
@@ -93,6 +115,9 @@ struct t_trxstatus
     double                  DT, BOX[3];
     gmx_bool                bReadBox;
     char                   *persistent_line; /* Persistent line for reading g96 trajectories */
+    gmx::XtcFrameIndex     *xtcIndex;        /* Frame offsets for random access in XTC files */
+    gmx_bool                bXtcIndexTried;  /* Whether we tried to build xtcIndex */
+    t_xtcblock             *xtcBlock;        /* XTC frames decoded ahead, or NULL */
 #if GMX_USE_PLUGINS
     gmx_vmdplugin_t        *vmdplugin;
 #endif
@@ -175,6 +200,39 @@ static void status_init(t_trxstatus *status)
     status->tf              = 0;
     status->persistent_line = nullptr;
     status->tng             = nullptr;
+    status->xtcIndex        = nullptr;
+    status->bXtcIndexTried  = FALSE;
+    status->xtcBlock        = nullptr;
+}
+
+static void free_xtc_block(t_xtcblock *block)
+{
+    if (block == nullptr)
+    {
+        return;
+    }
+    for (int f = 0; f < block->maxFrames; f++)
+    {
+        sfree(block->x[f]);
+    }
+    sfree(block->step);
+    sfree(block->time);
+    sfree(block->box);
+    sfree(block->x);
+    sfree(block->prec);
+    sfree(block);
+}
+
+/* Discards the XTC frames that were decoded ahead, needed when
+ * the file position is changed.
+ */
+static void clear_xtc_block(t_trxstatus *status)
+{
+    if (status->xtcBlock != nullptr)
+    {
+        status->xtcBlock->nframes = 0;
+        status->xtcBlock->next    = 0;
+    }
 }
 
 
@@ -629,6 +687,8 @@ void close_trx(t_trxstatus *status)
     {
         gmx_fio_close(status->fio);
     }
+    delete status->xtcIndex;
+    free_xtc_block(status->xtcBlock);
     sfree(status);
 }
 
@@ -647,6 +707,94 @@ t_trxstatus *open_trx(const char *outfile, const char *filemode)
     return stat;
 }
 
+/* Reads the next frame with readFrame(), which reads from fio through
+ * XDR, decoding directly from the memory-mapped file when possible.
+ */
+template <typename ReadFrameFunction>
+static gmx_bool read_next_xdr_frame(t_fileio *fio, ReadFrameFunction readFrame)
+{
+    gmx_bool bMapped = gmx_fio_begin_mapped_read(fio);
+    gmx_bool bRet    = readFrame();
+    if (bMapped)
+    {
+        gmx_fio_end_mapped_read(fio);
+    }
+    return bRet;
+}
+
+/* Returns the number of OpenMP threads to decode XTC frames with,
+ * when it is worth decoding frames ahead in parallel, 0 otherwise.
+ */
+static int xtc_block_thread_count()
+{
+    if (getenv("GMX_NO_PARALLEL_XTC_READ") != nullptr)
+    {
+        return 0;
+    }
+    int nthreads = gmx_omp_get_max_threads();
+
+    return (nthreads > 1) ? nthreads : 0;
+}
+
+/* Reads the next XTC frame into fr from the block of frames decoded
+ * ahead, decoding the next block in parallel with nthreads threads when
+ * all frames of the block have been used.
+ * Returns FALSE when no frame could be decoded in parallel, the next
+ * frame should then be read with read_next_xtc.
+ */
+static gmx_bool xtc_next_frame_from_block(t_trxstatus *status, t_trxframe *fr,
+                                          int nthreads)
+{
+    t_xtcblock *block = status->xtcBlock;
+
+    if (block == nullptr)
+    {
+        /* Decode a few frames per thread, but limit the memory usage */
+        size_t frameBytes = std::max(fr->natoms, 1)*sizeof(rvec);
+        int    maxFrames  = static_cast<int>(std::min<size_t>(4*nthreads, c_xtcBlockMaxBytes/frameBytes));
+        if (maxFrames < 2)
+        {
+            return FALSE;
+        }
+
+        snew(block, 1);
+        block->maxFrames = maxFrames;
+        block->natoms    = fr->natoms;
+        snew(block->step, maxFrames);
+        snew(block->time, maxFrames);
+        snew(block->box, maxFrames);
+        snew(block->x, maxFrames);
+        snew(block->prec, maxFrames);
+        for (int f = 0; f < maxFrames; f++)
+        {
+            snew(block->x[f], block->natoms);
+        }
+        status->xtcBlock = block;
+    }
+    GMX_RELEASE_ASSERT(block->natoms == fr->natoms, "The number of atoms should not change");
+
+    if (block->next == block->nframes)
+    {
+        block->nframes = read_next_xtc_frames(status->fio, block->natoms, block->maxFrames, nthreads,
+                                              block->step, block->time, block->box,
+                                              block->x, block->prec);
+        block->next    = 0;
+        if (block->nframes == 0)
+        {
+            return FALSE;
+        }
+    }
+
+    int f = block->next++;
+    fr->step = block->step[f];
+    fr->time = block->time[f];
+    copy_mat(block->box[f], fr->box);
+    std::memcpy(fr->x, block->x[f], block->natoms*sizeof(rvec));
+    fr->prec = block->prec[f];
+
+    return TRUE;
+}
+
 static gmx_bool gmx_next_frame(t_trxstatus *status, t_trxframe *fr)
 {
     gmx_trr_header_t sh;
@@ -802,6 +950,123 @@ static int pdb_first_x(t_trxstatus *status, FILE *fp, t_trxframe *fr)
     return fr->natoms;
 }
 
+/* Returns the frame-offset index of an XTC trajectory, building it on
+ * first use, or NULL when the file does not support random access.
+ */
+static gmx::XtcFrameIndex *trx_get_xtc_index(t_trxstatus *status, int natoms)
+{
+    if (!status->bXtcIndexTried)
+    {
+        status->bXtcIndexTried = TRUE;
+        if (status->fio != nullptr && gmx_fio_getftp(status->fio) == efXTC)
+        {
+            bool bUseIndexFile = (getenv("GMX_NO_XTC_INDEX_FILE") == nullptr);
+
+            status->xtcIndex = new gmx::XtcFrameIndex;
+            if (!status->xtcIndex->build(status->fio, natoms, bUseIndexFile))
+            {
+                delete status->xtcIndex;
+                status->xtcIndex = nullptr;
+            }
+        }
+    }
+    return status->xtcIndex;
+}
+
+/* Uses the XTC frame index to jump over all frames that check_times2()
+ * would reject, so that their coordinates are never decoded.
+ * Returns FALSE when no index is available.
+ */
+static gmx_bool xtc_skip_unwanted_frames(t_trxstatus *status, t_trxframe *fr)
+{
+    gmx::XtcFrameIndex *index = trx_get_xtc_index(status, fr->natoms);
+    int                 next, frame, nskipped;
+    gmx_bool            bBeforeBegin;
+
+    if (index == nullptr)
+    {
+        return FALSE;
+    }
+    /* When we are past the indexed frames, e.g. because the file is still
+     * being written, we simply continue reading sequentially.
+     */
+    next = index->frameAtOffset(gmx_fio_ftell(status->fio));
+    if (next < 0)
+    {
+        return TRUE;
+    }
+
+    bBeforeBegin = FALSE;
+    nskipped     = 0;
+    for (frame = next; frame < index->frameCount(); frame++)
+    {
+        real t = index->frame(frame).time;
+
+        if (bTimeSet(TBEGIN) && t < rTimeValue(TBEGIN))
+        {
+            /* As with xtc_seek_time, frames before -b are not counted */
+            bBeforeBegin = TRUE;
+            nskipped     = 0;
+            continue;
+        }
+        if ((status->flags & TRX_DONT_SKIP) ||
+            check_times2(t, status->t0, fr->bDouble) >= 0)
+        {
+            break;
+        }
+        nskipped++;
+    }
+    if (frame > next)
+    {
+        gmx_fio_seek(status->fio, frame < index->frameCount() ?
+                     index->frame(frame).offset : index->endOffset());
+        if (bBeforeBegin)
+        {
+            initcount(status);
+        }
+        status->__frame += nskipped;
+    }
+
+    return TRUE;
+}
+
+int trx_get_number_of_frames(t_trxstatus *status)
+{
+    gmx::XtcFrameIndex *index = trx_get_xtc_index(status, status->natoms);
+
+    return (index != nullptr) ? index->frameCount() : -1;
+}
+
+gmx_bool trx_seek_frame(t_trxstatus *status, int frame)
+{
+    gmx::XtcFrameIndex *index = trx_get_xtc_index(status, status->natoms);
+
+    if (index == nullptr || frame < 0 || frame >= index->frameCount())
+    {
+        return FALSE;
+    }
+    if (gmx_fio_seek(status->fio, index->frame(frame).offset) != 0)
+    {
+        return FALSE;
+    }
+    /* Only drop the frames read ahead once the position has changed */
+    clear_xtc_block(status);
+    status->__frame = frame - 1;
+
+    return TRUE;
+}
+
+gmx_bool trx_seek_time(t_trxstatus *status, real t)
+{
+    gmx::XtcFrameIndex *index = trx_get_xtc_index(status, status->natoms);
+
+    if (index == nullptr)
+    {
+        return FALSE;
+    }
+    return trx_seek_frame(status, index->findFrameAtTime(t));
+}
+
 gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_trxframe *fr)
 {
     real     pt;
@@ -828,7 +1093,7 @@ gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_tr
         switch (ftp)
         {
             case efTRR:
-                bRet = gmx_next_frame(status, fr);
+                bRet = read_next_xdr_frame(status->fio, [&]() { return gmx_next_frame(status, fr); });
                 break;
             case efCPT:
                 /* Checkpoint files can not contain mulitple frames */
@@ -845,7 +1110,12 @@ gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_tr
                 break;
             }
             case efXTC:
-                if (bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)))
+            {
+                gmx_bool bSeekBegin = (bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)));
+                gmx_bool bSkipDelta = (bTimeSet(TDELTA) && !(status->flags & TRX_DONT_SKIP));
+
+                if ((bSeekBegin || bSkipDelta) &&
+                    !xtc_skip_unwanted_frames(status, fr) && bSeekBegin)
                 {
                     if (xtc_seek_time(status->fio, rTimeValue(TBEGIN), fr->natoms, TRUE))
                     {
@@ -854,8 +1124,25 @@ gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_tr
                     }
                     initcount(status);
                 }
-                bRet = read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box,
-                                     fr->x, &fr->prec, &bOK);
+
+                /* When frames are read sequentially, decode several frames
+                 * ahead in parallel. The skipping above uses the file
+                 * position, so then we read one frame at a time.
+                 */
+                int nthreads = (bSeekBegin || bSkipDelta) ? 0 : xtc_block_thread_count();
+                bOK          = TRUE;
+                if (nthreads > 0 && xtc_next_frame_from_block(status, fr, nthreads))
+                {
+                    bRet = TRUE;
+                }
+                else
+                {
+                    bRet = read_next_xdr_frame(status->fio, [&]()
+                                               {
+                                                   return read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box,
+                                                                        fr->x, &fr->prec, &bOK);
+                                               });
+                }
                 fr->bPrec = (bRet && fr->prec > 0);
                 fr->bStep = bRet;
                 fr->bTime = bRet;
@@ -868,6 +1155,7 @@ gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_tr
                     fr->not_ok = DATA_NOT_OK;
                 }
                 break;
+            }
             case efTNG:
                 bRet = gmx_read_next_tng_frame(status->tng, fr, nullptr, 0);
                 break;
@@ -1134,12 +1422,15 @@ void close_trj(t_trxstatus *status)
      * but the read_first_x/read_next_x functions are deprecated anyhow.
      * read_first_frame/read_next_frame and close_trx should be used.
      */
+    delete status->xtcIndex;
+    free_xtc_block(status->xtcBlock);
     sfree(status);
 }
 
 void rewind_trj(t_trxstatus *status)
 {
     initcount(status);
+    clear_xtc_block(status);
 
     gmx_fio_rewind(status->fio);
 }
@@ -145,6 +145,32 @@ struct t_fileio *trx_get_fileio(t_trxstatus *status);
 float trx_get_time_of_final_frame(t_trxstatus *status);
 /* get time of final frame. Only supported for TNG and XTC */
 
+/* The functions below provide random access to trajectories opened with
+ * read_first_frame. They are only supported for XTC files, for which
+ * a frame-offset index is built on first use. The index is stored in
+ * a sidecar file next to the trajectory and reused by later tools as long
+ * as the size and modification time of the trajectory do not change,
+ * unless the environment variable GMX_NO_XTC_INDEX_FILE is set.
+ * Reading with -b and -dt uses the same index to avoid decoding the
+ * coordinates of frames that are skipped.
+ */
+
+int trx_get_number_of_frames(t_trxstatus *status);
+/* Returns the number of complete frames in the trajectory,
+ * or -1 when random access is not supported for this file.
+ */
+
+gmx_bool trx_seek_frame(t_trxstatus *status, int frame);
+/* Positions the trajectory such that the next call to read_next_frame
+ * reads frame number frame, counting from 0 at the start of the file.
+ * Time control set through timecontrol.h still applies to that call.
+ * Returns FALSE, without changing the position, when random access is
+ * not supported or the frame does not exist.
+ */
+
+gmx_bool trx_seek_time(t_trxstatus *status, real t);
+/* As trx_seek_frame, but seeks to the first frame with time >= t. */
+
 gmx_bool bRmod_fd(double a, double b, double c, gmx_bool bDouble);
 /* Returns TRUE when (a - b) MOD c = 0, using a margin which is slightly
  * larger than the float/double precision.
@@ -63,6 +63,17 @@ extern "C" {
 int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision);
 
 
+/* Decompress coordinates from a memory buffer that contains the data written
+ * by xdr3dfcoord, with the same meaning of the arguments as for reading with
+ * xdr3dfcoord. Returns the number of bytes used from buffer, or 0 when the
+ * buffer is too short or the data is corrupt. Since this does not need
+ * an XDR stream, different threads can decompress different frames
+ * concurrently.
+ */
+size_t xdr3dfcoord_from_buffer(const char *buffer, size_t bufferSize,
+                               float *fp, int *size, float *precision);
+
+
 /* Read or write a *real* value (stored as float) */
 int xdr_real(XDR *xdrs, real *r);
 
@@ -0,0 +1,387 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::XtcFrameIndex.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "xtcindex.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/gmxfio-xdr.h"
+#include "gromacs/fileio/xdrf.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/fatalerror.h"
+
+/* Must match definition in xtcio.cpp */
+#ifndef XTC_MAGIC
+#define XTC_MAGIC 1995
+#endif
+
+/* Must match definition in libxdrf.cpp */
+#define XDR_INT_SIZE 4
+
+namespace gmx
+{
+
+namespace
+{
+
+/*! \brief
+ * Byte offsets of the fields in an XTC frame, relative to the frame start.
+ *
+ * A frame consists of magic, natoms, step and time (4 bytes each), the
+ * box (9 floats), and the output of xdr3dfcoord(). The latter starts with
+ * the number of atoms; for up to 9 atoms the coordinates follow as plain
+ * floats, otherwise the precision, minint[3], maxint[3] and smallidx come
+ * before the byte count of the compressed data, which is padded to a
+ * multiple of 4 bytes.
+ */
+//! \{
+const gmx_off_t c_xtcCoordinateCountOffset = 13*XDR_INT_SIZE;
+const gmx_off_t c_xtcUncompressedOffset    = 14*XDR_INT_SIZE;
+const gmx_off_t c_xtcByteCountOffset       = 22*XDR_INT_SIZE;
+const gmx_off_t c_xtcCompressedOffset      = 23*XDR_INT_SIZE;
+const int       c_xtcMaxUncompressedAtoms  = 9;
+//! \}
+
+//! Identifies a sidecar index file, including its format version.
+const char        c_indexFileMagic[]  = "GMXXTCIDX1";
+//! Written in native byte order to detect files from other architectures.
+const gmx_int32_t c_indexFileByteOrder = 0x01020304;
+
+/*! \brief
+ * Reads the header of the XTC frame starting at \p offset.
+ *
+ * Returns false when no complete frame with \p natoms atoms starts at
+ * \p offset within the first \p fileSize bytes of the file.
+ * On success, \p nextOffset is set to the start of the following frame.
+ */
+bool readFrameHeader(FILE *fp, XDR *xd, gmx_off_t offset, int natoms,
+                     gmx_int64_t fileSize,
+                     XtcFrameIndex::Frame *frame, gmx_off_t *nextOffset)
+{
+    int   magic, n, step, size;
+    float time;
+
+    if (gmx_fseek(fp, offset, SEEK_SET) != 0 ||
+        !xdr_int(xd, &magic) || magic != XTC_MAGIC ||
+        !xdr_int(xd, &n) || n != natoms ||
+        !xdr_int(xd, &step) ||
+        !xdr_float(xd, &time))
+    {
+        return false;
+    }
+    if (gmx_fseek(fp, offset + c_xtcCoordinateCountOffset, SEEK_SET) != 0 ||
+        !xdr_int(xd, &size) || size != natoms)
+    {
+        return false;
+    }
+    gmx_off_t next;
+    if (size <= c_xtcMaxUncompressedAtoms)
+    {
+        next = offset + c_xtcUncompressedOffset + size*DIM*XDR_INT_SIZE;
+    }
+    else
+    {
+        int byteCount;
+        if (gmx_fseek(fp, offset + c_xtcByteCountOffset, SEEK_SET) != 0 ||
+            !xdr_int(xd, &byteCount) || byteCount < 0)
+        {
+            return false;
+        }
+        next = offset + c_xtcCompressedOffset
+            + ((byteCount + XDR_INT_SIZE - 1)/XDR_INT_SIZE)*XDR_INT_SIZE;
+    }
+    if (next > fileSize)
+    {
+        /* Truncated frame, e.g. from a crashed or running simulation */
+        return false;
+    }
+    frame->offset = offset;
+    frame->step   = step;
+    frame->time   = time;
+    *nextOffset   = next;
+
+    return true;
+}
+
+//! Reads a single value of type \p T in native format.
+template <typename T>
+bool readValue(FILE *fp, T *value)
+{
+    return std::fread(value, sizeof(T), 1, fp) == 1;
+}
+
+//! Writes a single value of type \p T in native format.
+template <typename T>
+bool writeValue(FILE *fp, const T &value)
+{
+    return std::fwrite(&value, sizeof(T), 1, fp) == 1;
+}
+
+}   // namespace
+
+// static
+std::string XtcFrameIndex::indexFilename(const std::string &trajectoryFilename)
+{
+    return trajectoryFilename + ".gmxidx";
+}
+
+XtcFrameIndex::XtcFrameIndex()
+    : endOffset_(0), fileSize_(-1), fileTime_(-1)
+{
+}
+
+int XtcFrameIndex::frameAtOffset(gmx_off_t offset) const
+{
+    auto it = std::lower_bound(frames_.begin(), frames_.end(), offset,
+                               [](const Frame &f, gmx_off_t o) { return f.offset < o; });
+    if (it == frames_.end() || it->offset != offset)
+    {
+        return -1;
+    }
+    return static_cast<int>(it - frames_.begin());
+}
+
+int XtcFrameIndex::findFrameAtTime(real time, int firstFrame) const
+{
+    /* Frame times need not be monotonic, e.g. for concatenated
+     * trajectories, so we can not use a binary search here.
+     */
+    for (int i = firstFrame; i < frameCount(); i++)
+    {
+        if (frames_[i].time >= time)
+        {
+            return i;
+        }
+    }
+    return frameCount();
+}
+
+bool XtcFrameIndex::scanFrames(t_fileio *fio, int natoms)
+{
+    FILE     *fp = gmx_fio_getfp(fio);
+    XDR      *xd = gmx_fio_getxdr(fio);
+    Frame     frame;
+    gmx_off_t offset = endOffset_;
+    gmx_off_t next;
+
+    if (fp == nullptr || xd == nullptr)
+    {
+        return false;
+    }
+    while (readFrameHeader(fp, xd, offset, natoms, fileSize_, &frame, &next))
+    {
+        frames_.push_back(frame);
+        offset = next;
+    }
+    endOffset_ = offset;
+
+    return true;
+}
+
+bool XtcFrameIndex::readIndexFile(const std::string &filename, int natoms,
+                                  gmx_int64_t fileSize, gmx_int64_t fileTime)
+{
+    FILE *fp = std::fopen(filename.c_str(), "rb");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+
+    char        magic[sizeof(c_indexFileMagic)];
+    gmx_int32_t byteOrder, storedNatoms;
+    gmx_int64_t nframes;
+    bool        bOK =
+        std::fread(magic, sizeof(magic), 1, fp) == 1 &&
+        std::memcmp(magic, c_indexFileMagic, sizeof(magic)) == 0 &&
+        readValue(fp, &byteOrder) && byteOrder == c_indexFileByteOrder &&
+        readValue(fp, &storedNatoms) && storedNatoms == natoms &&
+        readValue(fp, &fileSize_) && fileSize_ <= fileSize &&
+        readValue(fp, &fileTime_) &&
+        readValue(fp, &endOffset_) && endOffset_ <= fileSize_ &&
+        readValue(fp, &nframes) && nframes >= 0;
+    /* A file that only grew can be extended, anything else is rebuilt */
+    bOK = bOK && (fileSize_ < fileSize || fileTime_ == fileTime);
+
+    frames_.clear();
+    gmx_off_t prevOffset = -1;
+    for (gmx_int64_t i = 0; bOK && i < nframes; i++)
+    {
+        Frame       frame;
+        gmx_int64_t offset, step;
+        float       time;
+        bOK = (readValue(fp, &offset) && readValue(fp, &step) &&
+               readValue(fp, &time) &&
+               offset > prevOffset && offset < endOffset_);
+        frame.offset = offset;
+        frame.step   = step;
+        frame.time   = time;
+        prevOffset   = offset;
+        frames_.push_back(frame);
+    }
+    std::fclose(fp);
+
+    if (!bOK)
+    {
+        frames_.clear();
+        endOffset_ = 0;
+        fileSize_  = -1;
+        fileTime_  = -1;
+    }
+    if (debug)
+    {
+        fprintf(debug, "%s XTC frame index file '%s' (%d frames)\n",
+                bOK ? "Read" : "Ignored", filename.c_str(), frameCount());
+    }
+
+    return bOK;
+}
+
+void XtcFrameIndex::writeIndexFile(const std::string &filename, int natoms) const
+{
+    FILE *fp = std::fopen(filename.c_str(), "wb");
+    if (fp == nullptr)
+    {
+        /* The index is only a cache, e.g. the directory may be read-only */
+        return;
+    }
+
+    bool bOK =
+        std::fwrite(c_indexFileMagic, sizeof(c_indexFileMagic), 1, fp) == 1 &&
+        writeValue(fp, c_indexFileByteOrder) &&
+        writeValue(fp, static_cast<gmx_int32_t>(natoms)) &&
+        writeValue(fp, fileSize_) &&
+        writeValue(fp, fileTime_) &&
+        writeValue(fp, static_cast<gmx_int64_t>(endOffset_)) &&
+        writeValue(fp, static_cast<gmx_int64_t>(frames_.size()));
+    for (size_t i = 0; bOK && i < frames_.size(); i++)
+    {
+        bOK = (writeValue(fp, static_cast<gmx_int64_t>(frames_[i].offset)) &&
+               writeValue(fp, frames_[i].step) &&
+               writeValue(fp, static_cast<float>(frames_[i].time)));
+    }
+    bOK = (std::fclose(fp) == 0) && bOK;
+
+    if (!bOK)
+    {
+        /* Do not leave a partial file that would be rejected every time */
+        std::remove(filename.c_str());
+    }
+    if (debug)
+    {
+        fprintf(debug, "%s XTC frame index file '%s' (%d frames)\n",
+                bOK ? "Wrote" : "Could not write", filename.c_str(), frameCount());
+    }
+}
+
+bool XtcFrameIndex::build(t_fileio *fio, int natoms, bool bUseIndexFile)
+{
+    const std::string fn(gmx_fio_getname(fio));
+    struct stat       info;
+
+    frames_.clear();
+    endOffset_ = 0;
+    if (natoms <= 0 || stat(fn.c_str(), &info) != 0 || !(info.st_mode & S_IFREG))
+    {
+        return false;
+    }
+    const gmx_int64_t fileSize = info.st_size;
+    const gmx_int64_t fileTime = info.st_mtime;
+    const std::string indexFn  = indexFilename(fn);
+
+    bool              bHaveLastFrame = false;
+    Frame             lastFrame;
+    if (bUseIndexFile && readIndexFile(indexFn, natoms, fileSize, fileTime))
+    {
+        if (fileSize_ == fileSize && fileTime_ == fileTime)
+        {
+            return true;
+        }
+        /* The trajectory has grown since the index was written. Rescan the
+         * last indexed frame, so that we detect a trajectory that was
+         * rewritten instead of appended to.
+         */
+        if (!frames_.empty())
+        {
+            bHaveLastFrame = true;
+            lastFrame      = frames_.back();
+            endOffset_     = lastFrame.offset;
+            frames_.pop_back();
+        }
+    }
+    fileSize_ = fileSize;
+    fileTime_ = fileTime;
+
+    const gmx_off_t position = gmx_fio_ftell(fio);
+    const size_t    nReused  = frames_.size();
+    bool            bOK      = scanFrames(fio, natoms);
+    if (bOK && bHaveLastFrame &&
+        (frames_.size() == nReused ||
+         frames_[nReused].step != lastFrame.step ||
+         frames_[nReused].time != lastFrame.time))
+    {
+        frames_.clear();
+        endOffset_ = 0;
+        bOK        = scanFrames(fio, natoms);
+    }
+    gmx_fio_seek(fio, position);
+
+    if (!bOK)
+    {
+        frames_.clear();
+        endOffset_ = 0;
+        return false;
+    }
+    if (bUseIndexFile)
+    {
+        writeIndexFile(indexFn, natoms);
+    }
+
+    return true;
+}
+
+} // namespace gmx
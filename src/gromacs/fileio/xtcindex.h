@@ -0,0 +1,152 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares a frame-offset index for random access into XTC files.
+ *
+ * The index stores the file offset, step and time of every complete
+ * frame in an XTC file. It is built by scanning only the frame headers
+ * (the compressed coordinate data is skipped with a seek), and can be
+ * stored in a sidecar file next to the trajectory, so later tools can
+ * reuse it. A stored index is only used when the size and modification
+ * time of the trajectory match the recorded ones; when the trajectory
+ * has only been appended to, the stored index is extended.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_XTCINDEX_H
+#define GMX_FILEIO_XTCINDEX_H
+
+#include <string>
+#include <vector>
+
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/real.h"
+
+struct t_fileio;
+
+namespace gmx
+{
+
+/*! \libinternal \brief
+ * Frame-offset index of an XTC trajectory file.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+class XtcFrameIndex
+{
+    public:
+        //! Location and identification of one frame in the file.
+        struct Frame
+        {
+            //! Offset of the start of the frame header in the file.
+            gmx_off_t   offset;
+            //! MD step stored in the frame.
+            gmx_int64_t step;
+            //! Time stored in the frame.
+            real        time;
+        };
+
+        /*! \brief
+         * Returns the name of the sidecar file used to store the index
+         * of \p trajectoryFilename.
+         */
+        static std::string indexFilename(const std::string &trajectoryFilename);
+
+        //! Creates an empty index.
+        XtcFrameIndex();
+
+        /*! \brief
+         * Builds the index for an XTC file opened for reading.
+         *
+         * \param[in] fio    Open XTC file.
+         * \param[in] natoms Number of atoms in each frame.
+         * \param[in] bUseIndexFile  Whether a sidecar index file may be
+         *     read and written.
+         * \returns   true if the index could be built.
+         *
+         * The position of \p fio is unchanged on return. Frames that are
+         * truncated at the end of the file are not part of the index.
+         * Fails when \p fio does not refer to a seekable regular file.
+         */
+        bool build(t_fileio *fio, int natoms, bool bUseIndexFile);
+
+        //! Returns the number of complete frames in the file.
+        int frameCount() const { return static_cast<int>(frames_.size()); }
+        //! Returns the location of frame \p index.
+        const Frame &frame(int index) const { return frames_[index]; }
+        /*! \brief
+         * Returns the offset just past the last complete frame.
+         *
+         * Seeking here positions the file at end of file, or at the start
+         * of an incomplete trailing frame.
+         */
+        gmx_off_t endOffset() const { return endOffset_; }
+        /*! \brief
+         * Returns the frame that starts at \p offset, or -1 if no frame
+         * starts there.
+         */
+        int frameAtOffset(gmx_off_t offset) const;
+        /*! \brief
+         * Returns the first frame, at or after \p firstFrame, with a time
+         * that is not smaller than \p time, or frameCount() if none exists.
+         */
+        int findFrameAtTime(real time, int firstFrame = 0) const;
+
+    private:
+        //! Reads a sidecar index that is valid for the given file state.
+        bool readIndexFile(const std::string &filename, int natoms,
+                           gmx_int64_t fileSize, gmx_int64_t fileTime);
+        //! Writes the index to a sidecar file, ignoring failures.
+        void writeIndexFile(const std::string &filename, int natoms) const;
+        //! Adds frames to the index, starting at endOffset_.
+        bool scanFrames(t_fileio *fio, int natoms);
+
+        //! Frames in the file, ordered by offset.
+        std::vector<Frame> frames_;
+        //! Offset just past the last complete frame.
+        gmx_off_t          endOffset_;
+        //! File size that the index was built for.
+        gmx_int64_t        fileSize_;
+        //! File modification time that the index was built for.
+        gmx_int64_t        fileTime_;
+};
+
+} // namespace gmx
+
+#endif
@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -40,16 +40,26 @@
 
 #include <cstring>
 
+#include <vector>
+
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/gmxfio-xdr.h"
 #include "gromacs/fileio/xdrf.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/smalloc.h"
 
 #define XTC_MAGIC 1995
 
+/* Size in bytes of the frame header, the box and the number of atoms,
+ * which precede the data written by xdr3dfcoord */
+#define XTC_FRAME_PREFIX_SIZE (3*4 + 4 + DIM*DIM*4 + 4)
+/* Size in bytes of the fields written by xdr3dfcoord between the number
+ * of atoms and the compressed bit stream */
+#define XTC_COORD_HEADER_SIZE (4 + 2*DIM*4 + 4 + 4)
+
 
 static int xdr_r2f(XDR *xdrs, real *r, gmx_bool gmx_unused bRead)
 {
@@ -290,3 +300,166 @@ int read_next_xtc(t_fileio* fio,
 
     return *bOK;
 }
+
+/* Returns the big-endian XDR integer at pos in buf */
+static int xtc_buffer_int(const std::vector<char> &buf, size_t pos)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(buf.data()) + pos;
+
+    return static_cast<int>((static_cast<unsigned int>(p[0]) << 24) |
+                            (static_cast<unsigned int>(p[1]) << 16) |
+                            (static_cast<unsigned int>(p[2]) << 8) |
+                            static_cast<unsigned int>(p[3]));
+}
+
+/* Returns the XDR float at pos in buf */
+static float xtc_buffer_float(const std::vector<char> &buf, size_t pos)
+{
+    int   i = xtc_buffer_int(buf, pos);
+    float f;
+
+    std::memcpy(&f, &i, sizeof(f));
+    return f;
+}
+
+/* Reads the raw data of the next frame in fp into data, without decoding it.
+ * fileEnd is the size of the file, which bounds the size of the compressed
+ * data given in the frame header.
+ * Returns FALSE at end of file or when the frame is incomplete, in which
+ * case the file position is not changed.
+ */
+static gmx_bool read_xtc_frame_data(FILE *fp, gmx_off_t fileEnd, std::vector<char> *data)
+{
+    gmx_off_t offset = gmx_ftell(fp);
+    size_t    size   = XTC_FRAME_PREFIX_SIZE;
+    gmx_bool  bOK;
+
+    data->resize(size);
+    bOK = (fread(data->data(), 1, size, fp) == size);
+    if (bOK)
+    {
+        check_xtc_magic(xtc_buffer_int(*data, 0));
+
+        int natoms = xtc_buffer_int(*data, size - 4);
+        if (natoms < 0)
+        {
+            bOK = FALSE;
+        }
+        else if (natoms <= 9)
+        {
+            /* uncompressed coordinates */
+            data->resize(size + natoms*DIM*4);
+            bOK = (fread(data->data() + size, 1, data->size() - size, fp) == data->size() - size);
+        }
+        else
+        {
+            data->resize(size + XTC_COORD_HEADER_SIZE);
+            bOK = (fread(data->data() + size, 1, XTC_COORD_HEADER_SIZE, fp) == XTC_COORD_HEADER_SIZE);
+            if (bOK)
+            {
+                /* the compressed data is padded to a multiple of 4 bytes */
+                int byteCount = xtc_buffer_int(*data, data->size() - 4);
+                bOK           = (byteCount >= 0 && byteCount <= fileEnd - gmx_ftell(fp));
+                if (bOK)
+                {
+                    size = data->size();
+                    data->resize(size + (byteCount + 3)/4*4);
+                    bOK  = (fread(data->data() + size, 1, data->size() - size, fp) == data->size() - size);
+                }
+            }
+        }
+    }
+    if (!bOK)
+    {
+        gmx_fseek(fp, offset, SEEK_SET);
+    }
+
+    return bOK;
+}
+
+int read_next_xtc_frames(t_fileio *fio, int natoms, int maxFrames, int nthreads,
+                         gmx_int64_t step[], real time[], matrix box[], rvec *x[], real prec[])
+{
+    FILE                            *fp = gmx_fio_getfp(fio);
+    std::vector< std::vector<char> > data(maxFrames);
+    std::vector<gmx_off_t>           offsets(maxFrames);
+    std::vector<char>                bFrameOK(maxFrames);
+    int                              nframes;
+
+    /* Determine the file size, so corrupt frame headers can not make us
+     * allocate more memory than the rest of the file contains
+     */
+    gmx_off_t start = gmx_ftell(fp);
+    gmx_fseek(fp, 0, SEEK_END);
+    gmx_off_t fileEnd = gmx_ftell(fp);
+    gmx_fseek(fp, start, SEEK_SET);
+
+    /* Reading is sequential, so the raw frame data is read first */
+    for (nframes = 0; nframes < maxFrames; nframes++)
+    {
+        offsets[nframes] = gmx_ftell(fp);
+        if (!read_xtc_frame_data(fp, fileEnd, &data[nframes]))
+        {
+            break;
+        }
+        int n = xtc_buffer_int(data[nframes], XTC_FRAME_PREFIX_SIZE - 4);
+        if (n > natoms)
+        {
+            gmx_fatal(FARGS, "Frame contains more atoms (%d) than expected (%d)",
+                      n, natoms);
+        }
+    }
+
+    /* The frames are independent, so they can be decompressed in parallel */
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+    for (int f = 0; f < nframes; f++)
+    {
+        try
+        {
+            const std::vector<char> &buf = data[f];
+            int                      n   = 0;
+            float                    fprec;
+
+            step[f] = xtc_buffer_int(buf, 8);
+            time[f] = xtc_buffer_float(buf, 12);
+            for (int i = 0; i < DIM; i++)
+            {
+                for (int j = 0; j < DIM; j++)
+                {
+                    box[f][i][j] = xtc_buffer_float(buf, 16 + 4*(i*DIM + j));
+                }
+            }
+#if GMX_DOUBLE
+            std::vector<float> ftmp(natoms*DIM);
+            float             *fx = ftmp.data();
+#else
+            float             *fx = x[f][0];
+#endif
+            size_t coordSize = buf.size() - XTC_FRAME_PREFIX_SIZE + 4;
+            bFrameOK[f] = (xdr3dfcoord_from_buffer(buf.data() + XTC_FRAME_PREFIX_SIZE - 4, coordSize,
+                                                   fx, &n, &fprec) == coordSize);
+#if GMX_DOUBLE
+            for (int i = 0; i < n; i++)
+            {
+                x[f][i][XX] = ftmp[DIM*i+XX];
+                x[f][i][YY] = ftmp[DIM*i+YY];
+                x[f][i][ZZ] = ftmp[DIM*i+ZZ];
+            }
+#endif
+            prec[f] = fprec;
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+    /* Leave the file at the first frame that could not be decompressed */
+    for (int f = 0; f < nframes; f++)
+    {
+        if (!bFrameOK[f])
+        {
+            gmx_fseek(fp, offsets[f], SEEK_SET);
+            return f;
+        }
+    }
+
+    return nframes;
+}
@@ -75,6 +75,17 @@ int read_next_xtc(struct t_fileio *fio,
                   matrix box, rvec *x, real *prec, gmx_bool *bOK);
 /* Read subsequent frames */
 
+int read_next_xtc_frames(struct t_fileio *fio, int natoms, int maxFrames, int nthreads,
+                         gmx_int64_t step[], real time[], matrix box[], rvec *x[], real prec[]);
+/* Read up to maxFrames subsequent frames into the arrays, which should have
+ * room for maxFrames frames, with x[f] allocated for natoms atoms.
+ * The frame data is read sequentially, after which the frames are
+ * decompressed in parallel using nthreads OpenMP threads.
+ * Returns the number of frames read, which is smaller than maxFrames
+ * at the end of the file or at a corrupted frame. In the latter case,
+ * the file is positioned at the start of the corrupted frame.
+ */
+
 int write_xtc(struct t_fileio *fio,
               int natoms, gmx_int64_t step, real time,
               const rvec *box, const rvec *x, real prec);
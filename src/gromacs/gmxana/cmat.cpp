@@ -210,7 +210,6 @@ void swap_mat(t_mat *m)
 void low_rmsd_dist(const char *fn, real maxrms, int nn, real **mat,
                    const gmx_output_env_t *oenv)
 {
-    FILE   *fp;
     int     i, j, *histo, x;
     real    fac;
 
@@ -228,13 +227,24 @@ void low_rmsd_dist(const char *fn, real maxrms, int nn, real **mat,
         }
     }
 
-    fp = xvgropen(fn, "RMS Distribution", "RMS (nm)", "a.u.", oenv);
+    write_rmsd_dist(fn, maxrms, histo, oenv);
+    sfree(histo);
+}
+
+void write_rmsd_dist(const char *fn, real maxrms, const int *histo,
+                     const gmx_output_env_t *oenv)
+{
+    FILE *fp;
+    int   i;
+    real  fac;
+
+    fac = 100/maxrms;
+    fp  = xvgropen(fn, "RMS Distribution", "RMS (nm)", "a.u.", oenv);
     for (i = 0; (i < 101); i++)
     {
         fprintf(fp, "%10g  %10d\n", i/fac, histo[i]);
     }
     xvgrclose(fp);
-    sfree(histo);
 }
 
 void rmsd_distribution(const char *fn, t_mat *rms, const gmx_output_env_t *oenv)
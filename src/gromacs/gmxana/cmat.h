@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2013,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2013,2014,2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -92,6 +92,12 @@ extern void low_rmsd_dist(const char *fn, real maxrms, int nn, real **mat,
 
 extern void rmsd_distribution(const char *fn, t_mat *m, const gmx_output_env_t *oenv);
 
+extern void write_rmsd_dist(const char *fn, real maxrms, const int *histo,
+                            const gmx_output_env_t *oenv);
+/* Writes the RMSD distribution histo, with 101 bins from 0 to maxrms,
+ * where value r goes in bin (int)(100*r/maxrms + 0.5), to fn.
+ */
+
 extern t_clustid *new_clustid(int n1);
 
 #ifdef __cplusplus
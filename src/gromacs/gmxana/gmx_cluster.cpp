@@ -41,6 +41,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
@@ -62,8 +63,10 @@
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 /* print to two file pointers at once (i.e. stderr and log) */
@@ -139,6 +142,9 @@ typedef struct {
     int *nb;
 } t_nnb;
 
+/* The maximum size in bytes of a tile of rows for writing the matrix with -sparse */
+static const size_t c_maxTileSize = 256*1024*1024;
+
 void cp_index(int nn, int from[], int to[])
 {
     int i;
@@ -330,6 +336,105 @@ static real rms_dist(int isize, real **d, real **d_r)
     return std::sqrt(r2);
 }
 
+/* The data for computing the RMSD between two frames on the fly */
+typedef struct {
+    int       natom; /* the number of atoms per frame */
+    real     *mass;  /* the weights, zero for atoms not used for fitting */
+    rvec    **xx;    /* the coordinates of all frames, centered with bFit */
+    gmx_bool  bFit;  /* fit the frames before computing the RMSD */
+} t_rmsd_calc;
+
+/* Returns the RMSD between frames i and j, this can be called by
+ * multiple threads simultaneously.
+ */
+static real calc_rmsd(const t_rmsd_calc *rc, int i, int j)
+{
+    if (rc->bFit)
+    {
+        return calc_fit_rmsd(rc->natom, rc->mass, rc->xx[i], rc->xx[j]);
+    }
+    else
+    {
+        return rmsdev(rc->natom, rc->mass, rc->xx[i], rc->xx[j]);
+    }
+}
+
+/* Computes the RMSD matrix, or with bRMSdist the RMS distance deviation
+ * matrix, with the rows divided over OpenMP threads.
+ */
+static void calc_rmsd_matrix(int nf, const t_rmsd_calc *rc, gmx_bool bRMSdist, t_mat *rms)
+{
+    gmx_int64_t nrms = (static_cast<gmx_int64_t>(nf)*static_cast<gmx_int64_t>(nf-1))/2;
+    int         i1, i2;
+
+#pragma omp parallel num_threads(gmx_omp_get_max_threads())
+    {
+        try
+        {
+            real **d1 = nullptr, **d2 = nullptr;
+            int    i;
+
+            if (bRMSdist)
+            {
+                /* Initiate work arrays */
+                snew(d1, rc->natom);
+                snew(d2, rc->natom);
+                for (i = 0; (i < rc->natom); i++)
+                {
+                    snew(d1[i], rc->natom);
+                    snew(d2[i], rc->natom);
+                }
+            }
+#pragma omp for schedule(dynamic)
+            for (int j1 = 0; j1 < nf; j1++)
+            {
+                if (bRMSdist)
+                {
+                    calc_dist(rc->natom, rc->xx[j1], d1);
+                }
+                for (int j2 = j1+1; j2 < nf; j2++)
+                {
+                    if (bRMSdist)
+                    {
+                        calc_dist(rc->natom, rc->xx[j2], d2);
+                        rms->mat[j1][j2] = rms_dist(rc->natom, d1, d2);
+                    }
+                    else
+                    {
+                        rms->mat[j1][j2] = calc_rmsd(rc, j1, j2);
+                    }
+                }
+#pragma omp critical
+                {
+                    nrms -= nf-j1-1;
+                    fprintf(stderr, "\r# RMSD calculations left: " "%" GMX_PRId64 "   ", nrms);
+                    fflush(stderr);
+                }
+            }
+            if (bRMSdist)
+            {
+                /* Clean up work arrays */
+                for (i = 0; (i < rc->natom); i++)
+                {
+                    sfree(d1[i]);
+                    sfree(d2[i]);
+                }
+                sfree(d1);
+                sfree(d2);
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+    /* Fill the lower half and the statistics */
+    for (i1 = 0; i1 < nf; i1++)
+    {
+        for (i2 = i1+1; i2 < nf; i2++)
+        {
+            set_mat_entry(rms, i1, i2, rms->mat[i1][i2]);
+        }
+    }
+}
+
 static bool rms_dist_comp(const t_dist &a, const t_dist &b)
 {
     return a.dist < b.dist;
@@ -658,43 +763,12 @@ static void dump_nnb (FILE *fp, const char *title, int n1, t_nnb *nnb)
     }
 }
 
-static void gromos(int n1, real **mat, real rmsdcut, t_clusters *clust)
+/* Finds the clusters for the gromos method, given for each structure
+ * the list of neighbors within the cut-off in nnb. Frees the lists.
+ */
+static void gromos_clusters(int n1, t_nnb *nnb, t_clusters *clust)
 {
-    t_dist *row;
-    t_nnb  *nnb;
-    int     i, j, k, j1, maxval;
-
-    /* Put all neighbors nearer than rmsdcut in the list */
-    fprintf(stderr, "Making list of neighbors within cutoff ");
-    snew(nnb, n1);
-    snew(row, n1);
-    for (i = 0; (i < n1); i++)
-    {
-        maxval = 0;
-        k      = 0;
-        /* put all neighbors within cut-off in list */
-        for (j = 0; j < n1; j++)
-        {
-            if (mat[i][j] < rmsdcut)
-            {
-                if (k >= maxval)
-                {
-                    maxval += 10;
-                    srenew(nnb[i].nb, maxval);
-                }
-                nnb[i].nb[k] = j;
-                k++;
-            }
-        }
-        /* store nr of neighbors, we'll need that */
-        nnb[i].nr = k;
-        if (i%(1+n1/100) == 0)
-        {
-            fprintf(stderr, "%3d%%\b\b\b\b", (i*100+1)/n1);
-        }
-    }
-    fprintf(stderr, "%3d%%\n", 100);
-    sfree(row);
+    int i, j, k, j1;
 
     /* sort neighbor list on number of neighbors, largest first */
     std::sort(nnb, nnb+n1, nrnb_comp);
@@ -719,6 +793,7 @@ static void gromos(int n1, real **mat, real rmsdcut, t_clusters *clust)
         /* mark as done */
         nnb[0].nr = 0;
         sfree(nnb[0].nb);
+        nnb[0].nb = nullptr;
 
         /* adjust number of neighbors for others, taking removals into account: */
         for (i = 1; i < n1 && nnb[i].nr; i++)
@@ -747,7 +822,10 @@ static void gromos(int n1, real **mat, real rmsdcut, t_clusters *clust)
         k++;
     }
     fprintf(stderr, "\n");
-    sfree(nnb);
+    for (i = 0; i < n1; i++)
+    {
+        sfree(nnb[i].nb);
+    }
     if (debug)
     {
         fprintf(debug, "Clusters (%d):\n", k);
@@ -761,6 +839,223 @@ static void gromos(int n1, real **mat, real rmsdcut, t_clusters *clust)
     clust->ncl = k-1;
 }
 
+static void gromos(int n1, real **mat, real rmsdcut, t_clusters *clust)
+{
+    t_dist *row;
+    t_nnb  *nnb;
+    int     i, j, k, maxval;
+
+    /* Put all neighbors nearer than rmsdcut in the list */
+    fprintf(stderr, "Making list of neighbors within cutoff ");
+    snew(nnb, n1);
+    snew(row, n1);
+    for (i = 0; (i < n1); i++)
+    {
+        maxval = 0;
+        k      = 0;
+        /* put all neighbors within cut-off in list */
+        for (j = 0; j < n1; j++)
+        {
+            if (mat[i][j] < rmsdcut)
+            {
+                if (k >= maxval)
+                {
+                    maxval += 10;
+                    srenew(nnb[i].nb, maxval);
+                }
+                nnb[i].nb[k] = j;
+                k++;
+            }
+        }
+        /* store nr of neighbors, we'll need that */
+        nnb[i].nr = k;
+        if (i%(1+n1/100) == 0)
+        {
+            fprintf(stderr, "%3d%%\b\b\b\b", (i*100+1)/n1);
+        }
+    }
+    fprintf(stderr, "%3d%%\n", 100);
+    sfree(row);
+
+    gromos_clusters(n1, nnb, clust);
+    sfree(nnb);
+}
+
+/* Computes the RMSD between all pairs of frames, divided over OpenMP
+ * threads, without storing the RMSD matrix. Stores for each frame the
+ * frames within rmsdcut, including itself, in nnb, as gromos does,
+ * and returns the minimum, maximum and sum of the RMSDs and the sum of
+ * the squared RMSDs between consecutive frames (see mat_energy).
+ */
+static void calc_rmsd_neighbors(int nf, const t_rmsd_calc *rc, real rmsdcut,
+                                t_nnb *nnb, real *minrms, real *maxrms,
+                                double *sumrms, double *energy)
+{
+    const int                      nthreads = gmx_omp_get_max_threads();
+    std::vector<std::vector<int> > pairs(nthreads);
+    gmx_int64_t                    nrms     = (static_cast<gmx_int64_t>(nf)*static_cast<gmx_int64_t>(nf-1))/2;
+    int                            i;
+
+    *minrms = 1e20;
+    *maxrms = 0;
+    *sumrms = 0;
+    *energy = 0;
+
+#pragma omp parallel num_threads(nthreads)
+    {
+        try
+        {
+            std::vector<int> &pairList = pairs[gmx_omp_get_thread_num()];
+            real              tminrms  = 1e20, tmaxrms = 0;
+            double            tsumrms  = 0, tenergy = 0;
+
+#pragma omp for schedule(dynamic)
+            for (int i1 = 0; i1 < nf; i1++)
+            {
+                for (int i2 = i1+1; i2 < nf; i2++)
+                {
+                    real r = calc_rmsd(rc, i1, i2);
+
+                    tminrms  = std::min(tminrms, r);
+                    tmaxrms  = std::max(tmaxrms, r);
+                    tsumrms += r;
+                    if (i2 == i1+1)
+                    {
+                        tenergy += r*r;
+                    }
+                    if (r < rmsdcut)
+                    {
+                        pairList.push_back(i1);
+                        pairList.push_back(i2);
+                    }
+                }
+#pragma omp critical
+                {
+                    nrms -= nf-i1-1;
+                    fprintf(stderr, "\r# RMSD calculations left: " "%" GMX_PRId64 "   ", nrms);
+                    fflush(stderr);
+                }
+            }
+#pragma omp critical
+            {
+                *minrms  = std::min(*minrms, tminrms);
+                *maxrms  = std::max(*maxrms, tmaxrms);
+                *sumrms += tsumrms;
+                *energy += tenergy;
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+    /* Each frame is its own neighbor, as the diagonal of the matrix is 0 */
+    for (i = 0; i < nf; i++)
+    {
+        nnb[i].nr = 1;
+    }
+    for (const auto &pairList : pairs)
+    {
+        for (size_t p = 0; p < pairList.size(); p++)
+        {
+            nnb[pairList[p]].nr++;
+        }
+    }
+    for (i = 0; i < nf; i++)
+    {
+        snew(nnb[i].nb, nnb[i].nr);
+        nnb[i].nb[0] = i;
+        nnb[i].nr    = 1;
+    }
+    for (const auto &pairList : pairs)
+    {
+        for (size_t p = 0; p < pairList.size(); p += 2)
+        {
+            int i1 = pairList[p], i2 = pairList[p+1];
+
+            nnb[i1].nb[nnb[i1].nr++] = i2;
+            nnb[i2].nb[nnb[i2].nr++] = i1;
+        }
+    }
+    /* Order the neighbors as gromos does */
+    for (i = 0; i < nf; i++)
+    {
+        std::sort(nnb[i].nb, nnb[i].nb+nnb[i].nr);
+    }
+}
+
+/* The data for writing the RMSD/cluster matrix with tiles of rows */
+typedef struct {
+    const t_rmsd_calc *rc;
+    const int         *cl;     /* the cluster of each frame */
+    const real        *color;  /* the value of each frame in the lower half */
+    int                ntile;  /* the maximum number of rows in a tile */
+    int                j0, j1; /* the tile contains rows j0 to j1 */
+    real              *tile;   /* RMSDs with i < j, row j starts at (j-j0)*nf */
+    real               maxrms; /* the maximum RMSD, for the histogram */
+    int               *histo;  /* the RMSD distribution, see write_rmsd_dist */
+} t_rmsd_tiles;
+
+/* Row function for write_xpm_rows: returns the RMSDs for frame i < j and the
+ * cluster colors for i > j. The RMSDs are recomputed for a tile of rows at
+ * a time, so only the tile is stored. Also collects the RMSD distribution.
+ */
+static void get_rmsd_row(int j, int n_x, real row[], void *data)
+{
+    t_rmsd_tiles *rt = static_cast<t_rmsd_tiles *>(data);
+    const real   *rmsd;
+    real          fac;
+    int           i, x;
+
+    if (j < rt->j0 || j >= rt->j1)
+    {
+        /* Rows are requested from high to low j, compute the next tile */
+        rt->j1 = j+1;
+        rt->j0 = std::max(0, rt->j1 - rt->ntile);
+#pragma omp parallel for schedule(dynamic) num_threads(gmx_omp_get_max_threads())
+        for (int jt = rt->j0; jt < rt->j1; jt++)
+        {
+            try
+            {
+                real *tileRow = rt->tile + static_cast<size_t>(jt - rt->j0)*n_x;
+                for (int it = 0; it < jt; it++)
+                {
+                    tileRow[it] = calc_rmsd(rt->rc, it, jt);
+                }
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+        }
+        fac = 100/rt->maxrms;
+        for (int jt = rt->j0; jt < rt->j1; jt++)
+        {
+            const real *tileRow = rt->tile + static_cast<size_t>(jt - rt->j0)*n_x;
+            for (i = 0; i < jt; i++)
+            {
+                x = static_cast<int>(fac*tileRow[i]+0.5);
+                if (x <= 100)
+                {
+                    rt->histo[x]++;
+                }
+            }
+        }
+    }
+
+    rmsd = rt->tile + static_cast<size_t>(j - rt->j0)*n_x;
+    for (i = 0; i < n_x; i++)
+    {
+        if (i < j)
+        {
+            row[i] = rmsd[i];
+        }
+        else if (i > j && rt->cl[i] == rt->cl[j])
+        {
+            row[i] = rt->color[i];
+        }
+        else
+        {
+            row[i] = 0;
+        }
+    }
+}
+
 rvec **read_whole_trj(const char *fn, int isize, int index[], int skip,
                       int *nframe, real **time, const gmx_output_env_t *oenv, gmx_bool bPBC, gmx_rmpbc_t gpbc)
 {
@@ -813,10 +1108,13 @@ rvec **read_whole_trj(const char *fn, int isize, int index[], int skip,
     return xx;
 }
 
-static int plot_clusters(int nf, real **mat, t_clusters *clust,
-                         int minstruct)
+/* Sets color[i] to the index, counting from 1, of the cluster of frame i
+ * among the clusters with at least minstruct structures, 0 when the cluster
+ * is smaller. Returns the number of these clusters plus one.
+ */
+static int cluster_colors(int nf, t_clusters *clust, int minstruct, real color[])
 {
-    int  i, j, ncluster, ci;
+    int  i, j, ncluster;
     int *cl_id, *nstruct, *strind;
 
     snew(cl_id, nf);
@@ -847,26 +1145,35 @@ static int plot_clusters(int nf, real **mat, t_clusters *clust,
     fprintf(stderr, "There are %d clusters with at least %d conformations\n",
             ncluster, minstruct);
 
+    for (i = 0; i < nf; i++)
+    {
+        color[i] = (nstruct[cl_id[i]] >= minstruct) ? strind[i] : 0;
+    }
+    sfree(strind);
+    sfree(nstruct);
+    sfree(cl_id);
+
+    return ncluster;
+}
+
+static int plot_clusters(int nf, real **mat, t_clusters *clust,
+                         int minstruct)
+{
+    int   i, j, ncluster;
+    real *color;
+
+    snew(color, nf);
+    ncluster = cluster_colors(nf, clust, minstruct, color);
     for (i = 0; (i < nf); i++)
     {
-        ci = cl_id[i];
         for (j = 0; j < i; j++)
         {
-            if ((ci == cl_id[j]) && (nstruct[ci] >= minstruct))
-            {
-                /* color different clusters with different colors, as long as
-                   we don't run out of colors */
-                mat[i][j] = strind[i];
-            }
-            else
-            {
-                mat[i][j] = 0;
-            }
+            /* color different clusters with different colors, as long as
+               we don't run out of colors */
+            mat[i][j] = (clust->cl[i] == clust->cl[j]) ? color[i] : 0;
         }
     }
-    sfree(strind);
-    sfree(nstruct);
-    sfree(cl_id);
+    sfree(color);
 
     return ncluster;
 }
@@ -981,8 +1288,16 @@ static void ana_trans(t_clusters *clust, int nf,
     sfree(axis);
 }
 
+/* Returns the RMSD between frames i and j from the matrix rmsd,
+ * or computed with rc when rmsd is NULL.
+ */
+static real pair_rmsd(real **rmsd, const t_rmsd_calc *rc, int i, int j)
+{
+    return rmsd ? rmsd[i][j] : calc_rmsd(rc, i, j);
+}
+
 static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
-                             int natom, t_atoms *atoms, rvec *xtps,
+                             const t_rmsd_calc *rc, int natom, t_atoms *atoms, rvec *xtps,
                              real *mass, rvec **xx, real *time,
                              int ifsize, int *fitidx,
                              int iosize, int *outidx,
@@ -999,7 +1314,7 @@ static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
     t_trxstatus *trxsout = nullptr;
     int          i, i1, cl, nstr, *structure, first = 0, midstr;
     gmx_bool    *bWrite = nullptr;
-    real         r, clrmsd, midrmsd;
+    real         r, clrmsd, midrmsd, *ravg;
     rvec        *xav = nullptr;
     matrix       zerobox;
 
@@ -1090,6 +1405,7 @@ static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
         }
     }
     snew(structure, nf);
+    snew(ravg, nf);
     fprintf(log, "\n%3s | %3s  %4s | %6s %4s | cluster members\n",
             "cl.", "#st", "rmsd", "middle", "rmsd");
     for (cl = 1; cl <= clust->ncl; cl++)
@@ -1140,24 +1456,54 @@ static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
         clrmsd  = 0;
         midstr  = 0;
         midrmsd = 10000;
+        /* Sum the RMSDs with the other structures in the cluster, the RMSD
+         * of a structure with itself is zero. Each pair is computed once
+         * and added to both rows. Without a matrix the RMSDs are computed
+         * here, so then we use all threads with a buffer per thread.
+         */
         for (i1 = 0; i1 < nstr; i1++)
         {
-            r = 0;
-            if (nstr > 1)
+            ravg[i1] = 0;
+        }
+        if (nstr > 1)
+        {
+            const int                       nthreads = (rmsd == nullptr ? gmx_omp_get_max_threads() : 1);
+            std::vector<std::vector<real> > rsumThread(nthreads);
+#pragma omp parallel num_threads(nthreads)
             {
-                for (i = 0; i < nstr; i++)
+                try
                 {
-                    if (i < i1)
-                    {
-                        r += rmsd[structure[i]][structure[i1]];
-                    }
-                    else
+                    std::vector<real> &rsum = rsumThread[gmx_omp_get_thread_num()];
+
+                    rsum.assign(nstr, 0);
+#pragma omp for schedule(dynamic)
+                    for (int i2 = 0; i2 < nstr - 1; i2++)
                     {
-                        r += rmsd[structure[i1]][structure[i]];
+                        for (int i3 = i2 + 1; i3 < nstr; i3++)
+                        {
+                            real rpair = pair_rmsd(rmsd, rc, structure[i2], structure[i3]);
+                            rsum[i2] += rpair;
+                            rsum[i3] += rpair;
+                        }
                     }
                 }
-                r /= (nstr - 1);
+                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+            }
+            for (const std::vector<real> &rsum : rsumThread)
+            {
+                for (i1 = 0; i1 < nstr; i1++)
+                {
+                    ravg[i1] += rsum[i1];
+                }
+            }
+            for (i1 = 0; i1 < nstr; i1++)
+            {
+                ravg[i1] /= (nstr - 1);
             }
+        }
+        for (i1 = 0; i1 < nstr; i1++)
+        {
+            r = ravg[i1];
             if (r < midrmsd)
             {
                 midstr  = structure[i1];
@@ -1227,7 +1573,7 @@ static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
                         {
                             if (bWrite[i1])
                             {
-                                bWrite[i] = rmsd[structure[i1]][structure[i]] > rmsmin;
+                                bWrite[i] = pair_rmsd(rmsd, rc, structure[i1], structure[i]) > rmsmin;
                             }
                         }
                     }
@@ -1276,6 +1622,7 @@ static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
         }
     }
     sfree(structure);
+    sfree(ravg);
     if (trxsfn)
     {
         sfree(trxsfn);
@@ -1353,6 +1700,16 @@ int gmx_cluster(int argc, char *argv[])
         "and eliminate it from the pool of clusters. Repeat for remaining",
         "structures in pool.[PAR]",
 
+        "The RMSD matrix is computed using all OpenMP threads. It uses",
+        "memory proportional to the square of the number of structures.",
+        "With [TT]-sparse[tt], which is only supported for the gromos method",
+        "with structures from a trajectory, no matrix is stored: only the",
+        "neighbors within the cut-off are kept and the RMSDs are computed",
+        "again, in blocks of rows, when writing the [TT]-o[tt] and",
+        "[TT]-dist[tt] output and for the cluster analysis. This makes",
+        "it possible to cluster many more structures, at the cost of",
+        "computing each RMSD at least twice.[PAR]",
+
         "When the clustering algorithm assigns each structure to exactly one",
         "cluster (single linkage, Jarvis Patrick and gromos) and a trajectory",
         "file is supplied, the structure with",
@@ -1394,13 +1751,16 @@ int gmx_cluster(int argc, char *argv[])
 
     FILE              *fp, *log;
     int                nf, i, i1, i2, j;
-    gmx_int64_t        nrms = 0;
 
     matrix             box;
-    rvec              *xtps, *usextps, *x1, **xx = nullptr;
+    rvec              *xtps, *usextps, **xx = nullptr;
     const char        *fn, *trx_out_fn;
     t_clusters         clust;
-    t_mat             *rms, *orig = nullptr;
+    t_mat             *rms  = nullptr, *orig = nullptr;
+    t_nnb             *nnb  = nullptr;
+    t_rmsd_calc        rmsdCalc;
+    real               minrms, maxrms, *color = nullptr;
+    double             sumrms, energy;
     real              *eigenvalues;
     t_topology         top;
     int                ePBC;
@@ -1411,7 +1771,7 @@ int gmx_cluster(int argc, char *argv[])
     int                isize = 0, ifsize = 0, iosize = 0;
     int               *index = nullptr, *fitidx = nullptr, *outidx = nullptr;
     char              *grpname;
-    real               rmsd, **d1, **d2, *time = nullptr, time_invfac, *mass = nullptr;
+    real              *time = nullptr, time_invfac, *mass = nullptr;
     char               buf[STRLEN], buf1[80], title[STRLEN];
     gmx_bool           bAnalyze, bUseRmsdCut, bJP_RMSD = FALSE, bReadMat, bReadTraj, bPBC = TRUE;
 
@@ -1432,6 +1792,7 @@ int gmx_cluster(int argc, char *argv[])
     static int        nlevels  = 40, skip = 1;
     static real       scalemax = -1.0, rmsdcut = 0.1, rmsmin = 0.0;
     gmx_bool          bRMSdist = FALSE, bBinary = FALSE, bAverage = FALSE, bFit = TRUE;
+    gmx_bool          bSparse  = FALSE;
     static int        niter    = 10000, nrandom = 0, seed = 0, write_ncl = 0, write_nst = 1, minstruct = 1;
     static real       kT       = 1e-3;
     static int        M        = 10, P = 3;
@@ -1463,6 +1824,8 @@ int gmx_cluster(int argc, char *argv[])
           "Method for cluster determination" },
         { "-minstruct", FALSE, etINT, {&minstruct},
           "Minimum number of structures in cluster for coloring in the [REF].xpm[ref] file" },
+        { "-sparse", FALSE, etBOOL, {&bSparse},
+          "Store only the neighbors within the cut-off instead of the RMSD matrix (gromos only)" },
         { "-binary", FALSE, etBOOL, {&bBinary},
           "Treat the RMSD matrix as consisting of 0 and 1, where the cut-off "
           "is given by [TT]-cutoff[tt]" },
@@ -1601,6 +1964,11 @@ int gmx_cluster(int argc, char *argv[])
     {
         fprintf(log, "Using %d iterations\n", niter);
     }
+    if (bSparse && (method != m_gromos || bReadMat || bRMSdist || bBinary))
+    {
+        gmx_fatal(FARGS, "Option -sparse is only supported with the gromos method "
+                  "with structures read from a trajectory, without -dm, -dista and -binary");
+    }
 
     if (skip < 1)
     {
@@ -1694,6 +2062,10 @@ int gmx_cluster(int argc, char *argv[])
         {
             gmx_rmpbc_done(gpbc);
         }
+        rmsdCalc.natom = isize;
+        rmsdCalc.mass  = mass;
+        rmsdCalc.xx    = xx;
+        rmsdCalc.bFit  = bFit;
     }
 
     if (bReadMat)
@@ -1726,85 +2098,43 @@ int gmx_cluster(int argc, char *argv[])
 
         nlevels = readmat[0].nmap;
     }
+    else if (bSparse)
+    {
+        fprintf(stderr, "Computing the RMS deviations for %d structures, "
+                "storing the neighbors within %g nm\n", nf, rmsdcut);
+        snew(nnb, nf);
+        calc_rmsd_neighbors(nf, &rmsdCalc, rmsdcut, nnb, &minrms, &maxrms, &sumrms, &energy);
+        fprintf(stderr, "\n\n");
+    }
     else   /* !bReadMat */
     {
         rms  = init_mat(nf, method == m_diagonalize);
-        nrms = (static_cast<gmx_int64_t>(nf)*static_cast<gmx_int64_t>(nf-1))/2;
-        if (!bRMSdist)
-        {
-            fprintf(stderr, "Computing %dx%d RMS deviation matrix\n", nf, nf);
-            /* Initialize work array */
-            snew(x1, isize);
-            for (i1 = 0; i1 < nf; i1++)
-            {
-                for (i2 = i1+1; i2 < nf; i2++)
-                {
-                    for (i = 0; i < isize; i++)
-                    {
-                        copy_rvec(xx[i1][i], x1[i]);
-                    }
-                    if (bFit)
-                    {
-                        do_fit(isize, mass, xx[i2], x1);
-                    }
-                    rmsd = rmsdev(isize, mass, xx[i2], x1);
-                    set_mat_entry(rms, i1, i2, rmsd);
-                }
-                nrms -= nf-i1-1;
-                fprintf(stderr, "\r# RMSD calculations left: " "%" GMX_PRId64 "   ", nrms);
-                fflush(stderr);
-            }
-            sfree(x1);
-        }
-        else /* bRMSdist */
-        {
-            fprintf(stderr, "Computing %dx%d RMS distance deviation matrix\n", nf, nf);
-
-            /* Initiate work arrays */
-            snew(d1, isize);
-            snew(d2, isize);
-            for (i = 0; (i < isize); i++)
-            {
-                snew(d1[i], isize);
-                snew(d2[i], isize);
-            }
-            for (i1 = 0; i1 < nf; i1++)
-            {
-                calc_dist(isize, xx[i1], d1);
-                for (i2 = i1+1; (i2 < nf); i2++)
-                {
-                    calc_dist(isize, xx[i2], d2);
-                    set_mat_entry(rms, i1, i2, rms_dist(isize, d1, d2));
-                }
-                nrms -= nf-i1-1;
-                fprintf(stderr, "\r# RMSD calculations left: " "%" GMX_PRId64 "   ", nrms);
-                fflush(stderr);
-            }
-            /* Clean up work arrays */
-            for (i = 0; (i < isize); i++)
-            {
-                sfree(d1[i]);
-                sfree(d2[i]);
-            }
-            sfree(d1);
-            sfree(d2);
-        }
+        fprintf(stderr, "Computing %dx%d RMS %sdeviation matrix\n", nf, nf,
+                bRMSdist ? "distance " : "");
+        calc_rmsd_matrix(nf, &rmsdCalc, bRMSdist, rms);
         fprintf(stderr, "\n\n");
     }
+    if (!bSparse)
+    {
+        minrms = rms->minrms;
+        maxrms = rms->maxrms;
+        sumrms = rms->sumrms;
+        energy = mat_energy(rms);
+    }
     ffprintf_gg(stderr, log, buf, "The RMSD ranges from %g to %g nm\n",
-                rms->minrms, rms->maxrms);
-    ffprintf_g(stderr, log, buf, "Average RMSD is %g\n", 2*rms->sumrms/(nf*(nf-1)));
+                minrms, maxrms);
+    ffprintf_g(stderr, log, buf, "Average RMSD is %g\n", 2*sumrms/(nf*(nf-1)));
     ffprintf_d(stderr, log, buf, "Number of structures for matrix %d\n", nf);
-    ffprintf_g(stderr, log, buf, "Energy of the matrix is %g.\n", mat_energy(rms));
-    if (bUseRmsdCut && (rmsdcut < rms->minrms || rmsdcut > rms->maxrms) )
+    ffprintf_g(stderr, log, buf, "Energy of the matrix is %g.\n", energy);
+    if (bUseRmsdCut && (rmsdcut < minrms || rmsdcut > maxrms) )
     {
         fprintf(stderr, "WARNING: rmsd cutoff %g is outside range of rmsd values "
-                "%g to %g\n", rmsdcut, rms->minrms, rms->maxrms);
+                "%g to %g\n", rmsdcut, minrms, maxrms);
     }
-    if (bAnalyze && (rmsmin < rms->minrms) )
+    if (bAnalyze && (rmsmin < minrms) )
     {
         fprintf(stderr, "WARNING: rmsd minimum %g is below lowest rmsd value %g\n",
-                rmsmin, rms->minrms);
+                rmsmin, minrms);
     }
     if (bAnalyze && (rmsmin > rmsdcut) )
     {
@@ -1812,8 +2142,11 @@ int gmx_cluster(int argc, char *argv[])
                 rmsmin, rmsdcut);
     }
 
-    /* Plot the rmsd distribution */
-    rmsd_distribution(opt2fn("-dist", NFILE, fnm), rms, oenv);
+    /* Plot the rmsd distribution, with -sparse this is done with the matrix output */
+    if (!bSparse)
+    {
+        rmsd_distribution(opt2fn("-dist", NFILE, fnm), rms, oenv);
+    }
 
     if (bBinary)
     {
@@ -1867,7 +2200,15 @@ int gmx_cluster(int argc, char *argv[])
             jarvis_patrick(rms->nn, rms->mat, M, P, bJP_RMSD ? rmsdcut : -1, &clust);
             break;
         case m_gromos:
-            gromos(rms->nn, rms->mat, rmsdcut, &clust);
+            if (bSparse)
+            {
+                gromos_clusters(nf, nnb, &clust);
+                sfree(nnb);
+            }
+            else
+            {
+                gromos(rms->nn, rms->mat, rmsdcut, &clust);
+            }
             break;
         default:
             gmx_fatal(FARGS, "DEATH HORROR unknown method \"%s\"", methodname[0]);
@@ -1881,7 +2222,23 @@ int gmx_cluster(int argc, char *argv[])
 
     if (bAnalyze)
     {
-        if (minstruct > 1)
+        if (bSparse)
+        {
+            /* The cluster depiction is generated while writing the matrix */
+            snew(color, nf);
+            if (minstruct > 1)
+            {
+                ncluster = cluster_colors(nf, &clust, minstruct, color);
+            }
+            else
+            {
+                for (i = 0; i < nf; i++)
+                {
+                    color[i] = maxrms;
+                }
+            }
+        }
+        else if (minstruct > 1)
         {
             ncluster = plot_clusters(nf, rms->mat, &clust, minstruct);
         }
@@ -1900,7 +2257,8 @@ int gmx_cluster(int argc, char *argv[])
             copy_rvec(xtps[index[i]], usextps[i]);
         }
         useatoms.nr = isize;
-        analyze_clusters(nf, &clust, rms->mat, isize, &useatoms, usextps, mass, xx, time,
+        analyze_clusters(nf, &clust, bSparse ? nullptr : rms->mat, &rmsdCalc,
+                         isize, &useatoms, usextps, mass, xx, time,
                          ifsize, fitidx, iosize, outidx,
                          bReadTraj ? trx_out_fn : nullptr,
                          opt2fn_null("-sz", NFILE, fnm),
@@ -1940,7 +2298,41 @@ int gmx_cluster(int argc, char *argv[])
         sprintf(buf, "Time (%s)", output_env_get_time_unit(oenv));
         sprintf(title, "RMS%sDeviation / Cluster Index",
                 bRMSdist ? " Distance " : " ");
-        if (minstruct > 1)
+        if (bSparse)
+        {
+            t_rmsd_tiles tiles;
+
+            tiles.rc     = &rmsdCalc;
+            tiles.cl     = clust.cl;
+            tiles.color  = color;
+            tiles.ntile  = static_cast<int>(std::min(static_cast<size_t>(nf),
+                                                     c_maxTileSize/(nf*sizeof(real))));
+            tiles.ntile  = std::max(tiles.ntile, 1);
+            tiles.j0     = 0;
+            tiles.j1     = 0;
+            tiles.maxrms = maxrms;
+            snew(tiles.tile, static_cast<size_t>(tiles.ntile)*nf);
+            snew(tiles.histo, 101);
+            if (minstruct > 1)
+            {
+                write_xpm_split_rows(fp, 0, title, "RMSD (nm)", buf, buf,
+                                     nf, nf, time, time, get_rmsd_row, &tiles,
+                                     0.0, maxrms, &nlevels,
+                                     rlo_top, rhi_top, 0.0, ncluster,
+                                     &ncluster, TRUE, rlo_bot, rhi_bot);
+            }
+            else
+            {
+                write_xpm_rows(fp, 0, title, "RMSD (nm)", buf, buf,
+                               nf, nf, time, time, get_rmsd_row, &tiles, 0.0, maxrms,
+                               rlo_top, rhi_top, &nlevels);
+            }
+            write_rmsd_dist(opt2fn("-dist", NFILE, fnm), maxrms, tiles.histo, oenv);
+            sfree(tiles.tile);
+            sfree(tiles.histo);
+            sfree(color);
+        }
+        else if (minstruct > 1)
         {
             write_xpm_split(fp, 0, title, "RMSD (nm)", buf, buf,
                             nf, nf, time, time, rms->mat, 0.0, rms->maxrms, &nlevels,
@@ -39,6 +39,8 @@
 #include <cmath>
 #include <cstring>
 
+#include <algorithm>
+
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/matio.h"
@@ -46,6 +48,7 @@
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/gmxana/eigio.h"
 #include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/linearalgebra/covariance.h"
 #include "gromacs/linearalgebra/eigensolver.h"
 #include "gromacs/math/do_fit.h"
 #include "gromacs/math/vec.h"
@@ -55,11 +58,16 @@
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/sysinfo.h"
 
+//! Number of frames that are added to the covariance matrix at once
+static const int c_covarBatchSize = 64;
+
 int gmx_covar(int argc, char *argv[])
 {
     const char       *desc[] = {
@@ -88,6 +96,15 @@ int gmx_covar(int argc, char *argv[])
         "i.e. for each atom pair the sum of the xx, yy and zz covariances is",
         "written.",
         "[PAR]",
+        "With [TT]-lanczos[tt], only the eigenvectors that are written",
+        "(set with [TT]-last[tt], or limited by the number of frames",
+        "when there are fewer frames than degrees of freedom) are",
+        "determined with the Lanczos method instead of diagonalizing",
+        "the whole matrix. This is much faster when a small part of the",
+        "eigenvectors is written. The sum of the eigenvalues is then only",
+        "computed over these eigenvalues and is reported together with",
+        "the fraction of the trace of the covariance matrix it covers.",
+        "[PAR]",
         "Note that the diagonalization of a matrix requires memory and time",
         "that will increase at least as fast as than the square of the number",
         "of atoms involved. It is easy to run out of memory, in which",
@@ -95,7 +112,7 @@ int gmx_covar(int argc, char *argv[])
         "should consider carefully whether a reduced set of atoms will meet",
         "your needs for lower costs."
     };
-    static gmx_bool   bFit = TRUE, bRef = FALSE, bM = FALSE, bPBC = TRUE;
+    static gmx_bool   bFit = TRUE, bRef = FALSE, bM = FALSE, bPBC = TRUE, bLanczos = FALSE;
     static int        end  = -1;
     t_pargs           pa[] = {
         { "-fit",  FALSE, etBOOL, {&bFit},
@@ -107,7 +124,9 @@ int gmx_covar(int argc, char *argv[])
         { "-last",  FALSE, etINT, {&end},
           "Last eigenvector to write away (-1 is till the last)" },
         { "-pbc",  FALSE,  etBOOL, {&bPBC},
-          "Apply corrections for periodic boundary conditions" }
+          "Apply corrections for periodic boundary conditions" },
+        { "-lanczos", FALSE, etBOOL, {&bLanczos},
+          "Determine only the eigenvectors that are written, with the Lanczos method" }
     };
     FILE             *out = nullptr; /* initialization makes all compilers happy */
     t_trxstatus      *status;
@@ -117,17 +136,18 @@ int gmx_covar(int argc, char *argv[])
     rvec             *x, *xread, *xref, *xav, *xproj;
     matrix            box, zerobox;
     real             *sqrtm, *mat, *eigenvalues, sum, trace, inv_nframes;
+    real             *xbatch;
     real              t, tstart, tend, **mat2;
-    real              xj, *w_rls = nullptr;
+    real             *w_rls = nullptr;
     real              min, max, *axis;
-    int               natoms, nat, nframes0, nframes, nlevels;
-    gmx_int64_t       ndim, i, j, k, l;
+    int               natoms, nat, nframes0, nframes, nlevels, nbatch;
+    gmx_int64_t       ndim, i, j;
     int               WriteXref;
     const char       *fitfile, *trxfile, *ndxfile;
     const char       *eigvalfile, *eigvecfile, *averfile, *logfile;
     const char       *asciifile, *xpmfile, *xpmafile;
     char              str[STRLEN], *fitname, *ananame;
-    int               d, dj, nfit;
+    int               d, nfit;
     int              *index, *ifit;
     gmx_bool          bDiffMass1, bDiffMass2;
     char              timebuf[STRLEN];
@@ -301,6 +321,8 @@ int gmx_covar(int argc, char *argv[])
     sfree(xread);
 
     fprintf(stderr, "Constructing covariance matrix (%dx%d) ...\n", static_cast<int>(ndim), static_cast<int>(ndim));
+    snew(xbatch, c_covarBatchSize*ndim);
+    nbatch  = 0;
     nframes = 0;
     nat     = read_first_x(oenv, &status, trxfile, &t, &xread, box);
     tstart  = t;
@@ -318,36 +340,28 @@ int gmx_covar(int argc, char *argv[])
             reset_x(nfit, ifit, nat, nullptr, xread, w_rls);
             do_fit(nat, w_rls, xref, xread);
         }
+        /* store the deviations in the next row of the batch */
+        rvec *xdev = reinterpret_cast<rvec *>(xbatch + nbatch*ndim);
         if (bRef)
         {
             for (i = 0; i < natoms; i++)
             {
-                rvec_sub(xread[index[i]], xref[index[i]], x[i]);
+                rvec_sub(xread[index[i]], xref[index[i]], xdev[i]);
             }
         }
         else
         {
             for (i = 0; i < natoms; i++)
             {
-                rvec_sub(xread[index[i]], xav[i], x[i]);
+                rvec_sub(xread[index[i]], xav[i], xdev[i]);
             }
         }
+        nbatch++;
 
-        for (j = 0; j < natoms; j++)
+        if (nbatch == c_covarBatchSize)
         {
-            for (dj = 0; dj < DIM; dj++)
-            {
-                k  = ndim*(DIM*j+dj);
-                xj = x[j][dj];
-                for (i = j; i < natoms; i++)
-                {
-                    l = k+DIM*i;
-                    for (d = 0; d < DIM; d++)
-                    {
-                        mat[l+d] += x[i][d]*xj;
-                    }
-                }
-            }
+            add_covariance_batch(ndim, nbatch, xbatch, mat);
+            nbatch = 0;
         }
     }
     while (read_next_x(oenv, status, &t, xread, box) &&
@@ -355,6 +369,12 @@ int gmx_covar(int argc, char *argv[])
     close_trj(status);
     gmx_rmpbc_done(gpbc);
 
+    if (nbatch > 0)
+    {
+        add_covariance_batch(ndim, nbatch, xbatch, mat);
+    }
+    sfree(xbatch);
+
     fprintf(stderr, "Read %d frames\n", nframes);
 
     if (bRef)
@@ -373,27 +393,23 @@ int gmx_covar(int argc, char *argv[])
 
     /* correct the covariance matrix for the mass */
     inv_nframes = 1.0/nframes;
-    for (j = 0; j < natoms; j++)
+#pragma omp parallel for num_threads(gmx_omp_get_max_threads()) schedule(dynamic, DIM)
+    for (gmx_int64_t row = 0; row < ndim; row++)
     {
-        for (dj = 0; dj < DIM; dj++)
+        real fac = inv_nframes*sqrtm[row/DIM];
+        for (gmx_int64_t col = row; col < ndim; col++)
         {
-            for (i = j; i < natoms; i++)
-            {
-                k = ndim*(DIM*j+dj)+DIM*i;
-                for (d = 0; d < DIM; d++)
-                {
-                    mat[k+d] = mat[k+d]*inv_nframes*sqrtm[i]*sqrtm[j];
-                }
-            }
+            mat[ndim*row+col] *= fac*sqrtm[col/DIM];
         }
     }
 
     /* symmetrize the matrix */
-    for (j = 0; j < ndim; j++)
+#pragma omp parallel for num_threads(gmx_omp_get_max_threads()) schedule(static)
+    for (gmx_int64_t row = 0; row < ndim; row++)
     {
-        for (i = j; i < ndim; i++)
+        for (gmx_int64_t col = 0; col < row; col++)
         {
-            mat[ndim*i+j] = mat[ndim*j+i];
+            mat[ndim*row+col] = mat[ndim*col+row];
         }
     }
 
@@ -509,15 +525,55 @@ int gmx_covar(int argc, char *argv[])
     }
 
 
+    /* Set 'end', the maximum eigenvector and -value index used for output */
+    if (end == -1)
+    {
+        if (nframes-1 < ndim)
+        {
+            end = nframes-1;
+            fprintf(stderr, "\nWARNING: there are fewer frames in your trajectory than there are\n");
+            fprintf(stderr, "degrees of freedom in your system. Only generating the first\n");
+            fprintf(stderr, "%d out of %d eigenvectors and eigenvalues.\n", end, static_cast<int>(ndim));
+        }
+        else
+        {
+            end = ndim;
+        }
+    }
+    end = std::min(end, static_cast<int>(ndim));
+
     /* call diagonalization routine */
 
     snew(eigenvalues, ndim);
-    snew(eigenvectors, ndim*ndim);
 
-    std::memcpy(eigenvectors, mat, ndim*ndim*sizeof(real));
-    fprintf(stderr, "\nDiagonalizing ...\n");
-    fflush(stderr);
-    eigensolver(eigenvectors, ndim, 0, ndim, eigenvalues, mat);
+    /* With the Lanczos method only the eigenvectors that are written are
+     * determined, this is not possible when all of them are written.
+     */
+    if (bLanczos && (end <= 0 || end >= ndim))
+    {
+        fprintf(stderr, "\nAll %d eigenvectors are written, using full diagonalization instead of the Lanczos method\n",
+                static_cast<int>(ndim));
+        bLanczos = FALSE;
+    }
+    if (bLanczos)
+    {
+        snew(eigenvectors, end*ndim);
+        fprintf(stderr, "\nDetermining the %d largest eigenvalues with the Lanczos method ...\n", end);
+        fflush(stderr);
+        dense_largest_eigensolver(mat, ndim, end, eigenvalues+ndim-end, eigenvectors, 100000);
+        /* Store the eigenvectors in the last rows of mat, as with the
+         * full diagonalization.
+         */
+        std::memcpy(mat+(ndim-end)*ndim, eigenvectors, end*ndim*sizeof(real));
+    }
+    else
+    {
+        snew(eigenvectors, ndim*ndim);
+        std::memcpy(eigenvectors, mat, ndim*ndim*sizeof(real));
+        fprintf(stderr, "\nDiagonalizing the whole matrix ...\n");
+        fflush(stderr);
+        eigensolver(eigenvectors, ndim, 0, ndim, eigenvalues, mat);
+    }
     sfree(eigenvectors);
 
     /* now write the output */
@@ -527,26 +583,23 @@ int gmx_covar(int argc, char *argv[])
     {
         sum += eigenvalues[i];
     }
-    fprintf(stderr, "\nSum of the eigenvalues: %g (%snm^2)\n",
-            sum, bM ? "u " : "");
-    if (std::abs(trace-sum) > 0.01*trace)
-    {
-        fprintf(stderr, "\nWARNING: eigenvalue sum deviates from the trace of the covariance matrix\n");
-    }
-
-    /* Set 'end', the maximum eigenvector and -value index used for output */
-    if (end == -1)
+    if (bLanczos)
     {
-        if (nframes-1 < ndim)
+        fprintf(stderr, "\nSum of the %d largest eigenvalues: %g (%snm^2), %.1f%% of the trace\n",
+                end, sum, bM ? "u " : "", 100*sum/trace);
+        /* The eigenvalues are non-negative, so they can not sum to more than the trace */
+        if (sum - trace > 0.01*trace)
         {
-            end = nframes-1;
-            fprintf(stderr, "\nWARNING: there are fewer frames in your trajectory than there are\n");
-            fprintf(stderr, "degrees of freedom in your system. Only generating the first\n");
-            fprintf(stderr, "%d out of %d eigenvectors and eigenvalues.\n", end, static_cast<int>(ndim));
+            fprintf(stderr, "\nWARNING: eigenvalue sum is larger than the trace of the covariance matrix\n");
         }
-        else
+    }
+    else
+    {
+        fprintf(stderr, "\nSum of the eigenvalues: %g (%snm^2)\n",
+                sum, bM ? "u " : "");
+        if (std::abs(trace-sum) > 0.01*trace)
         {
-            end = ndim;
+            fprintf(stderr, "\nWARNING: eigenvalue sum deviates from the trace of the covariance matrix\n");
         }
     }
 
@@ -623,11 +676,27 @@ int gmx_covar(int argc, char *argv[])
     {
         fprintf(out, "Fit is %smass weighted\n", bDiffMass1 ? "" : "non-");
     }
-    fprintf(out, "Diagonalized the %dx%d covariance matrix\n", static_cast<int>(ndim), static_cast<int>(ndim));
+    if (bLanczos)
+    {
+        fprintf(out, "Determined the %d largest eigenvalues of the %dx%d covariance matrix with the Lanczos method\n",
+                end, static_cast<int>(ndim), static_cast<int>(ndim));
+    }
+    else
+    {
+        fprintf(out, "Diagonalized the %dx%d covariance matrix\n", static_cast<int>(ndim), static_cast<int>(ndim));
+    }
     fprintf(out, "Trace of the covariance matrix before diagonalizing: %g\n",
             trace);
-    fprintf(out, "Trace of the covariance matrix after diagonalizing: %g\n\n",
-            sum);
+    if (bLanczos)
+    {
+        fprintf(out, "Sum of the %d largest eigenvalues: %g (%.1f%% of the trace)\n\n",
+                end, sum, 100*sum/trace);
+    }
+    else
+    {
+        fprintf(out, "Trace of the covariance matrix after diagonalizing: %g\n\n",
+                sum);
+    }
 
     fprintf(out, "Wrote %d eigenvalues to %s\n", static_cast<int>(end), eigvalfile);
     if (WriteXref == eWXR_YES)
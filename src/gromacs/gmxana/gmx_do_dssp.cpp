@@ -472,7 +472,9 @@ int gmx_do_dssp(int argc, char *argv[])
         "Finally, this program can dump the secondary structure in a special file",
         "[TT]ssdump.dat[tt] for usage in the program [gmx-chi]. Together",
         "these two programs can be used to analyze dihedral properties as a",
-        "function of secondary structure type."
+        "function of secondary structure type.[PAR]",
+        "[gmx-dssp] computes the same assignment without the external",
+        "dssp program, and is much faster for long trajectories."
     };
     static gmx_bool    bVerbose;
     static const char *ss_string   = "HEBT";
@@ -43,6 +43,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
@@ -62,6 +63,7 @@
 #include "gromacs/mdrunutility/mdmodules.h"
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/selection/nbsearch.h"
 #include "gromacs/topology/ifunc.h"
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
@@ -98,8 +100,6 @@ static const unsigned char c_donorMask    = (1 << 1);
 static const unsigned char c_inGroupMask  = (1 << 2);
 
 
-static const char *grpnames[grNR] = {"0", "1", "I" };
-
 static gmx_bool    bDebug = FALSE;
 
 #define HB_NO 0
@@ -116,32 +116,32 @@ static gmx_bool    bDebug = FALSE;
 #define ISDON(h)   ((h) & c_donorMask)
 #define ISINGRP(h) ((h) & c_inGroupMask)
 
-typedef struct {
-    int      nr;
-    int      maxnr;
-    int     *atoms;
-} t_ncell;
-
-typedef struct {
-    t_ncell d[grNR];
-    t_ncell a[grNR];
-} t_gridcell;
-
 typedef int     t_icell[grNR];
 typedef int h_id[MAXHYDRO];
 
+/* Run-length encoded existence function of a hbond. The frames (relative
+ * to t_hbond::n0) in which the hbond is present are stored as a sorted
+ * list of uninterrupted periods, so the memory use is proportional to the
+ * number of times the hbond forms rather than to the number of frames.
+ */
+typedef struct {
+    int      nrun, maxrun;
+    int     *start;       /* First frame of each period             */
+    int     *length;      /* Number of frames in each period        */
+} t_hbexist;
+
 typedef struct {
     int      history[MAXHYDRO];
     /* Has this hbond existed ever? If so as hbDist or hbHB or both.
      * Result is stored as a bitmap (1 = hbDist) || (2 = hbHB)
      */
-    /* Bitmask array which tells whether a hbond is present
+    /* Existence functions which tell whether a hbond is present
      * at a given time. Either of these may be NULL
      */
     int            n0;                 /* First frame a HB was found     */
-    int            nframes, maxframes; /* Amount of frames in this hbond */
-    unsigned int **h;
-    unsigned int **g;
+    int            nframes;            /* Amount of frames in this hbond */
+    t_hbexist    **h;
+    t_hbexist    **g;
     /* See Xu and Berne, JPCB 105 (2001), p. 11929. We define the
      * function g(t) = [1-h(t)] H(t) where H(t) is one when the donor-
      * acceptor distance is less than the user-specified distance (typically
@@ -168,7 +168,6 @@ typedef struct {
 
 typedef struct {
     gmx_bool        bHBmap, bDAnr;
-    int             wordlen;
     /* The following arrays are nframes long */
     int             nframes, max_frames, maxhydro;
     int            *nhb, *ndist;
@@ -195,7 +194,6 @@ static t_hbdata *mk_hbdata(gmx_bool bHBmap, gmx_bool bDAnr, gmx_bool oneHB)
     t_hbdata *hb;
 
     snew(hb, 1);
-    hb->wordlen = 8*sizeof(unsigned int);
     hb->bHBmap  = bHBmap;
     hb->bDAnr   = bDAnr;
     if (oneHB)
@@ -246,29 +244,75 @@ static void add_frames(t_hbdata *hb, int nframes)
     hb->nframes = nframes;
 }
 
-#define OFFSET(frame) (frame / 32)
-#define MASK(frame)   (1 << (frame % 32))
-
-static void _set_hb(unsigned int hbexist[], unsigned int frame, gmx_bool bValue)
+/* Marks the hbond as present in frame (relative to n0). Frames have to be
+ * added in non-decreasing order.
+ */
+static void add_hbexist(t_hbexist *e, int frame)
 {
-    if (bValue)
+    if (e->nrun > 0)
+    {
+        int last = e->nrun - 1;
+        int end  = e->start[last] + e->length[last];
+
+        if (frame < e->start[last])
+        {
+            gmx_incons("Hydrogen bond frames not added in order");
+        }
+        if (frame < end)
+        {
+            return;
+        }
+        if (frame == end)
+        {
+            e->length[last]++;
+            return;
+        }
+    }
+    if (e->nrun >= e->maxrun)
     {
-        hbexist[OFFSET(frame)] |= MASK(frame);
+        e->maxrun = std::max(4, 2*e->maxrun);
+        srenew(e->start, e->maxrun);
+        srenew(e->length, e->maxrun);
     }
-    else
+    e->start[e->nrun]  = frame;
+    e->length[e->nrun] = 1;
+    e->nrun++;
+}
+
+static gmx_bool is_hb(const t_hbexist *e, int frame)
+{
+    /* Binary search for the last period starting at or before frame */
+    int lo = 0, hi = e->nrun;
+
+    while (lo < hi)
     {
-        hbexist[OFFSET(frame)] &= ~MASK(frame);
+        int mid = (lo + hi)/2;
+        if (e->start[mid] <= frame)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
     }
+
+    return (lo > 0 && frame < e->start[lo-1] + e->length[lo-1]);
 }
 
-static gmx_bool is_hb(unsigned int hbexist[], int frame)
+static void done_hbexist(t_hbexist *e)
 {
-    return ((hbexist[OFFSET(frame)] & MASK(frame)) != 0) ? 1 : 0;
+    if (e)
+    {
+        sfree(e->start);
+        sfree(e->length);
+        sfree(e);
+    }
 }
 
 static void set_hb(t_hbdata *hb, int id, int ih, int ia, int frame, int ihb)
 {
-    unsigned int *ghptr = nullptr;
+    t_hbexist *ghptr = nullptr;
 
     if (ihb == hbHB)
     {
@@ -283,49 +327,27 @@ static void set_hb(t_hbdata *hb, int id, int ih, int ia, int frame, int ihb)
         gmx_fatal(FARGS, "Incomprehensible iValue %d in set_hb", ihb);
     }
 
-    _set_hb(ghptr, frame-hb->hbmap[id][ia]->n0, TRUE);
+    add_hbexist(ghptr, frame-hb->hbmap[id][ia]->n0);
 }
 
 static void add_ff(t_hbdata *hbd, int id, int h, int ia, int frame, int ihb)
 {
-    int         i, j, n;
+    int         i;
     t_hbond    *hb       = hbd->hbmap[id][ia];
     int         maxhydro = std::min(hbd->maxhydro, hbd->d.nhydro[id]);
-    int         wlen     = hbd->wordlen;
-    int         delta    = 32*wlen;
 
     if (!hb->h[0])
     {
-        hb->n0        = frame;
-        hb->maxframes = delta;
+        hb->n0 = frame;
         for (i = 0; (i < maxhydro); i++)
         {
-            snew(hb->h[i], hb->maxframes/wlen);
-            snew(hb->g[i], hb->maxframes/wlen);
+            snew(hb->h[i], 1);
+            snew(hb->g[i], 1);
         }
     }
     else
     {
         hb->nframes = frame-hb->n0;
-        /* We need a while loop here because hbonds may be returning
-         * after a long time.
-         */
-        while (hb->nframes >= hb->maxframes)
-        {
-            n = hb->maxframes + delta;
-            for (i = 0; (i < maxhydro); i++)
-            {
-                srenew(hb->h[i], n/wlen);
-                srenew(hb->g[i], n/wlen);
-                for (j = hb->maxframes/wlen; (j < n/wlen); j++)
-                {
-                    hb->h[i][j] = 0;
-                    hb->g[i][j] = 0;
-                }
-            }
-
-            hb->maxframes = n;
-        }
     }
     if (frame >= 0)
     {
@@ -863,43 +885,6 @@ static void search_donors(const t_topology *top, int isize, const int *index,
     }
 }
 
-static t_gridcell ***init_grid(gmx_bool bBox, rvec box[], real rcut, ivec ngrid)
-{
-    t_gridcell ***grid;
-    int           i, y, z;
-
-    if (bBox)
-    {
-        for (i = 0; i < DIM; i++)
-        {
-            ngrid[i] = static_cast<int>(box[i][i]/(1.2*rcut));
-        }
-    }
-
-    if (!bBox || (ngrid[XX] < 3) || (ngrid[YY] < 3) || (ngrid[ZZ] < 3) )
-    {
-        for (i = 0; i < DIM; i++)
-        {
-            ngrid[i] = 1;
-        }
-    }
-    else
-    {
-        printf("\nWill do grid-seach on %dx%dx%d grid, rcut=%g\n",
-               ngrid[XX], ngrid[YY], ngrid[ZZ], rcut);
-    }
-    snew(grid, ngrid[ZZ]);
-    for (z = 0; z < ngrid[ZZ]; z++)
-    {
-        snew((grid)[z], ngrid[YY]);
-        for (y = 0; y < ngrid[YY]; y++)
-        {
-            snew((grid)[z][y], ngrid[XX]);
-        }
-    }
-    return grid;
-}
-
 static void reset_nhbonds(t_donors *ddd)
 {
     int i, j;
@@ -913,323 +898,91 @@ static void reset_nhbonds(t_donors *ddd)
     }
 }
 
-static void pbc_correct_gem(rvec dx, matrix box, rvec hbox);
-static void pbc_in_gridbox(rvec dx, matrix box);
-
-static void build_grid(t_hbdata *hb, rvec x[], rvec xshell,
-                       gmx_bool bBox, matrix box, rvec hbox,
-                       real rcut, real rshell,
-                       ivec ngrid, t_gridcell ***grid)
+static void pbc_correct_gem(rvec dx, matrix box, rvec hbox)
 {
-    int         i, m, gr, xi, yi, zi, nr;
-    int        *ad;
-    ivec        grididx;
-    rvec        invdelta, dshell;
-    t_ncell    *newgrid;
-    gmx_bool    bDoRshell, bInShell, bAcc;
-    real        rshell2 = 0;
-    int         gx, gy, gz;
-    int         dum = -1;
-
-    bDoRshell = (rshell > 0);
-    rshell2   = gmx::square(rshell);
-    bInShell  = TRUE;
-
-#define DBB(x) if (debug && bDebug) fprintf(debug, "build_grid, line %d, %s = %d\n", __LINE__,#x, x)
-    DBB(dum);
-    for (m = 0; m < DIM; m++)
-    {
-        hbox[m] = box[m][m]*0.5;
-        if (bBox)
-        {
-            invdelta[m] = ngrid[m]/box[m][m];
-            if (1/invdelta[m] < rcut)
-            {
-                gmx_fatal(FARGS, "Your computational box has shrunk too much.\n"
-                          "%s can not handle this situation, sorry.\n",
-                          gmx::getProgramContext().displayName());
-            }
-        }
-        else
-        {
-            invdelta[m] = 0;
-        }
-    }
-    grididx[XX] = 0;
-    grididx[YY] = 0;
-    grididx[ZZ] = 0;
-    DBB(dum);
-    /* resetting atom counts */
-    for (gr = 0; (gr < grNR); gr++)
+    int      m;
+    gmx_bool bDone = FALSE;
+    while (!bDone)
     {
-        for (zi = 0; zi < ngrid[ZZ]; zi++)
-        {
-            for (yi = 0; yi < ngrid[YY]; yi++)
-            {
-                for (xi = 0; xi < ngrid[XX]; xi++)
-                {
-                    grid[zi][yi][xi].d[gr].nr = 0;
-                    grid[zi][yi][xi].a[gr].nr = 0;
-                }
-            }
-        }
-        DBB(dum);
-
-        /* put atoms in grid cells */
-        for (bAcc = FALSE; (bAcc <= TRUE); bAcc++)
+        bDone = TRUE;
+        for (m = DIM-1; m >= 0; m--)
         {
-            if (bAcc)
-            {
-                nr = hb->a.nra;
-                ad = hb->a.acc;
-            }
-            else
+            if (dx[m] < -hbox[m])
             {
-                nr = hb->d.nrd;
-                ad = hb->d.don;
+                bDone = FALSE;
+                rvec_inc(dx, box[m]);
             }
-            DBB(bAcc);
-            for (i = 0; (i < nr); i++)
+            if (dx[m] >= hbox[m])
             {
-                /* check if we are inside the shell */
-                /* if bDoRshell=FALSE then bInShell=TRUE always */
-                DBB(i);
-                if (bDoRshell)
-                {
-                    bInShell = TRUE;
-                    rvec_sub(x[ad[i]], xshell, dshell);
-                    if (bBox)
-                    {
-                        gmx_bool bDone = FALSE;
-                        while (!bDone)
-                        {
-                            bDone = TRUE;
-                            for (m = DIM-1; m >= 0 && bInShell; m--)
-                            {
-                                if (dshell[m] < -hbox[m])
-                                {
-                                    bDone = FALSE;
-                                    rvec_inc(dshell, box[m]);
-                                }
-                                if (dshell[m] >= hbox[m])
-                                {
-                                    bDone      = FALSE;
-                                    dshell[m] -= 2*hbox[m];
-                                }
-                            }
-                        }
-                        for (m = DIM-1; m >= 0 && bInShell; m--)
-                        {
-                            /* if we're outside the cube, we're outside the sphere also! */
-                            if ( (dshell[m] > rshell) || (-dshell[m] > rshell) )
-                            {
-                                bInShell = FALSE;
-                            }
-                        }
-                    }
-                    /* if we're inside the cube, check if we're inside the sphere */
-                    if (bInShell)
-                    {
-                        bInShell = norm2(dshell) < rshell2;
-                    }
-                }
-                DBB(i);
-                if (bInShell)
-                {
-                    if (bBox)
-                    {
-                        pbc_in_gridbox(x[ad[i]], box);
-
-                        for (m = DIM-1; m >= 0; m--)
-                        {   /* determine grid index of atom */
-                            grididx[m] = static_cast<int>(x[ad[i]][m]*invdelta[m]);
-                            grididx[m] = (grididx[m]+ngrid[m]) % ngrid[m];
-                        }
-                    }
-
-                    gx = grididx[XX];
-                    gy = grididx[YY];
-                    gz = grididx[ZZ];
-                    range_check(gx, 0, ngrid[XX]);
-                    range_check(gy, 0, ngrid[YY]);
-                    range_check(gz, 0, ngrid[ZZ]);
-                    DBB(gx);
-                    DBB(gy);
-                    DBB(gz);
-                    /* add atom to grid cell */
-                    if (bAcc)
-                    {
-                        newgrid = &(grid[gz][gy][gx].a[gr]);
-                    }
-                    else
-                    {
-                        newgrid = &(grid[gz][gy][gx].d[gr]);
-                    }
-                    if (newgrid->nr >= newgrid->maxnr)
-                    {
-                        newgrid->maxnr += 10;
-                        DBB(newgrid->maxnr);
-                        srenew(newgrid->atoms, newgrid->maxnr);
-                    }
-                    DBB(newgrid->nr);
-                    newgrid->atoms[newgrid->nr] = ad[i];
-                    newgrid->nr++;
-                }
+                bDone = FALSE;
+                rvec_dec(dx, box[m]);
             }
         }
     }
 }
 
-static void count_da_grid(ivec ngrid, t_gridcell ***grid, t_icell danr)
+/* Returns whether x is within rshell of xshell */
+static gmx_bool in_shell(const rvec x, const rvec xshell,
+                         gmx_bool bBox, matrix box, rvec hbox, real rshell)
 {
-    int gr, xi, yi, zi;
+    rvec dshell;
 
-    for (gr = 0; (gr < grNR); gr++)
+    rvec_sub(x, xshell, dshell);
+    if (bBox)
     {
-        danr[gr] = 0;
-        for (zi = 0; zi < ngrid[ZZ]; zi++)
-        {
-            for (yi = 0; yi < ngrid[YY]; yi++)
-            {
-                for (xi = 0; xi < ngrid[XX]; xi++)
-                {
-                    danr[gr] += grid[zi][yi][xi].d[gr].nr;
-                }
-            }
-        }
+        pbc_correct_gem(dshell, box, hbox);
     }
-}
 
-/* The grid loop.
- * Without a box, the grid is 1x1x1, so all loops are 1 long.
- * With a rectangular box (bTric==FALSE) all loops are 3 long.
- * With a triclinic box all loops are 3 long, except when a cell is
- * located next to one of the box edges which is not parallel to the
- * x/y-plane, in that case all cells in a line or layer are searched.
- * This could be implemented slightly more efficient, but the code
- * would get much more complicated.
- */
-static gmx_inline gmx_bool grid_loop_begin(int n, int x, gmx_bool bTric, gmx_bool bEdge)
-{
-    return ((n == 1) ? x : bTric && bEdge ? 0     : (x-1));
-}
-static gmx_inline gmx_bool grid_loop_end(int n, int x, gmx_bool bTric, gmx_bool bEdge)
-{
-    return ((n == 1) ? x : bTric && bEdge ? (n-1) : (x+1));
-}
-static gmx_inline int grid_mod(int j, int n)
-{
-    return (j+n) % (n);
+    return norm2(dshell) < gmx::square(rshell);
 }
 
-static void dump_grid(FILE *fp, ivec ngrid, t_gridcell ***grid)
+/* Sets up the donors and acceptors of each group that take part in the
+ * search of the current frame. With -shell only the donors and acceptors
+ * within rshell of xshell are used.
+ */
+static void select_search_atoms(t_hbdata *hb, rvec x[], rvec xshell,
+                                gmx_bool bBox, matrix box, rvec hbox,
+                                real rshell,
+                                std::vector<int> don[], std::vector<int> acc[])
 {
-    int gr, x, y, z, sum[grNR];
+    int i, m, gr;
 
-    fprintf(fp, "grid %dx%dx%d\n", ngrid[XX], ngrid[YY], ngrid[ZZ]);
-    for (gr = 0; gr < grNR; gr++)
+    for (m = 0; m < DIM; m++)
     {
-        sum[gr] = 0;
-        fprintf(fp, "GROUP %d (%s)\n", gr, grpnames[gr]);
-        for (z = 0; z < ngrid[ZZ]; z += 2)
-        {
-            fprintf(fp, "Z=%d,%d\n", z, z+1);
-            for (y = 0; y < ngrid[YY]; y++)
-            {
-                for (x = 0; x < ngrid[XX]; x++)
-                {
-                    fprintf(fp, "%3d", grid[x][y][z].d[gr].nr);
-                    sum[gr] += grid[z][y][x].d[gr].nr;
-                    fprintf(fp, "%3d", grid[x][y][z].a[gr].nr);
-                    sum[gr] += grid[z][y][x].a[gr].nr;
-
-                }
-                fprintf(fp, " | ");
-                if ( (z+1) < ngrid[ZZ])
-                {
-                    for (x = 0; x < ngrid[XX]; x++)
-                    {
-                        fprintf(fp, "%3d", grid[z+1][y][x].d[gr].nr);
-                        sum[gr] += grid[z+1][y][x].d[gr].nr;
-                        fprintf(fp, "%3d", grid[z+1][y][x].a[gr].nr);
-                        sum[gr] += grid[z+1][y][x].a[gr].nr;
-                    }
-                }
-                fprintf(fp, "\n");
-            }
-        }
+        hbox[m] = box[m][m]*0.5;
     }
-    fprintf(fp, "TOTALS:");
-    for (gr = 0; gr < grNR; gr++)
+    for (gr = 0; (gr < grNR); gr++)
     {
-        fprintf(fp, " %d=%d", gr, sum[gr]);
+        don[gr].clear();
+        acc[gr].clear();
     }
-    fprintf(fp, "\n");
-}
-
-/* New GMX record! 5 * in a row. Congratulations!
- * Sorry, only four left.
- */
-static void free_grid(ivec ngrid, t_gridcell ****grid)
-{
-    int           y, z;
-    t_gridcell ***g = *grid;
-
-    for (z = 0; z < ngrid[ZZ]; z++)
+    for (i = 0; (i < hb->d.nrd); i++)
     {
-        for (y = 0; y < ngrid[YY]; y++)
+        if (rshell <= 0 || in_shell(x[hb->d.don[i]], xshell, bBox, box, hbox, rshell))
         {
-            sfree(g[z][y]);
+            don[hb->d.grp[i]].push_back(hb->d.don[i]);
         }
-        sfree(g[z]);
     }
-    sfree(g);
-    g = nullptr;
-}
-
-static void pbc_correct_gem(rvec dx, matrix box, rvec hbox)
-{
-    int      m;
-    gmx_bool bDone = FALSE;
-    while (!bDone)
+    for (i = 0; (i < hb->a.nra); i++)
     {
-        bDone = TRUE;
-        for (m = DIM-1; m >= 0; m--)
+        if (rshell <= 0 || in_shell(x[hb->a.acc[i]], xshell, bBox, box, hbox, rshell))
         {
-            if (dx[m] < -hbox[m])
-            {
-                bDone = FALSE;
-                rvec_inc(dx, box[m]);
-            }
-            if (dx[m] >= hbox[m])
-            {
-                bDone = FALSE;
-                rvec_dec(dx, box[m]);
-            }
+            acc[hb->a.grp[i]].push_back(hb->a.acc[i]);
         }
     }
 }
 
-static void pbc_in_gridbox(rvec dx, matrix box)
+/* Appends the acceptors in the search within the cut-off from x */
+static void add_search_acceptors(const gmx::AnalysisNeighborhoodSearch &nbsearch,
+                                 const rvec &x, const std::vector<int> &acc,
+                                 std::vector<int> *candidates)
 {
-    int      m;
-    gmx_bool bDone = FALSE;
-    while (!bDone)
+    gmx::AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(x);
+    gmx::AnalysisNeighborhoodPair       pair;
+
+    while (pairSearch.findNextPair(&pair))
     {
-        bDone = TRUE;
-        for (m = DIM-1; m >= 0; m--)
-        {
-            if (dx[m] < 0)
-            {
-                bDone = FALSE;
-                rvec_inc(dx, box[m]);
-            }
-            if (dx[m] >= box[m][m])
-            {
-                bDone = FALSE;
-                rvec_dec(dx, box[m]);
-            }
-        }
+        candidates->push_back(acc[pair.refIndex()]);
     }
 }
 
@@ -1357,8 +1110,7 @@ static int is_hbond(t_hbdata *hb, int grpd, int grpa, int d, int a,
 /* Merging is now done on the fly, so do_merge is most likely obsolete now.
  * Will do some more testing before removing the function entirely.
  * - Erik Marklund, MAY 10 2010 */
-static void do_merge(t_hbdata *hb, int ntmp,
-                     unsigned int htmp[], unsigned int gtmp[],
+static void do_merge(int ntmp, unsigned int htmp[], unsigned int gtmp[],
                      t_hbond *hb0, t_hbond *hb1)
 {
     /* Here we need to make sure we're treating periodicity in
@@ -1399,23 +1151,24 @@ static void do_merge(t_hbdata *hb, int ntmp,
         htmp[mm] = htmp[mm] || is_hb(hb1->h[0], m);
         gtmp[mm] = gtmp[mm] || is_hb(hb1->g[0], m);
     }
-    /* Reallocate target array */
-    if (nnframes > hb0->maxframes)
-    {
-        srenew(hb0->h[0], 4+nnframes/hb->wordlen);
-        srenew(hb0->g[0], 4+nnframes/hb->wordlen);
-    }
-
-    /* Copy temp array to target array */
+    /* Rebuild the target existence functions from the temp arrays */
+    hb0->h[0]->nrun = 0;
+    hb0->g[0]->nrun = 0;
     for (m = 0; (m <= nnframes); m++)
     {
-        _set_hb(hb0->h[0], m, htmp[m]);
-        _set_hb(hb0->g[0], m, gtmp[m]);
+        if (htmp[m])
+        {
+            add_hbexist(hb0->h[0], m);
+        }
+        if (gtmp[m])
+        {
+            add_hbexist(hb0->g[0], m);
+        }
     }
 
     /* Set scalar variables */
-    hb0->n0        = nn0;
-    hb0->maxframes = nnframes;
+    hb0->n0      = nn0;
+    hb0->nframes = nnframes;
 }
 
 static void merge_hb(t_hbdata *hb, gmx_bool bTwo, gmx_bool bContact)
@@ -1450,7 +1203,7 @@ static void merge_hb(t_hbdata *hb, gmx_bool bTwo, gmx_bool bContact)
                 hb1 = hb->hbmap[jj][ii];
                 if (hb0 && hb1 && ISHB(hb0->history[0]) && ISHB(hb1->history[0]))
                 {
-                    do_merge(hb, ntmp, htmp, gtmp, hb0, hb1);
+                    do_merge(ntmp, htmp, gtmp, hb0, hb1);
                     if (ISHB(hb1->history[0]))
                     {
                         inrnew--;
@@ -1468,8 +1221,8 @@ static void merge_hb(t_hbdata *hb, gmx_bool bTwo, gmx_bool bContact)
                     {
                         gmx_incons("Neither hydrogen bond nor distance");
                     }
-                    sfree(hb1->h[0]);
-                    sfree(hb1->g[0]);
+                    done_hbexist(hb1->h[0]);
+                    done_hbexist(hb1->g[0]);
                     hb1->h[0]       = nullptr;
                     hb1->g[0]       = nullptr;
                     hb1->history[0] = hbNo;
@@ -1519,9 +1272,9 @@ static void do_hblife(const char *fn, t_hbdata *hb, gmx_bool bMerge, gmx_bool bC
     FILE          *fp;
     const char    *leg[] = { "p(t)", "t p(t)" };
     int           *histo;
-    int            i, j, j0, k, m, nh, ihb, ohb, nhydro, ndump = 0;
+    int            i, j, j0, k, m, nh, nhydro;
     int            nframes = hb->nframes;
-    unsigned int **h;
+    t_hbexist    **h;
     real           t, x1, dt;
     double         sum, integral;
     t_hbond       *hbh;
@@ -1561,30 +1314,14 @@ static void do_hblife(const char *fn, t_hbdata *hb, gmx_bool bMerge, gmx_bool bC
                 }
                 for (nh = 0; (nh < nhydro); nh++)
                 {
-                    ohb = 0;
-                    j0  = 0;
-
-                    for (j = 0; (j <= hbh->nframes); j++)
+                    /* Only periods that are seen to end count */
+                    for (j = 0; (j < h[nh]->nrun); j++)
                     {
-                        ihb      = is_hb(h[nh], j);
-                        if (debug && (ndump < 10))
+                        if (h[nh]->start[j] + h[nh]->length[j] <= hbh->nframes)
                         {
-                            fprintf(debug, "%5d  %5d\n", j, ihb);
-                        }
-                        if (ihb != ohb)
-                        {
-                            if (ihb)
-                            {
-                                j0 = j;
-                            }
-                            else
-                            {
-                                histo[j-j0]++;
-                            }
-                            ohb = ihb;
+                            histo[h[nh]->length[j]]++;
                         }
                     }
-                    ndump++;
                 }
             }
         }
@@ -1656,7 +1393,7 @@ static void dump_ac(t_hbdata *hb, gmx_bool oneHB, int nDump)
                 hbh    = hb->hbmap[i][k];
                 if (oneHB)
                 {
-                    if (hbh->h[0])
+                    if (hbh && hbh->h[0])
                     {
                         ihb    = is_hb(hbh->h[0], j);
                         idist  = is_hb(hbh->g[0], j);
@@ -1665,7 +1402,7 @@ static void dump_ac(t_hbdata *hb, gmx_bool oneHB, int nDump)
                 }
                 else
                 {
-                    for (m = 0; (m < hb->maxhydro) && !ihb; m++)
+                    for (m = 0; (m < hb->maxhydro) && hbh && !ihb; m++)
                     {
                         ihb   = ihb   || ((hbh->h[m]) && is_hb(hbh->h[m], j));
                         idist = idist || ((hbh->g[m]) && is_hb(hbh->g[m], j));
@@ -1928,7 +1665,7 @@ static void do_hbac(const char *fn, t_hbdata *hb,
     real          *ct, tail, tail2, dtail, *cct;
     const real     tol     = 1e-3;
     int            nframes = hb->nframes;
-    unsigned int **h       = nullptr, **g = nullptr;
+    t_hbexist    **h       = nullptr, **g = nullptr;
     int            nh, nhbonds, nhydro;
     t_hbond       *hbh;
     int            acType;
@@ -2519,28 +2256,27 @@ int gmx_hbond(int argc, char *argv[])
     matrix                box;
     real                  t, ccut, dist = 0.0, ang = 0.0;
     double                max_nhb, aver_nhb, aver_dist;
-    int                   h = 0, i = 0, j, k = 0, ogrp, nsel;
-    int                   xi, yi, zi, ai;
-    int                   xj, yj, zj, aj, xjj, yjj, zjj;
-    gmx_bool              bSelected, bHBmap, bStop, bTwo, bBox, bTric;
+    int                   h = 0, i = 0, j, k = 0, ogrp, nsel, ai, aj;
+    gmx_bool              bSelected, bHBmap, bStop, bTwo, bBox;
     int                  *adist, *rdist;
     int                   grp, nabin, nrbin, resdist, ihb;
     char                **leg;
     t_hbdata             *hb;
     FILE                 *fp, *fpnhb = nullptr, *donor_properties = nullptr;
-    t_gridcell         ***grid;
-    t_ncell              *icell, *jcell;
-    ivec                  ngrid;
     unsigned char        *datable;
     gmx_output_env_t     *oenv;
     int                   ii, hh, actual_nThreads;
     int                   threadNr = 0;
     gmx_bool              bParallel;
-    gmx_bool              bEdge_yjj, bEdge_xjj;
 
     t_hbdata            **p_hb    = nullptr;                      /* one per thread, then merge after the frame loop */
     int                 **p_adist = nullptr, **p_rdist = nullptr; /* a histogram for each thread. */
 
+    gmx::AnalysisNeighborhood       nb;
+    gmx::AnalysisNeighborhoodSearch nbsearch[grNR];  /* acceptor search for each donor group */
+    std::vector<int>                searchDon[grNR], searchAcc[grNR];
+    t_pbc                           pbc;
+
     const bool            bOMP = GMX_OPENMP;
 
     npargs = asize(pa);
@@ -2767,7 +2503,10 @@ int gmx_hbond(int argc, char *argv[])
     }
 
     bBox  = (ir->ePBC != epbcNONE);
-    grid  = init_grid(bBox, box, (rcut > r2cut) ? rcut : r2cut, ngrid);
+    /* Only the D-A distance matters for contacts, otherwise the search
+     * is done from the donors or, with -noda, from the hydrogens.
+     */
+    nb.setCutoff(bContact ? std::max(rcut, r2cut) : rcut);
     nabin = static_cast<int>(acut/abin);
     nrbin = static_cast<int>(rcut/rbin);
     snew(adist, nabin+1);
@@ -2821,7 +2560,6 @@ int gmx_hbond(int argc, char *argv[])
 
             p_hb[i]->bHBmap     = hb->bHBmap;
             p_hb[i]->bDAnr      = hb->bDAnr;
-            p_hb[i]->wordlen    = hb->wordlen;
             p_hb[i]->nframes    = hb->nframes;
             p_hb[i]->maxhydro   = hb->maxhydro;
             p_hb[i]->danr       = hb->danr;
@@ -2840,24 +2578,21 @@ int gmx_hbond(int argc, char *argv[])
 
 #pragma omp parallel \
     firstprivate(i) \
-    private(j, h, ii, hh, \
-    xi, yi, zi, xj, yj, zj, threadNr, \
-    dist, ang, icell, jcell, \
-    grp, ogrp, ai, aj, xjj, yjj, zjj, \
+    private(j, h, ii, hh, threadNr, \
+    dist, ang, \
+    grp, ogrp, ai, aj, \
     ihb, resdist, \
-    k, bTric, \
-    bEdge_xjj, bEdge_yjj) \
+    k) \
     default(shared)
     {                           /* Start of parallel region */
+        std::vector<int> candidates;
+
 #if !defined __clang_analyzer__ // clang complains about unused value.
         threadNr = gmx_omp_get_thread_num();
 #endif
 
         do
         {
-
-            bTric = bBox && TRICLINIC(box);
-
             if (bOMP)
             {
                 try
@@ -2870,21 +2605,38 @@ int gmx_hbond(int argc, char *argv[])
             {
                 try
                 {
-                    build_grid(hb, x, x[shatom], bBox, box, hbox, (rcut > r2cut) ? rcut : r2cut,
-                               rshell, ngrid, grid);
+                    select_search_atoms(hb, x, x[shatom], bBox, box, hbox, rshell,
+                                        searchDon, searchAcc);
                     reset_nhbonds(&(hb->d));
 
-                    if (debug && bDebug)
-                    {
-                        dump_grid(debug, ngrid, grid);
-                    }
-
                     add_frames(hb, nframes);
                     init_hbframe(hb, nframes, output_env_conv_time(oenv, t));
 
                     if (hb->bDAnr)
                     {
-                        count_da_grid(ngrid, grid, hb->danr[nframes]);
+                        for (grp = 0; (grp < grNR); grp++)
+                        {
+                            hb->danr[nframes][grp] = searchDon[grp].size();
+                        }
+                    }
+
+                    if (!bSelected)
+                    {
+                        /* Acceptors are the reference positions,
+                         * each thread searches from its own donors.
+                         */
+                        if (bBox)
+                        {
+                            set_pbc(&pbc, ir->ePBC, box);
+                        }
+                        for (grp = gr0; (grp <= (bTwo ? gr1 : gr0)); grp++)
+                        {
+                            ogrp = bTwo ? 1-grp : grp;
+                            nbsearch[grp].reset();
+                            nbsearch[grp] =
+                                nb.initSearch(bBox ? &pbc : nullptr,
+                                              gmx::AnalysisNeighborhoodPositions(x, natoms).indexed(searchAcc[ogrp]));
+                        }
                     }
                 }
                 GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
@@ -2925,117 +2677,97 @@ int gmx_hbond(int argc, char *argv[])
             }     /* if (bSelected) */
             else
             {
-                /* The outer grid loop will have to do for now. */
-#pragma omp for schedule(dynamic)
-                for (xi = 0; xi < ngrid[XX]; xi++)
+                /* loop over donor groups gr0 (always) and gr1 (if necessary) */
+                for (grp = gr0; (grp <= (bTwo ? gr1 : gr0)); grp++)
                 {
-                    try
+                    if (bTwo)
+                    {
+                        ogrp = 1-grp;
+                    }
+                    else
                     {
-                        for (yi = 0; (yi < ngrid[YY]); yi++)
+                        ogrp = grp;
+                    }
+
+                    /* loop over all donors from group (grp) in the search */
+#pragma omp for schedule(dynamic, 16)
+                    for (ai = 0; ai < static_cast<int>(searchDon[grp].size()); ai++)
+                    {
+                        try
                         {
-                            for (zi = 0; (zi < ngrid[ZZ]); zi++)
+                            i = searchDon[grp][ai];
+
+                            /* Find the acceptors from the other group (ogrp)
+                             * within the cut-off of the donor, or of any of
+                             * its hydrogens when using the H-A distance.
+                             */
+                            candidates.clear();
+                            if (bDA || bContact)
                             {
-
-                                /* loop over donor groups gr0 (always) and gr1 (if necessary) */
-                                for (grp = gr0; (grp <= (bTwo ? gr1 : gr0)); grp++)
+                                add_search_acceptors(nbsearch[grp], x[i], searchAcc[ogrp], &candidates);
+                            }
+                            else
+                            {
+                                ii = hb->d.dptr[i];
+                                for (hh = 0; (hh < hb->d.nhydro[ii]); hh++)
                                 {
-                                    icell = &(grid[zi][yi][xi].d[grp]);
+                                    add_search_acceptors(nbsearch[grp], x[hb->d.hydro[ii][hh]],
+                                                         searchAcc[ogrp], &candidates);
+                                }
+                            }
+                            std::sort(candidates.begin(), candidates.end());
+                            candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                                             candidates.end());
 
-                                    if (bTwo)
-                                    {
-                                        ogrp = 1-grp;
-                                    }
-                                    else
-                                    {
-                                        ogrp = grp;
-                                    }
+                            for (aj = 0; (aj < static_cast<int>(candidates.size())); aj++)
+                            {
+                                j = candidates[aj];
 
-                                    /* loop over all hydrogen atoms from group (grp)
-                                     * in this gridcell (icell)
-                                     */
-                                    for (ai = 0; (ai < icell->nr); ai++)
-                                    {
-                                        i  = icell->atoms[ai];
+                                /* check if this once was a h-bond */
+                                ihb  = is_hbond(__HBDATA, grp, ogrp, i, j, rcut, r2cut, ccut, x, bBox, box,
+                                                hbox, &dist, &ang, bDA, &h, bContact, bMerge);
+
+                                if (ihb)
+                                {
+                                    /* add to index if not already there */
+                                    /* Add a hbond */
+                                    add_hbond(__HBDATA, i, j, h, grp, ogrp, nframes, bMerge, ihb, bContact);
 
-                                        /* loop over all adjacent gridcells (xj,yj,zj) */
-                                        for (zjj = grid_loop_begin(ngrid[ZZ], zi, bTric, FALSE);
-                                             zjj <= grid_loop_end(ngrid[ZZ], zi, bTric, FALSE);
-                                             zjj++)
+                                    /* make angle and distance distributions */
+                                    if (ihb == hbHB && !bContact)
+                                    {
+                                        if (dist > rcut)
                                         {
-                                            zj        = grid_mod(zjj, ngrid[ZZ]);
-                                            bEdge_yjj = (zj == 0) || (zj == ngrid[ZZ] - 1);
-                                            for (yjj = grid_loop_begin(ngrid[YY], yi, bTric, bEdge_yjj);
-                                                 yjj <= grid_loop_end(ngrid[YY], yi, bTric, bEdge_yjj);
-                                                 yjj++)
+                                            gmx_fatal(FARGS, "distance is higher than what is allowed for an hbond: %f", dist);
+                                        }
+                                        ang *= RAD2DEG;
+                                        __ADIST[static_cast<int>( ang/abin)]++;
+                                        __RDIST[static_cast<int>(dist/rbin)]++;
+                                        if (!bTwo)
+                                        {
+                                            if (donor_index(&hb->d, grp, i) == NOTSET)
+                                            {
+                                                gmx_fatal(FARGS, "Invalid donor %d", i);
+                                            }
+                                            if (acceptor_index(&hb->a, ogrp, j) == NOTSET)
                                             {
-                                                yj        = grid_mod(yjj, ngrid[YY]);
-                                                bEdge_xjj =
-                                                    (yj == 0) || (yj == ngrid[YY] - 1) ||
-                                                    (zj == 0) || (zj == ngrid[ZZ] - 1);
-                                                for (xjj = grid_loop_begin(ngrid[XX], xi, bTric, bEdge_xjj);
-                                                     xjj <= grid_loop_end(ngrid[XX], xi, bTric, bEdge_xjj);
-                                                     xjj++)
-                                                {
-                                                    xj    = grid_mod(xjj, ngrid[XX]);
-                                                    jcell = &(grid[zj][yj][xj].a[ogrp]);
-                                                    /* loop over acceptor atoms from other group (ogrp)
-                                                     * in this adjacent gridcell (jcell)
-                                                     */
-                                                    for (aj = 0; (aj < jcell->nr); aj++)
-                                                    {
-                                                        j = jcell->atoms[aj];
-
-                                                        /* check if this once was a h-bond */
-                                                        ihb  = is_hbond(__HBDATA, grp, ogrp, i, j, rcut, r2cut, ccut, x, bBox, box,
-                                                                        hbox, &dist, &ang, bDA, &h, bContact, bMerge);
-
-                                                        if (ihb)
-                                                        {
-                                                            /* add to index if not already there */
-                                                            /* Add a hbond */
-                                                            add_hbond(__HBDATA, i, j, h, grp, ogrp, nframes, bMerge, ihb, bContact);
-
-                                                            /* make angle and distance distributions */
-                                                            if (ihb == hbHB && !bContact)
-                                                            {
-                                                                if (dist > rcut)
-                                                                {
-                                                                    gmx_fatal(FARGS, "distance is higher than what is allowed for an hbond: %f", dist);
-                                                                }
-                                                                ang *= RAD2DEG;
-                                                                __ADIST[static_cast<int>( ang/abin)]++;
-                                                                __RDIST[static_cast<int>(dist/rbin)]++;
-                                                                if (!bTwo)
-                                                                {
-                                                                    if (donor_index(&hb->d, grp, i) == NOTSET)
-                                                                    {
-                                                                        gmx_fatal(FARGS, "Invalid donor %d", i);
-                                                                    }
-                                                                    if (acceptor_index(&hb->a, ogrp, j) == NOTSET)
-                                                                    {
-                                                                        gmx_fatal(FARGS, "Invalid acceptor %d", j);
-                                                                    }
-                                                                    resdist = std::abs(top.atoms.atom[i].resind-top.atoms.atom[j].resind);
-                                                                    if (resdist >= max_hx)
-                                                                    {
-                                                                        resdist = max_hx-1;
-                                                                    }
-                                                                    __HBDATA->nhx[nframes][resdist]++;
-                                                                }
-                                                            }
-
-                                                        }
-                                                    } /* for aj  */
-                                                }     /* for xjj */
-                                            }         /* for yjj */
-                                        }             /* for zjj */
-                                    }                 /* for ai  */
-                                }                     /* for grp */
-                            }                         /* for xi,yi,zi */
+                                                gmx_fatal(FARGS, "Invalid acceptor %d", j);
+                                            }
+                                            resdist = std::abs(top.atoms.atom[i].resind-top.atoms.atom[j].resind);
+                                            if (resdist >= max_hx)
+                                            {
+                                                resdist = max_hx-1;
+                                            }
+                                            __HBDATA->nhx[nframes][resdist]++;
+                                        }
+                                    }
+
+                                }
+                            } /* for aj  */
                         }
-                    }
-                    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
-                }
+                        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+                    }     /* for ai  */
+                }         /* for grp */
             } /* if (bSelected) {...} else */
 
 
@@ -3155,8 +2887,6 @@ int gmx_hbond(int argc, char *argv[])
         gmx_fatal(FARGS, "Cannot calculate autocorrelation of life times with less than two frames");
     }
 
-    free_grid(ngrid, &grid);
-
     close_trj(status);
 
     if (donor_properties)
@@ -39,8 +39,12 @@
 #include <cmath>
 #include <cstring>
 
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
+#include "gromacs/correlationfunctions/displacementcorrelation.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xvgr.h"
@@ -54,9 +58,11 @@
 #include "gromacs/topology/index.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/arraysize.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
 #define FACTOR  1000.0  /* Convert nm^2/ps to 10e-5 cm^2/s */
@@ -86,6 +92,7 @@ typedef struct {
     msd_type      type;       /* the type of msd to calculate (lateral, etc.)*/
     int           axis;       /* the axis along which to calculate */
     int           ncoords;
+    gmx_bool      bFFT;       /* all frames are time origins, computed with FFTs */
     int           nrestart;   /* number of restart points */
     int           nmol;       /* number of molecules (for bMol) */
     int           nframes;    /* number of frames */
@@ -120,6 +127,7 @@ t_corr *init_corr(int nrgrp, int type, int axis, real dim_factor,
     curr->type       = (msd_type)type;
     curr->axis       = axis;
     curr->ngrp       = nrgrp;
+    curr->bFFT       = FALSE;
     curr->nrestart   = 0;
     curr->delta_t    = dt;
     curr->beginfit   = (1 - 2*GMX_REAL_EPS)*beginfit;
@@ -184,8 +192,16 @@ static void corr_print(t_corr *curr, gmx_bool bTen, const char *fn, const char *
     out = xvgropen(fn, title, output_env_get_xvgr_tlabel(oenv), yaxis, oenv);
     if (DD)
     {
-        fprintf(out, "# MSD gathered over %g %s with %d restarts\n",
-                msdtime, output_env_get_time_unit(oenv), curr->nrestart);
+        if (curr->bFFT)
+        {
+            fprintf(out, "# MSD gathered over %g %s with all frames as time origins\n",
+                    msdtime, output_env_get_time_unit(oenv));
+        }
+        else
+        {
+            fprintf(out, "# MSD gathered over %g %s with %d restarts\n",
+                    msdtime, output_env_get_time_unit(oenv), curr->nrestart);
+        }
         fprintf(out, "# Diffusion constants fitted from time %g to %g %s\n",
                 beginfit, endfit, output_env_get_time_unit(oenv));
         for (i = 0; i < curr->ngrp; i++)
@@ -833,6 +849,439 @@ int corr_loop(t_corr *curr, const char *fn, const t_topology *top, int ePBC,
     return natoms;
 }
 
+/* A particle in the MSD calculation with -fft: an atom, or the center
+ * of mass of a molecule with -mol.
+ */
+typedef struct {
+    int  grp; /* the group the particle belongs to */
+    int  ind; /* the atom index, or the molecule index with -mol */
+    real w;   /* the weight of the particle in the group average */
+} t_msd_particle;
+
+/* Reads the whole trajectory, removes the periodic boundary crossings
+ * and stores the coordinates of particles p0 to p1 of part in xstore,
+ * with p1-p0 consecutive coordinates for each frame.
+ * With bFirst, also sets the frame times and, for gnx_com != NULL,
+ * the center of mass for each frame, and handles -pdb. Storing then stops,
+ * and xstore is cleared, when it would contain more than maxstore
+ * coordinates (no limit for maxstore = 0).
+ * Returns the number of atoms in the trajectory.
+ */
+static int fft_read_pass(t_corr *curr, const char *fn, const t_topology *top, int ePBC,
+                         gmx_bool bMol, const std::vector<t_msd_particle> &part,
+                         int p0, int p1, gmx_bool bFirst, size_t maxstore,
+                         std::vector<gmx::RVec> *xstore,
+                         int *gnx_com, int *index_com[],
+                         real t_pdb, rvec **x_pdb, matrix box_pdb,
+                         const gmx_output_env_t *oenv)
+{
+    rvec            *x[2];  /* the coordinates to read */
+    rvec            *xa[2]; /* the molecule centers of mass with -mol */
+    std::vector<int> blockind(p1 - p0);
+    real             t, t0, t_prev = 0;
+    int              natoms, i, nblock, nframes = 0, maxframes = 0, cur = 0;
+    t_trxstatus     *status;
+    matrix           box;
+    gmx_bool         bStore = TRUE;
+    gmx_rmpbc_t      gpbc   = nullptr;
+
+    nblock = p1 - p0;
+    for (i = 0; i < nblock; i++)
+    {
+        blockind[i] = part[p0 + i].ind;
+    }
+
+    natoms = read_first_x(oenv, &status, fn, &t0, &(x[cur]), box);
+    snew(x[prev], natoms);
+    if (bMol)
+    {
+        snew(xa[0], nblock);
+        snew(xa[1], nblock);
+        gpbc = gmx_rmpbc_init(&top->idef, ePBC, natoms);
+    }
+    if (bFirst)
+    {
+        curr->t0 = t0;
+        if (x_pdb)
+        {
+            *x_pdb = nullptr;
+        }
+    }
+    xstore->clear();
+
+    t = t0;
+    do
+    {
+        if (bFirst && x_pdb && ((nframes == 0 && t_pdb < t) ||
+                                (nframes > 0 &&
+                                 t_pdb > t - 0.5*(t - t_prev) &&
+                                 t_pdb < t + 0.5*(t - t_prev))))
+        {
+            if (*x_pdb == nullptr)
+            {
+                snew(*x_pdb, natoms);
+            }
+            for (i = 0; i < natoms; i++)
+            {
+                copy_rvec(x[cur][i], (*x_pdb)[i]);
+            }
+            copy_mat(box, box_pdb);
+        }
+
+        /* for the first frame, the previous frame is a copy of the first frame */
+        if (nframes == 0)
+        {
+            std::memcpy(x[prev], x[cur], natoms*sizeof(x[prev][0]));
+        }
+        if (bMol)
+        {
+            gmx_rmpbc(gpbc, natoms, box, x[cur]);
+            calc_mol_com(nblock, blockind.data(), &top->mols, &top->atoms, x[cur], xa[cur]);
+            if (nframes == 0)
+            {
+                std::memcpy(xa[prev], xa[cur], nblock*sizeof(xa[prev][0]));
+            }
+            prep_data(TRUE, nblock, nullptr, xa[cur], xa[prev], box);
+        }
+        else
+        {
+            prep_data(FALSE, nblock, blockind.data(), x[cur], x[prev], box);
+        }
+
+        if (bFirst)
+        {
+            if (nframes >= maxframes)
+            {
+                maxframes += 100;
+                srenew(curr->time, maxframes);
+                if (gnx_com)
+                {
+                    srenew(curr->com, maxframes);
+                }
+            }
+            curr->time[nframes] = t - t0;
+            if (gnx_com)
+            {
+                calc_com(FALSE, gnx_com[0], index_com[0], x[cur], x[prev], box,
+                         &top->atoms, curr->com[nframes]);
+            }
+        }
+
+        if (bStore)
+        {
+            if (maxstore > 0 && xstore->size() + nblock > maxstore)
+            {
+                bStore = FALSE;
+                xstore->clear();
+                xstore->shrink_to_fit();
+            }
+            else
+            {
+                for (i = 0; i < nblock; i++)
+                {
+                    xstore->push_back(bMol ? xa[cur][i] : x[cur][blockind[i]]);
+                }
+            }
+        }
+
+        cur    = prev;
+        t_prev = t;
+        nframes++;
+    }
+    while (read_next_x(oenv, status, &t, x[cur], box));
+
+    if (bFirst)
+    {
+        curr->nframes = nframes;
+    }
+    else if (nframes != curr->nframes)
+    {
+        gmx_fatal(FARGS, "Read %d frames from %s, while the first pass read %d",
+                  nframes, fn, curr->nframes);
+    }
+
+    if (bMol)
+    {
+        gmx_rmpbc_done(gpbc);
+        sfree(xa[0]);
+        sfree(xa[1]);
+    }
+    sfree(x[0]);
+    sfree(x[1]);
+    close_trj(status);
+
+    return natoms;
+}
+
+/* Computes the MSD over all time origins for particles p0 to p1 of part,
+ * with the coordinates stored by fft_read_pass in xstore, and adds it with
+ * the particle weights to sum (and the tensor to summ) for each group
+ * and time lag. The particles are divided over OpenMP threads.
+ */
+static void fft_block_msd(t_corr *curr, gmx_bool bTen,
+                          const std::vector<t_msd_particle> &part, int p0, int p1,
+                          const std::vector<gmx::RVec> &xstore, const rvec *com,
+                          std::vector<double> *sum, std::vector<double> *summ)
+{
+    const int nframes  = curr->nframes;
+    const int nblock   = p1 - p0;
+    const int nthreads = gmx_omp_get_max_threads();
+
+#pragma omp parallel num_threads(nthreads)
+    {
+        try
+        {
+            gmx::DisplacementCorrelation corr(nframes);
+            std::vector<real>            series[DIM];
+            std::vector<real>            comp[DIM][DIM];
+            std::vector<real>            msd(nframes);
+            std::vector<double>          tsum(sum->size(), 0);
+            std::vector<double>          tsumm(summ->size(), 0);
+            int                          d, d2;
+
+            for (d = 0; d < DIM; d++)
+            {
+                series[d].resize(nframes);
+                for (d2 = 0; d2 <= d; d2++)
+                {
+                    comp[d][d2].resize(nframes);
+                }
+            }
+
+#pragma omp for schedule(dynamic, 16)
+            for (int p = p0; p < p1; p++)
+            {
+                const t_msd_particle &mp = part[p];
+                int                   m;
+
+                if (mp.w == 0)
+                {
+                    continue;
+                }
+                for (m = 0; m < nframes; m++)
+                {
+                    const gmx::RVec &xm = xstore[m*nblock + p - p0];
+                    for (d = 0; d < DIM; d++)
+                    {
+                        series[d][m] = xm[d] - (com ? com[m][d] : 0);
+                    }
+                }
+                std::fill(msd.begin(), msd.end(), 0);
+                switch (curr->type)
+                {
+                    case NORMAL:
+                        for (d = 0; d < DIM; d++)
+                        {
+                            if (bTen)
+                            {
+                                for (d2 = 0; d2 <= d; d2++)
+                                {
+                                    std::fill(comp[d][d2].begin(), comp[d][d2].end(), 0);
+                                    corr.add(series[d].data(), series[d2].data(), 1,
+                                             comp[d][d2].data());
+                                }
+                                for (m = 0; m < nframes; m++)
+                                {
+                                    msd[m] += comp[d][d][m];
+                                }
+                            }
+                            else
+                            {
+                                corr.add(series[d].data(), series[d].data(), 1, msd.data());
+                            }
+                        }
+                        break;
+                    case X:
+                    case Y:
+                    case Z:
+                        d = curr->type - X;
+                        corr.add(series[d].data(), series[d].data(), 1, msd.data());
+                        break;
+                    case LATERAL:
+                        for (d = 0; d < DIM; d++)
+                        {
+                            if (d != curr->axis)
+                            {
+                                corr.add(series[d].data(), series[d].data(), 1, msd.data());
+                            }
+                        }
+                        break;
+                    default:
+                        gmx_fatal(FARGS, "Error: did not expect option value %d", curr->type);
+                }
+
+                for (m = 0; m < nframes; m++)
+                {
+                    tsum[mp.grp*nframes + m] += mp.w*msd[m];
+                    if (bTen)
+                    {
+                        for (d = 0; d < DIM; d++)
+                        {
+                            for (d2 = 0; d2 <= d; d2++)
+                            {
+                                tsumm[((mp.grp*nframes + m)*DIM + d)*DIM + d2] +=
+                                    mp.w*comp[d][d2][m];
+                            }
+                        }
+                    }
+                }
+                if (curr->nmol > 0)
+                {
+                    /* Molecular MSD: collect the fit data for this molecule */
+                    for (m = 0; m < nframes; m++)
+                    {
+                        real tt = curr->time[m];
+                        if (tt >= curr->beginfit && (curr->endfit < 0 || tt <= curr->endfit))
+                        {
+                            gmx_stats_add_point(curr->lsq[0][p], tt, msd[m], 0, 0);
+                        }
+                    }
+                }
+            }
+
+#pragma omp critical
+            {
+                for (size_t i = 0; i < tsum.size(); i++)
+                {
+                    (*sum)[i] += tsum[i];
+                }
+                for (size_t i = 0; i < tsumm.size(); i++)
+                {
+                    (*summ)[i] += tsumm[i];
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+}
+
+/* Computes the MSD using all frames as time origins, as an alternative to
+ * corr_loop. For each particle the displacement correlations over all
+ * origins are computed with FFTs, with the particles divided over threads.
+ * The unwrapped coordinates of all particles for all frames are kept in
+ * memory when they fit in maxmem MB; otherwise the trajectory is read
+ * once more for each block of particles that fits.
+ */
+static int corr_loop_fft(t_corr *curr, const char *fn, const t_topology *top, int ePBC,
+                         gmx_bool bMol, int gnx[], int *index[], gmx_bool bTen,
+                         int *gnx_com, int *index_com[], real maxmem,
+                         real t_pdb, rvec **x_pdb, matrix box_pdb,
+                         const gmx_output_env_t *oenv)
+{
+    std::vector<t_msd_particle> part;
+    std::vector<double>         wsum(curr->ngrp, 0);
+    std::vector<gmx::RVec>      xstore;
+    size_t                      maxstore;
+    int                         natoms, npart, nframes, g, i, m, d, d2;
+
+    for (g = 0; g < curr->ngrp; g++)
+    {
+        for (i = 0; i < gnx[g]; i++)
+        {
+            t_msd_particle mp;
+
+            mp.grp = g;
+            mp.ind = index[g][i];
+            mp.w   = 1;
+            if (curr->mass)
+            {
+                mp.w = curr->mass[bMol ? i : mp.ind];
+            }
+            wsum[g] += mp.w;
+            part.push_back(mp);
+        }
+    }
+    npart = part.size();
+
+    curr->bFFT     = TRUE;
+    curr->nrestart = 1;
+    if (bMol)
+    {
+        snew(curr->lsq, 1);
+        snew(curr->lsq[0], curr->nmol);
+        for (i = 0; i < curr->nmol; i++)
+        {
+            curr->lsq[0][i] = gmx_stats_init();
+        }
+    }
+
+    /* maxstore=0 means no limit, so a limit below one coordinate should be 1 */
+    maxstore = 0;
+    if (maxmem > 0)
+    {
+        maxstore = std::max(static_cast<size_t>(maxmem*1024*1024/sizeof(gmx::RVec)),
+                            static_cast<size_t>(1));
+    }
+    natoms   = fft_read_pass(curr, fn, top, ePBC, bMol, part, 0, npart, TRUE, maxstore,
+                             &xstore, gnx_com, index_com, t_pdb, x_pdb, box_pdb, oenv);
+    nframes  = curr->nframes;
+
+    for (m = 2; m < nframes; m++)
+    {
+        if (std::abs(curr->time[m] - m*curr->time[1]) > 1e-3*curr->time[1])
+        {
+            gmx_fatal(FARGS, "With -fft the frames should be equally spaced in time, "
+                      "but frame %d is at time %g instead of %g",
+                      m, curr->time[m], m*curr->time[1]);
+        }
+    }
+
+    std::vector<double> sum(curr->ngrp*nframes, 0);
+    std::vector<double> summ(bTen ? curr->ngrp*nframes*DIM*DIM : 0, 0);
+    const rvec         *com = (gnx_com ? curr->com : nullptr);
+    if (xstore.size() == static_cast<size_t>(npart)*nframes)
+    {
+        fft_block_msd(curr, bTen, part, 0, npart, xstore, com, &sum, &summ);
+    }
+    else
+    {
+        int nblock = std::max(1, static_cast<int>(std::min(maxstore/nframes, static_cast<size_t>(npart))));
+        fprintf(stderr, "\nThe coordinates need more than %g MB (-maxmem), "
+                "reading the trajectory %d more times\n",
+                maxmem, (npart + nblock - 1)/nblock);
+        for (int p0 = 0; p0 < npart; p0 += nblock)
+        {
+            int p1 = std::min(p0 + nblock, npart);
+            fft_read_pass(curr, fn, top, ePBC, bMol, part, p0, p1, FALSE, 0,
+                          &xstore, nullptr, nullptr, 0, nullptr, nullptr, oenv);
+            fft_block_msd(curr, bTen, part, p0, p1, xstore, com, &sum, &summ);
+        }
+    }
+
+    for (g = 0; g < curr->ngrp; g++)
+    {
+        snew(curr->data[g], nframes);
+        snew(curr->ndata[g], nframes);
+        if (bTen)
+        {
+            snew(curr->datam[g], nframes);
+        }
+        for (m = 0; m < nframes; m++)
+        {
+            curr->data[g][m]  = sum[g*nframes + m]/wsum[g];
+            curr->ndata[g][m] = 1;
+            if (bTen)
+            {
+                for (d = 0; d < DIM; d++)
+                {
+                    for (d2 = 0; d2 <= d; d2++)
+                    {
+                        curr->datam[g][m][d][d2] =
+                            summ[((g*nframes + m)*DIM + d)*DIM + d2]/wsum[g];
+                    }
+                }
+            }
+        }
+    }
+
+    fprintf(stderr, "\nUsed all %d frames as time origins over %g %s\n\n",
+            nframes,
+            output_env_conv_time(oenv, curr->time[nframes-1]),
+            output_env_get_time_unit(oenv));
+
+    return natoms;
+}
+
 static void index_atom2mol(int *n, int *index, const t_block *mols)
 {
     int nat, i, nmol, mol, j;
@@ -872,7 +1321,8 @@ void do_corr(const char *trx_file, const char *ndx_file, const char *msd_file,
              int nrgrp, t_topology *top, int ePBC,
              gmx_bool bTen, gmx_bool bMW, gmx_bool bRmCOMM,
              int type, real dim_factor, int axis,
-             real dt, real beginfit, real endfit, const gmx_output_env_t *oenv)
+             real dt, gmx_bool bFFT, real maxmem,
+             real beginfit, real endfit, const gmx_output_env_t *oenv)
 {
     t_corr        *msd;
     int           *gnx;   /* the selected groups' sizes */
@@ -912,11 +1362,21 @@ void do_corr(const char *trx_file, const char *ndx_file, const char *msd_file,
                     mol_file == nullptr ? 0 : gnx[0], bTen, bMW, dt, top,
                     beginfit, endfit);
 
-    nat_trx =
-        corr_loop(msd, trx_file, top, ePBC, mol_file ? gnx[0] : 0, gnx, index,
-                  (mol_file != nullptr) ? calc1_mol : (bMW ? calc1_mw : calc1_norm),
-                  bTen, gnx_com, index_com, dt, t_pdb,
-                  pdb_file ? &x : nullptr, box, oenv);
+    if (bFFT)
+    {
+        nat_trx =
+            corr_loop_fft(msd, trx_file, top, ePBC, mol_file != nullptr, gnx, index,
+                          bTen, gnx_com, index_com, maxmem, t_pdb,
+                          pdb_file ? &x : nullptr, box, oenv);
+    }
+    else
+    {
+        nat_trx =
+            corr_loop(msd, trx_file, top, ePBC, mol_file ? gnx[0] : 0, gnx, index,
+                      (mol_file != nullptr) ? calc1_mol : (bMW ? calc1_mw : calc1_norm),
+                      bTen, gnx_com, index_com, dt, t_pdb,
+                      pdb_file ? &x : nullptr, box, oenv);
+    }
 
     /* Correct for the number of points */
     for (j = 0; (j < msd->ngrp); j++)
@@ -1067,7 +1527,15 @@ int gmx_msd(int argc, char *argv[])
         "Option [TT]-pdb[tt] writes a [REF].pdb[ref] file with the coordinates of the frame",
         "at time [TT]-tpdb[tt] with in the B-factor field the square root of",
         "the diffusion coefficient of the molecule.",
-        "This option implies option [TT]-mol[tt]."
+        "This option implies option [TT]-mol[tt].[PAR]",
+        "With [TT]-fft[tt], every frame is used as a time origin and",
+        "[TT]-trestart[tt] is ignored. The displacements over all origins",
+        "are computed with fast Fourier transforms, which scales as N log N",
+        "with the number of frames N, and the atoms or molecules are divided",
+        "over OpenMP threads. The frames should be equally spaced in time.",
+        "The unwrapped coordinates are stored in memory up to [TT]-maxmem[tt]",
+        "MB; when more is needed, the trajectory is read again for each",
+        "block of atoms or molecules that fits."
     };
     static const char *normtype[] = { nullptr, "no", "x", "y", "z", nullptr };
     static const char *axtitle[]  = { nullptr, "no", "x", "y", "z", nullptr };
@@ -1079,6 +1547,8 @@ int gmx_msd(int argc, char *argv[])
     static gmx_bool    bTen       = FALSE;
     static gmx_bool    bMW        = TRUE;
     static gmx_bool    bRmCOMM    = FALSE;
+    static gmx_bool    bFFT       = FALSE;
+    static real        maxmem     = 2048;
     t_pargs            pa[]       = {
         { "-type",    FALSE, etENUM, {normtype},
           "Compute diffusion coefficient in one direction" },
@@ -1096,6 +1566,10 @@ int gmx_msd(int argc, char *argv[])
           "The frame to use for option [TT]-pdb[tt] (%t)" },
         { "-trestart", FALSE, etTIME, {&dt},
           "Time between restarting points in trajectory (%t)" },
+        { "-fft", FALSE, etBOOL, {&bFFT},
+          "Use all frames as time origins, computed with FFTs" },
+        { "-maxmem", FALSE, etREAL, {&maxmem},
+          "Memory (MB) for storing coordinates with [TT]-fft[tt], 0 is no limit" },
         { "-beginfit", FALSE, etTIME, {&beginfit},
           "Start time for fitting the MSD (%t), -1 is 10%" },
         { "-endfit", FALSE, etTIME, {&endfit},
@@ -1197,7 +1671,8 @@ int gmx_msd(int argc, char *argv[])
     }
 
     do_corr(trx_file, ndx_file, msd_file, mol_file, pdb_file, t_pdb, ngroup,
-            &top, ePBC, bTen, bMW, bRmCOMM, type, dim_factor, axis, dt, beginfit, endfit,
+            &top, ePBC, bTen, bMW, bRmCOMM, type, dim_factor, axis, dt, bFFT, maxmem,
+            beginfit, endfit,
             oenv);
 
     view_all(oenv, NFILE, fnm);
@@ -0,0 +1,188 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx msd -fft
+ *
+ * The MSD computed with FFTs over all time origins is compared with
+ * a direct sum over all origins for a random walk, both with all
+ * coordinates in memory and with reading the trajectory once per
+ * particle block.
+ */
+
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/xvgr.h"
+#include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/random/normaldistribution.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/integrationtests.h"
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+//! Number of frames in the random walk trajectory.
+const int  c_frameCount = 40;
+//! Time between frames in ps.
+const real c_timeStep   = 0.5;
+
+//! Test fixture running gmx msd -fft on a random walk.
+class GmxMsdFft : public gmx::test::IntegrationTestFixture
+{
+    public:
+        GmxMsdFft() : groFileName_(fileManager_.getInputFilePath("spc2.gro")),
+                      trrFileName_(fileManager_.getTemporaryFilePath("walk.trr")),
+                      natoms_(6)
+        {
+            writeRandomWalk();
+        }
+
+        //! Writes a random walk of the atoms in spc2.gro to the trajectory.
+        void writeRandomWalk()
+        {
+            gmx::ThreeFry2x64<64>         rng(2017, gmx::RandomDomain::Other);
+            gmx::NormalDistribution<real> dist(0, 0.05);
+            const matrix                  box = {{ 3.01, 0, 0 }, { 0, 3.01, 0 }, { 0, 0, 3.01 }};
+            std::vector<gmx::RVec>        x(natoms_, gmx::RVec(1.5, 1.5, 1.5));
+
+            t_fileio *fio = gmx_trr_open(trrFileName_.c_str(), "w");
+            for (int frame = 0; frame < c_frameCount; frame++)
+            {
+                gmx_trr_write_frame(fio, frame, frame*c_timeStep, 0, box, natoms_,
+                                    as_rvec_array(x.data()), nullptr, nullptr);
+                x_.insert(x_.end(), x.begin(), x.end());
+                for (gmx::RVec &xi : x)
+                {
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        xi[d] += dist(rng);
+                    }
+                }
+            }
+            gmx_trr_close(fio);
+        }
+
+        //! Returns the MSD averaged over all atoms and time origins.
+        std::vector<double> referenceMsd() const
+        {
+            std::vector<double> msd(c_frameCount, 0);
+            for (int lag = 0; lag < c_frameCount; lag++)
+            {
+                for (int t0 = 0; t0 + lag < c_frameCount; t0++)
+                {
+                    for (int i = 0; i < natoms_; i++)
+                    {
+                        const gmx::RVec &x0 = x_[t0*natoms_ + i];
+                        const gmx::RVec &x1 = x_[(t0 + lag)*natoms_ + i];
+                        for (int d = 0; d < DIM; d++)
+                        {
+                            msd[lag] += (x1[d] - x0[d])*(x1[d] - x0[d]);
+                        }
+                    }
+                }
+                msd[lag] /= natoms_*(c_frameCount - lag);
+            }
+            return msd;
+        }
+
+        //! Runs gmx msd -fft with -maxmem \p maxmem and checks the result.
+        void runTest(double maxmem)
+        {
+            const std::string      xvgFileName = fileManager_.getTemporaryFilePath("msd.xvg");
+            gmx::test::CommandLine caller;
+            caller.append("msd");
+            caller.addOption("-s", groFileName_);
+            caller.addOption("-f", trrFileName_);
+            caller.addOption("-o", xvgFileName);
+            caller.append("-fft");
+            caller.append("-nomw");
+            caller.addOption("-maxmem", maxmem);
+
+            redirectStringToStdin("0\n");
+
+            ASSERT_EQ(0, gmx_msd(caller.argc(), caller.argv()));
+
+            double **y  = nullptr;
+            int      ny = 0;
+            int      nx = read_xvg(xvgFileName.c_str(), &y, &ny);
+            ASSERT_EQ(c_frameCount, nx);
+            ASSERT_EQ(2, ny);
+
+            std::vector<double> msd = referenceMsd();
+            for (int frame = 0; frame < c_frameCount; frame++)
+            {
+                EXPECT_REAL_EQ_TOL(frame*c_timeStep, y[0][frame],
+                                   gmx::test::absoluteTolerance(1e-4));
+                EXPECT_REAL_EQ_TOL(msd[frame], y[1][frame],
+                                   gmx::test::relativeToleranceAsFloatingPoint(msd[c_frameCount - 1], 1e-4))
+                << "lag " << frame;
+            }
+            for (int i = 0; i < ny; i++)
+            {
+                sfree(y[i]);
+            }
+            sfree(y);
+        }
+
+        std::string            groFileName_;
+        std::string            trrFileName_;
+        int                    natoms_;
+        //! Coordinates of all frames, frame by frame.
+        std::vector<gmx::RVec> x_;
+};
+
+TEST_F(GmxMsdFft, MatchesDirectSumInMemory)
+{
+    runTest(2048);
+}
+
+TEST_F(GmxMsdFft, MatchesDirectSumWithMultiplePasses)
+{
+    // Room for fewer coordinates than one particle has frames, so each
+    // particle needs a separate pass over the trajectory.
+    runTest(1e-5);
+}
+
+} // namespace
@@ -45,6 +45,10 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <thread>
+
+#include "thread_mpi/atomic.h"
+
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/utility/basenetwork.h"
@@ -162,6 +166,220 @@ t_commrec *reinitialize_commrec_for_this_thread(const t_commrec gmx_unused *cro)
 #endif
 }
 
+/* Whether the intra-node step of the two step summing can use MPI-3
+ * shared-memory windows. With thread-MPI there is no two step summing.
+ */
+#if GMX_LIB_MPI && defined MPI_VERSION && MPI_VERSION >= 3
+#define GMX_NODECOMM_SHM 1
+#else
+#define GMX_NODECOMM_SHM 0
+#endif
+
+#if GMX_NODECOMM_SHM
+
+/* Synchronization counters at the start of the segment of each rank.
+ * Only those of intra-node rank 0 are used. They are on separate
+ * cache lines to avoid false sharing.
+ */
+struct NodecommShmHeader
+{
+    tMPI_Atomic_t arrived;   /* The number of ranks that stored their data */
+    char          pad0[64];
+    tMPI_Atomic_t published; /* Counts the sums made available by rank 0 */
+    char          pad1[64];
+};
+
+/* Intra-node summing through a window shared by the ranks in comm_intra.
+ * Each rank stores its contribution in its own segment and increments
+ * the arrived counter of rank 0. Rank 0 sums the contributions, sums
+ * over the nodes and stores the result behind its own input, after
+ * which it increments the published counter that the other ranks wait on.
+ * This replaces the MPI_Reduce plus MPI_Bcast pair by two one-way
+ * synchronizations through memory.
+ */
+struct gmx_nodecomm_shm_t
+{
+    int       nrank;     /* The number of ranks in comm_intra */
+    MPI_Win   win;       /* The shared-memory window, MPI_WIN_NULL when not allocated */
+    int       nalloc;    /* The number of doubles per input and result buffer */
+    char    **base;      /* The segment of each rank in comm_intra */
+};
+
+/* Returns the size in bytes of the segment of each rank */
+static size_t nodecomm_shm_segment_size(int nalloc)
+{
+    /* Room for the header, the input and, only used by rank 0, the result */
+    return sizeof(NodecommShmHeader) + 2*nalloc*sizeof(double);
+}
+
+static NodecommShmHeader *nodecomm_shm_header(const gmx_nodecomm_shm_t *shm, int rank)
+{
+    return reinterpret_cast<NodecommShmHeader *>(shm->base[rank]);
+}
+
+static double *nodecomm_shm_input(const gmx_nodecomm_shm_t *shm, int rank)
+{
+    return reinterpret_cast<double *>(shm->base[rank] + sizeof(NodecommShmHeader));
+}
+
+static double *nodecomm_shm_result(const gmx_nodecomm_shm_t *shm)
+{
+    return nodecomm_shm_input(shm, 0) + shm->nalloc;
+}
+
+/* Makes sure the shared buffers can hold nr doubles.
+ * This is collective over comm_intra, which is fine since all ranks
+ * call gmx_sumd with the same nr.
+ */
+static void nodecomm_shm_reserve(gmx_nodecomm_shm_t *shm, MPI_Comm comm_intra, int nr)
+{
+    if (nr <= shm->nalloc)
+    {
+        return;
+    }
+
+    if (shm->win != MPI_WIN_NULL)
+    {
+        /* Make sure all ranks have read the previous result */
+        MPI_Barrier(comm_intra);
+        MPI_Win_unlock_all(shm->win);
+        MPI_Win_free(&shm->win);
+    }
+
+    shm->nalloc = over_alloc_small(nr);
+
+    size_t  size = nodecomm_shm_segment_size(shm->nalloc);
+    char   *localBase;
+    MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, comm_intra,
+                            &localBase, &shm->win);
+    MPI_Win_lock_all(0, shm->win);
+    std::memset(localBase, 0, size);
+    for (int rank = 0; rank < shm->nrank; rank++)
+    {
+        MPI_Aint segmentSize;
+        int      dispUnit;
+        MPI_Win_shared_query(shm->win, rank, &segmentSize, &dispUnit, &shm->base[rank]);
+    }
+    MPI_Win_sync(shm->win);
+    MPI_Barrier(comm_intra);
+}
+
+/* Waits after this many polls of a counter yield the core */
+static const int c_nodecommShmSpinCount = 1000;
+
+/* Called for each poll of a counter, yields once we waited for long */
+static void nodecomm_shm_backoff(int *npoll)
+{
+    if (*npoll < c_nodecommShmSpinCount)
+    {
+        (*npoll)++;
+    }
+    else
+    {
+        std::this_thread::yield();
+    }
+}
+
+/* Sums r over all ranks using shared memory within the node */
+static void nodecomm_shm_sumd(int nr, double r[], const gmx_nodecomm_t *nc)
+{
+    gmx_nodecomm_shm_t *shm = nc->shm;
+
+    nodecomm_shm_reserve(shm, nc->comm_intra, nr);
+
+    NodecommShmHeader *hdr   = nodecomm_shm_header(shm, 0);
+    int                npoll = 0;
+
+    if (nc->rank_intra == 0)
+    {
+        /* Wait for the contributions of the other ranks */
+        while (tMPI_Atomic_get(reinterpret_cast<volatile tMPI_Atomic_t *>(&hdr->arrived)) < shm->nrank - 1)
+        {
+            nodecomm_shm_backoff(&npoll);
+        }
+        tMPI_Atomic_set(&hdr->arrived, 0);
+        tMPI_Atomic_memory_barrier();
+        for (int rank = 1; rank < shm->nrank; rank++)
+        {
+            const double *in = nodecomm_shm_input(shm, rank);
+            for (int i = 0; i < nr; i++)
+            {
+                r[i] += in[i];
+            }
+        }
+        /* Sum the roots of the internal (intra) buffers. */
+        MPI_Allreduce(MPI_IN_PLACE, r, nr, MPI_DOUBLE, MPI_SUM,
+                      nc->comm_inter);
+        /* The other ranks are waiting in this call, so they have all
+         * finished reading the result of the previous call.
+         */
+        std::memcpy(nodecomm_shm_result(shm), r, nr*sizeof(double));
+        tMPI_Atomic_memory_barrier();
+        tMPI_Atomic_fetch_add(&hdr->published, 1);
+    }
+    else
+    {
+        /* Read the counter before signaling, so we can not miss the update */
+        int npublished = tMPI_Atomic_get(&hdr->published);
+        std::memcpy(nodecomm_shm_input(shm, nc->rank_intra), r, nr*sizeof(double));
+        tMPI_Atomic_memory_barrier();
+        tMPI_Atomic_fetch_add(&hdr->arrived, 1);
+        while (tMPI_Atomic_get(reinterpret_cast<volatile tMPI_Atomic_t *>(&hdr->published)) == npublished)
+        {
+            nodecomm_shm_backoff(&npoll);
+        }
+        tMPI_Atomic_memory_barrier();
+        std::memcpy(r, nodecomm_shm_result(shm), nr*sizeof(double));
+    }
+}
+
+/* Sets up shared-memory summing within the node, when possible */
+static void nodecomm_shm_init(FILE *fplog, gmx_nodecomm_t *nc)
+{
+    nc->shm = nullptr;
+
+    if (getenv("GMX_NO_NODECOMM_SHM") != nullptr)
+    {
+        return;
+    }
+
+    /* comm_intra is split on the physical node hash, check that
+     * all its ranks can actually share memory.
+     */
+    MPI_Comm comm_shared;
+    int      nrank, nrank_shared, bShared;
+    MPI_Comm_size(nc->comm_intra, &nrank);
+    MPI_Comm_split_type(nc->comm_intra, MPI_COMM_TYPE_SHARED, 0,
+                        MPI_INFO_NULL, &comm_shared);
+    MPI_Comm_size(comm_shared, &nrank_shared);
+    MPI_Comm_free(&comm_shared);
+    bShared = (nrank_shared == nrank);
+    /* All ranks should take the same decision */
+    MPI_Allreduce(MPI_IN_PLACE, &bShared, 1, MPI_INT, MPI_LAND, nc->comm_intra);
+    if (nc->rank_intra == 0)
+    {
+        MPI_Allreduce(MPI_IN_PLACE, &bShared, 1, MPI_INT, MPI_LAND, nc->comm_inter);
+    }
+    MPI_Bcast(&bShared, 1, MPI_INT, 0, nc->comm_intra);
+    if (!bShared || nrank == 1)
+    {
+        return;
+    }
+
+    snew(nc->shm, 1);
+    nc->shm->nrank  = nrank;
+    nc->shm->win    = MPI_WIN_NULL;
+    nc->shm->nalloc = 0;
+    snew(nc->shm->base, nrank);
+
+    if (fplog)
+    {
+        fprintf(fplog, "Using shared memory for the intra-node summing step\n\n");
+    }
+}
+
+#endif /* GMX_NODECOMM_SHM */
+
 void gmx_setup_nodecomm(FILE gmx_unused *fplog, t_commrec *cr)
 {
     gmx_nodecomm_t *nc;
@@ -180,6 +398,7 @@ void gmx_setup_nodecomm(FILE gmx_unused *fplog, t_commrec *cr)
     nc = &cr->nc;
 
     nc->bUse = FALSE;
+    nc->shm  = nullptr;
 #if !GMX_THREAD_MPI
 #if GMX_MPI
     int n, rank;
@@ -228,6 +447,10 @@ void gmx_setup_nodecomm(FILE gmx_unused *fplog, t_commrec *cr)
             fprintf(fplog, "Using two step summing over %d groups of on average %.1f ranks\n\n",
                     ng, (real)n/(real)ng);
         }
+#if GMX_NODECOMM_SHM
+        /* Here comm_inter is still valid on all ranks */
+        nodecomm_shm_init(fplog, nc);
+#endif
         if (nc->rank_intra > 0)
         {
             MPI_Comm_free(&nc->comm_inter);
@@ -250,6 +473,37 @@ void gmx_setup_nodecomm(FILE gmx_unused *fplog, t_commrec *cr)
 #endif
 }
 
+void gmx_done_nodecomm(t_commrec gmx_unused *cr)
+{
+#if GMX_MPI && !GMX_THREAD_MPI
+    gmx_nodecomm_t *nc = &cr->nc;
+
+    if (!nc->bUse)
+    {
+        return;
+    }
+
+#if GMX_NODECOMM_SHM
+    if (nc->shm != nullptr)
+    {
+        if (nc->shm->win != MPI_WIN_NULL)
+        {
+            MPI_Win_unlock_all(nc->shm->win);
+            MPI_Win_free(&nc->shm->win);
+        }
+        sfree(nc->shm->base);
+        sfree(nc->shm);
+    }
+#endif
+    if (nc->rank_intra == 0)
+    {
+        MPI_Comm_free(&nc->comm_inter);
+    }
+    MPI_Comm_free(&nc->comm_intra);
+    nc->bUse = FALSE;
+#endif
+}
+
 void gmx_init_intranode_counters(t_commrec *cr)
 {
     /* counters for PP+PME and PP-only processes on my physical node */
@@ -370,6 +624,14 @@ void gmx_sumd(int gmx_unused nr, double gmx_unused r[], const t_commrec gmx_unus
 #if !GMX_MPI
     gmx_call("gmx_sumd");
 #else
+#if GMX_NODECOMM_SHM
+    if (cr->nc.bUse && cr->nc.shm != nullptr)
+    {
+        /* Two step summing with the intra-node step through shared memory */
+        nodecomm_shm_sumd(nr, r, &cr->nc);
+        return;
+    }
+#endif
 #if MPI_IN_PLACE_EXISTS
     if (cr->nc.bUse)
     {
@@ -38,9 +38,12 @@
 
 #include "nb_free_energy.h"
 
+#include "config.h"
+
 #include <cmath>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/gmxlib/nrnb.h"
 #include "gromacs/gmxlib/nonbonded/nb_kernel.h"
@@ -49,8 +52,557 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/mdtypes/forcerec.h"
 #include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/utility/fatalerror.h"
 
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Returns whether the SIMD free-energy kernel supports the setup in \p fr
+ *
+ * The SIMD kernel handles the common Verlet setups: (Ewald or reaction-field)
+ * electrostatics with plain Lennard-Jones, no potential-switch modifiers and
+ * soft-core with sc-r-power=6. All other setups use the generic kernel.
+ */
+static bool fep_simd_kernel_supported(const t_forcerec *fr)
+{
+    const interaction_const_t *ic = fr->ic;
+
+    return (fr->use_simd_kernels &&
+            fr->cutoff_scheme == ecutsVERLET &&
+            (ic->eeltype == eelCUT || EEL_RF(ic->eeltype) || EEL_PME_EWALD(ic->eeltype)) &&
+            fr->coulomb_modifier != eintmodPOTSWITCH &&
+            !EVDW_PME(ic->vdwtype) &&
+            fr->vdw_modifier != eintmodPOTSWITCH &&
+            fr->sc_r_power == 6);
+}
+
+/*! \brief Adds the i-particle force, shift force and energies of i-entry \p n to the output */
+static inline void
+add_fep_i_entry_output(const t_nblist *nlist, int n,
+                       real fix, real fiy, real fiz, real vctot, real vvtot,
+                       int flags, real *f, real *fshift, real *Vc, real *Vv)
+{
+    if (flags & GMX_NONBONDED_DO_FORCE)
+    {
+        int ii3 = 3*nlist->iinr[n];
+#pragma omp atomic
+        f[ii3]        += fix;
+#pragma omp atomic
+        f[ii3+1]      += fiy;
+#pragma omp atomic
+        f[ii3+2]      += fiz;
+    }
+    if (flags & GMX_NONBONDED_DO_SHIFTFORCE)
+    {
+        int is3 = 3*nlist->shift[n];
+#pragma omp atomic
+        fshift[is3]   += fix;
+#pragma omp atomic
+        fshift[is3+1] += fiy;
+#pragma omp atomic
+        fshift[is3+2] += fiz;
+    }
+    if (flags & GMX_NONBONDED_DO_POTENTIAL)
+    {
+        int ggid = nlist->gid[n];
+#pragma omp atomic
+        Vc[ggid]      += vctot;
+#pragma omp atomic
+        Vv[ggid]      += vvtot;
+    }
+}
+
+/*! \brief SIMD version of gmx_nb_free_energy_kernel for the setups accepted by fep_simd_kernel_supported
+ *
+ * The perturbed pairs of all i-entries are streamed into SIMD lanes,
+ * so the lanes are also filled for the many i-entries of non-perturbed
+ * atoms that only have a few perturbed j-atoms. Pairs beyond the cut-off
+ * are dropped while filling the lanes. The pair parameters are stored
+ * in structure-of-arrays buffers, the interactions of both states are
+ * computed in SIMD and the forces and energies are reduced per i-entry
+ * in a scalar pass using atomics, as in the generic kernel.
+ * With GMX_NONBONDED_DO_MULTILAMBDA only the total potential is computed,
+ * for all lambda points in one pass over the pairs.
+ */
+static void
+nb_free_energy_kernel_simd(const t_nblist * gmx_restrict    nlist,
+                           rvec * gmx_restrict              xx,
+                           rvec * gmx_restrict              ff,
+                           t_forcerec * gmx_restrict        fr,
+                           const t_mdatoms * gmx_restrict   mdatoms,
+                           nb_kernel_data_t * gmx_restrict  kernel_data,
+                           t_nrnb * gmx_restrict            nrnb)
+{
+    using namespace gmx;
+
+#define  STATE_A  0
+#define  STATE_B  1
+#define  NSTATES  2
+    const interaction_const_t *ic           = fr->ic;
+    const int                  nri          = nlist->nri;
+    const int                 *iinr         = nlist->iinr;
+    const int                 *jindex       = nlist->jindex;
+    const int                 *jjnr         = nlist->jjnr;
+    const int                 *shift        = nlist->shift;
+    const real                *shiftvec     = fr->shift_vec[0];
+    const real                *x            = xx[0];
+    real                      *f            = ff[0];
+    real                      *fshift       = fr->fshift[0];
+    const real                *chargeA      = mdatoms->chargeA;
+    const real                *chargeB      = mdatoms->chargeB;
+    const int                 *typeA        = mdatoms->typeA;
+    const int                 *typeB        = mdatoms->typeB;
+    const int                  ntype        = fr->ntype;
+    const real                *nbfp         = fr->nbfp;
+    const real                 facel        = fr->epsfac;
+    const int                  flags        = kernel_data->flags;
+    const bool                 bDoForces    = (flags & GMX_NONBONDED_DO_FORCE);
+    const bool                 bEwald       = EEL_PME_EWALD(ic->eeltype);
+    const real                 lam_power    = fr->sc_power;
+    const real                 sc_r_power   = fr->sc_r_power;
+    const real                 rcutoff_max2 = gmx::square(std::max(fr->rcoulomb, fr->rvdw));
+
+    real                       LFC[NSTATES], LFV[NSTATES], DLF[NSTATES];
+    real                       lfac_coul[NSTATES], dlfac_coul[NSTATES];
+    real                       lfac_vdw[NSTATES], dlfac_vdw[NSTATES];
+
+    LFC[STATE_A] = 1 - kernel_data->lambda[efptCOUL];
+    LFV[STATE_A] = 1 - kernel_data->lambda[efptVDW];
+    LFC[STATE_B] = kernel_data->lambda[efptCOUL];
+    LFV[STATE_B] = kernel_data->lambda[efptVDW];
+    DLF[STATE_A] = -1;
+    DLF[STATE_B] = 1;
+
+    for (int i = 0; i < NSTATES; i++)
+    {
+        lfac_coul[i]  = (lam_power == 2 ? (1-LFC[i])*(1-LFC[i]) : (1-LFC[i]));
+        dlfac_coul[i] = DLF[i]*lam_power/sc_r_power*(lam_power == 2 ? (1-LFC[i]) : 1);
+        lfac_vdw[i]   = (lam_power == 2 ? (1-LFV[i])*(1-LFV[i]) : (1-LFV[i]));
+        dlfac_vdw[i]  = DLF[i]*lam_power/sc_r_power*(lam_power == 2 ? (1-LFV[i]) : 1);
+    }
+
+    /* With GMX_NONBONDED_DO_MULTILAMBDA we only compute potentials, at all
+     * lambda points. Pairs without soft-core and the exclusion and Ewald
+     * corrections are linear in lambda, so for these we accumulate the
+     * A and B state potentials and interpolate at the end.
+     */
+    const bool          bMultiLambda = (flags & GMX_NONBONDED_DO_MULTILAMBDA);
+    const int           nlambda      = (bMultiLambda ? kernel_data->nlambda_multi : 0);
+    std::vector<real>   LFC_multi(nlambda*NSTATES), LFV_multi(nlambda*NSTATES);
+    std::vector<real>   lfac_coul_multi(nlambda*NSTATES), lfac_vdw_multi(nlambda*NSTATES);
+    std::vector<double> energy_sc(nlambda, 0.0);
+    double              energy_lin_coul[NSTATES] = { 0 }, energy_lin_vdw[NSTATES] = { 0 };
+
+    for (int l = 0; l < nlambda; l++)
+    {
+        const real *lambda = kernel_data->lambda_multi + l*efptNR;
+
+        LFC_multi[l*NSTATES+STATE_A] = 1 - lambda[efptCOUL];
+        LFV_multi[l*NSTATES+STATE_A] = 1 - lambda[efptVDW];
+        LFC_multi[l*NSTATES+STATE_B] = lambda[efptCOUL];
+        LFV_multi[l*NSTATES+STATE_B] = lambda[efptVDW];
+        for (int i = 0; i < NSTATES; i++)
+        {
+            real lfc = 1 - LFC_multi[l*NSTATES+i];
+            real lfv = 1 - LFV_multi[l*NSTATES+i];
+
+            lfac_coul_multi[l*NSTATES+i] = (lam_power == 2 ? lfc*lfc : lfc);
+            lfac_vdw_multi[l*NSTATES+i]  = (lam_power == 2 ? lfv*lfv : lfv);
+        }
+    }
+
+    const SimdReal zero_S(0.0);
+    const SimdReal one_S(1.0);
+    const SimdReal half_S(0.5);
+    const SimdReal onesixth_S(1.0/6.0);
+    const SimdReal onetwelfth_S(1.0/12.0);
+    const SimdReal rcoulomb2_S(fr->rcoulomb*fr->rcoulomb);
+    /* With sc-r-power=6 we compare r_sc^-6 to avoid taking roots */
+    const SimdReal rpinv_coul_cut_S(1/gmx::power6(fr->rcoulomb));
+    const SimdReal rpinv_vdw_cut_S(1/gmx::power6(fr->rvdw));
+    const SimdReal krf_S(fr->k_rf);
+    const SimdReal two_krf_S(2*fr->k_rf);
+    const SimdReal crf_S(fr->c_rf);
+    const SimdReal sh_ewald_S(ic->sh_ewald);
+    const SimdReal beta_S(ic->ewaldcoeff_q);
+    const SimdReal beta2_S(ic->ewaldcoeff_q*ic->ewaldcoeff_q);
+    const SimdReal beta3_S(ic->ewaldcoeff_q*ic->ewaldcoeff_q*ic->ewaldcoeff_q);
+    const SimdReal sh_invrc6_S(ic->sh_invrc6);
+    const SimdReal sh_invrc12_S(ic->sh_invrc6*ic->sh_invrc6);
+    const SimdReal alpha_coul_S(fr->sc_alphacoul);
+    const SimdReal alpha_vdw_S(fr->sc_alphavdw);
+    const SimdReal sigma6_def_S(fr->sc_sigma6_def);
+    const SimdReal sigma6_min_S(fr->sc_sigma6_min);
+    SimdReal       LFC_S[NSTATES], LFV_S[NSTATES], DLF_S[NSTATES];
+    SimdReal       lfac_coul_S[NSTATES], dlfac_coul_S[NSTATES];
+    SimdReal       lfac_vdw_S[NSTATES], dlfac_vdw_S[NSTATES];
+
+    for (int i = 0; i < NSTATES; i++)
+    {
+        LFC_S[i]        = SimdReal(LFC[i]);
+        LFV_S[i]        = SimdReal(LFV[i]);
+        DLF_S[i]        = SimdReal(DLF[i]);
+        lfac_coul_S[i]  = SimdReal(lfac_coul[i]);
+        dlfac_coul_S[i] = SimdReal(dlfac_coul[i]);
+        lfac_vdw_S[i]   = SimdReal(lfac_vdw[i]);
+        dlfac_vdw_S[i]  = SimdReal(dlfac_vdw[i]);
+    }
+
+    /* Pair data for the SIMD lanes */
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) dx[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) dy[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) dz[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) qq[NSTATES*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) c6[NSTATES*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) c12[NSTATES*GMX_SIMD_REAL_WIDTH];
+    /* 1 for interacting pairs, 0 for excluded pairs */
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) interact[GMX_SIMD_REAL_WIDTH];
+    /* 0.5 for self-pairs, which occur twice, 1 otherwise */
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) selfscale[GMX_SIMD_REAL_WIDTH];
+    /* Output of the SIMD lanes */
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) fscal[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) vcoul[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) vvdw[GMX_SIMD_REAL_WIDTH];
+    int                                    entry[GMX_SIMD_REAL_WIDTH];
+    int                                    jatom[GMX_SIMD_REAL_WIDTH];
+
+    /* Data of the i-entry which is being streamed into the lanes */
+    int    ii   = 0, ntiA = 0, ntiB = 0;
+    real   ix   = 0, iy   = 0, iz   = 0, iqA = 0, iqB = 0;
+    /* Output accumulation of the i-entry which is being reduced */
+    int    nout = -1;
+    real   fix  = 0, fiy  = 0, fiz  = 0, vctot = 0, vvtot = 0;
+    double dvdl_coul = 0, dvdl_vdw = 0;
+
+    int    n        = 0;
+    int    k        = (nri > 0 ? jindex[0] : 0);
+    bool   newEntry = true;
+    while (n < nri)
+    {
+        /* Fill the lanes with the next pairs within the cut-off */
+        int nlane = 0;
+        while (n < nri && nlane < GMX_SIMD_REAL_WIDTH)
+        {
+            if (k == jindex[n+1])
+            {
+                n++;
+                newEntry = true;
+                continue;
+            }
+            if (newEntry)
+            {
+                int is3  = 3*shift[n];
+                ii       = iinr[n];
+                ix       = shiftvec[is3]   + x[3*ii];
+                iy       = shiftvec[is3+1] + x[3*ii+1];
+                iz       = shiftvec[is3+2] + x[3*ii+2];
+                iqA      = facel*chargeA[ii];
+                iqB      = facel*chargeB[ii];
+                ntiA     = 2*ntype*typeA[ii];
+                ntiB     = 2*ntype*typeB[ii];
+                newEntry = false;
+            }
+
+            int  jnr = jjnr[k];
+            real dxl = ix - x[3*jnr];
+            real dyl = iy - x[3*jnr+1];
+            real dzl = iz - x[3*jnr+2];
+            if (dxl*dxl + dyl*dyl + dzl*dzl < rcutoff_max2)
+            {
+                int tjA = ntiA + 2*typeA[jnr];
+                int tjB = ntiB + 2*typeB[jnr];
+
+                dx[nlane]                             = dxl;
+                dy[nlane]                             = dyl;
+                dz[nlane]                             = dzl;
+                qq[STATE_A*GMX_SIMD_REAL_WIDTH+nlane]  = iqA*chargeA[jnr];
+                qq[STATE_B*GMX_SIMD_REAL_WIDTH+nlane]  = iqB*chargeB[jnr];
+                c6[STATE_A*GMX_SIMD_REAL_WIDTH+nlane]  = nbfp[tjA];
+                c6[STATE_B*GMX_SIMD_REAL_WIDTH+nlane]  = nbfp[tjB];
+                c12[STATE_A*GMX_SIMD_REAL_WIDTH+nlane] = nbfp[tjA+1];
+                c12[STATE_B*GMX_SIMD_REAL_WIDTH+nlane] = nbfp[tjB+1];
+                interact[nlane]                       = (nlist->excl_fep == nullptr || nlist->excl_fep[k]) ? 1 : 0;
+                selfscale[nlane]                      = (ii == jnr ? 0.5 : 1);
+                entry[nlane]                          = n;
+                jatom[nlane]                          = jnr;
+                nlane++;
+            }
+            k++;
+        }
+        if (nlane == 0)
+        {
+            break;
+        }
+        /* Clear the unused lanes, all their contributions are then zero */
+        for (int l = nlane; l < GMX_SIMD_REAL_WIDTH; l++)
+        {
+            dx[l]        = 0;
+            dy[l]        = 0;
+            dz[l]        = 0;
+            for (int i = 0; i < NSTATES; i++)
+            {
+                qq[i*GMX_SIMD_REAL_WIDTH+l]  = 0;
+                c6[i*GMX_SIMD_REAL_WIDTH+l]  = 0;
+                c12[i*GMX_SIMD_REAL_WIDTH+l] = 0;
+            }
+            interact[l]  = 0;
+            selfscale[l] = 1;
+        }
+
+        SimdReal dx_S        = load(dx);
+        SimdReal dy_S        = load(dy);
+        SimdReal dz_S        = load(dz);
+        SimdReal rsq_S       = norm2(dx_S, dy_S, dz_S);
+        SimdReal interact_S  = load(interact);
+        SimdBool interact_B  = (zero_S < interact_S);
+        SimdReal selfscale_S = load(selfscale);
+
+        /* Use r=1 for the excluded and unused lanes to keep the
+         * soft-core terms finite for r=0, these lanes are masked out.
+         */
+        SimdReal rsq_sc_S    = blend(one_S, rsq_S, interact_B);
+        SimdReal rpm2_S      = rsq_sc_S*rsq_sc_S;
+        SimdReal rp_S        = rpm2_S*rsq_sc_S;
+
+        SimdReal qq_S[NSTATES], c6_S[NSTATES], c12_S[NSTATES], sigma6_S[NSTATES];
+        for (int i = 0; i < NSTATES; i++)
+        {
+            qq_S[i]     = load(qq + i*GMX_SIMD_REAL_WIDTH);
+            c6_S[i]     = load(c6 + i*GMX_SIMD_REAL_WIDTH);
+            c12_S[i]    = load(c12 + i*GMX_SIMD_REAL_WIDTH);
+
+            /* c12 is stored scaled with 12.0 and c6 is scaled with 6.0 - correct for this */
+            SimdBool lj_B = (zero_S < c6_S[i]) && (zero_S < c12_S[i]);
+            sigma6_S[i] = max(half_S*c12_S[i]*maskzInv(c6_S[i], lj_B), sigma6_min_S);
+            sigma6_S[i] = blend(sigma6_def_S, sigma6_S[i], lj_B);
+        }
+
+        /* Only use soft-core if one of the states has a zero endstate */
+        SimdBool nosc_B         = (zero_S < c12_S[STATE_A]) && (zero_S < c12_S[STATE_B]);
+        SimdReal alpha_coul_eff = selectByNotMask(alpha_coul_S, nosc_B);
+        SimdReal alpha_vdw_eff  = selectByNotMask(alpha_vdw_S, nosc_B);
+
+        /* Computes the soft-core Coulomb and VdW potentials of state i and
+         * the scalar forces dV/dr_sc * r_sc^(1-p), using the soft-core
+         * lambda factors lfac_c_S and lfac_v_S.
+         */
+        auto softcoreState = [&](int i, SimdReal lfac_c_S, SimdReal lfac_v_S,
+                                 SimdReal *Vcoul, SimdReal *FscalC,
+                                 SimdReal *Vvdw, SimdReal *FscalV)
+            {
+                SimdReal rpinvC  = inv(fma(alpha_coul_eff*lfac_c_S, sigma6_S[i], rp_S));
+                SimdReal rpinvV  = inv(fma(alpha_vdw_eff*lfac_v_S, sigma6_S[i], rp_S));
+                /* rinvC = rpinvC^(1/6) */
+                SimdReal rinvC   = exp(onesixth_S*log(rpinvC));
+
+                SimdBool elec_B;
+                if (bEwald)
+                {
+                    /* Ewald FEP is done only on the 1/r part */
+                    *Vcoul  = qq_S[i]*(rinvC - sh_ewald_S);
+                    *FscalC = qq_S[i]*rinvC;
+                    elec_B  = interact_B && (rsq_S < rcoulomb2_S);
+                }
+                else
+                {
+                    SimdReal rC2 = inv(rinvC*rinvC);
+                    *Vcoul  = qq_S[i]*(rinvC + fms(krf_S, rC2, crf_S));
+                    *FscalC = qq_S[i]*fnma(two_krf_S, rC2, rinvC);
+                    elec_B  = interact_B && (rpinv_coul_cut_S < rpinvC);
+                }
+                *Vcoul           = selectByMask(*Vcoul, elec_B);
+                *FscalC          = selectByMask(*FscalC, elec_B);
+
+                SimdReal Vvdw6   = c6_S[i]*rpinvV;
+                SimdReal Vvdw12  = c12_S[i]*rpinvV*rpinvV;
+                SimdBool vdw_B   = interact_B && (rpinv_vdw_cut_S < rpinvV);
+                *Vvdw            = selectByMask(fms(Vvdw12 - c12_S[i]*sh_invrc12_S, onetwelfth_S,
+                                                    (Vvdw6 - c6_S[i]*sh_invrc6_S)*onesixth_S), vdw_B);
+                *FscalV          = selectByMask(Vvdw12 - Vvdw6, vdw_B);
+
+                /* Convert dV/dr_sc * r_sc to dV/dr_sc * r_sc^(1-p) */
+                *FscalC          = *FscalC*rpinvC;
+                *FscalV          = *FscalV*rpinvV;
+            };
+
+        /* The potential and scalar force per unit charge product of
+         * the terms without soft-core, which are linear in lambda.
+         */
+        SimdReal vcorr_S, fcorr_S;
+        if (bEwald)
+        {
+            /* Subtract the reciprocal-space part for all pairs within
+             * the cut-off, including excluded pairs, see the generic kernel.
+             */
+            SimdBool ewald_B = (rsq_S < rcoulomb2_S);
+            SimdReal brsq_S  = beta2_S*rsq_S;
+            vcorr_S          = -selectByMask(selfscale_S*beta_S*pmePotentialCorrection(brsq_S), ewald_B);
+            /* This is (d/dr (erf(beta r)/r))/r */
+            fcorr_S          = selectByMask(beta3_S*pmeForceCorrection(brsq_S), ewald_B);
+        }
+        else
+        {
+            /* Plain reaction-field for excluded pairs, without soft-core */
+            SimdBool excl_B  = (interact_S == zero_S);
+            vcorr_S          = selectByMask(selfscale_S*fms(krf_S, rsq_S, crf_S), excl_B);
+            fcorr_S          = -selectByMask(two_krf_S, excl_B);
+        }
+
+        if (bMultiLambda)
+        {
+            SimdReal Vcoul, FscalC, Vvdw, FscalV;
+
+            for (int i = 0; i < NSTATES; i++)
+            {
+                energy_lin_coul[i] += reduce(qq_S[i]*vcorr_S);
+            }
+
+            SimdBool sc_B = interact_B && ((c12_S[STATE_A] <= zero_S) || (c12_S[STATE_B] <= zero_S));
+            if (!anyTrue(sc_B))
+            {
+                /* Without soft-core pairs the potentials do not depend on lambda */
+                for (int i = 0; i < NSTATES; i++)
+                {
+                    softcoreState(i, zero_S, zero_S, &Vcoul, &FscalC, &Vvdw, &FscalV);
+                    energy_lin_coul[i] += reduce(Vcoul);
+                    energy_lin_vdw[i]  += reduce(Vvdw);
+                }
+            }
+            else
+            {
+                for (int l = 0; l < nlambda; l++)
+                {
+                    SimdReal energy_S = zero_S;
+                    for (int i = 0; i < NSTATES; i++)
+                    {
+                        int li = l*NSTATES + i;
+                        softcoreState(i, SimdReal(lfac_coul_multi[li]), SimdReal(lfac_vdw_multi[li]),
+                                      &Vcoul, &FscalC, &Vvdw, &FscalV);
+                        energy_S = fma(SimdReal(LFC_multi[li]), Vcoul, energy_S);
+                        energy_S = fma(SimdReal(LFV_multi[li]), Vvdw, energy_S);
+                    }
+                    energy_sc[l] += reduce(energy_S);
+                }
+            }
+            continue;
+        }
+
+        SimdReal fscal_S        = zero_S;
+        SimdReal vctot_S        = zero_S;
+        SimdReal vvtot_S        = zero_S;
+        SimdReal dvdl_coul_S    = zero_S;
+        SimdReal dvdl_vdw_S     = zero_S;
+
+        for (int i = 0; i < NSTATES; i++)
+        {
+            SimdReal Vcoul, FscalC, Vvdw, FscalV;
+
+            softcoreState(i, lfac_coul_S[i], lfac_vdw_S[i], &Vcoul, &FscalC, &Vvdw, &FscalV);
+
+            vctot_S     = fma(LFC_S[i], Vcoul, vctot_S);
+            vvtot_S     = fma(LFV_S[i], Vvdw, vvtot_S);
+            fscal_S     = fma(fma(LFC_S[i], FscalC, LFV_S[i]*FscalV), rpm2_S, fscal_S);
+            dvdl_coul_S = fma(DLF_S[i], Vcoul, dvdl_coul_S);
+            dvdl_coul_S = fma(LFC_S[i]*alpha_coul_eff*dlfac_coul_S[i], FscalC*sigma6_S[i], dvdl_coul_S);
+            dvdl_vdw_S  = fma(DLF_S[i], Vvdw, dvdl_vdw_S);
+            dvdl_vdw_S  = fma(LFV_S[i]*alpha_vdw_eff*dlfac_vdw_S[i], FscalV*sigma6_S[i], dvdl_vdw_S);
+        }
+
+        /* Add the terms without soft-core, using the charge products
+         * of the lambda-interpolated state and of B-A.
+         */
+        SimdReal qq_lambda_S = fma(LFC_S[STATE_A], qq_S[STATE_A], LFC_S[STATE_B]*qq_S[STATE_B]);
+        vctot_S              = fma(qq_lambda_S, vcorr_S, vctot_S);
+        fscal_S              = fma(qq_lambda_S, fcorr_S, fscal_S);
+        dvdl_coul_S          = fma(qq_S[STATE_B] - qq_S[STATE_A], vcorr_S, dvdl_coul_S);
+
+        store(fscal, fscal_S);
+        store(vcoul, vctot_S);
+        store(vvdw, vvtot_S);
+        dvdl_coul += reduce(dvdl_coul_S);
+        dvdl_vdw  += reduce(dvdl_vdw_S);
+
+        /* Reduce the lane output, i-entry output is added when the entry ends */
+        for (int l = 0; l < nlane; l++)
+        {
+            if (entry[l] != nout)
+            {
+                if (nout >= 0)
+                {
+                    add_fep_i_entry_output(nlist, nout, fix, fiy, fiz, vctot, vvtot,
+                                           flags, f, fshift,
+                                           kernel_data->energygrp_elec,
+                                           kernel_data->energygrp_vdw);
+                }
+                nout  = entry[l];
+                fix   = 0;
+                fiy   = 0;
+                fiz   = 0;
+                vctot = 0;
+                vvtot = 0;
+            }
+            vctot += vcoul[l];
+            vvtot += vvdw[l];
+            if (bDoForces)
+            {
+                real tx = fscal[l]*dx[l];
+                real ty = fscal[l]*dy[l];
+                real tz = fscal[l]*dz[l];
+                int  j3 = 3*jatom[l];
+                fix    += tx;
+                fiy    += ty;
+                fiz    += tz;
+#pragma omp atomic
+                f[j3]   -= tx;
+#pragma omp atomic
+                f[j3+1] -= ty;
+#pragma omp atomic
+                f[j3+2] -= tz;
+            }
+        }
+    }
+    if (nout >= 0)
+    {
+        add_fep_i_entry_output(nlist, nout, fix, fiy, fiz, vctot, vvtot,
+                               flags, f, fshift,
+                               kernel_data->energygrp_elec,
+                               kernel_data->energygrp_vdw);
+    }
+
+    if (bMultiLambda)
+    {
+        for (int l = 0; l < nlambda; l++)
+        {
+            double energy = energy_sc[l];
+            for (int i = 0; i < NSTATES; i++)
+            {
+                energy += LFC_multi[l*NSTATES+i]*energy_lin_coul[i];
+                energy += LFV_multi[l*NSTATES+i]*energy_lin_vdw[i];
+            }
+#pragma omp atomic
+            kernel_data->energy_multi[l] += energy;
+        }
+    }
+    else
+    {
+#pragma omp atomic
+        kernel_data->dvdl[efptCOUL] += dvdl_coul;
+#pragma omp atomic
+        kernel_data->dvdl[efptVDW]  += dvdl_vdw;
+    }
+
+    /* Same flop estimate as the generic kernel */
+#pragma omp atomic
+    inc_nrnb(nrnb, eNR_NBKERNEL_FREE_ENERGY, nlist->nri*12 + nlist->jindex[nri]*150);
+#undef STATE_A
+#undef STATE_B
+#undef NSTATES
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 void
 gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
                           rvec * gmx_restrict              xx,
@@ -77,9 +629,10 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
     real          ix, iy, iz, fix, fiy, fiz;
     real          dx, dy, dz, rsq, rinv;
     real          c6[NSTATES], c12[NSTATES], c6grid;
-    real          LFC[NSTATES], LFV[NSTATES], DLF[NSTATES];
+    const real   *LFC, *LFV;
+    real          DLF[NSTATES];
     double        dvdl_coul, dvdl_vdw;
-    real          lfac_coul[NSTATES], dlfac_coul[NSTATES], lfac_vdw[NSTATES], dlfac_vdw[NSTATES];
+    const real   *lfac_coul, *dlfac_coul, *lfac_vdw, *dlfac_vdw;
     real          sigma6[NSTATES], alpha_vdw_eff, alpha_coul_eff, sigma2_def, sigma2_min;
     double        rp, rpm2, rC, rV, rinvC, rpinvC, rinvV, rpinvV; /* Needs double for sc_power==48 */
     real          sigma2[NSTATES], sigma_pow[NSTATES];
@@ -113,7 +666,8 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
     real *        dvdl;
     real *        Vv;
     real *        Vc;
-    gmx_bool      bDoForces, bDoShiftForces, bDoPotential;
+    gmx_bool      bDoForces, bDoShiftForces, bDoPotential, bMultiLambda;
+    int           nlambda, nlambda_sc, l;
     real          rcoulomb, rvdw, sh_invrc6;
     gmx_bool      bExactElecCutoff, bExactVdwCutoff, bExactCutoffAll;
     gmx_bool      bEwald, bEwaldLJ;
@@ -138,6 +692,13 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
     const real    six         = 6.0;
     const real    fourtyeight = 48.0;
 
+#if GMX_SIMD_HAVE_REAL
+    if (fep_simd_kernel_supported(fr))
+    {
+        nb_free_energy_kernel_simd(nlist, xx, ff, fr, mdatoms, kernel_data, nrnb);
+        return;
+    }
+#endif
     x                   = xx[0];
     f                   = ff[0];
 
@@ -165,8 +726,6 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
     nbfp                = fr->nbfp;
     nbfp_grid           = fr->ljpme_c6grid;
     Vv                  = kernel_data->energygrp_vdw;
-    lambda_coul         = kernel_data->lambda[efptCOUL];
-    lambda_vdw          = kernel_data->lambda[efptVDW];
     dvdl                = kernel_data->dvdl;
     alpha_coul          = fr->sc_alphacoul;
     alpha_vdw           = fr->sc_alphavdw;
@@ -177,6 +736,7 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
     bDoForces           = kernel_data->flags & GMX_NONBONDED_DO_FORCE;
     bDoShiftForces      = kernel_data->flags & GMX_NONBONDED_DO_SHIFTFORCE;
     bDoPotential        = kernel_data->flags & GMX_NONBONDED_DO_POTENTIAL;
+    bMultiLambda        = kernel_data->flags & GMX_NONBONDED_DO_MULTILAMBDA;
 
     rcoulomb            = fr->rcoulomb;
     rvdw                = fr->rvdw;
@@ -306,25 +866,73 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
     dvdl_coul  = 0;
     dvdl_vdw   = 0;
 
-    /* Lambda factor for state A, 1-lambda*/
-    LFC[STATE_A] = one - lambda_coul;
-    LFV[STATE_A] = one - lambda_vdw;
-
-    /* Lambda factor for state B, lambda*/
-    LFC[STATE_B] = lambda_coul;
-    LFV[STATE_B] = lambda_vdw;
-
     /*derivative of the lambda factor for state A and B */
     DLF[STATE_A] = -1;
     DLF[STATE_B] = 1;
 
-    for (i = 0; i < NSTATES; i++)
+    /* With GMX_NONBONDED_DO_MULTILAMBDA we compute the total potential at
+     * all lambda points in one pass over the list. Only the soft-core part
+     * depends non-linearly on lambda and is evaluated per lambda point.
+     * All other contributions are accumulated per state in vtot_lin
+     * and interpolated at the end.
+     * This kernel is called for every neighbor list on every step, so we
+     * only use the heap for the lambda factors of the multi-lambda case.
+     */
+    nlambda = (bMultiLambda ? kernel_data->nlambda_multi : 1);
+    const int           c_numLambdaFactors = 6;
+    real                lambda_factors_single[c_numLambdaFactors*NSTATES];
+    double              energy_sc_single[1] = { 0 };
+    std::vector<real>   lambda_factors_multi;
+    std::vector<double> energy_sc_multi;
+    real               *lambda_factors = lambda_factors_single;
+    double             *energy_sc      = energy_sc_single;
+    if (bMultiLambda)
     {
-        lfac_coul[i]  = (lam_power == 2 ? (1-LFC[i])*(1-LFC[i]) : (1-LFC[i]));
-        dlfac_coul[i] = DLF[i]*lam_power/sc_r_power*(lam_power == 2 ? (1-LFC[i]) : 1);
-        lfac_vdw[i]   = (lam_power == 2 ? (1-LFV[i])*(1-LFV[i]) : (1-LFV[i]));
-        dlfac_vdw[i]  = DLF[i]*lam_power/sc_r_power*(lam_power == 2 ? (1-LFV[i]) : 1);
+        lambda_factors_multi.resize(c_numLambdaFactors*nlambda*NSTATES);
+        energy_sc_multi.resize(nlambda, 0.0);
+        lambda_factors = lambda_factors_multi.data();
+        energy_sc      = energy_sc_multi.data();
     }
+    real               *LFC_multi        = lambda_factors;
+    real               *LFV_multi        = LFC_multi + nlambda*NSTATES;
+    real               *lfac_coul_multi  = LFV_multi + nlambda*NSTATES;
+    real               *dlfac_coul_multi = lfac_coul_multi + nlambda*NSTATES;
+    real               *lfac_vdw_multi   = dlfac_coul_multi + nlambda*NSTATES;
+    real               *dlfac_vdw_multi  = lfac_vdw_multi + nlambda*NSTATES;
+    double              energy_lin_coul[NSTATES] = { 0 }, energy_lin_vdw[NSTATES] = { 0 };
+
+    for (l = 0; l < nlambda; l++)
+    {
+        const real *lambda_l = (bMultiLambda ? kernel_data->lambda_multi + l*efptNR : kernel_data->lambda);
+
+        lambda_coul = lambda_l[efptCOUL];
+        lambda_vdw  = lambda_l[efptVDW];
+
+        /* Lambda factor for state A, 1-lambda*/
+        LFC_multi[l*NSTATES + STATE_A] = one - lambda_coul;
+        LFV_multi[l*NSTATES + STATE_A] = one - lambda_vdw;
+
+        /* Lambda factor for state B, lambda*/
+        LFC_multi[l*NSTATES + STATE_B] = lambda_coul;
+        LFV_multi[l*NSTATES + STATE_B] = lambda_vdw;
+
+        for (i = 0; i < NSTATES; i++)
+        {
+            real lfc = LFC_multi[l*NSTATES + i];
+            real lfv = LFV_multi[l*NSTATES + i];
+
+            lfac_coul_multi[l*NSTATES + i]  = (lam_power == 2 ? (1-lfc)*(1-lfc) : (1-lfc));
+            dlfac_coul_multi[l*NSTATES + i] = DLF[i]*lam_power/sc_r_power*(lam_power == 2 ? (1-lfc) : 1);
+            lfac_vdw_multi[l*NSTATES + i]   = (lam_power == 2 ? (1-lfv)*(1-lfv) : (1-lfv));
+            dlfac_vdw_multi[l*NSTATES + i]  = DLF[i]*lam_power/sc_r_power*(lam_power == 2 ? (1-lfv) : 1);
+        }
+    }
+    LFC        = LFC_multi;
+    LFV        = LFV_multi;
+    lfac_coul  = lfac_coul_multi;
+    dlfac_coul = dlfac_coul_multi;
+    lfac_vdw   = lfac_vdw_multi;
+    dlfac_vdw  = dlfac_vdw_multi;
     /* precalculate */
     sigma2_def = std::cbrt(sigma6_def);
     sigma2_min = std::cbrt(sigma6_min);
@@ -490,275 +1098,308 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
                     alpha_coul_eff   = alpha_coul;
                 }
 
-                for (i = 0; i < NSTATES; i++)
-                {
-                    FscalC[i]    = 0;
-                    FscalV[i]    = 0;
-                    Vcoul[i]     = 0;
-                    Vvdw[i]      = 0;
+                /* Without soft-core the potential is linear in lambda,
+                 * so we only need to evaluate it once.
+                 */
+                nlambda_sc = ((alpha_vdw_eff == 0 && alpha_coul_eff == 0) ? 1 : nlambda);
 
-                    /* Only spend time on A or B state if it is non-zero */
-                    if ( (qq[i] != 0) || (c6[i] != 0) || (c12[i] != 0) )
+                for (l = 0; l < nlambda_sc; l++)
+                {
+                    LFC        = &LFC_multi[l*NSTATES];
+                    LFV        = &LFV_multi[l*NSTATES];
+                    lfac_coul  = &lfac_coul_multi[l*NSTATES];
+                    dlfac_coul = &dlfac_coul_multi[l*NSTATES];
+                    lfac_vdw   = &lfac_vdw_multi[l*NSTATES];
+                    dlfac_vdw  = &dlfac_vdw_multi[l*NSTATES];
+
+                    for (i = 0; i < NSTATES; i++)
                     {
-                        /* this section has to be inside the loop because of the dependence on sigma_pow */
-                        rpinvC         = one/(alpha_coul_eff*lfac_coul[i]*sigma_pow[i]+rp);
-                        rinvC          = std::pow(rpinvC, one/sc_r_power);
-                        rC             = one/rinvC;
-
-                        rpinvV         = one/(alpha_vdw_eff*lfac_vdw[i]*sigma_pow[i]+rp);
-                        rinvV          = std::pow(rpinvV, one/sc_r_power);
-                        rV             = one/rinvV;
+                        FscalC[i]    = 0;
+                        FscalV[i]    = 0;
+                        Vcoul[i]     = 0;
+                        Vvdw[i]      = 0;
 
-                        if (do_tab)
+                        /* Only spend time on A or B state if it is non-zero */
+                        if ( (qq[i] != 0) || (c6[i] != 0) || (c12[i] != 0) )
                         {
-                            rtC        = rC*tabscale;
-                            n0         = rtC;
-                            epsC       = rtC-n0;
-                            eps2C      = epsC*epsC;
-                            n1C        = tab_elemsize*n0;
-
-                            rtV        = rV*tabscale;
-                            n0         = rtV;
-                            epsV       = rtV-n0;
-                            eps2V      = epsV*epsV;
-                            n1V        = tab_elemsize*n0;
-                        }
+                            /* this section has to be inside the loop because of the dependence on sigma_pow */
+                            rpinvC         = one/(alpha_coul_eff*lfac_coul[i]*sigma_pow[i]+rp);
+                            rinvC          = std::pow(rpinvC, one/sc_r_power);
+                            rC             = one/rinvC;
 
-                        /* Only process the coulomb interactions if we have charges,
-                         * and if we either include all entries in the list (no cutoff
-                         * used in the kernel), or if we are within the cutoff.
-                         */
-                        bComputeElecInteraction = !bExactElecCutoff ||
-                            ( bConvertEwaldToCoulomb && r < rcoulomb) ||
-                            (!bConvertEwaldToCoulomb && rC < rcoulomb);
+                            rpinvV         = one/(alpha_vdw_eff*lfac_vdw[i]*sigma_pow[i]+rp);
+                            rinvV          = std::pow(rpinvV, one/sc_r_power);
+                            rV             = one/rinvV;
 
-                        if ( (qq[i] != 0) && bComputeElecInteraction)
-                        {
-                            switch (icoul)
+                            if (do_tab)
                             {
-                                case GMX_NBKERNEL_ELEC_COULOMB:
-                                    /* simple cutoff */
-                                    Vcoul[i]   = qq[i]*rinvC;
-                                    FscalC[i]  = Vcoul[i];
-                                    /* The shift for the Coulomb potential is stored in
-                                     * the RF parameter c_rf, which is 0 without shift.
-                                     */
-                                    Vcoul[i]  -= qq[i]*fr->ic->c_rf;
-                                    break;
-
-                                case GMX_NBKERNEL_ELEC_REACTIONFIELD:
-                                    /* reaction-field */
-                                    Vcoul[i]   = qq[i]*(rinvC + krf*rC*rC-crf);
-                                    FscalC[i]  = qq[i]*(rinvC - two*krf*rC*rC);
-                                    break;
-
-                                case GMX_NBKERNEL_ELEC_CUBICSPLINETABLE:
-                                    /* non-Ewald tabulated coulomb */
-                                    nnn        = n1C;
-                                    Y          = VFtab[nnn];
-                                    F          = VFtab[nnn+1];
-                                    Geps       = epsC*VFtab[nnn+2];
-                                    Heps2      = eps2C*VFtab[nnn+3];
-                                    Fp         = F+Geps+Heps2;
-                                    VV         = Y+epsC*Fp;
-                                    FF         = Fp+Geps+two*Heps2;
-                                    Vcoul[i]   = qq[i]*VV;
-                                    FscalC[i]  = -qq[i]*tabscale*FF*rC;
-                                    break;
-
-                                case GMX_NBKERNEL_ELEC_GENERALIZEDBORN:
-                                    gmx_fatal(FARGS, "Free energy and GB not implemented.\n");
-                                    break;
-
-                                case GMX_NBKERNEL_ELEC_EWALD:
-                                    if (bConvertEwaldToCoulomb)
-                                    {
-                                        /* Ewald FEP is done only on the 1/r part */
-                                        Vcoul[i]   = qq[i]*(rinvC-sh_ewald);
-                                        FscalC[i]  = qq[i]*rinvC;
-                                    }
-                                    else
-                                    {
-                                        ewrt      = rC*ewtabscale;
-                                        ewitab    = static_cast<int>(ewrt);
-                                        eweps     = ewrt-ewitab;
-                                        ewitab    = 4*ewitab;
-                                        FscalC[i] = ewtab[ewitab]+eweps*ewtab[ewitab+1];
-                                        rinvcorr  = rinvC-sh_ewald;
-                                        Vcoul[i]  = qq[i]*(rinvcorr-(ewtab[ewitab+2]-ewtabhalfspace*eweps*(ewtab[ewitab]+FscalC[i])));
-                                        FscalC[i] = qq[i]*(rinvC-rC*FscalC[i]);
-                                    }
-                                    break;
-
-                                case GMX_NBKERNEL_ELEC_NONE:
-                                    FscalC[i]  = zero;
-                                    Vcoul[i]   = zero;
-                                    break;
-
-                                default:
-                                    gmx_incons("Invalid icoul in free energy kernel");
-                                    break;
+                                rtC        = rC*tabscale;
+                                n0         = rtC;
+                                epsC       = rtC-n0;
+                                eps2C      = epsC*epsC;
+                                n1C        = tab_elemsize*n0;
+
+                                rtV        = rV*tabscale;
+                                n0         = rtV;
+                                epsV       = rtV-n0;
+                                eps2V      = epsV*epsV;
+                                n1V        = tab_elemsize*n0;
                             }
 
-                            if (fr->coulomb_modifier == eintmodPOTSWITCH)
-                            {
-                                d                = rC-fr->rcoulomb_switch;
-                                d                = (d > zero) ? d : zero;
-                                d2               = d*d;
-                                sw               = one+d2*d*(elec_swV3+d*(elec_swV4+d*elec_swV5));
-                                dsw              = d2*(elec_swF2+d*(elec_swF3+d*elec_swF4));
-
-                                FscalC[i]        = FscalC[i]*sw - rC*Vcoul[i]*dsw;
-                                Vcoul[i]        *= sw;
+                            /* Only process the coulomb interactions if we have charges,
+                             * and if we either include all entries in the list (no cutoff
+                             * used in the kernel), or if we are within the cutoff.
+                             */
+                            bComputeElecInteraction = !bExactElecCutoff ||
+                                ( bConvertEwaldToCoulomb && r < rcoulomb) ||
+                                (!bConvertEwaldToCoulomb && rC < rcoulomb);
 
-                                FscalC[i]        = (rC < rcoulomb) ? FscalC[i] : zero;
-                                Vcoul[i]         = (rC < rcoulomb) ? Vcoul[i] : zero;
+                            if ( (qq[i] != 0) && bComputeElecInteraction)
+                            {
+                                switch (icoul)
+                                {
+                                    case GMX_NBKERNEL_ELEC_COULOMB:
+                                        /* simple cutoff */
+                                        Vcoul[i]   = qq[i]*rinvC;
+                                        FscalC[i]  = Vcoul[i];
+                                        /* The shift for the Coulomb potential is stored in
+                                         * the RF parameter c_rf, which is 0 without shift.
+                                         */
+                                        Vcoul[i]  -= qq[i]*fr->ic->c_rf;
+                                        break;
+
+                                    case GMX_NBKERNEL_ELEC_REACTIONFIELD:
+                                        /* reaction-field */
+                                        Vcoul[i]   = qq[i]*(rinvC + krf*rC*rC-crf);
+                                        FscalC[i]  = qq[i]*(rinvC - two*krf*rC*rC);
+                                        break;
+
+                                    case GMX_NBKERNEL_ELEC_CUBICSPLINETABLE:
+                                        /* non-Ewald tabulated coulomb */
+                                        nnn        = n1C;
+                                        Y          = VFtab[nnn];
+                                        F          = VFtab[nnn+1];
+                                        Geps       = epsC*VFtab[nnn+2];
+                                        Heps2      = eps2C*VFtab[nnn+3];
+                                        Fp         = F+Geps+Heps2;
+                                        VV         = Y+epsC*Fp;
+                                        FF         = Fp+Geps+two*Heps2;
+                                        Vcoul[i]   = qq[i]*VV;
+                                        FscalC[i]  = -qq[i]*tabscale*FF*rC;
+                                        break;
+
+                                    case GMX_NBKERNEL_ELEC_GENERALIZEDBORN:
+                                        gmx_fatal(FARGS, "Free energy and GB not implemented.\n");
+                                        break;
+
+                                    case GMX_NBKERNEL_ELEC_EWALD:
+                                        if (bConvertEwaldToCoulomb)
+                                        {
+                                            /* Ewald FEP is done only on the 1/r part */
+                                            Vcoul[i]   = qq[i]*(rinvC-sh_ewald);
+                                            FscalC[i]  = qq[i]*rinvC;
+                                        }
+                                        else
+                                        {
+                                            ewrt      = rC*ewtabscale;
+                                            ewitab    = static_cast<int>(ewrt);
+                                            eweps     = ewrt-ewitab;
+                                            ewitab    = 4*ewitab;
+                                            FscalC[i] = ewtab[ewitab]+eweps*ewtab[ewitab+1];
+                                            rinvcorr  = rinvC-sh_ewald;
+                                            Vcoul[i]  = qq[i]*(rinvcorr-(ewtab[ewitab+2]-ewtabhalfspace*eweps*(ewtab[ewitab]+FscalC[i])));
+                                            FscalC[i] = qq[i]*(rinvC-rC*FscalC[i]);
+                                        }
+                                        break;
+
+                                    case GMX_NBKERNEL_ELEC_NONE:
+                                        FscalC[i]  = zero;
+                                        Vcoul[i]   = zero;
+                                        break;
+
+                                    default:
+                                        gmx_incons("Invalid icoul in free energy kernel");
+                                        break;
+                                }
+
+                                if (fr->coulomb_modifier == eintmodPOTSWITCH)
+                                {
+                                    d                = rC-fr->rcoulomb_switch;
+                                    d                = (d > zero) ? d : zero;
+                                    d2               = d*d;
+                                    sw               = one+d2*d*(elec_swV3+d*(elec_swV4+d*elec_swV5));
+                                    dsw              = d2*(elec_swF2+d*(elec_swF3+d*elec_swF4));
+
+                                    FscalC[i]        = FscalC[i]*sw - rC*Vcoul[i]*dsw;
+                                    Vcoul[i]        *= sw;
+
+                                    FscalC[i]        = (rC < rcoulomb) ? FscalC[i] : zero;
+                                    Vcoul[i]         = (rC < rcoulomb) ? Vcoul[i] : zero;
+                                }
                             }
-                        }
 
-                        /* Only process the VDW interactions if we have
-                         * some non-zero parameters, and if we either
-                         * include all entries in the list (no cutoff used
-                         * in the kernel), or if we are within the cutoff.
-                         */
-                        bComputeVdwInteraction = !bExactVdwCutoff ||
-                            ( bConvertLJEwaldToLJ6 && r < rvdw) ||
-                            (!bConvertLJEwaldToLJ6 && rV < rvdw);
-                        if ((c6[i] != 0 || c12[i] != 0) && bComputeVdwInteraction)
-                        {
-                            switch (ivdw)
+                            /* Only process the VDW interactions if we have
+                             * some non-zero parameters, and if we either
+                             * include all entries in the list (no cutoff used
+                             * in the kernel), or if we are within the cutoff.
+                             */
+                            bComputeVdwInteraction = !bExactVdwCutoff ||
+                                ( bConvertLJEwaldToLJ6 && r < rvdw) ||
+                                (!bConvertLJEwaldToLJ6 && rV < rvdw);
+                            if ((c6[i] != 0 || c12[i] != 0) && bComputeVdwInteraction)
                             {
-                                case GMX_NBKERNEL_VDW_LENNARDJONES:
-                                    /* cutoff LJ */
-                                    if (sc_r_power == six)
-                                    {
-                                        rinv6            = rpinvV;
-                                    }
-                                    else
-                                    {
-                                        rinv6            = rinvV*rinvV;
-                                        rinv6            = rinv6*rinv6*rinv6;
-                                    }
-                                    Vvdw6            = c6[i]*rinv6;
-                                    Vvdw12           = c12[i]*rinv6*rinv6;
-
-                                    Vvdw[i]          = ( (Vvdw12 - c12[i]*sh_invrc6*sh_invrc6)*onetwelfth
-                                                         - (Vvdw6 - c6[i]*sh_invrc6)*onesixth);
-                                    FscalV[i]        = Vvdw12 - Vvdw6;
-                                    break;
-
-                                case GMX_NBKERNEL_VDW_BUCKINGHAM:
-                                    gmx_fatal(FARGS, "Buckingham free energy not supported.");
-                                    break;
-
-                                case GMX_NBKERNEL_VDW_CUBICSPLINETABLE:
-                                    /* Table LJ */
-                                    nnn = n1V+4;
-                                    /* dispersion */
-                                    Y          = VFtab[nnn];
-                                    F          = VFtab[nnn+1];
-                                    Geps       = epsV*VFtab[nnn+2];
-                                    Heps2      = eps2V*VFtab[nnn+3];
-                                    Fp         = F+Geps+Heps2;
-                                    VV         = Y+epsV*Fp;
-                                    FF         = Fp+Geps+two*Heps2;
-                                    Vvdw[i]   += c6[i]*VV;
-                                    FscalV[i] -= c6[i]*tabscale*FF*rV;
-
-                                    /* repulsion */
-                                    Y          = VFtab[nnn+4];
-                                    F          = VFtab[nnn+5];
-                                    Geps       = epsV*VFtab[nnn+6];
-                                    Heps2      = eps2V*VFtab[nnn+7];
-                                    Fp         = F+Geps+Heps2;
-                                    VV         = Y+epsV*Fp;
-                                    FF         = Fp+Geps+two*Heps2;
-                                    Vvdw[i]   += c12[i]*VV;
-                                    FscalV[i] -= c12[i]*tabscale*FF*rV;
-                                    break;
-
-                                case GMX_NBKERNEL_VDW_LJEWALD:
-                                    if (sc_r_power == six)
-                                    {
-                                        rinv6            = rpinvV;
-                                    }
-                                    else
-                                    {
-                                        rinv6            = rinvV*rinvV;
-                                        rinv6            = rinv6*rinv6*rinv6;
-                                    }
-                                    c6grid           = nbfp_grid[tj[i]];
-
-                                    if (bConvertLJEwaldToLJ6)
-                                    {
+                                switch (ivdw)
+                                {
+                                    case GMX_NBKERNEL_VDW_LENNARDJONES:
                                         /* cutoff LJ */
+                                        if (sc_r_power == six)
+                                        {
+                                            rinv6            = rpinvV;
+                                        }
+                                        else
+                                        {
+                                            rinv6            = rinvV*rinvV;
+                                            rinv6            = rinv6*rinv6*rinv6;
+                                        }
                                         Vvdw6            = c6[i]*rinv6;
                                         Vvdw12           = c12[i]*rinv6*rinv6;
 
                                         Vvdw[i]          = ( (Vvdw12 - c12[i]*sh_invrc6*sh_invrc6)*onetwelfth
-                                                             - (Vvdw6 - c6[i]*sh_invrc6 - c6grid*sh_lj_ewald)*onesixth);
+                                                             - (Vvdw6 - c6[i]*sh_invrc6)*onesixth);
                                         FscalV[i]        = Vvdw12 - Vvdw6;
-                                    }
-                                    else
-                                    {
-                                        /* Normal LJ-PME */
-                                        ewcljrsq         = ewclj2*rV*rV;
-                                        exponent         = std::exp(-ewcljrsq);
-                                        poly             = exponent*(one + ewcljrsq + ewcljrsq*ewcljrsq*half);
-                                        vvdw_disp        = (c6[i]-c6grid*(one-poly))*rinv6;
-                                        vvdw_rep         = c12[i]*rinv6*rinv6;
-                                        FscalV[i]        = vvdw_rep - vvdw_disp - c6grid*onesixth*exponent*ewclj6;
-                                        Vvdw[i]          = (vvdw_rep - c12[i]*sh_invrc6*sh_invrc6)*onetwelfth - (vvdw_disp - c6[i]*sh_invrc6 - c6grid*sh_lj_ewald)/six;
-                                    }
-                                    break;
-
-                                case GMX_NBKERNEL_VDW_NONE:
-                                    Vvdw[i]    = zero;
-                                    FscalV[i]  = zero;
-                                    break;
-
-                                default:
-                                    gmx_incons("Invalid ivdw in free energy kernel");
-                                    break;
+                                        break;
+
+                                    case GMX_NBKERNEL_VDW_BUCKINGHAM:
+                                        gmx_fatal(FARGS, "Buckingham free energy not supported.");
+                                        break;
+
+                                    case GMX_NBKERNEL_VDW_CUBICSPLINETABLE:
+                                        /* Table LJ */
+                                        nnn = n1V+4;
+                                        /* dispersion */
+                                        Y          = VFtab[nnn];
+                                        F          = VFtab[nnn+1];
+                                        Geps       = epsV*VFtab[nnn+2];
+                                        Heps2      = eps2V*VFtab[nnn+3];
+                                        Fp         = F+Geps+Heps2;
+                                        VV         = Y+epsV*Fp;
+                                        FF         = Fp+Geps+two*Heps2;
+                                        Vvdw[i]   += c6[i]*VV;
+                                        FscalV[i] -= c6[i]*tabscale*FF*rV;
+
+                                        /* repulsion */
+                                        Y          = VFtab[nnn+4];
+                                        F          = VFtab[nnn+5];
+                                        Geps       = epsV*VFtab[nnn+6];
+                                        Heps2      = eps2V*VFtab[nnn+7];
+                                        Fp         = F+Geps+Heps2;
+                                        VV         = Y+epsV*Fp;
+                                        FF         = Fp+Geps+two*Heps2;
+                                        Vvdw[i]   += c12[i]*VV;
+                                        FscalV[i] -= c12[i]*tabscale*FF*rV;
+                                        break;
+
+                                    case GMX_NBKERNEL_VDW_LJEWALD:
+                                        if (sc_r_power == six)
+                                        {
+                                            rinv6            = rpinvV;
+                                        }
+                                        else
+                                        {
+                                            rinv6            = rinvV*rinvV;
+                                            rinv6            = rinv6*rinv6*rinv6;
+                                        }
+                                        c6grid           = nbfp_grid[tj[i]];
+
+                                        if (bConvertLJEwaldToLJ6)
+                                        {
+                                            /* cutoff LJ */
+                                            Vvdw6            = c6[i]*rinv6;
+                                            Vvdw12           = c12[i]*rinv6*rinv6;
+
+                                            Vvdw[i]          = ( (Vvdw12 - c12[i]*sh_invrc6*sh_invrc6)*onetwelfth
+                                                                 - (Vvdw6 - c6[i]*sh_invrc6 - c6grid*sh_lj_ewald)*onesixth);
+                                            FscalV[i]        = Vvdw12 - Vvdw6;
+                                        }
+                                        else
+                                        {
+                                            /* Normal LJ-PME */
+                                            ewcljrsq         = ewclj2*rV*rV;
+                                            exponent         = std::exp(-ewcljrsq);
+                                            poly             = exponent*(one + ewcljrsq + ewcljrsq*ewcljrsq*half);
+                                            vvdw_disp        = (c6[i]-c6grid*(one-poly))*rinv6;
+                                            vvdw_rep         = c12[i]*rinv6*rinv6;
+                                            FscalV[i]        = vvdw_rep - vvdw_disp - c6grid*onesixth*exponent*ewclj6;
+                                            Vvdw[i]          = (vvdw_rep - c12[i]*sh_invrc6*sh_invrc6)*onetwelfth - (vvdw_disp - c6[i]*sh_invrc6 - c6grid*sh_lj_ewald)/six;
+                                        }
+                                        break;
+
+                                    case GMX_NBKERNEL_VDW_NONE:
+                                        Vvdw[i]    = zero;
+                                        FscalV[i]  = zero;
+                                        break;
+
+                                    default:
+                                        gmx_incons("Invalid ivdw in free energy kernel");
+                                        break;
+                                }
+
+                                if (fr->vdw_modifier == eintmodPOTSWITCH)
+                                {
+                                    d                = rV-fr->rvdw_switch;
+                                    d                = (d > zero) ? d : zero;
+                                    d2               = d*d;
+                                    sw               = one+d2*d*(vdw_swV3+d*(vdw_swV4+d*vdw_swV5));
+                                    dsw              = d2*(vdw_swF2+d*(vdw_swF3+d*vdw_swF4));
+
+                                    FscalV[i]        = FscalV[i]*sw - rV*Vvdw[i]*dsw;
+                                    Vvdw[i]         *= sw;
+
+                                    FscalV[i]  = (rV < rvdw) ? FscalV[i] : zero;
+                                    Vvdw[i]    = (rV < rvdw) ? Vvdw[i] : zero;
+                                }
                             }
 
-                            if (fr->vdw_modifier == eintmodPOTSWITCH)
-                            {
-                                d                = rV-fr->rvdw_switch;
-                                d                = (d > zero) ? d : zero;
-                                d2               = d*d;
-                                sw               = one+d2*d*(vdw_swV3+d*(vdw_swV4+d*vdw_swV5));
-                                dsw              = d2*(vdw_swF2+d*(vdw_swF3+d*vdw_swF4));
-
-                                FscalV[i]        = FscalV[i]*sw - rV*Vvdw[i]*dsw;
-                                Vvdw[i]         *= sw;
-
-                                FscalV[i]  = (rV < rvdw) ? FscalV[i] : zero;
-                                Vvdw[i]    = (rV < rvdw) ? Vvdw[i] : zero;
-                            }
+                            /* FscalC (and FscalV) now contain: dV/drC * rC
+                             * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
+                             * Further down we first multiply by r^p-2 and then by
+                             * the vector r, which in total gives: dV/drC * (r/rC)^1-p
+                             */
+                            FscalC[i] *= rpinvC;
+                            FscalV[i] *= rpinvV;
                         }
-
-                        /* FscalC (and FscalV) now contain: dV/drC * rC
-                         * Now we multiply by rC^-p, so it will be: dV/drC * rC^1-p
-                         * Further down we first multiply by r^p-2 and then by
-                         * the vector r, which in total gives: dV/drC * (r/rC)^1-p
-                         */
-                        FscalC[i] *= rpinvC;
-                        FscalV[i] *= rpinvV;
                     }
-                }
 
-                /* Assemble A and B states */
-                for (i = 0; i < NSTATES; i++)
-                {
-                    vctot         += LFC[i]*Vcoul[i];
-                    vvtot         += LFV[i]*Vvdw[i];
+                    /* Assemble A and B states */
+                    if (!bMultiLambda)
+                    {
+                        for (i = 0; i < NSTATES; i++)
+                        {
+                            vctot         += LFC[i]*Vcoul[i];
+                            vvtot         += LFV[i]*Vvdw[i];
 
-                    Fscal         += LFC[i]*FscalC[i]*rpm2;
-                    Fscal         += LFV[i]*FscalV[i]*rpm2;
+                            Fscal         += LFC[i]*FscalC[i]*rpm2;
+                            Fscal         += LFV[i]*FscalV[i]*rpm2;
 
-                    dvdl_coul     += Vcoul[i]*DLF[i] + LFC[i]*alpha_coul_eff*dlfac_coul[i]*FscalC[i]*sigma_pow[i];
-                    dvdl_vdw      += Vvdw[i]*DLF[i] + LFV[i]*alpha_vdw_eff*dlfac_vdw[i]*FscalV[i]*sigma_pow[i];
+                            dvdl_coul     += Vcoul[i]*DLF[i] + LFC[i]*alpha_coul_eff*dlfac_coul[i]*FscalC[i]*sigma_pow[i];
+                            dvdl_vdw      += Vvdw[i]*DLF[i] + LFV[i]*alpha_vdw_eff*dlfac_vdw[i]*FscalV[i]*sigma_pow[i];
+                        }
+                    }
+                    else if (nlambda_sc == 1)
+                    {
+                        for (i = 0; i < NSTATES; i++)
+                        {
+                            energy_lin_coul[i] += Vcoul[i];
+                            energy_lin_vdw[i]  += Vvdw[i];
+                        }
+                    }
+                    else
+                    {
+                        for (i = 0; i < NSTATES; i++)
+                        {
+                            energy_sc[l]       += LFC[i]*Vcoul[i] + LFV[i]*Vvdw[i];
+                        }
+                    }
                 }
             }
             else if (icoul == GMX_NBKERNEL_ELEC_REACTIONFIELD)
@@ -778,9 +1419,10 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
 
                 for (i = 0; i < NSTATES; i++)
                 {
-                    vctot      += LFC[i]*qq[i]*VV;
-                    Fscal      += LFC[i]*qq[i]*FF;
-                    dvdl_coul  += DLF[i]*qq[i]*VV;
+                    vctot              += LFC[i]*qq[i]*VV;
+                    Fscal              += LFC[i]*qq[i]*FF;
+                    dvdl_coul          += DLF[i]*qq[i]*VV;
+                    energy_lin_coul[i] += qq[i]*VV;
                 }
             }
 
@@ -820,9 +1462,10 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
 
                 for (i = 0; i < NSTATES; i++)
                 {
-                    vctot      -= LFC[i]*qq[i]*v_lr;
-                    Fscal      -= LFC[i]*qq[i]*f_lr;
-                    dvdl_coul  -= (DLF[i]*qq[i])*v_lr;
+                    vctot              -= LFC[i]*qq[i]*v_lr;
+                    Fscal              -= LFC[i]*qq[i]*f_lr;
+                    dvdl_coul          -= (DLF[i]*qq[i])*v_lr;
+                    energy_lin_coul[i] -= qq[i]*v_lr;
                 }
             }
 
@@ -865,10 +1508,11 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
 
                 for (i = 0; i < NSTATES; i++)
                 {
-                    c6grid      = nbfp_grid[tj[i]];
-                    vvtot      += LFV[i]*c6grid*VV;
-                    Fscal      += LFV[i]*c6grid*FF;
-                    dvdl_vdw   += (DLF[i]*c6grid)*VV;
+                    c6grid             = nbfp_grid[tj[i]];
+                    vvtot             += LFV[i]*c6grid*VV;
+                    Fscal             += LFV[i]*c6grid*FF;
+                    dvdl_vdw          += (DLF[i]*c6grid)*VV;
+                    energy_lin_vdw[i] += c6grid*VV;
                 }
             }
 
@@ -921,7 +1565,7 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
 #pragma omp atomic
                 fshift[is3+2] += fiz;
             }
-            if (bDoPotential)
+            if (bDoPotential && !bMultiLambda)
             {
                 ggid               = gid[n];
 #pragma omp atomic
@@ -932,10 +1576,25 @@ gmx_nb_free_energy_kernel(const t_nblist * gmx_restrict    nlist,
         }
     }
 
+    if (!bMultiLambda)
+    {
+#pragma omp atomic
+        dvdl[efptCOUL] += dvdl_coul;
 #pragma omp atomic
-    dvdl[efptCOUL]     += dvdl_coul;
- #pragma omp atomic
-    dvdl[efptVDW]      += dvdl_vdw;
+        dvdl[efptVDW]  += dvdl_vdw;
+    }
+    else
+    {
+        for (l = 0; l < nlambda; l++)
+        {
+            for (i = 0; i < NSTATES; i++)
+            {
+                energy_sc[l] += LFC_multi[l*NSTATES + i]*energy_lin_coul[i] + LFV_multi[l*NSTATES + i]*energy_lin_vdw[i];
+            }
+#pragma omp atomic
+            kernel_data->energy_multi[l] += energy_sc[l];
+        }
+    }
 
     /* Estimate flops, average for free energy stuff:
      * 12  flops per outer iteration
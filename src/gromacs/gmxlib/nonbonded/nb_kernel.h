@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2012,2014,2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -71,6 +71,14 @@ typedef struct
     real *             energygrp_elec;
     real *             energygrp_vdw;
     real *             energygrp_polarization;
+
+    /* Only used with GMX_NONBONDED_DO_MULTILAMBDA: the number of lambda
+     * points, efptNR lambda values for each point and the total (Coulomb
+     * plus VdW) potential for each point, which is added to.
+     */
+    int                nlambda_multi;
+    const real *       lambda_multi;
+    double *           energy_multi;
 }
 nb_kernel_data_t;
 
@@ -356,14 +356,24 @@ void check_ir(const char *mdparin, t_inputrec *ir, t_gromppopts *opts,
             }
         }
 
-        if (!(ir->vdwtype == evdwCUT || ir->vdwtype == evdwPME))
+        if (!(ir->vdwtype == evdwCUT || ir->vdwtype == evdwPME || ir->vdwtype == evdwUSER))
         {
-            warning_error(wi, "With Verlet lists only cut-off and PME LJ interactions are supported");
+            warning_error(wi, "With Verlet lists only cut-off, PME and user LJ interactions are supported");
         }
         if (!(ir->coulombtype == eelCUT || EEL_RF(ir->coulombtype) ||
-              EEL_PME(ir->coulombtype) || ir->coulombtype == eelEWALD))
+              EEL_PME(ir->coulombtype) || ir->coulombtype == eelEWALD ||
+              ir->coulombtype == eelUSER))
         {
-            warning_error(wi, "With Verlet lists only cut-off, reaction-field, PME and Ewald electrostatics are supported");
+            warning_error(wi, "With Verlet lists only cut-off, reaction-field, PME, Ewald and user electrostatics are supported");
+        }
+        if (ir->vdwtype == evdwUSER || ir->coulombtype == eelUSER)
+        {
+            warning_note(wi, "With Verlet lists the user tables are used as is and potential modifiers are not applied, so the tabulated potentials should go smoothly to zero at the cut-off. The Verlet buffer size is estimated assuming plain Lennard-Jones and Coulomb interactions, check that this is reasonable for your tables.");
+
+            if (ir->efep != efepNO)
+            {
+                warning_error(wi, "With Verlet lists user tables are not supported with free-energy calculations");
+            }
         }
         if (!(ir->coulomb_modifier == eintmodNONE ||
               ir->coulomb_modifier == eintmodPOTSHIFT))
@@ -3799,6 +3809,10 @@ void do_index(const char* mdparin, const char *ndx,
     {
         gmx_fatal(FARGS, "Can only have energy group pair tables in combination with user tables for VdW and/or Coulomb");
     }
+    if (bTable && ir->cutoff_scheme == ecutsVERLET)
+    {
+        warning_error(wi, "Energy group pair tables are not (yet) implemented for the Verlet scheme");
+    }
 
     for (i = 0; (i < grps->nr); i++)
     {
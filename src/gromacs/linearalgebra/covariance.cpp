@@ -0,0 +1,85 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include "covariance.h"
+
+#include <algorithm>
+
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/real.h"
+
+//! Number of matrix rows in a tile of the covariance update
+static const int c_covarTileRows = 32;
+//! Number of matrix columns in a tile of the covariance update
+static const int c_covarTileCols = 512;
+
+void
+add_covariance_batch(int          ndim,
+                     int          nbatch,
+                     const real * xbatch,
+                     real *       mat)
+{
+    int nblock = (ndim + c_covarTileRows - 1)/c_covarTileRows;
+
+#pragma omp parallel for num_threads(gmx_omp_get_max_threads()) schedule(dynamic)
+    for (int block = 0; block < nblock; block++)
+    {
+        int r0 = block*c_covarTileRows;
+        int r1 = std::min(r0 + c_covarTileRows, ndim);
+
+        for (int c0 = r0; c0 < ndim; c0 += c_covarTileCols)
+        {
+            int c1 = std::min(c0 + c_covarTileCols, ndim);
+
+            for (int r = r0; r < r1; r++)
+            {
+                real *row = mat + static_cast<size_t>(r)*ndim;
+                int   cs  = std::max(r, c0);
+
+                for (int f = 0; f < nbatch; f++)
+                {
+                    const real *xf = xbatch + static_cast<size_t>(f)*ndim;
+                    real        xr = xf[r];
+
+                    for (int c = cs; c < c1; c++)
+                    {
+                        row[c] += xr*xf[c];
+                    }
+                }
+            }
+        }
+    }
+}
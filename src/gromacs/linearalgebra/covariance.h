@@ -0,0 +1,68 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#ifndef GMX_LINEARALGEBRA_COVARIANCE_H
+#define GMX_LINEARALGEBRA_COVARIANCE_H
+
+#include "gromacs/utility/real.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \brief Adds a batch of outer products to a covariance matrix.
+ *
+ *  Adds the outer products of nbatch vectors of length ndim to the upper
+ *  triangle, including the diagonal, of the ndim*ndim matrix mat.
+ *  This is a rank-nbatch update, as SYRK in BLAS. The matrix is updated
+ *  in tiles, so a tile stays in cache while all vectors of the batch are
+ *  added to it, and the blocks of tile rows are divided over the OpenMP
+ *  threads. The lower triangle of mat is not accessed.
+ *
+ *  \param ndim    Length of the vectors and side of the matrix.
+ *  \param nbatch  Number of vectors.
+ *  \param xbatch  The vectors, stored consecutively, total size nbatch*ndim.
+ *  \param mat     The matrix to add to, total size ndim*ndim.
+ */
+void
+add_covariance_batch(int          ndim,
+                     int          nbatch,
+                     const real * xbatch,
+                     real *       mat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
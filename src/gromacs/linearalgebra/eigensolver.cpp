@@ -38,8 +38,12 @@
 
 #include "eigensolver.h"
 
+#include <algorithm>
+#include <functional>
+
 #include "gromacs/linearalgebra/sparsematrix.h"
 #include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/real.h"
 #include "gromacs/utility/smalloc.h"
 
@@ -140,13 +144,21 @@ eigensolver(real *   a,
 }
 
 
-#ifdef GMX_MPI_NOT
-void
-sparse_parallel_eigensolver(gmx_sparsematrix_t *    A,
-                            int                     neig,
-                            real *                  eigenvalues,
-                            real *                  eigenvectors,
-                            int                     maxiter)
+/* Determines neig eigenvalues, and eigenvectors when eigenvectors!=nullptr,
+ * of a symmetric n*n matrix with the implicitly restarted Lanczos method
+ * from ARPACK, using ncv Lanczos vectors. which selects the eigenvalues,
+ * "SA" for the smallest and "LA" for the largest. The ARPACK reverse
+ * communication calls multiply(x, y), which should compute y = A x.
+ */
+static void
+arpack_symmetric_eigensolver(int                                        n,
+                             int                                        neig,
+                             int                                        ncv,
+                             const char                                *which,
+                             const std::function<void(real *, real *)> &multiply,
+                             real                                      *eigenvalues,
+                             real                                      *eigenvectors,
+                             int                                        maxiter)
 {
     int      iwork[80];
     int      iparam[11];
@@ -155,32 +167,10 @@ sparse_parallel_eigensolver(gmx_sparsematrix_t *    A,
     real *   workd;
     real *   workl;
     real *   v;
-    int      n;
-    int      ido, info, lworkl, i, ncv, dovec;
+    int      ido, info, lworkl, i, dovec;
     real     abstol;
     int *    select;
     int      iter;
-    int      nnodes, rank;
-
-    MPI_Comm_size( MPI_COMM_WORLD, &nnodes );
-    MPI_Comm_rank( MPI_COMM_WORLD, &rank );
-
-    if (eigenvectors != NULL)
-    {
-        dovec = 1;
-    }
-    else
-    {
-        dovec = 0;
-    }
-
-    n   = A->nrow;
-    ncv = 2*neig;
-
-    if (ncv > n)
-    {
-        ncv = n;
-    }
 
     for (i = 0; i < 11; i++)
     {
@@ -196,29 +186,29 @@ sparse_parallel_eigensolver(gmx_sparsematrix_t *    A,
     snew(workd, (3*n+4));
     snew(workl, lworkl);
     snew(select, ncv);
-    snew(v, n*ncv);
+    snew(v, static_cast<size_t>(n)*ncv);
 
     /* Use machine tolerance - roughly 1e-16 in double precision */
     abstol = 0;
 
     ido = info = 0;
-    fprintf(stderr, "Calculation Ritz values and Lanczos vectors, max %d iterations...\n", maxiter);
+    fprintf(stderr, "Calculating Ritz values and Lanczos vectors, max %d iterations...\n", maxiter);
 
     iter = 1;
     do
     {
 #if GMX_DOUBLE
-        F77_FUNC(pdsaupd, PDSAUPD) (&ido, "I", &n, "SA", &neig, &abstol,
-                                    resid, &ncv, v, &n, iparam, ipntr,
-                                    workd, iwork, workl, &lworkl, &info);
+        F77_FUNC(dsaupd, DSAUPD) (&ido, "I", &n, which, &neig, &abstol,
+                                  resid, &ncv, v, &n, iparam, ipntr,
+                                  workd, iwork, workl, &lworkl, &info);
 #else
-        F77_FUNC(pssaupd, PSSAUPD) (&ido, "I", &n, "SA", &neig, &abstol,
-                                    resid, &ncv, v, &n, iparam, ipntr,
-                                    workd, iwork, workl, &lworkl, &info);
+        F77_FUNC(ssaupd, SSAUPD) (&ido, "I", &n, which, &neig, &abstol,
+                                  resid, &ncv, v, &n, iparam, ipntr,
+                                  workd, iwork, workl, &lworkl, &info);
 #endif
         if (ido == -1 || ido == 1)
         {
-            gmx_sparsematrix_vector_multiply(A, workd+ipntr[0]-1, workd+ipntr[1]-1);
+            multiply(workd+ipntr[0]-1, workd+ipntr[1]-1);
         }
 
         fprintf(stderr, "\rIteration %4d: %3d out of %3d Ritz values converged.", iter++, iparam[4], neig);
@@ -230,30 +220,36 @@ sparse_parallel_eigensolver(gmx_sparsematrix_t *    A,
     if (info == 1)
     {
         gmx_fatal(FARGS,
-                  "Maximum number of iterations (%d) reached in Arnoldi\n"
+                  "Maximum number of iterations (%d) reached in Lanczos\n"
                   "diagonalization, but only %d of %d eigenvectors converged.\n",
                   maxiter, iparam[4], neig);
     }
     else if (info != 0)
     {
-        gmx_fatal(FARGS, "Unspecified error from Arnoldi diagonalization:%d\n", info);
+        gmx_fatal(FARGS, "Unspecified error from Lanczos diagonalization:%d\n", info);
     }
 
     info = 0;
     /* Extract eigenvalues and vectors from data */
     fprintf(stderr, "Calculating eigenvalues and eigenvectors...\n");
 
+    dovec = (eigenvectors != nullptr) ? 1 : 0;
+
 #if GMX_DOUBLE
-    F77_FUNC(pdseupd, PDSEUPD) (&dovec, "A", select, eigenvalues, eigenvectors,
-                                &n, NULL, "I", &n, "SA", &neig, &abstol,
-                                resid, &ncv, v, &n, iparam, ipntr,
-                                workd, workl, &lworkl, &info);
+    F77_FUNC(dseupd, DSEUPD) (&dovec, "A", select, eigenvalues, eigenvectors,
+                              &n, nullptr, "I", &n, which, &neig, &abstol,
+                              resid, &ncv, v, &n, iparam, ipntr,
+                              workd, workl, &lworkl, &info);
 #else
-    F77_FUNC(psseupd, PSSEUPD) (&dovec, "A", select, eigenvalues, eigenvectors,
-                                &n, NULL, "I", &n, "SA", &neig, &abstol,
-                                resid, &ncv, v, &n, iparam, ipntr,
-                                workd, workl, &lworkl, &info);
+    F77_FUNC(sseupd, SSEUPD) (&dovec, "A", select, eigenvalues, eigenvectors,
+                              &n, nullptr, "I", &n, which, &neig, &abstol,
+                              resid, &ncv, v, &n, iparam, ipntr,
+                              workd, workl, &lworkl, &info);
 #endif
+    if (info != 0)
+    {
+        gmx_fatal(FARGS, "Error extracting eigenvectors from Lanczos diagonalization:%d\n", info);
+    }
 
     sfree(v);
     sfree(resid);
@@ -261,15 +257,63 @@ sparse_parallel_eigensolver(gmx_sparsematrix_t *    A,
     sfree(workl);
     sfree(select);
 }
-#endif
 
 
+/* Computes y = A x for the symmetric n*n matrix a, with the rows
+ * divided over the OpenMP threads.
+ */
+static void
+dense_matrix_vector_multiply(const real *a, int n, const real *x, real *y)
+{
+#pragma omp parallel for num_threads(gmx_omp_get_max_threads()) schedule(static)
+    for (int i = 0; i < n; i++)
+    {
+        const real *row = a + static_cast<size_t>(i)*n;
+        real        sum = 0;
+
+        for (int j = 0; j < n; j++)
+        {
+            sum += row[j]*x[j];
+        }
+        y[i] = sum;
+    }
+}
+
 void
-sparse_eigensolver(gmx_sparsematrix_t *    A,
-                   int                     neig,
-                   real *                  eigenvalues,
-                   real *                  eigenvectors,
-                   int                     maxiter)
+dense_largest_eigensolver(const real *  a,
+                          int           n,
+                          int           neig,
+                          real *        eigenvalues,
+                          real *        eigenvectors,
+                          int           maxiter)
+{
+    if (neig <= 0 || neig >= n)
+    {
+        gmx_fatal(FARGS, "Can only determine between 1 and %d eigenvalues with the Lanczos method, not %d", n-1, neig);
+    }
+
+    /* With only twice as many Lanczos vectors as eigenvalues, as used
+     * for the sparse normal-mode matrices, eigenvalues that are small
+     * compared to the largest one are sometimes missed in single precision.
+     */
+    int ncv = std::min(4*neig, n);
+
+    arpack_symmetric_eigensolver(n, neig, ncv, "LA",
+                                 [a, n](real *x, real *y)
+                                 {
+                                     dense_matrix_vector_multiply(a, n, x, y);
+                                 },
+                                 eigenvalues, eigenvectors, maxiter);
+}
+
+
+#ifdef GMX_MPI_NOT
+void
+sparse_parallel_eigensolver(gmx_sparsematrix_t *    A,
+                            int                     neig,
+                            real *                  eigenvalues,
+                            real *                  eigenvectors,
+                            int                     maxiter)
 {
     int      iwork[80];
     int      iparam[11];
@@ -283,17 +327,12 @@ sparse_eigensolver(gmx_sparsematrix_t *    A,
     real     abstol;
     int *    select;
     int      iter;
+    int      nnodes, rank;
 
-#ifdef GMX_MPI_NOT
-    MPI_Comm_size( MPI_COMM_WORLD, &n );
-    if (n > 1)
-    {
-        sparse_parallel_eigensolver(A, neig, eigenvalues, eigenvectors, maxiter);
-        return;
-    }
-#endif
+    MPI_Comm_size( MPI_COMM_WORLD, &nnodes );
+    MPI_Comm_rank( MPI_COMM_WORLD, &rank );
 
-    if (eigenvectors != nullptr)
+    if (eigenvectors != NULL)
     {
         dovec = 1;
     }
@@ -330,19 +369,19 @@ sparse_eigensolver(gmx_sparsematrix_t *    A,
     abstol = 0;
 
     ido = info = 0;
-    fprintf(stderr, "Calculation Ritz values and Lanczos vectors, max %d iterations...\n", maxiter);
+    fprintf(stderr, "Calculating Ritz values and Lanczos vectors, max %d iterations...\n", maxiter);
 
     iter = 1;
     do
     {
 #if GMX_DOUBLE
-        F77_FUNC(dsaupd, DSAUPD) (&ido, "I", &n, "SA", &neig, &abstol,
-                                  resid, &ncv, v, &n, iparam, ipntr,
-                                  workd, iwork, workl, &lworkl, &info);
+        F77_FUNC(pdsaupd, PDSAUPD) (&ido, "I", &n, "SA", &neig, &abstol,
+                                    resid, &ncv, v, &n, iparam, ipntr,
+                                    workd, iwork, workl, &lworkl, &info);
 #else
-        F77_FUNC(ssaupd, SSAUPD) (&ido, "I", &n, "SA", &neig, &abstol,
-                                  resid, &ncv, v, &n, iparam, ipntr,
-                                  workd, iwork, workl, &lworkl, &info);
+        F77_FUNC(pssaupd, PSSAUPD) (&ido, "I", &n, "SA", &neig, &abstol,
+                                    resid, &ncv, v, &n, iparam, ipntr,
+                                    workd, iwork, workl, &lworkl, &info);
 #endif
         if (ido == -1 || ido == 1)
         {
@@ -372,15 +411,15 @@ sparse_eigensolver(gmx_sparsematrix_t *    A,
     fprintf(stderr, "Calculating eigenvalues and eigenvectors...\n");
 
 #if GMX_DOUBLE
-    F77_FUNC(dseupd, DSEUPD) (&dovec, "A", select, eigenvalues, eigenvectors,
-                              &n, nullptr, "I", &n, "SA", &neig, &abstol,
-                              resid, &ncv, v, &n, iparam, ipntr,
-                              workd, workl, &lworkl, &info);
+    F77_FUNC(pdseupd, PDSEUPD) (&dovec, "A", select, eigenvalues, eigenvectors,
+                                &n, NULL, "I", &n, "SA", &neig, &abstol,
+                                resid, &ncv, v, &n, iparam, ipntr,
+                                workd, workl, &lworkl, &info);
 #else
-    F77_FUNC(sseupd, SSEUPD) (&dovec, "A", select, eigenvalues, eigenvectors,
-                              &n, nullptr, "I", &n, "SA", &neig, &abstol,
-                              resid, &ncv, v, &n, iparam, ipntr,
-                              workd, workl, &lworkl, &info);
+    F77_FUNC(psseupd, PSSEUPD) (&dovec, "A", select, eigenvalues, eigenvectors,
+                                &n, NULL, "I", &n, "SA", &neig, &abstol,
+                                resid, &ncv, v, &n, iparam, ipntr,
+                                workd, workl, &lworkl, &info);
 #endif
 
     sfree(v);
@@ -389,3 +428,40 @@ sparse_eigensolver(gmx_sparsematrix_t *    A,
     sfree(workl);
     sfree(select);
 }
+#endif
+
+
+void
+sparse_eigensolver(gmx_sparsematrix_t *    A,
+                   int                     neig,
+                   real *                  eigenvalues,
+                   real *                  eigenvectors,
+                   int                     maxiter)
+{
+    int      n;
+    int      ncv;
+
+#ifdef GMX_MPI_NOT
+    MPI_Comm_size( MPI_COMM_WORLD, &n );
+    if (n > 1)
+    {
+        sparse_parallel_eigensolver(A, neig, eigenvalues, eigenvectors, maxiter);
+        return;
+    }
+#endif
+
+    n   = A->nrow;
+    ncv = 2*neig;
+
+    if (ncv > n)
+    {
+        ncv = n;
+    }
+
+    arpack_symmetric_eigensolver(n, neig, ncv, "SA",
+                                 [A](real *x, real *y)
+                                 {
+                                     gmx_sparsematrix_vector_multiply(A, x, y);
+                                 },
+                                 eigenvalues, eigenvectors, maxiter);
+}
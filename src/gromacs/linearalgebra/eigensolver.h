@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2012,2014, by the GROMACS development team, led by
+ * Copyright (c) 2012,2014,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -75,6 +75,34 @@ eigensolver(real *   a,
 
 
 
+/*! \brief Eigensolver for the largest eigenvalues of a dense symmetric matrix.
+ *
+ *  This routine uses the implicitly restarted Lanczos method from ARPACK,
+ *  which only requires products of the matrix with vectors. These are
+ *  computed with OpenMP threads. When only a few eigenvectors of a large
+ *  matrix are wanted, this is much faster than eigensolver().
+ *
+ *  \param a            Pointer to symmetric matrix data, total size n*n.
+ *                      Both halves of the matrix should be filled.
+ *                      The matrix is not changed.
+ *  \param n            Side of the matrix.
+ *  \param neig         Number of largest eigenvalues to determine,
+ *                      should be less than n.
+ *  \param eigenvalues  Array of the neig largest eigenvalues on return,
+ *                      sorted in ascending order.
+ *  \param eigenvectors If this pointer is non-NULL, the corresponding
+ *                      eigenvectors are returned as rows of a neig*n
+ *                      matrix, in the same order as the eigenvalues.
+ *  \param maxiter      Maximum number of Lanczos iterations.
+ */
+void
+dense_largest_eigensolver(const real *  a,
+                          int           n,
+                          int           neig,
+                          real *        eigenvalues,
+                          real *        eigenvectors,
+                          int           maxiter);
+
 /*! \brief Sparse matrix eigensolver.
  *
  *  This routine is intended for large matrices that might not fit in memory.
@@ -0,0 +1,128 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the batched covariance matrix update.
+ *
+ * The update is compared with adding the outer products one vector at a
+ * time, as gmx covar did before batching.
+ */
+#include "gmxpre.h"
+
+#include "gromacs/linearalgebra/covariance.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+/*! \brief Checks add_covariance_batch() for vectors of length \p ndim.
+ *
+ * Two batches are added, to check that the update adds to the matrix.
+ */
+void testCovarianceBatch(int ndim, int nbatch)
+{
+    gmx::ThreeFry2x64<64>               rng(123456, gmx::RandomDomain::Other);
+    gmx::UniformRealDistribution<real>  dist(-1, 1);
+
+    std::vector<real> x(2*nbatch*ndim);
+    for (real &xi : x)
+    {
+        xi = dist(rng);
+    }
+
+    /* Mark the lower triangle, which should not be changed */
+    const real        lowerValue = 12345;
+    std::vector<real> mat(ndim*ndim, 0);
+    for (int i = 0; i < ndim; i++)
+    {
+        for (int j = 0; j < i; j++)
+        {
+            mat[i*ndim + j] = lowerValue;
+        }
+    }
+    add_covariance_batch(ndim, nbatch, x.data(), mat.data());
+    add_covariance_batch(ndim, nbatch, x.data() + nbatch*ndim, mat.data());
+
+    std::vector<real> ref(ndim*ndim, 0);
+    for (int f = 0; f < 2*nbatch; f++)
+    {
+        const real *xf = x.data() + f*ndim;
+        for (int i = 0; i < ndim; i++)
+        {
+            for (int j = i; j < ndim; j++)
+            {
+                ref[i*ndim + j] += xf[i]*xf[j];
+            }
+        }
+    }
+
+    for (int i = 0; i < ndim; i++)
+    {
+        for (int j = 0; j < ndim; j++)
+        {
+            if (j < i)
+            {
+                EXPECT_EQ(lowerValue, mat[i*ndim + j]) << "row " << i << " column " << j;
+            }
+            else
+            {
+                EXPECT_REAL_EQ_TOL(ref[i*ndim + j], mat[i*ndim + j],
+                                   gmx::test::relativeToleranceAsFloatingPoint(2*nbatch, 1e-5))
+                << "row " << i << " column " << j;
+            }
+        }
+    }
+}
+
+TEST(CovarianceBatchTest, MatchesSingleVectorUpdates)
+{
+    testCovarianceBatch(30, 7);
+}
+
+TEST(CovarianceBatchTest, MatchesSingleVectorUpdatesWithMultipleTiles)
+{
+    // More than one tile of rows and of columns, with partial tiles
+    testCovarianceBatch(3*200, 5);
+}
+
+} // namespace
@@ -0,0 +1,177 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the eigensolvers.
+ *
+ * The eigenpairs from the Lanczos methods are compared with those
+ * from the full diagonalization.
+ */
+#include "gmxpre.h"
+
+#include "gromacs/linearalgebra/eigensolver.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/random/threefry.h"
+#include "gromacs/linearalgebra/sparsematrix.h"
+#include "gromacs/random/uniformrealdistribution.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+/*! \brief Returns a random n*n covariance matrix.
+ *
+ * The matrix is the covariance of random vectors with components of
+ * different magnitude, so the eigenvalues are spread out.
+ */
+std::vector<real> randomCovarianceMatrix(int n)
+{
+    gmx::ThreeFry2x64<64>               rng(123456, gmx::RandomDomain::Other);
+    gmx::UniformRealDistribution<real>  dist(-1, 1);
+    const int                           nsample = 2*n;
+
+    std::vector<double>                 x(n);
+    std::vector<double>                 cov(n*n, 0);
+    for (int s = 0; s < nsample; s++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            x[i] = dist(rng)*std::exp(-0.05*i);
+        }
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                cov[i*n + j] += x[i]*x[j]/nsample;
+            }
+        }
+    }
+
+    return std::vector<real>(cov.begin(), cov.end());
+}
+
+TEST(DenseLargestEigensolverTest, MatchesFullDiagonalization)
+{
+    const int               n    = 60;
+    const int               neig = 6;
+    const std::vector<real> mat  = randomCovarianceMatrix(n);
+
+    std::vector<real>       fullMat(mat);
+    std::vector<real>       fullValues(n);
+    std::vector<real>       fullVectors(n*n);
+    eigensolver(fullMat.data(), n, 0, n, fullValues.data(), fullVectors.data());
+
+    std::vector<real>       lanczosMat(mat);
+    std::vector<real>       lanczosValues(neig);
+    std::vector<real>       lanczosVectors(neig*n);
+    dense_largest_eigensolver(lanczosMat.data(), n, neig,
+                              lanczosValues.data(), lanczosVectors.data(), 100000);
+
+    /* The input matrix should not be changed */
+    for (int i = 0; i < n*n; i++)
+    {
+        EXPECT_EQ(mat[i], lanczosMat[i]);
+    }
+
+    const gmx::test::FloatingPointTolerance tolerance
+        = gmx::test::relativeToleranceAsFloatingPoint(fullValues[n - 1], 1e-4);
+    for (int k = 0; k < neig; k++)
+    {
+        /* Both return the eigenvalues in ascending order */
+        const int fullIndex = n - neig + k;
+        EXPECT_REAL_EQ_TOL(fullValues[fullIndex], lanczosValues[k], tolerance)
+        << "eigenvalue " << fullIndex;
+
+        /* The eigenvectors are normalized, but the sign is arbitrary */
+        double    dot = 0;
+        for (int i = 0; i < n; i++)
+        {
+            dot += fullVectors[fullIndex*n + i]*lanczosVectors[k*n + i];
+        }
+        EXPECT_REAL_EQ_TOL(1.0, std::abs(dot), gmx::test::absoluteTolerance(1e-3))
+        << "eigenvector " << fullIndex;
+    }
+}
+
+TEST(SparseEigensolverTest, MatchesFullDiagonalization)
+{
+    const int               n    = 60;
+    const int               neig = 6;
+    const std::vector<real> mat  = randomCovarianceMatrix(n);
+
+    std::vector<real>       fullMat(mat);
+    std::vector<real>       fullValues(n);
+    std::vector<real>       fullVectors(n*n);
+    eigensolver(fullMat.data(), n, 0, n, fullValues.data(), fullVectors.data());
+
+    gmx_sparsematrix_t     *sparseMat = gmx_sparsematrix_init(n);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            gmx_sparsematrix_increment_value(sparseMat, i, j, mat[i*n + j]);
+        }
+    }
+    std::vector<real>       lanczosValues(neig);
+    std::vector<real>       lanczosVectors(neig*n);
+    sparse_eigensolver(sparseMat, neig, lanczosValues.data(), lanczosVectors.data(), 100000);
+    gmx_sparsematrix_destroy(sparseMat);
+
+    const gmx::test::FloatingPointTolerance tolerance
+        = gmx::test::relativeToleranceAsFloatingPoint(fullValues[n - 1], 1e-4);
+    for (int k = 0; k < neig; k++)
+    {
+        /* The smallest eigenpairs, both in ascending order */
+        EXPECT_REAL_EQ_TOL(fullValues[k], lanczosValues[k], tolerance)
+        << "eigenvalue " << k;
+
+        double dot = 0;
+        for (int i = 0; i < n; i++)
+        {
+            dot += fullVectors[k*n + i]*lanczosVectors[k*n + i];
+        }
+        EXPECT_REAL_EQ_TOL(1.0, std::abs(dot), gmx::test::absoluteTolerance(1e-3))
+        << "eigenvector " << k;
+    }
+}
+
+} // namespace
@@ -419,6 +419,172 @@ real bonds(int nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/* Adds the shift forces of nlane interactions computed with SIMD.
+ * For atom a of the natom atoms in an interaction, other than the
+ * reference atom aj, atoms[a] contains the atom indices and fa the
+ * forces, stored as DIM consecutive blocks of GMX_SIMD_REAL_WIDTH
+ * per atom. The shifts are determined as in the plain-C kernels.
+ * As the forces of an interaction sum to zero, atoms that are not
+ * shifted with respect to aj do not contribute.
+ */
+static void
+add_shift_forces_simd_batch(int nlane, int natom,
+                            const int * const atoms[], const int *aj,
+                            const real *fa,
+                            const rvec x[], const t_pbc *pbc,
+                            const t_graph *g, rvec fshift[])
+{
+    if (pbc == nullptr && g == nullptr)
+    {
+        /* All shifts are CENTRAL */
+        return;
+    }
+
+    for (int s = 0; s < nlane; s++)
+    {
+        for (int a = 0; a < natom; a++)
+        {
+            int ai = atoms[a][s];
+            int t;
+
+            if (g != nullptr)
+            {
+                ivec dt;
+
+                ivec_sub(SHIFT_IVEC(g, ai), SHIFT_IVEC(g, aj[s]), dt);
+                t = IVEC2IS(dt);
+            }
+            else
+            {
+                rvec dx;
+
+                t = pbc_rvec_sub(pbc, x[ai], x[aj[s]], dx);
+            }
+
+            if (t != CENTRAL)
+            {
+                const real *fas = fa + a*DIM*GMX_SIMD_REAL_WIDTH + s;
+
+                for (int m = 0; m < DIM; m++)
+                {
+                    fshift[t][m]       += fas[m*GMX_SIMD_REAL_WIDTH];
+                    fshift[CENTRAL][m] -= fas[m*GMX_SIMD_REAL_WIDTH];
+                }
+            }
+        }
+    }
+}
+
+/* As bonds, but using SIMD to calculate many bonds at once.
+ * Energies and shift forces are only computed with computeEnergyAndVirial,
+ * the energy is returned.
+ */
+template <bool computeEnergyAndVirial>
+static real
+bonds_simd_kernel(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec4 f[], rvec fshift[],
+                  const t_pbc *pbc, const t_graph *g)
+{
+    const int            nfa1 = 3;
+    int                  i, iu, s;
+    int                  type;
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ai[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    aj[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   coeff[2*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   fbuf[DIM*GMX_SIMD_REAL_WIDTH];
+    const int           *shift_atoms[1] = { ai };
+    SimdReal             xi_S, yi_S, zi_S;
+    SimdReal             xj_S, yj_S, zj_S;
+    SimdReal             k_S, b0_S;
+    SimdReal             dx_S, dy_S, dz_S;
+    SimdReal             dr2_S, rinv_S, ddr_S;
+    SimdReal             fscal_S;
+    SimdReal             fx_S, fy_S, fz_S;
+    SimdBool             nonzero_S;
+    SimdReal             half_S(0.5);
+    SimdReal             vtot_S = setZero();
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of bonds times nfa1, here we step GMX_SIMD_REAL_WIDTH bonds */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms pairs for GMX_SIMD_REAL_WIDTH bonds.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s*nfa1 < nbonds)
+            {
+                coeff[s]                     = forceparams[type].harmonic.krA;
+                coeff[GMX_SIMD_REAL_WIDTH+s] = forceparams[type].harmonic.rA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                     = 0;
+                coeff[GMX_SIMD_REAL_WIDTH+s] = 0;
+            }
+        }
+
+        gatherLoadUTranspose<3>(reinterpret_cast<const real *>(x), ai, &xi_S, &yi_S, &zi_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real *>(x), aj, &xj_S, &yj_S, &zj_S);
+        dx_S      = xi_S - xj_S;
+        dy_S      = yi_S - yj_S;
+        dz_S      = zi_S - zj_S;
+
+        k_S       = load(coeff);
+        b0_S      = load(coeff+GMX_SIMD_REAL_WIDTH);
+
+        pbc_correct_dx_simd(&dx_S, &dy_S, &dz_S, pbc_simd);
+
+        dr2_S     = norm2(dx_S, dy_S, dz_S);
+
+        /* As in bonds(), bonds of zero length do not contribute */
+        nonzero_S = setZero() < dr2_S;
+        rinv_S    = maskzInvsqrt(dr2_S, nonzero_S);
+        ddr_S     = fms(dr2_S, rinv_S, b0_S);
+
+        fscal_S   = -k_S * ddr_S * rinv_S;
+        fx_S      = fscal_S * dx_S;
+        fy_S      = fscal_S * dy_S;
+        fz_S      = fscal_S * dz_S;
+
+        transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ai, fx_S, fy_S, fz_S);
+        transposeScatterDecrU<4>(reinterpret_cast<real *>(f), aj, fx_S, fy_S, fz_S);
+
+        if (computeEnergyAndVirial)
+        {
+            vtot_S = vtot_S + selectByMask(half_S * k_S * ddr_S * ddr_S, nonzero_S);
+
+            store(fbuf + 0*GMX_SIMD_REAL_WIDTH, fx_S);
+            store(fbuf + 1*GMX_SIMD_REAL_WIDTH, fy_S);
+            store(fbuf + 2*GMX_SIMD_REAL_WIDTH, fz_S);
+            add_shift_forces_simd_batch(std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1),
+                                        1, shift_atoms, aj, fbuf,
+                                        x, pbc, g, fshift);
+        }
+    }
+
+    return computeEnergyAndVirial ? reduce(vtot_S) : 0;
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 real restraint_bonds(int nbonds,
                      const t_iatom forceatoms[], const t_iparams forceparams[],
                      const rvec x[], rvec4 f[], rvec fshift[],
@@ -968,16 +1134,15 @@ real angles(int nbonds,
 #if GMX_SIMD_HAVE_REAL
 
 /* As angles, but using SIMD to calculate many angles at once.
- * This routines does not calculate energies and shift forces.
+ * Energies and shift forces are only computed with computeEnergyAndVirial,
+ * the energy is returned.
  */
-void
-angles_noener_simd(int nbonds,
+template <bool computeEnergyAndVirial>
+static real
+angles_simd_kernel(int nbonds,
                    const t_iatom forceatoms[], const t_iparams forceparams[],
-                   const rvec x[], rvec4 f[],
-                   const t_pbc *pbc, const t_graph gmx_unused *g,
-                   real gmx_unused lambda,
-                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                   int gmx_unused *global_atom_index)
+                   const rvec x[], rvec4 f[], rvec fshift[],
+                   const t_pbc *pbc, const t_graph *g)
 {
     const int            nfa1 = 4;
     int                  i, iu, s;
@@ -986,6 +1151,8 @@ angles_noener_simd(int nbonds,
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    aj[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   coeff[2*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   fbuf[2*DIM*GMX_SIMD_REAL_WIDTH];
+    const int           *shift_atoms[2] = { ai, ak };
     SimdReal             deg2rad_S(DEG2RAD);
     SimdReal             xi_S, yi_S, zi_S;
     SimdReal             xj_S, yj_S, zj_S;
@@ -1005,6 +1172,9 @@ angles_noener_simd(int nbonds,
     SimdReal             cik_S, cii_S, ckk_S;
     SimdReal             f_ix_S, f_iy_S, f_iz_S;
     SimdReal             f_kx_S, f_ky_S, f_kz_S;
+    SimdReal             dtheta_S;
+    SimdReal             half_S(0.5);
+    SimdReal             vtot_S = setZero();
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
 
     set_pbc_simd(pbc, pbc_simd);
@@ -1105,7 +1275,41 @@ angles_noener_simd(int nbonds,
         transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ai, f_ix_S, f_iy_S, f_iz_S);
         transposeScatterDecrU<4>(reinterpret_cast<real *>(f), aj, f_ix_S + f_kx_S, f_iy_S + f_ky_S, f_iz_S + f_kz_S);
         transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ak, f_kx_S, f_ky_S, f_kz_S);
+
+        if (computeEnergyAndVirial)
+        {
+            dtheta_S = theta_S - theta0_S;
+            vtot_S   = fma(half_S * k_S, dtheta_S * dtheta_S, vtot_S);
+
+            store(fbuf + 0*GMX_SIMD_REAL_WIDTH, f_ix_S);
+            store(fbuf + 1*GMX_SIMD_REAL_WIDTH, f_iy_S);
+            store(fbuf + 2*GMX_SIMD_REAL_WIDTH, f_iz_S);
+            store(fbuf + 3*GMX_SIMD_REAL_WIDTH, f_kx_S);
+            store(fbuf + 4*GMX_SIMD_REAL_WIDTH, f_ky_S);
+            store(fbuf + 5*GMX_SIMD_REAL_WIDTH, f_kz_S);
+            add_shift_forces_simd_batch(std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1),
+                                        2, shift_atoms, aj, fbuf,
+                                        x, pbc, g, fshift);
+        }
     }
+
+    return computeEnergyAndVirial ? reduce(vtot_S) : 0;
+}
+
+/* As angles, but using SIMD to calculate many angles at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+angles_noener_simd(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec4 f[],
+                   const t_pbc *pbc, const t_graph *g,
+                   real gmx_unused lambda,
+                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                   int gmx_unused *global_atom_index)
+{
+    angles_simd_kernel<false>(nbonds, forceatoms, forceparams,
+                              x, f, nullptr, pbc, g);
 }
 
 #endif // GMX_SIMD_HAVE_REAL
@@ -1657,6 +1861,26 @@ do_dih_fup_noshiftf_simd(const int *ai, const int *aj, const int *ak, const int
     transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ak, f_k_x, f_k_y, f_k_z);
     transposeScatterDecrU<4>(reinterpret_cast<real *>(f), al, mf_l_x, mf_l_y, mf_l_z);
 }
+
+/* Stores the forces on atoms i, k and l, as applied by
+ * do_dih_fup_noshiftf_simd, in the layout of add_shift_forces_simd_batch.
+ */
+static gmx_inline void gmx_simdcall
+store_dih_forces_simd(SimdReal p, SimdReal q,
+                      SimdReal f_i_x,  SimdReal f_i_y,  SimdReal f_i_z,
+                      SimdReal mf_l_x, SimdReal mf_l_y, SimdReal mf_l_z,
+                      real *fbuf)
+{
+    store(fbuf + 0*GMX_SIMD_REAL_WIDTH, f_i_x);
+    store(fbuf + 1*GMX_SIMD_REAL_WIDTH, f_i_y);
+    store(fbuf + 2*GMX_SIMD_REAL_WIDTH, f_i_z);
+    store(fbuf + 3*GMX_SIMD_REAL_WIDTH, mf_l_x - (p * f_i_x + q * mf_l_x));
+    store(fbuf + 4*GMX_SIMD_REAL_WIDTH, mf_l_y - (p * f_i_y + q * mf_l_y));
+    store(fbuf + 5*GMX_SIMD_REAL_WIDTH, mf_l_z - (p * f_i_z + q * mf_l_z));
+    store(fbuf + 6*GMX_SIMD_REAL_WIDTH, -mf_l_x);
+    store(fbuf + 7*GMX_SIMD_REAL_WIDTH, -mf_l_y);
+    store(fbuf + 8*GMX_SIMD_REAL_WIDTH, -mf_l_z);
+}
 #endif // GMX_SIMD_HAVE_REAL
 
 real dopdihs(real cpA, real cpB, real phiA, real phiB, int mult,
@@ -1844,15 +2068,16 @@ pdihs_noener(int nbonds,
 
 #if GMX_SIMD_HAVE_REAL
 
-/* As pdihs_noner above, but using SIMD to calculate many dihedrals at once */
-void
-pdihs_noener_simd(int nbonds,
+/* As pdihs above, but using SIMD to calculate many dihedrals at once.
+ * Energies and shift forces are only computed with computeEnergyAndVirial,
+ * the energy is returned.
+ */
+template <bool computeEnergyAndVirial>
+static real
+pdihs_simd_kernel(int nbonds,
                   const t_iatom forceatoms[], const t_iparams forceparams[],
-                  const rvec x[], rvec4 f[],
-                  const t_pbc *pbc, const t_graph gmx_unused *g,
-                  real gmx_unused lambda,
-                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                  int gmx_unused *global_atom_index)
+                  const rvec x[], rvec4 f[], rvec fshift[],
+                  const t_pbc *pbc, const t_graph *g)
 {
     const int             nfa1 = 5;
     int                   i, iu, s;
@@ -1862,6 +2087,8 @@ pdihs_noener_simd(int nbonds,
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    al[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)  buf[3*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) fbuf[3*DIM*GMX_SIMD_REAL_WIDTH];
+    const int            *shift_atoms[3] = { ai, ak, al };
     real                 *cp, *phi0, *mult;
     SimdReal              deg2rad_S(DEG2RAD);
     SimdReal              p_S, q_S;
@@ -1873,6 +2100,8 @@ pdihs_noener_simd(int nbonds,
     SimdReal              sin_S, cos_S;
     SimdReal              mddphi_S;
     SimdReal              sf_i_S, msf_l_S;
+    SimdReal              one_S(1.0);
+    SimdReal              vtot_S = setZero();
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
 
     /* Extract aligned pointer for parameters and variables */
@@ -1953,21 +2182,180 @@ pdihs_noener_simd(int nbonds,
                                  mx_S, my_S, mz_S,
                                  nx_S, ny_S, nz_S,
                                  f);
+
+        if (computeEnergyAndVirial)
+        {
+            vtot_S = fma(cp_S, one_S + cos_S, vtot_S);
+
+            store_dih_forces_simd(p_S, q_S,
+                                  mx_S, my_S, mz_S,
+                                  nx_S, ny_S, nz_S,
+                                  fbuf);
+            add_shift_forces_simd_batch(std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1),
+                                        3, shift_atoms, aj, fbuf,
+                                        x, pbc, g, fshift);
+        }
     }
+
+    return computeEnergyAndVirial ? reduce(vtot_S) : 0;
+}
+
+/* As pdihs_noner above, but using SIMD to calculate many dihedrals at once */
+void
+pdihs_noener_simd(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec4 f[],
+                  const t_pbc *pbc, const t_graph *g,
+                  real gmx_unused lambda,
+                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                  int gmx_unused *global_atom_index)
+{
+    pdihs_simd_kernel<false>(nbonds, forceatoms, forceparams,
+                             x, f, nullptr, pbc, g);
 }
 
-/* This is mostly a copy of pdihs_noener_simd above, but with using
+/* As idihs above, but using SIMD to calculate many dihedrals at once.
+ * This follows pdihs_simd_kernel, but with a harmonic potential.
+ * Energies and shift forces are only computed with computeEnergyAndVirial,
+ * the energy is returned.
+ */
+template <bool computeEnergyAndVirial>
+static real
+idihs_simd_kernel(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec4 f[], rvec fshift[],
+                  const t_pbc *pbc, const t_graph *g)
+{
+    const int             nfa1 = 5;
+    int                   i, iu, s;
+    int                   type;
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ai[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    aj[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    al[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)  buf[2*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) fbuf[3*DIM*GMX_SIMD_REAL_WIDTH];
+    const int            *shift_atoms[3] = { ai, ak, al };
+    real                 *kk, *phi0;
+    SimdReal              deg2rad_S(DEG2RAD);
+    SimdReal              pi_S(M_PI);
+    SimdReal              two_pi_S(2*M_PI);
+    SimdReal              half_S(0.5);
+    SimdReal              p_S, q_S;
+    SimdReal              phi0_S, phi_S;
+    SimdReal              mx_S, my_S, mz_S;
+    SimdReal              nx_S, ny_S, nz_S;
+    SimdReal              nrkj_m2_S, nrkj_n2_S;
+    SimdReal              kk_S, dp_S;
+    SimdReal              mddphi_S;
+    SimdReal              sf_i_S, msf_l_S;
+    SimdReal              vtot_S = setZero();
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
+
+    /* Extract aligned pointer for parameters and variables */
+    kk    = buf + 0*GMX_SIMD_REAL_WIDTH;
+    phi0  = buf + 1*GMX_SIMD_REAL_WIDTH;
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms quadruplets for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            al[s] = forceatoms[iu+4];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s*nfa1 < nbonds)
+            {
+                kk[s]   = forceparams[type].harmonic.krA;
+                phi0[s] = forceparams[type].harmonic.rA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                kk[s]   = 0;
+                phi0[s] = 0;
+            }
+        }
+
+        /* Caclulate GMX_SIMD_REAL_WIDTH dihedral angles at once */
+        dih_angle_simd(x, ai, aj, ak, al, pbc_simd,
+                       &phi_S,
+                       &mx_S, &my_S, &mz_S,
+                       &nx_S, &ny_S, &nz_S,
+                       &nrkj_m2_S,
+                       &nrkj_n2_S,
+                       &p_S, &q_S);
+
+        kk_S     = load(kk);
+        phi0_S   = load(phi0) * deg2rad_S;
+
+        /* As in idihs(), take phi-phi0 modulo (-Pi,Pi) */
+        dp_S     = phi_S - phi0_S;
+        dp_S     = dp_S - selectByMask(two_pi_S, pi_S <= dp_S);
+        dp_S     = dp_S + selectByMask(two_pi_S, dp_S < -pi_S);
+
+        mddphi_S = -kk_S * dp_S;
+        sf_i_S   = mddphi_S * nrkj_m2_S;
+        msf_l_S  = mddphi_S * nrkj_n2_S;
+
+        /* After this m?_S will contain f[i] */
+        mx_S     = sf_i_S * mx_S;
+        my_S     = sf_i_S * my_S;
+        mz_S     = sf_i_S * mz_S;
+
+        /* After this m?_S will contain -f[l] */
+        nx_S     = msf_l_S * nx_S;
+        ny_S     = msf_l_S * ny_S;
+        nz_S     = msf_l_S * nz_S;
+
+        do_dih_fup_noshiftf_simd(ai, aj, ak, al,
+                                 p_S, q_S,
+                                 mx_S, my_S, mz_S,
+                                 nx_S, ny_S, nz_S,
+                                 f);
+
+        if (computeEnergyAndVirial)
+        {
+            vtot_S = fma(half_S * kk_S, dp_S * dp_S, vtot_S);
+
+            store_dih_forces_simd(p_S, q_S,
+                                  mx_S, my_S, mz_S,
+                                  nx_S, ny_S, nz_S,
+                                  fbuf);
+            add_shift_forces_simd_batch(std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1),
+                                        3, shift_atoms, aj, fbuf,
+                                        x, pbc, g, fshift);
+        }
+    }
+
+    return computeEnergyAndVirial ? reduce(vtot_S) : 0;
+}
+
+/* This is mostly a copy of pdihs_simd_kernel above, but with using
  * the RB potential instead of a harmonic potential.
- * This function can replace rbdihs() when no energy and virial are needed.
+ * Energies and shift forces are only computed with computeEnergyAndVirial,
+ * the energy is returned.
  */
-void
-rbdihs_noener_simd(int nbonds,
+template <bool computeEnergyAndVirial>
+static real
+rbdihs_simd_kernel(int nbonds,
                    const t_iatom forceatoms[], const t_iparams forceparams[],
-                   const rvec x[], rvec4 f[],
-                   const t_pbc *pbc, const t_graph gmx_unused *g,
-                   real gmx_unused lambda,
-                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                   int gmx_unused *global_atom_index)
+                   const rvec x[], rvec4 f[], rvec fshift[],
+                   const t_pbc *pbc, const t_graph *g)
 {
     const int             nfa1 = 5;
     int                   i, iu, s, j;
@@ -1977,6 +2365,8 @@ rbdihs_noener_simd(int nbonds,
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    al[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) parm[NR_RBDIHS*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) fbuf[3*DIM*GMX_SIMD_REAL_WIDTH];
+    const int            *shift_atoms[3] = { ai, ak, al };
 
     SimdReal              p_S, q_S;
     SimdReal              phi_S;
@@ -1991,6 +2381,8 @@ rbdihs_noener_simd(int nbonds,
 
     SimdReal              pi_S(M_PI);
     SimdReal              one_S(1.0);
+    SimdReal              v_S;
+    SimdReal              vtot_S = setZero();
 
     set_pbc_simd(pbc, pbc_simd);
 
@@ -2012,10 +2404,10 @@ rbdihs_noener_simd(int nbonds,
             /* At the end fill the arrays with the last atoms and 0 params */
             if (i + s*nfa1 < nbonds)
             {
-                /* We don't need the first parameter, since that's a constant
-                 * which only affects the energies, not the forces.
+                /* The first parameter is a constant which only affects
+                 * the energies, not the forces.
                  */
-                for (j = 1; j < NR_RBDIHS; j++)
+                for (j = 0; j < NR_RBDIHS; j++)
                 {
                     parm[j*GMX_SIMD_REAL_WIDTH + s] =
                         forceparams[type].rbdihs.rbcA[j];
@@ -2028,7 +2420,7 @@ rbdihs_noener_simd(int nbonds,
             }
             else
             {
-                for (j = 1; j < NR_RBDIHS; j++)
+                for (j = 0; j < NR_RBDIHS; j++)
                 {
                     parm[j*GMX_SIMD_REAL_WIDTH + s] = 0;
                 }
@@ -2052,12 +2444,17 @@ rbdihs_noener_simd(int nbonds,
         ddphi_S   = setZero();
         c_S       = one_S;
         cosfac_S  = one_S;
+        v_S       = load(parm);
         for (j = 1; j < NR_RBDIHS; j++)
         {
             parm_S   = load(parm + j*GMX_SIMD_REAL_WIDTH);
             ddphi_S  = fma(c_S * parm_S, cosfac_S, ddphi_S);
             cosfac_S = cosfac_S * cos_S;
             c_S      = c_S + one_S;
+            if (computeEnergyAndVirial)
+            {
+                v_S  = fma(parm_S, cosfac_S, v_S);
+            }
         }
 
         /* Note that here we do not use the minus sign which is present
@@ -2083,11 +2480,238 @@ rbdihs_noener_simd(int nbonds,
                                  mx_S, my_S, mz_S,
                                  nx_S, ny_S, nz_S,
                                  f);
+
+        if (computeEnergyAndVirial)
+        {
+            vtot_S = vtot_S + v_S;
+
+            store_dih_forces_simd(p_S, q_S,
+                                  mx_S, my_S, mz_S,
+                                  nx_S, ny_S, nz_S,
+                                  fbuf);
+            add_shift_forces_simd_batch(std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1),
+                                        3, shift_atoms, aj, fbuf,
+                                        x, pbc, g, fshift);
+        }
     }
+
+    return computeEnergyAndVirial ? reduce(vtot_S) : 0;
+}
+
+/* This function can replace rbdihs() when no energy and virial are needed */
+void
+rbdihs_noener_simd(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec4 f[],
+                   const t_pbc *pbc, const t_graph *g,
+                   real gmx_unused lambda,
+                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                   int gmx_unused *global_atom_index)
+{
+    rbdihs_simd_kernel<false>(nbonds, forceatoms, forceparams,
+                              x, f, nullptr, pbc, g);
 }
 
 #endif // GMX_SIMD_HAVE_REAL
 
+gmx_bool bonded_ftype_has_simd_kernel(int ftype)
+{
+#if GMX_SIMD_HAVE_REAL
+    switch (ftype)
+    {
+        case F_BONDS:
+        case F_HARMONIC:
+        case F_ANGLES:
+        case F_PDIHS:
+        case F_PIDIHS:
+        case F_RBDIHS:
+        case F_FOURDIHS:
+        case F_IDIHS:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+#else
+    GMX_UNUSED_VALUE(ftype);
+
+    return FALSE;
+#endif
+}
+
+#if GMX_SIMD_HAVE_REAL
+
+real bonded_simd(int ftype, gmx_bool bCalcEnerVir,
+                 int nbonds,
+                 const t_iatom forceatoms[], const t_iparams forceparams[],
+                 const rvec x[], rvec4 f[], rvec fshift[],
+                 const t_pbc *pbc, const t_graph *g)
+{
+    real v = 0;
+
+    switch (ftype)
+    {
+        case F_BONDS:
+        case F_HARMONIC:
+            v = (bCalcEnerVir ?
+                 bonds_simd_kernel<true>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g) :
+                 bonds_simd_kernel<false>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g));
+            break;
+        case F_ANGLES:
+            v = (bCalcEnerVir ?
+                 angles_simd_kernel<true>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g) :
+                 angles_simd_kernel<false>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g));
+            break;
+        case F_PDIHS:
+        case F_PIDIHS:
+            v = (bCalcEnerVir ?
+                 pdihs_simd_kernel<true>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g) :
+                 pdihs_simd_kernel<false>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g));
+            break;
+        case F_RBDIHS:
+        case F_FOURDIHS:
+            v = (bCalcEnerVir ?
+                 rbdihs_simd_kernel<true>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g) :
+                 rbdihs_simd_kernel<false>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g));
+            break;
+        case F_IDIHS:
+            v = (bCalcEnerVir ?
+                 idihs_simd_kernel<true>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g) :
+                 idihs_simd_kernel<false>(nbonds, forceatoms, forceparams, x, f, fshift, pbc, g));
+            break;
+        default:
+            gmx_incons("bonded_simd called for an interaction type without SIMD kernel");
+    }
+
+    return v;
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
+gmx_bool bonded_ftype_has_lambda_multi(int ftype)
+{
+    switch (ftype)
+    {
+        case F_BONDS:
+        case F_HARMONIC:
+        case F_ANGLES:
+        case F_PDIHS:
+        case F_PIDIHS:
+        case F_RBDIHS:
+        case F_FOURDIHS:
+        case F_IDIHS:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+void bonded_lambda_multi(int ftype, int nbonds,
+                         const t_iatom forceatoms[], const t_iparams forceparams[],
+                         const rvec x[], const t_pbc *pbc,
+                         int nlambda, const real lambda[], double energy[])
+{
+    int  nat1 = interaction_function[ftype].nratoms + 1;
+    int  t1, t2, t3;
+    rvec r_ij, r_kj, r_kl, m, n;
+    real geom, costh, sign, v, vA, vB, ddphi, dp;
+
+    for (int i = 0; i < nbonds; i += nat1)
+    {
+        const t_iatom   *ia = forceatoms + i;
+        const t_iparams &ip = forceparams[ia[0]];
+
+        /* Compute the geometry once, only the potential depends on lambda */
+        switch (ftype)
+        {
+            case F_BONDS:
+            case F_HARMONIC:
+                pbc_rvec_sub(pbc, x[ia[1]], x[ia[2]], r_ij);
+                geom = norm(r_ij);
+                if (geom == 0)
+                {
+                    /* As in bonds(), pairs at zero distance are skipped */
+                    continue;
+                }
+                break;
+            case F_ANGLES:
+                geom = bond_angle(x[ia[1]], x[ia[2]], x[ia[3]], pbc,
+                                  r_ij, r_kj, &costh, &t1, &t2);
+                break;
+            default:
+                geom = dih_angle(x[ia[1]], x[ia[2]], x[ia[3]], x[ia[4]], pbc,
+                                 r_ij, r_kj, r_kl, m, n, &sign, &t1, &t2, &t3);
+                break;
+        }
+
+        switch (ftype)
+        {
+            case F_BONDS:
+            case F_HARMONIC:
+                for (int l = 0; l < nlambda; l++)
+                {
+                    harmonic(ip.harmonic.krA, ip.harmonic.krB,
+                             ip.harmonic.rA, ip.harmonic.rB,
+                             geom, lambda[l], &v, &ddphi);
+                    energy[l] += v;
+                }
+                break;
+            case F_ANGLES:
+                for (int l = 0; l < nlambda; l++)
+                {
+                    harmonic(ip.harmonic.krA, ip.harmonic.krB,
+                             ip.harmonic.rA*DEG2RAD, ip.harmonic.rB*DEG2RAD,
+                             geom, lambda[l], &v, &ddphi);
+                    energy[l] += v;
+                }
+                break;
+            case F_PDIHS:
+            case F_PIDIHS:
+                for (int l = 0; l < nlambda; l++)
+                {
+                    dopdihs(ip.pdihs.cpA, ip.pdihs.cpB, ip.pdihs.phiA, ip.pdihs.phiB,
+                            ip.pdihs.mult, geom, lambda[l], &v, &ddphi);
+                    energy[l] += v;
+                }
+                break;
+            case F_IDIHS:
+                for (int l = 0; l < nlambda; l++)
+                {
+                    real L1 = 1.0 - lambda[l];
+
+                    dp = geom - (L1*ip.harmonic.rA + lambda[l]*ip.harmonic.rB)*DEG2RAD;
+                    make_dp_periodic(&dp);
+                    energy[l] += 0.5*(L1*ip.harmonic.krA + lambda[l]*ip.harmonic.krB)*dp*dp;
+                }
+                break;
+            case F_RBDIHS:
+            case F_FOURDIHS:
+            {
+                /* The potential is linear in the parameters, so we only
+                 * need the A- and B-state energies. Use the polymer convention.
+                 */
+                real cos_phi = std::cos(geom < 0 ? geom + M_PI : geom - M_PI);
+                real cosfac  = 1;
+
+                vA = 0;
+                vB = 0;
+                for (int j = 0; j < NR_RBDIHS; j++)
+                {
+                    vA     += ip.rbdihs.rbcA[j]*cosfac;
+                    vB     += ip.rbdihs.rbcB[j]*cosfac;
+                    cosfac *= cos_phi;
+                }
+                for (int l = 0; l < nlambda; l++)
+                {
+                    energy[l] += (1.0 - lambda[l])*vA + lambda[l]*vB;
+                }
+                break;
+            }
+            default:
+                gmx_incons("bonded_lambda_multi called for an unsupported interaction type");
+        }
+    }
+}
+
 
 real idihs(int nbonds,
            const t_iatom forceatoms[], const t_iparams forceparams[],
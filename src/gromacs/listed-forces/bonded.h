@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -136,7 +136,7 @@ void
                        const t_iatom forceatoms[], const t_iparams forceparams[],
                        const rvec x[], rvec4 f[],
                        const struct t_pbc *pbc,
-                       const struct t_graph gmx_unused *g,
+                       const struct t_graph *g,
                        real gmx_unused lambda,
                        const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
                        int gmx_unused *global_atom_index);
@@ -147,7 +147,7 @@ void
                       const t_iatom forceatoms[], const t_iparams forceparams[],
                       const rvec x[], rvec4 f[],
                       const struct t_pbc *pbc,
-                      const struct t_graph gmx_unused *g,
+                      const struct t_graph *g,
                       real gmx_unused lambda,
                       const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
                       int gmx_unused *global_atom_index);
@@ -158,11 +158,47 @@ void
                        const t_iatom forceatoms[], const t_iparams forceparams[],
                        const rvec x[], rvec4 f[],
                        const struct t_pbc *pbc,
-                       const struct t_graph gmx_unused *g,
+                       const struct t_graph *g,
                        real gmx_unused lambda,
                        const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
                        int gmx_unused *global_atom_index);
 
+/* Returns whether interactions of type ftype can be computed with
+ * bonded_simd(). Always returns FALSE without SIMD support.
+ */
+gmx_bool bonded_ftype_has_simd_kernel(int ftype);
+
+/* Computes the forces of interactions of type ftype using SIMD,
+ * GMX_SIMD_REAL_WIDTH interactions at once. With bCalcEnerVir
+ * the shift forces are also computed and the energy is returned,
+ * otherwise 0 is returned. Only the A-state parameters are used,
+ * so this should only be called without free-energy perturbation
+ * and for types for which bonded_ftype_has_simd_kernel() is TRUE.
+ */
+real
+    bonded_simd(int ftype, gmx_bool bCalcEnerVir,
+                int nbonds,
+                const t_iatom forceatoms[], const t_iparams forceparams[],
+                const rvec x[], rvec4 f[], rvec fshift[],
+                const struct t_pbc *pbc, const struct t_graph *g);
+
+/* Returns whether the energies of interactions of type ftype can be
+ * computed at many lambda values at once with bonded_lambda_multi().
+ */
+gmx_bool bonded_ftype_has_lambda_multi(int ftype);
+
+/* Adds the energies of the interactions of type ftype at the nlambda
+ * lambda values in lambda[] to energy[]. The geometry of each interaction
+ * is computed only once, only the potential is evaluated per lambda value.
+ * No forces are computed. Should only be called for types for which
+ * bonded_ftype_has_lambda_multi() is TRUE.
+ */
+void
+    bonded_lambda_multi(int ftype, int nbonds,
+                        const t_iatom forceatoms[], const t_iparams forceparams[],
+                        const rvec x[], const struct t_pbc *pbc,
+                        int nlambda, const real lambda[], double energy[]);
+
 //! \endcond
 
 #ifdef __cplusplus
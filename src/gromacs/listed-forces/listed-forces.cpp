@@ -48,6 +48,7 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/gmxlib/nrnb.h"
@@ -312,55 +313,27 @@ calc_one_bond(int thread,
                           md, fcd, global_atom_index);
         }
 #if GMX_SIMD_HAVE_REAL
-        else if (ftype == F_ANGLES && bUseSIMD &&
-                 !bCalcEnerVir && fr->efep == efepNO)
+        else if (bUseSIMD && fr->efep == efepNO &&
+                 bonded_ftype_has_simd_kernel(ftype))
         {
-            /* No energies, shift forces, dvdl */
-            angles_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                               idef->iparams,
-                               x, f,
-                               pbc, g, lambda[efptFTYPE], md, fcd,
-                               global_atom_index);
-            v = 0;
+            /* No dvdl, since the parameters are not perturbed */
+            v = bonded_simd(ftype, bCalcEnerVir,
+                            nbn, iatoms+nb0, idef->iparams,
+                            x, f, fshift,
+                            pbc, g);
         }
 #endif
         else if (ftype == F_PDIHS &&
                  !bCalcEnerVir && fr->efep == efepNO)
         {
             /* No energies, shift forces, dvdl */
-#if GMX_SIMD_HAVE_REAL
-            if (bUseSIMD)
-            {
-                pdihs_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                                  idef->iparams,
-                                  x, f,
-                                  pbc, g, lambda[efptFTYPE], md, fcd,
-                                  global_atom_index);
-            }
-            else
-#endif
-            {
-                pdihs_noener(nbn, idef->il[ftype].iatoms+nb0,
-                             idef->iparams,
-                             x, f,
-                             pbc, g, lambda[efptFTYPE], md, fcd,
-                             global_atom_index);
-            }
+            pdihs_noener(nbn, idef->il[ftype].iatoms+nb0,
+                         idef->iparams,
+                         x, f,
+                         pbc, g, lambda[efptFTYPE], md, fcd,
+                         global_atom_index);
             v = 0;
         }
-#if GMX_SIMD_HAVE_REAL
-        else if (ftype == F_RBDIHS && bUseSIMD &&
-                 !bCalcEnerVir && fr->efep == efepNO)
-        {
-            /* No energies, shift forces, dvdl */
-            rbdihs_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                               idef->iparams,
-                               (const rvec*)x, f,
-                               pbc, g, lambda[efptFTYPE], md, fcd,
-                               global_atom_index);
-            v = 0;
-        }
-#endif
         else
         {
             v = interaction_function[ftype].ifunc(nbn, iatoms+nb0,
@@ -572,14 +545,17 @@ void calc_listed_lambda(const t_idef *idef,
                         const rvec x[],
                         t_forcerec *fr,
                         const struct t_pbc *pbc, const struct t_graph *g,
-                        gmx_grppairener_t *grpp, real *epot, t_nrnb *nrnb,
-                        real *lambda,
+                        gmx_enerdata_t *enerd, t_nrnb *nrnb,
+                        int nlambda, const real *lambda_multi,
                         const t_mdatoms *md,
                         t_fcdata *fcd,
                         int *global_atom_index)
 {
     int           ftype, nr_nonperturbed, nr;
+    int           nftype_fe;
+    int           ftype_fe[F_NRE];
     real          v;
+    real          lambda[efptNR];
     real          dvdl_dum[efptNR] = {0};
     rvec4        *f;
     rvec         *fshift;
@@ -600,11 +576,19 @@ void calc_listed_lambda(const t_idef *idef,
     idef_fe.nthreads = 1;
     snew(idef_fe.il_thread_division, F_NRE*(idef_fe.nthreads+1));
 
-    /* We already have the forces, so we use temp buffers here */
+    /* We already have the forces, so we use temp buffers here.
+     * These are shared by all lambda points, the forces are not used.
+     */
     snew(f, fr->natoms_force);
     snew(fshift, SHIFTS);
 
-    /* Loop over all bonded force types to calculate the bonded energies */
+    /* Types supported by bonded_lambda_multi() are computed at all lambda
+     * points in a single pass over their perturbed interactions. For the
+     * other types, we set up the work range only once for all lambda points.
+     */
+    std::vector<double> energy(nlambda, 0.0);
+    std::vector<real>   lambda_ftype(nlambda);
+    nftype_fe = 0;
     for (ftype = 0; (ftype < F_NRE); ftype++)
     {
         if (ftype_is_bonded_potential(ftype))
@@ -618,16 +602,56 @@ void calc_listed_lambda(const t_idef *idef,
             /* This is only to get the flop count correct */
             idef_fe.il[ftype].nr = nr - nr_nonperturbed;
 
-            if (nr - nr_nonperturbed > 0)
+            if (nr - nr_nonperturbed > 0 && bonded_ftype_has_lambda_multi(ftype))
             {
-                v = calc_one_bond(0, ftype, &idef_fe,
+                int efptFTYPE = (IS_RESTRAINT_TYPE(ftype) ? efptRESTRAINT : efptBONDED);
+
+                for (int i = 0; i < nlambda; i++)
+                {
+                    lambda_ftype[i] = lambda_multi[i*efptNR + efptFTYPE];
+                }
+                bonded_lambda_multi(ftype, nr - nr_nonperturbed,
+                                    idef->il[ftype].iatoms + nr_nonperturbed,
+                                    idef->iparams, x, pbc_null,
+                                    nlambda, lambda_ftype.data(), energy.data());
+                inc_nrnb(nrnb, interaction_function[ftype].nrnb_ind,
+                         nlambda*idef_fe.il[ftype].nr/(interaction_function[ftype].nratoms + 1));
+            }
+            else if (nr - nr_nonperturbed > 0)
+            {
+                ftype_fe[nftype_fe++] = ftype;
+            }
+        }
+    }
+
+    for (int i = 0; i < nlambda; i++)
+    {
+        enerd->enerpart_lambda[i] += energy[i];
+    }
+
+    for (int i = 0; i < nlambda && nftype_fe > 0; i++)
+    {
+        for (int j = 0; j < efptNR; j++)
+        {
+            lambda[j] = lambda_multi[i*efptNR + j];
+        }
+
+        reset_foreign_enerdata(enerd);
+
+        /* Loop over the other perturbed bonded force types to calculate the bonded energies */
+        for (int t = 0; t < nftype_fe; t++)
+        {
+            ftype = ftype_fe[t];
+            v     = calc_one_bond(0, ftype, &idef_fe,
                                   x, f, fshift, fr, pbc_null, g,
-                                  grpp, nrnb, lambda, dvdl_dum,
+                                  &enerd->foreign_grpp, nrnb, lambda, dvdl_dum,
                                   md, fcd, TRUE,
                                   global_atom_index);
-                epot[ftype] += v;
-            }
+            enerd->foreign_term[ftype] += v;
         }
+
+        sum_epot(&(enerd->foreign_grpp), enerd->foreign_term);
+        enerd->enerpart_lambda[i] += enerd->foreign_term[F_EPOT];
     }
 
     sfree(fshift);
@@ -687,20 +711,17 @@ do_force_listed(struct gmx_wallcycle        *wcycle,
             {
                 gmx_incons("The bonded interactions are not sorted for free energy");
             }
+            std::vector<real> lambda_multi(enerd->n_lambda*efptNR);
             for (int i = 0; i < enerd->n_lambda; i++)
             {
-                real lam_i[efptNR];
-
-                reset_foreign_enerdata(enerd);
                 for (int j = 0; j < efptNR; j++)
                 {
-                    lam_i[j] = (i == 0 ? lambda[j] : fepvals->all_lambda[j][i-1]);
+                    lambda_multi[i*efptNR + j] = (i == 0 ? lambda[j] : fepvals->all_lambda[j][i-1]);
                 }
-                calc_listed_lambda(idef, x, fr, pbc, graph, &(enerd->foreign_grpp), enerd->foreign_term, nrnb, lam_i, md,
-                                   fcd, global_atom_index);
-                sum_epot(&(enerd->foreign_grpp), enerd->foreign_term);
-                enerd->enerpart_lambda[i] += enerd->foreign_term[F_EPOT];
             }
+            calc_listed_lambda(idef, x, fr, pbc, graph, enerd, nrnb,
+                               enerd->n_lambda, lambda_multi.data(), md,
+                               fcd, global_atom_index);
             wallcycle_sub_stop(wcycle, ewcsLISTED_FEP);
         }
     }
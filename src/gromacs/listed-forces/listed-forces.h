@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -112,15 +112,20 @@ void calc_listed(const t_commrec *cr,
                  int force_flags);
 
 /*! \brief As calc_listed(), but only determines the potential energy
- * for the perturbed interactions.
+ * for the perturbed interactions, at all \p nlambda lambda points.
  *
+ * \p lambda_multi contains efptNR lambda values for each point.
+ * The energy at point i is added to enerd->enerpart_lambda[i].
+ * Types supported by bonded_lambda_multi() are evaluated at all points
+ * in one pass, for the other types enerd->foreign_grpp and
+ * enerd->foreign_term are used as work buffers.
  * The shift forces in fr are not affected. */
 void calc_listed_lambda(const t_idef *idef,
                         const rvec x[],
                         t_forcerec *fr,
                         const struct t_pbc *pbc, const struct t_graph *g,
-                        gmx_grppairener_t *grpp, real *epot, t_nrnb *nrnb,
-                        real *lambda,
+                        gmx_enerdata_t *enerd, t_nrnb *nrnb,
+                        int nlambda, const real *lambda_multi,
                         const t_mdatoms *md,
                         struct t_fcdata *fcd, int *global_atom_index);
 
@@ -53,9 +53,11 @@
 
 #include <algorithm>
 
+#include "gromacs/listed-forces/bonded.h"
 #include "gromacs/listed-forces/listed-forces.h"
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/pbcutil/ishift.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/topology/ifunc.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
@@ -187,6 +189,43 @@ static void divide_bondeds_by_locality(int                 ntype,
     }
 }
 
+/*! \brief Aligns the thread division of ftype to SIMD batches
+ *
+ * The SIMD bonded kernels compute GMX_SIMD_REAL_WIDTH interactions
+ * at once and fill up the last, partial batch of each thread with
+ * dummy interactions. We move the internal thread boundaries to the
+ * nearest multiple of the SIMD width, so only the last thread can
+ * have a partial batch. This shifts at most half a batch between
+ * neighboring threads, which has negligible effect on the balance.
+ */
+static void align_division_to_simd_batches(int     ftype,
+                                           int     nthread,
+                                           t_idef *idef)
+{
+#if GMX_SIMD_HAVE_REAL
+    if (!bonded_ftype_has_simd_kernel(ftype))
+    {
+        return;
+    }
+
+    /* nat1 = 1 + #atoms(ftype) which is the stride use for iatoms */
+    int  nat1     = 1 + NRAL(ftype);
+    int *division = idef->il_thread_division + ftype*(nthread + 1);
+
+    for (int t = 1; t < nthread; t++)
+    {
+        int nbatch = (division[t]/nat1 + GMX_SIMD_REAL_WIDTH/2)/GMX_SIMD_REAL_WIDTH;
+
+        division[t] = std::min(nbatch*GMX_SIMD_REAL_WIDTH*nat1,
+                               idef->il[ftype].nr);
+    }
+#else
+    GMX_UNUSED_VALUE(ftype);
+    GMX_UNUSED_VALUE(nthread);
+    GMX_UNUSED_VALUE(idef);
+#endif
+}
+
 //! Divides bonded interactions over threads
 static void divide_bondeds_over_threads(t_idef *idef,
                                         int     nthread,
@@ -285,6 +324,14 @@ static void divide_bondeds_over_threads(t_idef *idef,
         divide_bondeds_by_locality(ntype, ild, nthread, idef);
     }
 
+    for (f = 0; f < F_NRE; f++)
+    {
+        if (ftype_is_bonded_potential(f) && idef->il[f].nr > 0)
+        {
+            align_division_to_simd_batches(f, nthread, idef);
+        }
+    }
+
     if (debug)
     {
         int f;
@@ -45,13 +45,16 @@
 
 #include <cmath>
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "gromacs/math/units.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
 
 #include "testutils/refdata.h"
 #include "testutils/testasserts.h"
@@ -157,6 +160,111 @@ class BondedTest : public ::testing::Test
 
 };
 
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Compares the SIMD bonded kernels with the plain-C kernels
+ *
+ * Uses the same coordinates and box as BondedTest, but no reference data.
+ */
+class BondedSimdTest : public ::testing::Test
+{
+    protected:
+        rvec   x[NATOMS];
+        matrix box;
+        BondedSimdTest( )
+        {
+            clear_rvecs(NATOMS, x);
+            x[1][2] = 1;
+            x[2][1] = x[2][2] = 1;
+            x[3][0] = x[3][1] = x[3][2] = 1;
+
+            clear_mat(box);
+            box[0][0] = box[1][1] = box[2][2] = 1.5;
+        }
+
+        /*! \brief Checks that bonded_simd() agrees with the plain-C kernel
+         *
+         * The interactions are repeated to fill more than one SIMD batch.
+         */
+        void testSimdKernel(int                         ftype,
+                            const std::vector<t_iatom> &iatoms,
+                            const t_iparams             iparams[],
+                            int                         epbc)
+        {
+            std::vector<t_iatom> iatomsRepeated;
+            for (int r = 0; r < GMX_SIMD_REAL_WIDTH + 1; r++)
+            {
+                iatomsRepeated.insert(iatomsRepeated.end(), iatoms.begin(), iatoms.end());
+            }
+
+            t_pbc pbc;
+            set_pbc(&pbc, epbc, box);
+
+            real  lambda = 0;
+            real  dvdlambda;
+            int   ddgatindex = 0;
+            rvec4 fRef[NATOMS], fSimd[NATOMS], fSimdNoEner[NATOMS];
+            rvec  fshiftRef[N_IVEC], fshiftSimd[N_IVEC];
+            for (int i = 0; i < NATOMS; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    fRef[i][j] = fSimd[i][j] = fSimdNoEner[i][j] = 0;
+                }
+            }
+            clear_rvecs(N_IVEC, fshiftRef);
+            clear_rvecs(N_IVEC, fshiftSimd);
+
+            real energyRef  = interaction_function[ftype].ifunc(iatomsRepeated.size(),
+                                                                iatomsRepeated.data(),
+                                                                iparams,
+                                                                x, fRef, fshiftRef,
+                                                                &pbc, nullptr,
+                                                                lambda, &dvdlambda,
+                                                                nullptr, nullptr,
+                                                                &ddgatindex);
+            real energySimd = bonded_simd(ftype, TRUE,
+                                          iatomsRepeated.size(), iatomsRepeated.data(),
+                                          iparams,
+                                          x, fSimd, fshiftSimd,
+                                          &pbc, nullptr);
+            bonded_simd(ftype, FALSE,
+                        iatomsRepeated.size(), iatomsRepeated.data(),
+                        iparams,
+                        x, fSimdNoEner, nullptr,
+                        &pbc, nullptr);
+
+            real magnitude = std::abs(energyRef);
+            for (int i = 0; i < NATOMS; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    magnitude = std::max(magnitude, std::abs(fRef[i][d]));
+                }
+            }
+            test::FloatingPointTolerance tolerance(test::relativeToleranceAsFloatingPoint(magnitude, 1e-5));
+
+            EXPECT_REAL_EQ_TOL(energyRef, energySimd, tolerance);
+            for (int i = 0; i < NATOMS; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(fRef[i][d], fSimd[i][d], tolerance);
+                    EXPECT_REAL_EQ_TOL(fRef[i][d], fSimdNoEner[i][d], tolerance);
+                }
+            }
+            for (int s = 0; s < N_IVEC; s++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(fshiftRef[s][d], fshiftSimd[s][d], tolerance);
+                }
+            }
+        }
+};
+
+#endif
+
 TEST_F (BondedTest, BondAnglePbcNone)
 {
     testBondAngle(epbcNONE);
@@ -274,6 +382,200 @@ TEST_F (BondedTest, IfuncProperDihedralsPbcXyz)
     testIfunc(F_PDIHS, iatoms, &iparams, epbcXYZ);
 }
 
+#if GMX_SIMD_HAVE_REAL
+TEST_F (BondedSimdTest, SimdBondsPbcNo)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 0, 1, 2, 0, 2, 3, 0, 0, 3 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = iparams.harmonic.rB  = 0.8;
+    iparams.harmonic.krA = iparams.harmonic.krB = 50;
+    testSimdKernel(F_BONDS, iatoms, &iparams, epbcNONE);
+}
+
+TEST_F (BondedSimdTest, SimdBondsPbcXyz)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 0, 1, 2, 0, 2, 3, 0, 0, 3 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = iparams.harmonic.rB  = 0.8;
+    iparams.harmonic.krA = iparams.harmonic.krB = 50;
+    testSimdKernel(F_BONDS, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, SimdAnglesPbcXyz)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 0, 1, 2, 3, 0, 0, 3, 2 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = iparams.harmonic.rB  = 100;
+    iparams.harmonic.krA = iparams.harmonic.krB = 50;
+    testSimdKernel(F_ANGLES, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, SimdProperDihedralsPbcXyz)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3, 0, 3, 2, 1, 0 };
+    t_iparams            iparams;
+    iparams.pdihs.phiA = iparams.pdihs.phiB = -100;
+    iparams.pdihs.cpA  = iparams.pdihs.cpB  = 10;
+    iparams.pdihs.mult = 2;
+    testSimdKernel(F_PDIHS, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, SimdImproperDihedralsPbcXyz)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3, 0, 3, 2, 1, 0 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = iparams.harmonic.rB  = 170;
+    iparams.harmonic.krA = iparams.harmonic.krB = 40;
+    testSimdKernel(F_IDIHS, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, SimdRbDihedralsPbcXyz)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3, 0, 3, 2, 1, 0 };
+    t_iparams            iparams;
+    const real           rbc[NR_RBDIHS] = { 9.28, 12.16, -13.12, -3.06, 26.24, -31.5 };
+    for (int i = 0; i < NR_RBDIHS; i++)
+    {
+        iparams.rbdihs.rbcA[i] = iparams.rbdihs.rbcB[i] = rbc[i];
+    }
+    testSimdKernel(F_RBDIHS, iatoms, &iparams, epbcXYZ);
+}
+#endif
+
+/*! \brief Compares bonded_lambda_multi() with the plain-C kernels at each lambda value
+ *
+ * Uses the same coordinates and box as BondedTest, but no reference data.
+ * The dV/dlambda of the plain-C kernels is also checked against a finite
+ * difference of the multi-lambda energies.
+ */
+class BondedLambdaMultiTest : public ::testing::Test
+{
+    protected:
+        rvec   x[NATOMS];
+        matrix box;
+        BondedLambdaMultiTest( )
+        {
+            clear_rvecs(NATOMS, x);
+            x[1][2] = 1;
+            x[2][1] = x[2][2] = 1;
+            x[3][0] = x[3][1] = x[3][2] = 1;
+
+            clear_mat(box);
+            box[0][0] = box[1][1] = box[2][2] = 1.5;
+        }
+
+        //! Checks bonded_lambda_multi() for interactions with perturbed parameters
+        void testLambdaMulti(int                         ftype,
+                             const std::vector<t_iatom> &iatoms,
+                             const t_iparams             iparams[])
+        {
+            const real          lambda[]  = { 0, 0.2, 0.5, 0.7, 1, 0.49, 0.51 };
+            const int           nlambda   = sizeof(lambda)/sizeof(lambda[0]);
+            /* The last two points are used for the finite difference around 0.5 */
+            const real          dLambda   = 0.01;
+            std::vector<double> energyMulti(nlambda, 0.0);
+
+            t_pbc               pbc;
+            set_pbc(&pbc, epbcXYZ, box);
+
+            bonded_lambda_multi(ftype, iatoms.size(), iatoms.data(), iparams,
+                                x, &pbc, nlambda, lambda, energyMulti.data());
+
+            for (int l = 0; l < nlambda; l++)
+            {
+                rvec4 f[NATOMS];
+                rvec  fshift[N_IVEC];
+                real  dvdlambda  = 0;
+                int   ddgatindex = 0;
+                for (int i = 0; i < NATOMS; i++)
+                {
+                    for (int j = 0; j < 4; j++)
+                    {
+                        f[i][j] = 0;
+                    }
+                }
+                clear_rvecs(N_IVEC, fshift);
+
+                real energyRef = interaction_function[ftype].ifunc(iatoms.size(),
+                                                                   iatoms.data(),
+                                                                   iparams,
+                                                                   x, f, fshift,
+                                                                   &pbc, nullptr,
+                                                                   lambda[l], &dvdlambda,
+                                                                   nullptr, nullptr,
+                                                                   &ddgatindex);
+                test::FloatingPointTolerance tolerance(test::relativeToleranceAsFloatingPoint(energyRef, 1e-5));
+                EXPECT_REAL_EQ_TOL(energyRef, energyMulti[l], tolerance) << "lambda = " << lambda[l];
+
+                if (lambda[l] == 0.5)
+                {
+                    real dvdlambdaFD = (energyMulti[nlambda - 1] - energyMulti[nlambda - 2])/(2*dLambda);
+                    test::FloatingPointTolerance dvdlTolerance(test::relativeToleranceAsFloatingPoint(std::abs(energyRef) + std::abs(dvdlambda), 1e-3));
+                    EXPECT_REAL_EQ_TOL(dvdlambda, dvdlambdaFD, dvdlTolerance);
+                }
+            }
+        }
+};
+
+TEST_F (BondedLambdaMultiTest, Bonds)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 0, 1, 2, 0, 2, 3, 0, 0, 3 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = 0.8;
+    iparams.harmonic.rB  = 1.1;
+    iparams.harmonic.krA = 50;
+    iparams.harmonic.krB = 20;
+    testLambdaMulti(F_BONDS, iatoms, &iparams);
+}
+
+TEST_F (BondedLambdaMultiTest, Angles)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 0, 1, 2, 3, 0, 0, 3, 2 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = 100;
+    iparams.harmonic.rB  = 120;
+    iparams.harmonic.krA = 50;
+    iparams.harmonic.krB = 80;
+    testLambdaMulti(F_ANGLES, iatoms, &iparams);
+}
+
+TEST_F (BondedLambdaMultiTest, ProperDihedrals)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3, 0, 3, 2, 1, 0 };
+    t_iparams            iparams;
+    iparams.pdihs.phiA = -100;
+    iparams.pdihs.phiB = 30;
+    iparams.pdihs.cpA  = 10;
+    iparams.pdihs.cpB  = 4;
+    iparams.pdihs.mult = 2;
+    testLambdaMulti(F_PDIHS, iatoms, &iparams);
+}
+
+TEST_F (BondedLambdaMultiTest, ImproperDihedrals)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3, 0, 3, 2, 1, 0 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = 170;
+    iparams.harmonic.rB  = 120;
+    iparams.harmonic.krA = 40;
+    iparams.harmonic.krB = 10;
+    testLambdaMulti(F_IDIHS, iatoms, &iparams);
+}
+
+TEST_F (BondedLambdaMultiTest, RbDihedrals)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3, 0, 3, 2, 1, 0 };
+    t_iparams            iparams;
+    const real           rbcA[NR_RBDIHS] = { 9.28, 12.16, -13.12, -3.06, 26.24, -31.5 };
+    const real           rbcB[NR_RBDIHS] = { 2.1, -4.2, 6.3, 0.5, -1.0, 3.3 };
+    for (int i = 0; i < NR_RBDIHS; i++)
+    {
+        iparams.rbdihs.rbcA[i] = rbcA[i];
+        iparams.rbdihs.rbcB[i] = rbcB[i];
+    }
+    testLambdaMulti(F_RBDIHS, iatoms, &iparams);
+}
+
 }
 
 }
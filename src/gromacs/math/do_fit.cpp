@@ -38,9 +38,12 @@
 
 #include "do_fit.h"
 
+#include <cmath>
 #include <math.h>
 #include <stdio.h>
 
+#include <algorithm>
+
 #include "gromacs/linearalgebra/nrjac.h"
 #include "gromacs/math/functions.h"
 #include "gromacs/math/utilities.h"
@@ -291,6 +294,129 @@ void do_fit(int natoms, real *w_rls, const rvec *xp, rvec *x)
     do_fit_ndim(3, natoms, w_rls, xp, x);
 }
 
+real calc_fit_rmsd(int natoms, const real *w_rls, const rvec *xp, const rvec *x)
+{
+    double s[DIM][DIM], key[4][4], key2[4][4];
+    double wtot, e0, c0, c1, c2, lambda, lambdaOld, a, b, lambda2, msd;
+    int    n, c, r, k, iter;
+
+    /* The weighted correlation matrix s[c][r] = sum_n w_n xp_n[c] x_n[r] */
+    for (c = 0; c < DIM; c++)
+    {
+        for (r = 0; r < DIM; r++)
+        {
+            s[c][r] = 0;
+        }
+    }
+    wtot = 0;
+    e0   = 0;
+    for (n = 0; n < natoms; n++)
+    {
+        const real w = w_rls[n];
+
+        if (w != 0)
+        {
+            wtot += w;
+            e0   += w*(norm2(xp[n]) + norm2(x[n]));
+            for (c = 0; c < DIM; c++)
+            {
+                const real wxpc = w*xp[n][c];
+                for (r = 0; r < DIM; r++)
+                {
+                    s[c][r] += wxpc*x[n][r];
+                }
+            }
+        }
+    }
+    if (wtot == 0)
+    {
+        return 0;
+    }
+
+    /* The symmetric, traceless key matrix. Its largest eigenvalue is the
+     * maximum over all rotations R of sum_n w_n xp_n . R x_n.
+     */
+    key[0][0] =  s[XX][XX] + s[YY][YY] + s[ZZ][ZZ];
+    key[0][1] =  s[YY][ZZ] - s[ZZ][YY];
+    key[0][2] =  s[ZZ][XX] - s[XX][ZZ];
+    key[0][3] =  s[XX][YY] - s[YY][XX];
+    key[1][1] =  s[XX][XX] - s[YY][YY] - s[ZZ][ZZ];
+    key[1][2] =  s[XX][YY] + s[YY][XX];
+    key[1][3] =  s[ZZ][XX] + s[XX][ZZ];
+    key[2][2] = -s[XX][XX] + s[YY][YY] - s[ZZ][ZZ];
+    key[2][3] =  s[YY][ZZ] + s[ZZ][YY];
+    key[3][3] = -s[XX][XX] - s[YY][YY] + s[ZZ][ZZ];
+    for (r = 0; r < 4; r++)
+    {
+        for (c = 0; c < r; c++)
+        {
+            key[r][c] = key[c][r];
+        }
+    }
+
+    /* The characteristic polynomial is lambda^4 + c2 lambda^2 + c1 lambda + c0,
+     * with c2 = -tr(key^2)/2, c1 = -tr(key^3)/3 and c0 = det(key).
+     */
+    c1 = 0;
+    c2 = 0;
+    for (r = 0; r < 4; r++)
+    {
+        for (c = 0; c < 4; c++)
+        {
+            key2[r][c] = 0;
+            for (k = 0; k < 4; k++)
+            {
+                key2[r][c] += key[r][k]*key[k][c];
+            }
+            c1 += key2[r][c]*key[c][r];
+        }
+        c2 += key2[r][r];
+    }
+    c1 = -c1/3;
+    c2 = -c2/2;
+    c0 = 0;
+    for (c = 0; c < 4; c++)
+    {
+        /* Expand the determinant along the first row using 3x3 minors */
+        int    col[3], m = 0;
+        double minor;
+
+        for (k = 0; k < 4; k++)
+        {
+            if (k != c)
+            {
+                col[m++] = k;
+            }
+        }
+        minor = key[1][col[0]]*(key[2][col[1]]*key[3][col[2]] - key[2][col[2]]*key[3][col[1]])
+            - key[1][col[1]]*(key[2][col[0]]*key[3][col[2]] - key[2][col[2]]*key[3][col[0]])
+            + key[1][col[2]]*(key[2][col[0]]*key[3][col[1]] - key[2][col[1]]*key[3][col[0]]);
+        c0   += ((c % 2 == 0) ? 1 : -1)*key[0][c]*minor;
+    }
+
+    /* Newton iterations from the upper bound e0/2 converge to the largest
+     * root, see D.L. Theobald, Acta Cryst. A 61, 478 (2005).
+     */
+    lambda = 0.5*e0;
+    for (iter = 0; iter < 50; iter++)
+    {
+        lambdaOld = lambda;
+        lambda2   = lambda*lambda;
+        b         = (lambda2 + c2)*lambda;
+        a         = b + c1;
+        lambda   -= (a*lambda + c0)/(2*lambda2*lambda + b + a);
+        if (std::abs(lambda - lambdaOld) <= 1e-11*std::abs(lambda))
+        {
+            break;
+        }
+    }
+
+    /* Rounding can make the deviation of identical structures negative */
+    msd = std::max((e0 - 2*lambda)/wtot, 0.0);
+
+    return std::sqrt(msd);
+}
+
 void reset_x_ndim(int ndim, int ncm, const int *ind_cm,
                   int nreset, const int *ind_reset,
                   rvec x[], const real mass[])
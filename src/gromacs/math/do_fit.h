@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2010,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2010,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -86,6 +86,16 @@ void do_fit_ndim(int ndim, int natoms, real *w_rls, const rvec *xp, rvec *x);
 void do_fit(int natoms, real *w_rls, const rvec *xp, rvec *x);
 /* Calls do_fit with ndim=3, thus fitting in 3D */
 
+real calc_fit_rmsd(int natoms, const real *w_rls, const rvec *xp, const rvec *x);
+/* Returns the weighted RMS deviation between xp and x after the least
+ * squares fit of x to xp that do_fit would do, without changing x.
+ * The minimal deviation follows from the largest eigenvalue of the 4x4
+ * quaternion key matrix (B.K.P. Horn, J. Opt. Soc. Am. A 4, 629 (1987)),
+ * found with Newton iterations, so no rotation matrix, rotated coordinates
+ * or memory allocation are needed.
+ * Both xp and x should be centered round the origin.
+ */
+
 void reset_x_ndim(int ndim, int ncm, const int *ind_cm,
                   int nreset, const int *ind_reset,
                   rvec x[], const real mass[]);
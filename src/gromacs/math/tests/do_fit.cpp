@@ -0,0 +1,157 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the least squares fitting routines
+ *
+ * \ingroup module_math
+ */
+#include "gmxpre.h"
+
+#include "gromacs/math/do_fit.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+using gmx::test::absoluteTolerance;
+using gmx::test::relativeToleranceAsFloatingPoint;
+
+//! Number of atoms in the test structures.
+const int c_natoms = 20;
+
+/*! \brief
+ * Fills x and w with a centered structure with varying weights.
+ */
+void makeStructure(std::vector<gmx::RVec> *x, std::vector<real> *w)
+{
+    x->resize(c_natoms);
+    w->resize(c_natoms);
+    for (int i = 0; i < c_natoms; i++)
+    {
+        (*x)[i][XX] = std::sin(1.3*i);
+        (*x)[i][YY] = std::cos(0.7*i + 0.5);
+        (*x)[i][ZZ] = 0.1*i;
+        (*w)[i]     = 1 + (i % 3);
+    }
+    /* The weight of the last atom is zero, as for atoms not used in fits */
+    (*w)[c_natoms - 1] = 0;
+    reset_x(c_natoms, nullptr, c_natoms, nullptr, as_rvec_array(x->data()), w->data());
+}
+
+/*! \brief
+ * Returns x rotated around a tilted axis, with a deterministic
+ * perturbation of size noise added.
+ */
+std::vector<gmx::RVec> rotatedStructure(const std::vector<gmx::RVec> &x,
+                                        const std::vector<real> &w, real noise)
+{
+    matrix                 rot;
+    std::vector<gmx::RVec> xr(x.size());
+    const real             c = std::cos(0.8), s = std::sin(0.8);
+
+    /* Rotation around z followed by rotation around x */
+    rot[XX][XX] = c;
+    rot[XX][YY] = -s;
+    rot[XX][ZZ] = 0;
+    rot[YY][XX] = c*s;
+    rot[YY][YY] = c*c;
+    rot[YY][ZZ] = -s;
+    rot[ZZ][XX] = s*s;
+    rot[ZZ][YY] = s*c;
+    rot[ZZ][ZZ] = c;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        mvmul(rot, x[i], xr[i]);
+        xr[i][XX] += noise*std::sin(2.1*i);
+        xr[i][YY] += noise*std::cos(3.3*i);
+        xr[i][ZZ] += noise*std::sin(0.9*i + 1);
+    }
+    reset_x(xr.size(), nullptr, xr.size(), nullptr, as_rvec_array(xr.data()), w.data());
+
+    return xr;
+}
+
+TEST(CalcFitRmsdTest, IsZeroForIdenticalStructures)
+{
+    std::vector<gmx::RVec> x;
+    std::vector<real>      w;
+    makeStructure(&x, &w);
+
+    EXPECT_REAL_EQ_TOL(0, calc_fit_rmsd(c_natoms, w.data(), as_rvec_array(x.data()),
+                                        as_rvec_array(x.data())),
+                       absoluteTolerance(1e-3));
+}
+
+TEST(CalcFitRmsdTest, IsZeroForRotatedStructures)
+{
+    std::vector<gmx::RVec> x;
+    std::vector<real>      w;
+    makeStructure(&x, &w);
+    std::vector<gmx::RVec> xr = rotatedStructure(x, w, 0);
+
+    EXPECT_REAL_EQ_TOL(0, calc_fit_rmsd(c_natoms, w.data(), as_rvec_array(x.data()),
+                                        as_rvec_array(xr.data())),
+                       absoluteTolerance(1e-3));
+}
+
+TEST(CalcFitRmsdTest, MatchesRmsdAfterFit)
+{
+    std::vector<gmx::RVec> x;
+    std::vector<real>      w;
+    makeStructure(&x, &w);
+    std::vector<gmx::RVec> xr = rotatedStructure(x, w, 0.2);
+
+    real                   rmsd = calc_fit_rmsd(c_natoms, w.data(), as_rvec_array(x.data()),
+                                                as_rvec_array(xr.data()));
+
+    do_fit(c_natoms, w.data(), as_rvec_array(x.data()), as_rvec_array(xr.data()));
+    real expected = rmsdev(c_natoms, w.data(), as_rvec_array(x.data()),
+                           as_rvec_array(xr.data()));
+
+    EXPECT_GT(expected, 0.05);
+    EXPECT_REAL_EQ_TOL(expected, rmsd, relativeToleranceAsFloatingPoint(1, 1e-4));
+}
+
+} // namespace
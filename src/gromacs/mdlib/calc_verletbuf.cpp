@@ -922,11 +922,14 @@ void calc_verlet_buffer_size(const gmx_mtop_t *mtop, real boxvol,
     pot_derivatives_t ljRep  = { 0, 0, 0 };
     real              repPow = mtop->ffparams.reppow;
 
-    if (ir->vdwtype == evdwCUT)
+    if (ir->vdwtype == evdwCUT || ir->vdwtype == evdwUSER)
     {
         real sw_range, md3_pswf;
 
-        switch (ir->vdw_modifier)
+        /* We do not know the shape of user tables,
+         * so we estimate the buffer using plain LJ.
+         */
+        switch (ir->vdwtype == evdwUSER ? eintmodNONE : ir->vdw_modifier)
         {
             case eintmodNONE:
             case eintmodPOTSHIFT:
@@ -979,11 +982,13 @@ void calc_verlet_buffer_size(const gmx_mtop_t *mtop, real boxvol,
     // Determine the 1st and 2nd derivative for the electostatics
     pot_derivatives_t elec = { 0, 0, 0 };
 
-    if (ir->coulombtype == eelCUT || EEL_RF(ir->coulombtype))
+    if (ir->coulombtype == eelCUT || EEL_RF(ir->coulombtype) ||
+        ir->coulombtype == eelUSER)
     {
         real eps_rf, k_rf;
 
-        if (ir->coulombtype == eelCUT)
+        /* For user tables we estimate the buffer using plain Coulomb */
+        if (ir->coulombtype == eelCUT || ir->coulombtype == eelUSER)
         {
             eps_rf = 1;
             k_rf   = 0;
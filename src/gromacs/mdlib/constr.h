@@ -142,13 +142,16 @@ void csettle(gmx_settledata_t    settled,          /* The SETTLE structure */
  */
 
 void settle_proj(gmx_settledata_t settled, int econq,
-                 int nsettle, t_iatom iatoms[],
+                 int nthread, int thread,
                  const struct t_pbc *pbc,   /* PBC data pointer, can be NULL  */
-                 rvec x[],
-                 rvec *der, rvec *derp,
-                 int CalcVirAtomEnd, tensor vir_r_m_dder);
+                 const rvec x[],
+                 const rvec *der, rvec *derp,
+                 bool bCalcVirial, tensor vir_r_m_dder);
 /* Analytical algorithm to subtract the components of derivatives
  * of coordinates working on settle type constraint.
+ * Uses the settles set with settle_set_constraints, which are divided
+ * over nthread threads in the same way as in csettle.
+ * Can be called on any number of threads.
  */
 
 void cshake(const int iatom[], int ncon, int *nnit, int maxnit,
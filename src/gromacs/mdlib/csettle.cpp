@@ -300,115 +300,269 @@ void settle_set_constraints(gmx_settledata_t  settled,
     }
 }
 
-void settle_proj(gmx_settledata_t settled, int econq,
-                 int nsettle, t_iatom iatoms[],
-                 const t_pbc *pbc,
-                 rvec x[],
-                 rvec *der, rvec *derp,
-                 int calcvir_atom_end, tensor vir_r_m_dder)
+/* The projection code, templated for real/SimdReal and for the virial */
+template<typename T, int packSize,
+         typename TypePbc,
+         bool bCalcVirial>
+static void settleProjTemplate(const gmx_settledata_t settled,
+                               const settleparam_t *p,
+                               int settleStart, int settleEnd,
+                               const TypePbc pbc,
+                               const real *x,
+                               const real *der, real *derp,
+                               tensor vir_r_m_dder)
 {
     /* Settle for projection out constraint components
      * of derivatives of the coordinates.
      * Berk Hess 2008-1-10
      */
 
-    settleparam_t *p;
-    real           imO, imH, dOH, dHH, invdOH, invdHH;
-    matrix         invmat;
-    int            i, m, m2, ow1, hw2, hw3;
-    rvec           roh2, roh3, rhh, dc, fc;
+    assert(settleStart % packSize == 0);
+    assert((settleEnd - settleStart) % packSize == 0);
 
-    calcvir_atom_end *= DIM;
+    T imO    = T(p->imO);
+    T imH    = T(p->imH);
+    T dOH    = T(p->dOH);
+    T dHH    = T(p->dHH);
+    T invdOH = T(p->invdOH);
+    T invdHH = T(p->invdHH);
 
-    if (econq == econqForce)
+    T invmat[DIM][DIM];
+    for (int d2 = 0; d2 < DIM; d2++)
     {
-        p = &settled->mass1;
-    }
-    else
-    {
-        p = &settled->massw;
+        for (int d = 0; d < DIM; d++)
+        {
+            invmat[d2][d] = T(p->invmat[d2][d]);
+        }
     }
-    imO    = p->imO;
-    imH    = p->imH;
-    copy_mat(p->invmat, invmat);
-    dOH    = p->dOH;
-    dHH    = p->dHH;
-    invdOH = p->invdOH;
-    invdHH = p->invdHH;
-
-#ifdef PRAGMAS
-#pragma ivdep
-#endif
 
-    const int nral1 = 1 + NRAL(F_SETTLE);
+    T sum_r_m_dder[DIM][DIM];
 
-    for (i = 0; i < nsettle; i++)
+    if (bCalcVirial)
     {
-        ow1 = iatoms[i*nral1 + 1];
-        hw2 = iatoms[i*nral1 + 2];
-        hw3 = iatoms[i*nral1 + 3];
-
-        if (pbc == nullptr)
+        for (int d2 = 0; d2 < DIM; d2++)
         {
-            rvec_sub(x[ow1], x[hw2], roh2);
-            rvec_sub(x[ow1], x[hw3], roh3);
-            rvec_sub(x[hw2], x[hw3], rhh);
+            for (int d = 0; d < DIM; d++)
+            {
+                sum_r_m_dder[d2][d] = T(0);
+            }
         }
-        else
+    }
+
+    for (int i = settleStart; i < settleEnd; i += packSize)
+    {
+        /* In contrast to settleTemplate, we decrement derp here,
+         * so the caller should never pass padding entries.
+         */
+        const int *ow1 = settled->ow1 + i;
+        const int *hw2 = settled->hw2 + i;
+        const int *hw3 = settled->hw3 + i;
+
+        T          x_ow1[DIM], x_hw2[DIM], x_hw3[DIM];
+
+        gatherLoadUTranspose<3>(x, ow1, &x_ow1[XX], &x_ow1[YY], &x_ow1[ZZ]);
+        gatherLoadUTranspose<3>(x, hw2, &x_hw2[XX], &x_hw2[YY], &x_hw2[ZZ]);
+        gatherLoadUTranspose<3>(x, hw3, &x_hw3[XX], &x_hw3[YY], &x_hw3[ZZ]);
+
+        T roh2[DIM], roh3[DIM], rhh[DIM];
+
+        pbc_dx_aiuc(pbc, x_ow1, x_hw2, roh2);
+        pbc_dx_aiuc(pbc, x_ow1, x_hw3, roh3);
+        pbc_dx_aiuc(pbc, x_hw2, x_hw3, rhh);
+        for (int d = 0; d < DIM; d++)
         {
-            pbc_dx_aiuc(pbc, x[ow1], x[hw2], roh2);
-            pbc_dx_aiuc(pbc, x[ow1], x[hw3], roh3);
-            pbc_dx_aiuc(pbc, x[hw2], x[hw3], rhh);
+            roh2[d] = roh2[d]*invdOH;
+            roh3[d] = roh3[d]*invdOH;
+            rhh[d]  = rhh[d]*invdHH;
         }
-        svmul(invdOH, roh2, roh2);
-        svmul(invdOH, roh3, roh3);
-        svmul(invdHH, rhh, rhh);
         /* 18 flops */
 
+        T der_ow1[DIM], der_hw2[DIM], der_hw3[DIM];
+
+        gatherLoadUTranspose<3>(der, ow1, &der_ow1[XX], &der_ow1[YY], &der_ow1[ZZ]);
+        gatherLoadUTranspose<3>(der, hw2, &der_hw2[XX], &der_hw2[YY], &der_hw2[ZZ]);
+        gatherLoadUTranspose<3>(der, hw3, &der_hw3[XX], &der_hw3[YY], &der_hw3[ZZ]);
+
         /* Determine the projections of der on the bonds */
-        clear_rvec(dc);
-        for (m = 0; m < DIM; m++)
+        T dc[DIM];
+        for (int m = 0; m < DIM; m++)
         {
-            dc[0] += (der[ow1][m] - der[hw2][m])*roh2[m];
-            dc[1] += (der[ow1][m] - der[hw3][m])*roh3[m];
-            dc[2] += (der[hw2][m] - der[hw3][m])*rhh [m];
+            dc[m] = T(0);
+        }
+        for (int d = 0; d < DIM; d++)
+        {
+            dc[0] = dc[0] + (der_ow1[d] - der_hw2[d])*roh2[d];
+            dc[1] = dc[1] + (der_ow1[d] - der_hw3[d])*roh3[d];
+            dc[2] = dc[2] + (der_hw2[d] - der_hw3[d])*rhh[d];
         }
         /* 27 flops */
 
         /* Determine the correction for the three bonds */
-        mvmul(invmat, dc, fc);
+        T fc[DIM];
+        for (int m = 0; m < DIM; m++)
+        {
+            fc[m] = invmat[m][0]*dc[0] + invmat[m][1]*dc[1] + invmat[m][2]*dc[2];
+        }
         /* 15 flops */
 
         /* Subtract the corrections from derp */
-        for (m = 0; m < DIM; m++)
+        T dderp_ow1[DIM], dderp_hw2[DIM], dderp_hw3[DIM];
+        for (int d = 0; d < DIM; d++)
         {
-            derp[ow1][m] -= imO*( fc[0]*roh2[m] + fc[1]*roh3[m]);
-            derp[hw2][m] -= imH*(-fc[0]*roh2[m] + fc[2]*rhh [m]);
-            derp[hw3][m] -= imH*(-fc[1]*roh3[m] - fc[2]*rhh [m]);
+            dderp_ow1[d] = imO*( fc[0]*roh2[d] + fc[1]*roh3[d]);
+            dderp_hw2[d] = imH*(-fc[0]*roh2[d] + fc[2]*rhh[d]);
+            dderp_hw3[d] = imH*(-fc[1]*roh3[d] - fc[2]*rhh[d]);
         }
-
         /* 45 flops */
 
-        if (ow1 < calcvir_atom_end)
+        transposeScatterDecrU<3>(derp, ow1, dderp_ow1[XX], dderp_ow1[YY], dderp_ow1[ZZ]);
+        transposeScatterDecrU<3>(derp, hw2, dderp_hw2[XX], dderp_hw2[YY], dderp_hw2[ZZ]);
+        transposeScatterDecrU<3>(derp, hw3, dderp_hw3[XX], dderp_hw3[YY], dderp_hw3[ZZ]);
+
+        if (bCalcVirial)
         {
             /* Determining r \dot m der is easy,
              * since fc contains the mass weighted corrections for der.
+             * The virial factor filters out the non-local settles.
              */
+            T filter = load(settled->virfac + i);
+            T fcOH2  = filter*dOH*fc[0];
+            T fcOH3  = filter*dOH*fc[1];
+            T fcHH   = filter*dHH*fc[2];
 
-            for (m = 0; m < DIM; m++)
+            for (int d2 = 0; d2 < DIM; d2++)
             {
-                for (m2 = 0; m2 < DIM; m2++)
+                for (int d = 0; d < DIM; d++)
                 {
-                    vir_r_m_dder[m][m2] +=
-                        dOH*roh2[m]*roh2[m2]*fc[0] +
-                        dOH*roh3[m]*roh3[m2]*fc[1] +
-                        dHH*rhh [m]*rhh [m2]*fc[2];
+                    sum_r_m_dder[d2][d] = sum_r_m_dder[d2][d] +
+                        roh2[d2]*roh2[d]*fcOH2 +
+                        roh3[d2]*roh3[d]*fcOH3 +
+                        rhh[d2]*rhh[d]*fcHH;
                 }
             }
         }
     }
+
+    if (bCalcVirial)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                vir_r_m_dder[d2][d] += reduce(sum_r_m_dder[d2][d]);
+            }
+        }
+    }
+}
+
+/* Wrapper template function that divides the projection over threads
+ * and instantiates the core template with instantiated booleans.
+ * Threads get the same settles as in csettle. Since the projection
+ * decrements derp, the SIMD padding is not processed. Instead
+ * the last, partially filled, pack is handled with scalar code.
+ */
+template<typename T, int packSize, typename TypePbc>
+static void settleProjTemplateWrapper(gmx_settledata_t settled,
+                                      const settleparam_t *p,
+                                      int nthread, int thread,
+                                      TypePbc pbc, const t_pbc *pbcScalar,
+                                      const real x[],
+                                      const real der[], real derp[],
+                                      bool bCalcVirial, tensor vir_r_m_dder)
+{
+    int numSettlePacks = (settled->nsettle + packSize - 1)/packSize;
+    int settleStart    = ((numSettlePacks* thread      + nthread - 1)/nthread)*packSize;
+    int settleEnd      = ((numSettlePacks*(thread + 1) + nthread - 1)/nthread)*packSize;
+    settleEnd          = std::min(settleEnd, settled->nsettle);
+    if (settleEnd <= settleStart)
+    {
+        return;
+    }
+    int settleEndPack  = settleStart + ((settleEnd - settleStart)/packSize)*packSize;
+
+    if (!bCalcVirial)
+    {
+        settleProjTemplate<T, packSize, TypePbc, false>
+            (settled, p, settleStart, settleEndPack, pbc, x, der, derp, nullptr);
+    }
+    else
+    {
+        settleProjTemplate<T, packSize, TypePbc, true>
+            (settled, p, settleStart, settleEndPack, pbc, x, der, derp, vir_r_m_dder);
+    }
+
+    if (settleEndPack < settleEnd)
+    {
+        if (!bCalcVirial)
+        {
+            settleProjTemplate<real, 1, const t_pbc *, false>
+                (settled, p, settleEndPack, settleEnd, pbcScalar, x, der, derp, nullptr);
+        }
+        else
+        {
+            settleProjTemplate<real, 1, const t_pbc *, true>
+                (settled, p, settleEndPack, settleEnd, pbcScalar, x, der, derp, vir_r_m_dder);
+        }
+    }
 }
 
+void settle_proj(gmx_settledata_t settled, int econq,
+                 int nthread, int thread,
+                 const t_pbc *pbc,
+                 const rvec x[],
+                 const rvec *der, rvec *derp,
+                 bool bCalcVirial, tensor vir_r_m_dder)
+{
+    const settleparam_t *p;
+
+    if (econq == econqForce)
+    {
+        p = &settled->mass1;
+    }
+    else
+    {
+        p = &settled->massw;
+    }
+
+    /* This construct is needed because pbc_dx_aiuc doesn't accept pbc=NULL */
+    t_pbc        pbcNo;
+    const t_pbc *pbcNonNull;
+
+    if (pbc != nullptr)
+    {
+        pbcNonNull = pbc;
+    }
+    else
+    {
+        set_pbc(&pbcNo, epbcNONE, nullptr);
+        pbcNonNull = &pbcNo;
+    }
+
+#if GMX_SIMD_HAVE_REAL
+    if (settled->bUseSimd)
+    {
+        /* Convert the pbc struct for SIMD */
+        GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) pbcSimd[9*GMX_SIMD_REAL_WIDTH];
+        set_pbc_simd(pbc, pbcSimd);
+
+        settleProjTemplateWrapper<SimdReal, GMX_SIMD_REAL_WIDTH,
+                                  const real *>(settled, p,
+                                                nthread, thread,
+                                                pbcSimd, pbcNonNull,
+                                                x[0], der[0], derp[0],
+                                                bCalcVirial, vir_r_m_dder);
+    }
+    else
+#endif
+    {
+        settleProjTemplateWrapper<real, 1,
+                                  const t_pbc *>(settled, p,
+                                                 nthread, thread,
+                                                 pbcNonNull, pbcNonNull,
+                                                 x[0], der[0], derp[0],
+                                                 bCalcVirial, vir_r_m_dder);
+    }
+}
 
 /* The actual settle code, templated for real/SimdReal and for optimization */
 template<typename T, typename TypeBool, int packSize,
@@ -365,6 +365,14 @@ void do_force_lowlevel(t_forcerec *fr,      t_inputrec *ir,
                     DOMAINDECOMP(cr) ? cr->dd->gatindex : nullptr,
                     flags);
 
+    if (DOMAINDECOMP(cr) && cr->dd->bOverlapHaloComm && (flags & GMX_FORCE_FORCES))
+    {
+        /* All forces on the halo atoms have been computed, start sending
+         * them while we compute the long-range forces on the home atoms.
+         */
+        dd_move_f_start(cr->dd, f);
+    }
+
     where();
 
     *cycles_pme = 0;
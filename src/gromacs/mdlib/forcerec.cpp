@@ -64,6 +64,7 @@
 #include "gromacs/math/units.h"
 #include "gromacs/math/utilities.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/calc_verletbuf.h"
 #include "gromacs/mdlib/force.h"
 #include "gromacs/mdlib/forcerec-threading.h"
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
@@ -1580,6 +1581,12 @@ gmx_bool nbnxn_gpu_acceleration_supported(const gmx::MDLogger &mdlog,
         return FALSE;
     }
 
+    if (ir->coulombtype == eelUSER || ir->vdwtype == evdwUSER)
+    {
+        GMX_LOG(mdlog.warning).asParagraph().appendText("User tables are not implemented for GPUs, falling back to the CPU");
+        return FALSE;
+    }
+
     return TRUE;
 }
 
@@ -2295,6 +2302,107 @@ static void init_nb_verlet(FILE                *fp,
     *nb_verlet = nbv;
 }
 
+/*! \brief The minimum inner list lifetime in steps with dynamic pruning
+ *
+ * Pruning costs about as much as a few percent of a kernel call,
+ * so shorter intervals would not pay off.
+ */
+static const int c_nbnxnDynamicListPruningMinLifetime = 4;
+
+/*! \brief Set up dynamic pruning of the CPU pair lists
+ *
+ * With dynamic pruning the pair list is made every nstlist steps with
+ * the buffer required for nstlist steps. Every nstlistPrune steps
+ * this outer list is pruned to an inner list with the smaller buffer
+ * required for only nstlistPrune steps. The kernels only compute
+ * the inner list, so large nstlist values no longer increase
+ * the kernel cost.
+ */
+static void init_nb_verlet_dynamic_pruning(FILE                      *fp,
+                                           nonbonded_verlet_t        *nbv,
+                                           const t_inputrec          *ir,
+                                           const gmx_mtop_t          *mtop,
+                                           matrix                     box,
+                                           const interaction_const_t *ic)
+{
+    nbv->bDynamicPruning = FALSE;
+    nbv->rlistInner      = ic->rlist;
+    nbv->nstlistPrune    = ir->nstlist;
+
+    /* We need a buffer determined by the tolerance for pruning.
+     * The GPU kernels prune the list during the first step themselves.
+     */
+    if (!EI_DYNAMICS(ir->eI) || ir->verletbuf_tol <= 0 ||
+        (EI_MD(ir->eI) && ir->etc == etcNO) ||
+        nbv->bUseGPU ||
+        !nbnxn_kernel_pairlist_simple(nbv->grp[0].kernel_type) ||
+        getenv("GMX_DISABLE_DYNAMICPRUNING") != nullptr)
+    {
+        return;
+    }
+
+    gmx_bool    bUserSetNstlistPrune = FALSE;
+    int         nstlistPrune         = c_nbnxnDynamicListPruningMinLifetime;
+    const char *env                  = getenv("GMX_NSTLIST_DYNAMICPRUNING");
+    if (env != nullptr)
+    {
+        char *end;
+
+        nstlistPrune = strtol(env, &end, 10);
+        if (!end || (*end != 0) || nstlistPrune < 1)
+        {
+            gmx_fatal(FARGS, "Invalid value passed in GMX_NSTLIST_DYNAMICPRUNING=%s, positive integer required", env);
+        }
+        bUserSetNstlistPrune = TRUE;
+    }
+
+    /* Use the cluster setup of the kernels we actually run */
+    const gmx_bool         bSIMD = (nbv->grp[0].kernel_type == nbnxnk4xN_SIMD_4xN ||
+                                    nbv->grp[0].kernel_type == nbnxnk4xN_SIMD_2xNN);
+    verletbuf_list_setup_t ls;
+    verletbuf_get_list_setup(bSIMD, FALSE, &ls);
+
+    /* Determine the inner buffer by treating the pruning interval
+     * as the list lifetime. Without a user setting we increase
+     * the interval as long as no buffer is needed at all.
+     */
+    const real rcutoff  = std::max(ic->rvdw, ic->rcoulomb);
+    t_inputrec irPrune  = *ir;
+    real       rlistInner;
+    do
+    {
+        irPrune.nstlist = nstlistPrune;
+        calc_verlet_buffer_size(mtop, det(box), &irPrune, -1, &ls, nullptr,
+                                &rlistInner);
+        nstlistPrune++;
+    }
+    while (!bUserSetNstlistPrune && nstlistPrune < ir->nstlist - 1 &&
+           rlistInner <= rcutoff);
+    nstlistPrune = irPrune.nstlist;
+
+    /* With an interval of nstlist-1 or more the inner buffer is hardly
+     * smaller than the outer one, so pruning costs more than it saves.
+     */
+    if (nstlistPrune >= ir->nstlist - 1 || rlistInner >= ic->rlist)
+    {
+        /* Pruning would not reduce the list */
+        return;
+    }
+
+    nbv->bDynamicPruning = TRUE;
+    nbv->rlistInner      = rlistInner;
+    nbv->nstlistPrune    = nstlistPrune;
+
+    if (fp != nullptr)
+    {
+        fprintf(fp, "Using a dual pair-list setup updated with dynamic pruning:\n");
+        fprintf(fp, "  outer list: updated every %3d steps, buffer %.3f nm, rlist %.3f nm\n",
+                ir->nstlist, ic->rlist - rcutoff, ic->rlist);
+        fprintf(fp, "  inner list: updated every %3d steps, buffer %.3f nm, rlist %.3f nm\n\n",
+                nbv->nstlistPrune, nbv->rlistInner - rcutoff, nbv->rlistInner);
+    }
+}
+
 gmx_bool usingGpu(nonbonded_verlet_t *nbv)
 {
     return nbv != nullptr && nbv->bUseGPU;
@@ -3194,6 +3302,20 @@ void init_forcerec(FILE                *fp,
     init_interaction_const(fp, &fr->ic, fr);
     init_interaction_const_tables(fp, fr->ic, rtab);
 
+    if (fr->cutoff_scheme == ecutsVERLET &&
+        (ir->coulombtype == eelUSER || ir->vdwtype == evdwUSER))
+    {
+        /* The nbnxn kernels read the same user table file and use the same
+         * cubic spline table layout as the group scheme kernels. The table
+         * only needs to cover the interaction cut-off, not the pair list.
+         */
+        t_forcetable *userTable = make_tables(fp, fr, tabfn,
+                                              std::max(ir->rcoulomb, ir->rvdw) + ir->tabext, 0);
+        fr->ic->tab_user_scale  = userTable->scale;
+        fr->ic->tab_user        = userTable->data;
+        sfree(userTable);
+    }
+
     if (fr->cutoff_scheme == ecutsVERLET)
     {
         // We checked the cut-offs in grompp, but double-check here.
@@ -3208,6 +3330,20 @@ void init_forcerec(FILE                *fp,
         }
 
         init_nb_verlet(fp, mdlog, &fr->nbv, bFEP_NonBonded, ir, fr, cr, nbpu_opt);
+        init_nb_verlet_dynamic_pruning(fp, fr->nbv, ir, mtop, box, fr->ic);
+    }
+
+    if (DOMAINDECOMP(cr) && cr->dd->bOverlapHaloComm &&
+        !(fr->cutoff_scheme == ecutsVERLET && !fr->nbv->bUseGPU &&
+          fr->nbv->grp[eintLocal].kernel_type != nbnxnk8x8x8_PlainC))
+    {
+        /* With GPUs the halo communication already overlaps with the local
+         * non-bonded work, the group scheme does not support overlap.
+         */
+        cr->dd->bOverlapHaloComm = FALSE;
+        GMX_LOG(mdlog.warning).asParagraph().appendText(
+                "Overlapping halo communication with computation is only supported with\n"
+                "the Verlet cut-off scheme with CPU non-bonded kernels, turning it off.");
     }
 
     if (ir->eDispCorr != edispcNO)
@@ -36,6 +36,12 @@
 
 #include "mdoutf.h"
 
+#include <cstdlib>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_struct.h"
@@ -52,10 +58,25 @@
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/timing/wallcycle.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 
+/*! \brief Copy of the data of a trajectory frame for writing in the background */
+struct TrajectoryFrameBuffer
+{
+    int                    mdof_flags;   //!< Which outputs to write, MDOF_X etc.
+    gmx_int64_t            step;         //!< The MD step
+    double                 t;            //!< The time
+    real                   lambda;       //!< The FEP lambda value
+    matrix                 box;          //!< The box
+    std::vector<gmx::RVec> x;            //!< Coordinates, with MDOF_X
+    std::vector<gmx::RVec> v;            //!< Velocities, with MDOF_V
+    std::vector<gmx::RVec> f;            //!< Forces, with MDOF_F
+    std::vector<gmx::RVec> xCompressed;  //!< Compressed output coordinates
+};
+
 struct gmx_mdoutf {
     t_fileio         *fp_trn;
     t_fileio         *fp_xtc;
@@ -75,8 +96,68 @@ struct gmx_mdoutf {
     gmx_groups_t     *groups; /* for compressed position writing */
     gmx_wallcycle_t   wcycle;
     rvec             *f_global;
+    /* With asynchronous writing, a frame is copied to one of the two
+     * buffers and written by writeThread, while the MD loop continues
+     * and the next frame can be copied to the other buffer.
+     */
+    gmx_bool              bAsyncWrite;
+    TrajectoryFrameBuffer frameBuffer[2];
+    int                   frameBufferIndex;
+    std::thread           writeThread;
+    /* With asynchronous checkpointing, checkpointThread syncs the last
+     * checkpoint to disk and renames it, while the MD loop continues.
+     */
+    gmx_bool              bAsyncCheckpoint;
+    std::thread           checkpointThread;
+    /* Protects starting and joining writeThread and checkpointThread */
+    std::mutex            threadMutex;
+    /* Whether we set mdoutfFatalExitCallback, only done on the master rank */
+    gmx_bool              bFatalExitCallback;
 };
 
+/*! \brief Waits for \p thread of \p of to finish, if it is running */
+static void joinWriteThread(gmx_mdoutf_t of, std::thread *thread)
+{
+    std::lock_guard<std::mutex> lock(of->threadMutex);
+    if (thread->joinable())
+    {
+        thread->join();
+    }
+}
+
+/*! \brief Makes \p thread of \p of manage the running thread \p newThread */
+static void setWriteThread(gmx_mdoutf_t of, std::thread *thread, std::thread *newThread)
+{
+    std::lock_guard<std::mutex> lock(of->threadMutex);
+    *thread = std::move(*newThread);
+}
+
+/*! \brief Callback for gmx_fatal() that waits for the output in progress
+ *
+ * A fatal error can occur while a frame or checkpoint is being written
+ * in the background. This waits for these writes to finish, so the files
+ * are complete and the program does not exit with running std::thread
+ * objects. When the fatal error occurs in one of the write threads,
+ * or while the main thread is waiting for one, we can not wait.
+ */
+static void mdoutfFatalExitCallback(void *data)
+{
+    gmx_mdoutf_t                 of = static_cast<gmx_mdoutf_t>(data);
+    std::unique_lock<std::mutex> lock(of->threadMutex, std::try_to_lock);
+
+    if (!lock.owns_lock())
+    {
+        return;
+    }
+    for (std::thread *thread : { &of->writeThread, &of->checkpointThread })
+    {
+        if (thread->joinable() && thread->get_id() != std::this_thread::get_id())
+        {
+            thread->join();
+        }
+    }
+}
+
 
 gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
                          int mdrun_flags, const t_commrec *cr,
@@ -88,7 +169,7 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
     gmx_bool       bAppendFiles, bCiteTng = FALSE;
     int            i;
 
-    snew(of, 1);
+    of = new gmx_mdoutf();
 
     of->fp_trn       = nullptr;
     of->fp_ene       = nullptr;
@@ -104,6 +185,14 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
     of->x_compression_precision = static_cast<int>(ir->x_compression_precision);
     of->wcycle                  = wcycle;
     of->f_global                = nullptr;
+    of->bAsyncWrite             = (getenv("GMX_NO_ASYNC_TRAJECTORY_WRITING") == nullptr);
+    of->frameBufferIndex        = 0;
+    of->bFatalExitCallback      = FALSE;
+#ifndef GMX_FAHCORE
+    of->bAsyncCheckpoint        = (getenv("GMX_NO_ASYNC_CHECKPOINT") == nullptr);
+#else
+    of->bAsyncCheckpoint        = FALSE;
+#endif
 
     if (MASTER(cr))
     {
@@ -213,6 +302,9 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
         {
             snew(of->f_global, top_global->natoms);
         }
+
+        gmx_set_fatal_exit_callback(mdoutfFatalExitCallback, of);
+        of->bFatalExitCallback = TRUE;
     }
 
     if (bCiteTng)
@@ -238,10 +330,99 @@ gmx_wallcycle_t mdoutf_get_wcycle(gmx_mdoutf_t of)
     return of->wcycle;
 }
 
+/*! \brief Writes the frame outputs selected by \p mdof_flags
+ *
+ * Only pass flags MDOF_X, MDOF_V, MDOF_F and MDOF_X_COMPRESSED.
+ * \p xxtc contains the coordinates of the compressed output group.
+ */
+static void writeTrajectoryFrame(gmx_mdoutf_t of, int mdof_flags,
+                                 gmx_int64_t step, double t,
+                                 real lambda, const matrix box,
+                                 const rvec *x, const rvec *v, const rvec *f,
+                                 const rvec *xxtc)
+{
+    if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+    {
+        if (of->fp_trn)
+        {
+            gmx_trr_write_frame(of->fp_trn, step, t, lambda,
+                                box, of->natoms_global,
+                                x, v, f);
+            if (gmx_fio_flush(of->fp_trn) != 0)
+            {
+                gmx_file("Cannot write trajectory; maybe you are out of disk space?");
+            }
+        }
+
+        /* If a TNG file is open for uncompressed coordinate output also write
+           velocities and forces to it. */
+        else if (of->tng)
+        {
+            gmx_fwrite_tng(of->tng, FALSE, step, t, lambda,
+                           box,
+                           of->natoms_global,
+                           x, v, f);
+        }
+        /* If only a TNG file is open for compressed coordinate output (no uncompressed
+           coordinate output) also write forces and velocities to it. */
+        else if (of->tng_low_prec)
+        {
+            gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, lambda,
+                           box,
+                           of->natoms_global,
+                           x, v, f);
+        }
+    }
+    if (mdof_flags & MDOF_X_COMPRESSED)
+    {
+        if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t,
+                      box, xxtc, of->x_compression_precision) == 0)
+        {
+            gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
+        }
+        gmx_fwrite_tng(of->tng_low_prec,
+                       TRUE,
+                       step,
+                       t,
+                       lambda,
+                       box,
+                       of->natoms_x_compressed,
+                       xxtc,
+                       nullptr,
+                       nullptr);
+    }
+}
+
+/*! \brief Copies \p natoms vectors from \p src to \p dest, when \p src is not NULL */
+static void copyFrameData(const rvec *src, int natoms, std::vector<gmx::RVec> *dest)
+{
+    if (src != nullptr)
+    {
+        dest->assign(src, src + natoms);
+    }
+}
+
+/*! \brief Thread function that writes a frame buffer */
+static void writeFrameBufferThread(gmx_mdoutf_t of, const TrajectoryFrameBuffer *buffer)
+{
+    try
+    {
+        int mdof_flags = buffer->mdof_flags;
+
+        writeTrajectoryFrame(of, mdof_flags, buffer->step, buffer->t,
+                             buffer->lambda, buffer->box,
+                             (mdof_flags & MDOF_X) ? as_rvec_array(buffer->x.data()) : nullptr,
+                             (mdof_flags & MDOF_V) ? as_rvec_array(buffer->v.data()) : nullptr,
+                             (mdof_flags & MDOF_F) ? as_rvec_array(buffer->f.data()) : nullptr,
+                             (mdof_flags & MDOF_X_COMPRESSED) ? as_rvec_array(buffer->xCompressed.data()) : nullptr);
+    }
+    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+}
+
 void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                                       gmx_mdoutf_t of,
                                       int mdof_flags,
-                                      gmx_mtop_t *top_global,
+                                      gmx_mtop_t gmx_unused *top_global,
                                       gmx_int64_t step, double t,
                                       t_state *state_local, t_state *state_global,
                                       energyhistory_t *energyHistory,
@@ -286,65 +467,35 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
     {
         if (mdof_flags & MDOF_CPT)
         {
+            /* The file positions in the checkpoint should include
+             * all frames written so far.
+             */
+            mdoutf_wait_for_writing(of);
+            /* The previous checkpoint should be complete before we write a new one */
+            joinWriteThread(of, &of->checkpointThread);
+
             fflush_tng(of->tng);
             fflush_tng(of->tng_low_prec);
-            ivec one_ivec = { 1, 1, 1 };
+            ivec        one_ivec = { 1, 1, 1 };
+            std::thread finishThread;
             write_checkpoint(of->fn_cpt, of->bKeepAndNumCPT,
                              fplog, cr,
                              DOMAINDECOMP(cr) ? cr->dd->nc : one_ivec,
                              DOMAINDECOMP(cr) ? cr->dd->nnodes : cr->nnodes,
                              of->eIntegrator, of->simulation_part,
                              of->bExpanded, of->elamstats, step, t,
-                             state_global, energyHistory);
+                             state_global, energyHistory,
+                             of->bAsyncCheckpoint ? &finishThread : nullptr);
+            setWriteThread(of, &of->checkpointThread, &finishThread);
         }
 
-        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
-        {
-            const rvec *x = (mdof_flags & MDOF_X) ? as_rvec_array(state_global->x.data()) : nullptr;
-            const rvec *v = (mdof_flags & MDOF_V) ? as_rvec_array(state_global->v.data()) : nullptr;
-            const rvec *f = (mdof_flags & MDOF_F) ? f_global : nullptr;
-
-            if (of->fp_trn)
-            {
-                gmx_trr_write_frame(of->fp_trn, step, t, state_local->lambda[efptFEP],
-                                    state_local->box, top_global->natoms,
-                                    x, v, f);
-                if (gmx_fio_flush(of->fp_trn) != 0)
-                {
-                    gmx_file("Cannot write trajectory; maybe you are out of disk space?");
-                }
-            }
-
-            /* If a TNG file is open for uncompressed coordinate output also write
-               velocities and forces to it. */
-            else if (of->tng)
-            {
-                gmx_fwrite_tng(of->tng, FALSE, step, t, state_local->lambda[efptFEP],
-                               state_local->box,
-                               top_global->natoms,
-                               x, v, f);
-            }
-            /* If only a TNG file is open for compressed coordinate output (no uncompressed
-               coordinate output) also write forces and velocities to it. */
-            else if (of->tng_low_prec)
-            {
-                gmx_fwrite_tng(of->tng_low_prec, FALSE, step, t, state_local->lambda[efptFEP],
-                               state_local->box,
-                               top_global->natoms,
-                               x, v, f);
-            }
-        }
-        if (mdof_flags & MDOF_X_COMPRESSED)
+        int writeFlags = (mdof_flags & (MDOF_X | MDOF_V | MDOF_F | MDOF_X_COMPRESSED));
+        if (writeFlags != 0)
         {
             rvec *xxtc = nullptr;
 
-            if (of->natoms_x_compressed == of->natoms_global)
-            {
-                /* We are writing the positions of all of the atoms to
-                   the compressed output */
-                xxtc = as_rvec_array(state_global->x.data());
-            }
-            else
+            if ((mdof_flags & MDOF_X_COMPRESSED) &&
+                of->natoms_x_compressed != of->natoms_global)
             {
                 /* We are writing the positions of only a subset of
                    the atoms to the compressed output, so we have to
@@ -360,22 +511,46 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                     }
                 }
             }
-            if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t,
-                          state_local->box, xxtc, of->x_compression_precision) == 0)
+            else if (mdof_flags & MDOF_X_COMPRESSED)
             {
-                gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
+                /* We are writing the positions of all of the atoms to
+                   the compressed output */
+                xxtc = as_rvec_array(state_global->x.data());
             }
-            gmx_fwrite_tng(of->tng_low_prec,
-                           TRUE,
-                           step,
-                           t,
-                           state_local->lambda[efptFEP],
-                           state_local->box,
-                           of->natoms_x_compressed,
-                           xxtc,
-                           nullptr,
-                           nullptr);
-            if (of->natoms_x_compressed != of->natoms_global)
+
+            const rvec *x = (mdof_flags & MDOF_X) ? as_rvec_array(state_global->x.data()) : nullptr;
+            const rvec *v = (mdof_flags & MDOF_V) ? as_rvec_array(state_global->v.data()) : nullptr;
+            const rvec *f = (mdof_flags & MDOF_F) ? f_global : nullptr;
+
+            if (of->bAsyncWrite)
+            {
+                /* Copy the frame to the buffer not in use by the writing thread */
+                TrajectoryFrameBuffer *buffer = &of->frameBuffer[of->frameBufferIndex];
+                of->frameBufferIndex = 1 - of->frameBufferIndex;
+
+                buffer->mdof_flags = writeFlags;
+                buffer->step       = step;
+                buffer->t          = t;
+                buffer->lambda     = state_local->lambda[efptFEP];
+                copy_mat(state_local->box, buffer->box);
+                copyFrameData(x, of->natoms_global, &buffer->x);
+                copyFrameData(v, of->natoms_global, &buffer->v);
+                copyFrameData(f, of->natoms_global, &buffer->f);
+                copyFrameData(xxtc, of->natoms_x_compressed, &buffer->xCompressed);
+
+                mdoutf_wait_for_writing(of);
+                std::thread writeThread(writeFrameBufferThread, of, buffer);
+                setWriteThread(of, &of->writeThread, &writeThread);
+            }
+            else
+            {
+                writeTrajectoryFrame(of, writeFlags, step, t,
+                                     state_local->lambda[efptFEP], state_local->box,
+                                     x, v, f, xxtc);
+            }
+
+            if ((mdof_flags & MDOF_X_COMPRESSED) &&
+                of->natoms_x_compressed != of->natoms_global)
             {
                 sfree(xxtc);
             }
@@ -383,8 +558,15 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
     }
 }
 
+void mdoutf_wait_for_writing(gmx_mdoutf_t of)
+{
+    joinWriteThread(of, &of->writeThread);
+}
+
 void mdoutf_tng_close(gmx_mdoutf_t of)
 {
+    mdoutf_wait_for_writing(of);
+
     if (of->tng || of->tng_low_prec)
     {
         wallcycle_start(of->wcycle, ewcTRAJ);
@@ -396,6 +578,14 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
 
 void done_mdoutf(gmx_mdoutf_t of, const t_inputrec *ir)
 {
+    /* The last frame and checkpoint might still be written */
+    mdoutf_wait_for_writing(of);
+    joinWriteThread(of, &of->checkpointThread);
+    if (of->bFatalExitCallback)
+    {
+        gmx_set_fatal_exit_callback(nullptr, nullptr);
+    }
+
     if (of->fp_ene != nullptr)
     {
         close_enx(of->fp_ene);
@@ -421,5 +611,5 @@ void done_mdoutf(gmx_mdoutf_t of, const t_inputrec *ir)
     gmx_tng_close(&of->tng);
     gmx_tng_close(&of->tng_low_prec);
 
-    sfree(of);
+    delete of;
 }
@@ -101,6 +101,15 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                                       energyhistory_t *energyHistory,
                                       PaddedRVecVector *f_local);
 
+/*! \brief Waits until the last frame written by mdoutf_write_to_trajectory_files is on file
+ *
+ * Unless the environment variable GMX_NO_ASYNC_TRAJECTORY_WRITING is set,
+ * the master rank copies the frame data and writes it to the
+ * trajectory files in a background thread. This function should be
+ * called before accessing the trajectory files directly.
+ */
+void mdoutf_wait_for_writing(gmx_mdoutf_t of);
+
 #define MDOF_X            (1<<0)
 #define MDOF_V            (1<<1)
 #define MDOF_F            (1<<2)
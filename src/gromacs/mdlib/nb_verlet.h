@@ -105,6 +105,12 @@ typedef struct nonbonded_verlet_t {
     gmx_nbnxn_gpu_t         *gpu_nbv;         /* pointer to GPU nb verlet data     */
     int                      min_ci_balanced; /* pair list balancing parameter
                                                  used for the 8x8x8 GPU kernels    */
+    gmx_bool                 bDynamicPruning; /* TRUE when the pair lists are pruned
+                                                 dynamically with rlistInner         */
+    real                     rlistInner;      /* Cut-off of the dynamically pruned
+                                                 inner pair lists                    */
+    int                      nstlistPrune;    /* Interval in steps for pruning the
+                                                 inner pair lists                    */
 } nonbonded_verlet_t;
 
 /*! \brief Getter for bUseGPU */
@@ -80,7 +80,7 @@ import collections # Requires Python 2.7
 sys.path.append('../../../../../admin')
 from copyright import create_copyright_header
 
-FileHeader = create_copyright_header('2012,2013,2014,2015')
+FileHeader = create_copyright_header('2012,2013,2014,2015,2016,2017')
 FileHeader += """/*
  * Note: this file was generated by the Verlet kernel generator for
  * kernel type {0}.
@@ -105,6 +105,7 @@ ElectrostaticsDict['ElecQSTab'] = { 'define' : '#define CALC_COUL_TAB' }
 ElectrostaticsDict['ElecQSTabTwinCut'] = { 'define' : '#define CALC_COUL_TAB\n#define VDW_CUTOFF_CHECK /* Use twin-range cut-off */' }
 ElectrostaticsDict['ElecEw'] = { 'define' : '#define CALC_COUL_EWALD' }
 ElectrostaticsDict['ElecEwTwinCut'] = { 'define' : '#define CALC_COUL_EWALD\n#define VDW_CUTOFF_CHECK /* Use twin-range cut-off */' }
+ElectrostaticsDict['ElecUserTab'] = { 'define' : '#define CALC_COUL_USERTAB' }
  
 # The dict order must match the order of a C enumeration.
 VdwTreatmentDict = collections.OrderedDict()
@@ -114,21 +115,22 @@ VdwTreatmentDict['VdwLJ'] = { 'define' : '#define LJ_CUT\n/* Use full LJ combina
 VdwTreatmentDict['VdwLJFSw'] = { 'define' : '#define LJ_FORCE_SWITCH\n/* Use full LJ combination matrix */' }
 VdwTreatmentDict['VdwLJPSw'] = { 'define' : '#define LJ_POT_SWITCH\n/* Use full LJ combination matrix */' }
 VdwTreatmentDict['VdwLJEwCombGeom'] = { 'define' : '#define LJ_CUT\n#define LJ_EWALD_GEOM\n/* Use full LJ combination matrix + geometric rule for the grid correction */' }
-
-# This is OK as an unordered dict
-EnergiesComputationDict = {
-    'F'  : {
-        'function type' : 'nbk_func_noener',
-        'define' : '/* Will not calculate energies */',
-    },
-    'VF'    : {
-        'function type' : 'nbk_func_ener',
-        'define' : '#define CALC_ENERGIES',
-    },
-    'VgrpF' : {
-        'function type' : 'nbk_func_ener',
-        'define' : '#define CALC_ENERGIES\n#define ENERGY_GROUPS',
-    },
+VdwTreatmentDict['VdwUserTab'] = { 'define' : '#define VDW_USERTAB\n/* Use full LJ combination matrix */' }
+
+# The dict order sets the order of the declarations in the header file,
+# it is fixed so the output does not depend on the Python version.
+EnergiesComputationDict = collections.OrderedDict()
+EnergiesComputationDict['VgrpF'] = {
+    'function type' : 'nbk_func_ener',
+    'define' : '#define CALC_ENERGIES\n#define ENERGY_GROUPS',
+}
+EnergiesComputationDict['VF'] = {
+    'function type' : 'nbk_func_ener',
+    'define' : '#define CALC_ENERGIES',
+}
+EnergiesComputationDict['F'] = {
+    'function type' : 'nbk_func_noener',
+    'define' : '/* Will not calculate energies */',
 }
 
 # This is OK as an unordered dict
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2012,2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -35,8 +35,9 @@
 
 /* When calculating RF or Ewald interactions we calculate the electrostatic
  * forces and energies on excluded atom pairs here in the non-bonded loops.
+ * User tables have no exclusion correction.
  */
-#if defined CHECK_EXCLS && (defined CALC_COULOMB || defined LJ_EWALD)
+#if defined CHECK_EXCLS && ((defined CALC_COULOMB && !defined CALC_COUL_USERTAB) || defined LJ_EWALD)
 #define EXCL_FORCES
 #endif
 
@@ -67,13 +68,22 @@
             int             aj;
             real            dx, dy, dz;
             real            rsq, rinv;
-            real            rinvsq, rinvsix;
+            real            rinvsq;
             real            c6, c12;
-            real            FrLJ6 = 0, FrLJ12 = 0, frLJ = 0;
+#ifndef VDW_USERTAB
+            real            rinvsix;
+            real            FrLJ6 = 0, FrLJ12 = 0;
+#endif
+            real            frLJ = 0;
             real            VLJ gmx_unused;
 #if defined LJ_FORCE_SWITCH || defined LJ_POT_SWITCH
             real            r, rsw;
 #endif
+#if (defined CALC_COULOMB && defined CALC_COUL_USERTAB) || defined VDW_USERTAB
+            /* User table scaled distance, index and fraction */
+            real            rt, epst;
+            int             nt;
+#endif
 
 #ifdef CALC_COULOMB
             real qq;
@@ -147,6 +157,13 @@
 
             rinvsq  = rinv*rinv;
 
+#if (defined CALC_COULOMB && defined CALC_COUL_USERTAB) || defined VDW_USERTAB
+            /* rinv is zero beyond the cut-off, which gives table entry 0 */
+            rt      = rsq*rinv*tab_user_scale;
+            nt      = static_cast<int>(rt);
+            epst    = rt - nt;
+#endif
+
 #ifdef HALF_LJ
             if (i < UNROLLI/2)
 #endif
@@ -167,6 +184,22 @@
 #endif
 #endif
 
+#ifdef VDW_USERTAB
+                {
+                    real Vd, FFd, Vr, FFr;
+
+                    /* The dispersion and repulsion tables are scaled
+                     * by 1/6 and 1/12, as our c6 and c12.
+                     */
+                    user_table_interpolate(tab_user + nt*12 + 4, epst, &Vd, &FFd);
+                    user_table_interpolate(tab_user + nt*12 + 8, epst, &Vr, &FFr);
+                    frLJ    = -interact*(c6*FFd + c12*FFr)*rt;
+#ifdef CALC_ENERGIES
+                    VLJ     = c6*Vd + c12*Vr;
+#endif
+                }
+#endif
+
 #if defined LJ_FORCE_SWITCH || defined LJ_POT_SWITCH
                 /* Force or potential switching from ic->rvdw_switch */
                 r       = rsq*rinv;
@@ -332,6 +365,18 @@
             fcoul *= qq*rinv;
 #endif
 
+#ifdef CALC_COUL_USERTAB
+            {
+                real V, FF;
+
+                user_table_interpolate(tab_user + nt*12, epst, &V, &FF);
+                fcoul  = -qq*interact*FF*rt*rinvsq;
+#ifdef CALC_ENERGIES
+                vcoul  = qq*interact*V;
+#endif
+            }
+#endif
+
 #ifdef CALC_ENERGIES
 #ifdef ENERGY_GROUPS
             Vc[egp_sh_i[i]+((egp_cj>>(nbat->neg_2log*j)) & egp_mask)] += vcoul;
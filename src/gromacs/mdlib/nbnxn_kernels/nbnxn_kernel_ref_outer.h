@@ -62,6 +62,9 @@
 #define NBK_FUNC_NAME2(ljt, feg) nbnxn_kernel ## _ElecQSTabTwinCut ## ljt ## feg ## _ref
 #endif
 #endif
+#ifdef CALC_COUL_USERTAB
+#define NBK_FUNC_NAME2(ljt, feg) nbnxn_kernel ## _ElecUserTab ## ljt ## feg ## _ref
+#endif
 
 #if defined LJ_CUT && !defined LJ_EWALD
 #define NBK_FUNC_NAME(feg) NBK_FUNC_NAME2(_VdwLJ, feg)
@@ -75,6 +78,8 @@
 #else
 #define NBK_FUNC_NAME(feg) NBK_FUNC_NAME2(_VdwLJEwCombLB, feg)
 #endif
+#elif defined VDW_USERTAB
+#define NBK_FUNC_NAME(feg) NBK_FUNC_NAME2(_VdwUserTab, feg)
 #else
 #error "No VdW type defined"
 #endif
@@ -120,7 +125,9 @@ NBK_FUNC_NAME(_VgrpF)
 #endif
     int                 ntype2;
     real                facel;
-    int                 n, ci, ci_sh;
+    int                 n, ci;
+    /* ci_sh is unused when there are no exclusion forces nor energies */
+    int gmx_unused      ci_sh;
     int                 ish, ishf;
     gmx_bool            do_LJ, half_LJ, do_coul;
     int                 cjind0, cjind1, cjind;
@@ -167,6 +174,10 @@ NBK_FUNC_NAME(_VgrpF)
     const real gmx_unused *tab_coul_V;
 #endif
 #endif
+#if defined CALC_COUL_USERTAB || defined VDW_USERTAB
+    real        tab_user_scale;
+    const real *tab_user;
+#endif
 
 #ifdef COUNT_PAIRS
     int npair = 0;
@@ -210,6 +221,10 @@ NBK_FUNC_NAME(_VgrpF)
     tab_coul_V    = ic->tabq_coul_V;
 #endif
 #endif
+#if defined CALC_COUL_USERTAB || defined VDW_USERTAB
+    tab_user_scale = ic->tab_user_scale;
+    tab_user       = ic->tab_user;
+#endif
 
 #ifdef ENERGY_GROUPS
     egp_mask = (1<<nbat->neg_2log) - 1;
@@ -299,6 +314,10 @@ NBK_FUNC_NAME(_VgrpF)
 #else
             Vc_sub_self = 0.5*tab_coul_FDV0[2];
 #endif
+#endif
+#ifdef CALC_COUL_USERTAB
+            /* User tables have no self or exclusion correction */
+            Vc_sub_self = 0;
 #endif
 
             if (l_cj[nbln->cj_ind_start].cj == ci_sh)
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2012,2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -69,18 +69,19 @@
 /*! \brief Kinds of electrostatic treatments in SIMD Verlet kernels
  */
 enum {
-    coulktRF, coulktTAB, coulktTAB_TWIN, coulktEWALD, coulktEWALD_TWIN, coulktNR
+    coulktRF, coulktTAB, coulktTAB_TWIN, coulktEWALD, coulktEWALD_TWIN, coulktUSERTAB, coulktNR
 };
 
 /*! \brief Kinds of Van der Waals treatments in SIMD Verlet kernels
  */
 enum {
-    vdwktLJCUT_COMBGEOM, vdwktLJCUT_COMBLB, vdwktLJCUT_COMBNONE, vdwktLJFORCESWITCH, vdwktLJPOTSWITCH, vdwktLJEWALDCOMBGEOM, vdwktNR
+    vdwktLJCUT_COMBGEOM, vdwktLJCUT_COMBLB, vdwktLJCUT_COMBNONE, vdwktLJFORCESWITCH, vdwktLJPOTSWITCH, vdwktLJEWALDCOMBGEOM, vdwktUSERTAB, vdwktNR
 };
 
 /* Declare and define the kernel function pointer lookup tables.
  * The minor index of the array goes over both the LJ combination rules,
- * which is only supported by plain cut-off, and the LJ switch/PME functions.
+ * which is only supported by plain cut-off, and the LJ switch/PME functions
+ * and user tables.
  */
 static p_nbk_func_noener p_nbk_noener[coulktNR][vdwktNR] =
 {
@@ -91,6 +92,7 @@ static p_nbk_func_noener p_nbk_noener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecRF_VdwLJFSw_F_2xnn,
         nbnxn_kernel_ElecRF_VdwLJPSw_F_2xnn,
         nbnxn_kernel_ElecRF_VdwLJEwCombGeom_F_2xnn,
+        nbnxn_kernel_ElecRF_VdwUserTab_F_2xnn,
     },
     {
         nbnxn_kernel_ElecQSTab_VdwLJCombGeom_F_2xnn,
@@ -99,6 +101,7 @@ static p_nbk_func_noener p_nbk_noener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecQSTab_VdwLJFSw_F_2xnn,
         nbnxn_kernel_ElecQSTab_VdwLJPSw_F_2xnn,
         nbnxn_kernel_ElecQSTab_VdwLJEwCombGeom_F_2xnn,
+        nbnxn_kernel_ElecQSTab_VdwUserTab_F_2xnn,
     },
     {
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombGeom_F_2xnn,
@@ -107,6 +110,7 @@ static p_nbk_func_noener p_nbk_noener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJFSw_F_2xnn,
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJPSw_F_2xnn,
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJEwCombGeom_F_2xnn,
+        nbnxn_kernel_ElecQSTabTwinCut_VdwUserTab_F_2xnn,
     },
     {
         nbnxn_kernel_ElecEw_VdwLJCombGeom_F_2xnn,
@@ -115,6 +119,7 @@ static p_nbk_func_noener p_nbk_noener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecEw_VdwLJFSw_F_2xnn,
         nbnxn_kernel_ElecEw_VdwLJPSw_F_2xnn,
         nbnxn_kernel_ElecEw_VdwLJEwCombGeom_F_2xnn,
+        nbnxn_kernel_ElecEw_VdwUserTab_F_2xnn,
     },
     {
         nbnxn_kernel_ElecEwTwinCut_VdwLJCombGeom_F_2xnn,
@@ -123,6 +128,16 @@ static p_nbk_func_noener p_nbk_noener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecEwTwinCut_VdwLJFSw_F_2xnn,
         nbnxn_kernel_ElecEwTwinCut_VdwLJPSw_F_2xnn,
         nbnxn_kernel_ElecEwTwinCut_VdwLJEwCombGeom_F_2xnn,
+        nbnxn_kernel_ElecEwTwinCut_VdwUserTab_F_2xnn,
+    },
+    {
+        nbnxn_kernel_ElecUserTab_VdwLJCombGeom_F_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJCombLB_F_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJ_F_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJFSw_F_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJPSw_F_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJEwCombGeom_F_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwUserTab_F_2xnn,
     },
 };
 
@@ -135,6 +150,7 @@ static p_nbk_func_ener p_nbk_ener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecRF_VdwLJFSw_VF_2xnn,
         nbnxn_kernel_ElecRF_VdwLJPSw_VF_2xnn,
         nbnxn_kernel_ElecRF_VdwLJEwCombGeom_VF_2xnn,
+        nbnxn_kernel_ElecRF_VdwUserTab_VF_2xnn,
     },
     {
         nbnxn_kernel_ElecQSTab_VdwLJCombGeom_VF_2xnn,
@@ -143,6 +159,7 @@ static p_nbk_func_ener p_nbk_ener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecQSTab_VdwLJFSw_VF_2xnn,
         nbnxn_kernel_ElecQSTab_VdwLJPSw_VF_2xnn,
         nbnxn_kernel_ElecQSTab_VdwLJEwCombGeom_VF_2xnn,
+        nbnxn_kernel_ElecQSTab_VdwUserTab_VF_2xnn,
     },
     {
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombGeom_VF_2xnn,
@@ -151,6 +168,7 @@ static p_nbk_func_ener p_nbk_ener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJFSw_VF_2xnn,
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJPSw_VF_2xnn,
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJEwCombGeom_VF_2xnn,
+        nbnxn_kernel_ElecQSTabTwinCut_VdwUserTab_VF_2xnn,
     },
     {
         nbnxn_kernel_ElecEw_VdwLJCombGeom_VF_2xnn,
@@ -159,6 +177,7 @@ static p_nbk_func_ener p_nbk_ener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecEw_VdwLJFSw_VF_2xnn,
         nbnxn_kernel_ElecEw_VdwLJPSw_VF_2xnn,
         nbnxn_kernel_ElecEw_VdwLJEwCombGeom_VF_2xnn,
+        nbnxn_kernel_ElecEw_VdwUserTab_VF_2xnn,
     },
     {
         nbnxn_kernel_ElecEwTwinCut_VdwLJCombGeom_VF_2xnn,
@@ -167,6 +186,16 @@ static p_nbk_func_ener p_nbk_ener[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecEwTwinCut_VdwLJFSw_VF_2xnn,
         nbnxn_kernel_ElecEwTwinCut_VdwLJPSw_VF_2xnn,
         nbnxn_kernel_ElecEwTwinCut_VdwLJEwCombGeom_VF_2xnn,
+        nbnxn_kernel_ElecEwTwinCut_VdwUserTab_VF_2xnn,
+    },
+    {
+        nbnxn_kernel_ElecUserTab_VdwLJCombGeom_VF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJCombLB_VF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJ_VF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJFSw_VF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJPSw_VF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJEwCombGeom_VF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwUserTab_VF_2xnn,
     },
 };
 
@@ -179,6 +208,7 @@ static p_nbk_func_ener p_nbk_energrp[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecRF_VdwLJFSw_VgrpF_2xnn,
         nbnxn_kernel_ElecRF_VdwLJPSw_VgrpF_2xnn,
         nbnxn_kernel_ElecRF_VdwLJEwCombGeom_VgrpF_2xnn,
+        nbnxn_kernel_ElecRF_VdwUserTab_VgrpF_2xnn,
     },
     {
         nbnxn_kernel_ElecQSTab_VdwLJCombGeom_VgrpF_2xnn,
@@ -187,6 +217,7 @@ static p_nbk_func_ener p_nbk_energrp[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecQSTab_VdwLJFSw_VgrpF_2xnn,
         nbnxn_kernel_ElecQSTab_VdwLJPSw_VgrpF_2xnn,
         nbnxn_kernel_ElecQSTab_VdwLJEwCombGeom_VgrpF_2xnn,
+        nbnxn_kernel_ElecQSTab_VdwUserTab_VgrpF_2xnn,
     },
     {
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombGeom_VgrpF_2xnn,
@@ -195,6 +226,7 @@ static p_nbk_func_ener p_nbk_energrp[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJFSw_VgrpF_2xnn,
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJPSw_VgrpF_2xnn,
         nbnxn_kernel_ElecQSTabTwinCut_VdwLJEwCombGeom_VgrpF_2xnn,
+        nbnxn_kernel_ElecQSTabTwinCut_VdwUserTab_VgrpF_2xnn,
     },
     {
         nbnxn_kernel_ElecEw_VdwLJCombGeom_VgrpF_2xnn,
@@ -203,6 +235,7 @@ static p_nbk_func_ener p_nbk_energrp[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecEw_VdwLJFSw_VgrpF_2xnn,
         nbnxn_kernel_ElecEw_VdwLJPSw_VgrpF_2xnn,
         nbnxn_kernel_ElecEw_VdwLJEwCombGeom_VgrpF_2xnn,
+        nbnxn_kernel_ElecEw_VdwUserTab_VgrpF_2xnn,
     },
     {
         nbnxn_kernel_ElecEwTwinCut_VdwLJCombGeom_VgrpF_2xnn,
@@ -211,6 +244,16 @@ static p_nbk_func_ener p_nbk_energrp[coulktNR][vdwktNR] =
         nbnxn_kernel_ElecEwTwinCut_VdwLJFSw_VgrpF_2xnn,
         nbnxn_kernel_ElecEwTwinCut_VdwLJPSw_VgrpF_2xnn,
         nbnxn_kernel_ElecEwTwinCut_VdwLJEwCombGeom_VgrpF_2xnn,
+        nbnxn_kernel_ElecEwTwinCut_VdwUserTab_VgrpF_2xnn,
+    },
+    {
+        nbnxn_kernel_ElecUserTab_VdwLJCombGeom_VgrpF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJCombLB_VgrpF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJ_VgrpF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJFSw_VgrpF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJPSw_VgrpF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwLJEwCombGeom_VgrpF_2xnn,
+        nbnxn_kernel_ElecUserTab_VdwUserTab_VgrpF_2xnn,
     },
 };
 
@@ -286,6 +329,10 @@ nbnxn_kernel_simd_2xnn(nbnxn_pairlist_set_t      gmx_unused *nbl_list,
     {
         coulkt = coulktRF;
     }
+    else if (ic->eeltype == eelUSER)
+    {
+        coulkt = coulktUSERTAB;
+    }
     else
     {
         if (ewald_excl == ewaldexclTable)
@@ -344,6 +391,10 @@ nbnxn_kernel_simd_2xnn(nbnxn_pairlist_set_t      gmx_unused *nbl_list,
         }
         vdwkt = vdwktLJEWALDCOMBGEOM;
     }
+    else if (ic->vdwtype == evdwUSER)
+    {
+        vdwkt = vdwktUSERTAB;
+    }
     else
     {
         gmx_incons("Unsupported VdW interaction type");
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2013,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2012,2013,2014,2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -70,6 +70,27 @@ using namespace gmx;
 #define TAB_FDV0
 #endif
 
+#if defined CALC_COUL_USERTAB || defined VDW_USERTAB
+/* Interpolate one function of the stride 12 user cubic spline table,
+ * identical to the 4xn version. Returns V and dV/d(scaled r).
+ */
+static gmx_inline void gmx_simdcall
+gmx_load_user_table(const real *tab, SimdInt32 ti_S, SimdReal frac_S,
+                    SimdReal *v_S, SimdReal *dv_S)
+{
+    SimdReal y_S, f_S, g_S, h_S;
+
+    gatherLoadBySimdIntTranspose<12>(tab, ti_S, &y_S, &f_S, &g_S, &h_S);
+
+    SimdReal geps_S  = frac_S * g_S;
+    SimdReal heps2_S = frac_S * frac_S * h_S;
+    SimdReal fp_S    = f_S + geps_S + heps2_S;
+
+    *v_S             = fma(frac_S, fp_S, y_S);
+    *dv_S            = fp_S + geps_S + heps2_S + heps2_S;
+}
+#endif
+
 #if defined UNROLLJ
 /* As add_ener_grp, but for two groups of UNROLLJ/2 stored in
  * a single SIMD register.
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2012,2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -41,7 +41,9 @@
     const real         *shiftvec;
     const real         *x;
     real                facel;
-    int                 n, ci, ci_sh;
+    int                 n, ci;
+    /* ci_sh is unused when there are no exclusion forces nor energies */
+    int gmx_unused      ci_sh;
     int                 ish, ish3;
     gmx_bool            do_LJ, half_LJ, do_coul;
     int                 cjind0, cjind1, cjind;
@@ -104,6 +106,12 @@
     SimdReal beta2_S, beta_S;
 #endif
 
+#if defined CALC_COUL_USERTAB || defined VDW_USERTAB
+    /* User table variables */
+    SimdReal               tab_user_scale_S;
+    const real      *      tab_user;
+#endif
+
 #if defined CALC_ENERGIES && (defined CALC_COUL_EWALD || defined CALC_COUL_TAB)
     SimdReal  sh_ewald_S;
 #endif
@@ -246,8 +254,13 @@
     sh_ewald_S = SimdReal(ic->sh_ewald);
 #endif
 
+#if defined CALC_COUL_USERTAB || defined VDW_USERTAB
+    tab_user_scale_S = SimdReal(ic->tab_user_scale);
+    tab_user         = ic->tab_user;
+#endif
+
     /* LJ function constants */
-#if defined CALC_ENERGIES || defined LJ_POT_SWITCH
+#if (defined CALC_ENERGIES && !defined VDW_USERTAB) || defined LJ_POT_SWITCH
     SimdReal sixth_S      = SimdReal(1.0/6.0);
     SimdReal twelveth_S   = SimdReal(1.0/12.0);
 #endif
@@ -436,6 +449,10 @@
                 /* beta/sqrt(pi) */
                 Vc_sub_self = 0.5*ic->ewaldcoeff_q*M_2_SQRTPI;
 #endif
+#ifdef CALC_COUL_USERTAB
+                /* User tables have no self or exclusion correction */
+                Vc_sub_self = 0;
+#endif
 
                 for (ia = 0; ia < UNROLLI; ia++)
                 {
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2013,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2012,2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -85,30 +85,42 @@ nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJ_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJFSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJPSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJEwCombGeom_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecRF_VdwUserTab_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJCombGeom_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJCombLB_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJ_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJFSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJPSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJEwCombGeom_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwUserTab_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombGeom_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombLB_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJ_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJFSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJPSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJEwCombGeom_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwUserTab_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJCombGeom_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJCombLB_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJ_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJFSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJPSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJEwCombGeom_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecEw_VdwUserTab_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJCombGeom_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJCombLB_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJ_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJFSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJPSw_VgrpF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJEwCombGeom_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwUserTab_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJCombGeom_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJCombLB_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJ_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJFSw_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJPSw_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJEwCombGeom_VgrpF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwUserTab_VgrpF_4xn;
 
 nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJCombGeom_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJCombLB_VF_4xn;
@@ -116,30 +128,42 @@ nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJ_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJFSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJPSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecRF_VdwLJEwCombGeom_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecRF_VdwUserTab_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJCombGeom_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJCombLB_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJ_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJFSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJPSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwLJEwCombGeom_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecQSTab_VdwUserTab_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombGeom_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombLB_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJ_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJFSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJPSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwLJEwCombGeom_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecQSTabTwinCut_VdwUserTab_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJCombGeom_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJCombLB_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJ_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJFSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJPSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEw_VdwLJEwCombGeom_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecEw_VdwUserTab_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJCombGeom_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJCombLB_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJ_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJFSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJPSw_VF_4xn;
 nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwLJEwCombGeom_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecEwTwinCut_VdwUserTab_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJCombGeom_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJCombLB_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJ_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJFSw_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJPSw_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwLJEwCombGeom_VF_4xn;
+nbk_func_ener         nbnxn_kernel_ElecUserTab_VdwUserTab_VF_4xn;
 
 nbk_func_noener       nbnxn_kernel_ElecRF_VdwLJCombGeom_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecRF_VdwLJCombLB_F_4xn;
@@ -147,27 +171,41 @@ nbk_func_noener       nbnxn_kernel_ElecRF_VdwLJ_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecRF_VdwLJFSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecRF_VdwLJPSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecRF_VdwLJEwCombGeom_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecRF_VdwUserTab_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTab_VdwLJCombGeom_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTab_VdwLJCombLB_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTab_VdwLJ_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTab_VdwLJFSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTab_VdwLJPSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTab_VdwLJEwCombGeom_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecQSTab_VdwUserTab_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombGeom_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTabTwinCut_VdwLJCombLB_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTabTwinCut_VdwLJ_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTabTwinCut_VdwLJFSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTabTwinCut_VdwLJPSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecQSTabTwinCut_VdwLJEwCombGeom_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecQSTabTwinCut_VdwUserTab_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEw_VdwLJCombGeom_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEw_VdwLJCombLB_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEw_VdwLJ_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEw_VdwLJFSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEw_VdwLJPSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEw_VdwLJEwCombGeom_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecEw_VdwUserTab_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEwTwinCut_VdwLJCombGeom_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEwTwinCut_VdwLJCombLB_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEwTwinCut_VdwLJ_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEwTwinCut_VdwLJFSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEwTwinCut_VdwLJPSw_F_4xn;
 nbk_func_noener       nbnxn_kernel_ElecEwTwinCut_VdwLJEwCombGeom_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecEwTwinCut_VdwUserTab_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecUserTab_VdwLJCombGeom_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecUserTab_VdwLJCombLB_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecUserTab_VdwLJ_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecUserTab_VdwLJFSw_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecUserTab_VdwLJPSw_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecUserTab_VdwLJEwCombGeom_F_4xn;
+nbk_func_noener       nbnxn_kernel_ElecUserTab_VdwUserTab_F_4xn;
+
+
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2013,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2012,2013,2014,2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -91,6 +91,29 @@ static gmx_inline void add_ener_grp(SimdReal e_S, real *v, const int *offset_jj)
 }
 #endif
 
+#if defined CALC_COUL_USERTAB || defined VDW_USERTAB
+/* Interpolate one function of the user cubic spline table, which stores
+ * Y, F, G, H for Coulomb, dispersion and repulsion, so with stride 12.
+ * Returns the potential in v_S and its derivative with respect to
+ * the scaled distance in dv_S.
+ */
+static gmx_inline void gmx_simdcall
+gmx_load_user_table(const real *tab, SimdInt32 ti_S, SimdReal frac_S,
+                    SimdReal *v_S, SimdReal *dv_S)
+{
+    SimdReal y_S, f_S, g_S, h_S;
+
+    gatherLoadBySimdIntTranspose<12>(tab, ti_S, &y_S, &f_S, &g_S, &h_S);
+
+    SimdReal geps_S  = frac_S * g_S;
+    SimdReal heps2_S = frac_S * frac_S * h_S;
+    SimdReal fp_S    = f_S + geps_S + heps2_S;
+
+    *v_S             = fma(frac_S, fp_S, y_S);
+    *dv_S            = fp_S + geps_S + heps2_S + heps2_S;
+}
+#endif
+
 #if GMX_SIMD_HAVE_INT32_LOGICAL
 typedef SimdInt32    SimdBitMask;
 #else
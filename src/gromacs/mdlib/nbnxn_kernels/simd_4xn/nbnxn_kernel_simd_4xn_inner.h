@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2012,2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -50,8 +50,10 @@
  * But when energies and/or virial is required we calculate them
  * separately to as then it is easier to separate the energy and virial
  * contributions.
+ * User tables have no exclusion correction, so with user tables
+ * we only need exclusion forces for LJ-PME.
  */
-#if defined CHECK_EXCLS && (defined CALC_COULOMB || defined LJ_EWALD_GEOM)
+#if defined CHECK_EXCLS && ((defined CALC_COULOMB && !defined CALC_COUL_USERTAB) || defined LJ_EWALD_GEOM)
 #define EXCL_FORCES
 #endif
 
@@ -101,15 +103,25 @@
 #endif
 #endif
 
-#if (defined CALC_COULOMB && defined CALC_COUL_TAB) || defined LJ_FORCE_SWITCH || defined LJ_POT_SWITCH
+#if (defined CALC_COULOMB && defined CALC_COUL_TAB) || defined LJ_FORCE_SWITCH || defined LJ_POT_SWITCH || (defined CALC_COULOMB && defined CALC_COUL_USERTAB) || defined VDW_USERTAB
     SimdReal r_S0;
     SimdReal r_S1;
-#if (defined CALC_COULOMB && defined CALC_COUL_TAB) || !defined HALF_LJ
+#if (defined CALC_COULOMB && defined CALC_COUL_TAB) || !defined HALF_LJ || (defined CALC_COULOMB && defined CALC_COUL_USERTAB) || defined VDW_USERTAB
     SimdReal r_S2;
     SimdReal r_S3;
 #endif
 #endif
 
+#if (defined CALC_COULOMB && defined CALC_COUL_USERTAB) || defined VDW_USERTAB
+    /* For user tables: rs=r*scale, frac=rs-floor(rs), mrs=-rs for F*r */
+    SimdReal   rsu_S0, fracu_S0, mrsu_S0;
+    SimdReal   rsu_S1, fracu_S1, mrsu_S1;
+    SimdReal   rsu_S2, fracu_S2, mrsu_S2;
+    SimdReal   rsu_S3, fracu_S3, mrsu_S3;
+    /* User table index: rs truncated to an int */
+    SimdInt32  tiu_S0, tiu_S1, tiu_S2, tiu_S3;
+#endif
+
 #if defined LJ_FORCE_SWITCH || defined LJ_POT_SWITCH
     SimdReal  rsw_S0, rsw2_S0;
     SimdReal  rsw_S1, rsw2_S1;
@@ -143,6 +155,13 @@
     SimdReal  brsq_S0, brsq_S1, brsq_S2, brsq_S3;
     SimdReal  ewcorr_S0, ewcorr_S1, ewcorr_S2, ewcorr_S3;
 #endif
+#ifdef CALC_COUL_USERTAB
+    /* User table potential and its derivative with respect to rs */
+    SimdReal  vctab_S0, dvctab_S0;
+    SimdReal  vctab_S1, dvctab_S1;
+    SimdReal  vctab_S2, dvctab_S2;
+    SimdReal  vctab_S3, dvctab_S3;
+#endif
 
     /* frcoul = (1/r - fsub)*r */
     SimdReal  frcoul_S0;
@@ -222,7 +241,7 @@
 #endif
 
     /* Intermediate variables for LJ calculation */
-#ifndef LJ_COMB_LB
+#if !defined LJ_COMB_LB && !defined VDW_USERTAB
     SimdReal  rinvsix_S0;
     SimdReal  rinvsix_S1;
 #ifndef HALF_LJ
@@ -239,12 +258,28 @@
 #endif
 #endif
 
+#ifdef VDW_USERTAB
+    /* User dispersion and repulsion table potentials and derivatives */
+    SimdReal  vdtab_S0, dvdtab_S0, vrtab_S0, dvrtab_S0;
+    SimdReal  vdtab_S1, dvdtab_S1, vrtab_S1, dvrtab_S1;
+#ifndef HALF_LJ
+    SimdReal  vdtab_S2, dvdtab_S2, vrtab_S2, dvrtab_S2;
+    SimdReal  vdtab_S3, dvdtab_S3, vrtab_S3, dvrtab_S3;
+#endif
+    SimdReal  frLJ_S0;
+    SimdReal  frLJ_S1;
+#ifndef HALF_LJ
+    SimdReal  frLJ_S2;
+    SimdReal  frLJ_S3;
+#endif
+#else
     SimdReal  FrLJ6_S0, FrLJ12_S0, frLJ_S0;
     SimdReal  FrLJ6_S1, FrLJ12_S1, frLJ_S1;
 #ifndef HALF_LJ
     SimdReal  FrLJ6_S2, FrLJ12_S2, frLJ_S2;
     SimdReal  FrLJ6_S3, FrLJ12_S3, frLJ_S3;
 #endif
+#endif
 #endif /* CALC_LJ */
 
     /* j-cluster index */
@@ -464,6 +499,38 @@
     rinvsq_S2   = rinv_S2 * rinv_S2;
     rinvsq_S3   = rinv_S3 * rinv_S3;
 
+#if (defined CALC_COULOMB && defined CALC_COUL_USERTAB) || defined VDW_USERTAB
+    /* Convert r to scaled user table units, r is zero beyond the cut-off */
+    r_S0        = rsq_S0 * rinv_S0;
+    r_S1        = rsq_S1 * rinv_S1;
+    r_S2        = rsq_S2 * rinv_S2;
+    r_S3        = rsq_S3 * rinv_S3;
+    rsu_S0      = r_S0 * tab_user_scale_S;
+    rsu_S1      = r_S1 * tab_user_scale_S;
+    rsu_S2      = r_S2 * tab_user_scale_S;
+    rsu_S3      = r_S3 * tab_user_scale_S;
+    tiu_S0      = cvttR2I(rsu_S0);
+    tiu_S1      = cvttR2I(rsu_S1);
+    tiu_S2      = cvttR2I(rsu_S2);
+    tiu_S3      = cvttR2I(rsu_S3);
+    fracu_S0    = rsu_S0 - trunc(rsu_S0);
+    fracu_S1    = rsu_S1 - trunc(rsu_S1);
+    fracu_S2    = rsu_S2 - trunc(rsu_S2);
+    fracu_S3    = rsu_S3 - trunc(rsu_S3);
+    /* F*r = -dV/dr*r = -dV/drs*rs */
+    mrsu_S0     = zero_S - rsu_S0;
+    mrsu_S1     = zero_S - rsu_S1;
+    mrsu_S2     = zero_S - rsu_S2;
+    mrsu_S3     = zero_S - rsu_S3;
+#ifdef EXCL_FORCES
+    /* Excluded pairs are still in the list here, remove their table forces */
+    mrsu_S0     = selectByMask(mrsu_S0, interact_S0);
+    mrsu_S1     = selectByMask(mrsu_S1, interact_S1);
+    mrsu_S2     = selectByMask(mrsu_S2, interact_S2);
+    mrsu_S3     = selectByMask(mrsu_S3, interact_S3);
+#endif
+#endif
+
 #ifdef CALC_COULOMB
     /* Note that here we calculate force*r, not the usual force/r.
      * This allows avoiding masking the reaction-field contribution,
@@ -612,6 +679,31 @@
 #endif
 #endif /* CALC_COUL_TAB */
 
+#ifdef CALC_COUL_USERTAB
+    /* Electrostatic interactions from the user table */
+    gmx_load_user_table(tab_user, tiu_S0, fracu_S0, &vctab_S0, &dvctab_S0);
+    gmx_load_user_table(tab_user, tiu_S1, fracu_S1, &vctab_S1, &dvctab_S1);
+    gmx_load_user_table(tab_user, tiu_S2, fracu_S2, &vctab_S2, &dvctab_S2);
+    gmx_load_user_table(tab_user, tiu_S3, fracu_S3, &vctab_S3, &dvctab_S3);
+    frcoul_S0   = qq_S0 * (dvctab_S0 * mrsu_S0);
+    frcoul_S1   = qq_S1 * (dvctab_S1 * mrsu_S1);
+    frcoul_S2   = qq_S2 * (dvctab_S2 * mrsu_S2);
+    frcoul_S3   = qq_S3 * (dvctab_S3 * mrsu_S3);
+
+#ifdef CALC_ENERGIES
+#ifdef EXCL_FORCES
+    vctab_S0    = selectByMask(vctab_S0, interact_S0);
+    vctab_S1    = selectByMask(vctab_S1, interact_S1);
+    vctab_S2    = selectByMask(vctab_S2, interact_S2);
+    vctab_S3    = selectByMask(vctab_S3, interact_S3);
+#endif
+    vcoul_S0    = qq_S0 * vctab_S0;
+    vcoul_S1    = qq_S1 * vctab_S1;
+    vcoul_S2    = qq_S2 * vctab_S2;
+    vcoul_S3    = qq_S3 * vctab_S3;
+#endif
+#endif /* CALC_COUL_USERTAB */
+
 #if defined CALC_ENERGIES && (defined CALC_COUL_EWALD || defined CALC_COUL_TAB)
 #ifndef NO_SHIFT_EWALD
     /* Add Ewald potential shift to vc_sub for convenience */
@@ -663,7 +755,7 @@
 #define     wco_vdw_S3    wco_S3
 #endif
 
-#ifndef LJ_COMB_LB
+#if !defined LJ_COMB_LB && !defined VDW_USERTAB
     rinvsix_S0  = rinvsq_S0 * rinvsq_S0 * rinvsq_S0;
     rinvsix_S1  = rinvsq_S1 * rinvsq_S1 * rinvsq_S1;
 #ifdef EXCL_FORCES
@@ -735,7 +827,7 @@
 #undef gmx_add_fr_switch
 #endif /* LJ_FORCE_SWITCH */
 
-#endif /* not LJ_COMB_LB */
+#endif /* not LJ_COMB_LB and not VDW_USERTAB */
 
 #ifdef LJ_COMB_LB
     sir_S0      = sig_S0 * rinv_S0;
@@ -813,6 +905,39 @@
 #endif
 #endif /* LJ_COMB_LB */
 
+#ifdef VDW_USERTAB
+    /* The user dispersion and repulsion tables are scaled by 1/6 and 1/12,
+     * so they can be multiplied directly with our 6*C6 and 12*C12.
+     */
+    gmx_load_user_table(tab_user + 4, tiu_S0, fracu_S0, &vdtab_S0, &dvdtab_S0);
+    gmx_load_user_table(tab_user + 8, tiu_S0, fracu_S0, &vrtab_S0, &dvrtab_S0);
+    gmx_load_user_table(tab_user + 4, tiu_S1, fracu_S1, &vdtab_S1, &dvdtab_S1);
+    gmx_load_user_table(tab_user + 8, tiu_S1, fracu_S1, &vrtab_S1, &dvrtab_S1);
+#ifndef HALF_LJ
+    gmx_load_user_table(tab_user + 4, tiu_S2, fracu_S2, &vdtab_S2, &dvdtab_S2);
+    gmx_load_user_table(tab_user + 8, tiu_S2, fracu_S2, &vrtab_S2, &dvrtab_S2);
+    gmx_load_user_table(tab_user + 4, tiu_S3, fracu_S3, &vdtab_S3, &dvdtab_S3);
+    gmx_load_user_table(tab_user + 8, tiu_S3, fracu_S3, &vrtab_S3, &dvrtab_S3);
+#endif
+
+    /* Determine the total scalar LJ force*r */
+    frLJ_S0     = fma(c6_S0, dvdtab_S0, c12_S0 * dvrtab_S0) * mrsu_S0;
+    frLJ_S1     = fma(c6_S1, dvdtab_S1, c12_S1 * dvrtab_S1) * mrsu_S1;
+#ifndef HALF_LJ
+    frLJ_S2     = fma(c6_S2, dvdtab_S2, c12_S2 * dvrtab_S2) * mrsu_S2;
+    frLJ_S3     = fma(c6_S3, dvdtab_S3, c12_S3 * dvrtab_S3) * mrsu_S3;
+#endif
+
+#ifdef CALC_ENERGIES
+    SimdReal VLJ_S0 = fma(c6_S0, vdtab_S0, c12_S0 * vrtab_S0);
+    SimdReal VLJ_S1 = fma(c6_S1, vdtab_S1, c12_S1 * vrtab_S1);
+#ifndef HALF_LJ
+    SimdReal VLJ_S2 = fma(c6_S2, vdtab_S2, c12_S2 * vrtab_S2);
+    SimdReal VLJ_S3 = fma(c6_S3, vdtab_S3, c12_S3 * vrtab_S3);
+#endif
+#endif
+#else /* VDW_USERTAB */
+
     /* Determine the total scalar LJ force*r */
     frLJ_S0     = FrLJ12_S0 - FrLJ6_S0;
     frLJ_S1     = FrLJ12_S1 - FrLJ6_S1;
@@ -820,6 +945,7 @@
     frLJ_S2     = FrLJ12_S2 - FrLJ6_S2;
     frLJ_S3     = FrLJ12_S3 - FrLJ6_S3;
 #endif
+#endif /* VDW_USERTAB */
 
 #if (defined LJ_CUT || defined LJ_FORCE_SWITCH) && defined CALC_ENERGIES
 
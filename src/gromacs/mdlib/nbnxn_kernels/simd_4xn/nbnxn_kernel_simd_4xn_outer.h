@@ -41,7 +41,9 @@
     const real         *shiftvec;
     const real         *x;
     real                facel;
-    int                 n, ci, ci_sh;
+    int                 n, ci;
+    /* ci_sh is unused when there are no exclusion forces nor energies */
+    int gmx_unused      ci_sh;
     int                 ish, ish3;
     gmx_bool            do_LJ, half_LJ, do_coul;
     int                 cjind0, cjind1, cjind;
@@ -113,6 +115,12 @@
     SimdReal beta2_S, beta_S;
 #endif
 
+#if defined CALC_COUL_USERTAB || defined VDW_USERTAB
+    /* User table variables */
+    SimdReal               tab_user_scale_S;
+    const real      *      tab_user;
+#endif
+
 #if defined CALC_ENERGIES && (defined CALC_COUL_EWALD || defined CALC_COUL_TAB)
     SimdReal  sh_ewald_S;
 #endif
@@ -267,8 +275,13 @@
     sh_ewald_S = SimdReal(ic->sh_ewald);
 #endif
 
+#if defined CALC_COUL_USERTAB || defined VDW_USERTAB
+    tab_user_scale_S = SimdReal(ic->tab_user_scale);
+    tab_user         = ic->tab_user;
+#endif
+
     /* LJ function constants */
-#if defined CALC_ENERGIES || defined LJ_POT_SWITCH
+#if (defined CALC_ENERGIES && !defined VDW_USERTAB) || defined LJ_POT_SWITCH
     SimdReal sixth_S(1.0/6.0);
     SimdReal twelveth_S(1.0/12.0);
 #endif
@@ -463,6 +476,10 @@
                 /* beta/sqrt(pi) */
                 Vc_sub_self = 0.5*ic->ewaldcoeff_q*M_2_SQRTPI;
 #endif
+#ifdef CALC_COUL_USERTAB
+                /* User tables have no self or exclusion correction */
+                Vc_sub_self = 0;
+#endif
 
                 for (ia = 0; ia < UNROLLI; ia++)
                 {
@@ -830,6 +830,13 @@ static void nbnxn_init_pairlist(nbnxn_pairlist_t *nbl,
     nbl->cj4         = nullptr;
     nbl->nci_tot     = 0;
 
+    nbl->nciOuter       = -1;
+    nbl->ciOuter        = nullptr;
+    nbl->ciOuter_nalloc = 0;
+    nbl->ncjOuter       = 0;
+    nbl->cjOuter        = nullptr;
+    nbl->cjOuter_nalloc = 0;
+
     if (!nbl->bSimple)
     {
         GMX_ASSERT(c_nbnxnGpuNumClusterPerSupercluster == c_gpuNumClusterPerCell, "The search code assumes that the a super-cluster matches a search grid cell");
@@ -884,6 +891,8 @@ void nbnxn_init_pairlist_set(nbnxn_pairlist_set_t *nbl_list,
 
     nbl_list->nnbl = gmx_omp_nthreads_get(emntNonbonded);
 
+    nbl_list->outerListCreationStep = -1;
+
     if (!nbl_list->bCombined &&
         nbl_list->nnbl > NBNXN_BUFFERFLAG_MAX_THREADS)
     {
@@ -1277,6 +1286,43 @@ static void make_cluster_list_simple(const nbnxn_grid_t *gridj,
     }
 }
 
+/* Plain C code for pruning the outer j-cluster list range
+ * cj_ind_start to cj_ind_end of an i-cluster, with PBC shifted
+ * i-cluster coordinates set by icell_set_x_simple, into nbl.
+ * Only cluster pairs with at least one atom pair within sqrt(rl2) are kept.
+ */
+static void prune_cluster_list_simple(const nbnxn_cj_t *cjOuter,
+                                      int cj_ind_start, int cj_ind_end,
+                                      nbnxn_pairlist_t *nbl,
+                                      int stride, const real *x_j,
+                                      real rl2)
+{
+    const real *x_ci = nbl->work->x_ci;
+
+    for (int cjind = cj_ind_start; cjind < cj_ind_end; cjind++)
+    {
+        int      cj      = cjOuter[cjind].cj;
+        gmx_bool InRange = FALSE;
+
+        for (int i = 0; i < NBNXN_CPU_CLUSTER_I_SIZE && !InRange; i++)
+        {
+            for (int j = 0; j < NBNXN_CPU_CLUSTER_I_SIZE; j++)
+            {
+                int aj = cj*NBNXN_CPU_CLUSTER_I_SIZE + j;
+
+                InRange = InRange ||
+                    (gmx::square(x_ci[i*STRIDE_XYZ+XX] - x_j[aj*stride+XX]) +
+                     gmx::square(x_ci[i*STRIDE_XYZ+YY] - x_j[aj*stride+YY]) +
+                     gmx::square(x_ci[i*STRIDE_XYZ+ZZ] - x_j[aj*stride+ZZ]) < rl2);
+            }
+        }
+        if (InRange)
+        {
+            nbl->cj[nbl->ncj++] = cjOuter[cjind];
+        }
+    }
+}
+
 #ifdef GMX_NBNXN_SIMD_4XN
 #include "gromacs/mdlib/nbnxn_search_simd_4xn.h"
 #endif
@@ -2926,13 +2972,14 @@ static void balance_fep_lists(const nbnxn_search_t  nbs,
 
             /* Note that here we allocate for the total size, instead of
              * a per-thread esimate (which is hard to obtain).
+             * Splitting i-entries adds at most nnbl - 1 entries.
              */
-            if (nri_tot > nbl->maxnri)
+            if (nri_tot + nnbl > nbl->maxnri)
             {
-                nbl->maxnri = over_alloc_large(nri_tot);
+                nbl->maxnri = over_alloc_large(nri_tot + nnbl);
                 reallocate_nblist(nbl);
             }
-            if (nri_tot > nbl->maxnri || nrj_tot > nbl->maxnrj)
+            if (nri_tot + nnbl > nbl->maxnri || nrj_tot > nbl->maxnrj)
             {
                 nbl->maxnrj = over_alloc_small(nrj_tot);
                 srenew(nbl->jjnr, nbl->maxnrj);
@@ -2944,7 +2991,12 @@ static void balance_fep_lists(const nbnxn_search_t  nbs,
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
 
-    /* Loop over the source lists and assign and copy i-entries */
+    /* Loop over the source lists and assign and copy i-entries.
+     * A perturbed i-atom can have a long list of j-atoms, so to obtain
+     * an even distribution of the pairs, we split i-entries at the point
+     * where a destination list reaches the target size. This is allowed,
+     * since the free-energy kernel reduces the i-forces with atomics.
+     */
     th_dest = 0;
     nbld    = nbs->work[th_dest].nbl_fep;
     for (int th = 0; th < nnbl; th++)
@@ -2955,33 +3007,40 @@ static void balance_fep_lists(const nbnxn_search_t  nbs,
 
         for (int i = 0; i < nbls->nri; i++)
         {
-            int nrj;
-
-            /* The number of pairs in this i-entry */
-            nrj = nbls->jindex[i+1] - nbls->jindex[i];
+            int j, jEnd;
 
-            /* Decide if list th_dest is too large and we should procede
-             * to the next destination list.
-             */
-            if (th_dest+1 < nnbl && nbld->nrj > 0 &&
-                nbld->nrj + nrj - nrj_target > nrj_target - nbld->nrj)
+            j    = nbls->jindex[i];
+            jEnd = nbls->jindex[i+1];
+            while (j < jEnd)
             {
-                th_dest++;
-                nbld = nbs->work[th_dest].nbl_fep;
-            }
+                int jEndDest;
 
-            nbld->iinr[nbld->nri]  = nbls->iinr[i];
-            nbld->gid[nbld->nri]   = nbls->gid[i];
-            nbld->shift[nbld->nri] = nbls->shift[i];
+                /* Procede to the next destination list when this one is full */
+                if (th_dest+1 < nnbl && nbld->nrj >= nrj_target)
+                {
+                    th_dest++;
+                    nbld = nbs->work[th_dest].nbl_fep;
+                }
 
-            for (int j = nbls->jindex[i]; j < nbls->jindex[i+1]; j++)
-            {
-                nbld->jjnr[nbld->nrj]     = nbls->jjnr[j];
-                nbld->excl_fep[nbld->nrj] = nbls->excl_fep[j];
-                nbld->nrj++;
+                jEndDest = jEnd;
+                if (th_dest+1 < nnbl)
+                {
+                    jEndDest = std::min(jEnd, j + nrj_target - nbld->nrj);
+                }
+
+                nbld->iinr[nbld->nri]  = nbls->iinr[i];
+                nbld->gid[nbld->nri]   = nbls->gid[i];
+                nbld->shift[nbld->nri] = nbls->shift[i];
+
+                for (; j < jEndDest; j++)
+                {
+                    nbld->jjnr[nbld->nrj]     = nbls->jjnr[j];
+                    nbld->excl_fep[nbld->nrj] = nbls->excl_fep[j];
+                    nbld->nrj++;
+                }
+                nbld->nri++;
+                nbld->jindex[nbld->nri] = nbld->nrj;
             }
-            nbld->nri++;
-            nbld->jindex[nbld->nri] = nbld->nrj;
         }
     }
 
@@ -4385,3 +4444,111 @@ void nbnxn_make_pairlist(const nbnxn_search_t  nbs,
         }
     }
 }
+
+void nbnxn_set_outer_pairlist(nbnxn_pairlist_set_t *nbl_list,
+                              gmx_int64_t           step)
+{
+    GMX_RELEASE_ASSERT(nbl_list->bSimple, "Dynamic pruning is only implemented for simple pair lists");
+
+    for (int th = 0; th < nbl_list->nnbl; th++)
+    {
+        nbnxn_pairlist_t *nbl = nbl_list->nbl[th];
+
+        /* Swap the buffers, the old outer buffers are reused for the inner list */
+        std::swap(nbl->ci, nbl->ciOuter);
+        std::swap(nbl->ci_nalloc, nbl->ciOuter_nalloc);
+        std::swap(nbl->cj, nbl->cjOuter);
+        std::swap(nbl->cj_nalloc, nbl->cjOuter_nalloc);
+        nbl->nciOuter = nbl->nci;
+        nbl->ncjOuter = nbl->ncj;
+
+        nbl->nci      = 0;
+        nbl->ncj      = 0;
+        nbl->ncjInUse = 0;
+    }
+
+    nbl_list->outerListCreationStep = step;
+}
+
+void nbnxn_prune_pairlist(nbnxn_pairlist_set_t   *nbl_list,
+                          const nbnxn_atomdata_t *nbat,
+                          const rvec             *shift_vec,
+                          real                    rlist_inner,
+                          int                     nb_kernel_type)
+{
+    GMX_RELEASE_ASSERT(nbl_list->bSimple, "Dynamic pruning is only implemented for simple pair lists");
+
+    const real rl2 = rlist_inner*rlist_inner;
+
+#pragma omp parallel for schedule(static) num_threads(nbl_list->nnbl)
+    for (int th = 0; th < nbl_list->nnbl; th++)
+    {
+        try
+        {
+            nbnxn_pairlist_t *nbl = nbl_list->nbl[th];
+
+            GMX_ASSERT(nbl->nciOuter >= 0, "Can only prune a list after an outer list has been set");
+
+            /* The pruned list is never longer than the outer list */
+            nbl->nci      = 0;
+            nbl->ncj      = 0;
+            if (nbl->nciOuter > nbl->ci_nalloc)
+            {
+                nb_realloc_ci(nbl, nbl->nciOuter);
+            }
+            check_cell_list_space_simple(nbl, nbl->ncjOuter);
+
+            for (int i = 0; i < nbl->nciOuter; i++)
+            {
+                const nbnxn_ci_t *ciEntry = &nbl->ciOuter[i];
+                int               ish     = (ciEntry->shift & NBNXN_CI_SHIFT);
+                int               ncj_old = nbl->ncj;
+
+                switch (nb_kernel_type)
+                {
+#ifdef GMX_NBNXN_SIMD_4XN
+                    case nbnxnk4xN_SIMD_4xN:
+                        icell_set_x_simd_4xn(ciEntry->ci,
+                                             shift_vec[ish][XX], shift_vec[ish][YY], shift_vec[ish][ZZ],
+                                             nbat->xstride, nbat->x, nbl->work);
+                        prune_cluster_list_simd_4xn(nbl->cjOuter,
+                                                    ciEntry->cj_ind_start, ciEntry->cj_ind_end,
+                                                    nbl, nbat->x, rl2);
+                        break;
+#endif
+#ifdef GMX_NBNXN_SIMD_2XNN
+                    case nbnxnk4xN_SIMD_2xNN:
+                        icell_set_x_simd_2xnn(ciEntry->ci,
+                                              shift_vec[ish][XX], shift_vec[ish][YY], shift_vec[ish][ZZ],
+                                              nbat->xstride, nbat->x, nbl->work);
+                        prune_cluster_list_simd_2xnn(nbl->cjOuter,
+                                                     ciEntry->cj_ind_start, ciEntry->cj_ind_end,
+                                                     nbl, nbat->x, rl2);
+                        break;
+#endif
+                    case nbnxnk4x4_PlainC:
+                        icell_set_x_simple(ciEntry->ci,
+                                           shift_vec[ish][XX], shift_vec[ish][YY], shift_vec[ish][ZZ],
+                                           nbat->xstride, nbat->x, nbl->work);
+                        prune_cluster_list_simple(nbl->cjOuter,
+                                                  ciEntry->cj_ind_start, ciEntry->cj_ind_end,
+                                                  nbl, nbat->xstride, nbat->x, rl2);
+                        break;
+                    default:
+                        gmx_incons("Dynamic pruning called with an unsupported kernel type");
+                }
+
+                /* Only store i-entries that have j-clusters left */
+                if (nbl->ncj > ncj_old)
+                {
+                    nbl->ci[nbl->nci]              = *ciEntry;
+                    nbl->ci[nbl->nci].cj_ind_start = ncj_old;
+                    nbl->ci[nbl->nci].cj_ind_end   = nbl->ncj;
+                    nbl->nci++;
+                }
+            }
+            nbl->ncjInUse = nbl->ncj;
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+}
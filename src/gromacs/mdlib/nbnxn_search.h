@@ -83,4 +83,23 @@ void nbnxn_make_pairlist(const nbnxn_search_t  nbs,
                          int                   nb_kernel_type,
                          t_nrnb               *nrnb);
 
+/* Moves the simple pair lists just made by nbnxn_make_pairlist
+ * to the outer lists for dynamic pruning and stores the creation step.
+ * The inner lists are empty until nbnxn_prune_pairlist is called.
+ */
+void nbnxn_set_outer_pairlist(nbnxn_pairlist_set_t *nbl_list,
+                              gmx_int64_t           step);
+
+/* Prunes the outer simple pair lists in nbl_list to the inner lists,
+ * keeping only cluster pairs with at least one atom pair within
+ * rlist_inner for the current coordinates in nbat.
+ * This is much cheaper than a search and, as the inner lists
+ * have a smaller buffer, also reduces the non-bonded kernel cost.
+ */
+void nbnxn_prune_pairlist(nbnxn_pairlist_set_t   *nbl_list,
+                          const nbnxn_atomdata_t *nbat,
+                          const rvec             *shift_vec,
+                          real                    rlist_inner,
+                          int                     nb_kernel_type);
+
 #endif
@@ -267,4 +267,59 @@ make_cluster_list_simd_4xn(const nbnxn_grid_t *gridj,
     }
 }
 
+/* SIMD code for pruning the outer j-cluster list range
+ * cj_ind_start to cj_ind_end of an i-cluster, with PBC shifted
+ * i-cluster coordinates set by icell_set_x_simd_4xn, into nbl.
+ * Only cluster pairs with at least one atom pair within sqrt(rl2) are kept.
+ * This is an accelerated version of prune_cluster_list_simple.
+ */
+static gmx_inline void
+prune_cluster_list_simd_4xn(const nbnxn_cj_t *cjOuter,
+                            int cj_ind_start, int cj_ind_end,
+                            nbnxn_pairlist_t *nbl,
+                            const real *x_j,
+                            real rl2)
+{
+    const real *x_ci_simd = nbl->work->x_ci_simd;
+
+    /* The i-cluster coordinates are loaded only once */
+    SimdReal    ix_S0     = load(x_ci_simd +  0*GMX_SIMD_REAL_WIDTH);
+    SimdReal    iy_S0     = load(x_ci_simd +  1*GMX_SIMD_REAL_WIDTH);
+    SimdReal    iz_S0     = load(x_ci_simd +  2*GMX_SIMD_REAL_WIDTH);
+    SimdReal    ix_S1     = load(x_ci_simd +  3*GMX_SIMD_REAL_WIDTH);
+    SimdReal    iy_S1     = load(x_ci_simd +  4*GMX_SIMD_REAL_WIDTH);
+    SimdReal    iz_S1     = load(x_ci_simd +  5*GMX_SIMD_REAL_WIDTH);
+    SimdReal    ix_S2     = load(x_ci_simd +  6*GMX_SIMD_REAL_WIDTH);
+    SimdReal    iy_S2     = load(x_ci_simd +  7*GMX_SIMD_REAL_WIDTH);
+    SimdReal    iz_S2     = load(x_ci_simd +  8*GMX_SIMD_REAL_WIDTH);
+    SimdReal    ix_S3     = load(x_ci_simd +  9*GMX_SIMD_REAL_WIDTH);
+    SimdReal    iy_S3     = load(x_ci_simd + 10*GMX_SIMD_REAL_WIDTH);
+    SimdReal    iz_S3     = load(x_ci_simd + 11*GMX_SIMD_REAL_WIDTH);
+
+    SimdReal    rc2_S     = SimdReal(rl2);
+
+    for (int cjind = cj_ind_start; cjind < cj_ind_end; cjind++)
+    {
+        int      xind = x_ind_cj_simd_4xn(cjOuter[cjind].cj);
+
+        SimdReal jx_S = load(x_j+xind+0*STRIDE_S);
+        SimdReal jy_S = load(x_j+xind+1*STRIDE_S);
+        SimdReal jz_S = load(x_j+xind+2*STRIDE_S);
+
+        /* rsq = dx*dx+dy*dy+dz*dz */
+        SimdReal rsq_S0 = norm2(ix_S0 - jx_S, iy_S0 - jy_S, iz_S0 - jz_S);
+        SimdReal rsq_S1 = norm2(ix_S1 - jx_S, iy_S1 - jy_S, iz_S1 - jz_S);
+        SimdReal rsq_S2 = norm2(ix_S2 - jx_S, iy_S2 - jy_S, iz_S2 - jz_S);
+        SimdReal rsq_S3 = norm2(ix_S3 - jx_S, iy_S3 - jy_S, iz_S3 - jz_S);
+
+        SimdBool wco_any_S01 = (rsq_S0 < rc2_S) || (rsq_S1 < rc2_S);
+        SimdBool wco_any_S23 = (rsq_S2 < rc2_S) || (rsq_S3 < rc2_S);
+
+        if (anyTrue(wco_any_S01 || wco_any_S23))
+        {
+            nbl->cj[nbl->ncj++] = cjOuter[cjind];
+        }
+    }
+}
+
 #undef STRIDE_S
@@ -48,6 +48,7 @@
 #include <cstdint>
 
 #include <array>
+#include <vector>
 
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_struct.h"
@@ -407,6 +408,7 @@ static void do_nb_verlet(t_forcerec *fr,
                          gmx_enerdata_t *enerd,
                          int flags, int ilocality,
                          int clearF,
+                         gmx_int64_t step,
                          t_nrnb *nrnb,
                          gmx_wallcycle_t wcycle)
 {
@@ -414,14 +416,28 @@ static void do_nb_verlet(t_forcerec *fr,
     nonbonded_verlet_group_t  *nbvg;
     gmx_bool                   bUsingGpuKernels;
 
+    nbvg = &fr->nbv->grp[ilocality];
+
+    /* With dynamic pruning we prune the outer list to the inner list
+     * every nstlistPrune steps, starting at the search step.
+     * The inner list is used at subsequent steps, so we also need
+     * to prune when the non-bonded calculation is skipped.
+     */
+    if (fr->nbv->bDynamicPruning &&
+        (step - nbvg->nbl_lists.outerListCreationStep) % fr->nbv->nstlistPrune == 0)
+    {
+        wallcycle_sub_start(wcycle, ewcsNONBONDED_PRUNING);
+        nbnxn_prune_pairlist(&nbvg->nbl_lists, nbvg->nbat, fr->shift_vec,
+                             fr->nbv->rlistInner, nbvg->kernel_type);
+        wallcycle_sub_stop(wcycle, ewcsNONBONDED_PRUNING);
+    }
+
     if (!(flags & GMX_FORCE_NONBONDED))
     {
         /* skip non-bonded calculation */
         return;
     }
 
-    nbvg = &fr->nbv->grp[ilocality];
-
     /* GPU kernel launch overhead is already timed separately */
     if (fr->cutoff_scheme != ecutsVERLET)
     {
@@ -566,7 +582,6 @@ static void do_nb_verlet_fep(nbnxn_pairlist_set_t *nbl_lists,
 {
     int              donb_flags;
     nb_kernel_data_t kernel_data;
-    real             lam_i[efptNR];
     real             dvdl_nb[efptNR];
     int              th;
     int              i, j;
@@ -629,35 +644,40 @@ static void do_nb_verlet_fep(nbnxn_pairlist_set_t *nbl_lists,
 
     /* If we do foreign lambda and we have soft-core interactions
      * we have to recalculate the (non-linear) energies contributions.
+     * The kernel computes the energies at all lambda points in one pass.
      */
     if (fepvals->n_lambda > 0 && (flags & GMX_FORCE_DHDL) && fepvals->sc_alpha != 0)
     {
-        kernel_data.flags          = (donb_flags & ~(GMX_NONBONDED_DO_FORCE | GMX_NONBONDED_DO_SHIFTFORCE)) | GMX_NONBONDED_DO_FOREIGNLAMBDA;
-        kernel_data.lambda         = lam_i;
-        kernel_data.energygrp_elec = enerd->foreign_grpp.ener[egCOULSR];
-        kernel_data.energygrp_vdw  = enerd->foreign_grpp.ener[egLJSR];
-        /* Note that we add to kernel_data.dvdl, but ignore the result */
+        std::vector<real>   lambda_multi(enerd->n_lambda*efptNR);
+        std::vector<double> energy_multi(enerd->n_lambda, 0.0);
 
         for (i = 0; i < enerd->n_lambda; i++)
         {
             for (j = 0; j < efptNR; j++)
             {
-                lam_i[j] = (i == 0 ? lambda[j] : fepvals->all_lambda[j][i-1]);
+                lambda_multi[i*efptNR + j] = (i == 0 ? lambda[j] : fepvals->all_lambda[j][i-1]);
             }
-            reset_foreign_enerdata(enerd);
+        }
+
+        kernel_data.flags          = (donb_flags & ~(GMX_NONBONDED_DO_FORCE | GMX_NONBONDED_DO_SHIFTFORCE)) | GMX_NONBONDED_DO_FOREIGNLAMBDA | GMX_NONBONDED_DO_MULTILAMBDA;
+        kernel_data.nlambda_multi  = enerd->n_lambda;
+        kernel_data.lambda_multi   = lambda_multi.data();
+        kernel_data.energy_multi   = energy_multi.data();
+
 #pragma omp parallel for schedule(static) num_threads(nbl_lists->nnbl)
-            for (th = 0; th < nbl_lists->nnbl; th++)
+        for (th = 0; th < nbl_lists->nnbl; th++)
+        {
+            try
             {
-                try
-                {
-                    gmx_nb_free_energy_kernel(nbl_lists->nbl_fep[th],
-                                              x, f, fr, mdatoms, &kernel_data, nrnb);
-                }
-                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+                gmx_nb_free_energy_kernel(nbl_lists->nbl_fep[th],
+                                          x, f, fr, mdatoms, &kernel_data, nrnb);
             }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+        }
 
-            sum_epot(&(enerd->foreign_grpp), enerd->foreign_term);
-            enerd->enerpart_lambda[i] += enerd->foreign_term[F_EPOT];
+        for (i = 0; i < enerd->n_lambda; i++)
+        {
+            enerd->enerpart_lambda[i] += energy_multi[i];
         }
     }
 
@@ -736,6 +756,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     gmx_bool            bStateChanged, bNS, bFillGrid, bCalcCGCM;
     gmx_bool            bDoForces, bUseGPU, bUseOrEmulGPU;
     gmx_bool            bDiffKernels = FALSE;
+    gmx_bool            bOverlapHaloComm, bMoveXPending = FALSE;
     rvec                vzero, box_diag;
     float               cycles_pme, cycles_force, cycles_wait_gpu;
     /* TODO To avoid loss of precision, float can't be used for a
@@ -773,6 +794,8 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     bDoForces     = (flags & GMX_FORCE_FORCES);
     bUseGPU       = fr->nbv->bUseGPU;
     bUseOrEmulGPU = bUseGPU || (nbv->grp[0].kernel_type == nbnxnk8x8x8_PlainC);
+    /* Overlap the halo communication with the CPU non-bonded and PME work */
+    bOverlapHaloComm = (DOMAINDECOMP(cr) && cr->dd->bOverlapHaloComm);
 
     if (bStateChanged)
     {
@@ -923,6 +946,10 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
                             eintLocal,
                             nbv->grp[eintLocal].kernel_type,
                             nrnb);
+        if (nbv->bDynamicPruning)
+        {
+            nbnxn_set_outer_pairlist(&nbv->grp[eintLocal].nbl_lists, step);
+        }
         wallcycle_sub_stop(wcycle, ewcsNBS_SEARCH_LOCAL);
 
         if (bUseGPU)
@@ -949,7 +976,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         wallcycle_start(wcycle, ewcLAUNCH_GPU_NB);
         /* launch local nonbonded F on GPU */
         do_nb_verlet(fr, ic, enerd, flags, eintLocal, enbvClearFNo,
-                     nrnb, wcycle);
+                     step, nrnb, wcycle);
         wallcycle_stop(wcycle, ewcLAUNCH_GPU_NB);
     }
 
@@ -993,6 +1020,10 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
                                 eintNonlocal,
                                 nbv->grp[eintNonlocal].kernel_type,
                                 nrnb);
+            if (nbv->bDynamicPruning)
+            {
+                nbnxn_set_outer_pairlist(&nbv->grp[eintNonlocal].nbl_lists, step);
+            }
 
             wallcycle_sub_stop(wcycle, ewcsNBS_SEARCH_NONLOCAL);
 
@@ -1005,6 +1036,16 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             }
             wallcycle_stop(wcycle, ewcNS);
         }
+        else if (bOverlapHaloComm)
+        {
+            /* The last coordinate pulse is completed after the local
+             * non-bonded kernel has been called, see below.
+             */
+            wallcycle_start(wcycle, ewcMOVEX);
+            dd_move_x_start(cr->dd, box, x);
+            wallcycle_stop(wcycle, ewcMOVEX);
+            bMoveXPending = TRUE;
+        }
         else
         {
             wallcycle_start(wcycle, ewcMOVEX);
@@ -1024,7 +1065,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             wallcycle_start(wcycle, ewcLAUNCH_GPU_NB);
             /* launch non-local nonbonded F on GPU */
             do_nb_verlet(fr, ic, enerd, flags, eintNonlocal, enbvClearFNo,
-                         nrnb, wcycle);
+                         step, nrnb, wcycle);
             cycles_force += wallcycle_stop(wcycle, ewcLAUNCH_GPU_NB);
         }
     }
@@ -1153,7 +1194,26 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     {
         /* Maybe we should move this into do_force_lowlevel */
         do_nb_verlet(fr, ic, enerd, flags, eintLocal, enbvClearFYes,
-                     nrnb, wcycle);
+                     step, nrnb, wcycle);
+    }
+
+    if (bMoveXPending)
+    {
+        /* Complete the halo coordinate communication that overlapped
+         * with the local non-bonded work.
+         */
+        cycles_force += wallcycle_stop(wcycle, ewcFORCE);
+        wallcycle_start(wcycle, ewcMOVEX);
+        dd_move_x_finish(cr->dd, x);
+        wallcycle_stop(wcycle, ewcMOVEX);
+
+        wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
+        wallcycle_sub_start(wcycle, ewcsNB_X_BUF_OPS);
+        nbnxn_atomdata_copy_x_to_nbat_x(nbv->nbs, eatNonlocal, FALSE, x,
+                                        nbv->grp[eintNonlocal].nbat);
+        wallcycle_sub_stop(wcycle, ewcsNB_X_BUF_OPS);
+        cycles_force += wallcycle_stop(wcycle, ewcNB_XF_BUF_OPS);
+        wallcycle_start_nocount(wcycle, ewcFORCE);
     }
 
     if (fr->efep != efepNO)
@@ -1187,7 +1247,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         {
             do_nb_verlet(fr, ic, enerd, flags, eintNonlocal,
                          bDiffKernels ? enbvClearFYes : enbvClearFNo,
-                         nrnb, wcycle);
+                         step, nrnb, wcycle);
         }
 
         if (!bUseOrEmulGPU)
@@ -1265,7 +1325,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             {
                 wallcycle_start_nocount(wcycle, ewcFORCE);
                 do_nb_verlet(fr, ic, enerd, flags, eintNonlocal, enbvClearFYes,
-                             nrnb, wcycle);
+                             step, nrnb, wcycle);
                 cycles_force += wallcycle_stop(wcycle, ewcFORCE);
             }
             wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
@@ -1295,7 +1355,15 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
 
         /* Communicate the forces */
         wallcycle_start(wcycle, ewcMOVEF);
-        dd_move_f(cr->dd, f, fr->fshift);
+        if (bOverlapHaloComm)
+        {
+            /* The halo force communication was started in do_force_lowlevel */
+            dd_move_f_finish(cr->dd, f, fr->fshift);
+        }
+        else
+        {
+            dd_move_f(cr->dd, f, fr->fshift);
+        }
         wallcycle_stop(wcycle, ewcMOVEF);
     }
 
@@ -1357,7 +1425,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             wallcycle_start_nocount(wcycle, ewcFORCE);
             do_nb_verlet(fr, ic, enerd, flags, eintLocal,
                          DOMAINDECOMP(cr) ? enbvClearFNo : enbvClearFYes,
-                         nrnb, wcycle);
+                         step, nrnb, wcycle);
             wallcycle_stop(wcycle, ewcFORCE);
         }
         wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
@@ -0,0 +1,505 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the free-energy non-bonded kernel used with the Verlet scheme
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxlib/nonbonded/nb_free_energy.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/gmxlib/nonbonded/nb_kernel.h"
+#include "gromacs/gmxlib/nonbonded/nonbonded.h"
+#include "gromacs/math/calculate-ewald-splitting-coefficient.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/mdtypes/nblist.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testasserts.h"
+
+namespace gmx
+{
+
+namespace test
+{
+
+namespace
+{
+
+//! Number of atoms along each dimension of the grid of the test system
+const int c_gridSize[DIM] = { 4, 4, 3 };
+//! Grid spacing of the test system in nm
+const real c_gridSpacing  = 0.3;
+//! Number of perturbed atoms, these are the first atoms of the system
+const int  c_numPerturbed = 8;
+//! Cut-off distance in nm
+const real c_cutoff       = 1.0;
+
+//! The output of one call of the free-energy kernel
+struct KernelOutput
+{
+    //! Total potential energy
+    double            energy;
+    //! dV/dlambda for each lambda component
+    real              dvdl[efptNR];
+    //! Forces
+    std::vector<RVec> f;
+    //! Shift forces
+    std::vector<RVec> fshift;
+};
+
+/*! \brief Test fixture setting up a system with perturbed atoms and
+ * its free-energy pair list, parametrized by the electrostatics type
+ *
+ * The first c_numPerturbed atoms are perturbed. Most of them are
+ * decoupled, i.e. have zero charge and Van der Waals parameters in
+ * state B, which uses soft-core. The last two only change their
+ * parameters, so their pairs do not use soft-core. The pair list contains
+ * all pairs involving a perturbed atom, including the self-pairs, and
+ * some excluded pairs, as the Verlet scheme puts those in the list.
+ */
+class FreeEnergyKernelTest : public ::testing::TestWithParam<int>
+{
+    public:
+        FreeEnergyKernelTest()
+        {
+            const int        numAtoms = c_gridSize[XX]*c_gridSize[YY]*c_gridSize[ZZ];
+            ThreeFry2x64<64> rng(123456, RandomDomain::Other);
+            UniformRealDistribution<real> dist;
+
+            for (int ix = 0; ix < c_gridSize[XX]; ix++)
+            {
+                for (int iy = 0; iy < c_gridSize[YY]; iy++)
+                {
+                    for (int iz = 0; iz < c_gridSize[ZZ]; iz++)
+                    {
+                        RVec x(ix*c_gridSpacing, iy*c_gridSpacing, iz*c_gridSpacing);
+                        for (int d = 0; d < DIM; d++)
+                        {
+                            x[d] += 0.1*(dist(rng) - 0.5);
+                        }
+                        x_.push_back(x);
+                    }
+                }
+            }
+
+            /* Two atom types with LJ and a third without LJ for decoupling */
+            const int  ntype          = 3;
+            const real sigma[ntype]   = { 0.3, 0.25, 0 };
+            const real epsilon[ntype] = { 0.6, 0.4, 0 };
+            for (int ti = 0; ti < ntype; ti++)
+            {
+                for (int tj = 0; tj < ntype; tj++)
+                {
+                    real s6 = gmx::power6(0.5*(sigma[ti] + sigma[tj]));
+                    real e  = std::sqrt(epsilon[ti]*epsilon[tj]);
+                    /* nbfp stores 6*C6 and 12*C12 */
+                    nbfp_.push_back(6*4*e*s6);
+                    nbfp_.push_back(12*4*e*s6*s6);
+                    /* The LJ-PME grid uses geometric combination of C6 */
+                    ljPmeC6Grid_.push_back(6*4*std::sqrt(epsilon[ti]*gmx::power6(sigma[ti])*epsilon[tj]*gmx::power6(sigma[tj])));
+                    ljPmeC6Grid_.push_back(0);
+                }
+            }
+
+            for (int i = 0; i < numAtoms; i++)
+            {
+                chargeA_.push_back((i % 2 == 0 ? 0.5 : -0.5)*(0.5 + dist(rng)));
+                typeA_.push_back(i % 2);
+                if (i < c_numPerturbed - 2)
+                {
+                    chargeB_.push_back(0);
+                    typeB_.push_back(2);
+                }
+                else if (i < c_numPerturbed)
+                {
+                    chargeB_.push_back(-0.5*chargeA_[i]);
+                    typeB_.push_back(1 - typeA_[i]);
+                }
+                else
+                {
+                    chargeB_.push_back(chargeA_[i]);
+                    typeB_.push_back(typeA_[i]);
+                }
+            }
+            md_.chargeA = chargeA_.data();
+            md_.chargeB = chargeB_.data();
+            md_.typeA   = typeA_.data();
+            md_.typeB   = typeB_.data();
+
+            jindex_.push_back(0);
+            for (int i = 0; i < numAtoms; i++)
+            {
+                for (int j = i; j < numAtoms; j++)
+                {
+                    if (i < c_numPerturbed || j < c_numPerturbed)
+                    {
+                        /* Exclude the self-pair and the next atom along z */
+                        jjnr_.push_back(j);
+                        exclFep_.push_back((j == i || (j == i + 1 && i % 2 == 0)) ? 0 : 1);
+                    }
+                }
+                if (static_cast<int>(jjnr_.size()) > jindex_.back())
+                {
+                    iinr_.push_back(i);
+                    shift_.push_back(CENTRAL);
+                    gid_.push_back(0);
+                    jindex_.push_back(jjnr_.size());
+                }
+            }
+            nlist_.nri      = iinr_.size();
+            nlist_.nrj      = jjnr_.size();
+            nlist_.iinr     = iinr_.data();
+            nlist_.jindex   = jindex_.data();
+            nlist_.jjnr     = jjnr_.data();
+            nlist_.shift    = shift_.data();
+            nlist_.gid      = gid_.data();
+            nlist_.excl_fep = exclFep_.data();
+            nlist_.ielec    = GMX_NBKERNEL_ELEC_REACTIONFIELD;
+            nlist_.ivdw     = GMX_NBKERNEL_VDW_LENNARDJONES;
+
+            ic_.cutoff_scheme    = ecutsVERLET;
+            ic_.eeltype          = GetParam();
+            ic_.vdwtype          = evdwCUT;
+            ic_.coulomb_modifier = eintmodPOTSHIFT;
+            ic_.vdw_modifier     = eintmodPOTSHIFT;
+            ic_.rcoulomb         = c_cutoff;
+            ic_.rvdw             = c_cutoff;
+            ic_.epsfac           = ONE_4PI_EPS0;
+            ic_.sh_invrc6        = 1/gmx::power6(c_cutoff);
+            if (EEL_RF(ic_.eeltype))
+            {
+                const real epsilonRF = 78;
+                ic_.k_rf = (epsilonRF - 1)/((2*epsilonRF + 1)*gmx::power3(c_cutoff));
+                ic_.c_rf = 1/c_cutoff + ic_.k_rf*c_cutoff*c_cutoff;
+            }
+            else
+            {
+                ic_.ewaldcoeff_q = calc_ewaldcoeff_q(c_cutoff, 1e-5);
+                ic_.sh_ewald     = std::erfc(ic_.ewaldcoeff_q*c_cutoff)/c_cutoff;
+                init_interaction_const_tables(nullptr, &ic_, c_cutoff);
+            }
+
+            fr_.ic               = &ic_;
+            fr_.cutoff_scheme    = ecutsVERLET;
+            fr_.eeltype          = ic_.eeltype;
+            fr_.coulomb_modifier = ic_.coulomb_modifier;
+            fr_.vdw_modifier     = ic_.vdw_modifier;
+            fr_.rcoulomb         = c_cutoff;
+            fr_.rvdw             = c_cutoff;
+            fr_.epsfac           = ic_.epsfac;
+            fr_.k_rf             = ic_.k_rf;
+            fr_.c_rf             = ic_.c_rf;
+            fr_.ntype            = ntype;
+            fr_.nbfp             = nbfp_.data();
+            fr_.sc_alphacoul     = 0.5;
+            fr_.sc_alphavdw      = 0.5;
+            fr_.sc_power         = 1;
+            fr_.sc_r_power       = 6;
+            fr_.sc_sigma6_def    = gmx::power6(0.3);
+            fr_.sc_sigma6_min    = gmx::power6(0.3);
+            shiftVec_.assign(SHIFTS, RVec(0, 0, 0));
+            fshift_.assign(SHIFTS, RVec(0, 0, 0));
+            fr_.shift_vec        = as_rvec_array(shiftVec_.data());
+            fr_.fshift           = as_rvec_array(fshift_.data());
+        }
+
+        ~FreeEnergyKernelTest()
+        {
+            sfree_aligned(ic_.tabq_coul_FDV0);
+            sfree_aligned(ic_.tabq_coul_F);
+            sfree_aligned(ic_.tabq_coul_V);
+            sfree_aligned(ic_.tabq_vdw_FDV0);
+            sfree_aligned(ic_.tabq_vdw_F);
+            sfree_aligned(ic_.tabq_vdw_V);
+        }
+
+        //! Switches the Van der Waals potential off between 0.8 nm and the cut-off
+        void useVdwPotentialSwitch()
+        {
+            ic_.vdw_modifier = eintmodPOTSWITCH;
+            ic_.rvdw_switch  = 0.8;
+            fr_.vdw_modifier = ic_.vdw_modifier;
+            fr_.rvdw_switch  = ic_.rvdw_switch;
+        }
+
+        //! Uses LJ-PME with geometric combination of C6 on the grid
+        void useLJPme()
+        {
+            ic_.vdwtype         = evdwPME;
+            ic_.ewaldcoeff_lj   = calc_ewaldcoeff_lj(c_cutoff, 1e-3);
+            real crc2           = gmx::square(ic_.ewaldcoeff_lj*c_cutoff);
+            ic_.sh_lj_ewald     = (std::exp(-crc2)*(1 + crc2 + 0.5*crc2*crc2) - 1)/gmx::power6(c_cutoff);
+            init_interaction_const_tables(nullptr, &ic_, c_cutoff);
+            fr_.ewaldcoeff_lj   = ic_.ewaldcoeff_lj;
+            fr_.ljpme_c6grid    = ljPmeC6Grid_.data();
+        }
+
+        //! Sets the soft-core power of r
+        void setSoftCoreRPower(real scRPower)
+        {
+            fr_.sc_r_power = scRPower;
+        }
+
+        //! Returns the kernels to test, the SIMD kernel is only tested when supported
+        static std::vector<bool> kernelTypes()
+        {
+#if GMX_SIMD_HAVE_REAL
+            return { false, true };
+#else
+            return { false };
+#endif
+        }
+
+        //! Returns the energy, forces and dV/dlambda with the chosen kernel
+        KernelOutput runKernel(bool useSimd, real lambdaCoul, real lambdaVdw)
+        {
+            KernelOutput     out;
+            real             lambda[efptNR] = { 0 };
+            real             Vc             = 0;
+            real             Vv             = 0;
+            nb_kernel_data_t kernelData     = {};
+            t_nrnb           nrnb;
+
+            lambda[efptCOUL] = lambdaCoul;
+            lambda[efptVDW]  = lambdaVdw;
+            for (int i = 0; i < efptNR; i++)
+            {
+                out.dvdl[i] = 0;
+            }
+            out.f.assign(x_.size(), RVec(0, 0, 0));
+            fshift_.assign(SHIFTS, RVec(0, 0, 0));
+
+            kernelData.flags          = GMX_NONBONDED_DO_FORCE | GMX_NONBONDED_DO_SHIFTFORCE | GMX_NONBONDED_DO_POTENTIAL;
+            kernelData.lambda         = lambda;
+            kernelData.dvdl           = out.dvdl;
+            kernelData.energygrp_elec = &Vc;
+            kernelData.energygrp_vdw  = &Vv;
+
+            init_nrnb(&nrnb);
+            fr_.use_simd_kernels = useSimd;
+            gmx_nb_free_energy_kernel(&nlist_, as_rvec_array(x_.data()), as_rvec_array(out.f.data()),
+                                      &fr_, &md_, &kernelData, &nrnb);
+
+            out.energy = Vc + Vv;
+            out.fshift = fshift_;
+
+            return out;
+        }
+
+        //! Returns the energies at all \p lambdas with GMX_NONBONDED_DO_MULTILAMBDA
+        std::vector<double> runKernelMultiLambda(bool useSimd, const std::vector<real> &lambdas)
+        {
+            std::vector<real>   lambdaMulti(lambdas.size()*efptNR, 0);
+            std::vector<double> energyMulti(lambdas.size(), 0);
+            std::vector<RVec>   f(x_.size(), RVec(0, 0, 0));
+            real                dvdl[efptNR] = { 0 };
+            nb_kernel_data_t    kernelData   = {};
+            t_nrnb              nrnb;
+
+            for (size_t l = 0; l < lambdas.size(); l++)
+            {
+                lambdaMulti[l*efptNR + efptCOUL] = lambdas[l];
+                lambdaMulti[l*efptNR + efptVDW]  = lambdas[l];
+            }
+
+            kernelData.flags         = GMX_NONBONDED_DO_POTENTIAL | GMX_NONBONDED_DO_FOREIGNLAMBDA | GMX_NONBONDED_DO_MULTILAMBDA;
+            kernelData.lambda        = lambdaMulti.data();
+            kernelData.dvdl          = dvdl;
+            kernelData.nlambda_multi = lambdas.size();
+            kernelData.lambda_multi  = lambdaMulti.data();
+            kernelData.energy_multi  = energyMulti.data();
+
+            init_nrnb(&nrnb);
+            fr_.use_simd_kernels = useSimd;
+            gmx_nb_free_energy_kernel(&nlist_, as_rvec_array(x_.data()), as_rvec_array(f.data()),
+                                      &fr_, &md_, &kernelData, &nrnb);
+
+            return energyMulti;
+        }
+
+        /*! \brief Checks that the multi-lambda energies match single-lambda
+         * calls and that their finite difference matches dV/dlambda */
+        void checkMultiLambdaMatchesSingleLambda()
+        {
+            /* The last two points are used for a finite difference around 0.5 */
+            const std::vector<real> lambdas = { 0, 0.2, 0.5, 0.8, 1, 0.49, 0.51 };
+            const real              dLambda = 0.01;
+
+            for (bool useSimd : kernelTypes())
+            {
+                SCOPED_TRACE(useSimd ? "SIMD kernel" : "generic kernel");
+
+                std::vector<double> energyMulti = runKernelMultiLambda(useSimd, lambdas);
+
+                for (size_t l = 0; l < lambdas.size(); l++)
+                {
+                    KernelOutput ref = runKernel(useSimd, lambdas[l], lambdas[l]);
+
+                    EXPECT_REAL_EQ_TOL(ref.energy, energyMulti[l], relativeToleranceAsFloatingPoint(ref.energy, 1e-5))
+                    << "lambda = " << lambdas[l];
+
+                    if (lambdas[l] == 0.5)
+                    {
+                        real dvdl   = ref.dvdl[efptCOUL] + ref.dvdl[efptVDW];
+                        real dvdlFD = (energyMulti[lambdas.size() - 1] - energyMulti[lambdas.size() - 2])/(2*dLambda);
+                        EXPECT_REAL_EQ_TOL(dvdl, dvdlFD, relativeToleranceAsFloatingPoint(std::abs(ref.energy) + std::abs(dvdl), 1e-3));
+                    }
+                }
+            }
+        }
+
+    private:
+        std::vector<RVec>   x_;
+        std::vector<real>   nbfp_;
+        std::vector<real>   ljPmeC6Grid_;
+        std::vector<real>   chargeA_;
+        std::vector<real>   chargeB_;
+        std::vector<int>    typeA_;
+        std::vector<int>    typeB_;
+        std::vector<int>    iinr_;
+        std::vector<int>    jindex_;
+        std::vector<int>    jjnr_;
+        std::vector<int>    shift_;
+        std::vector<int>    gid_;
+        std::vector<char>   exclFep_;
+        std::vector<RVec>   shiftVec_;
+        std::vector<RVec>   fshift_;
+        t_mdatoms           md_    = {};
+        t_nblist            nlist_ = {};
+        interaction_const_t ic_    = {};
+        t_forcerec          fr_    = {};
+};
+
+TEST_P(FreeEnergyKernelTest, MultiLambdaMatchesSingleLambda)
+{
+    checkMultiLambdaMatchesSingleLambda();
+}
+
+TEST_P(FreeEnergyKernelTest, MultiLambdaMatchesSingleLambdaWithVdwPotentialSwitch)
+{
+    useVdwPotentialSwitch();
+    checkMultiLambdaMatchesSingleLambda();
+}
+
+TEST_P(FreeEnergyKernelTest, MultiLambdaMatchesSingleLambdaWithLJPme)
+{
+    useLJPme();
+    checkMultiLambdaMatchesSingleLambda();
+}
+
+TEST_P(FreeEnergyKernelTest, MultiLambdaMatchesSingleLambdaWithSoftCoreRPower48)
+{
+    setSoftCoreRPower(48);
+    checkMultiLambdaMatchesSingleLambda();
+}
+
+#if GMX_SIMD_HAVE_REAL
+TEST_P(FreeEnergyKernelTest, SimdKernelMatchesGenericKernel)
+{
+    /* Use different lambda values for Coulomb and VdW at the middle points */
+    const real lambdasCoul[] = { 0, 0.3, 0.5, 1 };
+    const real lambdasVdw[]  = { 0, 0.6, 0.5, 1 };
+    /* The generic kernel uses tables for the Ewald correction,
+     * the SIMD kernel an analytical approximation.
+     */
+    const real tolerance     = (GetParam() == eelPME ? 1e-4 : 1e-5);
+
+    for (size_t l = 0; l < sizeof(lambdasCoul)/sizeof(lambdasCoul[0]); l++)
+    {
+        SCOPED_TRACE(formatString("lambda coul %g vdw %g", lambdasCoul[l], lambdasVdw[l]));
+
+        KernelOutput ref  = runKernel(false, lambdasCoul[l], lambdasVdw[l]);
+        KernelOutput simd = runKernel(true, lambdasCoul[l], lambdasVdw[l]);
+
+        real         fMax = 0;
+        for (const RVec &f : ref.f)
+        {
+            fMax = std::max(fMax, norm(f));
+        }
+        FloatingPointTolerance energyTolerance(relativeToleranceAsFloatingPoint(ref.energy, tolerance));
+        FloatingPointTolerance dvdlTolerance(relativeToleranceAsFloatingPoint(std::abs(ref.dvdl[efptCOUL]) + std::abs(ref.dvdl[efptVDW]), tolerance));
+        FloatingPointTolerance forceTolerance(relativeToleranceAsFloatingPoint(fMax, tolerance));
+
+        EXPECT_REAL_EQ_TOL(ref.energy, simd.energy, energyTolerance);
+        EXPECT_REAL_EQ_TOL(ref.dvdl[efptCOUL], simd.dvdl[efptCOUL], dvdlTolerance);
+        EXPECT_REAL_EQ_TOL(ref.dvdl[efptVDW], simd.dvdl[efptVDW], dvdlTolerance);
+        for (size_t i = 0; i < ref.f.size(); i++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(ref.f[i][d], simd.f[i][d], forceTolerance) << "atom " << i;
+            }
+        }
+        for (int s = 0; s < SHIFTS; s++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                EXPECT_REAL_EQ_TOL(ref.fshift[s][d], simd.fshift[s][d], forceTolerance) << "shift " << s;
+            }
+        }
+    }
+}
+#endif
+
+INSTANTIATE_TEST_CASE_P(WithElectrostatics, FreeEnergyKernelTest, ::testing::Values(eelRF, eelPME));
+
+}      // namespace
+
+}      // namespace test
+
+}      // namespace gmx
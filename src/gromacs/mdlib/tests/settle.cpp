@@ -116,6 +116,70 @@ const double g_positions[] = {
 //! Simple cubic simulation box to use in tests
 matrix g_box = {{real(1.86206), 0, 0}, {0, real(1.86206), 0}, {0, 0, real(1.86206)}};
 
+/*! \brief Returns SETTLE data for \p numSettles consecutive waters
+ *
+ * The caller is responsible for calling settle_free().
+ */
+gmx_settledata_t makeSettleData(int numSettles, real dOH, real dHH)
+{
+    const int settleType     = 0;
+    const int atomsPerSettle = NRAL(F_SETTLE);
+
+    // Set up the topology. We still have to make some raw pointers,
+    // but they are put into scope guards for automatic cleanup.
+    gmx_mtop_t                   *mtop;
+    snew(mtop, 1);
+    const unique_cptr<gmx_mtop_t> mtopGuard(mtop);
+    mtop->mols.nr  = 1;
+    mtop->nmoltype = 1;
+    snew(mtop->moltype, mtop->nmoltype);
+    const unique_cptr<gmx_moltype_t> moltypeGuard(mtop->moltype);
+    mtop->nmolblock = 1;
+    snew(mtop->molblock, mtop->nmolblock);
+    const unique_cptr<gmx_molblock_t> molblockGuard(mtop->molblock);
+    mtop->molblock[0].type = 0;
+    std::vector<int>                  iatoms;
+    for (int i = 0; i < numSettles; ++i)
+    {
+        iatoms.push_back(settleType);
+        iatoms.push_back(i*atomsPerSettle+0);
+        iatoms.push_back(i*atomsPerSettle+1);
+        iatoms.push_back(i*atomsPerSettle+2);
+    }
+    mtop->moltype[0].ilist[F_SETTLE].iatoms = iatoms.data();
+    mtop->moltype[0].ilist[F_SETTLE].nr     = iatoms.size();
+
+    // Set up the SETTLE parameters.
+    mtop->ffparams.ntypes = 1;
+    snew(mtop->ffparams.iparams, mtop->ffparams.ntypes);
+    const unique_cptr<t_iparams> iparamsGuard(mtop->ffparams.iparams);
+    mtop->ffparams.iparams[settleType].settle.doh = dOH;
+    mtop->ffparams.iparams[settleType].settle.dhh = dHH;
+
+    // Set up the masses.
+    t_mdatoms         mdatoms;
+    std::vector<real> mass, massReciprocal;
+    const real        oxygenMass = 15.9994, hydrogenMass = 1.008;
+    for (int i = 0; i < numSettles; ++i)
+    {
+        mass.push_back(oxygenMass);
+        mass.push_back(hydrogenMass);
+        mass.push_back(hydrogenMass);
+        massReciprocal.push_back(1./oxygenMass);
+        massReciprocal.push_back(1./hydrogenMass);
+        massReciprocal.push_back(1./hydrogenMass);
+    }
+    mdatoms.massT   = mass.data();
+    mdatoms.invmass = massReciprocal.data();
+    mdatoms.homenr  = numSettles * atomsPerSettle;
+
+    // Finally make the settle data structures
+    gmx_settledata_t settled = settle_init(mtop);
+    settle_set_constraints(settled, &mtop->moltype[0].ilist[F_SETTLE], &mdatoms);
+
+    return settled;
+}
+
 //! Convenience typedef
 typedef std::tuple<int, bool, bool, bool> SettleTestParameters;
 
@@ -190,63 +254,13 @@ TEST_P(SettleTest, SatisfiesConstraints)
                                                useVelocities ? "with " : "without ",
                                                calcVirial ? "" : "not ");
 
-    const int settleType     = 0;
     const int atomsPerSettle = NRAL(F_SETTLE);
     ASSERT_LE(numSettles, updatedPositions_.size() / (atomsPerSettle * DIM)) << "cannot test that many SETTLEs " << testDescription;
 
-    // Set up the topology. We still have to make some raw pointers,
-    // but they are put into scope guards for automatic cleanup.
-    gmx_mtop_t                   *mtop;
-    snew(mtop, 1);
-    const unique_cptr<gmx_mtop_t> mtopGuard(mtop);
-    mtop->mols.nr  = 1;
-    mtop->nmoltype = 1;
-    snew(mtop->moltype, mtop->nmoltype);
-    const unique_cptr<gmx_moltype_t> moltypeGuard(mtop->moltype);
-    mtop->nmolblock = 1;
-    snew(mtop->molblock, mtop->nmolblock);
-    const unique_cptr<gmx_molblock_t> molblockGuard(mtop->molblock);
-    mtop->molblock[0].type = 0;
-    std::vector<int>                  iatoms;
-    for (int i = 0; i < numSettles; ++i)
-    {
-        iatoms.push_back(settleType);
-        iatoms.push_back(i*atomsPerSettle+0);
-        iatoms.push_back(i*atomsPerSettle+1);
-        iatoms.push_back(i*atomsPerSettle+2);
-    }
-    mtop->moltype[0].ilist[F_SETTLE].iatoms = iatoms.data();
-    mtop->moltype[0].ilist[F_SETTLE].nr     = iatoms.size();
-
-    // Set up the SETTLE parameters.
-    mtop->ffparams.ntypes = 1;
-    snew(mtop->ffparams.iparams, mtop->ffparams.ntypes);
-    const unique_cptr<t_iparams> iparamsGuard(mtop->ffparams.iparams);
-    const real                   dOH = 0.09572;
-    const real                   dHH = 0.15139;
-    mtop->ffparams.iparams[settleType].settle.doh = dOH;
-    mtop->ffparams.iparams[settleType].settle.dhh = dHH;
-
-    // Set up the masses.
-    t_mdatoms         mdatoms;
-    std::vector<real> mass, massReciprocal;
-    const real        oxygenMass = 15.9994, hydrogenMass = 1.008;
-    for (int i = 0; i < numSettles; ++i)
-    {
-        mass.push_back(oxygenMass);
-        mass.push_back(hydrogenMass);
-        mass.push_back(hydrogenMass);
-        massReciprocal.push_back(1./oxygenMass);
-        massReciprocal.push_back(1./hydrogenMass);
-        massReciprocal.push_back(1./hydrogenMass);
-    }
-    mdatoms.massT   = mass.data();
-    mdatoms.invmass = massReciprocal.data();
-    mdatoms.homenr  = numSettles * atomsPerSettle;
-
-    // Finally make the settle data structures
-    gmx_settledata_t settled = settle_init(mtop);
-    settle_set_constraints(settled, &mtop->moltype[0].ilist[F_SETTLE], &mdatoms);
+    // Set up the SETTLE data structures
+    const real       dOH     = 0.09572;
+    const real       dHH     = 0.15139;
+    gmx_settledata_t settled = makeSettleData(numSettles, dOH, dHH);
 
     // Copy the original positions from the array of doubles to a vector of reals
     std::vector<real> startingPositions(std::begin(g_positions), std::end(g_positions));
@@ -310,6 +324,80 @@ TEST_P(SettleTest, SatisfiesConstraints)
     }
 }
 
+TEST_P(SettleTest, ProjectsOutConstraintComponents)
+{
+    int  numSettles;
+    bool usePbc, useVelocities, calcVirial;
+    std::tie(numSettles, usePbc, useVelocities, calcVirial) = GetParam();
+    // The projection does not use velocities
+    if (useVelocities)
+    {
+        return;
+    }
+
+    std::string testDescription = formatString("while projecting %d SETTLEs, %sPBC and %scalculating the virial",
+                                               numSettles,
+                                               usePbc ? "with " : "without ",
+                                               calcVirial ? "" : "not ");
+
+    const int        atomsPerSettle = NRAL(F_SETTLE);
+    const real       dOH            = 0.09572;
+    const real       dHH            = 0.15139;
+    gmx_settledata_t settled        = makeSettleData(numSettles, dOH, dHH);
+    const t_pbc     *pbc            = usePbc ? &pbcXYZ_ : &pbcNone_;
+
+    // Generate constrained positions to project on
+    std::vector<real> startingPositions(std::begin(g_positions), std::end(g_positions));
+    bool              errorOccured;
+    tensor            virial = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    csettle(settled, 1, 0, pbc,
+            startingPositions.data(), updatedPositions_.data(), 0,
+            nullptr, false, virial, &errorOccured);
+    ASSERT_FALSE(errorOccured) << testDescription;
+
+    // Use the displacements as velocities, these have components
+    // along all bonds.
+    for (size_t i = 0; i < velocities_.size(); i++)
+    {
+        velocities_[i] = (updatedPositions_[i] - startingPositions[i])/0.002;
+    }
+
+    // Project in place using two threads, called sequentially here
+    const rvec *x          = reinterpret_cast<const rvec *>(updatedPositions_.data());
+    rvec       *v          = reinterpret_cast<rvec *>(velocities_.data());
+    const int   numThreads = 2;
+    for (int thread = 0; thread < numThreads; thread++)
+    {
+        settle_proj(settled, econqVeloc, numThreads, thread,
+                    pbc, x, v, v, calcVirial, virial);
+    }
+    settle_free(settled);
+
+    // The relative velocities should now be perpendicular to all bonds
+    FloatingPointTolerance tolerance = absoluteTolerance(GMX_DOUBLE ? 1e-10 : 1e-4);
+    for (int i = 0; i < numSettles; ++i)
+    {
+        const int atoms[atomsPerSettle] = { i*atomsPerSettle, i*atomsPerSettle + 1, i*atomsPerSettle + 2 };
+        for (int b = 0; b < atomsPerSettle; b++)
+        {
+            const int a1 = atoms[b == 2 ? 1 : 0];
+            const int a2 = atoms[b == 0 ? 1 : 2];
+            rvec      dx, dv;
+            rvec_sub(x[a1], x[a2], dx);
+            rvec_sub(v[a1], v[a2], dv);
+            EXPECT_REAL_EQ_TOL(0, iprod(dx, dv), tolerance) << formatString("for water %d bond %d ", i, b) << testDescription;
+        }
+    }
+
+    for (int d = 0; d < DIM; ++d)
+    {
+        for (int dd = 0; dd < DIM; ++dd)
+        {
+            EXPECT_TRUE(calcVirial == (0. != virial[d][dd])) << formatString("for virial component[%d][%d] ", d, dd) << testDescription;
+        }
+    }
+}
+
 // Scan the full Cartesian product of numbers of SETTLE interactions
 // (4 and 17 are chosen to test cases that do and do not match
 // hardware SIMD widths), and whether or not we use PBC, velocities or
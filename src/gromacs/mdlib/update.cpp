@@ -957,62 +957,71 @@ static void calc_ke_part_normal(rvec v[], t_grpopts *opts, t_mdatoms *md,
     ekind->dekindl_old = ekind->dekindl;
     nthread            = gmx_omp_nthreads_get(emntUpdate);
 
-#pragma omp parallel for num_threads(nthread) schedule(static)
-    for (thread = 0; thread < nthread; thread++)
-    {
-        // This OpenMP only loops over arrays and does not call any functions
-        // or memory allocation. It should not be able to throw, so for now
-        // we do not need a try/catch wrapper.
-        int     start_t, end_t, n;
-        int     ga, gt;
-        rvec    v_corrt;
-        real    hm;
-        int     d, m;
-        matrix *ekin_sum;
-        real   *dekindl_sum;
-
-        start_t = ((thread+0)*md->homenr)/nthread;
-        end_t   = ((thread+1)*md->homenr)/nthread;
-
-        ekin_sum    = ekind->ekin_work[thread];
-        dekindl_sum = ekind->dekindl_work[thread];
-
-        for (gt = 0; gt < opts->ngtc; gt++)
-        {
-            clear_mat(ekin_sum[gt]);
-        }
-        *dekindl_sum = 0.0;
+    /* When the half step kinetic energy was already accumulated in
+     * the work arrays during the update, we only need to reduce it.
+     */
+    bool bUseEkinhWork = (!bEkinAveVel && ekind->bEkinhWorkSet);
+    ekind->bEkinhWorkSet = FALSE;
 
-        ga = 0;
-        gt = 0;
-        for (n = start_t; n < end_t; n++)
+    if (!bUseEkinhWork)
+    {
+#pragma omp parallel for num_threads(nthread) schedule(static)
+        for (thread = 0; thread < nthread; thread++)
         {
-            if (md->cACC)
+            // This OpenMP only loops over arrays and does not call any functions
+            // or memory allocation. It should not be able to throw, so for now
+            // we do not need a try/catch wrapper.
+            int     start_t, end_t, n;
+            int     ga, gt;
+            rvec    v_corrt;
+            real    hm;
+            int     d, m;
+            matrix *ekin_sum;
+            real   *dekindl_sum;
+
+            start_t = ((thread+0)*md->homenr)/nthread;
+            end_t   = ((thread+1)*md->homenr)/nthread;
+
+            ekin_sum    = ekind->ekin_work[thread];
+            dekindl_sum = ekind->dekindl_work[thread];
+
+            for (gt = 0; gt < opts->ngtc; gt++)
             {
-                ga = md->cACC[n];
+                clear_mat(ekin_sum[gt]);
             }
-            if (md->cTC)
-            {
-                gt = md->cTC[n];
-            }
-            hm   = 0.5*md->massT[n];
+            *dekindl_sum = 0.0;
 
-            for (d = 0; (d < DIM); d++)
-            {
-                v_corrt[d]  = v[n][d]  - grpstat[ga].u[d];
-            }
-            for (d = 0; (d < DIM); d++)
+            ga = 0;
+            gt = 0;
+            for (n = start_t; n < end_t; n++)
             {
-                for (m = 0; (m < DIM); m++)
+                if (md->cACC)
                 {
-                    /* if we're computing a full step velocity, v_corrt[d] has v(t).  Otherwise, v(t+dt/2) */
-                    ekin_sum[gt][m][d] += hm*v_corrt[m]*v_corrt[d];
+                    ga = md->cACC[n];
+                }
+                if (md->cTC)
+                {
+                    gt = md->cTC[n];
+                }
+                hm   = 0.5*md->massT[n];
+
+                for (d = 0; (d < DIM); d++)
+                {
+                    v_corrt[d]  = v[n][d]  - grpstat[ga].u[d];
+                }
+                for (d = 0; (d < DIM); d++)
+                {
+                    for (m = 0; (m < DIM); m++)
+                    {
+                        /* if we're computing a full step velocity, v_corrt[d] has v(t).  Otherwise, v(t+dt/2) */
+                        ekin_sum[gt][m][d] += hm*v_corrt[m]*v_corrt[d];
+                    }
+                }
+                if (md->nMassPerturbed && md->bPerturbed[n])
+                {
+                    *dekindl_sum +=
+                        0.5*(md->massB[n] - md->massA[n])*iprod(v_corrt, v_corrt);
                 }
-            }
-            if (md->nMassPerturbed && md->bPerturbed[n])
-            {
-                *dekindl_sum +=
-                    0.5*(md->massB[n] - md->massA[n])*iprod(v_corrt, v_corrt);
             }
         }
     }
@@ -1040,6 +1049,54 @@ static void calc_ke_part_normal(rvec v[], t_grpopts *opts, t_mdatoms *md,
     inc_nrnb(nrnb, eNR_EKIN, md->homenr);
 }
 
+/*! \brief Copies the updated coordinates to \p x and accumulates the half step kinetic energy
+ *
+ * This does the same work per atom as calc_ke_part_normal(), but in
+ * the same pass over the atoms as the final copy of the update, so
+ * the state only streams through memory once. The velocities should
+ * be final, i.e. constrained, and there should be no NEMD groups.
+ */
+static void copyCoordinatesAndCalcEkinh(int                       start,
+                                        int                       end,
+                                        const rvec * gmx_restrict xprime,
+                                        rvec       * gmx_restrict x,
+                                        const rvec * gmx_restrict v,
+                                        const t_mdatoms          *md,
+                                        int                       ngtc,
+                                        tensor                   *ekinSum,
+                                        real                     *dekindlSum)
+{
+    for (int g = 0; g < ngtc; g++)
+    {
+        clear_mat(ekinSum[g]);
+    }
+    *dekindlSum = 0.0;
+
+    int gt = 0;
+    for (int n = start; n < end; n++)
+    {
+        copy_rvec(xprime[n], x[n]);
+
+        if (md->cTC)
+        {
+            gt = md->cTC[n];
+        }
+        real hm = 0.5*md->massT[n];
+
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int m = 0; m < DIM; m++)
+            {
+                ekinSum[gt][m][d] += hm*v[n][m]*v[n][d];
+            }
+        }
+        if (md->nMassPerturbed && md->bPerturbed[n])
+        {
+            *dekindlSum += 0.5*(md->massB[n] - md->massA[n])*iprod(v[n], v[n]);
+        }
+    }
+}
+
 static void calc_ke_part_visc(matrix box, rvec x[], rvec v[],
                               t_grpopts *opts, t_mdatoms *md,
                               gmx_ekindata_t *ekind,
@@ -1359,7 +1416,8 @@ void update_constraints(FILE             *fplog,
                         gmx_update_t     *upd,
                         gmx_constr_t      constr,
                         gmx_bool          bFirstHalf,
-                        gmx_bool          bCalcVir)
+                        gmx_bool          bCalcVir,
+                        gmx_ekindata_t   *ekind)
 {
     gmx_bool             bLastStep, bLog = FALSE, bEner = FALSE, bDoConstr = FALSE;
     tensor               vir_con;
@@ -1556,6 +1614,30 @@ void update_constraints(FILE             *fplog,
                 inc_nrnb(nrnb, eNR_SHIFTX, graph->nnodes);
             }
         }
+        else if (ekind != nullptr && !EI_VV(inputrec->eI) &&
+                 !ekind->bNEMD && ekind->cosacc.cos_accel == 0)
+        {
+            /* The velocities are final, so we can accumulate the half step
+             * kinetic energy for calc_ke_part while we copy the coordinates.
+             */
+            const rvec *xp = as_rvec_array(upd->xp.data());
+            rvec       *x  = as_rvec_array(state->x.data());
+            const rvec *v  = as_rvec_array(state->v.data());
+            nth            = gmx_omp_nthreads_get(emntUpdate);
+#pragma omp parallel for num_threads(nth) schedule(static)
+            for (th = 0; th < nth; th++)
+            {
+                // Only loops over arrays, does not throw
+                int start_th = start + ((nrend-start)* th   )/nth;
+                int end_th   = start + ((nrend-start)*(th+1))/nth;
+
+                copyCoordinatesAndCalcEkinh(start_th, end_th, xp, x, v, md,
+                                            ekind->ngtc,
+                                            ekind->ekin_work[th],
+                                            ekind->dekindl_work[th]);
+            }
+            ekind->bEkinhWorkSet = TRUE;
+        }
         else
         {
             /* The copy is performance sensitive, so use a bare pointer */
@@ -1716,6 +1798,14 @@ void update_coords(FILE             *fplog,
         update_orires_history(fcd, &state->hist);
     }
 
+    /* The velocities change, so any kinetic energy accumulated
+     * during the previous update is no longer valid.
+     */
+    if (ekind != nullptr)
+    {
+        ekind->bEkinhWorkSet = FALSE;
+    }
+
     /* ############# START The update of velocities and positions ######### */
     where();
     dump_it_all(fplog, "Before update",
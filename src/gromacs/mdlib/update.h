@@ -146,9 +146,17 @@ void update_constraints(FILE              *fplog,
                         gmx_update_t      *upd,
                         gmx_constr        *constr,
                         gmx_bool           bFirstHalf,
-                        gmx_bool           bCalcVir);
+                        gmx_bool           bCalcVir,
+                        gmx_ekindata_t    *ekind);
 
-/* Return TRUE if OK, FALSE in case of Shake Error */
+/* Return TRUE if OK, FALSE in case of Shake Error
+ *
+ * When ekind!=NULL, the leap-frog half step kinetic energy of the final
+ * velocities is accumulated in the same pass over the atoms as the final
+ * coordinate copy, so the next call to calc_ke_part only needs to reduce
+ * it. Pass ekind only when calc_ke_part will be called before the next
+ * update, to avoid unnecessary work.
+ */
 
 void calc_ke_part(t_state *state, t_grpopts *opts, t_mdatoms *md,
                   gmx_ekindata_t *ekind, t_nrnb *nrnb, gmx_bool bEkinAveVel);
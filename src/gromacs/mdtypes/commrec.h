@@ -75,12 +75,16 @@ struct gmx_multisim_t {
 #define DUTY_PP  (1<<0)
 #define DUTY_PME (1<<1)
 
+struct gmx_nodecomm_shm_t;
+
 typedef struct {
     int      bUse;
     MPI_Comm comm_intra;
     int      rank_intra;
     MPI_Comm comm_inter;
-
+    /* Shared-memory buffers for the intra-node step of gmx_sumd,
+     * nullptr when not used */
+    struct gmx_nodecomm_shm_t *shm;
 } gmx_nodecomm_t;
 
 struct t_commrec {
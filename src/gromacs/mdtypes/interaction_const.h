@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2012,2013,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2012,2013,2014,2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -129,6 +129,15 @@ typedef struct {
        single precision x86 SIMD for aligned loads */
     real *tabq_vdw_FDV0;
 
+    /* User-supplied Coulomb, dispersion and repulsion tables for the Verlet
+       scheme, as read with the -table option of mdrun.
+       Cubic spline table with entry quadruplets Y, F, G, H for each of
+       the three functions, so stride 12, nullptr when not used.
+       Dispersion and repulsion are scaled by 1/6 and 1/12, respectively,
+       so they can be multiplied directly with the nbnxn C6 and C12. */
+    real  tab_user_scale;
+    real *tab_user;
+
 } interaction_const_t;
 
 #ifdef __cplusplus
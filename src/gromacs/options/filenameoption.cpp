@@ -87,7 +87,8 @@ const FileTypeMapping c_fileTypeMapping[] =
     { eftPDB,         efPDB },
     { eftIndex,       efNDX },
     { eftPlot,        efXVG },
-    { eftGenericData, efDAT }
+    { eftGenericData, efDAT },
+    { eftMatrix,      efXPM }
 };
 
 /********************************************************************
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2010,2011,2012,2015, by the GROMACS development team, led by
+ * Copyright (c) 2010,2011,2012,2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -60,6 +60,7 @@ enum OptionFileType {
     eftIndex,
     eftPlot,
     eftGenericData,
+    eftMatrix,
     eftOptionFileType_NR
 };
 
@@ -43,6 +43,9 @@
 
 #include "selection.h"
 
+#include <cstring>
+
+#include <algorithm>
 #include <string>
 
 #include "gromacs/selection/nbsearch.h"
@@ -51,6 +54,7 @@
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
 #include "gromacs/utility/textwriter.h"
 
@@ -121,6 +125,19 @@ SelectionData::SelectionData(SelectionTreeElement *elem,
 }
 
 
+SelectionData::SelectionData(const SelectionData *other)
+    : name_(other->name_), selectionText_(other->selectionText_),
+      flags_(other->flags_), rootElement_(other->rootElement_),
+      coveredFractionType_(other->coveredFractionType_),
+      coveredFraction_(other->coveredFraction_),
+      averageCoveredFraction_(other->averageCoveredFraction_),
+      bDynamic_(other->bDynamic_),
+      bDynamicCoveredFraction_(other->bDynamicCoveredFraction_)
+{
+    copyEvaluatedState(*other);
+}
+
+
 SelectionData::~SelectionData()
 {
 }
@@ -265,6 +282,55 @@ SelectionData::restoreOriginalPositions(const gmx_mtop_t *top)
     }
 }
 
+
+void
+SelectionData::copyEvaluatedState(const SelectionData &other)
+{
+    const gmx_ana_pos_t &src   = other.rawPositions_;
+    gmx_ana_pos_t       &dest  = rawPositions_;
+    const int            count = src.count();
+    const int            nra   = src.m.mapb.nra;
+    // gmx_ana_pos_copy() is not used, as it can leave the atom indices
+    // pointing to memory that is overwritten by later evaluation.
+    gmx_ana_pos_reserve(&dest, count, 0);
+    if (src.v != nullptr)
+    {
+        gmx_ana_pos_reserve_velocities(&dest);
+    }
+    if (src.f != nullptr)
+    {
+        gmx_ana_pos_reserve_forces(&dest);
+    }
+    std::memcpy(dest.x, src.x, count*sizeof(*dest.x));
+    if (src.v != nullptr)
+    {
+        std::memcpy(dest.v, src.v, count*sizeof(*dest.v));
+    }
+    if (src.f != nullptr)
+    {
+        std::memcpy(dest.f, src.f, count*sizeof(*dest.f));
+    }
+    gmx_ana_indexmap_t &m = dest.m;
+    if (m.mapb.nalloc_a < nra)
+    {
+        srenew(m.mapb.a, nra);
+        m.mapb.nalloc_a = nra;
+    }
+    m.type      = src.m.type;
+    m.bStatic   = src.m.bStatic;
+    m.mapb.nr   = count;
+    m.mapb.nra  = nra;
+    std::copy(src.m.refid, src.m.refid + count, m.refid);
+    std::copy(src.m.mapid, src.m.mapid + count, m.mapid);
+    std::copy(src.m.orgid, src.m.orgid + count, m.orgid);
+    std::copy(src.m.mapb.index, src.m.mapb.index + count + 1, m.mapb.index);
+    std::copy(src.m.mapb.a, src.m.mapb.a + nra, m.mapb.a);
+
+    posMass_         = other.posMass_;
+    posCharge_       = other.posCharge_;
+    coveredFraction_ = other.coveredFraction_;
+}
+
 }   // namespace internal
 
 /********************************************************************
@@ -93,6 +93,18 @@ class SelectionData
          * \throws    std::bad_alloc if out of memory.
          */
         SelectionData(SelectionTreeElement *elem, const char *selstr);
+        /*! \brief
+         * Creates a copy of the evaluated state of another selection.
+         *
+         * \param[in] other  Selection to copy.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * The copy refers to the same evaluation tree as \p other, but it is
+         * not updated when the selections are evaluated; that requires a call
+         * to copyEvaluatedState().  Such copies are used by SelectionSnapshot
+         * to provide thread-local selections.
+         */
+        explicit SelectionData(const SelectionData *other);
         ~SelectionData();
 
         //! Returns the name for this selection.
@@ -186,6 +198,16 @@ class SelectionData
          * Called by SelectionEvaluator::evaluateFinal().
          */
         void restoreOriginalPositions(const gmx_mtop_t *top);
+        /*! \brief
+         * Copies positions and related data for the current frame.
+         *
+         * \param[in] other  Selection to copy the data from.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * All data is copied, such that the result stays valid when \p other
+         * is evaluated for another frame.
+         */
+        void copyEvaluatedState(const SelectionData &other);
 
     private:
         //! Name of the selection.
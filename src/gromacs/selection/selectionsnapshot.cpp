@@ -0,0 +1,135 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::SelectionSnapshot.
+ *
+ * \ingroup module_selection
+ */
+#include "gmxpre.h"
+
+#include "selectionsnapshot.h"
+
+#include <utility>
+#include <vector>
+
+#include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectioncollection.h"
+#include "gromacs/utility/gmxassert.h"
+
+#include "selectioncollection-impl.h"
+
+namespace gmx
+{
+
+/********************************************************************
+ * SelectionSnapshot::Impl
+ */
+
+/*! \internal \brief
+ * Private implementation class for SelectionSnapshot.
+ *
+ * \ingroup module_selection
+ */
+class SelectionSnapshot::Impl
+{
+    public:
+        //! Associates a selection in the collection with its copy.
+        typedef std::pair<internal::SelectionData *, SelectionDataPointer>
+            SelectionCopy;
+
+        //! Copies of the selections, in the order they are in the collection.
+        std::vector<SelectionCopy> copies_;
+};
+
+/********************************************************************
+ * SelectionSnapshot
+ */
+
+SelectionSnapshot::SelectionSnapshot()
+    : impl_(new Impl)
+{
+}
+
+
+SelectionSnapshot::~SelectionSnapshot()
+{
+}
+
+
+void
+SelectionSnapshot::copyFrom(const SelectionCollection &selections)
+{
+    const SelectionDataList &sel = selections.impl_->sc_.sel;
+    if (impl_->copies_.empty())
+    {
+        impl_->copies_.reserve(sel.size());
+        for (const SelectionDataPointer &data : sel)
+        {
+            SelectionDataPointer copy(new internal::SelectionData(data.get()));
+            impl_->copies_.emplace_back(data.get(), std::move(copy));
+        }
+        return;
+    }
+    GMX_RELEASE_ASSERT(impl_->copies_.size() == sel.size(),
+                       "Snapshot updated from a different collection");
+    for (size_t i = 0; i < sel.size(); ++i)
+    {
+        GMX_RELEASE_ASSERT(impl_->copies_[i].first == sel[i].get(),
+                           "Snapshot updated from a different collection");
+        impl_->copies_[i].second->copyEvaluatedState(*sel[i]);
+    }
+}
+
+
+Selection
+SelectionSnapshot::selection(const Selection &selection) const
+{
+    if (!selection.isValid())
+    {
+        return selection;
+    }
+    for (const Impl::SelectionCopy &copy : impl_->copies_)
+    {
+        if (Selection(copy.first) == selection)
+        {
+            return Selection(copy.second.get());
+        }
+    }
+    GMX_RELEASE_ASSERT(false, "Selection is not part of the snapshot");
+    return selection;
+}
+
+} // namespace gmx
@@ -0,0 +1,106 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares gmx::SelectionSnapshot.
+ *
+ * \inlibraryapi
+ * \ingroup module_selection
+ */
+#ifndef GMX_SELECTION_SELECTIONSNAPSHOT_H
+#define GMX_SELECTION_SELECTIONSNAPSHOT_H
+
+#include "gromacs/utility/classhelpers.h"
+
+namespace gmx
+{
+
+class Selection;
+class SelectionCollection;
+
+/*! \libinternal \brief
+ * Private copy of the evaluated selections in a collection.
+ *
+ * SelectionCollection::evaluate() updates the selections in place, so
+ * the selections for one frame cannot be used while the next frame is being
+ * evaluated.  This class keeps a copy of the evaluated state (positions,
+ * atom indices, masses, charges and the covered fraction) of all selections
+ * in a collection, such that a frame can be analyzed in another thread while
+ * the collection is evaluated for subsequent frames.
+ *
+ * The copies can only be accessed through the Selection interface; methods
+ * that change the selection should not be called for them.
+ *
+ * \inlibraryapi
+ * \ingroup module_selection
+ */
+class SelectionSnapshot
+{
+    public:
+        //! Creates an empty snapshot.
+        SelectionSnapshot();
+        ~SelectionSnapshot();
+
+        /*! \brief
+         * Copies the current state of all selections in a collection.
+         *
+         * \param[in] selections  Evaluated selection collection.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * The first call creates copies of all selections in \p selections;
+         * subsequent calls must use the same collection, and reuse the memory
+         * allocated for the copies.
+         */
+        void copyFrom(const SelectionCollection &selections);
+        /*! \brief
+         * Returns the copy of a selection.
+         *
+         * \param[in] selection  Selection from the collection passed to
+         *     copyFrom().
+         *
+         * If \p selection is not valid, it is returned unchanged.
+         * Does not throw.
+         */
+        Selection selection(const Selection &selection) const;
+
+    private:
+        class Impl;
+
+        PrivateImplPointer<Impl> impl_;
+};
+
+} // namespace gmx
+
+#endif
@@ -43,12 +43,16 @@
 
 #include "gromacs/selection/selectioncollection.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "gromacs/math/vectypes.h"
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/ioptionscontainer.h"
 #include "gromacs/selection/indexutil.h"
 #include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionsnapshot.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/arrayref.h"
@@ -689,6 +693,46 @@ TEST_F(SelectionCollectionTest, HandlesFramesWithTooSmallAtomSubsets4)
 
 // TODO: Tests for more evaluation errors
 
+TEST_F(SelectionCollectionTest, SnapshotIsNotChangedByEvaluation)
+{
+    ASSERT_NO_THROW_GMX(sel_ = sc_.parseFromString("x < 1.5; res_cog of atomnr 1 to 5"));
+    ASSERT_NO_FATAL_FAILURE(loadTopology("simple.gro"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+    ASSERT_NO_THROW_GMX(sc_.evaluate(topManager_.frame(), nullptr));
+
+    gmx::SelectionSnapshot snapshot;
+    ASSERT_NO_THROW_GMX(snapshot.copyFrom(sc_));
+    const gmx::Selection  dynamicCopy = snapshot.selection(sel_[0]);
+    const gmx::Selection  cogCopy     = snapshot.selection(sel_[1]);
+    EXPECT_NE(sel_[0], dynamicCopy);
+    const std::vector<int> atoms(sel_[0].atomIndices().begin(),
+                                 sel_[0].atomIndices().end());
+    const gmx::RVec        cog(sel_[1].position(0).x());
+    EXPECT_EQ(atoms.size(), dynamicCopy.atomIndices().size());
+
+    // Move all atoms such that the dynamic selection changes.
+    t_trxframe *frame = topManager_.frame();
+    for (int i = 0; i < frame->natoms; ++i)
+    {
+        frame->x[i][XX] += 1.0;
+    }
+    ASSERT_NO_THROW_GMX(sc_.evaluate(frame, nullptr));
+    EXPECT_NE(atoms.size(), sel_[0].atomIndices().size());
+
+    ASSERT_EQ(atoms.size(), dynamicCopy.atomIndices().size());
+    for (size_t i = 0; i < atoms.size(); ++i)
+    {
+        EXPECT_EQ(atoms[i], dynamicCopy.atomIndices()[i]);
+    }
+    EXPECT_REAL_EQ_TOL(cog[XX], cogCopy.position(0).x()[XX],
+                       gmx::test::defaultRealTolerance());
+
+    ASSERT_NO_THROW_GMX(snapshot.copyFrom(sc_));
+    EXPECT_EQ(sel_[0].atomIndices().size(), dynamicCopy.atomIndices().size());
+    EXPECT_REAL_EQ_TOL(cog[XX] + 1.0, cogCopy.position(0).x()[XX],
+                       gmx::test::defaultRealTolerance());
+}
+
 /********************************************************************
  * Tests for interactive selection input
  */
@@ -69,6 +69,7 @@ enum {
     ewcsRESTRAINTS,
     ewcsLISTED_BUF_OPS,
     ewcsNONBONDED,
+    ewcsNONBONDED_PRUNING,
     ewcsEWALD_CORRECTION,
     ewcsNB_X_BUF_OPS,
     ewcsNB_F_BUF_OPS,
@@ -0,0 +1,639 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx nonbonded-benchmark.
+ *
+ * Runs the nbnxn pair search and all CPU non-bonded kernel flavors
+ * on a synthetic SPC water box and reports the cycle counts.
+ */
+#include "gmxpre.h"
+
+#include "nonbonded-benchmark.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <algorithm>
+#include <vector>
+
+#include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/gmxlib/nrnb.h"
+#include "gromacs/math/calculate-ewald-splitting-coefficient.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/utilities.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/force_flags.h"
+#include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/nb_verlet.h"
+#include "gromacs/mdlib/nbnxn_atomdata.h"
+#include "gromacs/mdlib/nbnxn_grid.h"
+#include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_ref.h"
+#include "gromacs/mdlib/nbnxn_kernels/simd_2xnn/nbnxn_kernel_simd_2xnn.h"
+#include "gromacs/mdlib/nbnxn_kernels/simd_4xn/nbnxn_kernel_simd_4xn.h"
+#include "gromacs/mdlib/nbnxn_search.h"
+#include "gromacs/mdlib/nbnxn_simd.h"
+#include "gromacs/mdlib/nbnxn_util.h"
+#include "gromacs/mdtypes/forcerec.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/random/seed.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/timing/cyclecounter.h"
+#include "gromacs/topology/block.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/smalloc.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Which CPU non-bonded kernel layouts to benchmark
+enum KernelSelection
+{
+    eKernelAll, eKernelPlainC, eKernelSimd4xM, eKernelSimd2xMM
+};
+//! Option names for KernelSelection
+const char *const cKernelSelectionEnum[] = { "all", "plainc", "4xm", "2xmm" };
+
+//! Number of water molecules per nm^3 at 300 K and 1 bar
+const real c_waterMoleculeDensity = 33.4;
+
+/*! \brief Lennard-Jones parameters of the SPC water oxygen
+ *
+ * The hydrogens have no Lennard-Jones interactions.
+ */
+const real c_spcOxygenC6  = 0.0026173456;
+//! Repulsion parameter of the SPC water oxygen
+const real c_spcOxygenC12 = 2.634129e-06;
+
+/*! \brief The synthetic system the benchmark runs on
+ *
+ * All arrays have one entry per atom, with atoms ordered O, H, H
+ * per water molecule.
+ */
+struct WaterBox
+{
+    std::vector<RVec> x;
+    std::vector<int>  type;
+    std::vector<real> charge;
+    std::vector<int>  atinfo;
+    std::vector<int>  exclIndex;
+    std::vector<int>  exclAtoms;
+    matrix            box;
+};
+
+/*! \brief Fills \p system with a cubic box of SPC water
+ *
+ * The oxygens are placed on a lattice at liquid water density
+ * and each molecule gets a random orientation. The structure is
+ * not equilibrated, but the pair distribution within the cut-off,
+ * which is all that matters for the kernel performance, is close
+ * to that of liquid water.
+ */
+void generateWaterBox(real boxSize, int seed, WaterBox *system)
+{
+    const int  nPerDim     = std::max(1, static_cast<int>(std::round(boxSize*std::cbrt(c_waterMoleculeDensity))));
+    const int  nMolecules  = nPerDim*nPerDim*nPerDim;
+    const real spacing     = boxSize/nPerDim;
+    const real bondLength  = 0.1;
+    const real halfAngle   = 0.5*std::acos(-1.0/3.0);
+
+    DefaultRandomEngine           rng(seed);
+    UniformRealDistribution<real> dist(-1, 1);
+
+    clear_mat(system->box);
+    system->box[XX][XX] = boxSize;
+    system->box[YY][YY] = boxSize;
+    system->box[ZZ][ZZ] = boxSize;
+
+    system->x.resize(3*nMolecules);
+    system->type.resize(3*nMolecules);
+    system->charge.resize(3*nMolecules);
+    system->atinfo.resize(3*nMolecules);
+    system->exclIndex.resize(3*nMolecules + 1);
+    system->exclAtoms.resize(9*nMolecules);
+
+    int mol = 0;
+    for (int i = 0; i < nPerDim; i++)
+    {
+        for (int j = 0; j < nPerDim; j++)
+        {
+            for (int k = 0; k < nPerDim; k++)
+            {
+                /* Draw two random orthogonal unit vectors for the orientation */
+                rvec u, v, w;
+                do
+                {
+                    u[XX] = dist(rng);
+                    u[YY] = dist(rng);
+                    u[ZZ] = dist(rng);
+                }
+                while (norm2(u) > 1 || norm2(u) < 0.01);
+                unitv(u, u);
+                do
+                {
+                    w[XX] = dist(rng);
+                    w[YY] = dist(rng);
+                    w[ZZ] = dist(rng);
+                    cprod(u, w, v);
+                }
+                while (norm2(v) < 0.01);
+                unitv(v, v);
+
+                const int a = 3*mol;
+                system->x[a][XX] = (i + 0.5)*spacing;
+                system->x[a][YY] = (j + 0.5)*spacing;
+                system->x[a][ZZ] = (k + 0.5)*spacing;
+                for (int h = 1; h <= 2; h++)
+                {
+                    const real sign = (h == 1 ? 1 : -1);
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        system->x[a + h][d] = system->x[a][d] +
+                            bondLength*(std::cos(halfAngle)*u[d] + sign*std::sin(halfAngle)*v[d]);
+                    }
+                }
+
+                for (int h = 0; h < 3; h++)
+                {
+                    system->type[a + h]   = (h == 0 ? 0 : 1);
+                    system->charge[a + h] = (h == 0 ? -0.82 : 0.41);
+                    system->atinfo[a + h] = 0;
+                    SET_CGINFO_GID(system->atinfo[a + h], 0);
+                    SET_CGINFO_HAS_Q(system->atinfo[a + h]);
+                    if (h == 0)
+                    {
+                        SET_CGINFO_HAS_VDW(system->atinfo[a + h]);
+                    }
+                    /* The Verlet scheme needs the self-exclusion in the list */
+                    system->exclIndex[a + h] = 3*(a + h);
+                    for (int e = 0; e < 3; e++)
+                    {
+                        system->exclAtoms[3*(a + h) + e] = a + e;
+                    }
+                }
+                mol++;
+            }
+        }
+    }
+    system->exclIndex[3*nMolecules] = 9*nMolecules;
+
+    put_atoms_in_box(epbcXYZ, system->box, system->x.size(), as_rvec_array(system->x.data()));
+}
+
+/*! \brief Returns interaction constants for Coulomb type \p eeltype
+ *
+ * Uses plain Lennard-Jones with potential shift with cut-off \p cutoff,
+ * the same cut-off and a potential shift for Coulomb and
+ * a relative Ewald tolerance of 1e-5. Reaction-field uses
+ * an infinite dielectric constant.
+ */
+interaction_const_t *makeInteractionConst(int eeltype, real cutoff, real rlist)
+{
+    interaction_const_t *ic;
+
+    snew(ic, 1);
+
+    ic->cutoff_scheme             = ecutsVERLET;
+    ic->rlist                     = rlist;
+
+    ic->vdwtype                   = evdwCUT;
+    ic->vdw_modifier              = eintmodPOTSHIFT;
+    ic->rvdw                      = cutoff;
+    ic->dispersion_shift.cpot     = -1.0/gmx::power6(cutoff);
+    ic->repulsion_shift.cpot      = -1.0/gmx::power12(cutoff);
+    ic->sh_invrc6                 = -ic->dispersion_shift.cpot;
+
+    ic->eeltype                   = eeltype;
+    ic->coulomb_modifier          = eintmodPOTSHIFT;
+    ic->rcoulomb                  = cutoff;
+    ic->epsilon_r                 = 1;
+    ic->epsfac                    = ONE_4PI_EPS0;
+    if (EEL_PME_EWALD(eeltype))
+    {
+        ic->ewaldcoeff_q          = calc_ewaldcoeff_q(cutoff, 1e-5);
+        ic->sh_ewald              = std::erfc(ic->ewaldcoeff_q*cutoff);
+    }
+    ic->epsilon_rf                = 0;
+    ic->k_rf                      = 0.5/gmx::power3(cutoff);
+    ic->c_rf                      = 1/cutoff + ic->k_rf*cutoff*cutoff;
+
+    init_interaction_const_tables(nullptr, ic, 0);
+
+    return ic;
+}
+
+//! Frees the interaction constants made by makeInteractionConst()
+void freeInteractionConst(interaction_const_t *ic)
+{
+    sfree_aligned(ic->tabq_coul_FDV0);
+    sfree_aligned(ic->tabq_coul_F);
+    sfree_aligned(ic->tabq_coul_V);
+    sfree(ic);
+}
+
+class NonbondedBenchmark : public ICommandLineOptionsModule
+{
+    public:
+        NonbondedBenchmark()
+            : boxSize_(3.0), cutoff_(1.0), buffer_(0.1), numIterations_(100),
+              numThreads_(1), seed_(0), kernelSelection_(eKernelAll)
+        {
+        }
+
+        virtual void init(CommandLineModuleSettings * /*settings*/)
+        {
+        }
+        virtual void initOptions(IOptionsContainer                 *options,
+                                 ICommandLineOptionsModuleSettings *settings);
+        virtual void optionsFinished();
+        virtual int run();
+
+    private:
+        void benchmarkKernelType(int kernelType, const WaterBox &system);
+
+        real            boxSize_;
+        real            cutoff_;
+        real            buffer_;
+        int             numIterations_;
+        int             numThreads_;
+        int             seed_;
+        KernelSelection kernelSelection_;
+};
+
+void NonbondedBenchmark::initOptions(IOptionsContainer                 *options,
+                                     ICommandLineOptionsModuleSettings *settings)
+{
+    const char *const desc[] = {
+        "[THISMODULE] runs the CPU non-bonded pair search and kernels",
+        "of the Verlet cut-off scheme on a synthetic cubic box of SPC water",
+        "with edge length [TT]-size[tt] and reports the cost in CPU cycles.",
+        "This is useful to compare the kernel performance across hardware,",
+        "compilers and SIMD settings without setting up a simulation.",
+        "",
+        "For each kernel layout selected with [TT]-kernel[tt], the pair",
+        "search with a list radius of [TT]-cutoff[tt] plus [TT]-buffer[tt]",
+        "is timed, after which the kernels are run [TT]-iter[tt] times",
+        "for each electrostatics flavor (reaction-field, tabulated Ewald",
+        "and, with SIMD, analytical Ewald), each Lennard-Jones combination",
+        "rule and with and without energy calculation.",
+        "The cost is reported in cycles per atom pair within the cut-off,",
+        "where the number of pairs is estimated from the density.",
+        "",
+        "The cycle counts are measured with the hardware cycle counter, so",
+        "they are sensitive to frequency scaling and other load on the machine."
+    };
+
+    settings->setHelpText(desc);
+
+    options->addOption(RealOption("size")
+                           .store(&boxSize_)
+                           .description("Edge length of the water box (nm)"));
+    options->addOption(RealOption("cutoff")
+                           .store(&cutoff_)
+                           .description("Cut-off distance for Coulomb and Lennard-Jones (nm)"));
+    options->addOption(RealOption("buffer")
+                           .store(&buffer_)
+                           .description("Pair-list buffer added to the cut-off (nm)"));
+    options->addOption(IntegerOption("iter")
+                           .store(&numIterations_)
+                           .description("Number of timed iterations for each kernel"));
+    options->addOption(IntegerOption("nt")
+                           .store(&numThreads_)
+                           .description("Number of OpenMP threads to use"));
+    options->addOption(IntegerOption("seed")
+                           .store(&seed_)
+                           .description("Random seed for the water orientations (0 means generate)"));
+    options->addOption(EnumOption<KernelSelection>("kernel").enumValue(cKernelSelectionEnum)
+                           .store(&kernelSelection_)
+                           .description("Kernel layouts to benchmark"));
+}
+
+void NonbondedBenchmark::optionsFinished()
+{
+    if (cutoff_ <= 0 || buffer_ < 0)
+    {
+        GMX_THROW(InconsistentInputError("The cut-off should be positive and the buffer non-negative"));
+    }
+    if (boxSize_ < 2*(cutoff_ + buffer_))
+    {
+        GMX_THROW(InconsistentInputError("The box size should be at least twice the cut-off plus buffer"));
+    }
+    if (numIterations_ < 1 || numThreads_ < 1)
+    {
+        GMX_THROW(InconsistentInputError("The number of iterations and threads should be positive"));
+    }
+#if !GMX_OPENMP
+    if (numThreads_ > 1)
+    {
+        GMX_THROW(InconsistentInputError("Multiple threads requested, but GROMACS was compiled without OpenMP support"));
+    }
+#endif
+}
+
+void NonbondedBenchmark::benchmarkKernelType(int             kernelType,
+                                             const WaterBox &system)
+{
+    struct CoulombFlavor
+    {
+        const char *name;
+        int         eeltype;
+        int         ewaldExcl;
+    };
+    const CoulombFlavor coulombFlavors[] = {
+        { "RF",        eelRF,  ewaldexclTable },
+        { "Ewald tab", eelPME, ewaldexclTable },
+        { "Ewald ana", eelPME, ewaldexclAnalytical }
+    };
+    struct CombRule
+    {
+        const char *name;
+        int         enbnxninitcombrule;
+    };
+    const CombRule combRules[] = {
+        { "geom.", enbnxninitcombruleGEOM },
+        { "LB",    enbnxninitcombruleLB },
+        { "none",  enbnxninitcombruleNONE }
+    };
+
+    const bool  bPlainC = (kernelType == nbnxnk4x4_PlainC);
+    const int   natoms  = system.x.size();
+    const real  rlist   = cutoff_ + buffer_;
+
+    /* The plain-C kernel always uses the full parameter matrix */
+    const int   nbfpType = 2;
+    real        nbfp[nbfpType*nbfpType*2] = { 0 };
+    nbfp[0] = 6*c_spcOxygenC6;
+    nbfp[1] = 12*c_spcOxygenC12;
+
+    t_blocka    excls;
+    excls.nr           = natoms;
+    excls.index        = const_cast<int *>(system.exclIndex.data());
+    excls.nra          = system.exclAtoms.size();
+    excls.a            = const_cast<int *>(system.exclAtoms.data());
+    excls.nalloc_index = 0;
+    excls.nalloc_a     = 0;
+
+    t_mdatoms  *mdatoms;
+    snew(mdatoms, 1);
+    mdatoms->nr      = natoms;
+    mdatoms->typeA   = const_cast<int *>(system.type.data());
+    mdatoms->chargeA = const_cast<real *>(system.charge.data());
+
+    matrix      box;
+    copy_mat(system.box, box);
+    rvec        shiftVec[SHIFTS];
+    calc_shifts(box, shiftVec);
+    rvec        lowerCorner, upperCorner;
+    clear_rvec(lowerCorner);
+    for (int d = 0; d < DIM; d++)
+    {
+        upperCorner[d] = box[d][d];
+    }
+
+    /* The number of atom pairs within the cut-off for a homogeneous system */
+    const double numPairsInCutoff =
+        0.5*natoms*(natoms/det(box))*4.0/3.0*M_PI*gmx::power3(cutoff_);
+
+    t_nrnb      nrnb;
+    init_nrnb(&nrnb);
+
+    interaction_const_t *icRF    = makeInteractionConst(eelRF, cutoff_, rlist);
+    interaction_const_t *icEwald = makeInteractionConst(eelPME, cutoff_, rlist);
+
+    printf("\n%s kernels with %dx%d atom clusters\n",
+           bPlainC ? "Plain-C" : (kernelType == nbnxnk4xN_SIMD_4xN ? "SIMD 4xM" : "SIMD 2xMM"),
+           nbnxn_kernel_to_cluster_i_size(kernelType),
+           nbnxn_kernel_to_cluster_j_size(kernelType));
+
+    nbnxn_search_t       nbs;
+    nbnxn_pairlist_set_t nbl_list;
+    nbnxn_init_search(&nbs, nullptr, nullptr, FALSE, numThreads_);
+    nbnxn_init_pairlist_set(&nbl_list, TRUE, FALSE, nullptr, nullptr);
+
+    bool bSearchReported = false;
+    for (const CombRule &combRule : combRules)
+    {
+        if (bPlainC && combRule.enbnxninitcombrule != enbnxninitcombruleNONE)
+        {
+            continue;
+        }
+
+        /* The combination rule is set at initialization, so we need new atom data */
+        nbnxn_atomdata_t *nbat;
+        snew(nbat, 1);
+        nbnxn_atomdata_init(nullptr, nbat, kernelType, combRule.enbnxninitcombrule,
+                            nbfpType, nbfp, 1, numThreads_, nullptr, nullptr);
+        nbnxn_atomdata_copy_shiftvec(FALSE, shiftVec, nbat);
+
+        /* We time the grid setup and the search together, as in mdrun */
+        gmx_cycles_t searchCycles = 0;
+        const int    numSearches  = std::max(1, numIterations_/10);
+        for (int iter = 0; iter < numSearches; iter++)
+        {
+            gmx_cycles_t start = gmx_cycles_read();
+            nbnxn_put_on_grid(nbs, epbcXYZ, box, 0, lowerCorner, upperCorner,
+                              0, natoms, -1, system.atinfo.data(),
+                              as_rvec_array(const_cast<RVec *>(system.x.data())),
+                              0, nullptr, kernelType, nbat);
+            nbnxn_make_pairlist(nbs, nbat, &excls, rlist, 0, &nbl_list,
+                                eatLocal, kernelType, &nrnb);
+            searchCycles += gmx_cycles_read() - start;
+        }
+        nbnxn_atomdata_set(nbat, eatAll, nbs, mdatoms, system.atinfo.data());
+
+        if (!bSearchReported)
+        {
+            int numClusterPairs = 0;
+            for (int i = 0; i < nbl_list.nnbl; i++)
+            {
+                numClusterPairs += nbl_list.nbl[i]->ncjInUse;
+            }
+            const double numPairsInList = static_cast<double>(numClusterPairs)*
+                nbl_list.nbl[0]->na_ci*nbl_list.nbl[0]->na_cj;
+            printf("Pair search:   %10.3f Mcycles, %d cluster pairs, %.1f%% of the pairs within the cut-off\n",
+                   1e-6*searchCycles/numSearches, numClusterPairs,
+                   100*numPairsInCutoff/numPairsInList);
+            printf("%-10s %-6s %-8s %14s %12s\n",
+                   "Coulomb", "LJ", "energies", "Mcycles/call", "cycles/pair");
+            bSearchReported = true;
+        }
+
+        for (const CoulombFlavor &coulomb : coulombFlavors)
+        {
+            if (bPlainC && coulomb.eeltype == eelPME && coulomb.ewaldExcl == ewaldexclAnalytical)
+            {
+                /* The plain-C kernel only has tabulated Ewald */
+                continue;
+            }
+            const interaction_const_t *ic = (coulomb.eeltype == eelRF ? icRF : icEwald);
+
+            for (int bEnergy = 0; bEnergy <= 1; bEnergy++)
+            {
+                const int    forceFlags = GMX_FORCE_FORCES | (bEnergy ? GMX_FORCE_ENERGY : 0);
+                real         fshift[SHIFTS*DIM];
+                real         Vc[1], Vvdw[1];
+                gmx_cycles_t kernelCycles = 0;
+
+                /* The first, untimed, iteration warms up the caches */
+                for (int iter = 0; iter <= numIterations_; iter++)
+                {
+                    gmx_cycles_t start = gmx_cycles_read();
+                    switch (kernelType)
+                    {
+                        case nbnxnk4x4_PlainC:
+                            nbnxn_kernel_ref(&nbl_list, nbat, ic, shiftVec,
+                                             forceFlags, enbvClearFYes,
+                                             fshift, Vc, Vvdw);
+                            break;
+                        case nbnxnk4xN_SIMD_4xN:
+                            nbnxn_kernel_simd_4xn(&nbl_list, nbat, ic, coulomb.ewaldExcl,
+                                                  shiftVec, forceFlags, enbvClearFYes,
+                                                  fshift, Vc, Vvdw);
+                            break;
+                        case nbnxnk4xN_SIMD_2xNN:
+                            nbnxn_kernel_simd_2xnn(&nbl_list, nbat, ic, coulomb.ewaldExcl,
+                                                   shiftVec, forceFlags, enbvClearFYes,
+                                                   fshift, Vc, Vvdw);
+                            break;
+                        default:
+                            GMX_RELEASE_ASSERT(false, "Unsupported kernel type");
+                    }
+                    if (iter > 0)
+                    {
+                        kernelCycles += gmx_cycles_read() - start;
+                    }
+                }
+
+                printf("%-10s %-6s %-8s %14.3f %12.2f\n",
+                       coulomb.name, combRule.name, bEnergy ? "yes" : "no",
+                       1e-6*kernelCycles/numIterations_,
+                       kernelCycles/(numIterations_*numPairsInCutoff));
+            }
+        }
+
+        /* There is no destructor for the atom data, we only free the struct */
+        sfree(nbat);
+    }
+
+    freeInteractionConst(icRF);
+    freeInteractionConst(icEwald);
+    sfree(mdatoms);
+}
+
+int NonbondedBenchmark::run()
+{
+    if (!gmx_cycles_have_counter())
+    {
+        GMX_THROW(NotImplementedError("This tool needs a hardware cycle counter, which is not available on this architecture"));
+    }
+
+    if (seed_ == 0)
+    {
+        seed_ = static_cast<int>(makeRandomSeed());
+    }
+
+    WaterBox system;
+    generateWaterBox(boxSize_, seed_, &system);
+
+    gmx_omp_nthreads_set(emntDefault, numThreads_);
+    gmx_omp_nthreads_set(emntNonbonded, numThreads_);
+    gmx_omp_nthreads_set(emntPairsearch, numThreads_);
+
+    printf("Benchmarking %d SPC water molecules in a %.2f nm cubic box\n",
+           static_cast<int>(system.x.size()/3), boxSize_);
+    printf("Cut-off %.3f nm, pair-list radius %.3f nm, %d thread%s, %d iterations\n",
+           cutoff_, cutoff_ + buffer_, numThreads_, numThreads_ > 1 ? "s" : "",
+           numIterations_);
+
+    std::vector<int> kernelTypes;
+    if (kernelSelection_ == eKernelAll || kernelSelection_ == eKernelPlainC)
+    {
+        kernelTypes.push_back(nbnxnk4x4_PlainC);
+    }
+    if (kernelSelection_ == eKernelAll || kernelSelection_ == eKernelSimd4xM)
+    {
+#ifdef GMX_NBNXN_SIMD_4XN
+        kernelTypes.push_back(nbnxnk4xN_SIMD_4xN);
+#else
+        if (kernelSelection_ != eKernelAll)
+        {
+            GMX_THROW(InconsistentInputError("The SIMD 4xM kernels are not supported with this build"));
+        }
+#endif
+    }
+    if (kernelSelection_ == eKernelAll || kernelSelection_ == eKernelSimd2xMM)
+    {
+#ifdef GMX_NBNXN_SIMD_2XNN
+        kernelTypes.push_back(nbnxnk4xN_SIMD_2xNN);
+#else
+        if (kernelSelection_ != eKernelAll)
+        {
+            GMX_THROW(InconsistentInputError("The SIMD 2xMM kernels are not supported with this build"));
+        }
+#endif
+    }
+
+    for (int kernelType : kernelTypes)
+    {
+        benchmarkKernelType(kernelType, system);
+    }
+
+    return 0;
+}
+
+}   // namespace
+
+const char NonbondedBenchmarkInfo::name[]             = "nonbonded-benchmark";
+const char NonbondedBenchmarkInfo::shortDescription[] =
+    "Benchmark the CPU non-bonded pair search and kernels";
+ICommandLineOptionsModulePointer NonbondedBenchmarkInfo::create()
+{
+    return ICommandLineOptionsModulePointer(new NonbondedBenchmark());
+}
+
+} // namespace gmx
@@ -48,6 +48,7 @@
 
 #include "gromacs/analysisdata/analysisdata.h"
 #include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionsnapshot.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
 
@@ -111,13 +112,17 @@ class TrajectoryAnalysisModuleData::Impl
         HandleContainer            handles_;
         //! Stores thread-local selections.
         const SelectionCollection &selections_;
+        //! Copies of \a selections_ for the current frame.
+        SelectionSnapshot          frameSelections_;
+        //! Whether \a frameSelections_ has been initialized.
+        bool                       bFrameSelections_;
 };
 
 TrajectoryAnalysisModuleData::Impl::Impl(
         TrajectoryAnalysisModule          *module,
         const AnalysisDataParallelOptions &opt,
         const SelectionCollection         &selections)
-    : selections_(selections)
+    : selections_(selections), bFrameSelections_(false)
 {
     TrajectoryAnalysisModule::Impl::AnalysisDatasetContainer::const_iterator i;
     for (i = module->impl_->analysisDatasets_.begin();
@@ -193,7 +198,10 @@ TrajectoryAnalysisModuleData::dataHandle(const AnalysisData &data)
 
 Selection TrajectoryAnalysisModuleData::parallelSelection(const Selection &selection)
 {
-    // TODO: Implement properly.
+    if (impl_->bFrameSelections_)
+    {
+        return impl_->frameSelections_.selection(selection);
+    }
     return selection;
 }
 
@@ -213,6 +221,13 @@ TrajectoryAnalysisModuleData::parallelSelections(const SelectionList &selections
 }
 
 
+void TrajectoryAnalysisModuleData::copySelectionsForFrame()
+{
+    impl_->frameSelections_.copyFrom(impl_->selections_);
+    impl_->bFrameSelections_ = true;
+}
+
+
 /********************************************************************
  * TrajectoryAnalysisModuleDataBasic
  */
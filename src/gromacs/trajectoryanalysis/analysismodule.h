@@ -140,6 +140,20 @@ class TrajectoryAnalysisModuleData
          * \see parallelSelection()
          */
         SelectionList parallelSelections(const SelectionList &selections);
+        /*! \brief
+         * Takes thread-local copies of the selections for the current frame.
+         *
+         * \throws std::bad_alloc if out of memory.
+         *
+         * Copies the evaluated state of the selection collection with which
+         * this data object was constructed.  After the first call,
+         * parallelSelection() returns the copies, which are not affected when
+         * the collection is evaluated for other frames.
+         *
+         * This is called by the runner when frames are analyzed in parallel;
+         * analysis modules should not call it.
+         */
+        void copySelectionsForFrame();
 
     protected:
         /*! \brief
@@ -121,6 +121,21 @@ class TrajectoryAnalysisSettings
              * \see setRmPBC()
              */
             efNoUserRmPBC    = 1<<5,
+            /*! \brief
+             * Allows analyzing multiple frames in parallel.
+             *
+             * If this flag is specified, the user can request multiple
+             * threads, and TrajectoryAnalysisModule::analyzeFrame() may then
+             * be called concurrently for different frames, each call with a
+             * different TrajectoryAnalysisModuleData object.
+             * The module should then only modify data through the data
+             * handles and its TrajectoryAnalysisModuleData object, and access
+             * selections through
+             * TrajectoryAnalysisModuleData::parallelSelection().
+             * TrajectoryAnalysisModule::finishFrameSerial() is still called
+             * for each frame in order.
+             */
+            efFrameParallel  = 1<<6,
         };
 
         //! Initializes default settings.
@@ -43,9 +43,18 @@
 
 #include "cmdlinerunner.h"
 
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "gromacs/analysisdata/paralleloptions.h"
 #include "gromacs/commandline/cmdlinemodulemanager.h"
 #include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
 #include "gromacs/options/ioptionscontainer.h"
 #include "gromacs/options/timeunitmanager.h"
 #include "gromacs/pbcutil/pbc.h"
@@ -66,6 +75,289 @@ namespace gmx
 namespace
 {
 
+/********************************************************************
+ * FrameParallelRunner
+ */
+
+/*! \internal \brief
+ * Analyzes frames concurrently in a pool of worker threads.
+ *
+ * The calling thread reads the frames and evaluates the selections, and
+ * passes each frame, together with copies of the coordinates and the
+ * selections, to a worker thread that calls
+ * TrajectoryAnalysisModule::analyzeFrame().  While the workers analyze,
+ * the calling thread already reads and evaluates the next frames.
+ *
+ * Frame \c i is analyzed by worker \c i%N with its own
+ * TrajectoryAnalysisModuleData object, and a worker only receives a new
+ * frame after TrajectoryAnalysisModule::finishFrameSerial() has been called
+ * for its previous frame.  This keeps at most N frames in progress, as
+ * AnalysisDataParallelOptions(N) requires, and the serial part of the
+ * processing is done in frame order in the calling thread.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+class FrameParallelRunner
+{
+    public:
+        /*! \brief
+         * Starts the worker threads.
+         *
+         * \param[in] module      Module to analyze the frames with.
+         * \param[in] selections  Selections used by the module.
+         * \param[in] threadCount Number of worker threads.
+         */
+        FrameParallelRunner(TrajectoryAnalysisModule  *module,
+                            const SelectionCollection &selections,
+                            int                        threadCount);
+        //! Stops the worker threads, discarding any unfinished frames.
+        ~FrameParallelRunner();
+
+        /*! \brief
+         * Passes a frame for analysis.
+         *
+         * \param[in] frameIndex  Index of the frame; must be consecutive.
+         * \param[in] frame       Frame to analyze.
+         * \param[in] pbc         PBC information for the frame, or NULL.
+         *
+         * The selections must have been evaluated for \p frame.
+         * Waits for the worker that will analyze the frame, and rethrows
+         * any exception that occurred in analyzing its previous frame.
+         */
+        void analyzeFrame(int frameIndex, const t_trxframe &frame,
+                          const t_pbc *pbc);
+        /*! \brief
+         * Waits for all frames to be analyzed and finishes the frames.
+         *
+         * Calls TrajectoryAnalysisModule::finishFrames() and
+         * TrajectoryAnalysisModuleData::finish() for all the data objects.
+         */
+        void finish();
+
+    private:
+        //! Thread-local data for a single worker.
+        struct Worker
+        {
+            //! Processing state of the current frame.
+            enum State
+            {
+                eIdle,      //!< No frame is assigned.
+                eQueued,    //!< Frame is waiting for or in analysis.
+                eAnalyzed   //!< Frame is analyzed, but not finished.
+            };
+
+            Worker() : state(eIdle), frameIndex(-1), frame(), bPBC(false)
+            {
+            }
+
+            //! Thread-local data handles and selections for the module.
+            TrajectoryAnalysisModuleDataPointer pdata;
+            //! Processing state of the worker.
+            State                               state;
+            //! Index of the current frame.
+            int                                 frameIndex;
+            //! Copy of the current frame, pointing to \a x, \a v and \a f.
+            t_trxframe                          frame;
+            //! Coordinates for the current frame.
+            std::vector<RVec>                   x;
+            //! Velocities for the current frame.
+            std::vector<RVec>                   v;
+            //! Forces for the current frame.
+            std::vector<RVec>                   f;
+            //! PBC information for the current frame.
+            t_pbc                               pbc;
+            //! Whether \a pbc is used for the current frame.
+            bool                                bPBC;
+            //! Exception thrown when analyzing the current frame.
+            std::exception_ptr                  exception;
+            //! Thread running this worker.
+            std::thread                         thread;
+        };
+
+        //! Main loop for a worker thread.
+        void runWorker(Worker *worker);
+        //! Waits until \p worker is idle, finishing its current frame.
+        void finishWorkerFrame(Worker *worker);
+        //! Stops and joins all worker threads.
+        void stopWorkers();
+
+        TrajectoryAnalysisModule             &module_;
+        std::vector<std::unique_ptr<Worker> > workers_;
+        //! Index of the next frame to be passed to analyzeFrame().
+        int                                   nextFrameIndex_;
+        //! Whether the worker threads should exit.
+        bool                                  bStop_;
+        //! Protects the state of the workers.
+        std::mutex                            mutex_;
+        //! Signals the workers when a frame has been queued.
+        std::condition_variable               frameQueued_;
+        //! Signals the calling thread when a frame has been analyzed.
+        std::condition_variable               frameAnalyzed_;
+};
+
+//! Copies \p count vectors from \p src into \p dest, returning \p dest.
+rvec *copyFrameVectors(const rvec *src, int count, std::vector<RVec> *dest)
+{
+    if (src == nullptr)
+    {
+        return nullptr;
+    }
+    dest->resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+        copy_rvec(src[i], (*dest)[i]);
+    }
+    return as_rvec_array(dest->data());
+}
+
+FrameParallelRunner::FrameParallelRunner(
+        TrajectoryAnalysisModule *module, const SelectionCollection &selections,
+        int threadCount)
+    : module_(*module), nextFrameIndex_(0), bStop_(false)
+{
+    AnalysisDataParallelOptions dataOptions(threadCount);
+    for (int i = 0; i < threadCount; ++i)
+    {
+        workers_.emplace_back(new Worker);
+        workers_.back()->pdata = module_.startFrames(dataOptions, selections);
+    }
+    try
+    {
+        for (const auto &worker : workers_)
+        {
+            worker->thread = std::thread(&FrameParallelRunner::runWorker,
+                                         this, worker.get());
+        }
+    }
+    catch (...)
+    {
+        stopWorkers();
+        throw;
+    }
+}
+
+FrameParallelRunner::~FrameParallelRunner()
+{
+    stopWorkers();
+}
+
+void FrameParallelRunner::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bStop_ = true;
+    }
+    frameQueued_.notify_all();
+    for (const auto &worker : workers_)
+    {
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+void FrameParallelRunner::runWorker(Worker *worker)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        frameQueued_.wait(lock, [this, worker]
+                          {
+                              return bStop_ || worker->state == Worker::eQueued;
+                          });
+        if (bStop_)
+        {
+            return;
+        }
+        lock.unlock();
+        try
+        {
+            module_.analyzeFrame(worker->frameIndex, worker->frame,
+                                 worker->bPBC ? &worker->pbc : nullptr,
+                                 worker->pdata.get());
+        }
+        catch (...)
+        {
+            worker->exception = std::current_exception();
+        }
+        lock.lock();
+        worker->state = Worker::eAnalyzed;
+        frameAnalyzed_.notify_all();
+    }
+}
+
+void FrameParallelRunner::finishWorkerFrame(Worker *worker)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        frameAnalyzed_.wait(lock, [worker]
+                            {
+                                return worker->state != Worker::eQueued;
+                            });
+        if (worker->state == Worker::eIdle)
+        {
+            return;
+        }
+        worker->state = Worker::eIdle;
+    }
+    if (worker->exception)
+    {
+        std::rethrow_exception(worker->exception);
+    }
+    module_.finishFrameSerial(worker->frameIndex);
+}
+
+void FrameParallelRunner::analyzeFrame(int frameIndex, const t_trxframe &frame,
+                                       const t_pbc *pbc)
+{
+    GMX_RELEASE_ASSERT(frameIndex == nextFrameIndex_,
+                       "Frames should be analyzed in order");
+    Worker &worker = *workers_[frameIndex % workers_.size()];
+    finishWorkerFrame(&worker);
+
+    worker.frameIndex = frameIndex;
+    worker.frame      = frame;
+    worker.frame.x    = copyFrameVectors(frame.x, frame.natoms, &worker.x);
+    worker.frame.v    = copyFrameVectors(frame.v, frame.natoms, &worker.v);
+    worker.frame.f    = copyFrameVectors(frame.f, frame.natoms, &worker.f);
+    worker.bPBC       = (pbc != nullptr);
+    if (worker.bPBC)
+    {
+        worker.pbc = *pbc;
+    }
+    worker.pdata->copySelectionsForFrame();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        worker.state = Worker::eQueued;
+    }
+    frameQueued_.notify_all();
+    ++nextFrameIndex_;
+}
+
+void FrameParallelRunner::finish()
+{
+    // Finish the remaining frames in order, starting from the oldest.
+    const int workerCount = static_cast<int>(workers_.size());
+    for (int i = 0; i < workerCount; ++i)
+    {
+        finishWorkerFrame(workers_[(nextFrameIndex_ + i) % workerCount].get());
+    }
+    stopWorkers();
+    for (const auto &worker : workers_)
+    {
+        module_.finishFrames(worker->pdata.get());
+    }
+    for (const auto &worker : workers_)
+    {
+        if (worker->pdata != nullptr)
+        {
+            worker->pdata->finish();
+        }
+        worker->pdata.reset();
+    }
+}
+
 /********************************************************************
  * RunnerModule
  */
@@ -130,32 +422,56 @@ int RunnerModule::run()
     t_pbc  pbc;
     t_pbc *ppbc = settings_.hasPBC() ? &pbc : nullptr;
 
-    int    nframes = 0;
-    AnalysisDataParallelOptions         dataOptions;
-    TrajectoryAnalysisModuleDataPointer pdata(
-            module_->startFrames(dataOptions, selections_));
-    do
+    int       nframes     = 0;
+    const int threadCount = common_.threadCount();
+    if (threadCount > 1)
     {
-        common_.initFrame();
-        t_trxframe &frame = common_.frame();
-        if (ppbc != nullptr)
+        FrameParallelRunner runner(module_.get(), selections_, threadCount);
+        do
         {
-            set_pbc(ppbc, topology.ePBC(), frame.box);
-        }
+            common_.initFrame();
+            t_trxframe &frame = common_.frame();
+            if (ppbc != nullptr)
+            {
+                set_pbc(ppbc, topology.ePBC(), frame.box);
+            }
 
-        selections_.evaluate(&frame, ppbc);
-        module_->analyzeFrame(nframes, frame, ppbc, pdata.get());
-        module_->finishFrameSerial(nframes);
+            selections_.evaluate(&frame, ppbc);
+            runner.analyzeFrame(nframes, frame, ppbc);
 
-        ++nframes;
+            ++nframes;
+        }
+        while (common_.readNextFrame());
+        runner.finish();
     }
-    while (common_.readNextFrame());
-    module_->finishFrames(pdata.get());
-    if (pdata.get() != nullptr)
+    else
     {
-        pdata->finish();
+        AnalysisDataParallelOptions         dataOptions;
+        TrajectoryAnalysisModuleDataPointer pdata(
+                module_->startFrames(dataOptions, selections_));
+        do
+        {
+            common_.initFrame();
+            t_trxframe &frame = common_.frame();
+            if (ppbc != nullptr)
+            {
+                set_pbc(ppbc, topology.ePBC(), frame.box);
+            }
+
+            selections_.evaluate(&frame, ppbc);
+            module_->analyzeFrame(nframes, frame, ppbc, pdata.get());
+            module_->finishFrameSerial(nframes);
+
+            ++nframes;
+        }
+        while (common_.readNextFrame());
+        module_->finishFrames(pdata.get());
+        if (pdata.get() != nullptr)
+        {
+            pdata->finish();
+        }
+        pdata.reset();
     }
-    pdata.reset();
 
     if (common_.hasTrajectory())
     {
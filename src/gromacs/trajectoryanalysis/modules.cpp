@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2010,2011,2012,2013,2014,2016, by the GROMACS development team, led by
+ * Copyright (c) 2010,2011,2012,2013,2014,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -48,6 +48,7 @@
 
 #include "modules/angle.h"
 #include "modules/distance.h"
+#include "modules/dssp.h"
 #include "modules/freevolume.h"
 #include "modules/pairdist.h"
 #include "modules/rdf.h"
@@ -92,6 +93,7 @@ void registerTrajectoryAnalysisModules(CommandLineModuleManager *manager)
     CommandLineModuleGroup group = manager->addModuleGroup("Trajectory analysis");
     registerModule<AngleInfo>(manager, group);
     registerModule<DistanceInfo>(manager, group);
+    registerModule<DsspInfo>(manager, group);
     registerModule<FreeVolumeInfo>(manager, group);
     registerModule<PairDistanceInfo>(manager, group);
     registerModule<RdfInfo>(manager, group);
@@ -0,0 +1,1157 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::analysismodules::Dssp.
+ *
+ * The secondary structure assignment follows the algorithm of Kabsch and
+ * Sander (Biopolymers 22, 2577 (1983)) as implemented in DSSP 2.x.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "dssp.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gromacs/analysisdata/analysisdata.h"
+#include "gromacs/analysisdata/modules/plot.h"
+#include "gromacs/analysisdata/paralleloptions.h"
+#include "gromacs/fileio/matio.h"
+#include "gromacs/math/functions.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/options/basicoptions.h"
+#include "gromacs/options/filenameoption.h"
+#include "gromacs/options/ioptionscontainer.h"
+#include "gromacs/options/timeunitmanager.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/selection/nbsearch.h"
+#include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionoption.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/trajectoryanalysis/analysissettings.h"
+#include "gromacs/utility/arrayref.h"
+#include "gromacs/utility/exceptions.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/stringutil.h"
+
+namespace gmx
+{
+
+namespace analysismodules
+{
+
+namespace
+{
+
+//! \addtogroup module_trajectoryanalysis
+//! \{
+
+//! Maximum C-N distance (nm) between two residues bonded to each other.
+const real c_maxPeptideBondLength = 0.25;
+//! Maximum CA-CA distance (nm) for residue pairs that are checked for H-bonds.
+const real c_hbondSearchCutoff    = 0.9;
+//! Coupling constant of the electrostatic H-bond energy (kcal/mol Angstrom).
+const real c_couplingConstant     = 0.42*0.20*332;
+//! H-bond energy (kcal/mol) below which an H-bond is considered to exist.
+const real c_maxHBondEnergy       = -0.5;
+//! Lower bound (kcal/mol) for the computed H-bond energy.
+const real c_minHBondEnergy       = -9.9;
+//! Atom distance (Angstrom) below which the H-bond energy is set to the minimum.
+const real c_minimalDistance      = 0.5;
+//! Minimum CA chain angle (degrees) to assign a bend.
+const real c_minBendAngle         = 70;
+//! Number of frames per thread that are collected before processing.
+const int  c_framesPerThread      = 4;
+
+//! Backbone atoms used in the assignment.
+enum BackboneAtom
+{
+    eBackbone_N,
+    eBackbone_CA,
+    eBackbone_C,
+    eBackbone_O,
+    eBackbone_NR
+};
+
+/*! \brief
+ * Secondary structure types.
+ *
+ * The order matches the default ss.map used by `gmx do_dssp`.
+ */
+enum SecondaryStructure
+{
+    eSS_Loop,
+    eSS_Strand,
+    eSS_Bridge,
+    eSS_Bend,
+    eSS_Turn,
+    eSS_AlphaHelix,
+    eSS_PiHelix,
+    eSS_310Helix,
+    eSS_ChainSeparator,
+    eSS_NR
+};
+
+//! Output codes, descriptions and colors for SecondaryStructure.
+const t_mapping c_ssMapping[eSS_NR] =
+{
+    { { '~', 0 }, "Coil",            { 1.0, 1.0, 1.0 } },
+    { { 'E', 0 }, "B-Sheet",         { 1.0, 0.0, 0.0 } },
+    { { 'B', 0 }, "B-Bridge",        { 0.0, 0.0, 0.0 } },
+    { { 'S', 0 }, "Bend",            { 0.0, 0.5, 0.0 } },
+    { { 'T', 0 }, "Turn",            { 1.0, 1.0, 0.0 } },
+    { { 'H', 0 }, "A-Helix",         { 0.0, 0.0, 1.0 } },
+    { { 'I', 0 }, "5-Helix",         { 0.5, 0.0, 0.5 } },
+    { { 'G', 0 }, "3-Helix",         { 0.5, 0.5, 0.5 } },
+    { { '=', 0 }, "Chain_Separator", { 0.9, 0.9, 0.9 } }
+};
+
+//! Role of a residue in an n-turn.
+enum HelixFlag
+{
+    eHelix_None,
+    eHelix_Start,
+    eHelix_End,
+    eHelix_StartAndEnd,
+    eHelix_Middle
+};
+
+//! Type of a beta bridge.
+enum BridgeType
+{
+    eBridge_None,
+    eBridge_Parallel,
+    eBridge_AntiParallel
+};
+
+//! Topology information for a residue included in the assignment.
+struct BackboneResidue
+{
+    //! Indices of the backbone atoms (see BackboneAtom) in the selection.
+    int  atom[eBackbone_NR];
+    //! Whether the backbone NH can act as an H-bond donor.
+    bool bDonor;
+    //! Whether the residue starts a new chain in the output.
+    bool bChainStart;
+};
+
+//! Backbone coordinates of a single frame.
+struct BackboneFrame
+{
+    //! Time of the frame.
+    real              time;
+    //! Whether `pbc` is valid.
+    bool              bPbc;
+    //! PBC information for the frame.
+    t_pbc             pbc;
+    //! Backbone coordinates, eBackbone_NR consecutive atoms per residue.
+    std::vector<RVec> x;
+};
+
+//! Computes `x1 - x2`, using PBC if \p pbc is not NULL.
+void backboneDx(const t_pbc *pbc, const rvec x1, const rvec x2, rvec dx)
+{
+    if (pbc != nullptr)
+    {
+        pbc_dx_aiuc(pbc, x1, x2, dx);
+    }
+    else
+    {
+        rvec_sub(x1, x2, dx);
+    }
+}
+
+/*! \brief
+ * Assigns secondary structure for a single frame.
+ *
+ * Keeps the work arrays needed for the assignment, such that a single object
+ * can be reused for any number of frames.  Different objects can be used
+ * concurrently from different threads.
+ */
+class SecondaryStructureCalculator
+{
+    public:
+        /*! \brief
+         * Initializes the calculator for a set of residues.
+         *
+         * \param[in] residues  Residues to assign.
+         * \param[in] nb        Neighborhood search with the H-bond search cutoff.
+         */
+        SecondaryStructureCalculator(const std::vector<BackboneResidue> &residues,
+                                     AnalysisNeighborhood               *nb);
+
+        /*! \brief
+         * Assigns the secondary structure for a frame.
+         *
+         * \param[in]  frame  Backbone coordinates.
+         * \param[out] ss     Assigned structure, one value for each residue.
+         */
+        void calculate(const BackboneFrame &frame, SecondaryStructure *ss);
+
+    private:
+        //! H-bond from the NH of a residue to the CO of `partner`.
+        struct HBond
+        {
+            int  partner;
+            real energy;
+        };
+        //! Set of bridges with consecutive residues.
+        struct Ladder
+        {
+            BridgeType       type;
+            std::vector<int> i;
+            std::vector<int> j;
+        };
+
+        //! Whether there are no chain breaks between residues \p a <= \p b.
+        bool noChainBreak(int a, int b) const
+        {
+            return breakCount_[a] == breakCount_[b];
+        }
+        //! Whether there is an H-bond from the NH of \p donor to the CO of \p acceptor.
+        bool testBond(int donor, int acceptor) const
+        {
+            const std::array<HBond, 2> &bonds = hbonds_[donor];
+            return (bonds[0].partner == acceptor && bonds[0].energy < c_maxHBondEnergy)
+                   || (bonds[1].partner == acceptor && bonds[1].energy < c_maxHBondEnergy);
+        }
+        //! Whether \p residue starts an n-turn with the given \p stride.
+        bool isHelixStart(int stride, int residue) const
+        {
+            const HelixFlag flag = helixFlags_[stride - 3][residue];
+            return flag == eHelix_Start || flag == eHelix_StartAndEnd;
+        }
+
+        void findChainBreaks(const t_pbc *pbc, const rvec x[]);
+        real hbondEnergy(const t_pbc *pbc, const rvec x[], int donor, int acceptor) const;
+        void addHBond(int donor, int acceptor, real energy);
+        void calculateHBonds(const t_pbc *pbc, const rvec x[]);
+        BridgeType testBridge(int i, int j) const;
+        void calculateBetaSheets(SecondaryStructure *ss);
+        bool isBend(const t_pbc *pbc, const rvec x[], int residue) const;
+        void calculateHelices(const t_pbc *pbc, const rvec x[], SecondaryStructure *ss);
+
+        const std::vector<BackboneResidue> &residues_;
+        AnalysisNeighborhood               *nb_;
+
+        //! Number of chain breaks up to each residue.
+        std::vector<int>                    breakCount_;
+        //! Whether each residue has a backbone H.
+        std::vector<bool>                   bHasHydrogen_;
+        //! Position of the backbone H relative to N for each residue.
+        std::vector<RVec>                   hydrogen_;
+        //! Two lowest-energy H-bonds from each residue to acceptor residues.
+        std::vector<std::array<HBond, 2> >  hbonds_;
+        //! CA positions for the neighborhood search.
+        std::vector<RVec>                   caPositions_;
+        //! Candidate residue pairs for beta bridges.
+        std::vector<std::pair<int, int> >   bridgeCandidates_;
+        //! Ladders found in the current frame.
+        std::vector<Ladder>                 ladders_;
+        //! n-turn flags for strides 3, 4, and 5.
+        std::vector<HelixFlag>              helixFlags_[3];
+};
+
+SecondaryStructureCalculator::SecondaryStructureCalculator(
+        const std::vector<BackboneResidue> &residues,
+        AnalysisNeighborhood               *nb)
+    : residues_(residues), nb_(nb)
+{
+    const size_t residueCount = residues.size();
+    breakCount_.resize(residueCount);
+    bHasHydrogen_.resize(residueCount);
+    hydrogen_.resize(residueCount);
+    hbonds_.resize(residueCount);
+    caPositions_.resize(residueCount);
+    for (int stride = 3; stride <= 5; ++stride)
+    {
+        helixFlags_[stride - 3].resize(residueCount);
+    }
+}
+
+void SecondaryStructureCalculator::findChainBreaks(const t_pbc *pbc, const rvec x[])
+{
+    const int residueCount = residues_.size();
+    breakCount_[0] = 0;
+    for (int i = 1; i < residueCount; ++i)
+    {
+        bool bBreak = residues_[i].bChainStart;
+        if (!bBreak)
+        {
+            rvec dx;
+            backboneDx(pbc, x[i*eBackbone_NR + eBackbone_N],
+                       x[(i - 1)*eBackbone_NR + eBackbone_C], dx);
+            bBreak = (norm2(dx) > gmx::square(c_maxPeptideBondLength));
+        }
+        breakCount_[i] = breakCount_[i - 1] + (bBreak ? 1 : 0);
+    }
+}
+
+real SecondaryStructureCalculator::hbondEnergy(const t_pbc *pbc, const rvec x[],
+                                               int donor, int acceptor) const
+{
+    const rvec &n = x[donor*eBackbone_NR + eBackbone_N];
+    rvec        dNO, dNC, dHO, dHC;
+    backboneDx(pbc, x[acceptor*eBackbone_NR + eBackbone_O], n, dNO);
+    backboneDx(pbc, x[acceptor*eBackbone_NR + eBackbone_C], n, dNC);
+    rvec_sub(dNO, hydrogen_[donor], dHO);
+    rvec_sub(dNC, hydrogen_[donor], dHC);
+    // The energy expression uses distances in Angstrom.
+    const real rNO = 10*norm(dNO);
+    const real rNC = 10*norm(dNC);
+    const real rHO = 10*norm(dHO);
+    const real rHC = 10*norm(dHC);
+    if (rNO < c_minimalDistance || rNC < c_minimalDistance
+        || rHO < c_minimalDistance || rHC < c_minimalDistance)
+    {
+        return c_minHBondEnergy;
+    }
+    real energy = c_couplingConstant*(1/rNO + 1/rHC - 1/rHO - 1/rNC);
+    // Round like DSSP does to get identical assignments.
+    energy = std::round(energy*1000)/1000;
+    return std::max(energy, c_minHBondEnergy);
+}
+
+void SecondaryStructureCalculator::addHBond(int donor, int acceptor, real energy)
+{
+    std::array<HBond, 2> &bonds = hbonds_[donor];
+    if (energy < bonds[0].energy)
+    {
+        bonds[1]         = bonds[0];
+        bonds[0].partner = acceptor;
+        bonds[0].energy  = energy;
+    }
+    else if (energy < bonds[1].energy)
+    {
+        bonds[1].partner = acceptor;
+        bonds[1].energy  = energy;
+    }
+}
+
+void SecondaryStructureCalculator::calculateHBonds(const t_pbc *pbc, const rvec x[])
+{
+    const int residueCount = residues_.size();
+    for (int i = 0; i < residueCount; ++i)
+    {
+        // The H is placed 1 Angstrom from N, along the C=O direction of the
+        // preceding residue.
+        bHasHydrogen_[i] = (residues_[i].bDonor && i > 0 && noChainBreak(i - 1, i));
+        if (bHasHydrogen_[i])
+        {
+            rvec co;
+            backboneDx(pbc, x[(i - 1)*eBackbone_NR + eBackbone_C],
+                       x[(i - 1)*eBackbone_NR + eBackbone_O], co);
+            svmul(0.1/norm(co), co, hydrogen_[i]);
+        }
+        for (int k = 0; k < 2; ++k)
+        {
+            hbonds_[i][k].partner = -1;
+            hbonds_[i][k].energy  = 0;
+        }
+        copy_rvec(x[i*eBackbone_NR + eBackbone_CA], caPositions_[i]);
+    }
+
+    AnalysisNeighborhoodSearch     search     = nb_->initSearch(pbc, caPositions_);
+    AnalysisNeighborhoodPairSearch pairSearch = search.startPairSearch(caPositions_);
+    AnalysisNeighborhoodPair       pair;
+    while (pairSearch.findNextPair(&pair))
+    {
+        const int i = pair.refIndex();
+        const int j = pair.testIndex();
+        if (i >= j)
+        {
+            continue;
+        }
+        if (bHasHydrogen_[i])
+        {
+            addHBond(i, j, hbondEnergy(pbc, x, i, j));
+        }
+        if (j != i + 1 && bHasHydrogen_[j])
+        {
+            addHBond(j, i, hbondEnergy(pbc, x, j, i));
+        }
+    }
+}
+
+BridgeType SecondaryStructureCalculator::testBridge(int i, int j) const
+{
+    const int a = i - 1, b = i, c = i + 1;
+    const int d = j - 1, e = j, f = j + 1;
+    if (!noChainBreak(a, c) || !noChainBreak(d, f))
+    {
+        return eBridge_None;
+    }
+    if ((testBond(c, e) && testBond(e, a)) || (testBond(f, b) && testBond(b, d)))
+    {
+        return eBridge_Parallel;
+    }
+    if ((testBond(c, d) && testBond(f, a)) || (testBond(e, b) && testBond(b, e)))
+    {
+        return eBridge_AntiParallel;
+    }
+    return eBridge_None;
+}
+
+void SecondaryStructureCalculator::calculateBetaSheets(SecondaryStructure *ss)
+{
+    const int residueCount = residues_.size();
+
+    // All H-bonds of a bridge are between residues i-1..i+1 and j-1..j+1, so
+    // only pairs close to an H-bond need to be tested.
+    bridgeCandidates_.clear();
+    for (int donor = 0; donor < residueCount; ++donor)
+    {
+        for (const HBond &bond : hbonds_[donor])
+        {
+            if (bond.energy >= c_maxHBondEnergy)
+            {
+                continue;
+            }
+            for (int di = -1; di <= 1; ++di)
+            {
+                for (int dj = -1; dj <= 1; ++dj)
+                {
+                    const int i = std::min(donor + di, bond.partner + dj);
+                    const int j = std::max(donor + di, bond.partner + dj);
+                    if (i >= 1 && i + 4 < residueCount && j >= i + 3 && j + 1 < residueCount)
+                    {
+                        bridgeCandidates_.emplace_back(i, j);
+                    }
+                }
+            }
+        }
+    }
+    std::sort(bridgeCandidates_.begin(), bridgeCandidates_.end());
+    bridgeCandidates_.erase(std::unique(bridgeCandidates_.begin(), bridgeCandidates_.end()),
+                            bridgeCandidates_.end());
+
+    ladders_.clear();
+    for (const auto &candidate : bridgeCandidates_)
+    {
+        const int        i    = candidate.first;
+        const int        j    = candidate.second;
+        const BridgeType type = testBridge(i, j);
+        if (type == eBridge_None)
+        {
+            continue;
+        }
+        bool bFound = false;
+        for (Ladder &ladder : ladders_)
+        {
+            if (type != ladder.type || i != ladder.i.back() + 1)
+            {
+                continue;
+            }
+            if (type == eBridge_Parallel && ladder.j.back() + 1 == j)
+            {
+                ladder.i.push_back(i);
+                ladder.j.push_back(j);
+                bFound = true;
+                break;
+            }
+            if (type == eBridge_AntiParallel && ladder.j.front() - 1 == j)
+            {
+                ladder.i.push_back(i);
+                ladder.j.insert(ladder.j.begin(), j);
+                bFound = true;
+                break;
+            }
+        }
+        if (!bFound)
+        {
+            ladders_.push_back(Ladder {type, {i}, {j}});
+        }
+    }
+
+    // Join ladders separated by a beta bulge.  The unsigned arithmetic follows
+    // DSSP: negative differences never satisfy the bulge criteria.
+    std::stable_sort(ladders_.begin(), ladders_.end(),
+                     [](const Ladder &l1, const Ladder &l2)
+                     {
+                         return l1.i.front() < l2.i.front();
+                     });
+    for (size_t li = 0; li < ladders_.size(); ++li)
+    {
+        for (size_t lj = li + 1; lj < ladders_.size(); ++lj)
+        {
+            Ladder         &l1  = ladders_[li];
+            const Ladder   &l2  = ladders_[lj];
+            const unsigned  ibi = l1.i.front(), iei = l1.i.back();
+            const unsigned  jbi = l1.j.front(), jei = l1.j.back();
+            const unsigned  ibj = l2.i.front(), iej = l2.i.back();
+            const unsigned  jbj = l2.j.front(), jej = l2.j.back();
+            if (l1.type != l2.type
+                || !noChainBreak(std::min(ibi, ibj), std::max(iei, iej))
+                || !noChainBreak(std::min(jbi, jbj), std::max(jei, jej))
+                || ibj - iei >= 6
+                || (iei >= ibj && ibi <= iej))
+            {
+                continue;
+            }
+            bool bBulge;
+            if (l1.type == eBridge_Parallel)
+            {
+                bBulge = ((jbj - jei < 6 && ibj - iei < 3) || jbj - jei < 3);
+            }
+            else
+            {
+                bBulge = ((jbi - jej < 6 && ibj - iei < 3) || jbi - jej < 3);
+            }
+            if (bBulge)
+            {
+                l1.i.insert(l1.i.end(), l2.i.begin(), l2.i.end());
+                if (l1.type == eBridge_Parallel)
+                {
+                    l1.j.insert(l1.j.end(), l2.j.begin(), l2.j.end());
+                }
+                else
+                {
+                    l1.j.insert(l1.j.begin(), l2.j.begin(), l2.j.end());
+                }
+                ladders_.erase(ladders_.begin() + lj);
+                --lj;
+            }
+        }
+    }
+
+    for (const Ladder &ladder : ladders_)
+    {
+        const SecondaryStructure type = (ladder.i.size() > 1 ? eSS_Strand : eSS_Bridge);
+        for (int r = ladder.i.front(); r <= ladder.i.back(); ++r)
+        {
+            if (ss[r] != eSS_Strand)
+            {
+                ss[r] = type;
+            }
+        }
+        for (int r = ladder.j.front(); r <= ladder.j.back(); ++r)
+        {
+            if (ss[r] != eSS_Strand)
+            {
+                ss[r] = type;
+            }
+        }
+    }
+}
+
+bool SecondaryStructureCalculator::isBend(const t_pbc *pbc, const rvec x[], int residue) const
+{
+    const int residueCount = residues_.size();
+    if (residue < 2 || residue + 2 >= residueCount
+        || !noChainBreak(residue - 2, residue + 2))
+    {
+        return false;
+    }
+    const rvec &ca = x[residue*eBackbone_NR + eBackbone_CA];
+    rvec        v1, v2;
+    backboneDx(pbc, ca, x[(residue - 2)*eBackbone_NR + eBackbone_CA], v1);
+    backboneDx(pbc, x[(residue + 2)*eBackbone_NR + eBackbone_CA], ca, v2);
+    return gmx_angle(v1, v2)*RAD2DEG > c_minBendAngle;
+}
+
+void SecondaryStructureCalculator::calculateHelices(const t_pbc *pbc, const rvec x[],
+                                                    SecondaryStructure *ss)
+{
+    const int residueCount = residues_.size();
+    for (int stride = 3; stride <= 5; ++stride)
+    {
+        std::vector<HelixFlag> &flags = helixFlags_[stride - 3];
+        std::fill(flags.begin(), flags.end(), eHelix_None);
+        for (int i = 0; i + stride < residueCount; ++i)
+        {
+            if (noChainBreak(i, i + stride) && testBond(i + stride, i))
+            {
+                flags[i + stride] = eHelix_End;
+                for (int j = i + 1; j < i + stride; ++j)
+                {
+                    if (flags[j] == eHelix_None)
+                    {
+                        flags[j] = eHelix_Middle;
+                    }
+                }
+                flags[i] = (flags[i] == eHelix_End ? eHelix_StartAndEnd : eHelix_Start);
+            }
+        }
+    }
+
+    for (int i = 1; i + 4 < residueCount; ++i)
+    {
+        if (isHelixStart(4, i) && isHelixStart(4, i - 1))
+        {
+            for (int j = i; j <= i + 3; ++j)
+            {
+                ss[j] = eSS_AlphaHelix;
+            }
+        }
+    }
+    for (int i = 1; i + 3 < residueCount; ++i)
+    {
+        if (isHelixStart(3, i) && isHelixStart(3, i - 1))
+        {
+            bool bEmpty = true;
+            for (int j = i; bEmpty && j <= i + 2; ++j)
+            {
+                bEmpty = (ss[j] == eSS_Loop || ss[j] == eSS_310Helix);
+            }
+            if (bEmpty)
+            {
+                std::fill(ss + i, ss + i + 3, eSS_310Helix);
+            }
+        }
+    }
+    for (int i = 1; i + 5 < residueCount; ++i)
+    {
+        if (isHelixStart(5, i) && isHelixStart(5, i - 1))
+        {
+            bool bEmpty = true;
+            for (int j = i; bEmpty && j <= i + 4; ++j)
+            {
+                bEmpty = (ss[j] == eSS_Loop || ss[j] == eSS_PiHelix
+                          || ss[j] == eSS_AlphaHelix);
+            }
+            if (bEmpty)
+            {
+                std::fill(ss + i, ss + i + 5, eSS_PiHelix);
+            }
+        }
+    }
+
+    for (int i = 1; i + 1 < residueCount; ++i)
+    {
+        if (ss[i] != eSS_Loop)
+        {
+            continue;
+        }
+        bool bTurn = false;
+        for (int stride = 3; stride <= 5 && !bTurn; ++stride)
+        {
+            for (int k = 1; k < stride && !bTurn; ++k)
+            {
+                bTurn = (i >= k && isHelixStart(stride, i - k));
+            }
+        }
+        if (bTurn)
+        {
+            ss[i] = eSS_Turn;
+        }
+        else if (isBend(pbc, x, i))
+        {
+            ss[i] = eSS_Bend;
+        }
+    }
+}
+
+void SecondaryStructureCalculator::calculate(const BackboneFrame &frame,
+                                             SecondaryStructure  *ss)
+{
+    const t_pbc *pbc = (frame.bPbc ? &frame.pbc : nullptr);
+    const rvec  *x   = as_rvec_array(frame.x.data());
+
+    std::fill(ss, ss + residues_.size(), eSS_Loop);
+    findChainBreaks(pbc, x);
+    calculateHBonds(pbc, x);
+    calculateBetaSheets(ss);
+    calculateHelices(pbc, x, ss);
+}
+
+/*! \brief
+ * Implements `gmx dssp` trajectory analysis module.
+ */
+class Dssp : public TrajectoryAnalysisModule
+{
+    public:
+        Dssp();
+
+        virtual void initOptions(IOptionsContainer          *options,
+                                 TrajectoryAnalysisSettings *settings);
+        virtual void initAnalysis(const TrajectoryAnalysisSettings &settings,
+                                  const TopologyInformation        &top);
+
+        virtual void analyzeFrame(int frnr, const t_trxframe &fr, t_pbc *pbc,
+                                  TrajectoryAnalysisModuleData *pdata);
+
+        virtual void finishAnalysis(int nframes);
+        virtual void writeOutput();
+
+    private:
+        //! Assigns the secondary structure for all frames collected in `batch_`.
+        void processBatch();
+
+        Selection                                  sel_;
+        std::string                                fnMatrix_;
+        std::string                                fnCount_;
+        std::string                                fnDump_;
+        std::string                                countTypes_;
+
+        //! Residues included in the assignment.
+        std::vector<BackboneResidue>               residues_;
+        //! Number of rows in the output matrix (residues and chain separators).
+        int                                        rowCount_;
+        //! Whether each structure type contributes to the total structure count.
+        bool                                       bCountType_[eSS_NR];
+        //! Neighborhood search for the H-bond calculation.
+        AnalysisNeighborhood                       nb_;
+        //! One calculator for each thread.
+        std::vector<SecondaryStructureCalculator>  calculators_;
+
+        //! Frames waiting to be processed.
+        std::vector<BackboneFrame>                 batch_;
+        //! Number of valid frames in `batch_`.
+        int                                        batchFrameCount_;
+        //! Assignments for the frames in `batch_`.
+        std::vector<SecondaryStructure>            batchStructure_;
+
+        //! Number of structure elements of each type as a function of time.
+        AnalysisData                               counts_;
+        //! Handle for adding data to `counts_`.
+        AnalysisDataHandle                         countHandle_;
+        //! Number of frames processed.
+        int                                        frameCount_;
+        //! Times of the processed frames.
+        std::vector<real>                          times_;
+        //! Assigned structure for the processed frames, `rowCount_` per frame.
+        std::vector<t_matelmt>                     matrix_;
+        //! Scaling factor for time values in the matrix output.
+        double                                     timeScale_;
+        //! Label for the time axis in the matrix output.
+        std::string                                timeLabel_;
+
+        // Copy and assign disallowed by base.
+};
+
+Dssp::Dssp()
+    : countTypes_("HEBT"), rowCount_(0), batchFrameCount_(0), frameCount_(0),
+      timeScale_(1.0)
+{
+    std::fill(bCountType_, bCountType_ + eSS_NR, false);
+}
+
+
+void
+Dssp::initOptions(IOptionsContainer *options, TrajectoryAnalysisSettings *settings)
+{
+    static const char *const desc[] = {
+        "[THISMODULE] assigns the secondary structure of a protein using the",
+        "DSSP algorithm of Kabsch and Sander. Unlike [gmx-do_dssp], it does",
+        "not call the external [TT]dssp[tt] program, but computes the",
+        "assignment directly from the trajectory.[PAR]",
+        "The backbone atoms N, CA, C, and O of the residues in [TT]-sel[tt]",
+        "are used; residues that lack any of these atoms are ignored.",
+        "The amide hydrogen is placed along the C=O direction of the",
+        "preceding residue, as in DSSP, so hydrogens in the input are not",
+        "needed. H-bonds are searched between residues with CA atoms",
+        "within 0.9 nm of each other.[PAR]",
+        "The structure as a function of time is written as a matrix to",
+        "[TT]-o[tt], with the same codes and colors as [gmx-do_dssp] uses",
+        "by default. A chain separator is inserted between residues that",
+        "belong to different chains or molecules, or that are not",
+        "consecutive in the topology. Chain breaks detected from the",
+        "coordinates (C-N distance over 0.25 nm) are treated as in DSSP,",
+        "but do not add rows to the matrix.",
+        "[TT]-sc[tt] gives the number of residues of each type as a",
+        "function of time; the first column is the total over the types",
+        "given with [TT]-sss[tt].",
+        "[TT]-ssdump[tt] writes the structure of each frame as a string.[PAR]",
+        "The frames are processed in parallel using OpenMP threads."
+    };
+
+    settings->setHelpText(desc);
+
+    options->addOption(FileNameOption("o").filetype(eftMatrix).outputFile().required()
+                           .store(&fnMatrix_).defaultBasename("ss")
+                           .description("Secondary structure as function of time"));
+    options->addOption(FileNameOption("sc").filetype(eftPlot).outputFile()
+                           .store(&fnCount_).defaultBasename("scount")
+                           .description("Number of residues in each structure type"));
+    options->addOption(FileNameOption("ssdump").filetype(eftGenericData).outputFile()
+                           .store(&fnDump_).defaultBasename("ssdump")
+                           .description("Secondary structure strings for each frame"));
+
+    options->addOption(StringOption("sss").store(&countTypes_)
+                           .description("Secondary structures for the structure count"));
+
+    options->addOption(SelectionOption("sel").store(&sel_).required()
+                           .onlyStatic().onlyAtoms()
+                           .defaultSelectionText("group \"Protein\"")
+                           .description("Protein residues to assign"));
+
+    settings->setFlag(TrajectoryAnalysisSettings::efRequireTop);
+}
+
+
+void
+Dssp::initAnalysis(const TrajectoryAnalysisSettings &settings,
+                   const TopologyInformation        &top)
+{
+    const t_atoms      &atoms       = top.topology()->atoms;
+    const t_block      &mols        = top.topology()->mols;
+    ConstArrayRef<int>  atomIndices = sel_.atomIndices();
+
+    // Returns the molecule index of an atom, or -1 if not known.
+    auto moleculeIndex = [&mols](int atomIndex)
+    {
+        if (mols.nr == 0)
+        {
+            return -1;
+        }
+        return static_cast<int>(std::upper_bound(mols.index, mols.index + mols.nr + 1,
+                                                 atomIndex) - mols.index) - 1;
+    };
+
+    int prevResidueIndex = -1;
+    for (size_t p = 0; p < atomIndices.size(); )
+    {
+        const int       residueIndex = atoms.atom[atomIndices[p]].resind;
+        const int       firstAtom    = atomIndices[p];
+        BackboneResidue residue;
+        std::fill(residue.atom, residue.atom + eBackbone_NR, -1);
+        int             terminalO = -1;
+        for (; p < atomIndices.size() && atoms.atom[atomIndices[p]].resind == residueIndex; ++p)
+        {
+            const char *name = *atoms.atomname[atomIndices[p]];
+            if (std::strcmp(name, "N") == 0)
+            {
+                residue.atom[eBackbone_N] = p;
+            }
+            else if (std::strcmp(name, "CA") == 0)
+            {
+                residue.atom[eBackbone_CA] = p;
+            }
+            else if (std::strcmp(name, "C") == 0)
+            {
+                residue.atom[eBackbone_C] = p;
+            }
+            else if (std::strcmp(name, "O") == 0)
+            {
+                residue.atom[eBackbone_O] = p;
+            }
+            else if (std::strcmp(name, "OC1") == 0 || std::strcmp(name, "OT1") == 0
+                     || std::strcmp(name, "O1") == 0 || std::strcmp(name, "OXT") == 0)
+            {
+                if (terminalO < 0)
+                {
+                    terminalO = p;
+                }
+            }
+        }
+        if (residue.atom[eBackbone_O] < 0)
+        {
+            residue.atom[eBackbone_O] = terminalO;
+        }
+        if (std::find(residue.atom, residue.atom + eBackbone_NR, -1)
+            != residue.atom + eBackbone_NR)
+        {
+            continue;
+        }
+        const t_resinfo &resinfo = atoms.resinfo[residueIndex];
+        residue.bDonor      = (std::strcmp(*resinfo.name, "PRO") != 0);
+        residue.bChainStart = false;
+        if (!residues_.empty())
+        {
+            const int prevAtom = atomIndices[residues_.back().atom[eBackbone_C]];
+            residue.bChainStart =
+                (residueIndex != prevResidueIndex + 1
+                 || resinfo.chainid != atoms.resinfo[prevResidueIndex].chainid
+                 || moleculeIndex(firstAtom) != moleculeIndex(prevAtom));
+        }
+        residues_.push_back(residue);
+        prevResidueIndex = residueIndex;
+    }
+    if (residues_.empty())
+    {
+        GMX_THROW(InconsistentInputError("Selection does not contain any residues with backbone atoms N, CA, C, and O"));
+    }
+    rowCount_ = 0;
+    for (const BackboneResidue &residue : residues_)
+    {
+        rowCount_ += (residue.bChainStart ? 2 : 1);
+    }
+
+    std::string subtitle = "Structure = ";
+    for (size_t i = 0; i < countTypes_.size(); ++i)
+    {
+        const t_mapping *type
+            = std::find_if(c_ssMapping, c_ssMapping + eSS_ChainSeparator,
+                           [&](const t_mapping &m) { return m.code.c1 == countTypes_[i]; });
+        if (type == c_ssMapping + eSS_ChainSeparator)
+        {
+            GMX_THROW(InvalidInputError(formatString("Unknown secondary structure type '%c' in -sss", countTypes_[i])));
+        }
+        bCountType_[type - c_ssMapping] = true;
+        if (i > 0)
+        {
+            subtitle.append(" + ");
+        }
+        subtitle.append(type->desc);
+    }
+
+    counts_.setColumnCount(0, 1 + eSS_ChainSeparator);
+    if (!fnCount_.empty())
+    {
+        AnalysisDataPlotModulePointer plotm(
+                new AnalysisDataPlotModule(settings.plotSettings()));
+        plotm->setFileName(fnCount_);
+        plotm->setTitle("Secondary Structure");
+        plotm->setSubtitle(subtitle);
+        plotm->setXAxisIsTime();
+        plotm->setYLabel("Number of Residues");
+        plotm->setYFormat(5, 0);
+        plotm->appendLegend("Structure");
+        for (int type = 0; type < eSS_ChainSeparator; ++type)
+        {
+            plotm->appendLegend(c_ssMapping[type].desc);
+        }
+        counts_.addModule(plotm);
+    }
+    countHandle_ = counts_.startData(AnalysisDataParallelOptions());
+
+    TimeUnitManager timeManager(settings.timeUnit());
+    timeScale_ = timeManager.inverseTimeScaleFactor();
+    timeLabel_ = formatString("Time (%s)", timeManager.timeUnitAsString());
+
+    nb_.setCutoff(c_hbondSearchCutoff);
+    const int threadCount = gmx_omp_get_max_threads();
+    calculators_.reserve(threadCount);
+    for (int i = 0; i < threadCount; ++i)
+    {
+        calculators_.emplace_back(residues_, &nb_);
+    }
+    batch_.resize(c_framesPerThread*threadCount);
+    for (BackboneFrame &frame : batch_)
+    {
+        frame.x.resize(residues_.size()*eBackbone_NR);
+    }
+    batchStructure_.resize(batch_.size()*residues_.size());
+}
+
+
+void
+Dssp::analyzeFrame(int /*frnr*/, const t_trxframe &fr, t_pbc *pbc,
+                   TrajectoryAnalysisModuleData *pdata)
+{
+    const Selection &sel   = pdata->parallelSelection(sel_);
+    BackboneFrame   &frame = batch_[batchFrameCount_];
+    frame.time = fr.time;
+    frame.bPbc = (pbc != nullptr);
+    if (pbc != nullptr)
+    {
+        frame.pbc = *pbc;
+    }
+    for (size_t r = 0; r < residues_.size(); ++r)
+    {
+        for (int a = 0; a < eBackbone_NR; ++a)
+        {
+            copy_rvec(sel.position(residues_[r].atom[a]).x(),
+                      frame.x[r*eBackbone_NR + a]);
+        }
+    }
+    ++batchFrameCount_;
+    if (batchFrameCount_ == static_cast<int>(batch_.size()))
+    {
+        processBatch();
+    }
+}
+
+
+void
+Dssp::processBatch()
+{
+    const int residueCount = residues_.size();
+    const int threadCount  = calculators_.size();
+#pragma omp parallel for num_threads(threadCount) schedule(dynamic)
+    for (int f = 0; f < batchFrameCount_; ++f)
+    {
+        try
+        {
+            calculators_[gmx_omp_get_thread_num()].calculate(
+                    batch_[f], &batchStructure_[f*residueCount]);
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+
+    for (int f = 0; f < batchFrameCount_; ++f)
+    {
+        const SecondaryStructure *ss = &batchStructure_[f*residueCount];
+        int                       count[eSS_NR] = { 0 };
+        for (int r = 0; r < residueCount; ++r)
+        {
+            if (residues_[r].bChainStart)
+            {
+                matrix_.push_back(eSS_ChainSeparator);
+            }
+            matrix_.push_back(ss[r]);
+            ++count[ss[r]];
+        }
+        int total = 0;
+        for (int type = 0; type < eSS_NR; ++type)
+        {
+            if (bCountType_[type])
+            {
+                total += count[type];
+            }
+        }
+        countHandle_.startFrame(frameCount_, batch_[f].time);
+        countHandle_.setPoint(0, total);
+        for (int type = 0; type < eSS_ChainSeparator; ++type)
+        {
+            countHandle_.setPoint(1 + type, count[type]);
+        }
+        countHandle_.finishFrame();
+        times_.push_back(batch_[f].time);
+        ++frameCount_;
+    }
+    batchFrameCount_ = 0;
+}
+
+
+void
+Dssp::finishAnalysis(int /*nframes*/)
+{
+    processBatch();
+    counts_.finishData(countHandle_);
+}
+
+
+void
+Dssp::writeOutput()
+{
+    if (frameCount_ == 0)
+    {
+        return;
+    }
+
+    if (!fnMatrix_.empty())
+    {
+        // Only include the structure types that occur in the legend.
+        bool present[eSS_NR] = { false };
+        for (t_matelmt value : matrix_)
+        {
+            present[value] = true;
+        }
+        std::vector<t_mapping> map;
+        t_matelmt              newIndex[eSS_NR];
+        for (int type = 0; type < eSS_NR; ++type)
+        {
+            newIndex[type] = map.size();
+            if (present[type])
+            {
+                map.push_back(c_ssMapping[type]);
+            }
+        }
+        std::vector<t_matelmt>  values(matrix_.size());
+        std::vector<t_matelmt*> columns(frameCount_);
+        std::vector<real>       axisX(frameCount_);
+        std::vector<real>       axisY(rowCount_);
+        for (size_t i = 0; i < matrix_.size(); ++i)
+        {
+            values[i] = newIndex[matrix_[i]];
+        }
+        for (int f = 0; f < frameCount_; ++f)
+        {
+            columns[f] = &values[f*rowCount_];
+            axisX[f]   = times_[f]*timeScale_;
+        }
+        for (int r = 0; r < rowCount_; ++r)
+        {
+            axisY[r] = r + 1;
+        }
+
+        t_matrix mat;
+        mat.flags     = 0;
+        mat.nx        = frameCount_;
+        mat.ny        = rowCount_;
+        mat.y0        = 0;
+        std::snprintf(mat.title, sizeof(mat.title), "Secondary structure");
+        mat.legend[0] = '\0';
+        std::snprintf(mat.label_x, sizeof(mat.label_x), "%s", timeLabel_.c_str());
+        std::snprintf(mat.label_y, sizeof(mat.label_y), "Residue");
+        mat.bDiscrete = TRUE;
+        mat.axis_x    = axisX.data();
+        mat.axis_y    = axisY.data();
+        mat.matrix    = columns.data();
+        mat.nmap      = map.size();
+        mat.map       = map.data();
+
+        FILE *fp = gmx_ffopen(fnMatrix_.c_str(), "w");
+        write_xpm_m(fp, mat);
+        gmx_ffclose(fp);
+    }
+
+    if (!fnDump_.empty())
+    {
+        FILE       *fp = gmx_ffopen(fnDump_.c_str(), "w");
+        std::string line(rowCount_, ' ');
+        fprintf(fp, "%d\n", rowCount_);
+        for (int f = 0; f < frameCount_; ++f)
+        {
+            for (int r = 0; r < rowCount_; ++r)
+            {
+                line[r] = c_ssMapping[matrix_[f*rowCount_ + r]].code.c1;
+            }
+            fprintf(fp, "%s\n", line.c_str());
+        }
+        gmx_ffclose(fp);
+    }
+}
+
+//! \}
+
+}       // namespace
+
+const char DsspInfo::name[]             = "dssp";
+const char DsspInfo::shortDescription[] =
+    "Assign secondary structure with a built-in DSSP implementation";
+
+TrajectoryAnalysisModulePointer DsspInfo::create()
+{
+    return TrajectoryAnalysisModulePointer(new Dssp);
+}
+
+} // namespace analysismodules
+
+} // namespace gmx
@@ -43,10 +43,17 @@
 
 #include "runnercommon.h"
 
+#include "config.h"
+
 #include <string.h>
 
+#if HAVE_SCHED_AFFINITY
+#  include <sched.h>
+#endif
+
 #include <algorithm>
 #include <string>
+#include <thread>
 
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/oenv.h"
@@ -125,6 +132,8 @@ class TrajectoryAnalysisRunnerCommon::Impl : public ITopologyProvider
         bool                        bStartTimeSet_;
         bool                        bEndTimeSet_;
         bool                        bDeltaTimeSet_;
+        //! Number of threads for analyzing frames (0 if not yet determined).
+        int                         threadCount_;
 
         bool                        bTrajOpen_;
         //! The current frame, or \p NULL if no frame loaded yet.
@@ -140,7 +149,7 @@ TrajectoryAnalysisRunnerCommon::Impl::Impl(TrajectoryAnalysisSettings *settings)
     : settings_(*settings),
       startTime_(0.0), endTime_(0.0), deltaTime_(0.0),
       bStartTimeSet_(false), bEndTimeSet_(false), bDeltaTimeSet_(false),
-      bTrajOpen_(false), fr(nullptr), gpbc_(nullptr), status_(nullptr), oenv_(nullptr)
+      threadCount_(1), bTrajOpen_(false), fr(nullptr), gpbc_(nullptr), status_(nullptr), oenv_(nullptr)
 {
 }
 
@@ -389,6 +398,33 @@ TrajectoryAnalysisRunnerCommon::initOptions(IOptionsContainer *options,
         options->addOption(BooleanOption("pbc").store(&settings.impl_->bPBC)
                                .description("Use periodic boundary conditions for distance calculation"));
     }
+    if (settings.hasFlag(TrajectoryAnalysisSettings::efFrameParallel))
+    {
+        impl_->threadCount_ = 0;
+        options->addOption(IntegerOption("nt").store(&impl_->threadCount_)
+                               .description("Number of threads for analyzing frames in parallel (0: the cores in the CPU affinity mask)"));
+    }
+}
+
+
+/*! \brief
+ * Returns the number of hardware threads this process may run on.
+ *
+ * Uses the CPU affinity mask of the process when it can be queried, so that
+ * the default does not oversubscribe the cores that a job scheduler has
+ * assigned, and the total number of hardware threads otherwise.
+ */
+static int availableThreadCount()
+{
+#if HAVE_SCHED_AFFINITY && defined CPU_COUNT
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &mask) == 0 && CPU_COUNT(&mask) > 0)
+    {
+        return CPU_COUNT(&mask);
+    }
+#endif
+    return std::max(1U, std::thread::hardware_concurrency());
 }
 
 
@@ -419,6 +455,15 @@ TrajectoryAnalysisRunnerCommon::optionsFinished()
     {
         setTimeValue(TDELTA, impl_->deltaTime_);
     }
+
+    if (impl_->threadCount_ < 0)
+    {
+        GMX_THROW(InconsistentInputError("Number of threads (-nt) cannot be negative"));
+    }
+    if (impl_->threadCount_ == 0)
+    {
+        impl_->threadCount_ = availableThreadCount();
+    }
 }
 
 
@@ -478,6 +523,13 @@ TrajectoryAnalysisRunnerCommon::hasTrajectory() const
 }
 
 
+int
+TrajectoryAnalysisRunnerCommon::threadCount() const
+{
+    return impl_->threadCount_;
+}
+
+
 const TopologyInformation &
 TrajectoryAnalysisRunnerCommon::topologyInformation() const
 {
@@ -120,6 +120,14 @@ class TrajectoryAnalysisRunnerCommon
 
         //! Returns true if input data comes from a trajectory.
         bool hasTrajectory() const;
+        /*! \brief
+         * Returns the number of threads to use for analyzing frames.
+         *
+         * Always one unless the module has set
+         * TrajectoryAnalysisSettings::efFrameParallel.
+         * Can be called after optionsFinished().
+         */
+        int threadCount() const;
         //! Returns the topology information object.
         const TopologyInformation &topologyInformation() const;
         //! Returns the currently loaded frame.
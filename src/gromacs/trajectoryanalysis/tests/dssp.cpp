@@ -0,0 +1,186 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for functionality of the "dssp" trajectory analysis module.
+ *
+ * The input is an ideal alpha helix followed by a beta hairpin, built from
+ * standard backbone geometry.  The matrix output is not compared, since its
+ * header contains information on the binary that produced it; the same
+ * assignment is tested through -ssdump.  The multi-frame input contains
+ * randomly perturbed copies of the same structure, and is used to check that
+ * the frames processed in batches get the same assignment as when each frame
+ * is processed alone.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "gromacs/trajectoryanalysis/modules/dssp.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/trajectoryanalysis/cmdlinerunner.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
+#include "gromacs/utility/textwriter.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/testfilemanager.h"
+#include "testutils/textblockmatchers.h"
+#include "testutils/xvgtest.h"
+
+#include "moduletest.h"
+
+namespace
+{
+
+using gmx::test::CommandLine;
+using gmx::test::CommandLineTestHelper;
+using gmx::test::ExactTextMatch;
+using gmx::test::NoTextMatch;
+using gmx::test::XvgMatch;
+
+/********************************************************************
+ * Tests for gmx::analysismodules::Dssp.
+ */
+
+//! Test fixture for the `dssp` analysis module.
+typedef gmx::test::TrajectoryAnalysisModuleTestFixture<gmx::analysismodules::DsspInfo>
+    DsspModuleTest;
+
+TEST_F(DsspModuleTest, AssignsSecondaryStructure)
+{
+    const char *const cmdline[] = {
+        "dssp"
+    };
+    setTopology("helixhairpin.gro");
+    setOutputFile("-o", ".xpm", NoTextMatch());
+    setOutputFile("-sc", ".xvg", XvgMatch());
+    setOutputFile("-ssdump", ".dat", ExactTextMatch());
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(DsspModuleTest, HandlesSelectedResidues)
+{
+    const char *const cmdline[] = {
+        "dssp",
+        "-sel", "resnr 1 to 12 19 to 36",
+        "-sss", "HG"
+    };
+    setTopology("helixhairpin.gro");
+    setOutputFile("-o", ".xpm", NoTextMatch());
+    setOutputFile("-sc", ".xvg", XvgMatch());
+    setOutputFile("-ssdump", ".dat", ExactTextMatch());
+    runTest(CommandLine(cmdline));
+}
+
+/********************************************************************
+ * Tests for batched processing in gmx::analysismodules::Dssp.
+ */
+
+//! Number of frames in helixhairpin-traj.gro.
+const int c_trajectoryFrameCount = 10;
+
+//! Test fixture for comparing batched and single-frame assignment in `dssp`.
+class DsspBatchTest : public gmx::test::CommandLineTestBase
+{
+    public:
+        /*! \brief
+         * Runs `dssp` on the trajectory in \p trajectoryFile.
+         *
+         * \returns The per-frame lines written to -ssdump.
+         */
+        std::vector<std::string> runDssp(const std::string &trajectoryFile)
+        {
+            const std::string dumpFile = fileManager().getTemporaryFilePath(".dat");
+            CommandLine       cmdline;
+            cmdline.append("dssp");
+            cmdline.addOption("-s", fileManager().getInputFilePath("helixhairpin.gro"));
+            cmdline.addOption("-f", trajectoryFile);
+            cmdline.addOption("-o", fileManager().getTemporaryFilePath(".xpm"));
+            cmdline.addOption("-ssdump", dumpFile);
+            EXPECT_EQ(0, CommandLineTestHelper::runModuleDirect(
+                              gmx::TrajectoryAnalysisCommandLineRunner::createModule(
+                                      gmx::analysismodules::DsspInfo::create()),
+                              &cmdline));
+            std::vector<std::string> lines
+                = gmx::splitString(gmx::TextReader::readFileToString(dumpFile));
+            // The first line contains the number of residues.
+            if (!lines.empty())
+            {
+                lines.erase(lines.begin());
+            }
+            return lines;
+        }
+};
+
+TEST_F(DsspBatchTest, BatchedFramesMatchSingleFrames)
+{
+    const std::string trajectoryFile
+        = fileManager().getInputFilePath("helixhairpin-traj.gro");
+    const std::vector<std::string> allFrames = runDssp(trajectoryFile);
+    ASSERT_EQ(c_trajectoryFrameCount, static_cast<int>(allFrames.size()));
+    // The perturbation should change the assignment over the trajectory.
+    EXPECT_NE(allFrames.front(), allFrames.back());
+
+    // Write each frame to a separate file, such that each is processed in
+    // its own batch.  -b and -e are not used, since they set global state.
+    const std::vector<std::string> trajectoryLines
+        = gmx::splitDelimitedString(gmx::TextReader::readFileToString(trajectoryFile), '\n');
+    const int                      linesPerFrame = trajectoryLines.size()/c_trajectoryFrameCount;
+    for (int frame = 0; frame < c_trajectoryFrameCount; ++frame)
+    {
+        SCOPED_TRACE(gmx::formatString("frame %d", frame));
+        std::string frameContents;
+        for (int i = frame*linesPerFrame; i < (frame + 1)*linesPerFrame; ++i)
+        {
+            frameContents.append(trajectoryLines[i]);
+            frameContents.append("\n");
+        }
+        const std::string frameFile
+            = fileManager().getTemporaryFilePath(gmx::formatString("frame%d.gro", frame));
+        gmx::TextWriter::writeFileFromString(frameFile, frameContents);
+        const std::vector<std::string> lines = runDssp(frameFile);
+        ASSERT_EQ(1U, lines.size());
+        EXPECT_EQ(allFrames[frame], lines[0]);
+    }
+}
+
+} // namespace
@@ -161,6 +161,17 @@ void gmx_set_error_handler(gmx_error_handler_t func)
     tMPI_Thread_mutex_unlock(&error_mutex);
 }
 
+static gmx_fatal_exit_callback_t gmx_fatal_exit_callback      = nullptr;
+static void                     *gmx_fatal_exit_callback_data = nullptr;
+
+void gmx_set_fatal_exit_callback(gmx_fatal_exit_callback_t func, void *data)
+{
+    tMPI_Thread_mutex_lock(&error_mutex);
+    gmx_fatal_exit_callback      = func;
+    gmx_fatal_exit_callback_data = data;
+    tMPI_Thread_mutex_unlock(&error_mutex);
+}
+
 static const char *gmx_strerror(const char *key)
 {
     struct ErrorKeyEntry {
@@ -207,6 +218,15 @@ static void call_error_handler(const char *key, const char *file, int line, cons
 
 void gmx_exit_on_fatal_error(ExitType exitType, int returnValue)
 {
+    tMPI_Thread_mutex_lock(&error_mutex);
+    gmx_fatal_exit_callback_t exitCallback     = gmx_fatal_exit_callback;
+    void                     *exitCallbackData = gmx_fatal_exit_callback_data;
+    tMPI_Thread_mutex_unlock(&error_mutex);
+    if (exitCallback != nullptr)
+    {
+        exitCallback(exitCallbackData);
+    }
+
     if (log_file)
     {
         std::fflush(log_file);
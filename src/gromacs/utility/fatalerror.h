@@ -3,7 +3,7 @@
  *
  * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
  * Copyright (c) 2001-2004, The GROMACS development team.
- * Copyright (c) 2012,2014,2015, by the GROMACS development team, led by
+ * Copyright (c) 2012,2014,2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -108,6 +108,19 @@ typedef void (*gmx_error_handler_t)(const char *title, const char *msg, const ch
  */
 void gmx_set_error_handler(gmx_error_handler_t func);
 
+/** Function pointer type for the callback before exiting on a fatal error. */
+typedef void (*gmx_fatal_exit_callback_t)(void *data);
+
+/*! \brief
+ * Sets a function that is called before the program exits on a fatal error.
+ *
+ * The callback is called by gmx_exit_on_fatal_error() with \p data, and
+ * can be used to complete file output that is in progress in other threads.
+ * It can be called from any thread that encounters a fatal error.
+ * Only one callback can be set, pass NULL to remove it.
+ */
+void gmx_set_fatal_exit_callback(gmx_fatal_exit_callback_t func, void *data);
+
 /** Identifies the state of the program on a fatal error. */
 enum ExitType
 {
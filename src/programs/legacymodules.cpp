@@ -56,6 +56,7 @@
 #include "gromacs/tools/check.h"
 #include "gromacs/tools/convert_tpr.h"
 #include "gromacs/tools/dump.h"
+#include "gromacs/tools/nonbonded-benchmark.h"
 
 #include "mdrun/mdrun_main.h"
 #include "view/view.h"
@@ -190,6 +191,10 @@ void registerLegacyModules(gmx::CommandLineModuleManager *manager)
             manager, gmx::InsertMoleculesInfo::name,
             gmx::InsertMoleculesInfo::shortDescription,
             &gmx::InsertMoleculesInfo::create);
+    gmx::ICommandLineOptionsModule::registerModuleFactory(
+            manager, gmx::NonbondedBenchmarkInfo::name,
+            gmx::NonbondedBenchmarkInfo::shortDescription,
+            &gmx::NonbondedBenchmarkInfo::create);
 
     // Modules from gmx_ana.h.
     registerModule(manager, &gmx_do_dssp, "do_dssp",
@@ -413,6 +418,7 @@ void registerLegacyModules(gmx::CommandLineModuleManager *manager)
         group.addModule("spatial");
         group.addModule("traj");
         group.addModule("tune_pme");
+        group.addModule("nonbonded-benchmark");
         group.addModule("wham");
         group.addModule("check");
         group.addModule("dump");
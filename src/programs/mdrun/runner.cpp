@@ -56,6 +56,7 @@
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/domdec.h"
+#include "gromacs/domdec/domdec_network.h"
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/essentialdynamics/edsam.h"
 #include "gromacs/ewald/pme.h"
@@ -1415,8 +1416,18 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
                fr ? fr->nbv : nullptr,
                EI_DYNAMICS(inputrec->eI) && !MULTISIM(cr));
 
-    // Free PME data
-    if (pmedata)
+    /* Free the shared-memory windows, after the last global communication */
+    if (DOMAINDECOMP(cr))
+    {
+        dd_shm_halo_done(cr->dd);
+    }
+    if (PAR(cr))
+    {
+        gmx_done_nodecomm(cr);
+    }
+
+    // Free PME data, PP ranks with separate PME ranks have none
+    if (pmedata && *pmedata)
     {
         gmx_pme_destroy(pmedata);
         pmedata = nullptr;
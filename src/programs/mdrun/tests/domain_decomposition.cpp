@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2015, by the GROMACS development team, led by
+ * Copyright (c) 2015,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -42,12 +42,20 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "gromacs/utility/basenetwork.h"
+#include "gromacs/utility/gmxmpi.h"
+
 #include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
 
+#include "mdruncomparisonfixture.h"
 #include "moduletest.h"
 
 namespace
@@ -74,4 +82,169 @@ TEST_F(DomainDecompositionSpecialCasesTest, AnEmptyDomainWorks)
     ASSERT_EQ(0, runner_.callMdrun());
 }
 
+/*! \brief Test fixture comparing domain decomposition runs that
+ * should produce the same results
+ *
+ * The reference and test runs differ in the environment variables
+ * and mdrun options set in the members below. Dynamic load balancing
+ * is turned off, so that both runs use the same decomposition
+ * throughout. */
+class DomainDecompositionComparisonTest : public gmx::test::MdrunComparisonFixture
+{
+    public:
+        using MdrunComparisonFixture::runTest;
+
+        DomainDecompositionComparisonTest() :
+            referenceEnvironmentVariable_(nullptr),
+            testEnvironmentVariable_(nullptr),
+            energyNames_({"LJ (SR)", "Coulomb (SR)", "Potential", "Kinetic En."})
+        {
+            referenceMdrunCaller_.addOption("-dlb", "no");
+            testMdrunCaller_.addOption("-dlb", "no");
+        }
+
+        //! Runs the reference and test mdrun calls and compares the results
+        virtual void runTest(const gmx::test::CommandLine     &gromppCallerRef,
+                             const char                       *simulationName,
+                             const char                       *integrator,
+                             const char                       *tcoupl,
+                             const char                       *pcoupl,
+                             gmx::test::FloatingPointTolerance tolerance)
+        {
+            auto mdpFieldValues = prepareMdpFieldValues(simulationName);
+            mdpFieldValues["other"] += extraMdpContents_;
+            runner_.useTopGroAndNdxFromDatabase(simulationName);
+            prepareMdpFile(mdpFieldValues, integrator, tcoupl, pcoupl);
+            ASSERT_EQ(0, runner_.callGrompp(gromppCallerRef));
+
+            std::string referenceEdrFileName = fileManager_.getTemporaryFilePath("reference.edr");
+            std::string referenceTrrFileName = fileManager_.getTemporaryFilePath("reference.trr");
+            std::string testEdrFileName      = fileManager_.getTemporaryFilePath("test.edr");
+            std::string testTrrFileName      = fileManager_.getTemporaryFilePath("test.trr");
+
+            runner_.edrFileName_                     = referenceEdrFileName;
+            runner_.fullPrecisionTrajectoryFileName_ = referenceTrrFileName;
+            ASSERT_EQ(0, callMdrun(referenceMdrunCaller_, referenceEnvironmentVariable_));
+
+            runner_.edrFileName_                     = testEdrFileName;
+            runner_.fullPrecisionTrajectoryFileName_ = testTrrFileName;
+            ASSERT_EQ(0, callMdrun(testMdrunCaller_, testEnvironmentVariable_));
+
+            /* Only the master rank writes the output files. With
+             * external MPI, the other ranks should not remove them
+             * before the comparison is done. */
+            if (gmx_node_rank() == 0)
+            {
+                compareRuns(referenceEdrFileName, referenceTrrFileName,
+                            testEdrFileName, testTrrFileName,
+                            energyNames_, tolerance, tolerance);
+            }
+#if GMX_LIB_MPI
+            MPI_Barrier(MPI_COMM_WORLD);
+#endif
+        }
+
+        //! Calls mdrun with \p environmentVariable set to 1, unless it is nullptr
+        int callMdrun(const gmx::test::CommandLine &callerRef,
+                      const char                   *environmentVariable)
+        {
+            if (environmentVariable == nullptr)
+            {
+                return runner_.callMdrun(callerRef);
+            }
+            return runner_.callMdrunWithEnvironmentVariable(callerRef, environmentVariable, "1");
+        }
+
+        //! Environment variable set for the reference run, can be nullptr
+        const char              *referenceEnvironmentVariable_;
+        //! Environment variable set for the test run, can be nullptr
+        const char              *testEnvironmentVariable_;
+        //! Command-line options for the reference run
+        gmx::test::CommandLine   referenceMdrunCaller_;
+        //! Command-line options for the test run
+        gmx::test::CommandLine   testMdrunCaller_;
+        //! Lines added to the .mdp file of the simulation
+        std::string              extraMdpContents_;
+        //! Energy terms to compare
+        std::vector<std::string> energyNames_;
+};
+
+/*! \brief The shared-memory halo exchange should move exactly the same
+ * data as the MPI halo exchange
+ *
+ * Shared memory is only used with MPI libraries that support MPI-3,
+ * otherwise both runs use MPI. */
+TEST_F(DomainDecompositionComparisonTest, SharedMemoryHaloExchangeMatchesMpi)
+{
+    referenceEnvironmentVariable_ = "GMX_DD_NO_SHM_HALO";
+    runTest("spc216", "md", "v-rescale", "no", gmx::test::ulpTolerance(0));
+}
+
+/*! \brief Overlapping the halo exchange with the force computation
+ * should not change any results
+ *
+ * The local forces are computed in the same order, so the results
+ * should be identical. */
+TEST_F(DomainDecompositionComparisonTest, OverlappedHaloExchangeMatchesBlocking)
+{
+    testEnvironmentVariable_ = "GMX_DD_OVERLAP_HALO";
+    runTest("spc216", "md", "v-rescale", "no", gmx::test::ulpTolerance(0));
+}
+
+//! As OverlappedHaloExchangeMatchesBlocking, with PME also computed during the communication
+TEST_F(DomainDecompositionComparisonTest, OverlappedHaloExchangeWithPmeMatchesBlocking)
+{
+    extraMdpContents_        = "coulombtype = PME\n";
+    testEnvironmentVariable_ = "GMX_DD_OVERLAP_HALO";
+    energyNames_.push_back("Coul. recip.");
+    runTest("alanine_vsite_solvated", "md", "v-rescale", "no", gmx::test::ulpTolerance(0));
+}
+
+/*! \brief Global summation with the intra-node step through shared
+ * memory should match summation through MPI
+ *
+ * The two-step summation is only used when the ranks span several
+ * nodes, otherwise both runs use a single MPI_Allreduce. The order of
+ * the summation differs between the two, so we compare within a
+ * tolerance. */
+TEST_F(DomainDecompositionComparisonTest, SharedMemoryGlobalSummationMatchesMpi)
+{
+    referenceEnvironmentVariable_ = "GMX_NO_NODECOMM_SHM";
+    energyNames_.push_back("Pressure");
+    runTest("spc216", "md", "v-rescale", "berendsen", gmx::test::relativeToleranceAsFloatingPoint(100, 1e-4));
+}
+
+/*! \brief Building the local topology with several OpenMP threads
+ * should match building it with one
+ *
+ * The thread-local interactions and exclusions are merged in parallel
+ * with multiple threads. The forces are also reduced over threads, so
+ * the results can only be compared within a tolerance. */
+TEST_F(DomainDecompositionComparisonTest, LocalTopologyWithThreadsMatchesSingleThread)
+{
+    referenceMdrunCaller_.addOption("-ntomp", 1);
+    testMdrunCaller_.addOption("-ntomp", 2);
+    runTest("alanine_vsite_solvated", "md", "v-rescale", "no", gmx::test::relativeToleranceAsFloatingPoint(100, 1e-4));
+}
+
+/*! \brief PME with pipelined grid communication between the PP ranks
+ * should match PME on a single separate rank
+ *
+ * Coulomb and LJ-PME give two grids to pipeline. The communication of
+ * the grid overlap is only non-blocking with multiple OpenMP threads.
+ * The work is divided differently over the ranks, so the trajectories
+ * slowly diverge and we can only compare within a tolerance. */
+TEST_F(DomainDecompositionComparisonTest, PipelinedPmeMatchesSinglePmeRank)
+{
+    extraMdpContents_ = "coulombtype = PME\n"
+        "vdwtype     = PME\n";
+    energyNames_.push_back("Coul. recip.");
+    energyNames_.push_back("LJ recip.");
+    referenceMdrunCaller_.addOption("-npme", 1);
+    referenceMdrunCaller_.addOption("-ntomp", 2);
+    testMdrunCaller_.addOption("-npme", 0);
+    testMdrunCaller_.addOption("-ntomp", 2);
+    runTest("spc216", "md", "v-rescale", "no", gmx::test::relativeToleranceAsFloatingPoint(100, 1e-3));
+}
+
 } // namespace
@@ -0,0 +1,133 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for dynamic pruning of the Verlet pair lists
+ *
+ * Compares energies and forces of runs with and without dynamic
+ * pruning. The pruned inner list has a smaller buffer, so the results
+ * should agree within the accuracy set by the buffer tolerance.
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
+
+#include "mdruncomparisonfixture.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+//! Log file message written when dynamic pruning is used
+const char *const c_dynamicPruningMessage = "Using a dual pair-list setup updated with dynamic pruning";
+
+//! Test fixture comparing runs with and without dynamic pruning
+class DynamicPruningTest : public MdrunComparisonFixture
+{
+    public:
+        using MdrunComparisonFixture::runTest;
+
+        //! Runs mdrun with and without dynamic pruning and compares the results
+        virtual void runTest(const CommandLine     &gromppCallerRef,
+                             const char            *simulationName,
+                             const char            *integrator,
+                             const char            *tcoupl,
+                             const char            *pcoupl,
+                             FloatingPointTolerance tolerance)
+        {
+            auto mdpFieldValues = prepareMdpFieldValues(simulationName);
+            runner_.useTopGroAndNdxFromDatabase(simulationName);
+            prepareMdpFile(mdpFieldValues, integrator, tcoupl, pcoupl);
+            ASSERT_EQ(0, runner_.callGrompp(gromppCallerRef));
+
+            std::string prunedEdrFileName   = fileManager_.getTemporaryFilePath("pruned.edr");
+            std::string prunedTrrFileName   = fileManager_.getTemporaryFilePath("pruned.trr");
+            std::string prunedLogFileName   = fileManager_.getTemporaryFilePath("pruned.log");
+            std::string unprunedEdrFileName = fileManager_.getTemporaryFilePath("unpruned.edr");
+            std::string unprunedTrrFileName = fileManager_.getTemporaryFilePath("unpruned.trr");
+            std::string unprunedLogFileName = fileManager_.getTemporaryFilePath("unpruned.log");
+
+            runner_.edrFileName_                     = prunedEdrFileName;
+            runner_.fullPrecisionTrajectoryFileName_ = prunedTrrFileName;
+            runner_.logFileName_                     = prunedLogFileName;
+            ASSERT_EQ(0, runner_.callMdrun(CommandLine()));
+
+            runner_.edrFileName_                     = unprunedEdrFileName;
+            runner_.fullPrecisionTrajectoryFileName_ = unprunedTrrFileName;
+            runner_.logFileName_                     = unprunedLogFileName;
+            ASSERT_EQ(0, runner_.callMdrunWithEnvironmentVariable(CommandLine(), "GMX_DISABLE_DYNAMICPRUNING", "1"));
+
+            /* Only the CPU kernels prune the list dynamically */
+#if GMX_GPU == GMX_GPU_NONE
+            EXPECT_NE(std::string::npos,
+                      TextReader::readFileToString(prunedLogFileName).find(c_dynamicPruningMessage));
+#endif
+            EXPECT_EQ(std::string::npos,
+                      TextReader::readFileToString(unprunedLogFileName).find(c_dynamicPruningMessage));
+
+            compareRuns(unprunedEdrFileName, unprunedTrrFileName,
+                        prunedEdrFileName, prunedTrrFileName,
+                        {"LJ (SR)", "Coulomb (SR)", "Potential"},
+                        tolerance, tolerance);
+        }
+};
+
+TEST_F(DynamicPruningTest, WaterMatchesUnprunedRun)
+{
+    runTest("spc216", "md", "v-rescale", "no", relativeToleranceAsFloatingPoint(100, 1e-4));
+}
+
+TEST_F(DynamicPruningTest, SolvatedPeptideMatchesUnprunedRun)
+{
+    runTest("alanine_vsite_solvated", "sd", "no", "no", relativeToleranceAsFloatingPoint(100, 1e-4));
+}
+
+} // namespace
+} // namespace test
+} // namespace gmx
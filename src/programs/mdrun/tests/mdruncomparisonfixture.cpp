@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2016, by the GROMACS development team, led by
+ * Copyright (c) 2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -52,6 +52,9 @@
 
 #include "testutils/testasserts.h"
 
+#include "energyreader.h"
+#include "trajectoryreader.h"
+
 namespace gmx
 {
 namespace test
@@ -248,5 +251,40 @@ void MdrunComparisonFixture::runTest(const char            *simulationName,
     runTest(caller, simulationName, integrator, tcoupl, pcoupl, tolerance);
 }
 
+void MdrunComparisonFixture::compareRuns(const std::string              &referenceEdrFileName,
+                                         const std::string              &referenceTrrFileName,
+                                         const std::string              &testEdrFileName,
+                                         const std::string              &testTrrFileName,
+                                         const std::vector<std::string> &energyNames,
+                                         FloatingPointTolerance          energyTolerance,
+                                         FloatingPointTolerance          trajectoryTolerance)
+{
+    auto referenceEnergies = openEnergyFileToReadFields(referenceEdrFileName, energyNames);
+    auto testEnergies      = openEnergyFileToReadFields(testEdrFileName, energyNames);
+    int  numEnergyFrames   = 0;
+    while (referenceEnergies->readNextFrame())
+    {
+        ASSERT_TRUE(testEnergies->readNextFrame());
+        compareFrames(std::make_pair(referenceEnergies->frame(), testEnergies->frame()),
+                      energyTolerance);
+        numEnergyFrames++;
+    }
+    EXPECT_FALSE(testEnergies->readNextFrame());
+    EXPECT_LT(0, numEnergyFrames);
+
+    TrajectoryFrameReader referenceFrames(referenceTrrFileName);
+    TrajectoryFrameReader testFrames(testTrrFileName);
+    int                   numTrajectoryFrames = 0;
+    while (referenceFrames.readNextFrame())
+    {
+        ASSERT_TRUE(testFrames.readNextFrame());
+        compareFrames(std::make_pair(referenceFrames.frame(), testFrames.frame()),
+                      trajectoryTolerance);
+        numTrajectoryFrames++;
+    }
+    EXPECT_FALSE(testFrames.readNextFrame());
+    EXPECT_LT(0, numTrajectoryFrames);
+}
+
 } // namespace test
 } // namespace gmx
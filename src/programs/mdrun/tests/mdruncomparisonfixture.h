@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2016, by the GROMACS development team, led by
+ * Copyright (c) 2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -135,6 +135,18 @@ class MdrunComparisonFixture : public MdrunTestFixture
                              const char            *tcoupl,
                              const char            *pcoupl,
                              FloatingPointTolerance tolerance);
+        /*! \brief Compares the energy fields \c energyNames in all
+         * frames of two energy files, and all frames of two full-precision
+         * trajectory files
+         *
+         * \throws  std::bad_alloc  if out of memory */
+        void compareRuns(const std::string              &referenceEdrFileName,
+                         const std::string              &referenceTrrFileName,
+                         const std::string              &testEdrFileName,
+                         const std::string              &testTrrFileName,
+                         const std::vector<std::string> &energyNames,
+                         FloatingPointTolerance          energyTolerance,
+                         FloatingPointTolerance          trajectoryTolerance);
 };
 
 } // namespace test
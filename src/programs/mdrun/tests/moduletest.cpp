@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -46,6 +46,8 @@
 #include "config.h"
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include "gromacs/gmxpreprocess/grompp.h"
 #include "gromacs/hardware/detecthardware.h"
@@ -89,6 +91,21 @@ GMX_TEST_OPTIONS(MdrunTestOptions, options)
 }
 //! \endcond
 
+#if GMX_OPENMP
+//! Returns whether \p commandLine contains the option \p name
+bool hasOption(const CommandLine &commandLine, const char *name)
+{
+    for (int i = 0; i < commandLine.argc(); ++i)
+    {
+        if (std::strcmp(commandLine.arg(i), name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
 }
 
 SimulationRunner::SimulationRunner(IntegrationTestFixture *fixture) :
@@ -241,7 +258,11 @@ SimulationRunner::callMdrun(const CommandLine &callerRef)
 #endif
 
 #if GMX_OPENMP
-    caller.addOption("-ntomp", g_numOpenMPThreads);
+    /* Tests that need a particular number of threads set it themselves */
+    if (!hasOption(callerRef, "-ntomp"))
+    {
+        caller.addOption("-ntomp", g_numOpenMPThreads);
+    }
 #endif
 
 #if GMX_GPU != GMX_GPU_NONE
@@ -270,6 +291,25 @@ SimulationRunner::callMdrun()
     return callMdrun(CommandLine());
 }
 
+int
+SimulationRunner::callMdrunWithEnvironmentVariable(const CommandLine &callerRef,
+                                                   const char        *name,
+                                                   const char        *value)
+{
+#ifdef _MSC_VER
+    _putenv_s(name, value);
+#else
+    setenv(name, value, 1);
+#endif
+    int result = callMdrun(callerRef);
+#ifdef _MSC_VER
+    _putenv_s(name, "");
+#else
+    unsetenv(name);
+#endif
+    return result;
+}
+
 // ====
 
 MdrunTestFixtureBase::MdrunTestFixtureBase()
@@ -1,7 +1,7 @@
 /*
  * This file is part of the GROMACS molecular simulation package.
  *
- * Copyright (c) 2013,2014,2015,2016, by the GROMACS development team, led by
+ * Copyright (c) 2013,2014,2015,2016,2017, by the GROMACS development team, led by
  * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
  * and including many others, as listed in the AUTHORS file in the
  * top-level source directory and at http://www.gromacs.org.
@@ -110,11 +110,22 @@ class SimulationRunner
         int callGromppOnThisRank(const CommandLine &callerRef);
         //! Convenience wrapper for a default call to \c callGromppOnThisRank
         int callGromppOnThisRank();
-        //! Calls mdrun for testing with a customized command line
+        /*! \brief Calls mdrun for testing with a customized command line
+         *
+         * An -ntomp option in \c callerRef takes precedence over the
+         * number of OpenMP threads set for the test binary. */
         int callMdrun(const CommandLine &callerRef);
         /*! \brief Convenience wrapper for calling mdrun for testing
          * with default command line */
         int callMdrun();
+        /*! \brief Calls mdrun with a customized command line and with
+         * environment variable \c name set to \c value during the call
+         *
+         * Several mdrun code paths can only be chosen through the
+         * environment. */
+        int callMdrunWithEnvironmentVariable(const CommandLine &callerRef,
+                                             const char        *name,
+                                             const char        *value);
 
     private:
         //! Provides access to the test fixture, e.g. for the TestFileManager
@@ -0,0 +1,243 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for tabulated non-bonded interactions with the Verlet scheme
+ *
+ * Compares the SIMD nbnxn kernels for user tables with the plain-C
+ * reference kernel, and user tables shifted like the potential-shift
+ * modifiers with the analytical cut-off interactions.
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
+
+#include "energyreader.h"
+#include "moduletest.h"
+#include "trajectoryreader.h"
+
+namespace gmx
+{
+namespace test
+{
+namespace
+{
+
+/*! \brief Writes a user table with plain Coulomb and 6-12 Lennard-Jones
+ * up to \p rmax nm
+ *
+ * The format is r, f, -f', g, -g', h, -h' with f = 1/r, g = -1/r^6
+ * and h = 1/r^12, as in the table6-12.xvg file in share/top.
+ * With \p rcutoff > 0 the potentials are shifted to zero at \p rcutoff
+ * and are zero beyond, which matches the analytical cut-off
+ * interactions with potential-shift modifiers.
+ */
+void writeUserTable(const std::string &fileName, double rmax, double rcutoff = 0)
+{
+    const double spacing = 0.002;
+    const int    n       = static_cast<int>(rmax/spacing + 0.5);
+    std::string  table;
+
+    for (int i = 0; i <= n; i++)
+    {
+        double r = i*spacing;
+        if (i == 0 || (rcutoff > 0 && r > rcutoff + 0.5*spacing))
+        {
+            table += formatString("%8.4f %15.8e %15.8e %15.8e %15.8e %15.8e %15.8e\n",
+                                  r, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0);
+            continue;
+        }
+        double fShift = 0, gShift = 0, hShift = 0;
+        if (rcutoff > 0)
+        {
+            fShift = 1/rcutoff;
+            gShift = -1/std::pow(rcutoff, 6);
+            hShift = 1/std::pow(rcutoff, 12);
+        }
+        table += formatString("%8.4f %15.8e %15.8e %15.8e %15.8e %15.8e %15.8e\n",
+                              r,
+                              1/r - fShift, 1/(r*r),
+                              -1/std::pow(r, 6) - gShift, -6/std::pow(r, 7),
+                              1/std::pow(r, 12) - hShift, 12/std::pow(r, 13));
+    }
+    TextWriter::writeFileFromString(fileName, table);
+}
+
+//! Test fixture for Verlet-scheme user tables
+class NbnxnUserTableTest : public MdrunTestFixture,
+                           public ::testing::WithParamInterface<const char *>
+{
+    public:
+        /*! \brief Runs the energy and force calculation for the spc216
+         * configuration, with \p environmentVariable set when not null
+         */
+        void runMdrun(const std::string &tableFileName,
+                      const std::string &edrFileName,
+                      const std::string &trrFileName,
+                      const char        *environmentVariable = nullptr)
+        {
+            CommandLine rerunCaller;
+            rerunCaller.append("mdrun");
+            rerunCaller.addOption("-rerun", runner_.groFileName_);
+            rerunCaller.addOption("-table", tableFileName);
+            runner_.edrFileName_                     = edrFileName;
+            runner_.fullPrecisionTrajectoryFileName_ = trrFileName;
+            if (environmentVariable != nullptr)
+            {
+                ASSERT_EQ(0, runner_.callMdrunWithEnvironmentVariable(rerunCaller, environmentVariable, "1"));
+            }
+            else
+            {
+                ASSERT_EQ(0, runner_.callMdrun(rerunCaller));
+            }
+        }
+
+        /*! \brief Compares the energies and forces of the first frames
+         * of two runs, the forces with relative tolerance \p forceTolerance
+         */
+        void compareRuns(const std::string &referenceEdrFileName,
+                         const std::string &referenceTrrFileName,
+                         const std::string &testEdrFileName,
+                         const std::string &testTrrFileName,
+                         double             forceTolerance)
+        {
+            auto referenceEnergies = openEnergyFileToReadFields(referenceEdrFileName, {"Coulomb (SR)", "LJ (SR)"});
+            auto testEnergies      = openEnergyFileToReadFields(testEdrFileName, {"Coulomb (SR)", "LJ (SR)"});
+            ASSERT_TRUE(referenceEnergies->readNextFrame());
+            ASSERT_TRUE(testEnergies->readNextFrame());
+            compareFrames(std::make_pair(referenceEnergies->frame(), testEnergies->frame()),
+                          relativeToleranceAsFloatingPoint(1, 2e-5));
+
+            TrajectoryFrameReader referenceFrames(referenceTrrFileName);
+            TrajectoryFrameReader testFrames(testTrrFileName);
+            ASSERT_TRUE(referenceFrames.readNextFrame());
+            ASSERT_TRUE(testFrames.readNextFrame());
+            compareFrames(std::make_pair(referenceFrames.frame(), testFrames.frame()),
+                          relativeToleranceAsFloatingPoint(100, forceTolerance));
+        }
+};
+
+TEST_P(NbnxnUserTableTest, SimdKernelsMatchReferenceKernel)
+{
+    runner_.useTopGroAndNdxFromDatabase("spc216");
+    runner_.useStringAsMdpFile(formatString("cutoff-scheme = Verlet\n"
+                                            "%s\n"
+                                            "rcoulomb      = 0.7\n"
+                                            "rvdw          = 0.7\n"
+                                            "nstcalcenergy = 1\n"
+                                            "nstenergy     = 1\n"
+                                            "nstfout       = 1\n", GetParam()));
+    // grompp warns about combination rules with user Van der Waals tables
+    CommandLine gromppCaller;
+    gromppCaller.append("grompp");
+    gromppCaller.addOption("-maxwarn", 1);
+    ASSERT_EQ(0, runner_.callGrompp(gromppCaller));
+
+    std::string tableFileName = fileManager_.getTemporaryFilePath("table.xvg");
+    writeUserTable(tableFileName, 2.0);
+
+    std::string simdEdrFileName      = fileManager_.getTemporaryFilePath("simd.edr");
+    std::string simdTrrFileName      = fileManager_.getTemporaryFilePath("simd.trr");
+    std::string referenceEdrFileName = fileManager_.getTemporaryFilePath("reference.edr");
+    std::string referenceTrrFileName = fileManager_.getTemporaryFilePath("reference.trr");
+
+    runMdrun(tableFileName, simdEdrFileName, simdTrrFileName);
+    runMdrun(tableFileName, referenceEdrFileName, referenceTrrFileName, "GMX_DISABLE_SIMD_KERNELS");
+
+    compareRuns(referenceEdrFileName, referenceTrrFileName, simdEdrFileName, simdTrrFileName, 1e-4);
+}
+
+TEST_F(NbnxnUserTableTest, ShiftedUserTablesMatchAnalyticalCutoff)
+{
+    const char *mdpFormat = "cutoff-scheme = Verlet\n"
+                            "%s\n"
+                            "rcoulomb      = 0.7\n"
+                            "rvdw          = 0.7\n"
+                            "nstcalcenergy = 1\n"
+                            "nstenergy     = 1\n"
+                            "nstfout       = 1\n";
+    runner_.useTopGroAndNdxFromDatabase("spc216");
+
+    std::string tableFileName = fileManager_.getTemporaryFilePath("table.xvg");
+    writeUserTable(tableFileName, 2.0, 0.7);
+
+    std::string userEdrFileName       = fileManager_.getTemporaryFilePath("user.edr");
+    std::string userTrrFileName       = fileManager_.getTemporaryFilePath("user.trr");
+    std::string analyticalEdrFileName = fileManager_.getTemporaryFilePath("analytical.edr");
+    std::string analyticalTrrFileName = fileManager_.getTemporaryFilePath("analytical.trr");
+
+    /* Plain cut-off electrostatics and Van der Waals interactions
+     * use potential-shift modifiers by default */
+    runner_.useStringAsMdpFile(formatString(mdpFormat, "coulombtype = Cut-off\nvdwtype = Cut-off"));
+    ASSERT_EQ(0, runner_.callGrompp());
+    runMdrun(tableFileName, analyticalEdrFileName, analyticalTrrFileName);
+
+    runner_.useStringAsMdpFile(formatString(mdpFormat, "coulombtype = User\nvdwtype = User"));
+    CommandLine gromppCaller;
+    gromppCaller.append("grompp");
+    gromppCaller.addOption("-maxwarn", 1);
+    ASSERT_EQ(0, runner_.callGrompp(gromppCaller));
+    runMdrun(tableFileName, userEdrFileName, userTrrFileName);
+
+    /* The forces also differ by the error of the cubic spline
+     * interpolation of the table */
+    compareRuns(analyticalEdrFileName, analyticalTrrFileName, userEdrFileName, userTrrFileName, 5e-4);
+}
+
+//! Electrostatics and Van der Waals settings, each using a user table
+const char *userTableSettings[] = {
+    "coulombtype = User\nvdwtype = Cut-off",
+    "coulombtype = Cut-off\nvdwtype = User",
+    "coulombtype = User\nvdwtype = User"
+};
+
+INSTANTIATE_TEST_CASE_P(WithUserTables, NbnxnUserTableTest,
+                            ::testing::ValuesIn(userTableSettings));
+
+} // namespace
+} // namespace test
+} // namespace gmx